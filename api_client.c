@@ -73,7 +73,9 @@ cu:
     return e;
 }
 
-derr_t api_token_write(api_token_t token, const char* path){
+static derr_t _api_token_write(
+    api_token_t token, const char *path, bool sync
+){
     derr_t e = E_OK;
     FILE *f = NULL;
     DSTR_VAR(tempstack, 256);
@@ -99,12 +101,15 @@ derr_t api_token_write(api_token_t token, const char* path){
         DKEY("nonce", DU(token.nonce)),
     );
     PROP_GO(&e, jdump(obj, WF(f), 2), cu);
+    if(sync) PROP_GO(&e, dffsync(f), cu);
 
     // check error when closing writable file descriptor
     PROP_GO(&e, dfclose2(&f), cu);
 
     // rename temp file into place
     PROP_GO(&e, drename_atomic(temp, path), cu);
+    // the rename itself must be durable too
+    if(sync) PROP_GO(&e, dfsync_parent(path), cu);
 
 cu:
     if(f) fclose(f);
@@ -112,20 +117,34 @@ cu:
     return e;
 }
 
-derr_t api_token_write_path(api_token_t token, const string_builder_t *sb){
+static derr_t _api_token_write_path(
+    api_token_t token, const string_builder_t *sb, bool sync
+){
     derr_t e = E_OK;
     DSTR_VAR(stack, 256);
     dstr_t heap = {0};
     dstr_t* path;
     PROP(&e, sb_expand(sb, &stack, &heap, &path) );
 
-    PROP_GO(&e, api_token_write(token, path->data), cu);
+    PROP_GO(&e, _api_token_write(token, path->data, sync), cu);
 
 cu:
     dstr_free(&heap);
     return e;
 }
 
+derr_t api_token_write(api_token_t token, const char* path){
+    derr_t e = E_OK;
+    PROP(&e, _api_token_write(token, path, false) );
+    return e;
+}
+
+derr_t api_token_write_path(api_token_t token, const string_builder_t *sb){
+    derr_t e = E_OK;
+    PROP(&e, _api_token_write_path(token, sb, false) );
+    return e;
+}
+
 derr_t api_token_read_increment_write(
     const char *path, api_token_t *token, bool *ok
 ){
@@ -170,25 +189,53 @@ cu:
     return e;
 }
 
-derr_t nonce_read_increment_write(const char *path, uint64_t *nonce){
+derr_t api_token_reserve_path(
+    nonce_reserver_t *r, const string_builder_t *sb, api_token_t *token
+){
+    derr_t e = E_OK;
+
+    if(!r->loaded){
+        // the nonce in the file may have been used already
+        r->reserved = token->nonce;
+        r->next = token->nonce + 1;
+        r->loaded = true;
+    }
+
+    if(r->next > r->reserved){
+        // reserve a new block before handing out anything in it
+        api_token_t copy = *token;
+        copy.nonce = r->next + NONCE_RESERVE_BLOCK - 1;
+        // the reservation must hit the disk before we use any of it
+        PROP(&e, _api_token_write_path(copy, sb, true) );
+        r->reserved = copy.nonce;
+    }
+
+    token->nonce = r->next++;
+
+    return e;
+}
+
+// if the file doesn't exist, that is considered equivalent to a nonce of 0
+static derr_t nonce_read(const char *path, uint64_t *nonce){
     derr_t e = E_OK;
 
     *nonce = 0;
 
-    // read file for initial value, if it exists
     bool ok;
     PROP(&e, dexists(path, &ok) );
-    if(ok){
-        DSTR_VAR(buf, 32);
-        PROP(&e, dstr_read_file(path, &buf) );
-        dstr_t stripped = dstr_strip_chars(buf, ' ', '\t', '\r', '\n');
-        PROP(&e, dstr_tou64(&stripped, nonce, 10) );
-    }
+    if(!ok) return e;
 
-    // increment
-    (*nonce)++;
+    DSTR_VAR(buf, 32);
+    PROP(&e, dstr_read_file(path, &buf) );
+    dstr_t stripped = dstr_strip_chars(buf, ' ', '\t', '\r', '\n');
+    PROP(&e, dstr_tou64(&stripped, nonce, 10) );
+
+    return e;
+}
+
+static derr_t nonce_write(const char *path, uint64_t nonce, bool sync){
+    derr_t e = E_OK;
 
-    // write updated file
     FILE *f = NULL;
     DSTR_VAR(tempstack, 256);
     dstr_t tempheap = {0};
@@ -205,17 +252,35 @@ derr_t nonce_read_increment_write(const char *path, uint64_t *nonce){
 
     // write the temp file
     PROP_GO(&e, dfopen(temp, "w", &f), cu);
-    PROP_GO(&e, FFMT(f, "%x\n", FU(*nonce)), cu);
+    PROP_GO(&e, FFMT(f, "%x\n", FU(nonce)), cu);
+    if(sync) PROP_GO(&e, dffsync(f), cu);
     PROP_GO(&e, dfclose2(&f), cu);
 
     // rename temp file into place
     PROP_GO(&e, drename_atomic(temp, path), cu);
+    // the rename itself must be durable too
+    if(sync) PROP_GO(&e, dfsync_parent(path), cu);
 
 cu:
     if(f) fclose(f);
     dstr_free(&tempheap);
     return e;
 }
+
+derr_t nonce_read_increment_write(const char *path, uint64_t *nonce){
+    derr_t e = E_OK;
+
+    // read file for initial value, if it exists
+    PROP(&e, nonce_read(path, nonce) );
+
+    // increment
+    (*nonce)++;
+
+    // write updated file
+    PROP(&e, nonce_write(path, *nonce, false) );
+
+    return e;
+}
 derr_t nonce_read_increment_write_path(string_builder_t *sb, uint64_t *nonce){
     derr_t e = E_OK;
     DSTR_VAR(stack, 256);
@@ -230,6 +295,43 @@ cu:
     return e;
 }
 
+derr_t nonce_reserve(nonce_reserver_t *r, const char *path, uint64_t *nonce){
+    derr_t e = E_OK;
+
+    if(!r->loaded){
+        // anything up to the file's value may have been used already
+        PROP(&e, nonce_read(path, &r->reserved) );
+        r->next = r->reserved + 1;
+        r->loaded = true;
+    }
+
+    if(r->next > r->reserved){
+        // reserve a new block before handing out anything in it
+        uint64_t reserved = r->next + NONCE_RESERVE_BLOCK - 1;
+        PROP(&e, nonce_write(path, reserved, true) );
+        r->reserved = reserved;
+    }
+
+    *nonce = r->next++;
+
+    return e;
+}
+derr_t nonce_reserve_path(
+    nonce_reserver_t *r, string_builder_t *sb, uint64_t *nonce
+){
+    derr_t e = E_OK;
+    DSTR_VAR(stack, 256);
+    dstr_t heap = {0};
+    dstr_t* path;
+    PROP(&e, sb_expand(sb, &stack, &heap, &path) );
+
+    PROP_GO(&e, nonce_reserve(r, path->data, nonce), cu);
+
+cu:
+    dstr_free(&heap);
+    return e;
+}
+
 // zeroizes and frees secret
 void installation_free0(installation_t *inst){
     api_token_free0(&inst->token);
@@ -491,16 +593,24 @@ static void delayed_error(schedulable_t *schedulable){
     apic_finish(apic);
 }
 
+// body_err is the result of reading and parsing the response body
 static derr_t read_resp(
     bool using_password,
     int status,
     dstr_t reason,
-    const dstr_t respbody,
+    derr_t *body_err,
     json_t *json
 ){
     derr_t e = E_OK;
 
+    // invalid json only matters after we know what the status was
+    bool bad_json = false;
+    CATCH(body_err, E_PARAM){
+        bad_json = true;
+    }else PROP_VAR(&e, body_err);
+
     if(status == 401 || status == 403){
+        DROP_VAR(body_err);
         if(using_password){
             ORIG(&e,
                 E_PASSWORD,
@@ -519,6 +629,7 @@ static derr_t read_resp(
     }
 
     if(status < 200 || status > 299){
+        DROP_VAR(body_err);
         ORIG(&e,
             E_RESPONSE,
             "REST API server returned %x: %x",
@@ -528,12 +639,11 @@ static derr_t read_resp(
     }
 
     // 2xx status means we have a json response
-    derr_t e2 = json_parse(respbody, json);
-    CATCH(&e2, E_PARAM){
+    if(bad_json){
         // invalid json is not allowed from the server
         json_free(json);
-        RETHROW(&e, &e2, E_RESPONSE);
-    }else PROP_VAR(&e, &e2);
+        RETHROW(&e, body_err, E_RESPONSE);
+    }
 
     return e;
 }
@@ -543,20 +653,16 @@ DEF_CONTAINER_OF(api_client_t, reader, stream_reader_t)
 static void apic_reader_cb(stream_reader_t *reader, derr_t err){
     api_client_t *apic = CONTAINER_OF(reader, api_client_t, reader);
 
-    // capture errors
-    PROP_VAR_GO(&apic->e, &err, done);
-
-    PROP_GO(&apic->e,
+    TRACE_PROP(&apic->e,
         read_resp(
             apic->using_password,
             apic->req.status,
             apic->req.reason,
-            apic->respbody,
+            &err,
             apic->json
-        ),
-    done);
+        )
+    );
 
-done:
     apic_finish(apic);
 }
 
@@ -609,7 +715,10 @@ static derr_t apic_mkreq(api_client_t *apic, dstr_t path, http_pairs_t *hdrs){
     // queue reading the request
     apic->respbody.len = 0;
     json_free(apic->json);
-    stream_read_all(&apic->reader, rstream, &apic->respbody, apic_reader_cb);
+    apic->parser = json_parser(apic->json);
+    stream_read_json(
+        &apic->reader, rstream, &apic->respbody, &apic->parser, apic_reader_cb
+    );
 
     return e;
 }
@@ -765,38 +874,36 @@ static derr_t mkreq_sync(
 ){
     derr_t e = E_OK;
 
-    dstr_t resp = {0};
-
     DSTR_VAR(durl, 256);
 
     // compose full url
-    PROP_GO(&e, FMT(&durl, "%x%x", FD(baseurl), FD(path)), cu);
+    PROP(&e, FMT(&durl, "%x%x", FD(baseurl), FD(path)) );
 
     url_t url;
-    PROP_GO(&e, parse_url(&durl, &url), cu);
+    PROP(&e, parse_url(&durl, &url) );
 
     int status;
     DSTR_VAR(reason, 256);
 
-    PROP_GO(&e,
-        http_sync_req(
-            sync,
-            HTTP_METHOD_POST,
-            url,
-            NULL, // params
-            hdrs,
-            reqbody,
-            NULL, // selectors
-            &status,
-            &reason,
-            &resp
-        ),
-    cu);
+    json_parser_t parser = json_parser(json);
+    derr_t e2 = http_sync_req_json(
+        sync,
+        HTTP_METHOD_POST,
+        url,
+        NULL, // params
+        hdrs,
+        reqbody,
+        NULL, // selectors
+        &status,
+        &reason,
+        &parser
+    );
 
-    PROP_GO(&e, read_resp(using_password, status, reason, resp, json), cu);
+    IF_PROP(&e, read_resp(using_password, status, reason, &e2, json) ){
+        // don't leave a partially-parsed body behind
+        json_free(json);
+    }
 
-cu:
-    dstr_free0(&resp);
     return e;
 }
 
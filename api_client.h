@@ -38,8 +38,10 @@ typedef struct {
     bool using_password;
     duv_http_req_t req;
     stream_reader_t reader;
+    json_parser_t parser;
     dstr_t url;
     dstr_t reqbody;
+    // scratch space; the response is parsed as it arrives
     dstr_t respbody;
 } api_client_t;
 
@@ -74,6 +76,41 @@ derr_t api_token_read_increment_write_path(
 derr_t nonce_read_increment_write(const char *path, uint64_t *nonce);
 derr_t nonce_read_increment_write_path(string_builder_t *sb, uint64_t *nonce);
 
+// how many nonces a nonce_reserver_t reserves with each write
+#define NONCE_RESERVE_BLOCK 64
+
+/* A nonce_reserver_t is for long-lived processes which make many api calls.
+   Rather than a read/increment/write of the nonce file for every call, it
+   writes (and fsyncs) the end of a block of nonces to the file, then hands
+   out the block from memory.
+
+   The file always holds the highest nonce we might have used, so no nonce is
+   ever reused after a restart or a crash; the rest of the block is just
+   skipped, which is fine because the server only requires that nonces
+   increase.
+
+   Zeroize a nonce_reserver_t to start, and again whenever its file might
+   have been changed by somebody else. */
+typedef struct {
+    bool loaded;
+    // the next nonce to hand out
+    uint64_t next;
+    // the value in the file; nothing after it is ours to hand out yet
+    uint64_t reserved;
+} nonce_reserver_t;
+
+derr_t nonce_reserve(nonce_reserver_t *r, const char *path, uint64_t *nonce);
+derr_t nonce_reserve_path(
+    nonce_reserver_t *r, string_builder_t *sb, uint64_t *nonce
+);
+
+/* same thing, but the nonce lives in an api_token_t's file, and token->nonce
+   is set to the next nonce.  If r is not loaded, token->nonce is taken to be
+   the value in the file. */
+derr_t api_token_reserve_path(
+    nonce_reserver_t *r, const string_builder_t *sb, api_token_t *token
+);
+
 // zeroizes and frees secret
 void installation_free0(installation_t *inst);
 
@@ -119,7 +119,7 @@ static derr_t do_copy(void){
     return e;
 }
 
-static derr_t _mysql_encrypt(MYSQL *sql, const dstr_t user){
+static derr_t _mysql_encrypt(sql_t *sql, const dstr_t user){
     derr_t e = E_OK;
 
     dstr_t fsid;
@@ -192,7 +192,7 @@ static derr_t mysql_encrypt(const dstr_t *sock){
     // get sql server ready
     PROP(&e, dmysql_library_init() );
 
-    MYSQL sql;
+    sql_t sql;
     PROP_GO(&e, dmysql_init(&sql), cu_sql_lib);
 
     PROP_GO(&e, sql_connect_unix(&sql, NULL, NULL, sock), cu_sql);
@@ -200,7 +200,7 @@ static derr_t mysql_encrypt(const dstr_t *sock){
     PROP_GO(&e, _mysql_encrypt(&sql, user), cu_sql);
 
 cu_sql:
-    mysql_close(&sql);
+    sql_close(&sql);
 
 cu_sql_lib:
     mysql_library_end();
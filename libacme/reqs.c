@@ -55,7 +55,7 @@ static derr_t jspec_astat_read(jspec_t *jspec, jctx_t *ctx){
     return e;
 }
 
-#define JASTAT(out) &((jspec_astat_t){ {jspec_astat_read}, out}.jspec)
+#define JASTAT(out) &((jspec_astat_t){ {jspec_astat_read, true}, out}.jspec)
 
 typedef struct {
     // inputs
@@ -456,13 +456,12 @@ static derr_t expect_status(
     // all handleable errors have json-parsable bodies
     json_t json;
     JSON_PREP_PREALLOCATED(json, 1024, 64, true);
-    PROP_GO(&e, json_parse(acme->rbuf, &json), unhandled);
     dstr_t type;
     jspec_t *jspec = JOBJ(true,
         JKEY("type", JDREF(&type)),
     );
     bool ok;
-    PROP_GO(&e, jspec_read_ex(jspec, json.root, &ok, NULL), unhandled);
+    PROP_GO(&e, jspec_parse_ex(jspec, acme->rbuf, &json, &ok, NULL), unhandled);
     if(!ok) goto unhandled;
 
     // match against recognized errors
@@ -499,13 +498,12 @@ static derr_t expect_status_range(
     // all handleable errors have json-parsable bodies
     json_t json;
     JSON_PREP_PREALLOCATED(json, 1024, 64, true);
-    PROP_GO(&e, json_parse(acme->rbuf, &json), unhandled);
     dstr_t type;
     jspec_t *jspec = JOBJ(true,
         JKEY("type", JDREF(&type)),
     );
     bool ok;
-    PROP_GO(&e, jspec_read_ex(jspec, json.root, &ok, NULL), unhandled);
+    PROP_GO(&e, jspec_parse_ex(jspec, acme->rbuf, &json, &ok, NULL), unhandled);
     if(!ok) goto unhandled;
 
     // match against recognized errors
@@ -579,9 +577,6 @@ static void get_directory_reader_cb(stream_reader_t *reader, derr_t err){
         expect_status(acme, 200, "fetching directory urls", NULL),
     done);
 
-    // parse body
-    PROP_GO(&e, json_parse(acme->rbuf, &json), done);
-
     // read body
     jspec_t *jspec = JOBJ(true,
         JKEY("keyChange", JDCPY(&acme->key_change)),
@@ -596,7 +591,9 @@ static void get_directory_reader_cb(stream_reader_t *reader, derr_t err){
 
     bool ok;
     DSTR_VAR(errbuf, 512);
-    PROP_GO(&e, jspec_read_ex(jspec, json.root, &ok, &errbuf), done);
+    PROP_GO(&e,
+        jspec_parse_ex(jspec, acme->rbuf, &json, &ok, &errbuf),
+    done);
     if(!ok) ORIG_GO(&e, E_RESPONSE, "%x", done, FD(errbuf));
 
     // parse all the urls
@@ -734,9 +731,6 @@ static void new_account_reader_cb(stream_reader_t *reader, derr_t err){
         goto done;
     }
 
-    // parse body
-    PROP_GO(&e, json_parse(acme->rbuf, &json), done);
-
     // read body
     acme_status_e status;
     jspec_t *jspec = JOBJ(true,
@@ -744,11 +738,11 @@ static void new_account_reader_cb(stream_reader_t *reader, derr_t err){
     );
     bool ok;
     DSTR_VAR(errbuf, 512);
-    PROP_GO(&e, jspec_read_ex(jspec, json.root, &ok, &errbuf), done);
+    PROP_GO(&e,
+        jspec_parse_ex(jspec, acme->rbuf, &json, &ok, &errbuf),
+    done);
     if(!ok){
-        FFMT_QUIET(stderr, "response was");
-        DROP_CMD( json_fdump(json.root, stderr) );
-        FFMT_QUIET(stderr, "\n");
+        FFMT_QUIET(stderr, "response was %x\n", FD(acme->rbuf));
         ORIG_GO(&e, E_RESPONSE, "%x", done, FD(errbuf));
     }
 
@@ -911,8 +905,6 @@ static derr_t read_order(dstr_t rbuf, json_t *json, order_t *order){
     *order = (order_t){0};
     bool have_cert, have_error, have_expire;
 
-    PROP(&e, json_parse(rbuf, json) );
-
     jspec_t *jspec = JOBJ(true,
         JKEY("authorizations", JTUP(
             JDREF(&order->authorization),
@@ -932,7 +924,7 @@ static derr_t read_order(dstr_t rbuf, json_t *json, order_t *order){
 
     bool ok;
     DSTR_VAR(errbuf, 512);
-    PROP(&e, jspec_read_ex(jspec, json->root, &ok, &errbuf) );
+    PROP(&e, jspec_parse_ex(jspec, rbuf, json, &ok, &errbuf) );
     if(!ok){
         ORIG(&e, E_RESPONSE, "%x", FD(errbuf));
     }
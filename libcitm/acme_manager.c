@@ -231,8 +231,8 @@ static derr_t pre_apic_call(acme_manager_t *am){
     FMT_QUIET(&name, "%x.nonce", FU(am->inst.token.key));
     string_builder_t path = sb_append(&am->acme_dir, SBD(name));
 
-    // read/increment/write the nonce from file
-    PROP(&e, nonce_read_increment_write_path(&path, &am->inst.token.nonce) );
+    // get a nonce, only writing to the file once per block of nonces
+    PROP(&e, nonce_reserve_path(&am->nonces, &path, &am->inst.token.nonce) );
 
     return e;
 }
@@ -884,6 +884,9 @@ static derr_t load_installation(acme_manager_t *am, bool *ok){
         return e;
     }else PROP_VAR(&e, &e2);
 
+    // a new installation means a new nonce file
+    am->nonces = (nonce_reserver_t){0};
+
     // create the full domain from the subdomain
     PROP(&e,
         FMT(
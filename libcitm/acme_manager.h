@@ -87,6 +87,8 @@ typedef struct {
 
     acme_account_t acct;
     installation_t inst;
+    // hands out nonces for inst.token
+    nonce_reserver_t nonces;
 
     status_maj_e maj;
     status_min_e min;
@@ -23,6 +23,7 @@ typedef struct {
     link_t cmds;
     link_t resps;
 
+    anon_adopt_f adopt;
     anon_cb cb;
     void *cb_data;
 
@@ -41,6 +42,7 @@ typedef struct {
     bool reading_dn : 1;
 
     bool login_cmd_recvd : 1;
+    bool adopt_tried : 1;
     bool write_up_sent : 1;
     bool login_resp_recvd : 1;
     bool write_dn_sent : 1;
@@ -426,8 +428,24 @@ static derr_t write_dn(anon_t *anon, bool success){
     return e;
 }
 
+// trade our client for one which is already logged in, if one is available
+static bool try_adopt(anon_t *anon){
+    if(!anon->adopt || anon->c->awaited) return false;
+
+    imap_client_t *c = anon->c;
+    imap_client_unawait(c);
+    bool ok = anon->adopt(anon->cb_data, anon->user, anon->pass, &c);
+    // either way, c is ours now
+    anon->c = c;
+    imap_client_must_await(c, cawait_cb, NULL);
+    c->data = anon;
+
+    return ok;
+}
+
 static void reset(anon_t *anon){
     anon->login_cmd_recvd = false;
+    anon->adopt_tried = false;
     anon->write_up_sent = false;
     anon->login_resp_recvd = false;
     anon->write_dn_sent = false;
@@ -465,6 +483,14 @@ static void advance_state(anon_t *anon){
             // have login cmd
             anon->login_cmd_recvd = true;
         }
+        // a pooled client makes the upwards LOGIN unnecessary
+        ONCE(anon->adopt_tried){
+            if(try_adopt(anon)){
+                anon->write_up_sent = true;
+                anon->login_resp_recvd = true;
+                anon->login_success = true;
+            }
+        }
         // send our LOGIN cmd upwards
         ONCE(anon->write_up_sent) PROP_GO(&anon->e, write_up(anon), fail);
         // read LOGIN response from above
@@ -522,6 +548,7 @@ derr_t anon_new(
     scheduler_i *scheduler,
     imap_server_t *s,
     imap_client_t *c,
+    anon_adopt_f adopt,
     anon_cb cb,
     void *cb_data,
     link_t *list
@@ -542,6 +569,7 @@ derr_t anon_new(
         .s = s,
         .c = c,
         .scheduler = scheduler,
+        .adopt = adopt,
         .cb = cb,
         .cb_data = cb_data,
     };
@@ -5,6 +5,7 @@
     - relay LOGIN command
     - capture successful credentials
     - check upwards CAPABILITY response
+    - or, skip the upwards LOGIN by adopting a client already logged in
 */
 
 // if e == E_OK and s,c == NULL, that means the client did a LOGOUT
@@ -17,11 +18,19 @@ typedef void (*anon_cb)(
     dstr_t pass
 );
 
-// no args are consumed on failure
+/* offered each LOGIN before it would be relayed; returning true means *c was
+   traded for a client already logged in as user, so the LOGIN is answered
+   without going upstream */
+typedef bool (*anon_adopt_f)(
+    void *data, const dstr_t user, const dstr_t pass, imap_client_t **c
+);
+
+// no args are consumed on failure; adopt may be NULL
 derr_t anon_new(
     scheduler_i *scheduler,
     imap_server_t *s,
     imap_client_t *c,
+    anon_adopt_f adopt,
     anon_cb cb,
     void *data,
     link_t *list
@@ -193,15 +193,22 @@ derr_t citm_init(
     citm_t *citm,
     citm_io_i *io,
     scheduler_i *scheduler,
-    string_builder_t root
+    string_builder_t root,
+    citm_pool_cfg_t pool_cfg
 ){
     derr_t e = E_OK;
 
-    *citm = (citm_t){ .io = io, .scheduler = scheduler, .root = root };
+    *citm = (citm_t){
+        .io = io,
+        .scheduler = scheduler,
+        .root = root,
+        .pool_cfg = pool_cfg,
+    };
 
     PROP_GO(&e, hashmap_init(&citm->preusers), fail);
     PROP_GO(&e, hashmap_init(&citm->users), fail);
     PROP_GO(&e, hashmap_init(&citm->holds), fail);
+    PROP_GO(&e, hashmap_init(&citm->upools), fail);
 
     return e;
 
@@ -214,6 +221,7 @@ void citm_free(citm_t *citm){
     hashmap_free(&citm->preusers);
     hashmap_free(&citm->users);
     hashmap_free(&citm->holds);
+    hashmap_free(&citm->upools);
     *citm = (citm_t){0};
 }
 
@@ -236,6 +244,83 @@ void citm_cancel(citm_t *citm){
     FOR_EACH_ELEM(citm->holds){
         hold_cancel(citm, elem);
     }
+    FOR_EACH_ELEM(citm->upools){
+        upool_cancel(elem);
+    }
+}
+
+// ask to be woken when the soonest pool needs attention
+static void citm_set_deadline(citm_t *citm){
+    hash_elem_t *elem;
+    hashmap_trav_t trav;
+    time_t when = 0;
+    FOR_EACH_ELEM(citm->upools){
+        time_t t = upool_deadline(elem);
+        if(t && (!when || t < when)) when = t;
+    }
+    if(when) citm->io->deadline(citm->io, when);
+}
+
+void citm_on_deadline(citm_t *citm){
+    hash_elem_t *elem;
+    hashmap_trav_t trav;
+    FOR_EACH_ELEM(citm->upools){
+        upool_tick(elem);
+    }
+    citm_set_deadline(citm);
+}
+
+// after a successful login, make sure the user has a pool for this password
+static void citm_ensure_upool(
+    citm_t *citm, const dstr_t user, const dstr_t pass
+){
+    derr_t e = E_OK;
+
+    dstr_t u = {0};
+    dstr_t p = {0};
+
+    if(!citm->pool_cfg.size) return;
+
+    hash_elem_t *elem = hashmap_gets(&citm->upools, &user);
+    if(elem){
+        if(upool_check(elem, pass)) return;
+        // the password changed, or the old pool is closing
+        hash_elem_remove(elem);
+        upool_cancel(elem);
+    }
+
+    PROP_GO(&e, dstr_new(&u, user.len), fail);
+    PROP_GO(&e, dstr_copy(&user, &u), fail);
+    PROP_GO(&e, dstr_new(&p, pass.len), fail);
+    PROP_GO(&e, dstr_copy(&pass, &p), fail);
+
+    PROP_GO(&e,
+        upool_new(
+            citm->scheduler, citm->io, citm->pool_cfg, u, p, &citm->upools
+        ),
+    fail);
+
+    citm_set_deadline(citm);
+
+    return;
+
+fail:
+    // pooling is only an optimization
+    DUMP(e);
+    DROP_VAR(&e);
+    dstr_free(&u);
+    dstr_free0(&p);
+}
+
+// anons offer each LOGIN to the user's pool before relaying it
+static bool citm_anon_adopt(
+    void *data, const dstr_t user, const dstr_t pass, imap_client_t **c
+){
+    citm_t *citm = data;
+    if(citm->canceled) return false;
+    hash_elem_t *elem = hashmap_gets(&citm->upools, &user);
+    if(!elem) return false;
+    return upool_adopt(elem, pass, c);
 }
 
 static void citm_preuser_cb(
@@ -397,6 +482,8 @@ static void citm_anon_cb(
 
     if(citm->canceled || !s || !c) goto free;
 
+    citm_ensure_upool(citm, user, pass);
+
     // check for existing user
     hash_elem_t *elem = hashmap_gets(&citm->users, &user);
     if(elem){
@@ -491,7 +578,15 @@ static void citm_io_pair_cb(
     conn_up = NULL;
 
     PROP_GO(&e,
-        anon_new(citm->scheduler, s, c, citm_anon_cb, citm, &citm->anons),
+        anon_new(
+            citm->scheduler,
+            s,
+            c,
+            citm_anon_adopt,
+            citm_anon_cb,
+            citm,
+            &citm->anons
+        ),
     fail);
 
     return;
@@ -36,8 +36,24 @@ struct citm_io_i;
 typedef struct citm_io_i citm_io_i;
 struct citm_io_i {
     derr_t (*connect_imap)(citm_io_i*, citm_conn_cb, void*, citm_connect_i**);
+    // return the time right now
+    time_t (*now)(citm_io_i*);
+    // when the deadline fires, call citm_on_deadline(); replaces any previous
+    void (*deadline)(citm_io_i*, time_t when);
 };
 
+typedef struct {
+    // logged-in upstream connections to keep ready per user; 0 disables
+    size_t size;
+    // seconds without an adoption before a user's pool is closed
+    time_t idle_timeout;
+} citm_pool_cfg_t;
+
+#define CITM_POOL_SIZE 2
+#define CITM_POOL_IDLE_TIMEOUT 600
+#define CITM_POOL_CFG_DEFAULT \
+    ((citm_pool_cfg_t){ CITM_POOL_SIZE, CITM_POOL_IDLE_TIMEOUT })
+
 /* citm_t is the io-agnostic business logic.
 
    Everything inside citm_t is io-agnostic to make unit testing easy.
@@ -50,6 +66,9 @@ struct citm_io_i {
      - stage 3, preuser_t: create and synchronize a matching keysync_t
      - stage 4, user_t.sc_t: full blown citm
 
+   Alongside the stages, each user who has logged in gets a upool_t of spare
+   upstream connections, already logged in, which anon_t can adopt.
+
    citm_t ownership tree:
 
        citm_t
@@ -73,6 +92,8 @@ struct citm_io_i {
          - holds{}
              - servers[]
              - clients[]
+         - upools{}
+             - clients[]
 */
 
 
@@ -88,6 +109,9 @@ typedef struct {
     hashmap_t preusers;  // preuser_t->elem
     hashmap_t users;  // user_t->elem
     hashmap_t holds;  // citm_hold_t->elem
+    hashmap_t upools;  // upool_t->elem
+
+    citm_pool_cfg_t pool_cfg;
 
     // objects we are awaiting in order to delete
     struct {
@@ -103,7 +127,8 @@ derr_t citm_init(
     citm_t *citm,
     citm_io_i *io,
     scheduler_i *scheduler,
-    string_builder_t root
+    string_builder_t root,
+    citm_pool_cfg_t pool_cfg
 );
 void citm_free(citm_t *citm);
 
@@ -111,6 +136,8 @@ void citm_cancel(citm_t *citm);
 
 void citm_on_imap_connection(citm_t *citm, citm_conn_t *conn);
 
+void citm_on_deadline(citm_t *citm);
+
 #define FOR_EACH_LINK(list) \
     for( \
         link = (list).next ? (list).next : &(list); \
@@ -0,0 +1,428 @@
+#include "libimap/libimap.h"
+#include "libcitm/trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Turns a citm trace (see libcitm/trace.h) into per-command latency
+   breakdowns.  Each tagged command from a client is split into phases:
+
+     parse: from the last read from the client until the command was parsed
+     up:    time with commands in flight to the server
+     dir:   time spent in the imaildir, gathering or storing updates
+     citm:  the rest of the time until the tagged response was queued
+     send:  until the response was written to the client
+     total: all of the above
+
+   Commands from a pipelining client may overlap; up and dir time is charged
+   to the oldest command still waiting on its response.  Commands whose
+   events were overwritten in the ring, or which were unfinished when the
+   trace ended, are not reported.  Neither are commands dropped because more
+   than MAX_PENDING were waiting on one connection; those are counted.
+
+   A trace must be read on a host with the same byte order as the citm that
+   wrote it.
+
+   usage: citm_trace [-v] TRACE_FILE */
+
+typedef enum {
+    PH_TOTAL,
+    PH_PARSE,
+    PH_CITM,
+    PH_UP,
+    PH_DIR,
+    PH_SEND,
+    NPHASES,
+} phase_e;
+
+static const char *phase_names[NPHASES] = {
+    "total", "parse", "citm", "up", "dir", "send",
+};
+
+typedef struct {
+    uint32_t conn;
+    uint16_t type;
+    uint8_t taglen;
+    char tag[CITM_TRACE_TAG_MAX];
+    uint64_t t_recv;
+    uint64_t t_cmd;
+    uint64_t t_resp;
+    uint64_t up;
+    uint64_t dir;
+    bool responded;
+    uint64_t ph[NPHASES];
+} cmd_t;
+
+#define MAX_PENDING 16
+
+typedef struct {
+    uint64_t last_recv;
+    cmd_t pending[MAX_PENDING];
+    size_t npending;
+    // upstream commands in flight, and when we last charged for them
+    size_t up_inflight;
+    uint64_t up_mark;
+    uint64_t dir_start;
+} conn_t;
+
+typedef struct {
+    conn_t *conns; // indexed by server id
+    size_t nids;
+    cmd_t *done;
+    size_t ndone;
+    size_t cap;
+    // commands pushed out of a full conn_t.pending
+    size_t dropped;
+    bool verbose;
+} report_t;
+
+static double us(uint64_t ns){
+    return (double)ns / 1000;
+}
+
+// the oldest command still waiting on its response
+static cmd_t *oldest_waiting(conn_t *c){
+    for(size_t i = 0; i < c->npending; i++){
+        if(!c->pending[i].responded) return &c->pending[i];
+    }
+    return NULL;
+}
+
+static void charge_up(conn_t *c, uint64_t now){
+    cmd_t *cmd = oldest_waiting(c);
+    if(cmd && c->up_inflight){
+        uint64_t since = MAX(c->up_mark, cmd->t_cmd);
+        if(now > since) cmd->up += now - since;
+    }
+    c->up_mark = now;
+}
+
+static void pop_pending(conn_t *c){
+    c->npending--;
+    memmove(&c->pending[0], &c->pending[1], c->npending * sizeof(cmd_t));
+}
+
+static derr_t finish(report_t *r, cmd_t *cmd, uint64_t t_sent){
+    derr_t e = E_OK;
+
+    uint64_t work = cmd->t_resp - cmd->t_cmd;
+    uint64_t up = MIN(cmd->up, work);
+    uint64_t dir = MIN(cmd->dir, work - up);
+    cmd->ph[PH_TOTAL] = t_sent - cmd->t_recv;
+    cmd->ph[PH_PARSE] = cmd->t_cmd - cmd->t_recv;
+    cmd->ph[PH_CITM] = work - up - dir;
+    cmd->ph[PH_UP] = up;
+    cmd->ph[PH_DIR] = dir;
+    cmd->ph[PH_SEND] = t_sent - cmd->t_resp;
+
+    if(r->verbose){
+        dstr_t type = imap_cmd_type_to_dstr(cmd->type);
+        printf(
+            "conn=%u tag=%.*s %.*s total=%.1f parse=%.1f citm=%.1f "
+            "up=%.1f dir=%.1f send=%.1f\n",
+            (unsigned)cmd->conn,
+            (int)cmd->taglen, cmd->tag,
+            (int)type.len, type.data,
+            us(cmd->ph[PH_TOTAL]),
+            us(cmd->ph[PH_PARSE]),
+            us(cmd->ph[PH_CITM]),
+            us(cmd->ph[PH_UP]),
+            us(cmd->ph[PH_DIR]),
+            us(cmd->ph[PH_SEND])
+        );
+    }
+
+    if(r->ndone == r->cap){
+        size_t cap = r->cap ? r->cap * 2 : 1024;
+        cmd_t *done = realloc(r->done, cap * sizeof(*done));
+        if(!done) ORIG(&e, E_NOMEM, "nomem");
+        r->done = done;
+        r->cap = cap;
+    }
+    r->done[r->ndone++] = *cmd;
+
+    return e;
+}
+
+static bool tag_eq(const cmd_t *cmd, const citm_trace_rec_t *rec){
+    return cmd->taglen == rec->taglen
+        && memcmp(cmd->tag, rec->tag, rec->taglen) == 0;
+}
+
+static conn_t *get_conn(report_t *r, uint32_t id){
+    if(id == 0 || id >= r->nids) return NULL;
+    return &r->conns[id];
+}
+
+static derr_t process(report_t *r, const citm_trace_rec_t *rec){
+    derr_t e = E_OK;
+
+    conn_t *c;
+    cmd_t *cmd;
+
+    switch((citm_trace_ev_e)rec->ev){
+        case CITM_TRACE_DN_RECV:
+            if(!(c = get_conn(r, rec->conn))) break;
+            c->last_recv = rec->ns;
+            break;
+
+        case CITM_TRACE_DN_CMD:
+            // untagged commands, like DONE, have no response to wait for
+            if(!rec->taglen) break;
+            if(!(c = get_conn(r, rec->conn))) break;
+            charge_up(c, rec->ns);
+            if(c->npending == MAX_PENDING){
+                pop_pending(c);
+                r->dropped++;
+            }
+            cmd = &c->pending[c->npending++];
+            *cmd = (cmd_t){
+                .conn = rec->conn,
+                .type = (uint16_t)rec->aux,
+                .taglen = rec->taglen,
+                .t_recv = c->last_recv ? c->last_recv : rec->ns,
+                .t_cmd = rec->ns,
+            };
+            memcpy(cmd->tag, rec->tag, rec->taglen);
+            break;
+
+        case CITM_TRACE_DN_RESP:
+            if(!(c = get_conn(r, rec->conn))) break;
+            charge_up(c, rec->ns);
+            for(size_t i = 0; i < c->npending; i++){
+                cmd = &c->pending[i];
+                if(cmd->responded || !tag_eq(cmd, rec)) continue;
+                cmd->responded = true;
+                cmd->t_resp = rec->ns;
+                break;
+            }
+            break;
+
+        case CITM_TRACE_DN_SENT:
+            if(!(c = get_conn(r, rec->conn))) break;
+            while(c->npending && c->pending[0].responded){
+                PROP(&e, finish(r, &c->pending[0], rec->ns) );
+                pop_pending(c);
+            }
+            break;
+
+        case CITM_TRACE_UP_CMD:
+            // DONE ends an IDLE, but the IDLE's response is what we wait on
+            if(!rec->taglen) break;
+            if(!(c = get_conn(r, rec->conn))) break;
+            charge_up(c, rec->ns);
+            c->up_inflight++;
+            break;
+
+        case CITM_TRACE_UP_RESP:
+            if(!(c = get_conn(r, rec->conn))) break;
+            charge_up(c, rec->ns);
+            if(c->up_inflight) c->up_inflight--;
+            break;
+
+        case CITM_TRACE_DIR_START:
+            if(!(c = get_conn(r, rec->conn))) break;
+            // time in the imaildir is not also upstream time
+            charge_up(c, rec->ns);
+            c->dir_start = rec->ns;
+            break;
+
+        case CITM_TRACE_DIR_DONE:
+            if(!(c = get_conn(r, rec->conn))) break;
+            if(!c->dir_start) break;
+            cmd = oldest_waiting(c);
+            if(cmd) cmd->dir += rec->ns - MAX(c->dir_start, cmd->t_cmd);
+            c->dir_start = 0;
+            c->up_mark = rec->ns;
+            break;
+
+        // only useful for matching up raw client-side events
+        case CITM_TRACE_LINK:
+        case CITM_TRACE_UP_SENT:
+        case CITM_TRACE_UP_RECV:
+            break;
+    }
+
+    return e;
+}
+
+static int cmp_u64(const void *a, const void *b){
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_type(const void *a, const void *b){
+    const cmd_t *x = a;
+    const cmd_t *y = b;
+    return (x->type > y->type) - (x->type < y->type);
+}
+
+static derr_t summarize(report_t *r){
+    derr_t e = E_OK;
+
+    if(!r->ndone){
+        printf("no complete commands in trace\n");
+        return e;
+    }
+
+    uint64_t *samples = malloc(r->ndone * sizeof(*samples));
+    if(!samples) ORIG(&e, E_NOMEM, "nomem");
+
+    qsort(r->done, r->ndone, sizeof(*r->done), cmp_type);
+
+    printf(
+        "%-14s %8s %-6s %12s %12s %12s\n",
+        "command", "count", "phase", "mean us", "p50 us", "p99 us"
+    );
+    size_t start = 0;
+    while(start < r->ndone){
+        size_t end = start;
+        while(end < r->ndone && r->done[end].type == r->done[start].type){
+            end++;
+        }
+        size_t n = end - start;
+        dstr_t type = imap_cmd_type_to_dstr(r->done[start].type);
+        for(int ph = 0; ph < NPHASES; ph++){
+            double sum = 0;
+            for(size_t i = 0; i < n; i++){
+                samples[i] = r->done[start + i].ph[ph];
+                sum += (double)samples[i];
+            }
+            qsort(samples, n, sizeof(*samples), cmp_u64);
+            printf(
+                "%-14.*s %8zu %-6s %12.1f %12.1f %12.1f\n",
+                ph == PH_TOTAL ? (int)type.len : 0, type.data,
+                n,
+                phase_names[ph],
+                sum / (double)n / 1000,
+                us(samples[n / 2]),
+                us(samples[MIN(n - 1, n * 99 / 100)])
+            );
+        }
+        start = end;
+    }
+
+    free(samples);
+
+    return e;
+}
+
+static derr_t read_trace(const dstr_t text, report_t *r){
+    derr_t e = E_OK;
+
+    citm_trace_hdr_t hdr;
+    if(text.len < sizeof(hdr)){
+        ORIG(&e, E_PARAM, "trace file is too short");
+    }
+    memcpy(&hdr, text.data, sizeof(hdr));
+    if(memcmp(hdr.magic, CITM_TRACE_MAGIC, sizeof(hdr.magic)) != 0){
+        ORIG(&e, E_PARAM, "not a citm trace file");
+    }
+    if(hdr.version != CITM_TRACE_VERSION){
+        ORIG(&e,
+            E_PARAM,
+            "unsupported trace version %x (or wrong byte order)",
+            FU(hdr.version)
+        );
+    }
+    if(hdr.recsize != sizeof(citm_trace_rec_t)){
+        ORIG(&e, E_PARAM, "unexpected record size %x", FU(hdr.recsize));
+    }
+    // the file only grows as far as the ring has been filled
+    size_t avail = (text.len - sizeof(hdr)) / sizeof(citm_trace_rec_t);
+    if(hdr.nrecs == 0 || MIN(hdr.next, hdr.nrecs) > avail){
+        ORIG(&e, E_PARAM, "trace file is truncated");
+    }
+
+    uint64_t first = citm_trace_first(&hdr);
+    const char *recs = text.data + sizeof(hdr);
+
+    // find the largest id, so conns can be indexed by id
+    uint32_t maxid = 0;
+    for(uint64_t i = first; i < hdr.next; i++){
+        citm_trace_rec_t rec;
+        size_t slot = citm_trace_slot(&hdr, i);
+        memcpy(&rec, recs + slot * sizeof(rec), sizeof(rec));
+        maxid = MAX(maxid, rec.conn);
+    }
+    r->nids = (size_t)maxid + 1;
+    r->conns = calloc(r->nids, sizeof(*r->conns));
+    if(!r->conns) ORIG(&e, E_NOMEM, "nomem");
+
+    for(uint64_t i = first; i < hdr.next; i++){
+        citm_trace_rec_t rec;
+        size_t slot = citm_trace_slot(&hdr, i);
+        memcpy(&rec, recs + slot * sizeof(rec), sizeof(rec));
+        rec.taglen = MIN(rec.taglen, CITM_TRACE_TAG_MAX);
+        PROP(&e, process(r, &rec) );
+    }
+
+    if(r->verbose) printf("\n");
+    fprintf(
+        stderr,
+        "read %lu records (%lu overwritten, %lu commands dropped)\n",
+        (unsigned long)(hdr.next - first),
+        (unsigned long)first,
+        (unsigned long)r->dropped
+    );
+
+    return e;
+}
+
+static void print_help(FILE *f){
+    fprintf(f,
+        "usage: citm_trace [-v] TRACE_FILE\n"
+        "\n"
+        "Summarize per-command latency from a trace written by citm --trace.\n"
+        "\n"
+        "  -v, --verbose    also print one line for every command\n"
+    );
+}
+
+int main(int argc, char **argv){
+    derr_t e = E_OK;
+
+    dstr_t text = {0};
+    report_t r = {0};
+
+    opt_spec_t o_help = {'h', "help", false};
+    opt_spec_t o_verbose = {'v', "verbose", false};
+    opt_spec_t* spec[] = {
+        &o_help,
+        &o_verbose,
+    };
+    size_t speclen = sizeof(spec) / sizeof(*spec);
+    int newargc;
+
+    logger_add_fileptr(LOG_LVL_WARN, stderr);
+
+    IF_PROP(&e, opt_parse(argc, argv, spec, speclen, &newargc) ){
+        print_help(stderr);
+        goto cu;
+    }
+    if(o_help.found){
+        print_help(stdout);
+        goto cu;
+    }
+    if(newargc != 2){
+        print_help(stderr);
+        ORIG_GO(&e, E_PARAM, "expected one TRACE_FILE", cu);
+    }
+    r.verbose = o_verbose.found;
+
+    PROP_GO(&e, dstr_read_file(argv[1], &text), cu);
+    PROP_GO(&e, read_trace(text, &r), cu);
+    PROP_GO(&e, summarize(&r), cu);
+
+cu:
+    free(r.conns);
+    free(r.done);
+    dstr_free(&text);
+    if(is_error(e)){
+        DUMP(e);
+        DROP_VAR(&e);
+        return 1;
+    }
+    return 0;
+}
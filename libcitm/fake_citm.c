@@ -157,8 +157,24 @@ static derr_t fio_connect_imap(
     return e;
 }
 
+static time_t fio_now(citm_io_i *iface){
+    fake_citm_io_t *fio = CONTAINER_OF(iface, fake_citm_io_t, iface);
+    return fio->now;
+}
+
+static void fio_deadline(citm_io_i *iface, time_t when){
+    fake_citm_io_t *fio = CONTAINER_OF(iface, fake_citm_io_t, iface);
+    fio->deadline = when;
+}
+
 citm_io_i *fake_citm_io(fake_citm_io_t *fio){
-    *fio = (fake_citm_io_t){ .iface = { .connect_imap = fio_connect_imap } };
+    *fio = (fake_citm_io_t){
+        .iface = {
+            .connect_imap = fio_connect_imap,
+            .now = fio_now,
+            .deadline = fio_deadline,
+        },
+    };
     return &fio->iface;
 }
 
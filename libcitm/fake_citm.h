@@ -45,6 +45,10 @@ derr_t fake_citm_connect_finish(
 typedef struct {
     citm_io_i iface;
     link_t fcncts;  // fake_citm_connect_t->link
+    // tests control the clock directly
+    time_t now;
+    // the last deadline requested
+    time_t deadline;
 } fake_citm_io_t;
 
 citm_io_i *fake_citm_io(fake_citm_io_t *fio);
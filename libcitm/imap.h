@@ -17,6 +17,8 @@ DECLARE_STRUCT(imap_server_read_t);
 DECLARE_STRUCT(imap_server_write_t);
 DECLARE_STRUCT(imap_client_read_t);
 DECLARE_STRUCT(imap_client_write_t);
+DECLARE_STRUCT(imap_server_literal_t);
+DECLARE_STRUCT(imap_client_literal_t);
 #undef DECLARE_STRUCT
 
 // eof is never returned, either the client has logged out or it is a failure
@@ -46,6 +48,14 @@ typedef void (*imap_client_await_cb)(
     imap_client_t *c, derr_t e, link_t *reads, link_t *writes
 );
 
+typedef void (*imap_server_literal_cb)(
+    imap_server_t *s, imap_server_literal_t *req, dstr_t buf
+);
+
+typedef void (*imap_client_literal_cb)(
+    imap_client_t *c, imap_client_literal_t *req
+);
+
 struct imap_server_read_t {
     imap_server_read_cb cb;
     link_t link;
@@ -72,6 +82,20 @@ struct imap_client_write_t {
 };
 DEF_CONTAINER_OF(imap_client_write_t, link, link_t)
 
+struct imap_server_literal_t {
+    imap_server_literal_cb cb;
+    dstr_t buf;
+    link_t link;
+};
+DEF_CONTAINER_OF(imap_server_literal_t, link, link_t)
+
+struct imap_client_literal_t {
+    imap_client_literal_cb cb;
+    dstr_t buf;
+    link_t link;
+};
+DEF_CONTAINER_OF(imap_client_literal_t, link, link_t)
+
 bool imap_server_read(
     imap_server_t *s, imap_server_read_t *req, imap_server_read_cb cb
 );
@@ -94,6 +118,53 @@ bool imap_client_write(
     imap_client_write_cb cb
 );
 
+/* Streamed APPEND literals.
+
+   After imap_server_stream_literals(), the server emits each APPEND with a
+   literal of at least IMAP_STREAM_MIN_LEN bytes as soon as its literal
+   begins, with append->content=NULL and append->len set.  Smaller APPENDs
+   arrive with their content as usual.  For a streamed APPEND, the consumer
+   must then read exactly append->len bytes with
+   imap_server_read_literal() before reading another command.  The server
+   buffers at most one read's worth of the literal at a time.
+
+   On the client side, an APPEND with content=NULL is written only through its
+   literal header.  Exactly append->len bytes must follow, provided through
+   imap_client_write_literal(); other commands are held until the literal is
+   complete.
+
+   Literal requests are not returned through the await_cb, so they must be
+   statically allocated like other requests. */
+
+#define IMAP_STREAM_MIN_LEN 4096
+void imap_server_stream_literals(imap_server_t *s);
+
+// buf is filled from zero, up to buf.size; the cb's buf has the new length
+bool imap_server_read_literal(
+    imap_server_t *s,
+    imap_server_literal_t *req,
+    dstr_t buf,
+    imap_server_literal_cb cb
+);
+
+// buf must remain valid until the cb is called
+bool imap_client_write_literal(
+    imap_client_t *c,
+    imap_client_literal_t *req,
+    const dstr_t buf,
+    imap_client_literal_cb cb
+);
+
+/* Streamed FETCH BODY[] literals.
+
+   After imap_client_stream_literals(), each BODY[] literal of at least
+   sink->min_len bytes is passed to the sink as it arrives, in slices of the
+   client's read buffer, and its FETCH response is emitted after the final
+   chunk with extra->content=NULL and extra->len set.  The sink is called
+   while the client parses, so it may run ahead of responses which were
+   parsed earlier but not yet read by the consumer. */
+void imap_client_stream_literals(imap_client_t *c, imap_literal_sink_i *sink);
+
 #define MUST(func, ...) do { \
     if(!func(__VA_ARGS__)) LOG_FATAL(#func " failed\n"); \
 } while(0)
@@ -106,6 +177,10 @@ bool imap_client_write(
     MUST(imap_client_read, (s), (req), (cb))
 #define imap_server_must_write(c, req, resp, cb) \
     MUST(imap_server_write, (c), (req), (resp), (cb))
+#define imap_server_must_read_literal(s, req, buf, cb) \
+    MUST(imap_server_read_literal, (s), (req), (buf), (cb))
+#define imap_client_must_write_literal(c, req, buf, cb) \
+    MUST(imap_client_write_literal, (c), (req), (buf), (cb))
 
 derr_t imap_server_new(
     imap_server_t **out, scheduler_i *scheduler, citm_conn_t *conn
@@ -153,6 +228,7 @@ void imap_client_dump(imap_client_t *c, FILE *f, int indent);
 
 struct imap_server_t {
     void *data;  // user data
+    uint32_t trace_id;
     imap_cmd_reader_t reader;
     scheduler_i *scheduler;
     schedulable_t schedulable;
@@ -177,6 +253,19 @@ struct imap_server_t {
     link_t reads;  // imap_server_read_t->link
     link_t writes;  // imap_server_write_t->link
 
+    // streamed literals
+    imap_literal_sink_i literal_sink;
+    char litbufmem[4096];
+    dstr_t litbuf;
+    /* how much of litbuf belongs to each literal, oldest first; one read can
+       hold the end of one literal and the start of the next, but no more,
+       since rbuf is no bigger than IMAP_STREAM_MIN_LEN */
+    size_t litsegs[2];
+    size_t nlitsegs;
+    // bytes of the newest literal which the parser has not yet given us
+    size_t lit_remaining;
+    link_t litreads;  // imap_server_literal_t->link
+
     imap_server_await_cb await_cb;
 
     derr_t e;
@@ -216,9 +305,11 @@ struct imap_server_t {
 DEF_STEAL_PTR(imap_server_t)
 DEF_CONTAINER_OF(imap_server_t, link, link_t)
 DEF_CONTAINER_OF(imap_server_t, schedulable, schedulable_t)
+DEF_CONTAINER_OF(imap_server_t, literal_sink, imap_literal_sink_i)
 
 struct imap_client_t {
     void *data;  // user data
+    uint32_t trace_id;
     imap_resp_reader_t reader;
     scheduler_i *scheduler;
     schedulable_t schedulable;
@@ -243,12 +334,22 @@ struct imap_client_t {
     link_t reads;  // imap_client_read_t->link
     link_t writes;  // imap_client_write_t->link
 
+    // streamed literals
+    link_t litwrites;  // imap_client_literal_t->link
+    // bytes of the literal which have not been marshaled yet
+    size_t lit_remaining;
+    // how much of the first litwrite has been marshaled
+    size_t lit_skip;
+
     imap_client_await_cb await_cb;
 
     derr_t e;
     size_t write_skip;
     size_t nwritten;
 
+    // between a streamed APPEND's literal header and its final line break
+    bool lit_active : 1;
+
     bool wbuf_needs_zero : 1;
 
     bool starttls : 1;
@@ -268,6 +369,9 @@ struct imap_client_t {
 
     bool canceled : 1;
     bool awaited : 1;
+
+    // set by the owner once CONDSTORE and QRESYNC are ENABLEd upstream
+    bool enabled : 1;
 };
 DEF_STEAL_PTR(imap_client_t)
 DEF_CONTAINER_OF(imap_client_t, link, link_t)
@@ -1,5 +1,7 @@
 #include "libcitm/libcitm.h"
 
+#include <string.h>
+
 static void advance_state(imap_client_t *c);
 
 static void schedule_cb(schedulable_t *schedulable){
@@ -17,6 +19,7 @@ static void read_cb(stream_i *stream, stream_read_t *req, dstr_t buf){
     (void)req;
     c->read_done = true;
     c->rbuf.len = buf.len;
+    CITM_TRACE(CITM_TRACE_UP_RECV, c->trace_id, NULL, buf.len);
     if(buf.len == 0){
         // we always expect the server to tell us to close, then we close
         TRACE_ORIG(&c->e, E_RESPONSE, "unexpected EOF from imap server");
@@ -28,6 +31,7 @@ static void write_cb(stream_i *stream, stream_write_t *req){
     imap_client_t *c = stream->data;
     (void)req;
     c->write_done = true;
+    CITM_TRACE(CITM_TRACE_UP_SENT, c->trace_id, NULL, c->wbuf.len);
     if(c->wbuf_needs_zero){
         // there was something sensitive in our wbuf
         dstr_zeroize(&c->wbuf);
@@ -87,6 +91,58 @@ static void do_write(imap_client_t *c){
     stream_must_write(c->stream, &c->write_req, &c->wbuf, 1, write_cb);
 }
 
+static bool is_streamed_append(const imap_cmd_t *cmd){
+    return cmd->type == IMAP_CMD_APPEND && !cmd->arg.append->content;
+}
+
+/* copy a streamed literal into wbuf, followed by the line break which ends
+   the APPEND command.  Sets *full if wbuf fills up, and leaves lit_active set
+   if we are waiting on the user for more of the literal. */
+static derr_t marshal_literal(imap_client_t *c, bool *full, bool *made_cb){
+    derr_t e = E_OK;
+    *full = false;
+
+    while(c->lit_remaining){
+        if(link_list_isempty(&c->litwrites)) return e;
+        imap_client_literal_t *req = CONTAINER_OF(
+            c->litwrites.next, imap_client_literal_t, link
+        );
+        dstr_t rest = dstr_sub2(req->buf, c->lit_skip, SIZE_MAX);
+        if(rest.len > c->lit_remaining){
+            ORIG(&e, E_PARAM, "literal write exceeds literal length");
+        }
+        size_t space = c->wbuf.size - c->wbuf.len;
+        if(!space){
+            *full = true;
+            return e;
+        }
+        size_t n = MIN(rest.len, space);
+        memcpy(c->wbuf.data + c->wbuf.len, rest.data, n);
+        c->wbuf.len += n;
+        c->lit_skip += n;
+        c->lit_remaining -= n;
+        if(c->lit_skip < req->buf.len) continue;
+        // finished marshaling a literal write
+        c->lit_skip = 0;
+        link_remove(&req->link);
+        req->cb(c, req);
+        *made_cb = true;
+        // did the user cancel us?
+        if(c->canceled) return e;
+    }
+
+    // the literal is complete, end the command
+    DSTR_STATIC(crlf, "\r\n");
+    if(c->wbuf.size - c->wbuf.len < crlf.len){
+        *full = true;
+        return e;
+    }
+    PROP(&e, dstr_append(&c->wbuf, &crlf) );
+    c->lit_active = false;
+
+    return e;
+}
+
 // try to marshal all commands to the wire
 static derr_t advance_writes(imap_client_t *c, bool *ok){
     derr_t e = E_OK;
@@ -103,7 +159,11 @@ static derr_t advance_writes(imap_client_t *c, bool *ok){
     }
 
     // is there nothing to write?
-    if(!c->write_started && link_list_isempty(&c->cmds)){
+    if(
+        !c->write_started
+        && !c->lit_active
+        && link_list_isempty(&c->cmds)
+    ){
         *ok = true;
         return e;
     }
@@ -111,8 +171,24 @@ static derr_t advance_writes(imap_client_t *c, bool *ok){
     bool want_delay = false;
 
     // cram as many commands as we can fit into this wbuf
-    link_t *link = c->cmds.next;
-    while(link != &c->cmds){
+    while(true){
+        if(c->lit_active){
+            // commands wait behind a streamed literal
+            c->write_started = true;
+            bool full;
+            PROP(&e, marshal_literal(c, &full, &want_delay) );
+            if(c->canceled) return e;
+            if(full){
+                // buffer is full, send the write
+                do_write(c);
+                c->write_sent = true;
+                return e;
+            }
+            // waiting for more of the literal?
+            if(c->lit_active) break;
+        }
+        link_t *link = c->cmds.next;
+        if(link == &c->cmds) break;
         c->write_started = true;
         size_t want = 0;
         imap_cmd_t *cmd = CONTAINER_OF(link, imap_cmd_t, link);
@@ -127,8 +203,11 @@ static derr_t advance_writes(imap_client_t *c, bool *ok){
         }
         // finished marshaling a cmd
         c->write_skip = 0;
-        link = link->next;
         link_remove(&cmd->link);
+        if(is_streamed_append(cmd)){
+            c->lit_active = true;
+            c->lit_remaining = cmd->arg.append->len;
+        }
         imap_cmd_free(cmd);
         if(!c->relay_started) continue;
         // respond to write_cb
@@ -147,6 +226,9 @@ static derr_t advance_writes(imap_client_t *c, bool *ok){
         // delay one scheduling round
         link_remove(&c->schedulable.link);
         schedule(c);
+    }else if(!c->wbuf.len){
+        // waiting on a streamed literal, with nothing to send yet
+        c->write_started = false;
     }else{
         // if we didn't make any write_cb's, there's no reason to wait
         do_write(c);
@@ -398,6 +480,7 @@ derr_t imap_client_new(
     CHECK(&e);
 
     *c = (imap_client_t){
+        .trace_id = citm_trace_id(),
         .scheduler = scheduler,
         .conn = conn,
         .tls = { .iface.data = c },
@@ -539,3 +622,22 @@ bool imap_client_write(
     schedule(c);
     return true;
 }
+
+void imap_client_stream_literals(imap_client_t *c, imap_literal_sink_i *sink){
+    c->reader.args.literal_sink = sink;
+}
+
+bool imap_client_write_literal(
+    imap_client_t *c,
+    imap_client_literal_t *req,
+    const dstr_t buf,
+    imap_client_literal_cb cb
+){
+    DETECT_INVALID(c->awaited, "imap_client_write_literal");
+    DETECT_INVALID(c->canceled, "imap_client_write_literal");
+
+    *req = (imap_client_literal_t){ .buf = buf, .cb = cb };
+    link_list_append(&c->litwrites, &req->link);
+    schedule(c);
+    return true;
+}
@@ -1,5 +1,7 @@
 #include "libcitm/libcitm.h"
 
+#include <string.h>
+
 static void advance_state(imap_server_t *s);
 
 static void schedule_cb(schedulable_t *schedulable){
@@ -17,6 +19,7 @@ static void read_cb(stream_i *stream, stream_read_t *req, dstr_t buf){
     (void)req;
     s->read_done = true;
     s->rbuf.len = buf.len;
+    CITM_TRACE(CITM_TRACE_DN_RECV, s->trace_id, NULL, buf.len);
     if(buf.len == 0 && !s->logged_out && !is_error(s->e)){
         TRACE_ORIG(&s->e, E_CONN, "unexpected EOF from imap client");
     }
@@ -27,6 +30,7 @@ static void write_cb(stream_i *stream, stream_write_t *req){
     imap_server_t *s = stream->data;
     (void)req;
     s->write_done = true;
+    CITM_TRACE(CITM_TRACE_DN_SENT, s->trace_id, NULL, s->wbuf.len);
     schedule(s);
 }
 
@@ -67,6 +71,10 @@ static void await_cb(
     schedule(s);
 }
 
+static bool literal_active(imap_server_t *s){
+    return s->nlitsegs > 0;
+}
+
 // try to read at least one command from the wire
 // in the starttls case, leave remaining text in read_buf
 static derr_t advance_reads(imap_server_t *s, bool starttls, bool *ok){
@@ -74,6 +82,8 @@ static derr_t advance_reads(imap_server_t *s, bool starttls, bool *ok){
     *ok = false;
 
     while(link_list_isempty(&s->cmds)){
+        // the rest of a streamed literal must be consumed first
+        if(literal_active(s)) return e;
         // read bytes off the wire
         ONCE(s->read_started){
             stream_must_read(s->stream, &s->read_req, s->rbuf, read_cb);
@@ -102,6 +112,82 @@ static derr_t advance_reads(imap_server_t *s, bool starttls, bool *ok){
     return e;
 }
 
+// the parser calls into our literal_sink while we are in imap_cmd_read()
+
+static derr_t sink_start(imap_literal_sink_i *sink, size_t len){
+    derr_t e = E_OK;
+    imap_server_t *s = CONTAINER_OF(sink, imap_server_t, literal_sink);
+    /* a pipelined APPEND may start while litbuf still holds the end of the
+       previous literal, so each literal gets its own segment of litbuf */
+    if(s->lit_remaining){
+        ORIG(&e, E_INTERNAL, "literal started before previous literal ended");
+    }
+    if(s->nlitsegs == sizeof(s->litsegs) / sizeof(*s->litsegs)){
+        ORIG(&e, E_INTERNAL, "too many literals buffered");
+    }
+    s->litsegs[s->nlitsegs++] = 0;
+    s->lit_remaining = len;
+    return e;
+}
+
+static derr_t sink_chunk(imap_literal_sink_i *sink, const dstr_t chunk){
+    derr_t e = E_OK;
+    imap_server_t *s = CONTAINER_OF(sink, imap_server_t, literal_sink);
+    /* we only read from the wire when litbuf is empty, and litbuf is as big
+       as rbuf, so this is always safe */
+    PROP(&e, dstr_append(&s->litbuf, &chunk) );
+    s->litsegs[s->nlitsegs - 1] += chunk.len;
+    s->lit_remaining -= chunk.len;
+    return e;
+}
+
+// forget the oldest literal once the consumer has read all of it
+static void pop_finished_litseg(imap_server_t *s){
+    if(!s->nlitsegs || s->litsegs[0]) return;
+    // the newest literal may still have bytes on the wire
+    if(s->nlitsegs == 1 && s->lit_remaining) return;
+    s->nlitsegs--;
+    memmove(s->litsegs, s->litsegs + 1, s->nlitsegs * sizeof(*s->litsegs));
+}
+
+// fill literal read requests, reading from the wire as needed
+static derr_t advance_literal_reads(imap_server_t *s){
+    derr_t e = E_OK;
+
+    while(!link_list_isempty(&s->litreads)){
+        if(!s->nlitsegs){
+            ORIG(&e, E_INTERNAL, "literal read without a literal");
+        }
+        if(!s->litsegs[0]){
+            ONCE(s->read_started){
+                stream_must_read(s->stream, &s->read_req, s->rbuf, read_cb);
+            }
+            if(!s->read_done) return e;
+            s->read_started = false;
+            s->read_done = false;
+            LOG_DEBUG("%x recv dn: %x", FP(s), FD(s->rbuf));
+            // the literal goes to litbuf, anything after it goes to cmds
+            PROP(&e, imap_cmd_read(&s->reader, s->rbuf, &s->cmds) );
+            continue;
+        }
+        imap_server_literal_t *req = CONTAINER_OF(
+            link_list_pop_first(&s->litreads), imap_server_literal_t, link
+        );
+        // never hand out bytes from the next literal
+        dstr_t buf = req->buf;
+        buf.len = MIN(s->litsegs[0], buf.size);
+        memcpy(buf.data, s->litbuf.data, buf.len);
+        dstr_leftshift(&s->litbuf, buf.len);
+        s->litsegs[0] -= buf.len;
+        pop_finished_litseg(s);
+        req->cb(s, req, buf);
+        // did the user cancel us?
+        if(s->canceled || s->broken_conn) return e;
+    }
+
+    return e;
+}
+
 static void do_write(imap_server_t *s){
     LOG_DEBUG("%x send dn: %x", FP(s), FD(s->wbuf));
     stream_must_write(s->stream, &s->write_req, &s->wbuf, 1, write_cb);
@@ -462,6 +548,11 @@ static void advance_state(imap_server_t *s){
         }
     }
 
+    // process literal read requests
+    PROP_GO(&s->e, advance_literal_reads(s), cu);
+    if(s->canceled) goto cu;
+    if(s->broken_conn) return;
+
     // process read requests
     while(!link_list_isempty(&s->reads)){
         PROP_GO(&s->e, advance_reads(s, false, &ok), cu);
@@ -548,8 +639,14 @@ derr_t imap_server_new(
     CHECK(&e);
 
     *s = (imap_server_t){
+        .trace_id = citm_trace_id(),
         .scheduler = scheduler,
         .conn = conn,
+        .literal_sink = {
+            .min_len = IMAP_STREAM_MIN_LEN,
+            .start = sink_start,
+            .chunk = sink_chunk,
+        },
         .tls = { .iface.data = s },
         .starttls = conn->security == IMAP_SEC_STARTTLS,
         .exts = { .idle = EXT_STATE_ON },
@@ -559,6 +656,7 @@ derr_t imap_server_new(
 
     DSTR_WRAP_ARRAY(s->rbuf, s->rbufmem);
     DSTR_WRAP_ARRAY(s->wbuf, s->wbufmem);
+    DSTR_WRAP_ARRAY(s->litbuf, s->litbufmem);
 
     schedulable_prep(&s->schedulable, schedule_cb);
 
@@ -671,6 +769,27 @@ bool imap_server_read(
     return true;
 }
 
+void imap_server_stream_literals(imap_server_t *s){
+    s->reader.args.literal_sink = &s->literal_sink;
+}
+
+bool imap_server_read_literal(
+    imap_server_t *s,
+    imap_server_literal_t *req,
+    dstr_t buf,
+    imap_server_literal_cb cb
+){
+    DETECT_INVALID(s->awaited, "imap_server_read_literal");
+    DETECT_INVALID(s->canceled, "imap_server_read_literal");
+    DETECT_INVALID(s->broken_conn, "imap_server_read_literal");
+    DETECT_INVALID(s->logged_out, "imap_server_read_literal");
+
+    *req = (imap_server_literal_t){ .buf = buf, .cb = cb };
+    link_list_append(&s->litreads, &req->link);
+    schedule(s);
+    return true;
+}
+
 bool imap_server_write(
     imap_server_t *s,
     imap_server_write_t *req,
@@ -308,6 +308,30 @@ derr_t keydir_keysync_completed(keydir_i *iface){
 
 // begin imaildir_hooks_i functions
 
+// alert on recipients we haven't seen before, and remember all of them
+static derr_t check_recips(
+    keydir_t *kd, const dstr_t *mailbox, const LIST(dstr_t) *recips
+){
+    derr_t e = E_OK;
+
+    // detect unrecognized fingerprints first
+    for(size_t i = 0; i < recips->len; i++){
+        const dstr_t recip = recips->data[i];
+        bool alert = fpr_watcher_should_alert_on_decrypt(
+            &kd->fpr_watcher, recip, *mailbox
+        );
+        if(alert){
+            LOG_INFO(
+                "new device detected during decryption (%x)\n", FX(recip)
+            );
+            PROP(&e, inject_new_key_msg(kd, recip) );
+        }
+        PROP(&e, fpr_watcher_add_fpr(&kd->fpr_watcher, recip) );
+    }
+
+    return e;
+}
+
 static derr_t decrypt_msg(
     keydir_t *kd,
     const dstr_t *mailbox,
@@ -340,20 +364,7 @@ static derr_t decrypt_msg(
     PROP_GO(&e, decrypter_update(&dc, &copy, &plain), cu);
     PROP_GO(&e, decrypter_finish(&dc, &plain), cu);
 
-    // detect unrecognized fingerprints first
-    for(size_t i = 0; i < recips.len; i++){
-        const dstr_t recip = recips.data[i];
-        bool alert = fpr_watcher_should_alert_on_decrypt(
-            &kd->fpr_watcher, recip, *mailbox
-        );
-        if(alert){
-            LOG_INFO(
-                "new device detected during decryption (%x)\n", FX(recip)
-            );
-            PROP_GO(&e, inject_new_key_msg(kd, recip), cu);
-        }
-        PROP_GO(&e, fpr_watcher_add_fpr(&kd->fpr_watcher, recip), cu);
-    }
+    PROP_GO(&e, check_recips(kd, mailbox, &recips), cu);
 
     if(len) *len = plain.len;
 
@@ -370,6 +381,72 @@ cu:
     return e;
 }
 
+/* like decrypt_msg, but the ciphertext is read from fd a chunk at a time, and
+   cipher already holds the first chunk */
+static derr_t decrypt_file(
+    keydir_t *kd,
+    const dstr_t *mailbox,
+    int fd,
+    dstr_t *cipher,
+    const string_builder_t *path,
+    size_t *len
+){
+    dstr_t plain = {0};
+    decrypter_t dc = {0};
+    LIST(dstr_t) recips = {0};
+    dstr_t block = {0};
+    int out = -1;
+
+    derr_t e = E_OK;
+
+    *len = 0;
+
+    PROP_GO(&e, dstr_new(&plain, cipher->size + 1024), cu);
+
+    PROP_GO(&e, LIST_NEW(dstr_t, &recips, 32), cu);
+    PROP_GO(&e, dstr_new(&block, 1024), cu);
+
+    PROP_GO(&e, dopen_path(path, O_WRONLY | O_CREAT | O_TRUNC, 0666, &out), cu);
+
+    // create the decrypter
+    PROP_GO(&e, decrypter_new(&dc), cu);
+    PROP_GO(&e, decrypter_start(&dc, kd->mykey, &recips, &block), cu);
+
+    // decrypt the message, writing out each chunk of plaintext
+    while(true){
+        PROP_GO(&e, decrypter_update(&dc, cipher, &plain), cu);
+        PROP_GO(&e, dstr_write(out, &plain), cu);
+        *len += plain.len;
+        plain.len = 0;
+        // only a broken message leaves a whole chunk unconsumed
+        if(cipher->len == cipher->size){
+            ORIG_GO(&e, E_PARAM, "bad decryption, line too long", cu);
+        }
+        size_t amnt_read;
+        PROP_GO(&e, dstr_read(fd, cipher, 0, &amnt_read), cu);
+        if(!amnt_read) break;
+    }
+    PROP_GO(&e, decrypter_finish(&dc, &plain), cu);
+    PROP_GO(&e, dstr_write(out, &plain), cu);
+    *len += plain.len;
+
+    PROP_GO(&e, check_recips(kd, mailbox, &recips), cu);
+
+cu:
+    if(out > -1){
+        derr_t e2 = dclose(out);
+        MERGE_VAR(&e, &e2, "dclose");
+        // don't leave a partial plaintext behind
+        if(is_error(e)) DROP_CMD( remove_path(path) );
+    }
+    decrypter_free(&dc);
+    dstr_free(&block);
+    LIST_FREE(dstr_t, &recips);
+    dstr_free(&plain);
+
+    return e;
+}
+
 // mangle subject line of unencrypted messages to show there was a problem
 static derr_t mangle_unencrypted(
     const dstr_t *msg,
@@ -546,6 +623,56 @@ static derr_t imaildir_hooks_process_msg(
     return e;
 }
 
+// like imaildir_hooks_process_msg, but only decryption avoids loading *in
+static derr_t imaildir_hooks_process_file(
+    imaildir_hooks_i *hooks,
+    const dstr_t *mailbox,
+    const string_builder_t *in,
+    const string_builder_t *path,
+    size_t *len,
+    bool *not4me
+){
+    derr_t e = E_OK;
+    keydir_t *kd = CONTAINER_OF(hooks, keydir_t, imaildir_hooks);
+    dstr_t content = {0};
+    int fd = -1;
+    *len = 0;
+    *not4me = false;
+
+    PROP(&e, dopen_path(in, O_RDONLY, 0, &fd) );
+
+    // read enough to detect if the message is even encrypted
+    DSTR_VAR(cipher, 4096);
+    size_t amnt_read;
+    PROP_GO(&e, dstr_read(fd, &cipher, 0, &amnt_read), cu);
+
+    DSTR_STATIC(enc_header, "-----BEGIN SPLINTERMAIL MESSAGE-----");
+    bool encrypted = dstr_beginswith(&cipher, &enc_header);
+    if(encrypted){
+        // do the decryption
+        derr_t e2 = decrypt_file(kd, mailbox, fd, &cipher, path, len);
+        CATCH(&e2, E_NOT4ME){
+            LOG_INFO("detected NOT4ME message\n");
+            DROP_VAR(&e2);
+            *not4me = true;
+        }else CATCH_EX(&e2, is_decrypt_err){
+            // decryption errors, pass the broken message to the user
+            DROP_VAR(&e2);
+            PROP_GO(&e, dstr_read_path(in, &content), cu);
+            PROP_GO(&e, mangle_corrupted(&content, path, len), cu);
+        }else PROP_VAR_GO(&e, &e2, cu);
+    }else{
+        // message is not even encrypted
+        PROP_GO(&e, dstr_read_path(in, &content), cu);
+        PROP_GO(&e, mangle_unencrypted(&content, path, len), cu);
+    }
+
+cu:
+    compat_close(fd);
+    dstr_free(&content);
+    return e;
+}
+
 // end imaildir_hooks_i functions
 
 static derr_t _load_or_gen_mykey(
@@ -648,6 +775,7 @@ derr_t keydir_new(
         },
         .imaildir_hooks = {
             .process_msg = imaildir_hooks_process_msg,
+            .process_file = imaildir_hooks_process_file,
         },
     };
     kd->path = sb_append(root, SBD(kd->user));
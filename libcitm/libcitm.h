@@ -9,9 +9,11 @@
 #include "api_client.h"
 
 #include "libcitm/citm.h"
+#include "libcitm/trace.h"
 #include "libcitm/imap.h"
 #include "libcitm/io_pair.h"
 #include "libcitm/anon.h"
+#include "libcitm/upool.h"
 #include "libcitm/responses.h"
 #include "libcitm/date.h"
 #include "libcitm/keydir.h"
@@ -26,12 +26,21 @@ static void print_help(FILE *f){
         "      --rest ARG      (default: %x)\n"
         "      --ca ARG        (deault: none)\n"
         "  -p, --pebble        trust pebble's certificate, and change\n"
-        "                      default --acme to localhost:14000\n",
+        "                      default --acme to localhost:14000\n"
+        "      --pool-size N   logged-in upstream connections to keep\n"
+        "                      ready per user (default: %x)\n"
+        "      --pool-idle S   seconds before an unused pool closes\n"
+        "                      (default: %x)\n"
+        "      --trace FILE    write a binary trace of relay events, for\n"
+        "                      the citm_trace tool (needs BUILD_CITM_TRACE)\n"
+        "      --trace-size N  records in the trace ring (default: 1M)\n",
         FD(d_listen),
         FD(d_remote),
         FD(d_sm_dir),
         FD(d_socket),
-        FD(d_rest)
+        FD(d_rest),
+        FU(CITM_POOL_SIZE),
+        FU(CITM_POOL_IDLE_TIMEOUT)
     );
 }
 
@@ -95,6 +104,10 @@ int main(int argc, char **argv){
     opt_spec_t o_rest     = {'\0',"rest",    true};
     opt_spec_t o_ca       = {'\0',"ca",      true};
     opt_spec_t o_pebble   = {'p', "pebble",  false};
+    opt_spec_t o_pool     = {'\0',"pool-size", true};
+    opt_spec_t o_idle     = {'\0',"pool-idle", true};
+    opt_spec_t o_trace    = {'\0',"trace",   true};
+    opt_spec_t o_tsize    = {'\0',"trace-size", true};
 
     opt_spec_t* spec[] = {
         &o_help,
@@ -108,6 +121,10 @@ int main(int argc, char **argv){
         &o_rest,
         &o_ca,
         &o_pebble,
+        &o_pool,
+        &o_idle,
+        &o_trace,
+        &o_tsize,
     };
     size_t speclen = sizeof(spec) / sizeof(*spec);
     int newargc;
@@ -160,6 +177,24 @@ int main(int argc, char **argv){
 
     string_builder_t sockpath  = SBD(o_sock.found ? o_sock.val : d_socket);
 
+    citm_pool_cfg_t pool_cfg = CITM_POOL_CFG_DEFAULT;
+    if(o_pool.found){
+        PROP_GO(&e, dstr_tosize(&o_pool.val, &pool_cfg.size, 10), cu);
+    }
+    if(o_idle.found){
+        unsigned int idle;
+        PROP_GO(&e, dstr_tou(&o_idle.val, &idle, 10), cu);
+        pool_cfg.idle_timeout = (time_t)idle;
+    }
+
+    if(o_trace.found){
+        size_t nrecs = 0;
+        if(o_tsize.found){
+            PROP_GO(&e, dstr_tosize(&o_tsize.val, &nrecs, 10), cu);
+        }
+        PROP_GO(&e, citm_trace_start(o_trace.val.data, nrecs), cu);
+    }
+
     PROP_GO(&e,
          uv_citm(
             listeners.specs,
@@ -175,6 +210,7 @@ int main(int argc, char **argv){
             NULL, // sockfd; we don't support --system here
             ssl_ctx.ctx,
             sm_dir,
+            pool_cfg,
             indicate_ready,
             NULL, // user_async_hook
             NULL
@@ -182,6 +218,7 @@ int main(int argc, char **argv){
     cu);
 
 cu:
+    citm_trace_stop();
     ssl_context_free(&ssl_ctx);
     ssl_library_close();
 
@@ -4,6 +4,7 @@
 DEF_CONTAINER_OF(sc_t, schedulable, schedulable_t)
 DEF_CONTAINER_OF(sc_t, dn_cb, dn_cb_i)
 DEF_CONTAINER_OF(sc_t, up_cb, up_cb_i)
+DEF_CONTAINER_OF(sc_t, fetch_sink, imap_literal_sink_i)
 
 DSTR_STATIC(prefix, "sc");
 
@@ -19,6 +20,14 @@ static void schedule(sc_t *sc){
     sc->scheduler->schedule(sc->scheduler, &sc->schedulable);
 }
 
+/* an IDLE client is waiting on us for updates, so while IDLE we run ahead of
+   other connections' bulk work */
+static void set_prio(sc_t *sc, sched_prio_e prio){
+    schedulable_set_prio(&sc->schedulable, prio);
+    schedulable_set_prio(&sc->s->schedulable, prio);
+    schedulable_set_prio(&sc->c->schedulable, prio);
+}
+
 static void sawait_cb(
     imap_server_t *s, derr_t e, link_t *reads, link_t *writes
 ){
@@ -77,6 +86,23 @@ static void send_cmd(derr_t *e, sc_t *sc, imap_cmd_t *cmd){
     if(!is_error(*e)) link_list_append(&sc->cmds, &cmd->link);
 }
 
+// the tag of a tagged status-type response, or NULL
+static const ie_dstr_t *resp_tag(const imap_resp_t *resp){
+    if(resp->type != IMAP_RESP_STATUS_TYPE) return NULL;
+    return resp->arg.status_type->tag;
+}
+
+static derr_t gather_updates(sc_t *sc, link_t *out){
+    derr_t e = E_OK;
+
+    CITM_TRACE(CITM_TRACE_DIR_START, sc->s->trace_id, NULL, CITM_TRACE_DIR_DN);
+    // true = always allow expunges, false = there is no uid mode
+    PROP(&e, dn_gather_updates(&sc->dn, true, false, NULL, out) );
+    CITM_TRACE(CITM_TRACE_DIR_DONE, sc->s->trace_id, NULL, CITM_TRACE_DIR_DN);
+
+    return e;
+}
+
 // filter out unsupported extensions
 static void st_code_filter_unsupported(ie_st_code_t **codep){
     const ie_st_code_t *code = *codep;
@@ -128,7 +154,7 @@ static derr_t send_passthru_st_resp(
            SEARCH forbid sending EXPUNGEs */
         /* uid_mode is always false because none of the passthru commands have
            UID variants */
-        PROP(&e, dn_gather_updates(&sc->dn, true, false, NULL, &sc->resps) );
+        PROP(&e, gather_updates(sc, &sc->resps) );
     }
 
     imap_resp_t *resp = STEAL(imap_resp_t, respp);
@@ -188,6 +214,7 @@ static void sread_cb(
     (void)req;
     sc->reading_dn = false;
     sc->cmd = cmd;
+    CITM_TRACE(CITM_TRACE_DN_CMD, s->trace_id, cmd->tag, cmd->type);
     schedule(sc);
 }
 
@@ -217,6 +244,8 @@ static bool advance_writes_dn(sc_t *sc){
     if(!link) return true;
 
     imap_resp_t *resp = CONTAINER_OF(link, imap_resp_t, link);
+    const ie_dstr_t *tag = resp_tag(resp);
+    if(tag) CITM_TRACE(CITM_TRACE_DN_RESP, sc->s->trace_id, tag, 0);
     imap_server_must_write(sc->s, &sc->swrite, resp, swrite_cb);
     sc->writing_dn = true;
     return false;
@@ -229,6 +258,8 @@ static void cread_cb(
     (void)req;
     sc->reading_up = false;
     sc->resp = resp;
+    const ie_dstr_t *tag = resp_tag(resp);
+    if(tag) CITM_TRACE(CITM_TRACE_UP_RESP, sc->s->trace_id, tag, 0);
     schedule(sc);
 }
 
@@ -253,11 +284,19 @@ static bool advance_writes_up(sc_t *sc){
     // do we have a write in flight?
     if(sc->writing_up) return false;
 
+    /* commands from the up_t can't be written until the upstream APPEND
+       literal is complete, but we must not wait on them */
+    if(sc->append_lit_up) return true;
+
     // is there nothing more to write?
     link_t *link = link_list_pop_first(&sc->cmds);
     if(!link) return true;
 
     imap_cmd_t *cmd = CONTAINER_OF(link, imap_cmd_t, link);
+    if(cmd->type == IMAP_CMD_APPEND && !cmd->arg.append->content){
+        sc->append_lit_up = true;
+    }
+    CITM_TRACE(CITM_TRACE_UP_CMD, sc->s->trace_id, cmd->tag, cmd->type);
     imap_client_must_write(sc->c, &sc->cwrite, cmd, cwrite_cb);
     sc->writing_up = true;
     return false;
@@ -374,6 +413,111 @@ static derr_t advance_select(
     return e;
 }
 
+static void sliteral_cb(
+    imap_server_t *s, imap_server_literal_t *req, dstr_t buf
+){
+    sc_t *sc = s->data;
+    (void)req;
+    sc->reading_lit_dn = false;
+    sc->append_pbuf.len = buf.len;
+    schedule(sc);
+}
+
+static void cliteral_cb(imap_client_t *c, imap_client_literal_t *req){
+    sc_t *sc = c->data;
+    (void)req;
+    sc->writing_lit_up = false;
+    sc->append_cbuf.len = 0;
+    schedule(sc);
+}
+
+/* pump the APPEND literal from the client to the upstream server, holding at
+   most one chunk of plaintext and one chunk of ciphertext in memory */
+static derr_t advance_append_literal(sc_t *sc, bool *ok){
+    derr_t e = E_OK;
+
+    *ok = false;
+
+    while(true){
+        // send any ciphertext we have
+        if(!sc->writing_lit_up && sc->append_cbuf.len){
+            sc->append_lit_sent += sc->append_cbuf.len;
+            if(sc->append_lit_sent > sc->append_lit_len){
+                ORIG(&e, E_INTERNAL, "APPEND literal overran its length");
+            }
+            imap_client_must_write_literal(
+                sc->c, &sc->cliteral, sc->append_cbuf, cliteral_cb
+            );
+            sc->writing_lit_up = true;
+        }
+
+        // read ahead while the ciphertext is in flight
+        if(
+            !sc->reading_lit_dn
+            && !sc->append_pbuf.len
+            && sc->append_nread < sc->append_len
+        ){
+            if(sc->append_content){
+                dstr_t rest = dstr_sub2(
+                    sc->append_content->dstr, sc->append_nread, SIZE_MAX
+                );
+                dstr_t sub = dstr_sub2(rest, 0, sc->append_pbuf.size);
+                PROP(&e, dstr_append(&sc->append_pbuf, &sub) );
+            }else{
+                dstr_t buf = sc->append_pbuf;
+                buf.size = MIN(buf.size, sc->append_len - sc->append_nread);
+                imap_server_must_read_literal(
+                    sc->s, &sc->sliteral, buf, sliteral_cb
+                );
+                sc->reading_lit_dn = true;
+            }
+        }
+
+        // encrypting requires the ciphertext buffer
+        if(sc->writing_lit_up) return e;
+
+        if(sc->append_encrypted) break;
+
+        if(sc->append_pbuf.len){
+            // tee the plaintext into the temp file and the encrypter
+            PROP(&e, dstr_write(sc->append_fd, &sc->append_pbuf) );
+            PROP(&e,
+                encrypter_update(
+                    &sc->append_ec, &sc->append_pbuf, &sc->append_cbuf
+                )
+            );
+            sc->append_nread += sc->append_pbuf.len;
+            sc->append_pbuf.len = 0;
+            continue;
+        }
+
+        if(sc->append_nread < sc->append_len){
+            // wait for more plaintext
+            return e;
+        }
+
+        // all plaintext is in
+        PROP(&e, encrypter_finish(&sc->append_ec, &sc->append_cbuf) );
+        encrypter_free(&sc->append_ec);
+        if(sc->append_lit_sent + sc->append_cbuf.len != sc->append_lit_len){
+            ORIG(&e, E_INTERNAL, "APPEND literal did not match its length");
+        }
+        PROP(&e, dfsync(sc->append_fd) );
+        sc->append_fd_open = false;
+        PROP(&e, dclose(sc->append_fd) );
+        sc->append_encrypted = true;
+    }
+
+    // the whole literal has been written upwards
+    dstr_free(&sc->append_cbuf);
+    ie_dstr_free(STEAL(ie_dstr_t, &sc->append_content));
+    sc->append_encrypted = false;
+    sc->append_lit_up = false;
+    *ok = true;
+
+    return e;
+}
+
 typedef derr_t (*passthru_pre_f)(
     sc_t *sc, ie_dstr_t **cmdtagp, imap_cmd_arg_t *argp, bool *valid
 );
@@ -435,6 +579,12 @@ static derr_t advance_passthru(
         sc->passthru_sent = true;
     }
 
+    if(type == IMAP_CMD_APPEND && !sc->passthru_lit_done){
+        PROP(&e, advance_append_literal(sc, &ok) );
+        if(!ok) return e;
+        sc->passthru_lit_done = true;
+    }
+
     ok = advance_reads_up(sc);
     if(!ok) return e;
 
@@ -443,6 +593,7 @@ static derr_t advance_passthru(
 
     sc->passthru_pre = false;
     sc->passthru_sent = false;
+    sc->passthru_lit_done = false;
     *okout = true;
 
     return e;
@@ -651,7 +802,7 @@ static derr_t check_rename(
 }
 
 
-// we will modify the content of the append command directly
+// the APPEND arrives without its content; its literal is streamed afterwards
 static derr_t pre_append(
     sc_t *sc, ie_dstr_t **cmdtagp, imap_cmd_arg_t *argp, bool *valid
 ){
@@ -661,15 +812,27 @@ static derr_t pre_append(
     *valid = true;
 
     ie_append_cmd_t *append = argp->append;
+    if(append->content){
+        /* this APPEND was parsed before we enabled streaming, so we pump its
+           literal out of the already-buffered content instead */
+        sc->append_content = STEAL(ie_dstr_t, &append->content);
+        append->len = sc->append_content->dstr.len;
+    }
 
-    // step 1: write the unencrypted text to a file for saving
+    // step 1: open a file for saving the unencrypted text as it arrives
     sc->append_tmp_id = dirmgr_new_tmp_id(sc->dirmgr);
     string_builder_t tmp_path = sb_append(&sc->dirmgr->path, SBS("tmp"));
     string_builder_t path = sb_append(&tmp_path, SBU(sc->append_tmp_id));
-    PROP(&e, dstr_write_path(&path, &append->content->dstr) );
+    PROP(&e,
+        dopen_path(
+            &path, O_WRONLY | O_CREAT | O_TRUNC, 0666, &sc->append_fd
+        )
+    );
+    sc->append_fd_open = true;
 
     // step 2: copy some details from the APPEND command
-    sc->append_len = append->content->dstr.len;
+    sc->append_len = append->len;
+    sc->append_nread = 0;
     sc->append_flags = msg_flags_from_flags(append->flags);
     if(append->time.year){
         // an explicit intdate was passed in
@@ -688,27 +851,21 @@ static derr_t pre_append(
         )
     );
 
-    // step 4: encrypt the text to all the keys we know of
-    ie_dstr_t *content = ie_dstr_new_empty(&e);
-    CHECK(&e);
-
-    encrypter_t ec;
-    PROP_GO(&e, encrypter_new(&ec), cu_content);
+    // step 4: start encrypting to all the keys we know of
+    PROP(&e, dstr_new(&sc->append_cbuf, 8192) );
+    DSTR_WRAP_ARRAY(sc->append_pbuf, sc->append_pbufmem);
+    PROP(&e, encrypter_new(&sc->append_ec) );
     link_t *all_keys = sc->kd->all_keys(sc->kd);
-    PROP_GO(&e, encrypter_start(&ec, all_keys, &content->dstr), cu_ec);
-    PROP_GO(&e,
-        encrypter_update(&ec, &append->content->dstr, &content->dstr),
-    cu_ec);
-    PROP_GO(&e, encrypter_finish(&ec, &content->dstr), cu_ec);
-
-    // step 5: modify the APPEND and relay it upwards
-    ie_dstr_free(append->content);
-    append->content = STEAL(ie_dstr_t, &content);
+    PROP(&e, encrypter_start(&sc->append_ec, all_keys, &sc->append_cbuf) );
 
-cu_ec:
-    encrypter_free(&ec);
-cu_content:
-    ie_dstr_free(content);
+    /* step 5: modify the APPEND and relay it upwards.  The upstream literal
+       must declare its length before we have seen any of the plaintext, but
+       the encrypter's output length depends only on the plaintext length */
+    size_t rest;
+    PROP(&e, encrypter_predict_len(&sc->append_ec, sc->append_len, &rest) );
+    sc->append_lit_len = sc->append_cbuf.len + rest;
+    sc->append_lit_sent = 0;
+    append->len = sc->append_lit_len;
 
     return e;
 }
@@ -853,19 +1010,13 @@ static derr_t handle_cmd(sc_t *sc, bool *ok){
             break;
         case IMAP_CMD_CAPA:
             if(sc->dn_active){
-                // true = always allow expunges, false = there is no uid mode
-                PROP(&e,
-                    dn_gather_updates(&sc->dn, true, false, NULL, out)
-                );
+                PROP(&e, gather_updates(sc, out) );
             }
             PROP(&e, respond_capas(tagp, build_capas, out) );
             break;
         case IMAP_CMD_NOOP:
             if(sc->dn_active){
-                // true = always allow expunges, false = there is no uid mode
-                PROP(&e,
-                    dn_gather_updates(&sc->dn, true, false, NULL, out)
-                );
+                PROP(&e, gather_updates(sc, out) );
             }
             PROP(&e, respond_noop(tagp, out) );
             break;
@@ -929,8 +1080,7 @@ static derr_t handle_cmd(sc_t *sc, bool *ok){
         case IMAP_CMD_CHECK:
             PROP(&e, require_selected(sc, tagp, &valid) );
             if(!valid) break;
-            // true = always allow expunges, false = there is no uid mode
-            PROP(&e, dn_gather_updates(&sc->dn, true, false, NULL, out) );
+            PROP(&e, gather_updates(sc, out) );
             PROP(&e, respond_noop(tagp, out) );
             break;
         case IMAP_CMD_SEARCH:
@@ -943,12 +1093,14 @@ static derr_t handle_cmd(sc_t *sc, bool *ok){
             if(!valid) break;
             PROP(&e, dn_idle(&sc->dn, tagp, out) );
             sc->idle = true;
+            set_prio(sc, SCHED_PRIO_HIGH);
             break;
         case IMAP_CMD_IDLE_DONE:
             PROP(&e, require_selected(sc, tagp, &valid) );
             if(!valid) break;
             PROP(&e, dn_idle_done(&sc->dn, arg->idle_done, out) );
             sc->idle = false;
+            set_prio(sc, SCHED_PRIO_NORMAL);
             break;
 
         // unacceptable commands //
@@ -981,10 +1133,7 @@ static derr_t advance_server(sc_t *sc){
     if(!ok){
         // if we didn't read any command but we are in IDLE, check for updates
         if(sc->idle){
-            // true = always allow expunges, false = there is no uid mode
-            PROP(&e,
-                dn_gather_updates(&sc->dn, true, false, NULL, &sc->resps)
-            );
+            PROP(&e, gather_updates(sc, &sc->resps) );
         }
         return e;
     }
@@ -1002,6 +1151,73 @@ static derr_t advance_server(sc_t *sc){
     return e;
 }
 
+static string_builder_t fetch_path(sc_t *sc, size_t tmp_id){
+    string_builder_t tmp_path = sb_append(&sc->dirmgr->path, SBS("tmp"));
+    return sb_append(&tmp_path, SBU(tmp_id));
+}
+
+// the client calls into our fetch_sink while it parses responses
+
+static derr_t fetch_sink_start(imap_literal_sink_i *sink, size_t len){
+    derr_t e = E_OK;
+    sc_t *sc = CONTAINER_OF(sink, sc_t, fetch_sink);
+
+    if(sc->fetch_fd_open){
+        ORIG(&e, E_INTERNAL, "literal started before previous literal ended");
+    }
+
+    sc->fetch_tmp_id = dirmgr_new_tmp_id(sc->dirmgr);
+    string_builder_t path = fetch_path(sc, sc->fetch_tmp_id);
+    PROP(&e,
+        dopen_path(&path, O_WRONLY | O_CREAT | O_TRUNC, 0666, &sc->fetch_fd)
+    );
+    sc->fetch_fd_open = true;
+    sc->fetch_remaining = len;
+
+    return e;
+}
+
+static derr_t fetch_sink_chunk(imap_literal_sink_i *sink, const dstr_t chunk){
+    derr_t e = E_OK;
+    sc_t *sc = CONTAINER_OF(sink, sc_t, fetch_sink);
+
+    PROP(&e, dstr_write(sc->fetch_fd, &chunk) );
+    sc->fetch_remaining -= chunk.len;
+    if(sc->fetch_remaining) return e;
+
+    // the literal is complete
+    if(sc->fetch_ready){
+        ORIG(&e, E_INTERNAL, "too many literals buffered");
+    }
+    sc->fetch_fd_open = false;
+    PROP(&e, dclose(sc->fetch_fd) );
+    sc->fetch_ready_tmp_id = sc->fetch_tmp_id;
+    sc->fetch_tmp_id = 0;
+    sc->fetch_ready = true;
+
+    return e;
+}
+
+static derr_t fetch_resp_up(sc_t *sc, const ie_fetch_resp_t *fetch){
+    derr_t e = E_OK;
+
+    if(!fetch->extras || fetch->extras->content){
+        PROP(&e, up_fetch_resp(&sc->up, fetch, NULL, &sc->cmds) );
+        return e;
+    }
+
+    // the BODY[] literal was streamed, and is waiting in a temp file
+    if(!sc->fetch_ready){
+        ORIG(&e, E_INTERNAL, "streamed BODY[] without a literal");
+    }
+    string_builder_t path = fetch_path(sc, sc->fetch_ready_tmp_id);
+    // the up_t takes the file
+    sc->fetch_ready = false;
+    PROP(&e, up_fetch_resp(&sc->up, fetch, &path, &sc->cmds) );
+
+    return e;
+}
+
 static derr_t assert_up_active(sc_t *sc){
     derr_t e = E_OK;
     if(sc->up_active) return e;
@@ -1045,7 +1261,7 @@ static derr_t handle_resp_serverless(
 
         case IMAP_RESP_FETCH:
             PROP(&e, assert_up_active(sc) );
-            PROP(&e, up_fetch_resp(&sc->up, arg->fetch, &sc->cmds) );
+            PROP(&e, fetch_resp_up(sc, arg->fetch) );
             break;
 
         case IMAP_RESP_VANISHED:
@@ -1235,7 +1451,13 @@ static void advance_state(sc_t *sc){
     // if we have a response, always call handle_resp_serverless first
     if(sc->resp){
         bool consume;
+        CITM_TRACE(
+            CITM_TRACE_DIR_START, sc->s->trace_id, NULL, CITM_TRACE_DIR_UP
+        );
         PROP_GO(&sc->e, handle_resp_serverless(sc, sc->resp, &consume), fail);
+        CITM_TRACE(
+            CITM_TRACE_DIR_DONE, sc->s->trace_id, NULL, CITM_TRACE_DIR_UP
+        );
         if(consume){
             imap_resp_free(STEAL(imap_resp_t, &sc->resp));
             // start reading the next response
@@ -1337,9 +1559,20 @@ void sc_start(
         .data = data,
         .dn_cb = { .schedule = server_dn_schedule },
         .up_cb = { .schedule = server_up_schedule },
+        .fetch_sink = {
+            .min_len = IMAP_STREAM_MIN_LEN,
+            .start = fetch_sink_start,
+            .chunk = fetch_sink_chunk,
+        },
+        // pooled clients arrive with ENABLE already done
+        .enable_sent = c->enabled,
+        .enable_done = c->enabled,
     };
     s->data = sc;
     c->data = sc;
+    CITM_TRACE(CITM_TRACE_LINK, s->trace_id, NULL, c->trace_id);
+    imap_server_stream_literals(s);
+    imap_client_stream_literals(c, &sc->fetch_sink);
     imap_server_must_await(s, sawait_cb, NULL);
     imap_client_must_await(c, cawait_cb, NULL);
     schedulable_prep(&sc->schedulable, scheduled);
@@ -1365,11 +1598,24 @@ void sc_free(sc_t *sc){
     dirmgr_freeze_free(sc->freeze_rename_src);
     dirmgr_freeze_free(sc->freeze_rename_dst);
     dirmgr_hold_free(sc->append_hold);
+    if(sc->append_fd_open) compat_close(sc->append_fd);
+    encrypter_free(&sc->append_ec);
+    dstr_free(&sc->append_cbuf);
+    ie_dstr_free(sc->append_content);
     if(sc->append_tmp_id){
         string_builder_t tmp_path = sb_append(&sc->dirmgr->path, SBS("tmp"));
         string_builder_t path = sb_append(&tmp_path, SBU(sc->append_tmp_id));
         DROP_CMD( remove_path(&path) );
     }
+    if(sc->fetch_fd_open) compat_close(sc->fetch_fd);
+    if(sc->fetch_tmp_id){
+        string_builder_t path = fetch_path(sc, sc->fetch_tmp_id);
+        DROP_CMD( remove_path(&path) );
+    }
+    if(sc->fetch_ready){
+        string_builder_t path = fetch_path(sc, sc->fetch_ready_tmp_id);
+        DROP_CMD( remove_path(&path) );
+    }
     imap_cmd_free(sc->cmd);
     imap_resp_free(sc->resp);
     link_t *link;
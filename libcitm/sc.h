@@ -41,6 +41,34 @@ struct sc_t {
     size_t append_len;
     msg_flags_t append_flags;
     imap_time_t append_intdate;
+    /* the APPEND literal is streamed: each plaintext chunk is written to the
+       temp file and encrypted into the upstream literal as it arrives */
+    int append_fd;
+    encrypter_t append_ec;
+    // plaintext bytes processed so far
+    size_t append_nread;
+    // the upstream literal length, and how much of it we have written
+    size_t append_lit_len;
+    size_t append_lit_sent;
+    char append_pbufmem[4096];
+    dstr_t append_pbuf;
+    dstr_t append_cbuf;
+    // only for an APPEND which was parsed before streaming was enabled
+    ie_dstr_t *append_content;
+    imap_server_literal_t sliteral;
+    imap_client_literal_t cliteral;
+
+    /* large FETCH BODY[] literals from upstream are written to a temp file
+       straight out of the client's read buffer, ahead of their FETCH */
+    imap_literal_sink_i fetch_sink;
+    int fetch_fd;
+    size_t fetch_tmp_id;
+    // bytes of the current literal which have not arrived yet
+    size_t fetch_remaining;
+    /* a finished literal, waiting for its FETCH response.  The client only
+       reads again once we have taken every response it parsed, so there is
+       never more than one. */
+    size_t fetch_ready_tmp_id;
 
     imap_server_read_t sread;
     imap_server_write_t swrite;
@@ -75,6 +103,17 @@ struct sc_t {
 
     bool passthru_pre : 1;
     bool passthru_sent : 1;
+    bool passthru_lit_done : 1;
+
+    bool append_fd_open : 1;
+    bool append_encrypted : 1;
+    // commands are held between a streamed APPEND and its final literal write
+    bool append_lit_up : 1;
+    bool reading_lit_dn : 1;
+    bool writing_lit_up : 1;
+
+    bool fetch_fd_open : 1;
+    bool fetch_ready : 1;
 
     bool idle : 1;
 
@@ -274,6 +274,36 @@ static derr_t write_bad(status_server_t *ss, ss_client_t *c){
     return e;
 }
 
+static derr_t write_stats(status_server_t *ss, ss_client_t *c){
+    derr_t e = E_OK;
+
+    duv_scheduler_t *s = ss->duv_scheduler;
+    duv_scheduler_stats_t *st = &s->stats;
+
+    // times are reported in microseconds
+    jdump_i *j = DOBJ(
+        DKEY("scheduler", DOBJ(
+            DKEY("depth", DU(duv_scheduler_depth(s))),
+            DKEY("depth_max", DU(st->depth_max)),
+            DKEY("ticks", DU(st->ticks)),
+            DKEY("yields", DU(st->yields)),
+            DKEY("tick_max_us", DU(st->tick_max_ns / 1000)),
+            DKEY("callbacks_high", DU(st->callbacks[SCHED_PRIO_HIGH])),
+            DKEY("callbacks_normal", DU(st->callbacks[SCHED_PRIO_NORMAL])),
+            DKEY("latency_max_us_high",
+                DU(st->latency_max_ns[SCHED_PRIO_HIGH] / 1000)
+            ),
+            DKEY("latency_max_us_normal",
+                DU(st->latency_max_ns[SCHED_PRIO_NORMAL] / 1000)
+            ),
+        )),
+    );
+
+    PROP(&e, do_write(ss, c, j) );
+
+    return e;
+}
+
 // returns true if we decide to write something
 static derr_t process_cmd(status_server_t *ss, ss_client_t *c, dstr_t cmd){
     derr_t e = E_OK;
@@ -297,7 +327,16 @@ static derr_t process_cmd(status_server_t *ss, ss_client_t *c, dstr_t cmd){
         DROP_VAR(&e);
         goto bad;
     }
-    // right now only the "check" command is allowed
+    // the "stats" command gets an immediate response
+    if(dstr_eq(command, DSTR_LIT("stats"))){
+        if(!ss->duv_scheduler){
+            badreason = DSTR_LIT("stats unavailable");
+            goto bad;
+        }
+        PROP(&e, write_stats(ss, c) );
+        return e;
+    }
+    // otherwise only the "check" command is allowed
     if(!dstr_eq(command, DSTR_LIT("check"))){
         badreason = DSTR_LIT("unrecognized command");
         goto bad;
@@ -512,6 +551,8 @@ derr_t status_server_init(
     };
 
     schedulable_prep(&ss->schedulable, scheduled);
+    // status updates are small and latency-sensitive
+    schedulable_set_prio(&ss->schedulable, SCHED_PRIO_HIGH);
 
     PROP_GO(&e, dstr_new(&ss->wbuf, 4096), fail);
     PROP_GO(&e, dstr_new(&ss->json_text, 4096), fail);
@@ -580,6 +621,10 @@ bool status_server_close(status_server_t *ss){
     return true;
 }
 
+void status_server_report_scheduler(status_server_t *ss, duv_scheduler_t *s){
+    ss->duv_scheduler = s;
+}
+
 void status_server_update(
     status_server_t *ss,
     status_maj_e maj,
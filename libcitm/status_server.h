@@ -59,6 +59,9 @@ typedef struct {
     status_done_cb done_cb;
     void *cb_data;
 
+    // optional, for answering the "stats" command
+    duv_scheduler_t *duv_scheduler;
+
     // state
     derr_t e;
     bool started : 1;
@@ -87,6 +90,10 @@ derr_t status_server_init(
 // returns true if a done_cb is coming
 bool status_server_close(status_server_t *ss);
 
+/* let clients see duv_scheduler_t stats with the "stats" command; the
+   scheduler must outlive the status_server_t */
+void status_server_report_scheduler(status_server_t *ss, duv_scheduler_t *s);
+
 void status_server_update(
     status_server_t *ss,
     status_maj_e maj,
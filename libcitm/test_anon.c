@@ -94,7 +94,7 @@ static derr_t do_test_anon(int mode, size_t cancel_after, bool *finished){
     PROP_GO(&e, imap_server_new(&server, sched, conn_dn), cu);
     PROP_GO(&e, imap_client_new(&client, sched, conn_up), cu);
 
-    PROP_GO(&e, anon_new(sched, server, client, cb, &ptrs, &anons), cu);
+    PROP_GO(&e, anon_new(sched, server, client, NULL, cb, &ptrs, &anons), cu);
     server = NULL; client = NULL;
     EXPECT_LIST_LENGTH_GO(&e, "anons", &anons, 1, cu);
     #define MAYBE_CANCEL if(cancel_after == steps++) goto cu
@@ -198,6 +198,7 @@ static void *run_uv_citm(void *arg){
             NULL, // sockfd; we don't support --system here
             NULL, // client_ctx
             g->tmp,
+            CITM_POOL_CFG_DEFAULT,
             globals_indicate_ready,
             globals_async_user,
             g
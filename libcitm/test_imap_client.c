@@ -212,9 +212,7 @@ static derr_t test_starttls(SSL_CTX *sctx, SSL_CTX *cctx){
     ADVANCE_TEST();
     PUSH_BYTES(&fs, &fc); // server response
     ADVANCE_TEST();
-    PUSH_BYTES(&fc, &fs); // client finishes handshake
-    ADVANCE_TEST();
-    PUSH_BYTES(&fc, &fs); // client sends its message
+    PUSH_BYTES(&fc, &fs); // client finishes handshake and sends its message
     ADVANCE_TEST();
 
     EXPECT_IWRITE_CB(1);
@@ -348,6 +346,126 @@ cu:
     return e;
 }
 
+typedef struct {
+    imap_literal_sink_i iface;
+    const imap_client_t *c;
+    size_t starts;
+    size_t len;
+    size_t total;
+    size_t max_chunk;
+    // every chunk must be a slice of the client's read buffer
+    bool copied;
+} fetch_sink_t;
+DEF_CONTAINER_OF(fetch_sink_t, iface, imap_literal_sink_i)
+
+static derr_t fetch_sink_start(imap_literal_sink_i *iface, size_t len){
+    fetch_sink_t *sink = CONTAINER_OF(iface, fetch_sink_t, iface);
+    sink->starts++;
+    sink->len = len;
+    return E_OK;
+}
+
+static derr_t fetch_sink_chunk(imap_literal_sink_i *iface, const dstr_t chunk){
+    fetch_sink_t *sink = CONTAINER_OF(iface, fetch_sink_t, iface);
+    const char *lo = sink->c->rbufmem;
+    const char *hi = lo + sizeof(sink->c->rbufmem);
+    if(chunk.data < lo || chunk.data + chunk.len > hi) sink->copied = true;
+    sink->total += chunk.len;
+    sink->max_chunk = MAX(sink->max_chunk, chunk.len);
+    return E_OK;
+}
+
+// a multi-megabyte BODY[] goes to the sink in read-buffer-sized slices
+static derr_t test_fetch_stream(void){
+    derr_t e = E_OK;
+
+    manual_scheduler_t m;
+    scheduler_i *sched = manual_scheduler(&m);
+
+    // pipeline diagram: (no tls required)
+    // fs <-> fconn <-> imap_client_t c
+
+    fake_stream_t fs;
+    fake_citm_conn_t fconn;
+    citm_conn_t *conn = fake_citm_conn(
+        &fconn, fake_stream(&fs), IMAP_SEC_INSECURE, NULL, (dstr_t){0}
+    );
+
+    imap_client_t *c = NULL;
+    imap_client_read_t iread;
+    imap_resp_t *resp = NULL;
+
+    #define BIG_LITERAL (4 * 1024 * 1024)
+    fetch_sink_t sink = {
+        .iface = {
+            .min_len = IMAP_STREAM_MIN_LEN,
+            .start = fetch_sink_start,
+            .chunk = fetch_sink_chunk,
+        },
+    };
+
+    // end of preamble
+
+    PROP_GO(&e, imap_client_new(&c, sched, conn), cu);
+    imap_client_must_await(c, await_cb, NULL);
+    sink.c = c;
+    imap_client_stream_literals(c, &sink.iface);
+
+    PROP_GO(&e, establish_imap_client(&m, &fs), cu);
+
+    imap_client_must_read(c, &iread, iread_cb);
+    PROP_GO(&e,
+        fake_stream_write(&m, &fs,
+            DSTR_LIT("* 1 FETCH (UID 9 BODY[] {4194304}\r\n")
+        ),
+    cu);
+    EXPECT_U_GO(&e, "starts", sink.starts, 1, cu);
+    EXPECT_U_GO(&e, "sink len", sink.len, BIG_LITERAL, cu);
+
+    // feed the literal one block at a time, as if from the wire
+    DSTR_VAR(block, 8192);
+    while(block.len < block.size){
+        dstr_append_quiet(&block, &DSTR_LIT("0123456789abcdef"));
+    }
+    size_t nfed = 0;
+    while(nfed < BIG_LITERAL){
+        dstr_t piece = dstr_sub2(block, 0, BIG_LITERAL - nfed);
+        while(piece.len){
+            EXPECT_B_GO(&e, "want read", fake_stream_want_read(&fs), true, cu);
+            dstr_t rest = fake_stream_feed_read(&fs, piece);
+            nfed += piece.len - rest.len;
+            piece = rest;
+            ADVANCE_FAKES(&m, &fs);
+            PROP_VAR_GO(&e, &E, cu);
+        }
+    }
+    EXPECT_B_GO(&e, "early resp", link_list_isempty(&resps), true, cu);
+
+    PROP_GO(&e, fake_stream_write(&m, &fs, DSTR_LIT(")\r\n")), cu);
+    PROP_VAR_GO(&e, &E, cu);
+
+    EXPECT_U_GO(&e, "total", sink.total, BIG_LITERAL, cu);
+    EXPECT_B_GO(&e, "copied", sink.copied, false, cu);
+    EXPECT_U_GO(&e, "max chunk", sink.max_chunk, sizeof(c->rbufmem), cu);
+
+    resp = CONTAINER_OF(link_list_pop_first(&resps), imap_resp_t, link);
+    EXPECT_NOT_NULL_GO(&e, "resp", resp, cu);
+    EXPECT_U_GO(&e, "type", resp->type, IMAP_RESP_FETCH, cu);
+    EXPECT_U_GO(&e, "uid", resp->arg.fetch->uid, 9, cu);
+    ie_fetch_resp_extra_t *extra = resp->arg.fetch->extras;
+    EXPECT_NOT_NULL_GO(&e, "extras", extra, cu);
+    EXPECT_NULL_GO(&e, "content", extra->content, cu);
+    EXPECT_U_GO(&e, "len", extra->len, BIG_LITERAL, cu);
+
+cu:
+    MERGE_VAR(&e, &E, "global error");
+    MERGE_CMD(&e, cleanup_imap_client(&m, &c, &fs), "imap_client");
+    MERGE_CMD(&e, fake_citm_conn_cleanup(&m, &fconn, &fs), "fs");
+    imap_resp_free(resp);
+
+    return e;
+}
+
 int main(int argc, char** argv){
     derr_t e = E_OK;
     int exit_code = 0;
@@ -365,6 +483,7 @@ int main(int argc, char** argv){
 
     PROP_GO(&e, test_starttls(sctx, cctx), cu);
     PROP_GO(&e, test_writes(), cu);
+    PROP_GO(&e, test_fetch_stream(), cu);
 
 cu:
     if(is_error(e)){
@@ -344,9 +344,7 @@ static derr_t test_starttls(SSL_CTX *sctx, SSL_CTX *cctx, test_mode_e mode){
     // finish tls handshake
     PUSH_BYTES(&fs, &fc); // server response
     ADVANCE_TEST();
-    PUSH_BYTES(&fc, &fs); // client finished hanshake
-    ADVANCE_TEST();
-    PUSH_BYTES(&fc, &fs); // client writes initial message
+    PUSH_BYTES(&fc, &fs); // client finishes handshake and writes a message
     ADVANCE_TEST();
     EXPECT_WRITE_CB;
     EXPECT_CMD("5 NOOP\r\n");
@@ -373,9 +371,7 @@ static derr_t test_starttls(SSL_CTX *sctx, SSL_CTX *cctx, test_mode_e mode){
     // read the informational response we queued at the beginning
     stream_must_read(c, &read, rbuf, read_cb);
     ADVANCE_TEST();
-    PUSH_BYTES(&fs, &fc); // server finished handshake
-    ADVANCE_TEST();
-    PUSH_BYTES(&fs, &fc); // server sends response
+    PUSH_BYTES(&fs, &fc); // server finishes handshake and sends response
     ADVANCE_TEST();
 
     EXPECT_IWRITE_CB(1);
@@ -562,6 +558,138 @@ cu:
     return e;
 }
 
+static dstr_t litgot = {0};
+
+static void literal_cb(
+    imap_server_t *s, imap_server_literal_t *req, dstr_t buf
+){
+    (void)s;
+    (void)req;
+    dstr_append_quiet(&litgot, &buf);
+}
+
+// make sure pipelined APPENDs with streamed literals are read correctly
+static derr_t test_pipelined_appends(void){
+    derr_t e = E_OK;
+
+    manual_scheduler_t m;
+    scheduler_i *sched = manual_scheduler(&m);
+
+    // pipeline diagram: (no tls required)
+    // fs <-> fconn <-> imap_server_t s
+
+    fake_stream_t fs;
+    fake_citm_conn_t fconn;
+    citm_conn_t *conn = fake_citm_conn(
+        &fconn, fake_stream(&fs), IMAP_SEC_INSECURE, NULL, (dstr_t){0}
+    );
+
+    imap_server_t *s = NULL;
+
+    imap_server_read_t iread;
+    imap_server_literal_t lread;
+    DSTR_VAR(lbuf, 4096);
+    imap_cmd_t *cmd = NULL;
+
+    // both literals are the minimum streamable size, with different content
+    DSTR_VAR(lit1, IMAP_STREAM_MIN_LEN);
+    DSTR_VAR(lit2, IMAP_STREAM_MIN_LEN);
+    for(size_t i = 0; i < IMAP_STREAM_MIN_LEN; i++){
+        lit1.data[i] = (char)('a' + i % 26);
+        lit2.data[i] = (char)('A' + i % 26);
+    }
+    lit1.len = IMAP_STREAM_MIN_LEN;
+    lit2.len = IMAP_STREAM_MIN_LEN;
+
+    /* the client sends both APPENDs in a single write, so the end of the
+       first literal shares a read with the start of the second */
+    DSTR_VAR(input, 2 * IMAP_STREAM_MIN_LEN + 128);
+    PROP_GO(&e,
+        FMT(&input,
+            "1 APPEND inbox {%x}\r\n%x\r\n2 APPEND inbox {%x}\r\n%x\r\n",
+            FU(lit1.len), FD(lit1), FU(lit2.len), FD(lit2)
+        ),
+    cu);
+    dstr_t leftover = input;
+
+    DSTR_VAR(litmem, IMAP_STREAM_MIN_LEN);
+    litgot = litmem;
+
+    // end of preamble
+
+    PROP_GO(&e, imap_server_new(&s, sched, conn), cu);
+    imap_server_must_await(s, await_cb, NULL);
+    imap_server_stream_literals(s);
+
+    PROP_GO(&e, establish_imap_server(&m, &fs), cu);
+
+    #define FEED_IF_WANTED do { \
+        ADVANCE_FAKES(&m, &fs); \
+        PROP_VAR_GO(&e, &E, cu); \
+        if(fake_stream_want_read(&fs)){ \
+            leftover = fake_stream_feed_read(&fs, leftover); \
+        } \
+        ADVANCE_FAKES(&m, &fs); \
+        PROP_VAR_GO(&e, &E, cu); \
+    } while(0)
+
+    #define EXPECT_APPEND(exp_tag) do { \
+        imap_server_must_read(s, &iread, iread_cb); \
+        FEED_IF_WANTED; \
+        cmd = CONTAINER_OF(link_list_pop_first(&cmds), imap_cmd_t, link); \
+        EXPECT_NOT_NULL_GO(&e, "plus req", cmd, cu); \
+        EXPECT_U_GO(&e, "cmd type", cmd->type, IMAP_CMD_PLUS_REQ, cu); \
+        imap_cmd_free(STEAL(imap_cmd_t, &cmd)); \
+        imap_server_must_read(s, &iread, iread_cb); \
+        FEED_IF_WANTED; \
+        cmd = CONTAINER_OF(link_list_pop_first(&cmds), imap_cmd_t, link); \
+        EXPECT_NOT_NULL_GO(&e, "append", cmd, cu); \
+        EXPECT_U_GO(&e, "cmd type", cmd->type, IMAP_CMD_APPEND, cu); \
+        EXPECT_D_GO(&e, "tag", cmd->tag->dstr, DSTR_LIT(exp_tag), cu); \
+        EXPECT_NULL_GO(&e, "content", cmd->arg.append->content, cu); \
+        EXPECT_U_GO(&e, \
+            "len", cmd->arg.append->len, IMAP_STREAM_MIN_LEN, cu \
+        ); \
+        imap_cmd_free(STEAL(imap_cmd_t, &cmd)); \
+    } while(0)
+
+    #define EXPECT_LITERAL(exp) do { \
+        litgot.len = 0; \
+        while(litgot.len < exp.len){ \
+            size_t before = litgot.len; \
+            imap_server_must_read_literal(s, &lread, lbuf, literal_cb); \
+            FEED_IF_WANTED; \
+            EXPECT_B_GO(&e, \
+                "literal progress", litgot.len > before, true, cu \
+            ); \
+        } \
+        EXPECT_D3_GO(&e, "literal", litgot, exp, cu); \
+    } while(0)
+
+    EXPECT_APPEND("1");
+    EXPECT_LITERAL(lit1);
+    EXPECT_APPEND("2");
+    EXPECT_LITERAL(lit2);
+
+    // the whole write was consumed
+    EXPECT_U_GO(&e, "leftover", leftover.len, 0, cu);
+
+cu:
+    MERGE_VAR(&e, &E, "global error");
+    MERGE_CMD(&e, cleanup_imap_server(&m, &s, &fs), "imap_server");
+    MERGE_CMD(&e, fake_citm_conn_cleanup(&m, &fconn, &fs), "fs");
+
+    imap_cmd_free(cmd);
+
+    link_t *link;
+    while((link = link_list_pop_first(&cmds))){
+        imap_cmd_t *cmd = CONTAINER_OF(link, imap_cmd_t, link);
+        imap_cmd_free(cmd);
+    }
+
+    return e;
+}
+
 int main(int argc, char** argv){
     derr_t e = E_OK;
     int exit_code = 0;
@@ -583,6 +711,7 @@ int main(int argc, char** argv){
     PROP_GO(&e, test_writes(), cu);
     PROP_GO(&e, test_broken_conn(false), cu);
     PROP_GO(&e, test_broken_conn(true), cu);
+    PROP_GO(&e, test_pipelined_appends(), cu);
 
 cu:
     if(is_error(e)){
@@ -221,6 +221,113 @@ cu:
     return e;
 }
 
+static derr_t write_encrypted(
+    link_t *keys, const dstr_t plain, const string_builder_t *path
+){
+    derr_t e = E_OK;
+
+    encrypter_t ec = {0};
+    dstr_t cipher = {0};
+
+    PROP_GO(&e, dstr_new(&cipher, plain.len * 2), cu);
+    PROP_GO(&e, encrypter_new(&ec), cu);
+    PROP_GO(&e, encrypter_start(&ec, keys, &cipher), cu);
+    PROP_GO(&e, encrypter_update(&ec, &plain, &cipher), cu);
+    PROP_GO(&e, encrypter_finish(&ec, &cipher), cu);
+    PROP_GO(&e, dstr_write_path(path, &cipher), cu);
+
+cu:
+    encrypter_free(&ec);
+    dstr_free(&cipher);
+    return e;
+}
+
+// process_file decrypts a streamed message a chunk at a time
+static derr_t do_test_process_file(keydir_i *kd, const string_builder_t *root){
+    derr_t e = E_OK;
+
+    imaildir_hooks_i *hooks = kd->dirmgr(kd)->imaildir_hooks;
+    string_builder_t in = sb_append(root, SBS("in"));
+    string_builder_t out = sb_append(root, SBS("out"));
+    DSTR_STATIC(mailbox, "INBOX");
+    dstr_t plain = {0};
+    dstr_t got = {0};
+    keypair_t *kp = NULL;
+    size_t len;
+    bool not4me;
+    bool ok;
+
+    // a few megabytes of plaintext, spanning many read chunks
+    PROP_GO(&e, dstr_new(&plain, 3 * 1024 * 1024), cu);
+    PROP_GO(&e, FMT(&plain, "Subject: big\r\n\r\n"), cu);
+    for(size_t i = 0; plain.len + 32 < plain.size; i++){
+        PROP_GO(&e, FMT(&plain, "line number %x\r\n", FU(i)), cu);
+    }
+
+    PROP_GO(&e, write_encrypted(kd->all_keys(kd), plain, &in), cu);
+    PROP_GO(&e,
+        hooks->process_file(hooks, &mailbox, &in, &out, &len, &not4me),
+    cu);
+    EXPECT_B_GO(&e, "not4me", not4me, false, cu);
+    EXPECT_U_GO(&e, "len", len, plain.len, cu);
+    PROP_GO(&e, dstr_read_path(&out, &got), cu);
+    EXPECT_D3_GO(&e, "plaintext", got, plain, cu);
+    // the streamed file is left alone
+    PROP_GO(&e, exists_path(&in, &ok), cu);
+    EXPECT_B_GO(&e, "in exists", ok, true, cu);
+    got.len = 0;
+
+    // a message for somebody else leaves no partial plaintext behind
+    PROP_GO(&e, keypair_from_pubkey_pem(&kp, peer1), cu);
+    link_t keys = {0};
+    link_list_append(&keys, &kp->link);
+    PROP_GO(&e, write_encrypted(&keys, plain, &in), cu);
+    PROP_GO(&e, remove_path(&out), cu);
+    PROP_GO(&e,
+        hooks->process_file(hooks, &mailbox, &in, &out, &len, &not4me),
+    cu);
+    EXPECT_B_GO(&e, "not4me", not4me, true, cu);
+    PROP_GO(&e, exists_path(&out, &ok), cu);
+    EXPECT_B_GO(&e, "out exists", ok, false, cu);
+
+    // unencrypted messages are still mangled
+    PROP_GO(&e, dstr_write_path(&in, &DSTR_LIT("Subject: hi\r\n\r\nyo")), cu);
+    PROP_GO(&e,
+        hooks->process_file(hooks, &mailbox, &in, &out, &len, &not4me),
+    cu);
+    EXPECT_B_GO(&e, "not4me", not4me, false, cu);
+    PROP_GO(&e, dstr_read_path(&out, &got), cu);
+    EXPECT_D3_GO(&e,
+        "mangled", got, DSTR_LIT("Subject: NOT ENCRYPTED: hi\r\n\r\nyo"),
+    cu);
+
+cu:
+    keypair_free(&kp);
+    dstr_free(&got);
+    dstr_free(&plain);
+    return e;
+}
+
+static derr_t test_process_file(void){
+    derr_t e = E_OK;
+
+    DSTR_VAR(path, 4096);
+    PROP(&e, mkdir_temp("test-keydir", &path) );
+
+    string_builder_t sb = SBD(path);
+    keydir_i *kd = NULL;
+
+    PROP_GO(&e, keydir_new(&sb, username, &kd), cu);
+
+    PROP_GO(&e, do_test_process_file(kd, &sb), cu);
+
+cu:
+    if(kd) kd->free(kd);
+    DROP_CMD( rm_rf_path(&sb) );
+
+    return e;
+}
+
 int main(int argc, char** argv){
     derr_t e = E_OK;
     int exit_code = 0;
@@ -233,6 +340,7 @@ int main(int argc, char** argv){
     PROP_GO(&e, ssl_library_init(), cu);
 
     PROP_GO(&e, test_keydir(), cu);
+    PROP_GO(&e, test_process_file(), cu);
 
 cu:
     if(is_error(e)){
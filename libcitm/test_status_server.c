@@ -66,6 +66,8 @@ typedef struct {
     bool unrecog_sent_1 : 1;
     bool unrecog_sent_2 : 1;
     bool unrecog_recv : 1;
+    bool stats_sent : 1;
+    bool stats_recv : 1;
     bool check_sent : 1;
     bool read_stop_recv_1 : 1;
     bool read_stop_recv_2 : 1;
@@ -191,6 +193,7 @@ static derr_t test_server_advance_up(advancer_t *advancer){
                 ts // cb_data
             )
         );
+        status_server_report_scheduler(&ts->ss, &ts->root.scheduler);
 
         PROP(&e, duv_pipe_init(&ts->root.loop, &ts->pipe, 0) );
         ts->pipe.data = ts;
@@ -362,6 +365,26 @@ static derr_t test_server_advance_up(advancer_t *advancer){
         ts->rbuf.len = 0;
     }
 
+    // ask for scheduler stats
+    TONCE(ts->stats_sent){
+        DSTR_STATIC(stats, "{\"command\":\"stats\"}\n");
+        uv_buf_t buf = { .base = stats.data, .len = (unsigned long)stats.len };
+        PROP(&e, duv_pipe_write(&ts->wreq, &ts->pipe, &buf, 1, ts_write_cb) );
+    }
+    TFINISH(ts->stats_recv){
+        // wait for a complete line
+        if(!dstr_contains(ts->rbuf, DSTR_LIT("\n"))) return e;
+        // the values vary, but the scheduler has definitely ticked
+        DSTR_STATIC(exp, "{\"scheduler\":{\"depth\":");
+        EXPECT_D3(&e, "stats response", dstr_sub2(ts->rbuf, 0, exp.len), exp);
+        EXPECT_B(&e,
+            "stats has ticks",
+            dstr_contains(ts->rbuf, DSTR_LIT("\"ticks\":0,")),
+            false
+        );
+        ts->rbuf.len = 0;
+    }
+
     // client send a check
     TONCE(ts->check_sent){
         /* in the GET_READ_STOP case, we need a full buffer composed of
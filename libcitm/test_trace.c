@@ -0,0 +1,138 @@
+#include "libcitm/libcitm.h"
+
+#include "test/test_utils.h"
+
+static derr_t test_ring_math(void){
+    derr_t e = E_OK;
+
+    struct {
+        uint64_t next;
+        uint64_t first;
+    } cases[] = {
+        // not full yet
+        {0, 0},
+        {3, 0},
+        // exactly full
+        {5, 0},
+        // wrapped once, then many times
+        {6, 1},
+        {12, 7},
+        {1000003, 999998},
+    };
+    for(size_t i = 0; i < sizeof(cases)/sizeof(*cases); i++){
+        citm_trace_hdr_t hdr = { .nrecs = 5, .next = cases[i].next };
+        uint64_t first = citm_trace_first(&hdr);
+        EXPECT_U_GO(&e, "first", first, cases[i].first, cu);
+        // the readable records fill every slot once, oldest first
+        bool seen[5] = {0};
+        for(uint64_t j = first; j < hdr.next; j++){
+            size_t slot = citm_trace_slot(&hdr, j);
+            EXPECT_U_GO(&e, "slot", slot, j % 5, cu);
+            EXPECT_B_GO(&e, "seen", seen[slot], false, cu);
+            seen[slot] = true;
+        }
+    }
+
+cu:
+    return e;
+}
+
+#ifdef BUILD_CITM_TRACE
+
+// write n records with aux=0..n-1 to a ring of nrecs, and check the file
+static derr_t do_test_ring(
+    const string_builder_t *dir, size_t nrecs, size_t n
+){
+    derr_t e = E_OK;
+
+    dstr_t text = {0};
+
+    string_builder_t sb = sb_append(dir, SBS("trace"));
+    DSTR_VAR(path, 4096);
+    PROP(&e, FMT(&path, "%x", FSB(sb)) );
+
+    PROP(&e, citm_trace_start(path.data, nrecs) );
+    ie_dstr_t tag = { .dstr = DSTR_LIT("a1") };
+    for(size_t i = 0; i < n; i++){
+        // only every third record has a tag
+        CITM_TRACE(CITM_TRACE_DN_CMD, 7, i % 3 ? NULL : &tag, i);
+    }
+    citm_trace_stop();
+
+    PROP_GO(&e, dstr_read_path(&sb, &text), cu);
+
+    citm_trace_hdr_t hdr;
+    EXPECT_B_GO(&e, "has header", text.len >= sizeof(hdr), true, cu);
+    memcpy(&hdr, text.data, sizeof(hdr));
+    EXPECT_U_GO(&e, "version", hdr.version, CITM_TRACE_VERSION, cu);
+    EXPECT_U_GO(&e, "recsize", hdr.recsize, sizeof(citm_trace_rec_t), cu);
+    EXPECT_U_GO(&e, "nrecs", hdr.nrecs, nrecs, cu);
+    EXPECT_U_GO(&e, "next", hdr.next, n, cu);
+
+    // the file only grows as far as the ring has been filled
+    size_t filled = MIN(n, nrecs);
+    size_t len = sizeof(hdr) + filled * sizeof(citm_trace_rec_t);
+    EXPECT_U_GO(&e, "file length", text.len, len, cu);
+
+    // exactly the newest records remain, and they read back in order
+    uint64_t first = citm_trace_first(&hdr);
+    EXPECT_U_GO(&e, "first", first, n - filled, cu);
+    const char *recs = text.data + sizeof(hdr);
+    for(uint64_t i = first; i < hdr.next; i++){
+        citm_trace_rec_t rec;
+        size_t slot = citm_trace_slot(&hdr, i);
+        memcpy(&rec, recs + slot * sizeof(rec), sizeof(rec));
+        EXPECT_U_GO(&e, "aux", rec.aux, i, cu);
+        EXPECT_U_GO(&e, "ev", rec.ev, CITM_TRACE_DN_CMD, cu);
+        EXPECT_U_GO(&e, "conn", rec.conn, 7, cu);
+        EXPECT_U_GO(&e, "taglen", rec.taglen, i % 3 ? 0 : 2, cu);
+    }
+
+cu:
+    dstr_free(&text);
+    return e;
+}
+
+static derr_t test_ring_wrap(void){
+    derr_t e = E_OK;
+
+    DSTR_VAR(tmp, 4096);
+    PROP(&e, mkdir_temp("test-trace", &tmp) );
+    string_builder_t dir = SBD(tmp);
+
+    // a partial ring
+    PROP_GO(&e, do_test_ring(&dir, 1000, 300), cu);
+    // exactly full
+    PROP_GO(&e, do_test_ring(&dir, 100, 100), cu);
+    /* wrapped several times, with batches which straddle the end of the
+       ring and a final partial batch from citm_trace_stop() */
+    PROP_GO(&e, do_test_ring(&dir, 100, 805), cu);
+    // a ring smaller than one batch, so one batch wraps by itself
+    PROP_GO(&e, do_test_ring(&dir, 7, 600), cu);
+
+cu:
+    DROP_CMD( rm_rf_path(&dir) );
+    return e;
+}
+
+#endif
+
+int main(int argc, char** argv){
+    derr_t e = E_OK;
+    // parse options and set default log level
+    PARSE_TEST_OPTIONS(argc, argv, NULL, LOG_LVL_INFO);
+
+    PROP_GO(&e, test_ring_math(), test_fail);
+#ifdef BUILD_CITM_TRACE
+    PROP_GO(&e, test_ring_wrap(), test_fail);
+#endif
+
+    LOG_ERROR("PASS\n");
+    return 0;
+
+test_fail:
+    DUMP(e);
+    DROP_VAR(&e);
+    LOG_ERROR("FAIL\n");
+    return 1;
+}
@@ -0,0 +1,216 @@
+#include "libduv/fake_stream.h"
+#include "libcitm/libcitm.h"
+#include "libcitm/fake_citm.h"
+
+#include "test/test_utils.h"
+
+static void cawait_cb(
+    imap_client_t *c, derr_t e, link_t *reads, link_t *writes
+){
+    (void)c;
+    (void)reads;
+    (void)writes;
+    DROP_VAR(&e);
+}
+
+static derr_t do_test_upool(bool reject){
+    derr_t e = E_OK;
+
+    /* pipeline diagram:
+                    ________________
+                   |    upool_t     |
+                   |                |
+       c1 <-------> imap_client_t   |
+                   |________________|
+
+       After an adoption, the traded-in client (on c2) replaces the adopted
+       client (on c1) in the pool. */
+
+    manual_scheduler_t m;
+    fake_stream_t c1s, c2s;
+    fake_citm_conn_t c1f, c2f;
+    citm_conn_t *c1c = NULL, *c2c = NULL;
+    fake_citm_connect_t fcnct = {0};
+    imap_client_t *c2 = NULL;
+    imap_client_t *adopted = NULL;
+    hash_elem_t *elem;
+    dstr_t user = {0};
+    dstr_t pass = {0};
+    hashmap_t upools = {0};
+
+    c1c = fake_citm_conn_insec(&c1f, fake_stream(&c1s));
+    c2c = fake_citm_conn_insec(&c2f, fake_stream(&c2s));
+
+    scheduler_i *sched = manual_scheduler(&m);
+
+    fake_citm_io_t fio;
+    citm_io_i *io = fake_citm_io(&fio);
+    fio.now = 1000;
+
+    PROP_GO(&e, dstr_append(&user, &DSTR_LIT("user")), cu);
+    PROP_GO(&e, dstr_append(&pass, &DSTR_LIT("pass")), cu);
+    PROP_GO(&e, hashmap_init(&upools), cu);
+
+    // the client we will trade in
+    PROP_GO(&e, imap_client_new(&c2, sched, c2c), cu);
+
+    fake_citm_connect_prep(&fcnct);
+    link_list_append(&fio.fcncts, &fcnct.link);
+    citm_pool_cfg_t cfg = { .size = 1, .idle_timeout = 600 };
+    PROP_GO(&e,
+        upool_new(
+            sched,
+            io,
+            cfg,
+            STEAL(dstr_t, &user),
+            STEAL(dstr_t, &pass),
+            &upools
+        ),
+    cu);
+    EXPECT_U_GO(&e, "len(upools)", upools.num_elems, 1, cu);
+    EXPECT_LIST_LENGTH_GO(&e, "fcncts", &fio.fcncts, 0, cu);
+    elem = hashmap_gets(&upools, &DSTR_LIT("user"));
+    EXPECT_NOT_NULL_GO(&e, "elem", elem, cu);
+    EXPECT_I_GO(&e,
+        "deadline", upool_deadline(elem), 1000 + UPOOL_KEEPALIVE, cu
+    );
+
+    #define READ_EX(msg, _s) \
+        PROP_GO(&e, fake_stream_expect_read(&m, _s, DSTR_LIT(msg)), cu)
+
+    #define WRITE_EX(msg, _s) \
+        PROP_GO(&e, fake_stream_write(&m, _s, DSTR_LIT(msg)), cu)
+
+    PROP_GO(&e, fake_citm_connect_finish(&fcnct, c1c, E_NONE), cu);
+    PROP_GO(&e, establish_imap_client(&m, &c1s), cu);
+
+    // LOGIN and ENABLE are pipelined
+    READ_EX(
+        "upool1 LOGIN user pass\r\n"
+        "upool2 ENABLE CONDSTORE QRESYNC\r\n",
+        &c1s
+    );
+
+    if(reject){
+        WRITE_EX("upool1 NO bad password\r\n", &c1s);
+        ADVANCE_FAKES(&m, &c1s, &c2s);
+        // the pool closes itself
+        EXPECT_U_GO(&e, "len(upools)", upools.num_elems, 0, cu);
+        goto cu;
+    }
+
+    // nothing is ready yet
+    EXPECT_B_GO(&e,
+        "adopt early", upool_adopt(elem, DSTR_LIT("pass"), &c2), false, cu
+    );
+
+    WRITE_EX("upool1 OK logged in\r\n", &c1s);
+    WRITE_EX("* ENABLED CONDSTORE QRESYNC\r\n", &c1s);
+    WRITE_EX("upool2 OK enabled\r\n", &c1s);
+
+    // the wrong password never adopts
+    EXPECT_B_GO(&e, "check", upool_check(elem, DSTR_LIT("nope")), false, cu);
+    EXPECT_B_GO(&e,
+        "adopt bad pass", upool_adopt(elem, DSTR_LIT("nope"), &c2), false, cu
+    );
+
+    // trade in c2 for the ready client
+    fio.now += 10;
+    adopted = c2;
+    EXPECT_B_GO(&e,
+        "adopt", upool_adopt(elem, DSTR_LIT("pass"), &adopted), true, cu
+    );
+    c2 = NULL;
+    imap_client_must_await(adopted, cawait_cb, NULL);
+    EXPECT_B_GO(&e, "adopted->enabled", adopted->enabled, true, cu);
+    EXPECT_P_GO(&e, "adopted->conn", adopted->conn, &c1f.iface, cu);
+
+    // the traded-in client gets logged in to take its place
+    PROP_GO(&e, establish_imap_client(&m, &c2s), cu);
+    READ_EX(
+        "upool1 LOGIN user pass\r\n"
+        "upool2 ENABLE CONDSTORE QRESYNC\r\n",
+        &c2s
+    );
+    WRITE_EX("* OK informational\r\n", &c2s);
+    WRITE_EX("upool1 OK logged in\r\n", &c2s);
+    WRITE_EX("* ENABLED CONDSTORE QRESYNC\r\n", &c2s);
+    WRITE_EX("upool2 OK enabled\r\n", &c2s);
+
+    // keepalive
+    fio.now = 1000 + UPOOL_KEEPALIVE;
+    upool_tick(elem);
+    READ_EX("upool3 NOOP\r\n", &c2s);
+    WRITE_EX("upool3 OK noop\r\n", &c2s);
+    EXPECT_LIST_LENGTH_GO(&e, "fcncts", &fio.fcncts, 0, cu);
+    EXPECT_I_GO(&e,
+        "deadline", upool_deadline(elem), 1000 + 2*UPOOL_KEEPALIVE, cu
+    );
+
+    // idle timeout, counted from the adoption
+    fio.now = 1000 + 10 + 600;
+    upool_tick(elem);
+    EXPECT_I_GO(&e, "deadline", upool_deadline(elem), 0, cu);
+    ADVANCE_FAKES(&m, &c1s, &c2s);
+    EXPECT_U_GO(&e, "len(upools)", upools.num_elems, 0, cu);
+
+cu:
+    elem = hashmap_gets(&upools, &DSTR_LIT("user"));
+    if(elem){
+        upool_cancel(elem);
+        ADVANCE_FAKES(&m, &c1s, &c2s);
+        if(fcnct.canceled && !fcnct.done){
+            DROP_CMD(fake_citm_connect_finish(&fcnct, NULL, E_CANCELED));
+        }
+        ADVANCE_FAKES(&m, &c1s, &c2s);
+    }
+    if(c2){
+        imap_client_must_await(c2, cawait_cb, NULL);
+        imap_client_cancel(c2);
+    }
+    imap_client_cancel(adopted);
+    ADVANCE_FAKES(&m, &c1s, &c2s);
+    imap_client_free(&c2);
+    imap_client_free(&adopted);
+
+    dstr_free(&user);
+    dstr_free(&pass);
+    hashmap_free(&upools);
+    return e;
+}
+
+static derr_t test_upool(void){
+    derr_t e = E_OK;
+
+    PROP(&e, do_test_upool(false) );
+    PROP(&e, do_test_upool(true) );
+
+    return e;
+}
+
+int main(int argc, char** argv){
+    derr_t e = E_OK;
+    int exit_code = 0;
+
+    // parse options and set default log level
+    PARSE_TEST_OPTIONS(argc, argv, NULL, LOG_LVL_INFO);
+#ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    PROP_GO(&e, ssl_library_init(), fail);
+
+    PROP_GO(&e, test_upool(), fail);
+
+fail:
+    if(is_error(e)){
+        DUMP(e);
+        DROP_VAR(&e);
+        LOG_ERROR("FAIL\n");
+        exit_code = 1;
+    }else{
+        LOG_ERROR("PASS\n");
+    }
+    ssl_library_close();
+
+    return exit_code;
+}
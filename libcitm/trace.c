@@ -0,0 +1,143 @@
+#include "libcitm/libcitm.h"
+
+#include <errno.h>
+#include <string.h>
+
+static uint32_t next_id = 0;
+
+uint32_t citm_trace_id(void){
+    return ++next_id;
+}
+
+#ifdef BUILD_CITM_TRACE
+
+#define TRACE_NRECS_DEFAULT ((size_t)1 << 20)
+#define TRACE_BATCH 256
+
+bool citm_trace_on = false;
+
+static FILE *trace_f = NULL;
+static citm_trace_hdr_t trace_hdr;
+static citm_trace_rec_t batch[TRACE_BATCH];
+static size_t nbatch = 0;
+
+static derr_t write_at(size_t off, const void *data, size_t len){
+    derr_t e = E_OK;
+
+    if(off > LONG_MAX) ORIG(&e, E_FIXEDSIZE, "trace file too large");
+    if(fseek(trace_f, (long)off, SEEK_SET) != 0){
+        ORIG(&e, E_OS, "fseek(trace file): %x", FE(errno));
+    }
+    if(fwrite(data, 1, len, trace_f) != len){
+        ORIG(&e, E_OS, "fwrite(trace file): %x", FE(errno));
+    }
+
+    return e;
+}
+
+static derr_t flush_batch(void){
+    derr_t e = E_OK;
+
+    size_t done = 0;
+    while(done < nbatch){
+        // the batch might wrap around the end of the ring
+        size_t slot = citm_trace_slot(&trace_hdr, trace_hdr.next + done);
+        size_t n = MIN(nbatch - done, (size_t)trace_hdr.nrecs - slot);
+        size_t off = sizeof(trace_hdr) + slot * sizeof(*batch);
+        PROP(&e, write_at(off, &batch[done], n * sizeof(*batch)) );
+        done += n;
+    }
+    trace_hdr.next += nbatch;
+    nbatch = 0;
+
+    PROP(&e, write_at(0, &trace_hdr, sizeof(trace_hdr)) );
+    if(fflush(trace_f) != 0){
+        ORIG(&e, E_OS, "fflush(trace file): %x", FE(errno));
+    }
+
+    return e;
+}
+
+void citm_trace_pvt(
+    citm_trace_ev_e ev, uint32_t conn, const ie_dstr_t *tag, uint64_t aux
+){
+    citm_trace_rec_t *rec = &batch[nbatch++];
+    *rec = (citm_trace_rec_t){
+        .ns = uv_hrtime(),
+        .aux = aux,
+        .conn = conn,
+        .ev = (uint16_t)ev,
+    };
+    if(tag){
+        rec->taglen = (uint8_t)MIN(tag->dstr.len, CITM_TRACE_TAG_MAX);
+        memcpy(rec->tag, tag->dstr.data, rec->taglen);
+    }
+
+    if(nbatch < TRACE_BATCH) return;
+
+    derr_t e = flush_batch();
+    CATCH_ANY(&e){
+        // a broken trace file just ends the trace
+        TRACE(&e, "disabling citm trace\n");
+        DUMP(e);
+        DROP_VAR(&e);
+        nbatch = 0;
+        citm_trace_stop();
+    }
+}
+
+derr_t citm_trace_start(const char *path, size_t nrecs){
+    derr_t e = E_OK;
+
+    if(trace_f) ORIG(&e, E_PARAM, "citm trace is already running");
+
+    trace_hdr = (citm_trace_hdr_t){
+        .magic = CITM_TRACE_MAGIC,
+        .version = CITM_TRACE_VERSION,
+        .recsize = sizeof(citm_trace_rec_t),
+        .nrecs = nrecs ? nrecs : TRACE_NRECS_DEFAULT,
+    };
+    nbatch = 0;
+
+    trace_f = compat_fopen(path, "wb");
+    if(!trace_f){
+        ORIG(&e, E_OS, "fopen(%x): %x", FS(path), FE(errno));
+    }
+    PROP_GO(&e, write_at(0, &trace_hdr, sizeof(trace_hdr)), fail);
+
+    citm_trace_on = true;
+
+    return e;
+
+fail:
+    fclose(trace_f);
+    trace_f = NULL;
+    return e;
+}
+
+void citm_trace_stop(void){
+    if(!trace_f) return;
+    citm_trace_on = false;
+    if(nbatch){
+        derr_t e = flush_batch();
+        CATCH_ANY(&e){
+            DUMP(e);
+            DROP_VAR(&e);
+        }
+    }
+    fclose(trace_f);
+    trace_f = NULL;
+}
+
+#else
+
+derr_t citm_trace_start(const char *path, size_t nrecs){
+    derr_t e = E_OK;
+    (void)path;
+    (void)nrecs;
+    ORIG(&e, E_PARAM, "citm was built without BUILD_CITM_TRACE");
+}
+
+void citm_trace_stop(void){}
+
+#endif
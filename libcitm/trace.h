@@ -0,0 +1,106 @@
+/* The citm trace records timestamped relay events for offline latency
+   analysis, like where the time goes between a client sending a command and
+   getting its tagged response.  Tracing is compiled in only when
+   BUILD_CITM_TRACE is defined, and then it costs one branch per event until
+   citm_trace_start() is called.
+
+   Events go to a fixed-size binary ring file: a citm_trace_hdr_t followed by
+   hdr.nrecs citm_trace_rec_t's in host byte order.  Record i of the whole
+   trace is in slot i % nrecs, and hdr.next is the total number of records
+   written, so a full ring holds the newest nrecs records.  Records are
+   buffered and written in batches, and the header is updated with each batch.
+
+   The citm_trace tool turns a trace file into per-command latency
+   breakdowns.  Tracing must only be used from the event loop thread. */
+
+#define CITM_TRACE_MAGIC "SMTRACE"
+#define CITM_TRACE_VERSION 1
+#define CITM_TRACE_TAG_MAX 25
+
+typedef enum {
+    // conn=server id, aux=client id; the two halves of one relay
+    CITM_TRACE_LINK = 1,
+    // imap_server_t: bytes read from the client, aux=len
+    CITM_TRACE_DN_RECV,
+    // sc_t: a command from the client arrived, aux=imap_cmd_type_t
+    CITM_TRACE_DN_CMD,
+    // sc_t: a tagged response to the client was queued
+    CITM_TRACE_DN_RESP,
+    // imap_server_t: bytes written to the client, aux=len
+    CITM_TRACE_DN_SENT,
+    // sc_t: a command to the server was queued, conn=server id,
+    // aux=imap_cmd_type_t
+    CITM_TRACE_UP_CMD,
+    // imap_client_t: bytes written to the server, aux=len
+    CITM_TRACE_UP_SENT,
+    // imap_client_t: bytes read from the server, aux=len
+    CITM_TRACE_UP_RECV,
+    // sc_t: a tagged response from the server arrived, conn=server id
+    CITM_TRACE_UP_RESP,
+    // sc_t: started/finished an imaildir update, aux=citm_trace_dir_e
+    CITM_TRACE_DIR_START,
+    CITM_TRACE_DIR_DONE,
+} citm_trace_ev_e;
+
+typedef enum {
+    // the dn_t gathering updates for the client
+    CITM_TRACE_DIR_DN = 0,
+    // the up_t handling a response from the server
+    CITM_TRACE_DIR_UP = 1,
+} citm_trace_dir_e;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t recsize;
+    uint64_t nrecs;
+    uint64_t next;
+} citm_trace_hdr_t;
+
+typedef struct {
+    uint64_t ns; // monotonic
+    uint64_t aux;
+    uint32_t conn;
+    uint16_t ev;
+    uint8_t taglen;
+    char tag[CITM_TRACE_TAG_MAX];
+} citm_trace_rec_t;
+
+// the slot which holds record i of the whole trace
+static inline size_t citm_trace_slot(const citm_trace_hdr_t *hdr, uint64_t i){
+    return (size_t)(i % hdr->nrecs);
+}
+
+// the oldest record still in the ring; records [first, hdr.next) are readable
+static inline uint64_t citm_trace_first(const citm_trace_hdr_t *hdr){
+    return hdr->next > hdr->nrecs ? hdr->next - hdr->nrecs : 0;
+}
+
+// a fresh connection id for an imap_server_t or imap_client_t
+uint32_t citm_trace_id(void);
+
+// nrecs=0 means the default size; an existing file is overwritten
+derr_t citm_trace_start(const char *path, size_t nrecs);
+// writes out any buffered records and closes the file
+void citm_trace_stop(void);
+
+#ifdef BUILD_CITM_TRACE
+
+extern bool citm_trace_on;
+
+void citm_trace_pvt(
+    citm_trace_ev_e ev, uint32_t conn, const ie_dstr_t *tag, uint64_t aux
+);
+
+// tag may be NULL
+#define CITM_TRACE(ev, conn, tag, aux) do { \
+    if(citm_trace_on){ \
+        citm_trace_pvt((ev), (conn), (tag), (uint64_t)(aux)); \
+    } \
+} while(0)
+
+#else
+
+#define CITM_TRACE(ev, conn, tag, aux) do {} while(0)
+
+#endif
@@ -0,0 +1,619 @@
+#include "libcitm/libcitm.h"
+
+struct upool_t;
+
+typedef struct {
+    struct upool_t *pool;
+    link_t link;  // upool_t->conns
+
+    citm_connect_i *connect;
+    citm_conn_t *conn;
+    imap_client_t *c;
+
+    imap_client_read_t cread;
+    imap_client_write_t cwrite;
+
+    // what we have read
+    imap_resp_t *resp;
+    // what we are writing
+    link_t cmds;
+    size_t ntags;
+    // the tag of our NOOP, while it is in flight
+    size_t noop_tag;
+
+    derr_t e;
+
+    bool reading : 1;
+    bool writing : 1;
+    bool login_sent : 1;
+    bool login_done : 1;
+    bool noop_due : 1;
+    bool connect_canceled : 1;
+    bool failed : 1;
+} upool_conn_t;
+DEF_CONTAINER_OF(upool_conn_t, link, link_t)
+DEF_CONTAINER_OF(upool_conn_t, cread, imap_client_read_t)
+DEF_CONTAINER_OF(upool_conn_t, cwrite, imap_client_write_t)
+
+typedef struct upool_t {
+    hash_elem_t elem;  // citm_t->upools
+    scheduler_i *scheduler;
+    schedulable_t schedulable;
+    citm_io_i *io;
+    citm_pool_cfg_t cfg;
+
+    dstr_t user;
+    dstr_t pass;
+
+    link_t conns;  // upool_conn_t->link
+    size_t nconns;
+
+    // we close unless something is adopted before this time
+    time_t expiry;
+    // the next round of NOOPs
+    time_t keepalive;
+
+    size_t adopted;
+
+    bool rejected : 1;
+    bool expired : 1;
+    bool canceled : 1;
+} upool_t;
+DEF_CONTAINER_OF(upool_t, elem, hash_elem_t)
+DEF_CONTAINER_OF(upool_t, schedulable, schedulable_t)
+
+static void advance_state(upool_t *pool);
+
+static void scheduled(schedulable_t *s){
+    upool_t *pool = CONTAINER_OF(s, upool_t, schedulable);
+    advance_state(pool);
+}
+
+static void schedule(upool_t *pool){
+    pool->scheduler->schedule(pool->scheduler, &pool->schedulable);
+}
+
+static bool closing(upool_t *pool){
+    return pool->rejected || pool->expired || pool->canceled;
+}
+
+static void await_c(
+    imap_client_t *c, derr_t e, link_t *reads, link_t *writes
+){
+    // we only have static reads and writes
+    (void)reads;
+    (void)writes;
+
+    upool_conn_t *uc = c->data;
+    schedule(uc->pool);
+
+    // we only cancel clients which are already failing, or while closing
+    if(uc->failed || is_error(uc->e) || closing(uc->pool)){
+        DROP_CANCELED_VAR(&e);
+    }else{
+        UPGRADE_CANCELED_VAR(&e, E_INTERNAL);
+    }
+    KEEP_FIRST_IF_NOT_CANCELED_VAR(&uc->e, &e);
+}
+
+// a stream_i await_cb, only used if we close before making an imap_client_t
+static void await_conn(stream_i *s, derr_t e, link_t *reads, link_t *writes){
+    upool_conn_t *uc = s->data;
+    (void)reads;
+    (void)writes;
+    DROP_VAR(&e);
+    uc->conn->free(uc->conn);
+    uc->conn = NULL;
+    schedule(uc->pool);
+}
+
+static void connect_cb(void *data, citm_conn_t *conn, derr_t e){
+    upool_conn_t *uc = data;
+    schedule(uc->pool);
+
+    // done with connect
+    uc->connect = NULL;
+    uc->conn = conn;
+
+    if(uc->connect_canceled) DROP_CANCELED_VAR(&e);
+    UPGRADE_CANCELED_VAR(&e, E_INTERNAL);
+    KEEP_FIRST_IF_NOT_CANCELED_VAR(&uc->e, &e);
+}
+
+static void cread_cb(
+    imap_client_t *c, imap_client_read_t *req, imap_resp_t *resp
+){
+    (void)c;
+    upool_conn_t *uc = CONTAINER_OF(req, upool_conn_t, cread);
+    uc->reading = false;
+    uc->resp = resp;
+    schedule(uc->pool);
+}
+
+static void cwrite_cb(imap_client_t *c, imap_client_write_t *req){
+    (void)c;
+    upool_conn_t *uc = CONTAINER_OF(req, upool_conn_t, cwrite);
+    uc->writing = false;
+    schedule(uc->pool);
+}
+
+// returns bool ok
+static bool advance_writes(upool_conn_t *uc){
+    // have we finished the last write?
+    if(uc->writing) return false;
+
+    // should we start a new write?
+    link_t *link;
+    if((link = link_list_pop_first(&uc->cmds))){
+        imap_cmd_t *cmd = CONTAINER_OF(link, imap_cmd_t, link);
+        imap_client_must_write(uc->c, &uc->cwrite, cmd, cwrite_cb);
+        uc->writing = true;
+        return false;
+    }
+
+    return true;
+}
+
+// returns bool ok
+static bool advance_reads(upool_conn_t *uc){
+    if(uc->resp) return true;
+    ONCE(uc->reading) imap_client_must_read(uc->c, &uc->cread, cread_cb);
+    return false;
+}
+
+static ie_dstr_t *mktag(derr_t *e, upool_conn_t *uc){
+    if(is_error(*e)) return NULL;
+    DSTR_VAR(buf, 64);
+    // FU will be invoked twice on windows.
+    uc->ntags++;
+    IF_PROP(e, FMT(&buf, "upool%x", FU(uc->ntags)) ){
+        return NULL;
+    }
+    return ie_dstr_new2(e, buf);
+}
+
+static void queue_write(derr_t *e, upool_conn_t *uc, imap_cmd_t *cmd){
+    cmd = imap_cmd_assert_writable(e, cmd, &uc->c->exts);
+    if(is_error(*e)) return;
+    link_list_append(&uc->cmds, &cmd->link);
+    (void)advance_writes(uc);
+}
+
+static derr_t send_login(upool_conn_t *uc){
+    derr_t e = E_OK;
+
+    ie_dstr_t *tag = mktag(&e, uc);
+    ie_dstr_t *user = ie_dstr_new2(&e, uc->pool->user);
+    ie_dstr_t *pass = ie_dstr_new2(&e, uc->pool->pass);
+    ie_login_cmd_t *login = ie_login_cmd_new(&e, user, pass);
+    imap_cmd_arg_t arg = { .login = login };
+    imap_cmd_t *cmd = imap_cmd_new(&e, tag, IMAP_CMD_LOGIN, arg);
+    queue_write(&e, uc, cmd);
+    CHECK(&e);
+
+    return e;
+}
+
+static derr_t send_enable(upool_conn_t *uc){
+    derr_t e = E_OK;
+
+    ie_dstr_t *tag = mktag(&e, uc);
+    ie_dstr_t *ecs = ie_dstr_new2(&e, extension_token(EXT_CONDSTORE));
+    ie_dstr_t *eqr = ie_dstr_new2(&e, extension_token(EXT_QRESYNC));
+    ie_dstr_t *enable = ie_dstr_add(&e, ecs, eqr);
+    imap_cmd_arg_t arg = { .enable = enable };
+    imap_cmd_t *cmd = imap_cmd_new(&e, tag, IMAP_CMD_ENABLE, arg);
+    queue_write(&e, uc, cmd);
+    CHECK(&e);
+
+    return e;
+}
+
+static derr_t send_noop(upool_conn_t *uc){
+    derr_t e = E_OK;
+
+    ie_dstr_t *tag = mktag(&e, uc);
+    imap_cmd_t *cmd = imap_cmd_new(&e, tag, IMAP_CMD_NOOP, (imap_cmd_arg_t){0});
+    queue_write(&e, uc, cmd);
+    CHECK(&e);
+
+    uc->noop_tag = uc->ntags;
+
+    return e;
+}
+
+typedef derr_t (*check_f)(upool_conn_t *uc, imap_resp_t **respp, bool *ok);
+
+static derr_t check_login(upool_conn_t *uc, imap_resp_t **respp, bool *ok){
+    derr_t e = E_OK;
+
+    imap_resp_t *resp = *respp;
+
+    ie_st_resp_t *st;
+    if(!(st = match_tagged(resp, DSTR_LIT("upool"), 1))) return e;
+
+    if(st->status != IE_ST_OK){
+        // no connection in this pool will do any better
+        uc->pool->rejected = true;
+        ORIG(&e, E_RESPONSE, "upool_t failed to login: %x", FIRESP(resp));
+    }
+
+    *ok = true;
+
+    return e;
+}
+
+static derr_t check_enable(upool_conn_t *uc, imap_resp_t **respp, bool *ok){
+    derr_t e = E_OK;
+
+    (void)uc;
+
+    imap_resp_t *resp = *respp;
+
+    if(resp->type == IMAP_RESP_ENABLED){
+        bool condstore = false;
+        bool qresync = false;
+        for(ie_dstr_t *ptr = resp->arg.enabled; ptr; ptr = ptr->next){
+            if(dstr_eq(ptr->dstr, extension_token(EXT_CONDSTORE))){
+                condstore = true;
+            }else if(dstr_eq(ptr->dstr, extension_token(EXT_QRESYNC))){
+                qresync = true;
+            }
+        }
+        if(!condstore || !qresync){
+            ORIG(&e, E_RESPONSE, "bad ENABLED response: %x", FIRESP(resp));
+        }
+        // done with this response
+        imap_resp_free(STEAL(imap_resp_t, respp));
+        return e;
+    }
+
+    ie_st_resp_t *st;
+    if(!(st = match_tagged(resp, DSTR_LIT("upool"), 2))) return e;
+
+    if(st->status != IE_ST_OK){
+        ORIG(&e, E_RESPONSE, "upool_t failed to enable: %x", FIRESP(resp));
+    }
+
+    *ok = true;
+
+    return e;
+}
+
+static derr_t check_noop(upool_conn_t *uc, imap_resp_t **respp, bool *ok){
+    derr_t e = E_OK;
+
+    imap_resp_t *resp = *respp;
+
+    ie_st_resp_t *st;
+    if(!(st = match_tagged(resp, DSTR_LIT("upool"), uc->noop_tag))) return e;
+
+    if(st->status != IE_ST_OK){
+        ORIG(&e, E_RESPONSE, "upool_t keepalive failed: %x", FIRESP(resp));
+    }
+
+    *ok = true;
+
+    return e;
+}
+
+// *ok means "state machine can proceed", not "let's address this resp later"
+static derr_t check_resp(upool_conn_t *uc, bool *ok, check_f check_fn){
+    derr_t e = E_OK;
+    *ok = false;
+
+    imap_resp_t *resp = STEAL(imap_resp_t, &uc->resp);
+
+    PROP_GO(&e, check_fn(uc, &resp, ok), cu);
+    // did the check_fn set ok or consume the output?
+    if(*ok || !resp) goto cu;
+
+    // ignore informational responses
+    if(match_info(resp)) goto cu;
+
+    ORIG_GO(&e, E_RESPONSE, "unexpected response: %x", cu, FIRESP(resp));
+
+cu:
+    imap_resp_free(resp);
+    return e;
+}
+
+// returns true when uc is ready to be freed
+static bool advance_conn(upool_conn_t *uc){
+    upool_t *pool = uc->pool;
+    bool ok;
+
+    if(is_error(uc->e)) goto fail;
+    if(uc->failed || closing(pool)) goto close;
+
+    // wait to ready our imap client
+    if(!uc->c){
+        // wait for connect cb
+        if(!uc->conn) return false;
+        PROP_GO(&uc->e, imap_client_new(&uc->c, pool->scheduler, uc->conn), fail);
+        uc->conn = NULL;
+        imap_client_must_await(uc->c, await_c, NULL);
+        uc->c->data = uc;
+    }
+
+    // finish any pending writes
+    ok = advance_writes(uc);
+    if(!ok) return false;
+
+    ONCE(uc->login_sent){
+        PROP_GO(&uc->e, send_login(uc), fail);
+        PROP_GO(&uc->e, send_enable(uc), fail);
+    }
+
+    while(!uc->login_done){
+        ok = advance_reads(uc);
+        if(!ok) return false;
+        PROP_GO(&uc->e, check_resp(uc, &ok, check_login), fail);
+        if(!ok) continue;
+        uc->login_done = true;
+    }
+
+    while(!uc->c->enabled){
+        ok = advance_reads(uc);
+        if(!ok) return false;
+        PROP_GO(&uc->e, check_resp(uc, &ok, check_enable), fail);
+        if(!ok) continue;
+        uc->c->enabled = true;
+    }
+
+    // ready for adoption; just keep the connection alive
+
+    if(uc->noop_due){
+        uc->noop_due = false;
+        PROP_GO(&uc->e, send_noop(uc), fail);
+    }
+
+    while(uc->noop_tag){
+        ok = advance_reads(uc);
+        if(!ok) return false;
+        PROP_GO(&uc->e, check_resp(uc, &ok, check_noop), fail);
+        if(!ok) continue;
+        uc->noop_tag = 0;
+    }
+
+    return false;
+
+fail:
+    // pooled connections are only an optimization
+    if(pool->rejected){
+        LOG_INFO(
+            "upstream rejected pooled login for %x\n", FD_DBG(pool->user)
+        );
+        DROP_VAR(&uc->e);
+    }else{
+        DUMP_DEBUG(uc->e);
+        DROP_VAR(&uc->e);
+    }
+    uc->failed = true;
+
+close:
+    if(uc->connect){
+        ONCE(uc->connect_canceled) uc->connect->cancel(uc->connect);
+        return false;
+    }
+    if(uc->conn){
+        stream_i *s = uc->conn->stream;
+        if(!s->awaited){
+            s->data = uc;
+            s->await(s, await_conn);
+            s->cancel(s);
+            return false;
+        }
+        uc->conn->free(uc->conn);
+        uc->conn = NULL;
+    }
+    if(uc->c){
+        imap_client_cancel(uc->c);
+        if(!uc->c->awaited) return false;
+        imap_client_free(&uc->c);
+    }
+    return true;
+}
+
+// ready means logged in, enabled, and with none of our io in flight
+static bool conn_ready(upool_conn_t *uc){
+    return !uc->failed
+        && !is_error(uc->e)
+        && uc->c
+        && !uc->c->awaited
+        && uc->c->enabled
+        && !uc->noop_tag
+        && !uc->writing
+        && !uc->reading
+        && !uc->resp
+        && link_list_isempty(&uc->cmds);
+}
+
+static void conn_free(upool_conn_t *uc){
+    upool_t *pool = uc->pool;
+    imap_resp_free(uc->resp);
+    link_t *link;
+    while((link = link_list_pop_first(&uc->cmds))){
+        imap_cmd_free(CONTAINER_OF(link, imap_cmd_t, link));
+    }
+    link_remove(&uc->link);
+    pool->nconns--;
+    free(uc);
+}
+
+// c may be NULL, to start a new connection
+static derr_t conn_add(upool_t *pool, imap_client_t *c){
+    derr_t e = E_OK;
+
+    upool_conn_t *uc = DMALLOC_STRUCT_PTR(&e, uc);
+    CHECK(&e);
+
+    *uc = (upool_conn_t){ .pool = pool };
+
+    if(c){
+        uc->c = c;
+        imap_client_must_await(c, await_c, NULL);
+        c->data = uc;
+    }else{
+        PROP_GO(&e,
+            pool->io->connect_imap(pool->io, connect_cb, uc, &uc->connect),
+        fail);
+    }
+
+    link_list_append(&pool->conns, &uc->link);
+    pool->nconns++;
+    schedule(pool);
+
+    return e;
+
+fail:
+    free(uc);
+    return e;
+}
+
+// bring the pool back up to size, if we can
+static void fill(upool_t *pool){
+    while(pool->nconns < pool->cfg.size){
+        derr_t e = conn_add(pool, NULL);
+        CATCH_ANY(&e){
+            DUMP(e);
+            DROP_VAR(&e);
+            return;
+        }
+    }
+}
+
+static void advance_state(upool_t *pool){
+    upool_conn_t *uc, *temp;
+    LINK_FOR_EACH_SAFE(uc, temp, &pool->conns, upool_conn_t, link){
+        if(advance_conn(uc)) conn_free(uc);
+    }
+
+    if(!closing(pool)) return;
+    if(!link_list_isempty(&pool->conns)) return;
+
+    LOG_DEBUG(
+        "closed upstream pool for %x after %x adoptions\n",
+        FD_DBG(pool->user),
+        FU(pool->adopted)
+    );
+
+    hash_elem_remove(&pool->elem);
+    schedulable_cancel(&pool->schedulable);
+    dstr_free(&pool->user);
+    dstr_free0(&pool->pass);
+    free(pool);
+}
+
+// no args are consumed on failure
+derr_t upool_new(
+    scheduler_i *scheduler,
+    citm_io_i *io,
+    citm_pool_cfg_t cfg,
+    dstr_t user,
+    dstr_t pass,
+    hashmap_t *out
+){
+    derr_t e = E_OK;
+
+    upool_t *pool = DMALLOC_STRUCT_PTR(&e, pool);
+    CHECK(&e);
+
+    // success
+
+    time_t now = io->now(io);
+
+    *pool = (upool_t){
+        .scheduler = scheduler,
+        .io = io,
+        .cfg = cfg,
+        .user = user,
+        .pass = pass,
+        .expiry = now + cfg.idle_timeout,
+        .keepalive = now + UPOOL_KEEPALIVE,
+    };
+
+    schedulable_prep(&pool->schedulable, scheduled);
+
+    hash_elem_t *old = hashmap_sets(out, &pool->user, &pool->elem);
+    if(old) LOG_FATAL("upool found existing user %x\n", FD_DBG(pool->user));
+
+    fill(pool);
+
+    return e;
+}
+
+bool upool_check(hash_elem_t *elem, const dstr_t pass){
+    upool_t *pool = CONTAINER_OF(elem, upool_t, elem);
+    if(closing(pool)) return false;
+    return dstr_eq_consttime(&pass, &pool->pass);
+}
+
+bool upool_adopt(hash_elem_t *elem, const dstr_t pass, imap_client_t **c){
+    upool_t *pool = CONTAINER_OF(elem, upool_t, elem);
+
+    if(!upool_check(elem, pass)) return false;
+
+    upool_conn_t *uc;
+    LINK_FOR_EACH(uc, &pool->conns, upool_conn_t, link){
+        if(!conn_ready(uc)) continue;
+
+        imap_client_t *out = STEAL(imap_client_t, &uc->c);
+        imap_client_unawait(out);
+        out->data = NULL;
+
+        // the traded-in client takes the adopted client's place
+        *uc = (upool_conn_t){ .pool = pool, .link = uc->link, .c = *c };
+        imap_client_must_await(uc->c, await_c, NULL);
+        uc->c->data = uc;
+
+        *c = out;
+
+        pool->adopted++;
+        pool->expiry = pool->io->now(pool->io) + pool->cfg.idle_timeout;
+        schedule(pool);
+
+        return true;
+    }
+
+    return false;
+}
+
+void upool_tick(hash_elem_t *elem){
+    upool_t *pool = CONTAINER_OF(elem, upool_t, elem);
+
+    if(closing(pool)) return;
+
+    time_t now = pool->io->now(pool->io);
+
+    if(now >= pool->expiry){
+        pool->expired = true;
+        schedule(pool);
+        return;
+    }
+
+    if(now < pool->keepalive) return;
+    pool->keepalive = now + UPOOL_KEEPALIVE;
+
+    upool_conn_t *uc;
+    LINK_FOR_EACH(uc, &pool->conns, upool_conn_t, link){
+        if(conn_ready(uc)) uc->noop_due = true;
+    }
+
+    // replace any connections we have lost
+    fill(pool);
+
+    schedule(pool);
+}
+
+time_t upool_deadline(hash_elem_t *elem){
+    upool_t *pool = CONTAINER_OF(elem, upool_t, elem);
+    if(closing(pool)) return 0;
+    return MIN(pool->expiry, pool->keepalive);
+}
+
+void upool_cancel(hash_elem_t *elem){
+    upool_t *pool = CONTAINER_OF(elem, upool_t, elem);
+    pool->canceled = true;
+    schedule(pool);
+}
@@ -0,0 +1,40 @@
+/* upool_t: spare upstream connections for one user, already logged in and
+   with CONDSTORE and QRESYNC already ENABLEd.
+
+   citm starts a pool after a user's successful login.  When a later
+   connection for that user presents the same password, anon_t trades its
+   unauthenticated upstream client for one of ours and answers the LOGIN
+   itself, and sc_t skips its ENABLE, saving two round trips before the first
+   SELECT.  The traded-in client is logged in to take the adopted one's place.
+
+   Ready clients are kept alive with a NOOP every UPOOL_KEEPALIVE seconds.  A
+   pool closes itself if nothing is adopted for idle_timeout seconds, or if
+   its LOGIN is rejected (the password probably changed upstream). */
+
+#define UPOOL_KEEPALIVE 120
+
+// no args are consumed on failure
+derr_t upool_new(
+    scheduler_i *scheduler,
+    citm_io_i *io,
+    citm_pool_cfg_t cfg,
+    dstr_t user,
+    dstr_t pass,
+    hashmap_t *out
+);
+
+// constant-time check that pass matches the pool's password
+bool upool_check(hash_elem_t *elem, const dstr_t pass);
+
+/* on success, *c (an unawaited client which is not logged in) is replaced by
+   an unawaited client which is logged in and has c->enabled set */
+bool upool_adopt(hash_elem_t *elem, const dstr_t pass, imap_client_t **c);
+
+// send keepalives, refill, or close after idle_timeout, as needed
+void upool_tick(hash_elem_t *elem);
+
+// the next time upool_tick() should be called, or 0 for never
+time_t upool_deadline(hash_elem_t *elem);
+
+// the pool removes elem from its hashmap after it finishes closing
+void upool_cancel(hash_elem_t *elem);
@@ -226,6 +226,31 @@ static void noop_close_cb(uv_handle_t *handle){
     (void)handle;
 }
 
+static time_t uv_citm_now(citm_io_i *iface){
+    (void)iface;
+    time_t out;
+    derr_t e = dtime(&out);
+    CATCH_ANY(&e){
+        DUMP(e);
+        LOG_FATAL("unable to read clock!\n");
+    }
+    return MAX(out, 0);
+}
+
+static void pool_timer_cb(uv_timer_t *timer){
+    uv_citm_t *uv_citm = timer->data;
+    citm_on_deadline(&uv_citm->citm);
+}
+
+static void uv_citm_deadline(citm_io_i *iface, time_t when){
+    uv_citm_t *uv_citm = CONTAINER_OF(iface, uv_citm_t, iface);
+    // no new deadlines after the timer is closed
+    if(!uv_citm->pool_timer.data) return;
+    time_t now = uv_citm_now(iface);
+    uint64_t delay_ms = when > now ? (uint64_t)(when - now) * 1000 : 0;
+    duv_timer_must_start(&uv_citm->pool_timer, pool_timer_cb, delay_ms);
+}
+
 // returns INVALID_SOCKET on error
 static derr_t bind_addrspec(
     const addrspec_t spec, int type, int proto, compat_socket_t *fdout
@@ -402,6 +427,10 @@ static void onthread_cancel(uv_citm_t *uv_citm){
     FOR_EACH_LINK(uv_citm->stubs) stub_cancel(link);
     // cancel all of citm
     citm_cancel(&uv_citm->citm);
+    if(uv_citm->pool_timer.data){
+        duv_timer_close(&uv_citm->pool_timer, noop_close_cb);
+        uv_citm->pool_timer.data = NULL;
+    }
     // close all of the listeners
     for(size_t i = 0; i < uv_citm->nlisteners; i++){
         citm_listener_free(&uv_citm->listeners[i]);
@@ -535,6 +564,7 @@ derr_t uv_citm(
     int *sockfd,  // for systemd/launchd
     SSL_CTX *client_ctx,
     string_builder_t sm_dir,
+    citm_pool_cfg_t pool_cfg,
     // function pointers, mainly for instrumenting tests:
     void (*indicate_ready)(void*, uv_citm_t*),
     void (*user_async_hook)(void*, uv_citm_t*),
@@ -581,7 +611,11 @@ derr_t uv_citm(
     }
 
     uv_citm = (uv_citm_t){
-        .iface = { .connect_imap = connect_imap },
+        .iface = {
+            .connect_imap = connect_imap,
+            .now = uv_citm_now,
+            .deadline = uv_citm_deadline,
+        },
         .remote = remote,
         .remote_verify_name = dstr_from_off(remote.host),
         .client_sec = client_sec,
@@ -590,10 +624,19 @@ derr_t uv_citm(
         .user_data = user_data,
     };
 
+    if(client_ctx){
+        PROP_GO(&e,
+            duv_tls_session_cache_init(&uv_citm.session_cache, client_ctx),
+        cu);
+    }
+
     PROP_GO(&e, duv_loop_init(&uv_citm.loop), cu);
     uv_citm.loop.data = &uv_citm;
     loop_configured = true;
 
+    duv_timer_must_init(&uv_citm.loop, &uv_citm.pool_timer);
+    uv_citm.pool_timer.data = &uv_citm;
+
     PROP_GO(&e,
         duv_async_init(&uv_citm.loop, &uv_citm.async_cancel, async_cancel),
     cu);
@@ -614,7 +657,8 @@ derr_t uv_citm(
             &uv_citm.citm,
             &uv_citm.iface,
             &uv_citm.scheduler.iface,
-            sb_append(&sm_dir, SBS("citm"))
+            sb_append(&sm_dir, SBS("citm")),
+            pool_cfg
         ),
     cu);
 
@@ -685,6 +729,7 @@ derr_t uv_citm(
             &uv_citm
         ),
     cu);
+    status_server_report_scheduler(&uv_citm.ss, &uv_citm.scheduler);
     LOG_DEBUG("listening on %x\n", FSB(sockpath));
 
     // install signal handlers
@@ -723,6 +768,10 @@ cu:
         duv_async_close(&uv_citm.async_user, noop_close_cb);
         uv_citm.async_user.data = NULL;
     }
+    if(uv_citm.pool_timer.data){
+        duv_timer_close(&uv_citm.pool_timer, noop_close_cb);
+        uv_citm.pool_timer.data = NULL;
+    }
 
     if(loop_configured){
         // uvam, at least, needs to run to close all of its handles
@@ -739,6 +788,16 @@ cu:
     signal(SIGINT, SIG_IGN);
     signal(SIGTERM, SIG_IGN);
 
+    if(uv_citm.session_cache.ctx){
+        duv_tls_session_stats_t stats;
+        stats = duv_tls_session_cache_stats(&uv_citm.session_cache);
+        LOG_INFO(
+            "upstream tls sessions: %x resumed, %x full handshakes\n",
+            FU(stats.hits), FU(stats.misses)
+        );
+    }
+    duv_tls_session_cache_free(&uv_citm.session_cache);
+
     SSL_CTX_free(server_ctx);
     SSL_CTX_free(client_ctx);
 
@@ -17,10 +17,14 @@ struct uv_citm_t {
     addrspec_t remote;
     imap_security_e client_sec;
     SSL_CTX *client_ctx;
+    // shared by upstream imap connections and the acme manager's http
+    duv_tls_session_cache_t session_cache;
     dstr_t remote_verify_name;
     uv_loop_t loop;
     uv_async_t async_cancel;
     uv_async_t async_user;
+    // wakes citm for its upstream connection pools
+    uv_timer_t pool_timer;
     void (*user_async_hook)(void*, uv_citm_t*);
     void *user_data;
     duv_scheduler_t scheduler;
@@ -46,6 +50,7 @@ derr_t uv_citm(
     int *sockfd,  // for systemd/launchd
     SSL_CTX *client_ctx,
     string_builder_t sm_dir,
+    citm_pool_cfg_t pool_cfg,
     // function pointers, mainly for instrumenting tests:
     void (*indicate_ready)(void*, uv_citm_t*),
     void (*user_async_hook)(void*, uv_citm_t*),
@@ -32,6 +32,7 @@ ui_i default_ui_harness(void){
         .ssl_library_close = ssl_library_close,
         .api_token_read_increment_write_path =
             api_token_read_increment_write_path,
+        .api_token_reserve_path = api_token_reserve_path,
         .api_token_free0 = api_token_free0,
         .register_api_token_path_sync = register_api_token_path_sync,
         .api_pass_sync = api_pass_sync,
@@ -795,6 +796,7 @@ static derr_t citm_main(
             &sockfd,
             NULL,  // client_ctx
             sm_dir_path,
+            CITM_POOL_CFG_DEFAULT,
             system ? indicate_ready : NULL,
             NULL, // user_async_hook
             NULL
@@ -811,6 +813,179 @@ cu:
     return e;
 }
 
+// read one line from f, without the line ending; *eof is set at end of input
+static derr_t batch_read_line(FILE *f, dstr_t *line, bool *eof){
+    derr_t e = E_OK;
+
+    line->len = 0;
+    *eof = false;
+
+    DSTR_VAR(buf, 1024);
+    while(true){
+        char *s = fgets(buf.data, (int)buf.size, f);
+        if(!s){
+            if(ferror(f)) ORIG(&e, E_OS, "failed to read from stdin");
+            *eof = true;
+            break;
+        }
+        buf.len = strnlen(buf.data, buf.size);
+        PROP(&e, dstr_append(line, &buf) );
+        if(buf.len && buf.data[buf.len-1] == '\n') break;
+    }
+
+    *line = dstr_rstrip_chars(*line, '\r', '\n');
+
+    return e;
+}
+
+static derr_t batch_error(const char *why){
+    derr_t e = E_OK;
+
+    jdump_i *obj = DOBJ(
+        DKEY("contents", DS(why)),
+        DKEY("status", DS("error")),
+    );
+    PROP(&e, jdump(obj, WF(stdout), 0) );
+    PROP(&e, FFMT(stdout, "\n") );
+
+    return e;
+}
+
+/* Batch mode reads newline-delimited json commands from stdin, like:
+
+       {"command": "delete_alias", "arg": "abc@splintermail.com"}
+
+   and writes each response from the server on its own line of stdout, in the
+   same order.  Every call reuses the same http connection, and nonces are
+   reserved in blocks, so the token file is rarely written.
+
+   Calls are made one at a time, since the server rejects any nonce which
+   arrives after a larger one.  Commands which need a password or a typed
+   confirmation are refused, since stdin belongs to the batch. */
+static derr_t api_batch_main(
+    const ui_i ui,
+    http_sync_t *sync,
+    const dstr_t baseurl,
+    const string_builder_t *creds_path,
+    api_token_t *token,
+    int *retval
+){
+    derr_t e = E_OK;
+
+    dstr_t line = {0};
+    dstr_t apipath = {0};
+    json_t cmd = {0};
+    json_t json = {0};
+    json_prep(&cmd);
+    json_prep(&json);
+
+    // the read/increment/write of the token file reserved token->nonce
+    nonce_reserver_t nonces = {
+        .loaded = true, .next = token->nonce, .reserved = token->nonce
+    };
+
+    bool any_failed = false;
+
+    while(true){
+        bool eof;
+        PROP_GO(&e, batch_read_line(stdin, &line, &eof), cu);
+        dstr_t stripped = dstr_strip_chars(line, ' ', '\t');
+        if(!stripped.len){
+            if(eof) break;
+            continue;
+        }
+
+        // parse the command
+        json_free(&cmd);
+        derr_t e2 = json_parse(stripped, &cmd);
+        CATCH(&e2, E_PARAM){
+            DROP_VAR(&e2);
+            PROP_GO(&e, batch_error("invalid json"), cu);
+            any_failed = true;
+            goto next;
+        }else PROP_VAR_GO(&e, &e2, cu);
+
+        dstr_t command;
+        dstr_t arg = {0};
+        bool ok, arg_ok;
+        jspec_t *jspec = JOBJ(false,
+            JKEYOPT("arg", &arg_ok, JDREF(&arg)),
+            JKEY("command", JDREF(&command)),
+        );
+        PROP_GO(&e, jspec_read_ex(jspec, cmd.root, &ok, NULL), cu);
+        if(!ok){
+            PROP_GO(&e,
+                batch_error("expected {\"command\": ..., \"arg\": ...}"),
+            cu);
+            any_failed = true;
+            goto next;
+        }
+
+        bool refused = false
+            || dstr_eq(command, DSTR_LIT("add_device"))
+            || dstr_eq(command, DSTR_LIT("add_token"))
+            || dstr_eq(command, DSTR_LIT("batch"))
+            || dstr_eq(command, DSTR_LIT("change_password"))
+            || dstr_eq(command, DSTR_LIT("delete_account"))
+            || dstr_eq(command, DSTR_LIT("delete_all_mail"))
+            || dstr_eq(command, DSTR_LIT("delete_all_aliases"));
+        if(refused){
+            PROP_GO(&e, batch_error("command not allowed in batch mode"), cu);
+            any_failed = true;
+            goto next;
+        }
+
+        // make the call
+        apipath.len = 0;
+        PROP_GO(&e, FMT(&apipath, "/api/%x", FD(command)), cu);
+        PROP_GO(&e, ui.api_token_reserve_path(&nonces, creds_path, token), cu);
+        json_free(&json);
+        e2 = ui.api_token_sync(sync, baseurl, apipath, arg, *token, &json);
+        CATCH(&e2, E_TOKEN){
+            FFMT_QUIET(stderr,
+                "API Token rejected, deleting token.  Run any account "
+                "command to generate a new token.\n"
+            );
+            LOG_DEBUG("%x", FD(e2.msg));
+            DROP_VAR(&e2);
+            DROP_CMD( dunlink_path(creds_path) );
+            *retval = 9;
+            goto cu;
+        }else CATCH(&e2, E_NOMEM){
+            PROP_VAR_GO(&e, &e2, cu);
+        }else CATCH_ANY(&e2){
+            // other failures only affect this command
+            LOG_DEBUG("%x", FD(e2.msg));
+            DROP_VAR(&e2);
+            PROP_GO(&e, batch_error("REST API call failed"), cu);
+            any_failed = true;
+            goto next;
+        }
+
+        // pass the server's response through as-is
+        PROP_GO(&e, json_fdump_line(json.root, stdout), cu);
+
+        dstr_t status;
+        jspec = JOBJ(true, JKEY("status", JDREF(&status)));
+        PROP_GO(&e, jspec_read_ex(jspec, json.root, &ok, NULL), cu);
+        if(!ok || !dstr_eq(status, DSTR_LIT("success"))) any_failed = true;
+
+    next:
+        // let whoever is reading see each result as it happens
+        fflush(stdout);
+        if(eof) break;
+    }
+
+    *retval = any_failed ? 14 : 0;
+
+cu:
+    json_free(&json);
+    json_free(&cmd);
+    dstr_free(&apipath);
+    dstr_free(&line);
+    return e;
+}
+
 static derr_t api_command_main(
     const ui_i ui,
     const opt_spec_t o_account_dir,
@@ -956,6 +1131,22 @@ static derr_t api_command_main(
         apiarg = dstr_from_cstr(argv[2]);
     }
 
+    // batch mode can't prompt for anything, so it needs an existing token
+    if(dstr_eq(command, DSTR_LIT("batch"))){
+        if(!creds_found){
+            FFMT_QUIET(stderr,
+                "batch mode requires an API token; run any other account "
+                "command first to register one\n"
+            );
+            *retval = 18;
+            goto cu;
+        }
+        PROP_GO(&e,
+            api_batch_main(ui, &sync, baseurl, &creds_path, &token, retval),
+        cu);
+        goto cu;
+    }
+
     // list of commands requiring special handling
     DSTR_STATIC(add_device, "add_device");
     DSTR_STATIC(add_token, "add_token");
@@ -1476,6 +1667,9 @@ int do_main(const ui_i ui, int argc, char* argv[], bool windows_service){
             logger_add_filename(log_level, logfile_path.data);
         }
 
+        // keep log output, especially --debug, off of the event loop thread
+        PROP_GO(&e, logger_start_async(0), cu);
+
         PROP_GO(&e,
             citm_main(
                 ui,
@@ -1537,6 +1731,9 @@ fail:
         }
     }
 
+    // write out any async log output, before logfile_path is freed
+    logger_stop_async();
+
     // free memory after DUMP, since logfile_path will be read during DUMP
     dstr_free(&config_text);
     dstr_free(&logfile_path);
@@ -40,6 +40,9 @@ typedef struct {
     derr_t (*api_token_read_increment_write_path)(
         const string_builder_t *sb, api_token_t *token, bool *ok
     );
+    derr_t (*api_token_reserve_path)(
+        nonce_reserver_t *r, const string_builder_t *sb, api_token_t *token
+    );
     void (*api_token_free0)(api_token_t *token);
     derr_t (*register_api_token_path_sync)(
         http_sync_t *sync,
@@ -94,6 +97,7 @@ typedef struct {
         int *sockfd,
         SSL_CTX *client_ctx,
         string_builder_t sm_dir,
+        citm_pool_cfg_t pool_cfg,
         void (*indicate_ready)(void*, uv_citm_t*),
         void (*user_async_hook)(void*, uv_citm_t*),
         void *user_data
@@ -820,6 +820,36 @@ cleanup:
     return e;
 }
 
+// the length of bin2b64_stream's output for n bytes with force_end=true
+static size_t b64_stream_len(size_t n){
+    size_t out = (n / B64_CHUNK) * (B64_WIDTH + 1);
+    size_t rem = n % B64_CHUNK;
+    if(rem) out += (rem + 2) / 3 * 4 + 1;
+    return out;
+}
+
+derr_t encrypter_predict_len(
+    const encrypter_t* ec, size_t plain_len, size_t *out
+){
+    derr_t e = E_OK;
+
+    *out = 0;
+
+    // GCM is a stream mode: ciphertext is exactly as long as the plaintext
+    if(ec->block_size != 1){
+        ORIG(&e, E_INTERNAL, "can't predict length of a block cipher");
+    }
+
+    // the message body, plus whatever is leftover in pre64 from the header
+    *out += b64_stream_len(ec->pre64.len + plain_len);
+    // the "=<base64 tag>\n" line
+    *out += 1 + (CIPHER_TAG_LEN + 2) / 3 * 4 + 1;
+    // the footer line
+    *out += pem_footer.len + 1;
+
+    return e;
+}
+
 derr_t decrypter_new(decrypter_t* dc){
     derr_t e = E_OK;
     // we can't allocate this until we recieve the key pair
@@ -121,6 +121,13 @@ derr_t encrypter_start(encrypter_t* ec, link_t *keys, dstr_t* out);
 derr_t encrypter_update(encrypter_t* ec, const dstr_t *in, dstr_t* out);
 derr_t encrypter_update_stream(encrypter_t* ec, dstr_t* in, dstr_t* out);
 derr_t encrypter_finish(encrypter_t* ec, dstr_t* out);
+/* after encrypter_start, the exact number of bytes which the remaining calls
+   to encrypter_update and encrypter_finish will write for plain_len bytes of
+   input, so a message can be streamed somewhere which needs its length up
+   front (like an IMAP literal) */
+derr_t encrypter_predict_len(
+    const encrypter_t* ec, size_t plain_len, size_t *out
+);
 
 derr_t decrypter_new(decrypter_t* dc);
 /* throws: E_INTERNAL
@@ -0,0 +1,241 @@
+#include "libdstr/libdstr.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+/* Compares the two ways of reading json into a jspec: json_parse() followed
+   by jspec_read_ex(), and jspec_parse_ex(), which reads static jspecs
+   straight from the text.  The payloads are shaped like the ACME replies
+   that libacme reads with the same jspecs.
+
+   usage: bench_jspec [NCALLS] */
+
+typedef enum {
+    ACME_PENDING,
+    ACME_READY,
+    ACME_PROCESSING,
+    ACME_VALID,
+    ACME_INVALID,
+} bench_status_e;
+
+typedef struct {
+    jspec_t jspec;
+    bench_status_e *out;
+} jspec_status_t;
+DEF_CONTAINER_OF(jspec_status_t, jspec, jspec_t)
+
+// like libacme's JASTAT, a custom scalar reader
+static derr_t jspec_status_read(jspec_t *jspec, jctx_t *ctx){
+    derr_t e = E_OK;
+    jspec_status_t *j = CONTAINER_OF(jspec, jspec_status_t, jspec);
+
+    if(!jctx_require_type(ctx, JSON_STRING)) return e;
+    dstr_t status = jctx_text(ctx);
+
+    #define CASE(NAME) if(dstr_ieq(status, DSTR_LIT(#NAME))){ \
+        *j->out = ACME_ ## NAME; \
+        return e; \
+    }
+    CASE(PENDING)
+    CASE(READY)
+    CASE(PROCESSING)
+    CASE(VALID)
+    CASE(INVALID)
+    #undef CASE
+
+    jctx_error(ctx, "unrecognized status: \"%x\"\n", FD(status));
+    return e;
+}
+
+#define JSTAT(_out) \
+    &((jspec_status_t){ { jspec_status_read, true }, _out }.jspec)
+
+DSTR_STATIC(order_text,
+    "{\n"
+    "  \"status\": \"pending\",\n"
+    "  \"expires\": \"2026-10-25T18:32:11Z\",\n"
+    "  \"identifiers\": [\n"
+    "    {\n"
+    "      \"type\": \"dns\",\n"
+    "      \"value\": \"0123456789abcdef.user.splintermail.com\"\n"
+    "    }\n"
+    "  ],\n"
+    "  \"authorizations\": [\n"
+    "    \"https://acme-v02.api.letsencrypt.org/acme/authz-v3/1234567890\"\n"
+    "  ],\n"
+    "  \"finalize\": \"https://acme-v02.api.letsencrypt.org/acme/"
+        "finalize/123456789/9876543210\"\n"
+    "}"
+);
+
+DSTR_STATIC(directory_text,
+    "{\n"
+    "  \"MHyFDcR3xvY\": \"https://community.letsencrypt.org/t/"
+        "adding-random-entries-to-the-directory/33417\",\n"
+    "  \"keyChange\": \"https://acme-v02.api.letsencrypt.org/acme/"
+        "key-change\",\n"
+    "  \"meta\": {\n"
+    "    \"caaIdentities\": [\n"
+    "      \"letsencrypt.org\"\n"
+    "    ],\n"
+    "    \"termsOfService\": \"https://letsencrypt.org/documents/"
+        "LE-SA-v1.3-September-21-2022.pdf\",\n"
+    "    \"website\": \"https://letsencrypt.org\"\n"
+    "  },\n"
+    "  \"newAccount\": \"https://acme-v02.api.letsencrypt.org/acme/"
+        "new-acct\",\n"
+    "  \"newNonce\": \"https://acme-v02.api.letsencrypt.org/acme/"
+        "new-nonce\",\n"
+    "  \"newOrder\": \"https://acme-v02.api.letsencrypt.org/acme/"
+        "new-order\",\n"
+    "  \"renewalInfo\": \"https://acme-v02.api.letsencrypt.org/draft-ietf-"
+        "acme-ari-03/renewalInfo\",\n"
+    "  \"revokeCert\": \"https://acme-v02.api.letsencrypt.org/acme/"
+        "revoke-cert\"\n"
+    "}"
+);
+
+DSTR_STATIC(reply_text,
+    "{\n"
+    "  \"type\": \"urn:ietf:params:acme:error:badNonce\",\n"
+    "  \"detail\": \"JWS has an invalid anti-replay nonce: "
+        "\\\"AAEC0bGZ8xYzsQnrs6GKY2Vh7e-KZBoKGKCpzVc3PLgGbIw\\\"\",\n"
+    "  \"status\": 400\n"
+    "}"
+);
+
+// read one payload, either through a json_t or straight from the text
+static derr_t read_jspec(jspec_t *jspec, const dstr_t text, bool scan){
+    derr_t e = E_OK;
+
+    // like libacme's error bodies, a small preallocated json_t
+    json_t json;
+    JSON_PREP_PREALLOCATED(json, 1024, 64, true);
+
+    bool ok;
+    if(scan){
+        PROP(&e, jspec_parse_ex(jspec, text, &json, &ok, NULL) );
+    }else{
+        PROP(&e, json_parse(text, &json) );
+        PROP(&e, jspec_read_ex(jspec, json.root, &ok, NULL) );
+    }
+    if(!ok) ORIG(&e, E_VALUE, "payload did not match its jspec");
+
+    return e;
+}
+
+// jspecs are built fresh for each read, since JKEYs remember what they found
+
+static derr_t read_order(const dstr_t text, bool scan){
+    derr_t e = E_OK;
+
+    dstr_t authorization, certificate, error, expires, finalize, domain;
+    bench_status_e status;
+    bool have_cert, have_error, have_expires;
+    jspec_t *jspec = JOBJ(true,
+        JKEY("authorizations", JTUP(
+            JDREF(&authorization),
+        )),
+        JKEYOPT("certificate", &have_cert, JDREF(&certificate)),
+        JKEYOPT("error", &have_error, JDREF(&error)),
+        JKEYOPT("expires", &have_expires, JDREF(&expires)),
+        JKEY("finalize", JDREF(&finalize)),
+        JKEY("identifiers", JTUP(
+            JOBJ(true,
+                JKEY("type", JXSN("dns", 3)),
+                JKEY("value", JDREF(&domain)),
+            )
+        )),
+        JKEY("status", JSTAT(&status)),
+    );
+
+    PROP(&e, read_jspec(jspec, text, scan) );
+
+    return e;
+}
+
+static derr_t read_directory(const dstr_t text, bool scan){
+    derr_t e = E_OK;
+
+    dstr_t key_change, terms, new_account, new_nonce, new_order, revoke_cert;
+    jspec_t *jspec = JOBJ(true,
+        JKEY("keyChange", JDREF(&key_change)),
+        JKEY("meta", JOBJ(true,
+            JKEY("termsOfService", JDREF(&terms)),
+        )),
+        JKEY("newAccount", JDREF(&new_account)),
+        JKEY("newNonce", JDREF(&new_nonce)),
+        JKEY("newOrder", JDREF(&new_order)),
+        JKEY("revokeCert", JDREF(&revoke_cert)),
+    );
+
+    PROP(&e, read_jspec(jspec, text, scan) );
+
+    return e;
+}
+
+static derr_t read_reply(const dstr_t text, bool scan){
+    derr_t e = E_OK;
+
+    dstr_t type;
+    jspec_t *jspec = JOBJ(true,
+        JKEY("type", JDREF(&type)),
+    );
+
+    PROP(&e, read_jspec(jspec, text, scan) );
+
+    return e;
+}
+
+typedef derr_t (*read_f)(const dstr_t text, bool scan);
+
+static derr_t bench(
+    const char *name, read_f fn, const dstr_t text, size_t ncalls
+){
+    derr_t e = E_OK;
+
+    double secs[2];
+    for(int scan = 0; scan < 2; scan++){
+        clock_t start = clock();
+        for(size_t i = 0; i < ncalls; i++){
+            PROP(&e, fn(text, scan != 0) );
+        }
+        secs[scan] = (double)(clock() - start) / CLOCKS_PER_SEC;
+    }
+
+    for(int scan = 0; scan < 2; scan++){
+        double mbps = (double)(text.len * ncalls) / secs[scan] / 1e6;
+        printf(
+            "%-9s %-5s calls=%zu time=%.3fs rate=%.2fM calls/s %.1f MB/s\n",
+            name,
+            scan ? "scan" : "tree",
+            ncalls,
+            secs[scan],
+            (double)ncalls / secs[scan] / 1e6,
+            mbps
+        );
+    }
+    printf("%-9s speedup=%.2fx\n", name, secs[0] / secs[1]);
+
+    return e;
+}
+
+int main(int argc, char **argv){
+    derr_t e = E_OK;
+
+    size_t ncalls = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+
+    logger_add_fileptr(LOG_LVL_INFO, stderr);
+
+    PROP_GO(&e, bench("order", read_order, order_text, ncalls), cu);
+    PROP_GO(&e, bench("directory", read_directory, directory_text, ncalls), cu);
+    PROP_GO(&e, bench("error", read_reply, reply_text, ncalls), cu);
+
+cu:
+    if(is_error(e)){
+        DUMP(e);
+        DROP_VAR(&e);
+        return 1;
+    }
+    return 0;
+}
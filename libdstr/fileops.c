@@ -1351,6 +1351,38 @@ derr_t dffsync(FILE *f){
     return e;
 }
 
+derr_t dfsync_parent(const char *path){
+    derr_t e = E_OK;
+
+#ifndef _WIN32
+    DSTR_VAR(stack, 256);
+    dstr_t heap = {0};
+    int fd = -1;
+
+    // null-terminate the dirname
+    dstr_t dir = ddirname(dstr_from_cstr((char*)path));
+    const char *dirpath;
+    derr_type_t etype = FMT_QUIET(&stack, "%x", FD(dir));
+    if(etype == E_NONE){
+        dirpath = stack.data;
+    }else{
+        PROP_GO(&e, FMT(&heap, "%x", FD(dir)), cu);
+        dirpath = heap.data;
+    }
+
+    PROP_GO(&e, dopen(dirpath, O_RDONLY, 0, &fd), cu);
+    PROP_GO(&e, dfsync(fd), cu);
+
+cu:
+    if(fd > -1) compat_close(fd);
+    dstr_free(&heap);
+#else
+    (void)path;
+#endif
+
+    return e;
+}
+
 derr_t dfseek(FILE *f, long offset, int whence){
     derr_t e = E_OK;
 
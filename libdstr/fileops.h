@@ -166,6 +166,9 @@ derr_t dopen_path(const string_builder_t *sb, int flags, int mode, int *out);
 derr_t dfsync(int fd);
 // combines fflush and fsync
 derr_t dffsync(FILE *f);
+/* fsync the directory containing path, so a rename into it is durable.
+   A noop on windows, where directories can't be fsync'd. */
+derr_t dfsync_parent(const char *path);
 
 derr_t dfseek(FILE *f, long offset, int whence);
 
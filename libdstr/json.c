@@ -90,6 +90,8 @@ typedef enum {
     A2, A3, A4,
     // for done
     JSON_DONE,
+    // discarding an unwanted object value
+    SKIP,
 } parse_state_t;
 
 static inline int is_hex(char c){
@@ -237,6 +239,8 @@ static derr_t copy_char(json_parser_t *p, char c){
             base = block->text;
         }
         p->token_base = base;
+        // the block may already hold text from an earlier parse
+        p->token_start = base->len;
     }
 
     // prepare room for this char
@@ -364,6 +368,8 @@ static derr_t jopen(json_parser_t *p, json_type_e type, char c){
     new->parent = parent;
     new->type = type;
 
+    // remember the previous key in case this key is skipped
+    if(parent && parent->type == JSON_OBJECT) p->key_prev = prev;
     // if we are the parent's first child, modify parent
     if(parent && !parent->child) parent->child = new;
     // if we're in a sequence, modify prev
@@ -456,6 +462,41 @@ static void jclose(json_parser_t *p){
 }
 
 
+/* drop the key we just finished and skip its value, which is cheap because
+   the key is always the most recent node and the most recent text */
+static void skip_start(json_parser_t *p){
+    json_node_t *key = p->parent;
+    json_node_t *obj = key->parent;
+
+    // unlink the key from its object
+    if(p->key_prev) p->key_prev->next = NULL;
+    else obj->child = NULL;
+
+    // give back the key's node
+    link_t *link = p->json->node_blocks.prev;
+    json_node_block_t *block = CONTAINER_OF(link, json_node_block_t, link);
+    block->len--;
+
+    // give back the key's text
+    if(p->token_base){
+        p->token_base->len -= key->text.len;
+        p->token_start = p->token_base->len;
+    }
+
+    p->parent = obj;
+    p->skip_depth = 0;
+    p->skip_str = false;
+    p->skip_esc = false;
+    p->state = SKIP;
+}
+
+// after skipping a value, it's as if we just finished the previous value
+static void skip_finish(json_parser_t *p){
+    p->prev = p->key_prev;
+    p->ptr = p->parent;
+    p->state = O5;
+}
+
 static derr_t parse_char(
     json_parser_t *p, char c, unsigned char u, const dstr_t chunk, size_t i
 ){
@@ -691,8 +732,12 @@ reparse:
             else UNEXPECTED;
             break;
         case O3:
-            if(c == ':') p->state = O4;
-            else if(is_whitespace(c)){}
+            if(c == ':'){
+                p->state = O4;
+                if(p->skip && p->skip(p->parent, p->skip_data)){
+                    skip_start(p);
+                }
+            }else if(is_whitespace(c)){}
             else UNEXPECTED;
             break;
         // state O4 is identical to state V1
@@ -721,6 +766,23 @@ reparse:
         case JSON_DONE:
             if(!is_whitespace(c)) UNEXPECTED;
             break;
+        case SKIP:
+            if(p->skip_str){
+                if(p->skip_esc) p->skip_esc = false;
+                else if(c == '\\') p->skip_esc = true;
+                else if(c == '"') p->skip_str = false;
+            }else if(c == '"'){
+                p->skip_str = true;
+            }else if(c == '{' || c == '['){
+                p->skip_depth++;
+            }else if(p->skip_depth){
+                if(c == '}' || c == ']') p->skip_depth--;
+            }else if(c == ',' || c == '}' || c == ']'){
+                // the end of the skipped value
+                skip_finish(p);
+                goto reparse;
+            }
+            break;
     }
 
     #undef UNEXPECTED
@@ -844,6 +906,25 @@ derr_t json_parse_finish(json_parser_t *p){
     return e;
 }
 
+derr_t json_string_decode(json_t *json, const dstr_t raw, dstr_t *out){
+    derr_t e = E_OK;
+
+    *out = (dstr_t){0};
+
+    // run just the string states of the parser, on a node of our own
+    json_node_t node = { .type = JSON_STRING };
+    json_parser_t p = { .json = json, .state = S2, .ptr = &node };
+    PROP(&e, json_parse_chunk(&p, raw) );
+    PROP(&e, json_parse_chunk(&p, DSTR_LIT("\"")) );
+    if(p.state != JSON_DONE){
+        ORIG(&e, E_PARAM, "incomplete json string");
+    }
+
+    *out = node.text;
+
+    return e;
+}
+
 derr_t json_parse(const dstr_t in, json_t *out){
     derr_t e = E_OK;
 
@@ -1133,6 +1214,8 @@ static derr_t findent(FILE *f, size_t depth){
 typedef struct {
     size_t depth;
     bool comma;
+    // all on one line, with no indentation
+    bool compact;
     FILE *f;
 } fdump_visit_t;
 
@@ -1143,13 +1226,14 @@ static derr_t fdump_visit(
 
     fdump_visit_t *v = (fdump_visit_t*)data;
     FILE *f = v->f;
+    char *nl = v->compact ? "" : "\n";
 
     if(closing){
         if(!node->child) return e;
         v->depth--;
     }
 
-    PROP(&e, findent(f, 2 * v->depth) );
+    if(!v->compact) PROP(&e, findent(f, 2 * v->depth) );
 
     bool need_comma = false;
     /* use depth to infer if we have a parent, rather than checking directly,
@@ -1164,10 +1248,10 @@ static derr_t fdump_visit(
     if(closing){
         switch(node->type){
             case JSON_ARRAY:
-                PROP(&e, FFMT(f, "]%x\n", FS(comma)) );
+                PROP(&e, FFMT(f, "]%x%x", FS(comma), FS(nl)) );
                 return e;
             case JSON_OBJECT:
-                PROP(&e, FFMT(f, "}%x\n", FS(comma)) );
+                PROP(&e, FFMT(f, "}%x%x", FS(comma), FS(nl)) );
                 return e;
 
             case JSON_TRUE:
@@ -1180,45 +1264,51 @@ static derr_t fdump_visit(
     }
 
     if(key){
-        PROP(&e, FFMT(f, "\"%x\": ", FD_JSON(*key)) );
+        char *sep = v->compact ? ":" : ": ";
+        PROP(&e, FFMT(f, "\"%x\"%x", FD_JSON(*key), FS(sep)) );
     }
 
     switch(node->type){
         case JSON_TRUE:
-            PROP(&e, FFMT(f, "true%x\n", FS(comma)) );
+            PROP(&e, FFMT(f, "true%x%x", FS(comma), FS(nl)) );
             break;
         case JSON_FALSE:
-            PROP(&e, FFMT(f, "false%x\n", FS(comma)) );
+            PROP(&e, FFMT(f, "false%x%x", FS(comma), FS(nl)) );
             break;
         case JSON_NULL:
-            PROP(&e, FFMT(f, "null%x\n", FS(comma)) );
+            PROP(&e, FFMT(f, "null%x%x", FS(comma), FS(nl)) );
             break;
 
         case JSON_NUMBER:
-            PROP(&e, FFMT(f, "%x%x\n", FD(node->text), FS(comma)) );
+            PROP(&e, FFMT(f, "%x%x%x", FD(node->text), FS(comma), FS(nl)) );
             break;
 
         case JSON_STRING:
             PROP(&e,
-                FFMT(f, "\"%x\"%x\n", FD_JSON(node->text), FS(comma))
+                FFMT(f,
+                    "\"%x\"%x%x",
+                    FD_JSON(node->text),
+                    FS(comma),
+                    FS(nl)
+                )
             );
             break;
 
         case JSON_OBJECT:
             if(!node->child){
-                PROP(&e, FFMT(f, "{}%x\n", FS(comma)) );
+                PROP(&e, FFMT(f, "{}%x%x", FS(comma), FS(nl)) );
                 return e;
             }
-            PROP(&e, FFMT(f, "{\n") );
+            PROP(&e, FFMT(f, "{%x", FS(nl)) );
             v->depth++;
             break;
 
         case JSON_ARRAY:
             if(!node->child){
-                PROP(&e, FFMT(f, "[]%x\n", FS(comma)) );
+                PROP(&e, FFMT(f, "[]%x%x", FS(comma), FS(nl)) );
                 return e;
             }
-            PROP(&e, FFMT(f, "[\n") );
+            PROP(&e, FFMT(f, "[%x", FS(nl)) );
             v->depth++;
             break;
     }
@@ -1234,3 +1324,13 @@ derr_t json_fdump(json_ptr_t ptr, FILE *f){
 
     return e;
 }
+
+derr_t json_fdump_line(json_ptr_t ptr, FILE *f){
+    derr_t e = E_OK;
+
+    fdump_visit_t v = { .compact = true, .f = f };
+    PROP(&e, json_walk(ptr, fdump_visit, &v) );
+    PROP(&e, FFMT(f, "\n") );
+
+    return e;
+}
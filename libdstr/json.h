@@ -74,6 +74,10 @@ void json_prep_preallocated(
 
 void json_free(json_t *json);
 
+/* a json_skip_f is called for each object key as it is parsed, before its
+   value; returning true drops both the key and its value from the json_t */
+typedef bool (*json_skip_f)(const json_node_t *key, void *data);
+
 typedef struct {
     json_t *json;
     unsigned char state;
@@ -94,9 +98,19 @@ typedef struct {
     dstr_t *token_base;
     // the start position of our current token
     size_t token_start;
+    // the key before the current key, in case we skip the current key
+    json_node_t *key_prev;
+    // optional, set skip after json_parser() to drop unwanted subtrees
+    json_skip_f skip;
+    void *skip_data;
+    // skipped values are only checked for balanced brackets and strings
+    size_t skip_depth;
+    bool skip_str;
+    bool skip_esc;
 } json_parser_t;
 
-// if you need to read from a stream of chunks
+/* if you need to read from a stream of chunks; memory use grows with the
+   nodes and text that are kept, not with the chunks that are passed in */
 json_parser_t json_parser(json_t *json);
 derr_t json_parse_chunk(json_parser_t *p, const dstr_t chunk);
 derr_t json_parse_finish(json_parser_t *p);
@@ -104,6 +118,10 @@ derr_t json_parse_finish(json_parser_t *p);
 // if you have the whole json string in memory you don't need a json_parser_t
 derr_t json_parse(const dstr_t in, json_t *out);
 
+/* decode the inside of a json string (without the quotes) into the text
+   blocks of a json_t; out points into json afterwards */
+derr_t json_string_decode(json_t *json, const dstr_t raw, dstr_t *out);
+
 derr_type_t json_encode_unlocked(const char *utf8, size_t n, writer_i *out);
 derr_type_t json_encode_quiet(const dstr_t utf8, writer_i *out);
 derr_t json_encode(const dstr_t utf8, writer_i *out);
@@ -141,3 +159,5 @@ derr_t json_walk(
 );
 
 derr_t json_fdump(json_ptr_t ptr, FILE *f);
+// compact json on a single line, for line-delimited output
+derr_t json_fdump_line(json_ptr_t ptr, FILE *f);
@@ -182,13 +182,7 @@ static int cmpkeys(const void *va, const void *vb){
     return dstr_cmp2(*a, *b);
 }
 
-derr_t jspec_object_read(jspec_t *jspec, jctx_t *ctx){
-    derr_t e = E_OK;
-
-    if(!jctx_require_type(ctx, JSON_OBJECT)) return e;
-
-    jspec_object_t *j = CONTAINER_OF(jspec, jspec_object_t, jspec);
-
+static void object_check_sorted(jspec_object_t *j){
 #ifdef BUILD_DEBUG
     // check that keys are pre-sorted, or bsearch will fail
     if(j->nkeys){
@@ -204,7 +198,34 @@ derr_t jspec_object_read(jspec_t *jspec, jctx_t *ctx){
             prev = key;
         }
     }
+#else
+    (void)j;
 #endif
+}
+
+static void object_check_required(jspec_object_t *j, jctx_t *ctx){
+    for(size_t i = 0; i < j->nkeys; i++){
+        _jkey_t *jkey = &j->keys[i];
+        if(!jkey->found){
+            if(jkey->present){
+                *jkey->present = false;
+            }else{
+                jctx_error(ctx,
+                    "missing required key: \"%x\"\n", FD(jkey->key)
+                );
+            }
+        }
+    }
+}
+
+derr_t jspec_object_read(jspec_t *jspec, jctx_t *ctx){
+    derr_t e = E_OK;
+
+    if(!jctx_require_type(ctx, JSON_OBJECT)) return e;
+
+    jspec_object_t *j = CONTAINER_OF(jspec, jspec_object_t, jspec);
+
+    object_check_sorted(j);
 
     for(json_node_t *key = ctx->node->child; key; key = key->next){
         dstr_t keytext = key->text;
@@ -237,18 +258,7 @@ derr_t jspec_object_read(jspec_t *jspec, jctx_t *ctx){
     }
 
     // check that all required keys were found
-    for(size_t i = 0; i < j->nkeys; i++){
-        _jkey_t *jkey = &j->keys[i];
-        if(!jkey->found){
-            if(jkey->present){
-                *jkey->present = false;
-            }else{
-                jctx_error(ctx,
-                    "missing required key: \"%x\"\n", FD(jkey->key)
-                );
-            }
-        }
-    }
+    object_check_required(j, ctx);
 
     return e;
 }
@@ -287,6 +297,39 @@ derr_t jspec_optional_read(jspec_t *jspec, jctx_t *ctx){
     return e;
 }
 
+// the JOBJ a spec refers to, seeing through JOPT, or NULL if it isn't one
+static jspec_object_t *as_jobj(jspec_t *jspec){
+    if(!jspec) return NULL;
+    if(jspec->read == jspec_optional_read){
+        jspec = CONTAINER_OF(jspec, jspec_optional_t, jspec)->subspec;
+    }
+    if(jspec->read != jspec_object_read) return NULL;
+    return CONTAINER_OF(jspec, jspec_object_t, jspec);
+}
+
+static _jkey_t *find_jkey(jspec_object_t *j, const dstr_t *key){
+    return bsearch(key, j->keys, j->nkeys, sizeof(*j->keys), cmpkeys);
+}
+
+// find the jspec for a node, or NULL if we can't tell (like inside arrays)
+static jspec_t *jspec_for_node(jspec_t *root, const json_node_t *node){
+    if(!node->parent) return root;
+    const json_node_t *key = node->parent;
+    // only object values can be resolved, not array items
+    if(key->type != JSON_STRING) return NULL;
+    jspec_object_t *j = as_jobj(jspec_for_node(root, key->parent));
+    if(!j) return NULL;
+    _jkey_t *match = find_jkey(j, &key->text);
+    return match ? match->value : NULL;
+}
+
+bool jspec_skip_unrequested(const json_node_t *key, void *data){
+    jspec_object_t *j = as_jobj(jspec_for_node(data, key->parent));
+    // without allow_extras, keep the key so jspec_read can complain about it
+    if(!j || !j->allow_extras) return false;
+    return !find_jkey(j, &key->text);
+}
+
 derr_t jspec_tuple_read(jspec_t *jspec, jctx_t *ctx){
     derr_t e = E_OK;
 
@@ -410,3 +453,416 @@ derr_t jspec_xstrn_read(jspec_t *jspec, jctx_t *ctx){
     return e;
 }
 
+// jspec_parse: reading json text directly, without a json_t //
+
+typedef struct {
+    const dstr_t *in;
+    size_t pos;
+    // only for strings with escapes, which can't just reference *in
+    json_t *json;
+} jscan_t;
+
+static bool scannable(jspec_t *jspec){
+    if(jspec->scalar) return true;
+    if(jspec->read == jspec_object_read){
+        jspec_object_t *j = CONTAINER_OF(jspec, jspec_object_t, jspec);
+        for(size_t i = 0; i < j->nkeys; i++){
+            if(!scannable(j->keys[i].value)) return false;
+        }
+        return true;
+    }
+    if(jspec->read == jspec_tuple_read){
+        jspec_tuple_t *j = CONTAINER_OF(jspec, jspec_tuple_t, jspec);
+        for(size_t i = 0; i < j->nitems; i++){
+            if(!scannable(j->items[i])) return false;
+        }
+        return true;
+    }
+    if(jspec->read == jspec_optional_read){
+        return scannable(CONTAINER_OF(jspec, jspec_optional_t, jspec)->subspec);
+    }
+    // anything else might want to walk json_node_t's
+    return false;
+}
+
+static bool scan_is_whitespace(char c){
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// skip whitespace and return the next char, or '\0' at the end of input
+static char scan_peek(jscan_t *s){
+    while(s->pos < s->in->len && scan_is_whitespace(s->in->data[s->pos])){
+        s->pos++;
+    }
+    return s->pos < s->in->len ? s->in->data[s->pos] : '\0';
+}
+
+static derr_t scan_unexpected(jscan_t *s){
+    derr_t e = E_OK;
+
+    if(s->pos >= s->in->len){
+        ORIG(&e, E_PARAM, "incomplete json string");
+    }
+    dstr_off_t token = { .buf = s->in, .start = s->pos, .len = 1 };
+    DSTR_VAR(context, 512);
+    get_token_context(&context, token, 40);
+    ORIG(&e, E_PARAM, "Unexpected character:\n%x", FD(context));
+}
+
+static derr_t scan_expect(jscan_t *s, char c){
+    derr_t e = E_OK;
+
+    if(scan_peek(s) != c) PROP(&e, scan_unexpected(s) );
+    s->pos++;
+
+    return e;
+}
+
+// find the raw bytes of a string, without decoding anything
+static derr_t scan_string_raw(jscan_t *s, dstr_t *raw, bool *escaped){
+    derr_t e = E_OK;
+
+    // skip the open quote
+    size_t start = ++s->pos;
+    *escaped = false;
+    for(; s->pos < s->in->len; s->pos++){
+        unsigned char u = ((unsigned char*)s->in->data)[s->pos];
+        if(u == '"') break;
+        if(u == '\\'){
+            *escaped = true;
+            // whatever is escaped can't end the string
+            s->pos++;
+            continue;
+        }
+        if(u < 32) PROP(&e, scan_unexpected(s) );
+    }
+    if(s->pos >= s->in->len) PROP(&e, scan_unexpected(s) );
+
+    *raw = dstr_sub2(*s->in, start, s->pos);
+    // skip the close quote
+    s->pos++;
+
+    return e;
+}
+
+// *out references *in when possible
+static derr_t scan_string(jscan_t *s, dstr_t *out){
+    derr_t e = E_OK;
+
+    dstr_t raw;
+    bool escaped;
+    PROP(&e, scan_string_raw(s, &raw, &escaped) );
+
+    if(!escaped){
+        *out = raw;
+        return e;
+    }
+
+    PROP(&e, json_string_decode(s->json, raw, out) );
+
+    return e;
+}
+
+static bool scan_digits(jscan_t *s){
+    size_t start = s->pos;
+    while(s->pos < s->in->len){
+        char c = s->in->data[s->pos];
+        if(c < '0' || c > '9') break;
+        s->pos++;
+    }
+    return s->pos > start;
+}
+
+static bool scan_char(jscan_t *s, const char *chars){
+    if(s->pos >= s->in->len) return false;
+    if(!strchr(chars, s->in->data[s->pos])) return false;
+    s->pos++;
+    return true;
+}
+
+static derr_t scan_number(jscan_t *s, dstr_t *out){
+    derr_t e = E_OK;
+
+    size_t start = s->pos;
+
+    scan_char(s, "-");
+    if(!scan_char(s, "0")){
+        if(!scan_digits(s)) PROP(&e, scan_unexpected(s) );
+    }
+    if(scan_char(s, ".")){
+        if(!scan_digits(s)) PROP(&e, scan_unexpected(s) );
+    }
+    if(scan_char(s, "eE")){
+        scan_char(s, "+-");
+        if(!scan_digits(s)) PROP(&e, scan_unexpected(s) );
+    }
+
+    *out = dstr_sub2(*s->in, start, s->pos);
+
+    return e;
+}
+
+static derr_t scan_literal(jscan_t *s, const dstr_t lit){
+    derr_t e = E_OK;
+
+    for(size_t i = 0; i < lit.len; i++){
+        if(s->pos >= s->in->len || s->in->data[s->pos] != lit.data[i]){
+            PROP(&e, scan_unexpected(s) );
+        }
+        s->pos++;
+    }
+
+    return e;
+}
+
+// skip a value that the jspec doesn't read, stopping before ',', '}', or ']'
+static derr_t scan_skip(jscan_t *s){
+    derr_t e = E_OK;
+
+    char c = scan_peek(s);
+    if(c == ',' || c == '}' || c == ']' || c == '\0'){
+        PROP(&e, scan_unexpected(s) );
+    }
+
+    size_t depth = 0;
+    for(; s->pos < s->in->len; s->pos++){
+        c = s->in->data[s->pos];
+        if(c == '"'){
+            dstr_t raw;
+            bool escaped;
+            PROP(&e, scan_string_raw(s, &raw, &escaped) );
+            // scan_string_raw leaves us after the close quote
+            s->pos--;
+        }else if(c == '{' || c == '['){
+            depth++;
+        }else if(depth){
+            if(c == '}' || c == ']') depth--;
+        }else if(c == ',' || c == '}' || c == ']'){
+            break;
+        }
+    }
+    if(depth) PROP(&e, scan_unexpected(s) );
+
+    return e;
+}
+
+// read any single value into a node, skipping the contents of containers
+static derr_t scan_node(jscan_t *s, json_node_t *node){
+    derr_t e = E_OK;
+
+    *node = (json_node_t){0};
+
+    char c = scan_peek(s);
+    switch(c){
+        case '"':
+            node->type = JSON_STRING;
+            PROP(&e, scan_string(s, &node->text) );
+            break;
+        case 't':
+            node->type = JSON_TRUE;
+            PROP(&e, scan_literal(s, DSTR_LIT("true")) );
+            break;
+        case 'f':
+            node->type = JSON_FALSE;
+            PROP(&e, scan_literal(s, DSTR_LIT("false")) );
+            break;
+        case 'n':
+            node->type = JSON_NULL;
+            PROP(&e, scan_literal(s, DSTR_LIT("null")) );
+            break;
+        case '{':
+            // the jspec didn't want an object; it will complain
+            node->type = JSON_OBJECT;
+            PROP(&e, scan_skip(s) );
+            break;
+        case '[':
+            // the jspec didn't want an array; it will complain
+            node->type = JSON_ARRAY;
+            PROP(&e, scan_skip(s) );
+            break;
+        default:
+            if(c != '-' && (c < '0' || c > '9')){
+                PROP(&e, scan_unexpected(s) );
+            }
+            node->type = JSON_NUMBER;
+            PROP(&e, scan_number(s, &node->text) );
+    }
+
+    return e;
+}
+
+static derr_t scan_value(jscan_t *s, jspec_t *jspec, jctx_t *ctx);
+
+static derr_t scan_object(jscan_t *s, jspec_object_t *j, jctx_t *ctx){
+    derr_t e = E_OK;
+
+    object_check_sorted(j);
+
+    // skip the open brace
+    s->pos++;
+
+    if(scan_peek(s) == '}'){
+        s->pos++;
+        goto done;
+    }
+
+    while(true){
+        if(scan_peek(s) != '"') PROP(&e, scan_unexpected(s) );
+        dstr_t keytext;
+        PROP(&e, scan_string(s, &keytext) );
+        PROP(&e, scan_expect(s, ':') );
+
+        // look for matching jspec
+        _jkey_t *match = find_jkey(j, &keytext);
+        if(!match){
+            if(!j->allow_extras){
+                jctx_error(ctx, "unexpected key: \"%x\"\n", FD(keytext));
+            }
+            PROP(&e, scan_skip(s) );
+        }else if(match->found){
+            jctx_error(ctx,
+                "duplicate entries for key: \"%x\"\n", FD(keytext)
+            );
+            PROP(&e, scan_skip(s) );
+        }else{
+            match->found = true;
+            if(match->present) *match->present = true;
+            // descend into subkey
+            jctx_t subctx = jctx_sub_key(ctx, keytext, NULL);
+            PROP(&e, scan_value(s, match->value, &subctx) );
+        }
+
+        char c = scan_peek(s);
+        if(c == '}'){
+            s->pos++;
+            break;
+        }
+        if(c != ',') PROP(&e, scan_unexpected(s) );
+        s->pos++;
+    }
+
+done:
+    // check that all required keys were found
+    object_check_required(j, ctx);
+
+    return e;
+}
+
+static derr_t scan_tuple(jscan_t *s, jspec_tuple_t *j, jctx_t *ctx){
+    derr_t e = E_OK;
+
+    // skip the open bracket
+    s->pos++;
+
+    size_t i = 0;
+    if(scan_peek(s) == ']'){
+        s->pos++;
+    }else while(true){
+        if(i < j->nitems){
+            // descend into this item
+            jctx_t subctx = jctx_sub_index(ctx, i, NULL);
+            PROP(&e, scan_value(s, j->items[i], &subctx) );
+        }else{
+            PROP(&e, scan_skip(s) );
+        }
+        i++;
+
+        char c = scan_peek(s);
+        if(c == ']'){
+            s->pos++;
+            break;
+        }
+        if(c != ',') PROP(&e, scan_unexpected(s) );
+        s->pos++;
+    }
+
+    if(i < j->nitems){
+        jctx_error(ctx, "not enough items in tuple\n");
+    }else if(i > j->nitems){
+        jctx_error(ctx, "too many items in tuple\n");
+    }
+
+    return e;
+}
+
+static derr_t scan_value(jscan_t *s, jspec_t *jspec, jctx_t *ctx){
+    derr_t e = E_OK;
+
+    char c = scan_peek(s);
+
+    if(jspec->read == jspec_object_read && c == '{'){
+        jspec_object_t *j = CONTAINER_OF(jspec, jspec_object_t, jspec);
+        PROP(&e, scan_object(s, j, ctx) );
+        return e;
+    }
+
+    if(jspec->read == jspec_tuple_read && c == '['){
+        jspec_tuple_t *j = CONTAINER_OF(jspec, jspec_tuple_t, jspec);
+        PROP(&e, scan_tuple(s, j, ctx) );
+        return e;
+    }
+
+    if(jspec->read == jspec_optional_read){
+        jspec_optional_t *j = CONTAINER_OF(jspec, jspec_optional_t, jspec);
+        if(c == 'n'){
+            PROP(&e, scan_literal(s, DSTR_LIT("null")) );
+            *j->nonnull = false;
+            return e;
+        }
+        *j->nonnull = true;
+        PROP(&e, scan_value(s, j->subspec, ctx) );
+        return e;
+    }
+
+    /* scalars, or containers of the wrong type, are read from a lone node,
+       which is enough for the jspec to report a type mismatch */
+    json_node_t node;
+    PROP(&e, scan_node(s, &node) );
+    jctx_t nodectx = *ctx;
+    nodectx.node = &node;
+    PROP(&e, jctx_read(&nodectx, jspec) );
+
+    return e;
+}
+
+derr_t jspec_parse_ex(
+    jspec_t *jspec, const dstr_t in, json_t *json, bool *ok, dstr_t *errbuf
+){
+    derr_t e = E_OK;
+
+    if(!scannable(jspec)){
+        PROP(&e, json_parse(in, json) );
+        PROP(&e, jspec_read_ex(jspec, json->root, ok, errbuf) );
+        return e;
+    }
+
+    *ok = true;
+    jscan_t s = { .in = &in, .json = json };
+    jctx_t ctx = jctx_fork(NULL, NULL, ok, errbuf);
+
+    PROP(&e, scan_value(&s, jspec, &ctx) );
+
+    // like json_parse, only whitespace may follow the root value
+    scan_peek(&s);
+    if(s.pos < in.len) PROP(&e, scan_unexpected(&s) );
+
+    return e;
+}
+
+derr_t jspec_parse(jspec_t *jspec, const dstr_t in, json_t *json){
+    derr_t e = E_OK;
+
+    dstr_t errbuf = {0};
+    bool ok;
+
+    PROP_GO(&e, jspec_parse_ex(jspec, in, json, &ok, &errbuf), fail);
+    if(!ok){
+        // just steal errbuf
+        e.msg = errbuf;
+        ORIG(&e, E_PARAM, "json did not match jspec");
+    }
+
+fail:
+    dstr_free(&errbuf);
+    return e;
+}
@@ -21,6 +21,9 @@ typedef struct jspec_t jspec_t;
 
 struct jspec_t {
     derr_t (*read)(jspec_t *jspec, jctx_t *ctx);
+    /* scalar readers only look at the type and text of ctx->node, so they can
+       be used by jspec_parse() without building a json_t */
+    bool scalar;
 };
 
 // jctx_fork is for when you want to track separate ok/errbuf from base
@@ -78,6 +81,28 @@ derr_t jspec_read_ex(jspec_t *jspec, json_ptr_t ptr, bool *ok, dstr_t *errbuf);
 // same as jspec_read_ex when you don't want separate ok/errbuf
 derr_t jspec_read(jspec_t *jspec, json_ptr_t ptr);
 
+/* jspec_parse_ex is json_parse() followed by jspec_read_ex(), except that
+   when jspec is built only from JOBJ, JTUP, JOPT, and scalar readers, the
+   text is read straight into the outputs in one pass, and no json_node_t's
+   are ever created.  Then json only holds the decoded text of strings with
+   escapes, so a small preallocated json_t is usually enough.  Any other
+   jspec (like JLIST, JMAP, or JPTR) falls back to the full json_t.
+
+   JDREF outputs point into either `in` or json, which must outlive them.
+   Values that jspec doesn't read are only checked for balanced brackets and
+   strings.  Invalid json raises E_PARAM, like json_parse(). */
+derr_t jspec_parse_ex(
+    jspec_t *jspec, const dstr_t in, json_t *json, bool *ok, dstr_t *errbuf
+);
+
+// same as jspec_parse_ex when you don't want separate ok/errbuf
+derr_t jspec_parse(jspec_t *jspec, const dstr_t in, json_t *json);
+
+/* a json_skip_f which drops object values that jspec (passed as data) would
+   ignore anyway; only keys of JOBJs with allow_extras are ever skipped, and
+   nothing inside of arrays is skipped */
+bool jspec_skip_unrequested(const json_node_t *key, void *data);
+
 // jspec_t implementations //
 
 typedef struct {
@@ -91,13 +116,17 @@ derr_t jspec_dstr_read(jspec_t *jspec, jctx_t *ctx);
 // JDCPY copies the text to a buffer
 #define JDCPY(_out) \
     &((jspec_dstr_t){ \
-            .jspec = { .read = jspec_dstr_read }, .out = _out, .copy = true \
+            .jspec = { .read = jspec_dstr_read, .scalar = true }, \
+            .out = _out, \
+            .copy = true \
     }.jspec)
 
 // JDREF references the json-owned text
 #define JDREF(_out) \
     &((jspec_dstr_t){ \
-            .jspec = { .read = jspec_dstr_read }, .out = _out, .copy = false \
+            .jspec = { .read = jspec_dstr_read, .scalar = true }, \
+            .out = _out, \
+            .copy = false \
     }.jspec)
 
 typedef struct {
@@ -109,7 +138,7 @@ derr_t jspec_bool_read(jspec_t *jspec, jctx_t *ctx);
 
 #define JB(_out) \
     &((jspec_bool_t){ \
-        .jspec = { .read = jspec_bool_read }, .out = _out \
+        .jspec = { .read = jspec_bool_read, .scalar = true }, .out = _out \
     }.jspec)
 
 typedef struct {
@@ -241,7 +270,8 @@ INTEGERS_MAP(DECLARE_NUMERICS)
 
 #define _JNUMERIC(suffix, type, __out) \
     &((jspec_to ## suffix ##_t){ \
-        .jspec = { .read = jspec_to ## suffix ## _read }, .out = __out, \
+        .jspec = { .read = jspec_to ## suffix ## _read, .scalar = true }, \
+        .out = __out, \
     }.jspec)
 
 #define JI(_out) _JNUMERIC(i, int, _out)
@@ -275,6 +305,7 @@ derr_t jspec_xdstr_read(jspec_t *jspec, jctx_t *ctx);
 derr_t jspec_xstr_read(jspec_t *jspec, jctx_t *ctx);
 derr_t jspec_xstrn_read(jspec_t *jspec, jctx_t *ctx);
 
-#define JXD(d) &((jspec_xdstr_t){ { jspec_xdstr_read }, d }.jspec)
-#define JXS(s) &((jspec_xstr_t){ { jspec_xstr_read }, s }.jspec)
-#define JXSN(s, n) &((jspec_xstrn_t){ { jspec_xstrn_read }, s, n }.jspec)
+#define JXD(d) &((jspec_xdstr_t){ { jspec_xdstr_read, true }, d }.jspec)
+#define JXS(s) &((jspec_xstr_t){ { jspec_xstr_read, true }, s }.jspec)
+#define JXSN(s, n) \
+    &((jspec_xstrn_t){ { jspec_xstrn_read, true }, s, n }.jspec)
@@ -1,4 +1,10 @@
 #include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sched.h>
+#include <stdatomic.h>
+#endif
 
 #include "libdstr.h"
 
@@ -51,7 +57,7 @@ void logger_clear_outputs(void){
     fnlist_len = 0;
 }
 
-void log_flush(void){
+static void flush_fileptrs(void){
     // only need to flush fplist, not fnlist
     for(size_t i = 0; i < fplist_len; i++){
         fflush(fplist[i]);
@@ -62,6 +68,48 @@ void auto_log_flush(bool val){
     _auto_log_flush = val;
 }
 
+// would any output print a message at this level?
+static bool level_wanted(log_level_t level){
+    for(size_t i = 0; i < fplist_len; i++){
+        if(level >= fplevels[i]) return true;
+    }
+    for(size_t i = 0; i < fnlist_len; i++){
+        if(level >= fnlevels[i]) return true;
+    }
+    return !outputs_set && level >= LOG_LVL_WARN;
+}
+
+/* write one formatted message to every output registered to see its level.
+   With fnfiles == NULL, each file name is opened and closed right here,
+   otherwise fnfiles[i] is opened on first use and left open for the caller to
+   close. */
+static void write_outputs(log_level_t level, const dstr_t buf, FILE **fnfiles){
+    for(size_t i = 0; i < fplist_len; i++){
+        if(level >= fplevels[i]){
+            fwrite(buf.data, 1, buf.len, fplist[i]);
+        }
+    }
+    for(size_t i = 0; i < fnlist_len; i++){
+        if(level < fnlevels[i]) continue;
+        FILE *f = fnfiles ? fnfiles[i] : NULL;
+        if(!f){
+            f = compat_fopen(fnlist[i], "a");
+            // there's no good way to report errors
+            if(!f) continue;
+        }
+        fwrite(buf.data, 1, buf.len, f);
+        if(fnfiles){
+            fnfiles[i] = f;
+        }else{
+            fclose(f);
+        }
+    }
+    // fallback to stderr/LOG_LVL_WARN if no outputs are set
+    if(!outputs_set && level >= LOG_LVL_WARN){
+        fwrite(buf.data, 1, buf.len, stderr);
+    }
+}
+
 // do the format once for all log outputs, into a static buffer if possible
 static derr_type_t pre_log_fmt(
     const char* format,
@@ -69,11 +117,8 @@ static derr_type_t pre_log_fmt(
     size_t nargs,
     dstr_t* stack,
     dstr_t* heap,
-    dstr_t* out,
-    bool *done
+    dstr_t* out
 ){
-    if(*done) return E_NONE;
-
     derr_type_t etype;
 
     // try and expand into stack_dstr
@@ -82,7 +127,6 @@ static derr_type_t pre_log_fmt(
     if(etype) return etype;
     // it worked, return stack_dstr as *out
     *out = *stack;
-    *done = true;
     return E_NONE;
 
 use_heap:
@@ -92,7 +136,6 @@ use_heap:
     etype = _fmt_quiet(WD(heap), format, args, nargs);
     if(etype) goto fail_heap;
     *out = *heap;
-    *done = true;
     return E_NONE;
 
 fail_heap:
@@ -100,57 +143,395 @@ fail_heap:
     return etype;
 }
 
-// this ALWAYS return 0, for use in the CATCH macro
-// don't use any error-handling macros because they would recurse infinitely
-int pvt_do_log(
+#ifndef _WIN32 // UNIX
+
+/* Async logging.  Every thread that logs gets one of the static rings, and is
+   that ring's only producer; the drain thread is every ring's only consumer.
+   Producers never take amutex except to register, to allocate their ring's
+   buffer, or to wake an idle drain thread.  The drain thread holds amutex for
+   everything except waiting. */
+
+#define LOG_RINGS_MAX 64
+#define LOG_RING_DEFAULT ((size_t)256 * 1024)
+
+typedef enum {
+    RING_FREE,
+    RING_OWNED,
+    // the owning thread exited; free the buffer once it is drained
+    RING_ORPHANED,
+} ring_state_e;
+
+typedef struct {
+    ring_state_e state;
+    // only touched under amutex, or while busy is set and async_on is true
+    char *buf;
+    size_t size; // always a power of two
+    // head and tail only ever increase, and wrap at size
+    _Atomic size_t head;
+    _Atomic size_t tail;
+    // set while a producer might be touching buf
+    _Atomic bool busy;
+} log_ring_t;
+
+typedef struct {
+    uint32_t len;
+    uint32_t level;
+} log_rec_t;
+
+static log_ring_t rings[LOG_RINGS_MAX];
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static bool ring_key_ok = false;
+
+static _Atomic bool async_on = false;
+static _Atomic size_t ndropped = 0;
+// the drain thread is (or is about to be) waiting on acond
+static _Atomic bool drain_waiting = false;
+
+static dmutex_t amutex = PTHREAD_MUTEX_INITIALIZER;
+static dcond_t acond = PTHREAD_COND_INITIALIZER;
+static dcond_t adone = PTHREAD_COND_INITIALIZER;
+static dthread_t drain_thread;
+// the rest are protected by amutex
+static size_t ring_size;
+static bool drain_running = false;
+static bool drain_stop = false;
+static size_t flush_req = 0;
+static size_t flush_done = 0;
+static size_t ndropped_reported = 0;
+
+// pthread_key_t destructor, when a thread with a ring exits
+static void ring_orphan(void *arg){
+    log_ring_t *ring = arg;
+    dmutex_lock(&amutex);
+    ring->state = ring->buf ? RING_ORPHANED : RING_FREE;
+    dmutex_unlock(&amutex);
+}
+
+static void ring_key_init(void){
+    ring_key_ok = pthread_key_create(&ring_key, ring_orphan) == 0;
+}
+
+// claim a free ring for this thread, or return NULL if there are none left
+static log_ring_t *ring_register(void){
+    log_ring_t *out = NULL;
+    dmutex_lock(&amutex);
+    for(size_t i = 0; i < LOG_RINGS_MAX; i++){
+        if(rings[i].state != RING_FREE) continue;
+        if(pthread_setspecific(ring_key, &rings[i]) != 0) break;
+        rings[i].state = RING_OWNED;
+        out = &rings[i];
+        break;
+    }
+    dmutex_unlock(&amutex);
+    return out;
+}
+
+// buffers are freed when async logging stops, and reallocated on demand
+static bool ring_alloc(log_ring_t *ring){
+    dmutex_lock(&amutex);
+    if(!ring->buf){
+        ring->buf = malloc(ring_size);
+        ring->size = ring_size;
+        atomic_store(&ring->head, 0);
+        atomic_store(&ring->tail, 0);
+    }
+    bool ok = ring->buf != NULL;
+    dmutex_unlock(&amutex);
+    return ok;
+}
+
+static void ring_write(log_ring_t *ring, size_t pos, const void *src, size_t n){
+    size_t off = pos & (ring->size - 1);
+    size_t first = MIN(n, ring->size - off);
+    memcpy(ring->buf + off, src, first);
+    memcpy(ring->buf, (const char*)src + first, n - first);
+}
+
+static void ring_read(log_ring_t *ring, size_t pos, void *dst, size_t n){
+    size_t off = pos & (ring->size - 1);
+    size_t first = MIN(n, ring->size - off);
+    memcpy(dst, ring->buf + off, first);
+    memcpy((char*)dst + first, ring->buf, n - first);
+}
+
+// returns false if the message must be logged synchronously instead
+static bool log_async(
     log_level_t level, const char* fstr, const fmt_i **args, size_t nargs
 ){
+    if(!atomic_load(&async_on)) return false;
+
+    log_ring_t *ring = pthread_getspecific(ring_key);
+    if(!ring){
+        ring = ring_register();
+        if(!ring) return false;
+    }
+
+    // logger_stop_async() waits for busy to clear before freeing buf
+    atomic_store(&ring->busy, true);
+    if(!atomic_load(&async_on) || (!ring->buf && !ring_alloc(ring))){
+        atomic_store(&ring->busy, false);
+        return false;
+    }
+
     DSTR_VAR(stack, 1024);
     dstr_t heap = {0};
-    dstr_t buf = {0};
-    // format lazily
-    bool done = false;
+    dstr_t buf;
+    if(pre_log_fmt(fstr, args, nargs, &stack, &heap, &buf)){
+        // logged nothing, but don't try again synchronously
+        atomic_store(&ring->busy, false);
+        return true;
+    }
 
-    derr_type_t etype;
+    log_rec_t rec = { .len = (uint32_t)buf.len, .level = (uint32_t)level };
+    size_t need = sizeof(rec) + buf.len;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if(buf.len > UINT32_MAX || need > ring->size - (head - tail)){
+        // a full ring drops the message, rather than block this thread
+        atomic_fetch_add(&ndropped, 1);
+    }else{
+        ring_write(ring, head, &rec, sizeof(rec));
+        ring_write(ring, head + sizeof(rec), buf.data, buf.len);
+        atomic_store(&ring->head, head + need);
+    }
+    atomic_store(&ring->busy, false);
+    dstr_free(&heap);
 
-    // just print the whole format string to all of our fplist
-    for(size_t i = 0; i < fplist_len; i++){
-        // only print if this output is registered to see this level
-        if(level >= fplevels[i]){
-            etype = pre_log_fmt(fstr, args, nargs, &stack, &heap, &buf, &done);
-            if(etype) return 0;
-            fwrite(buf.data, 1, buf.len, fplist[i]);
+    // wake the drain thread if it went idle
+    if(atomic_exchange(&drain_waiting, false)){
+        dmutex_lock(&amutex);
+        dcond_signal(&acond);
+        dmutex_unlock(&amutex);
+    }
+
+    return true;
+}
+
+static bool rings_pending(void){
+    for(size_t i = 0; i < LOG_RINGS_MAX; i++){
+        log_ring_t *ring = &rings[i];
+        if(!ring->buf) continue;
+        if(atomic_load(&ring->head) != atomic_load(&ring->tail)) return true;
+    }
+    return false;
+}
+
+// write out everything published so far; called with amutex held
+static void drain_pass(void){
+    FILE *fnfiles[LIST_LEN_MAX] = {0};
+    dstr_t scratch = {0};
+
+    size_t dropped = atomic_load(&ndropped);
+    if(dropped != ndropped_reported){
+        DSTR_VAR(msg, 128);
+        _fmt_quiet(WD(&msg),
+            "logger dropped %x messages\n",
+            (const fmt_i*[]){ FU(dropped - ndropped_reported) }, 1
+        );
+        write_outputs(LOG_LVL_WARN, msg, fnfiles);
+        ndropped_reported = dropped;
+    }
+
+    for(size_t i = 0; i < LOG_RINGS_MAX; i++){
+        log_ring_t *ring = &rings[i];
+        if(!ring->buf) continue;
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        while(tail != head){
+            log_rec_t rec;
+            ring_read(ring, tail, &rec, sizeof(rec));
+            size_t pos = tail + sizeof(rec);
+            size_t off = pos & (ring->size - 1);
+            dstr_t msg;
+            if(off + rec.len <= ring->size){
+                // the usual case: write straight from the ring
+                DSTR_WRAP(msg, ring->buf + off, rec.len, false);
+            }else if(dstr_grow_quiet(&scratch, rec.len) == E_NONE){
+                ring_read(ring, pos, scratch.data, rec.len);
+                DSTR_WRAP(msg, scratch.data, rec.len, false);
+            }else{
+                // there's no good way to report errors
+                msg = (dstr_t){0};
+            }
+            write_outputs((log_level_t)rec.level, msg, fnfiles);
+            tail = pos + rec.len;
+            atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        }
+        if(ring->state == RING_ORPHANED){
+            free(ring->buf);
+            ring->buf = NULL;
+            ring->state = RING_FREE;
         }
     }
-    // repeat with fnlist
-    for(size_t i = 0; i < fnlist_len; i++){
-        if(level >= fnlevels[i]){
-            etype = pre_log_fmt(fstr, args, nargs, &stack, &heap, &buf, &done);
-            if(etype) return 0;
-            // open the file
-            FILE* f = compat_fopen(fnlist[i], "a");
-            // there's no good way to report errors
-            if(!f) continue;
-            fwrite(buf.data, 1, buf.len, f);
-            fclose(f);
+
+    for(size_t i = 0; i < LIST_LEN_MAX; i++){
+        if(fnfiles[i]) fclose(fnfiles[i]);
+    }
+    flush_fileptrs();
+    if(!outputs_set) fflush(stderr);
+    dstr_free(&scratch);
+}
+
+static void *drain_thread_fn(void *arg){
+    (void)arg;
+    dmutex_lock(&amutex);
+    while(true){
+        size_t req = flush_req;
+        bool stop = drain_stop;
+        drain_pass();
+        flush_done = req;
+        dcond_broadcast(&adone);
+        if(stop) break;
+        /* producers only wake us if they see drain_waiting, and we only wait
+           if we see every ring empty after setting it */
+        atomic_store(&drain_waiting, true);
+        if(rings_pending()){
+            atomic_store(&drain_waiting, false);
+            continue;
+        }
+        while(atomic_load(&drain_waiting) && !drain_stop && flush_req == req){
+            dcond_wait(&acond, &amutex);
         }
+        atomic_store(&drain_waiting, false);
     }
-    // fallback to stderr/LOG_LVL_WARN if no outputs are set
-    if(!outputs_set && level >= LOG_LVL_WARN){
-        etype = pre_log_fmt(fstr, args, nargs, &stack, &heap, &buf, &done);
-        if(etype) return 0;
-        fwrite(buf.data, 1, buf.len, stderr);
+    drain_running = false;
+    dcond_broadcast(&adone);
+    dmutex_unlock(&amutex);
+    return NULL;
+}
+
+derr_t logger_start_async(size_t size){
+    derr_t e = E_OK;
+
+    pthread_once(&ring_key_once, ring_key_init);
+    if(!ring_key_ok) ORIG(&e, E_OS, "pthread_key_create failed");
+    if(atomic_load(&async_on)){
+        ORIG(&e, E_PARAM, "async logging is already started");
+    }
+
+    // ring sizes are powers of two
+    size_t want = size ? size : LOG_RING_DEFAULT;
+    size_t pow2 = 1024;
+    while(pow2 < want) pow2 *= 2;
+
+    dmutex_lock(&amutex);
+    ring_size = pow2;
+    drain_stop = false;
+    drain_running = true;
+    ndropped_reported = atomic_load(&ndropped);
+    dmutex_unlock(&amutex);
+
+    IF_PROP(&e, dthread_create(&drain_thread, drain_thread_fn, NULL) ){
+        dmutex_lock(&amutex);
+        drain_running = false;
+        dmutex_unlock(&amutex);
+        return e;
+    }
+
+    atomic_store(&async_on, true);
+
+    return e;
+}
+
+void logger_stop_async(void){
+    if(!atomic_exchange(&async_on, false)) return;
+
+    // wait out any producers that saw async_on before we cleared it
+    for(size_t i = 0; i < LOG_RINGS_MAX; i++){
+        while(atomic_load(&rings[i].busy)) sched_yield();
+    }
+
+    dmutex_lock(&amutex);
+    drain_stop = true;
+    dcond_signal(&acond);
+    dmutex_unlock(&amutex);
+
+    dthread_join(&drain_thread);
+
+    // threads keep their rings, but buffers are reallocated on demand
+    dmutex_lock(&amutex);
+    for(size_t i = 0; i < LOG_RINGS_MAX; i++){
+        free(rings[i].buf);
+        rings[i].buf = NULL;
+        if(rings[i].state == RING_ORPHANED) rings[i].state = RING_FREE;
     }
+    dmutex_unlock(&amutex);
+}
+
+size_t logger_dropped(void){
+    return atomic_load(&ndropped);
+}
+
+void log_flush(void){
+    dmutex_lock(&amutex);
+    if(!drain_running){
+        dmutex_unlock(&amutex);
+        flush_fileptrs();
+        return;
+    }
+    size_t target = ++flush_req;
+    dcond_signal(&acond);
+    while(drain_running && flush_done < target){
+        dcond_wait(&adone, &amutex);
+    }
+    dmutex_unlock(&amutex);
+}
+
+#else // WINDOWS
+
+// logging is always synchronous on windows
+derr_t logger_start_async(size_t size){
+    (void)size;
+    return E_OK;
+}
+
+void logger_stop_async(void){}
+
+size_t logger_dropped(void){
+    return 0;
+}
+
+void log_flush(void){
+    flush_fileptrs();
+}
+
+#endif
+
+static void log_sync(
+    log_level_t level, const char* fstr, const fmt_i **args, size_t nargs
+){
+    DSTR_VAR(stack, 1024);
+    dstr_t heap = {0};
+    dstr_t buf;
+    if(pre_log_fmt(fstr, args, nargs, &stack, &heap, &buf)) return;
+    write_outputs(level, buf, NULL);
     if(_auto_log_flush){
-        log_flush();
+        flush_fileptrs();
     }
     dstr_free(&heap);
+}
+
+// this ALWAYS return 0, for use in the CATCH macro
+// don't use any error-handling macros because they would recurse infinitely
+int pvt_do_log(
+    log_level_t level, const char* fstr, const fmt_i **args, size_t nargs
+){
+    if(!level_wanted(level)) return 0;
+#ifndef _WIN32
+    if(log_async(level, fstr, args, nargs)) return 0;
+#endif
+    log_sync(level, fstr, args, nargs);
     return 0;
 }
 
 void pvt_do_log_fatal(const char* fstr, const fmt_i **args, size_t nargs){
-    pvt_do_log(LOG_LVL_FATAL, fstr, args, nargs);
+    // get everything before the fatal message out, then skip the rings
     log_flush();
+    if(level_wanted(LOG_LVL_FATAL)){
+        log_sync(LOG_LVL_FATAL, fstr, args, nargs);
+    }
+    flush_fileptrs();
     abort();
 }
 
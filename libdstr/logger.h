@@ -11,6 +11,25 @@ derr_t logger_add_filename(log_level_t level, const char* f);
 void logger_clear_outputs(void);
 void log_flush(void);
 void auto_log_flush(bool val);
+
+/* logger_start_async() moves log output onto a background thread.  Each
+   thread that logs formats into its own ring buffer of ring_size bytes (or a
+   default, for 0), and the background thread drains all rings to the outputs,
+   opening file name outputs once per batch instead of once per message.
+
+   A message that doesn't fit in its thread's ring is dropped, counted, and
+   reported in the log later.  Messages from one thread stay in order, but
+   messages from different threads may be interleaved differently than they
+   were logged.  log_flush() waits for the rings to drain, and LOG_FATAL is
+   always written synchronously.
+
+   Outputs must not be added or cleared while async logging is running.
+   logger_stop_async() writes out everything pending before it returns.  On
+   windows, logging is always synchronous. */
+derr_t logger_start_async(size_t ring_size);
+void logger_stop_async(void);
+// messages dropped because of a full ring, since the process started
+size_t logger_dropped(void);
 // this ALWAYS return 0, for use in the CATCH macro
 int pvt_do_log(
     log_level_t level, const char* fstr, const fmt_i** args, size_t nargs
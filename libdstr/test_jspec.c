@@ -252,6 +252,100 @@ static derr_t test_jspec_errors(void){
     return e;
 }
 
+static derr_t test_jspec_parse(void){
+    derr_t e = E_OK;
+
+    DSTR_STATIC(text,
+        "{"
+        "  \"skipped\": {\"a\": [1, \"]\", {\"b\": null}], \"c\": \"\\\"\"},"
+        "  \"esc\": \"a\\u00e9\\nb\","
+        "  \"num\": -1.5e3,"
+        "  \"null\": null,"
+        "  \"obj\": {\"int\": 7, \"str\": \"plain\"},"
+        "  \"tuple\": [\"hi\", true]"
+        "}"
+    );
+
+    // no nodes at all, and only enough text for the escaped string
+    json_t json;
+    JSON_PREP_PREALLOCATED(json, 8, 1, true);
+
+    dstr_t esc;
+    dstr_t num;
+    bool have_null;
+    int null;
+    int i;
+    dstr_t str;
+    dstr_t tupstr;
+    bool tupbool;
+
+    jspec_t *spec = JOBJ(true,
+        JKEY("esc", JDREF(&esc)),
+        JKEY("null", JOPT(&have_null, JI(&null))),
+        JKEY("num", JDREF(&num)),
+        JKEY("obj", JOBJ(false,
+            JKEY("int", JI(&i)),
+            JKEY("str", JDREF(&str)),
+        )),
+        JKEY("tuple", JTUP(JDREF(&tupstr), JB(&tupbool))),
+    );
+
+    bool ok;
+    DSTR_VAR(errbuf, 4096);
+    PROP(&e, jspec_parse_ex(spec, text, &json, &ok, &errbuf) );
+    EXPECT_D3(&e, "errbuf", errbuf, DSTR_LIT(
+        "at <root>.num: expected string-type but found number-type\n"
+    ));
+    EXPECT_B(&e, "ok", ok, false);
+    EXPECT_D(&e, "esc", esc, DSTR_LIT("a\xc3\xa9\nb"));
+    EXPECT_B(&e, "have_null", have_null, false);
+    EXPECT_I(&e, "i", i, 7);
+    EXPECT_D(&e, "str", str, DSTR_LIT("plain"));
+    // unescaped strings point right into the input
+    EXPECT_B(&e, "str in text",
+        str.data > text.data && str.data < text.data + text.len, true
+    );
+    EXPECT_D(&e, "tupstr", tupstr, DSTR_LIT("hi"));
+    EXPECT_B(&e, "tupbool", tupbool, true);
+    EXPECT_U(&e, "nodes used", json.preallocated_nodes.len, 0);
+
+    // invalid json is still caught, even in skipped values
+    DSTR_STATIC(bad, "{\"num\": \"x\", \"skip\": [1, }");
+    json_free(&json);
+    spec = JOBJ(true, JKEY("num", JDREF(&num)));
+    derr_t e2 = jspec_parse_ex(spec, bad, &json, &ok, NULL);
+    EXPECT_E_VAR(&e, "e2", &e2, E_PARAM);
+    DSTR_STATIC(trailing, "{\"num\": \"x\"} x");
+    json_free(&json);
+    spec = JOBJ(true, JKEY("num", JDREF(&num)));
+    e2 = jspec_parse_ex(spec, trailing, &json, &ok, NULL);
+    EXPECT_E_VAR(&e, "e2", &e2, E_PARAM);
+    DSTR_STATIC(badnum, "{\"num\": 01}");
+    json_free(&json);
+    spec = JOBJ(true, JKEY("num", JDREF(&num)));
+    e2 = jspec_parse_ex(spec, badnum, &json, &ok, NULL);
+    EXPECT_E_VAR(&e, "e2", &e2, E_PARAM);
+
+    // a dynamic jspec falls back to building a json_t
+    json_t json2;
+    JSON_PREP_PREALLOCATED(json2, 1024, 128, true);
+    LIST_VAR(dstr_t, list, 4);
+    spec = JOBJ(true,
+        JKEY("obj", JOBJ(true, JKEY("str", JDREF(&str)))),
+        JKEY("tuple", JLIST(jlist_dstr, &list)),
+    );
+    errbuf.len = 0;
+    PROP(&e, jspec_parse_ex(spec, text, &json2, &ok, &errbuf) );
+    EXPECT_B(&e, "ok", ok, false);
+    EXPECT_D3(&e, "errbuf", errbuf, DSTR_LIT(
+        "at <root>.tuple[1]: expected string-type but found true-type\n"
+    ));
+    EXPECT_D(&e, "str", str, DSTR_LIT("plain"));
+    EXPECT_B(&e, "built nodes", json2.preallocated_nodes.len > 0, true);
+
+    return e;
+}
+
 int main(int argc, char** argv){
     derr_t e = E_OK;
     int exit_code = 0;
@@ -261,6 +355,7 @@ int main(int argc, char** argv){
 
     PROP_GO(&e, test_jspec(), cu);
     PROP_GO(&e, test_jspec_errors(), cu);
+    PROP_GO(&e, test_jspec_parse(), cu);
 
 cu:
     if(is_error(e)){
@@ -118,7 +118,7 @@ static void advance_state(rstream_concat_t *c){
         // submit to the current base
         c->original_read_cb = read->cb;
         rstream_i *s = c->bases[c->base_idx];
-        stream_must_read(s, read, read->buf, read_cb);
+        rstream_must_forward(s, read, read->buf, read_cb);
         c->reading = true;
     }
 
@@ -168,6 +168,32 @@ static bool concat_read(
     return true;
 }
 
+static bool concat_lend(
+    rstream_i *iface,
+    rstream_read_t *read,
+    size_t max,
+    rstream_read_cb cb
+){
+    if(!stream_lend_checks(iface, max)) return false;
+
+    rstream_concat_t *c = CONTAINER_OF(iface, rstream_concat_t, iface);
+
+    rstream_lend_prep(read, max, cb);
+    link_list_append(&c->reads, &read->link);
+
+    schedule(c);
+
+    return true;
+}
+
+static void concat_release(rstream_i *iface, rstream_read_t *read){
+    rstream_concat_t *c = CONTAINER_OF(iface, rstream_concat_t, iface);
+    /* only an EOF moves us to the next base, and EOFs are not released, so
+       the lend must have come from the current base */
+    rstream_i *s = c->bases[c->base_idx];
+    s->release(s, read);
+}
+
 static void concat_cancel(rstream_i *iface){
     rstream_concat_t *c = CONTAINER_OF(iface, rstream_concat_t, iface);
 
@@ -220,5 +246,15 @@ rstream_i *_rstream_concat(
         c->base_await_cbs[i] = bases[i]->await(bases[i], await_cb);
     }
 
+    // we can lend only if every base can lend
+    bool lend = true;
+    for(size_t i = 0; i < nbases; i++){
+        if(!bases[i]->lend) lend = false;
+    }
+    if(lend){
+        c->iface.lend = concat_lend;
+        c->iface.release = concat_release;
+    }
+
     return &c->iface;
 }
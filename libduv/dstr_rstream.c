@@ -8,17 +8,24 @@ static void advance_state(dstr_rstream_t *r){
     if(r->iface.awaited) return;
     if(r->iface.canceled) goto closing;
 
-    while((link = link_list_pop_first(&r->reads))){
+    // nothing more happens until a lent slice is released
+    while(!r->lent && (link = link_list_pop_first(&r->reads))){
         rstream_read_t *read = CONTAINER_OF(link, rstream_read_t, link);
         if(r->nread < r->base.len){
             // pass as much as possible
             size_t readlen = MIN(read->buf.size, _dstr_rstream_read_max_size);
             dstr_t sub = dstr_sub2(r->base, r->nread, r->nread + readlen);
             r->nread += sub.len;
-            read->buf.len = 0;
-            derr_type_t etype = dstr_append_quiet(&read->buf, &sub);
-            if(etype != E_NONE){
-                LOG_FATAL("dstr_append overflow in dstr_rstream_t\n");
+            if(read->lend){
+                // no copy needed
+                read->buf = sub;
+                r->lent = true;
+            }else{
+                read->buf.len = 0;
+                derr_type_t etype = dstr_append_quiet(&read->buf, &sub);
+                if(etype != E_NONE){
+                    LOG_FATAL("dstr_append overflow in dstr_rstream_t\n");
+                }
             }
             read->cb(&r->iface, read, read->buf);
             // detect if user closed us
@@ -76,6 +83,31 @@ static bool rstream_read(
     return true;
 }
 
+static bool rstream_lend(
+    rstream_i *iface,
+    rstream_read_t *read,
+    size_t max,
+    rstream_read_cb cb
+){
+    if(!stream_lend_checks(iface, max)) return false;
+
+    dstr_rstream_t *r = CONTAINER_OF(iface, dstr_rstream_t, iface);
+
+    rstream_lend_prep(read, max, cb);
+    link_list_append(&r->reads, &read->link);
+
+    schedule(r);
+
+    return true;
+}
+
+static void rstream_release(rstream_i *iface, rstream_read_t *read){
+    (void)read;
+    dstr_rstream_t *r = CONTAINER_OF(iface, dstr_rstream_t, iface);
+    r->lent = false;
+    schedule(r);
+}
+
 static void rstream_cancel(rstream_i *iface){
     dstr_rstream_t *r = CONTAINER_OF(iface, dstr_rstream_t, iface);
 
@@ -110,6 +142,8 @@ rstream_i *dstr_rstream(
             .read = rstream_read,
             .cancel = rstream_cancel,
             .await = rstream_await,
+            .lend = rstream_lend,
+            .release = rstream_release,
         },
     };
     link_init(&r->reads);
@@ -6,6 +6,8 @@ typedef struct {
     link_t reads; // rstream_read_t->link
     dstr_t base;
     size_t nread;
+    // lends are slices of base, so releasing is just bookkeeping
+    bool lent;
     rstream_await_cb await_cb;
 } dstr_rstream_t;
 DEF_CONTAINER_OF(dstr_rstream_t, iface, rstream_i)
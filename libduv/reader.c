@@ -13,6 +13,10 @@ static void await_cb(rstream_i *rstream, derr_t e, link_t *reads){
     // filter our own read out of any unfinished reads
     link_t ours = {0};
     rstream_reads_filter(reads, &ours, read_cb);
+    // a stream that ended cleanly must have had a complete json body
+    if(r->parser && !is_error(r->e)){
+        TRACE_PROP(&r->e, json_parse_finish(r->parser) );
+    }
     r->done = true;
     if(r->await_cb) r->await_cb(rstream, E_OK, reads);
     // user callback must be last
@@ -22,13 +26,36 @@ static void await_cb(rstream_i *rstream, derr_t e, link_t *reads){
 static void do_read(stream_reader_t *r);
 
 static void read_cb(rstream_i *rstream, rstream_read_t *read, dstr_t buf){
-    (void)read;
     stream_reader_t *r = rstream->wrapper_data;
-    r->out->len += buf.len;
+    if(r->parser){
+        if(!buf.len) return;
+        // parse whatever we got, then reuse the same space
+        IF_PROP(&r->e, json_parse_chunk(r->parser, buf) ){
+            // cancel ourselves
+            r->rstream->cancel(r->rstream);
+        }
+        if(read->lend) rstream->release(rstream, read);
+    }else if(read->lend){
+        // copy the lent bytes out and give them right back
+        if(!buf.len) return;
+        IF_PROP(&r->e, dstr_append(r->out, &buf) ){
+            // cancel ourselves
+            r->rstream->cancel(r->rstream);
+        }
+        rstream->release(rstream, read);
+    }else{
+        r->out->len += buf.len;
+    }
     if(buf.len && !r->rstream->canceled) do_read(r);
 }
 
 static void do_read(stream_reader_t *r){
+    if(r->rstream->lend){
+        // no need to manage space in out if the stream can lend to us
+        size_t max = MIN(4096, _stream_reader_read_max_size);
+        rstream_must_lend(r->rstream, &r->read, max, read_cb);
+        return;
+    }
     if(r->out->len == r->out->size){
         // increase buffer size
         IF_PROP(&r->e, dstr_grow(r->out, r->out->size + 4096) ){
@@ -38,21 +65,25 @@ static void do_read(stream_reader_t *r){
         }
     }
     // read directly into the user's buffer
+    if(r->parser) r->out->len = 0;
     dstr_t space = dstr_empty_space(*r->out);
     space.size = MIN(space.size, _stream_reader_read_max_size);
     stream_must_read(r->rstream, &r->read, space, read_cb);
 }
 
-// caller is responsible for initializing out and freeing it in failure cases
-// stream_read_all will await rstream
-void stream_read_all(
-    stream_reader_t *r, rstream_i *rstream, dstr_t *out, stream_reader_cb cb
+static void reader_start(
+    stream_reader_t *r,
+    rstream_i *rstream,
+    dstr_t *out,
+    json_parser_t *parser,
+    stream_reader_cb cb
 ){
     *r = (stream_reader_t){
         // preserve data
         .data = r->data,
         .rstream = rstream,
         .out = out,
+        .parser = parser,
         .started = true,
         .cb = cb,
         .await_cb = rstream->await(rstream, await_cb),
@@ -68,6 +99,24 @@ void stream_read_all(
     do_read(r);
 }
 
+// caller is responsible for initializing out and freeing it in failure cases
+// stream_read_all will await rstream
+void stream_read_all(
+    stream_reader_t *r, rstream_i *rstream, dstr_t *out, stream_reader_cb cb
+){
+    reader_start(r, rstream, out, NULL, cb);
+}
+
+void stream_read_json(
+    stream_reader_t *r,
+    rstream_i *rstream,
+    dstr_t *buf,
+    json_parser_t *parser,
+    stream_reader_cb cb
+){
+    reader_start(r, rstream, buf, parser, cb);
+}
+
 // always succeeds; returns true if an err=E_CANCELED will be coming
 bool stream_reader_cancel(stream_reader_t *r){
     if(!r->started) return false;
@@ -7,6 +7,8 @@ struct stream_reader_t {
     void *data;
     rstream_i *rstream;
     dstr_t *out;
+    // when set, out is just scratch space and the body goes to the parser
+    json_parser_t *parser;
     derr_t e;
     bool started : 1;
     bool done : 1;
@@ -22,6 +24,19 @@ void stream_read_all(
     stream_reader_t *r, rstream_i *rstream, dstr_t *out, stream_reader_cb cb
 );
 
+/* stream_read_json is like stream_read_all, but each chunk is fed to the
+   parser as it arrives, and json_parse_finish() is called at eof, so the
+   whole body is never in memory at once.  buf is scratch space, which is
+   left untouched if rstream is able to lend its buffers instead.  Invalid
+   json is reported as E_PARAM. */
+void stream_read_json(
+    stream_reader_t *r,
+    rstream_i *rstream,
+    dstr_t *buf,
+    json_parser_t *parser,
+    stream_reader_cb cb
+);
+
 // always succeeds; returns true if an err=E_CANCELED will be coming
 bool stream_reader_cancel(stream_reader_t *r);
 
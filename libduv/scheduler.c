@@ -4,34 +4,128 @@
 
 
 void schedulable_prep(schedulable_t *s, scheduler_schedule_cb cb){
-    *s = (schedulable_t){ .cb = cb };
+    *s = (schedulable_t){ .cb = cb, .prio = SCHED_PRIO_NORMAL };
     link_init(&s->link);
 }
 
 void schedulable_cancel(schedulable_t *s){
+    if(link_list_isempty(&s->link)) return;
     link_remove(&s->link);
+    if(s->depth) (*s->depth)--;
+}
+
+void schedulable_set_prio(schedulable_t *s, sched_prio_e prio){
+    s->prio = prio;
+}
+
+static void scheduled_init(link_t *scheduled){
+    for(size_t i = 0; i < SCHED_NPRIOS; i++){
+        link_init(&scheduled[i]);
+    }
+}
+
+static bool scheduled_isempty(link_t *scheduled){
+    for(size_t i = 0; i < SCHED_NPRIOS; i++){
+        if(!link_list_isempty(&scheduled[i])) return false;
+    }
+    return true;
+}
+
+/* high priority goes first, except that every fourth callback goes to normal
+   priority when there's any, so that it can't be starved completely */
+static schedulable_t *pop_next(link_t *scheduled, size_t nrun){
+    link_t *link = NULL;
+    if(nrun % 4 == 3){
+        link = link_list_pop_first(&scheduled[SCHED_PRIO_NORMAL]);
+    }
+    for(size_t i = 0; !link && i < SCHED_NPRIOS; i++){
+        link = link_list_pop_first(&scheduled[i]);
+    }
+    if(!link) return NULL;
+    schedulable_t *x = CONTAINER_OF(link, schedulable_t, link);
+    if(x->depth) (*x->depth)--;
+    return x;
 }
 
 // invoke scheduled items repeatedly until there's none left
 static void drain(link_t *scheduled){
-    link_t *link;
-    while((link = link_list_pop_first(scheduled))){
-        schedulable_t *x = CONTAINER_OF(link, schedulable_t, link);
+    schedulable_t *x;
+    size_t nrun = 0;
+    while((x = pop_next(scheduled, nrun++))){
         x->cb(x);
     }
 }
 
-static void schedule(link_t *scheduled, schedulable_t *x){
+static void schedule(link_t *scheduled, size_t *depth, schedulable_t *x){
     // if we're already scheduled, do nothing
     if(!link_list_isempty(&x->link)) return;
-    // otherwise place it at the end of the list
-    link_list_append(scheduled, &x->link);
+    // otherwise place it at the end of its priority's list
+    link_list_append(&scheduled[x->prio], &x->link);
+    x->depth = depth;
+    if(depth) (*depth)++;
+}
+
+/* invoke scheduled items until there's none left or the budget is spent,
+   returns true if there is still work to do */
+static bool tick(duv_scheduler_t *s, size_t budget){
+    duv_scheduler_stats_t *stats = &s->stats;
+    uint64_t start = uv_hrtime();
+
+    stats->ticks++;
+    if(s->depth > stats->depth_max) stats->depth_max = s->depth;
+
+    schedulable_t *x;
+    size_t nrun = 0;
+    while((x = pop_next(s->scheduled, nrun++))){
+        uint64_t latency = uv_hrtime() - x->scheduled_ns;
+        if(latency > stats->latency_max_ns[x->prio]){
+            stats->latency_max_ns[x->prio] = latency;
+        }
+        stats->callbacks[x->prio]++;
+        x->cb(x);
+        if(budget && nrun >= budget) break;
+    }
+
+    uint64_t tick_ns = uv_hrtime() - start;
+    if(tick_ns > stats->tick_max_ns) stats->tick_max_ns = tick_ns;
+
+    if(scheduled_isempty(s->scheduled)) return false;
+    stats->yields++;
+    return true;
+}
+
+static void timer_cb(uv_timer_t *timer);
+
+static void yield_cb(uv_idle_t *idle){
+    duv_scheduler_t *s = CONTAINER_OF(idle, duv_scheduler_t, yield);
+    /* libuv runs idle handles just before it polls for IO, so by setting our
+       timer now we will get the next tick right after that IO */
+    int ret = uv_idle_stop(&s->yield);
+    if(ret < 0){
+        // should literally never happen
+        LOG_FATAL("uv_idle_stop: %x\n", FUV(ret));
+    }
+    ret = uv_timer_start(&s->timer, timer_cb, 0, 0);
+    if(ret < 0){
+        // should only happen if we called close, which we prevent
+        LOG_FATAL("uv_timer_start: %x\n", FUV(ret));
+    }
 }
 
 static void timer_cb(uv_timer_t *timer){
     duv_scheduler_t *s = CONTAINER_OF(timer, duv_scheduler_t, timer);
 
-    drain(&s->scheduled);
+    if(tick(s, s->budget)){
+        /* out of budget; a zero-length timer started from a timer callback
+           may run again without any IO in between, so wait for an idle
+           callback first, leaving timer_set to block other wakeups */
+        int ret = uv_idle_start(&s->yield, yield_cb);
+        if(ret < 0){
+            // should only happen if we called close, which we prevent
+            LOG_FATAL("uv_idle_start: %x\n", FUV(ret));
+        }
+        return;
+    }
 
     // scheduled is now empty; anything added after this needs to wake us up
     s->timer_set = false;
@@ -55,7 +149,8 @@ static void duv_schedule(scheduler_i *iface, schedulable_t *x){
         // illegal calling behavior
         LOG_FATAL("schedule() called on closed scheduler\n");
     }
-    schedule(&s->scheduled, x);
+    if(link_list_isempty(&x->link)) x->scheduled_ns = uv_hrtime();
+    schedule(s->scheduled, &s->depth, x);
     duv_scheduler_set_timer(s);
 }
 
@@ -64,10 +159,17 @@ derr_t duv_scheduler_init(duv_scheduler_t *s, uv_loop_t *loop){
 
     *s = (duv_scheduler_t){
         .iface = { .schedule = duv_schedule },
+        .budget = DUV_SCHEDULER_BUDGET,
         .initialized = true,
     };
-    link_init(&s->scheduled);
-    int ret = uv_timer_init(loop, &s->timer);
+    scheduled_init(s->scheduled);
+    // uv_idle_init() can't actually fail, so init it first
+    int ret = uv_idle_init(loop, &s->yield);
+    if(ret < 0){
+        ORIG(&e, uv_err_type(ret), "uv_idle_init: %x", FUV(ret));
+    }
+    s->yield.data = s;
+    ret = uv_timer_init(loop, &s->timer);
     if(ret < 0){
         ORIG(&e, uv_err_type(ret), "uv_timer_init: %x", FUV(ret));
     }
@@ -110,8 +212,9 @@ static void detect_unclosed_handles(uv_handle_t *handle, void *data){
 void duv_scheduler_close(duv_scheduler_t *s){
     if(!s->initialized || s->closed) return;
     s->closed = true;
-    // close the timer
+    // close the timer and idle
     duv_timer_close(&s->timer, close_cb);
+    duv_idle_close(&s->yield, close_cb);
     // make sure loop will not run forever
     uv_loop_t *loop = s->timer.loop;
     bool ok = true;
@@ -137,27 +240,39 @@ void duv_scheduler_run(duv_scheduler_t *s){
         }
     }
 
+    // we can cancel a pending yield too
+    int ret = uv_idle_stop(&s->yield);
+    if(ret < 0){
+        // should literally never happen
+        LOG_FATAL("uv_idle_stop: %x\n", FUV(ret));
+    }
+
     // disable uv_timer_t calls
     s->timer_set = true;
 
-    drain(&s->scheduled);
+    // no budget; the caller needs everything run before we return
+    tick(s, 0);
 
     s->timer_set = false;
 }
 
+size_t duv_scheduler_depth(duv_scheduler_t *s){
+    return s->depth;
+}
+
 static void manual_schedule(scheduler_i *iface, schedulable_t *x){
     manual_scheduler_t *s = CONTAINER_OF(iface, manual_scheduler_t, iface);
-    schedule(&s->scheduled, x);
+    schedule(s->scheduled, NULL, x);
 }
 
 scheduler_i *manual_scheduler(manual_scheduler_t *s){
     *s = (manual_scheduler_t){
         .iface = { .schedule = manual_schedule },
     };
-    link_init(&s->scheduled);
+    scheduled_init(s->scheduled);
     return &s->iface;
 }
 
 void manual_scheduler_run(manual_scheduler_t *s){
-    drain(&s->scheduled);
+    drain(s->scheduled);
 }
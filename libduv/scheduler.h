@@ -2,9 +2,16 @@
 
    Useful for "fast" callbacks.
 
-   In a libuv loop, the scheduler itself sets a zero-length timer, and
-   continually invokes actions in its queue until there are none left, all
-   without letting libuv make syscalls to check for IO. */
+   In a libuv loop, the scheduler itself sets a zero-length timer, and invokes
+   actions in its queue without letting libuv make syscalls to check for IO.
+   Each timer tick has a budget, so that one busy connection which keeps
+   rescheduling itself can't starve IO for every other connection; once the
+   budget is spent, the scheduler yields to libuv for one round of IO before
+   continuing.
+
+   Each schedulable_t also has a priority.  High-priority work (like IDLE
+   responses) runs ahead of normal-priority work (like bulk downloads), but
+   normal-priority work is still guaranteed every fourth callback. */
 
 struct scheduler_i;
 typedef struct scheduler_i scheduler_i;
@@ -17,30 +24,68 @@ typedef struct duv_scheduler_t duv_scheduler_t;
 
 typedef void (*scheduler_schedule_cb)(schedulable_t*);
 
+typedef enum {
+    SCHED_PRIO_HIGH = 0,
+    SCHED_PRIO_NORMAL,
+} sched_prio_e;
+#define SCHED_NPRIOS 2
+
 struct schedulable_t {
     link_t link;
     scheduler_schedule_cb cb;
+    sched_prio_e prio;
+    // when we were scheduled, for latency stats (duv_scheduler_t only)
+    uint64_t scheduled_ns;
+    // the queue depth counting us while we're scheduled (duv_scheduler_t only)
+    size_t *depth;
 };
 DEF_CONTAINER_OF(schedulable_t, link, link_t)
 
+// the default priority is SCHED_PRIO_NORMAL
 void schedulable_prep(schedulable_t *s, scheduler_schedule_cb cb);
 
+// takes effect the next time s is scheduled
+void schedulable_set_prio(schedulable_t *s, sched_prio_e prio);
+
 void schedulable_cancel(schedulable_t *s);
 
 struct scheduler_i {
     void (*schedule)(scheduler_i*, schedulable_t*);
 };
 
+// default callbacks per tick before yielding to libuv
+#define DUV_SCHEDULER_BUDGET 256
+
+typedef struct {
+    uint64_t ticks;
+    // ticks which spent their budget and yielded with work still queued
+    uint64_t yields;
+    uint64_t callbacks[SCHED_NPRIOS];
+    // the most callbacks queued at the start of any tick
+    size_t depth_max;
+    uint64_t tick_max_ns;
+    // the longest any callback waited between schedule() and running
+    uint64_t latency_max_ns[SCHED_NPRIOS];
+} duv_scheduler_stats_t;
+
 struct duv_scheduler_t {
     scheduler_i iface;
     uv_timer_t timer;
+    // an idle handle lets libuv poll for IO once before the next tick
+    uv_idle_t yield;
     bool timer_set;
-    link_t scheduled;  // schedulable_t->link
+    link_t scheduled[SCHED_NPRIOS];  // schedulable_t->link
+    // how many are in scheduled, kept up to date by schedule/pop/cancel
+    size_t depth;
+    // callbacks per tick, or 0 for unlimited; may be changed any time
+    size_t budget;
+    duv_scheduler_stats_t stats;
     bool initialized;
     bool closed;
 };
 DEF_CONTAINER_OF(duv_scheduler_t, iface, scheduler_i)
 DEF_CONTAINER_OF(duv_scheduler_t, timer, uv_timer_t)
+DEF_CONTAINER_OF(duv_scheduler_t, yield, uv_idle_t)
 
 derr_t duv_scheduler_init(duv_scheduler_t *s, uv_loop_t *loop);
 
@@ -56,11 +101,14 @@ void duv_scheduler_close(duv_scheduler_t *s);
    extraneous read_stop/read_start calls */
 void duv_scheduler_run(duv_scheduler_t *s);
 
+// how many callbacks are queued right now
+size_t duv_scheduler_depth(duv_scheduler_t *s);
+
 /* a libuv-free implementation of the scheduler_i, which relies on somebody
    manually calling manual_scheduler_run() periodically */
 typedef struct {
     scheduler_i iface;
-    link_t scheduled;
+    link_t scheduled[SCHED_NPRIOS];
 } manual_scheduler_t;
 DEF_CONTAINER_OF(manual_scheduler_t, iface, scheduler_i)
 
@@ -25,6 +25,17 @@ void rstream_read_prep(rstream_read_t *req, dstr_t buf, rstream_read_cb cb){
     link_init(&req->link);
 }
 
+void rstream_lend_prep(rstream_read_t *req, size_t max, rstream_read_cb cb){
+    *req = (rstream_read_t){
+        // preserve data
+        .data = req->data,
+        .buf = { .size = max },
+        .cb = cb,
+        .lend = true,
+    };
+    link_init(&req->link);
+}
+
 bool stream_write_isempty(const dstr_t bufs[], unsigned int nbufs){
     for(unsigned int i = 0; i < nbufs; i++){
         if(bufs[i].len) return false;
@@ -74,6 +74,8 @@ struct rstream_read_t {
     link_t link;
     dstr_t buf;
     rstream_read_cb cb;
+    // a lend, rather than a read; buf.size is the max length to lend
+    bool lend;
 };
 DEF_CONTAINER_OF(rstream_read_t, link, link_t)
 
@@ -184,7 +186,18 @@ struct stream_i {
 };
 
 /* a read-only stream, which is normally closed automatically after the EOF
-   read_cb, but which may be closed earlier by cancel */
+   read_cb, but which may be closed earlier by cancel
+
+   An rstream_i may also support lending reads, where instead of copying into
+   a buffer provided by the consumer, the stream passes the read_cb a slice of
+   its own memory, up to max bytes long.  The slice remains valid until the
+   consumer calls release(), or until the stream is awaited.  Only one lend is
+   outstanding at a time: the stream will not complete any further reads or
+   lends until the slice is released.  An empty (EOF) lend is not released.
+
+   Streams which only wrap another stream should pass lends through to their
+   base, so that the bytes are not copied at each layer.  Streams which don't
+   support lending leave lend and release NULL. */
 struct rstream_i {
     void *data;
     void *wrapper_data;
@@ -200,6 +213,9 @@ struct rstream_i {
     );
     void (*cancel)(rstream_i*);
     rstream_await_cb (*await)(rstream_i*, rstream_await_cb);
+    // MUST return false IFF stream is eof/canceled/awaited or max is zero
+    bool (*lend)(rstream_i*, rstream_read_t*, size_t max, rstream_read_cb cb);
+    void (*release)(rstream_i*, rstream_read_t*);
 };
 
 /* a read-only stream, which is normally closed automatically after the
@@ -250,6 +266,29 @@ struct wstream_i {
     } \
 } while(0)
 
+// aborts if stream is non-readable or doesn't lend
+#define rstream_must_lend(s, r, max, cb) do { \
+    size_t _max = (max); \
+    if(!(s)->lend) LOG_FATAL("lend on non-lending stream\n"); \
+    if(!(s)->lend((s), (r), _max, (cb))){ \
+        if(!_max) LOG_FATAL("zero max in lend\n"); \
+        if((s)->awaited) LOG_FATAL("lend after await_cb\n"); \
+        if((s)->canceled) LOG_FATAL("lend after cancel\n"); \
+        if((s)->eof) LOG_FATAL("lend after eof\n"); \
+        LOG_FATAL("lend failed but should not have\n"); \
+    } \
+} while(0)
+
+/* for streams which wrap another rstream_i: submit a read or a lend to the
+   base, matching whatever the consumer submitted to us */
+#define rstream_must_forward(s, r, b, cb) do { \
+    if((r)->lend){ \
+        rstream_must_lend((s), (r), (b).size, (cb)); \
+    }else{ \
+        stream_must_read((s), (r), (b), (cb)); \
+    } \
+} while(0)
+
 #define stream_must_await_first(s, cb) do { \
     if((s)->await((s), (cb))){ \
         LOG_FATAL("this stream has already been awaited\n"); \
@@ -299,6 +338,13 @@ struct wstream_i {
     && !(s)->eof \
 )
 
+#define stream_lend_checks(s, max)( \
+    (max) \
+    && !(s)->awaited \
+    && !(s)->canceled \
+    && !(s)->eof \
+)
+
 #define stream_write_checks(s, bufs, nbufs)( \
     !stream_write_isempty(bufs, nbufs) \
     && !(s)->awaited \
@@ -310,6 +356,7 @@ bool stream_write_isempty(const dstr_t bufs[], unsigned int nbufs);
 
 void stream_read_prep(stream_read_t *req, dstr_t buf, stream_read_cb cb);
 void rstream_read_prep(rstream_read_t *req, dstr_t buf, rstream_read_cb cb);
+void rstream_lend_prep(rstream_read_t *req, size_t max, rstream_read_cb cb);
 
 // always succeeds
 void stream_write_init_nocopy(stream_write_t *req, stream_write_cb cb);
@@ -159,12 +159,114 @@ static derr_t test_concat(void){
     return e;
 }
 
+typedef struct {
+    char _got[64];
+    dstr_t got;
+    bool eof;
+    bool awaited;
+    derr_t e;
+} lender_t;
+
+static void lend_cb(rstream_i *r, rstream_read_t *read, dstr_t buf){
+    (void)read;
+    lender_t *l = r->data;
+    if(!buf.len){
+        l->eof = true;
+        return;
+    }
+    TRACE_PROP(&l->e, dstr_append(&l->got, &buf) );
+}
+
+static void lend_await_cb(rstream_i *r, derr_t e, link_t *reads){
+    (void)reads;
+    lender_t *l = r->data;
+    l->awaited = true;
+    TRACE_PROP_VAR(&l->e, &e);
+}
+
+static derr_t test_concat_lend(void){
+    derr_t e = E_OK;
+
+    manual_scheduler_t scheduler;
+    scheduler_i *sched = manual_scheduler(&scheduler);
+    rstream_concat_t concat;
+    lender_t l = {0};
+    DSTR_WRAP_ARRAY(l.got, l._got);
+    rstream_read_t read1, read2;
+
+    DSTR_STATIC(text1, "hello ");
+    DSTR_STATIC(text2, "world!");
+
+    /* release after EOF: the last slice of the first base is held while its
+       EOF is pending, and the release must reach that base, not the next */
+    rstream_i *r1 = dstr_rstream(&d1, sched, text1);
+    rstream_i *r2 = dstr_rstream(&d2, sched, text2);
+    R = rstream_concat(&concat, sched, r1, r2);
+    R->data = &l;
+    stream_must_await_first(R, lend_await_cb);
+    EXPECT_NOT_NULL_GO(&e, "lend", R->lend, done);
+
+    rstream_must_lend(R, &read1, 64, lend_cb);
+    manual_scheduler_run(&scheduler);
+    EXPECT_D3_GO(&e, "got", l.got, text1, done);
+    // the slice is the base's own memory
+    EXPECT_P_GO(&e, "slice", read1.buf.data, text1.data, done);
+
+    // nothing moves to the next base until the release
+    rstream_must_lend(R, &read2, 64, lend_cb);
+    manual_scheduler_run(&scheduler);
+    EXPECT_D3_GO(&e, "got", l.got, text1, done);
+    EXPECT_B_GO(&e, "r1->eof", r1->eof, false, done);
+
+    R->release(R, &read1);
+    manual_scheduler_run(&scheduler);
+    EXPECT_B_GO(&e, "d1.lent", d1.lent, false, done);
+    EXPECT_B_GO(&e, "r1->awaited", r1->awaited, true, done);
+    EXPECT_D3_GO(&e, "got", l.got, DSTR_LIT("hello world!"), done);
+
+    R->release(R, &read2);
+    rstream_must_lend(R, &read2, 64, lend_cb);
+    manual_scheduler_run(&scheduler);
+    EXPECT_B_GO(&e, "d2.lent", d2.lent, false, done);
+    EXPECT_B_GO(&e, "eof", l.eof, true, done);
+    EXPECT_B_GO(&e, "awaited", l.awaited, true, done);
+    PROP_VAR_GO(&e, &l.e, done);
+
+    // release after cancel: the held slice is returned to a canceled stream
+    l = (lender_t){0};
+    DSTR_WRAP_ARRAY(l.got, l._got);
+    r1 = dstr_rstream(&d1, sched, text1);
+    r2 = dstr_rstream(&d2, sched, text2);
+    R = rstream_concat(&concat, sched, r1, r2);
+    R->data = &l;
+    stream_must_await_first(R, lend_await_cb);
+
+    rstream_must_lend(R, &read1, 64, lend_cb);
+    manual_scheduler_run(&scheduler);
+    EXPECT_D3_GO(&e, "got", l.got, text1, done);
+
+    R->cancel(R);
+    R->release(R, &read1);
+    manual_scheduler_run(&scheduler);
+    EXPECT_B_GO(&e, "d1.lent", d1.lent, false, done);
+    EXPECT_B_GO(&e, "eof", l.eof, false, done);
+    EXPECT_B_GO(&e, "awaited", l.awaited, true, done);
+    EXPECT_B_GO(&e, "r1->awaited", r1->awaited, true, done);
+    EXPECT_B_GO(&e, "r2->awaited", r2->awaited, true, done);
+    EXPECT_E_VAR_GO(&e, "l.e", &l.e, E_CANCELED, done);
+
+done:
+    DROP_VAR(&l.e);
+    return e;
+}
+
 int main(int argc, char **argv){
     derr_t e = E_OK;
     // parse options and set default log level
     PARSE_TEST_OPTIONS(argc, argv, NULL, LOG_LVL_INFO);
 
     PROP_GO(&e, test_concat(), test_fail);
+    PROP_GO(&e, test_concat_lend(), test_fail);
 
     LOG_ERROR("PASS\n");
     return 0;
@@ -110,12 +110,109 @@ static derr_t test_reader(void){
     return e;
 }
 
+static void reader_cb_json(stream_reader_t *reader, derr_t e){
+    derr_type_t *exp_type = reader->data;
+    if(e.type != *exp_type){
+        TRACE_ORIG(&E, E_VALUE,
+            "expected %x but got %x",
+            FD(error_to_dstr(*exp_type)),
+            FD(error_to_dstr(e.type))
+        );
+        DROP_VAR(&e);
+        return;
+    }
+    DROP_VAR(&e);
+    success = true;
+}
+
+static derr_t test_reader_json(void){
+    derr_t e = E_OK;
+
+    manual_scheduler_t scheduler;
+    scheduler_i *sched = manual_scheduler(&scheduler);
+
+    json_t json;
+    json_prep(&json);
+    json_parser_t p;
+    dstr_t a;
+
+    // small reads make tokens span chunks
+    _stream_reader_read_max_size = 3;
+
+    DSTR_STATIC(good, "{\"a\": \"hello world!\", \"b\": [1, 2, 3]}");
+    DSTR_VAR(buf, 64);
+    derr_type_t exp_type = E_NONE;
+    R.data = &exp_type;
+    success = false;
+    p = json_parser(&json);
+    rstream_i *r = dstr_rstream(&dstr_r, sched, good);
+    stream_read_json(&R, r, &buf, &p, reader_cb_json);
+    manual_scheduler_run(&scheduler);
+    PROP_VAR_GO(&e, &E, cu);
+    if(!success){
+        ORIG_GO(&e, E_VALUE, "no error but success was never set", cu);
+    }
+    PROP_GO(&e, jspec_read(JOBJ(true, JKEY("a", JDREF(&a))), json.root), cu);
+    EXPECT_D_GO(&e, "a", a, DSTR_LIT("hello world!"), cu);
+
+    // again, but skipping what we don't need
+    json_free(&json);
+    success = false;
+    jspec_t *jspec = JOBJ(true, JKEY("b", JPTR(&(json_ptr_t){0})));
+    p = json_parser(&json);
+    p.skip = jspec_skip_unrequested;
+    p.skip_data = jspec;
+    r = dstr_rstream(&dstr_r, sched, good);
+    stream_read_json(&R, r, &buf, &p, reader_cb_json);
+    manual_scheduler_run(&scheduler);
+    PROP_VAR_GO(&e, &E, cu);
+    if(!success){
+        ORIG_GO(&e, E_VALUE, "no error but success was never set", cu);
+    }
+    bool ok;
+    jspec = JOBJ(false, JKEY("b", JPTR(&(json_ptr_t){0})));
+    PROP_GO(&e, jspec_read_ex(jspec, json.root, &ok, NULL), cu);
+    EXPECT_B_GO(&e, "only b was kept", ok, true, cu);
+
+    // invalid json
+    json_free(&json);
+    DSTR_STATIC(bad, "{\"c\": \"hello\" world!}");
+    exp_type = E_PARAM;
+    success = false;
+    p = json_parser(&json);
+    r = dstr_rstream(&dstr_r, sched, bad);
+    stream_read_json(&R, r, &buf, &p, reader_cb_json);
+    manual_scheduler_run(&scheduler);
+    PROP_VAR_GO(&e, &E, cu);
+    if(!success){
+        ORIG_GO(&e, E_VALUE, "no error but success was never set", cu);
+    }
+
+    // incomplete json
+    json_free(&json);
+    DSTR_STATIC(short_, "{\"c\": \"hello\"");
+    success = false;
+    p = json_parser(&json);
+    r = dstr_rstream(&dstr_r, sched, short_);
+    stream_read_json(&R, r, &buf, &p, reader_cb_json);
+    manual_scheduler_run(&scheduler);
+    PROP_VAR_GO(&e, &E, cu);
+    if(!success){
+        ORIG_GO(&e, E_VALUE, "no error but success was never set", cu);
+    }
+cu:
+    _stream_reader_read_max_size = SIZE_MAX;
+    json_free(&json);
+    return e;
+}
+
 int main(int argc, char **argv){
     derr_t e = E_OK;
     // parse options and set default log level
     PARSE_TEST_OPTIONS(argc, argv, NULL, LOG_LVL_INFO);
 
     PROP_GO(&e, test_reader(), test_fail);
+    PROP_GO(&e, test_reader_json(), test_fail);
 
     LOG_ERROR("PASS\n");
     return 0;
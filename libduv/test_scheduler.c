@@ -27,6 +27,175 @@ fail:
     return e;
 }
 
+typedef struct {
+    scheduler_i *scheduler;
+    schedulable_t schedulable;
+    char name;
+    // how many more times to reschedule ourselves
+    size_t again;
+    dstr_t *order;
+} thing_t;
+DEF_CONTAINER_OF(thing_t, schedulable, schedulable_t)
+
+static void thing_cb(schedulable_t *schedulable){
+    thing_t *t = CONTAINER_OF(schedulable, thing_t, schedulable);
+    dstr_append_char(t->order, t->name);
+    if(!t->again) return;
+    t->again--;
+    t->scheduler->schedule(t->scheduler, &t->schedulable);
+}
+
+static void thing_prep(
+    thing_t *t,
+    scheduler_i *scheduler,
+    char name,
+    sched_prio_e prio,
+    size_t again,
+    dstr_t *order
+){
+    *t = (thing_t){
+        .scheduler = scheduler,
+        .name = name,
+        .again = again,
+        .order = order,
+    };
+    schedulable_prep(&t->schedulable, thing_cb);
+    schedulable_set_prio(&t->schedulable, prio);
+}
+
+static derr_t test_priority(void){
+    derr_t e = E_OK;
+
+    DSTR_VAR(order, 64);
+    manual_scheduler_t m;
+    scheduler_i *sched = manual_scheduler(&m);
+
+    thing_t things[6];
+    thing_prep(&things[0], sched, 'a', SCHED_PRIO_NORMAL, 0, &order);
+    thing_prep(&things[1], sched, 'b', SCHED_PRIO_NORMAL, 0, &order);
+    thing_prep(&things[2], sched, 'c', SCHED_PRIO_NORMAL, 0, &order);
+    thing_prep(&things[3], sched, 'X', SCHED_PRIO_HIGH, 0, &order);
+    thing_prep(&things[4], sched, 'Y', SCHED_PRIO_HIGH, 0, &order);
+    // Z reschedules itself, but can't starve the normal-priority things
+    thing_prep(&things[5], sched, 'Z', SCHED_PRIO_HIGH, 6, &order);
+    for(size_t i = 0; i < sizeof(things)/sizeof(*things); i++){
+        sched->schedule(sched, &things[i].schedulable);
+    }
+
+    manual_scheduler_run(&m);
+
+    EXPECT_D3(&e, "order", order, DSTR_LIT("XYZaZZZbZZZc"));
+
+    return e;
+}
+
+typedef struct {
+    duv_scheduler_t *scheduler;
+    uv_prepare_t prepare;
+    char _order[64];
+    dstr_t order;
+} budget_t;
+
+static void budget_prepare_cb(uv_prepare_t *prepare){
+    budget_t *b = prepare->data;
+    // mark where libuv polled for IO
+    dstr_append_char(&b->order, '|');
+    // stop once the scheduler is idle
+    if(!b->scheduler->timer_set) duv_prepare_close(prepare, NULL);
+}
+
+static derr_t test_budget(void){
+    derr_t e = E_OK;
+
+    uv_loop_t loop = {0};
+    duv_scheduler_t scheduler = {0};
+    budget_t b = { .scheduler = &scheduler };
+    DSTR_WRAP_ARRAY(b.order, b._order);
+
+    PROP(&e, duv_loop_init(&loop) );
+
+    PROP_GO(&e, duv_scheduler_init(&scheduler, &loop), cu);
+    scheduler.budget = 4;
+
+    int ret = uv_prepare_init(&loop, &b.prepare);
+    if(ret < 0){
+        ORIG_GO(&e, uv_err_type(ret), "uv_prepare_init: %x", cu, FUV(ret));
+    }
+    b.prepare.data = &b;
+    ret = uv_prepare_start(&b.prepare, budget_prepare_cb);
+    if(ret < 0){
+        ORIG_GO(&e, uv_err_type(ret), "uv_prepare_start: %x", cu, FUV(ret));
+    }
+
+    // one thing which would run 10 times in a row without a budget
+    thing_t t;
+    thing_prep(&t, &scheduler.iface, 'a', SCHED_PRIO_NORMAL, 9, &b.order);
+    scheduler.iface.schedule(&scheduler.iface, &t.schedulable);
+
+    PROP_GO(&e, duv_run(&loop), cu);
+
+    // the scheduler yields to libuv between every 4 callbacks
+    EXPECT_D3_GO(&e, "order", b.order, DSTR_LIT("aaaa|aaaa|aa|"), cu);
+
+    duv_scheduler_stats_t *stats = &scheduler.stats;
+    EXPECT_U_GO(&e, "ticks", stats->ticks, 3, cu);
+    EXPECT_U_GO(&e, "yields", stats->yields, 2, cu);
+    EXPECT_U_GO(&e, "callbacks", stats->callbacks[SCHED_PRIO_NORMAL], 10, cu);
+    EXPECT_U_GO(&e, "depth_max", stats->depth_max, 1, cu);
+
+cu:
+    duv_scheduler_close(&scheduler);
+    uv_loop_close(&loop);
+    DROP_CMD( duv_run(&loop) );
+
+    return e;
+}
+
+static derr_t test_depth(void){
+    derr_t e = E_OK;
+
+    uv_loop_t loop = {0};
+    duv_scheduler_t scheduler = {0};
+    scheduler_i *sched = &scheduler.iface;
+    DSTR_VAR(order, 64);
+
+    PROP(&e, duv_loop_init(&loop) );
+
+    PROP_GO(&e, duv_scheduler_init(&scheduler, &loop), cu);
+
+    thing_t things[3];
+    thing_prep(&things[0], sched, 'a', SCHED_PRIO_NORMAL, 0, &order);
+    thing_prep(&things[1], sched, 'X', SCHED_PRIO_HIGH, 0, &order);
+    // c reschedules itself once
+    thing_prep(&things[2], sched, 'c', SCHED_PRIO_NORMAL, 1, &order);
+    for(size_t i = 0; i < sizeof(things)/sizeof(*things); i++){
+        sched->schedule(sched, &things[i].schedulable);
+    }
+    EXPECT_U_GO(&e, "depth", duv_scheduler_depth(&scheduler), 3, cu);
+
+    // scheduling twice doesn't count twice
+    sched->schedule(sched, &things[1].schedulable);
+    EXPECT_U_GO(&e, "depth", duv_scheduler_depth(&scheduler), 3, cu);
+
+    // neither does canceling twice
+    schedulable_cancel(&things[0].schedulable);
+    EXPECT_U_GO(&e, "depth", duv_scheduler_depth(&scheduler), 2, cu);
+    schedulable_cancel(&things[0].schedulable);
+    EXPECT_U_GO(&e, "depth", duv_scheduler_depth(&scheduler), 2, cu);
+
+    duv_scheduler_run(&scheduler);
+    EXPECT_D3_GO(&e, "order", order, DSTR_LIT("Xcc"), cu);
+    EXPECT_U_GO(&e, "depth", duv_scheduler_depth(&scheduler), 0, cu);
+    EXPECT_U_GO(&e, "depth_max", scheduler.stats.depth_max, 2, cu);
+
+cu:
+    duv_scheduler_close(&scheduler);
+    uv_loop_close(&loop);
+    DROP_CMD( duv_run(&loop) );
+
+    return e;
+}
+
 int main(int argc, char** argv){
     derr_t e = E_OK;
     int exit_code = 0;
@@ -35,6 +204,9 @@ int main(int argc, char** argv){
     PARSE_TEST_OPTIONS(argc, argv, NULL, LOG_LVL_INFO);
 
     PROP_GO(&e, test_close(), cu);
+    PROP_GO(&e, test_priority(), cu);
+    PROP_GO(&e, test_budget(), cu);
+    PROP_GO(&e, test_depth(), cu);
 
 cu:
     if(is_error(e)){
@@ -5,6 +5,7 @@
 #include "libduv/libduv.h"
 #include "libcrypto/libcrypto.h"
 
+#include "session.h"
 #include "tls.h"
 
 #endif // LIBUVTLS_H
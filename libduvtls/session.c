@@ -0,0 +1,212 @@
+#include <openssl/ssl.h>
+
+#include "libduvtls/libduvtls.h"
+
+static void session_drop(duv_tls_cached_name_t *n, size_t i){
+    SSL_SESSION_free(n->sessions[i]);
+    for(; i + 1 < n->nsessions; i++){
+        n->sessions[i] = n->sessions[i+1];
+    }
+    n->sessions[--n->nsessions] = NULL;
+}
+
+static void cached_name_free(duv_tls_cached_name_t *n){
+    while(n->nsessions) session_drop(n, n->nsessions - 1);
+    link_remove(&n->link);
+    dstr_free(&n->name);
+    free(n);
+}
+
+// the cache's mutex must be held
+static void evict_lru(duv_tls_session_cache_t *c){
+    link_t *link = link_list_pop_first(&c->lru);
+    duv_tls_cached_name_t *n = CONTAINER_OF(link, duv_tls_cached_name_t, link);
+    hash_elem_remove(&n->elem);
+    cached_name_free(n);
+    c->nnames--;
+    c->stats.evicted++;
+}
+
+static bool session_usable(SSL_SESSION *s){
+    if(!SSL_SESSION_is_resumable(s)) return false;
+    long expiry = SSL_SESSION_get_time(s) + SSL_SESSION_get_timeout(s);
+    return (long)time(NULL) < expiry;
+}
+
+static derr_t store(
+    duv_tls_session_cache_t *c, const dstr_t name, SSL_SESSION *s
+){
+    derr_t e = E_OK;
+
+    duv_tls_cached_name_t *n = NULL;
+    hash_elem_t *elem = hashmap_gets(&c->names, &name);
+    if(elem){
+        n = CONTAINER_OF(elem, duv_tls_cached_name_t, elem);
+        // most-recently-used goes last
+        link_remove(&n->link);
+        link_list_append(&c->lru, &n->link);
+    }else{
+        if(c->nnames >= DUV_TLS_SESSION_NAMES) evict_lru(c);
+
+        n = DMALLOC_STRUCT_PTR(&e, n);
+        CHECK(&e);
+        PROP_GO(&e, dstr_new(&n->name, name.len), fail);
+        PROP_GO(&e, dstr_copy(&name, &n->name), fail);
+        hashmap_sets(&c->names, &n->name, &n->elem);
+        link_list_append(&c->lru, &n->link);
+        c->nnames++;
+    }
+
+    // full; the oldest session goes
+    if(n->nsessions == DUV_TLS_SESSIONS_PER_NAME) session_drop(n, 0);
+    n->sessions[n->nsessions++] = s;
+    c->stats.stored++;
+
+    return e;
+
+fail:
+    dstr_free(&n->name);
+    free(n);
+    return e;
+}
+
+// called by openssl whenever a new session is established
+static int new_session_cb(SSL *ssl, SSL_SESSION *s){
+    SSL_CTX *ctx = SSL_get_SSL_CTX(ssl);
+    duv_tls_session_cache_t *c = duv_tls_session_cache_get(ctx);
+    if(!c) return 0;
+
+    // duv_tls_wrap_client() always sets SNI to the verify_name
+    const char *sni = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    if(!sni) return 0;
+    if(!session_usable(s)) return 0;
+
+    /* store a copy: openssl marks the connection's own session unresumable
+       if the connection is freed without a clean shutdown, which happens
+       every time a stream is canceled */
+    SSL_SESSION *copy = SSL_SESSION_dup(s);
+    if(!copy) return 0;
+
+    dmutex_lock(&c->mutex);
+    derr_t e = store(c, dstr_from_cstr((char*)sni), copy);
+    dmutex_unlock(&c->mutex);
+
+    CATCH_ANY(&e){
+        // not being able to cache a session is not an error worth reporting
+        DROP_VAR(&e);
+        SSL_SESSION_free(copy);
+    }
+
+    // we never keep the reference openssl gave us
+    return 0;
+}
+
+derr_t duv_tls_session_cache_init(duv_tls_session_cache_t *c, SSL_CTX *ctx){
+    derr_t e = E_OK;
+
+    *c = (duv_tls_session_cache_t){0};
+    link_init(&c->lru);
+
+    if(SSL_CTX_get_app_data(ctx)){
+        ORIG(&e, E_PARAM, "SSL_CTX app_data is already in use");
+    }
+
+    PROP(&e, hashmap_init(&c->names) );
+    PROP_GO(&e, dmutex_init(&c->mutex), fail);
+
+    SSL_CTX_up_ref(ctx);
+    c->ctx = ctx;
+
+    /* the internal store is for servers; clients look sessions up by name,
+       which only we know how to do */
+    SSL_CTX_set_session_cache_mode(ctx,
+        SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE
+    );
+    SSL_CTX_sess_set_new_cb(ctx, new_session_cb);
+    SSL_CTX_set_app_data(ctx, c);
+
+    return e;
+
+fail:
+    hashmap_free(&c->names);
+    return e;
+}
+
+void duv_tls_session_cache_free(duv_tls_session_cache_t *c){
+    if(!c->ctx) return;
+
+    SSL_CTX_set_app_data(c->ctx, NULL);
+    SSL_CTX_sess_set_new_cb(c->ctx, NULL);
+    SSL_CTX_set_session_cache_mode(c->ctx, SSL_SESS_CACHE_OFF);
+    SSL_CTX_free(c->ctx);
+
+    link_t *link;
+    while((link = link_list_pop_first(&c->lru))){
+        duv_tls_cached_name_t *n;
+        n = CONTAINER_OF(link, duv_tls_cached_name_t, link);
+        hash_elem_remove(&n->elem);
+        cached_name_free(n);
+    }
+    hashmap_free(&c->names);
+    dmutex_free(&c->mutex);
+
+    *c = (duv_tls_session_cache_t){0};
+}
+
+duv_tls_session_stats_t duv_tls_session_cache_stats(
+    duv_tls_session_cache_t *c
+){
+    dmutex_lock(&c->mutex);
+    duv_tls_session_stats_t out = c->stats;
+    dmutex_unlock(&c->mutex);
+    return out;
+}
+
+duv_tls_session_cache_t *duv_tls_session_cache_get(SSL_CTX *ctx){
+    return SSL_CTX_get_app_data(ctx);
+}
+
+SSL_SESSION *duv_tls_session_cache_take(
+    duv_tls_session_cache_t *c, const dstr_t name
+){
+    SSL_SESSION *out = NULL;
+
+    dmutex_lock(&c->mutex);
+
+    hash_elem_t *elem = hashmap_gets(&c->names, &name);
+    if(!elem) goto done;
+    duv_tls_cached_name_t *n;
+    n = CONTAINER_OF(elem, duv_tls_cached_name_t, elem);
+
+    // prefer the newest session, discarding any which have expired
+    while(n->nsessions && !out){
+        size_t i = n->nsessions - 1;
+        SSL_SESSION *s = n->sessions[i];
+        if(!session_usable(s)){
+            session_drop(n, i);
+            continue;
+        }
+        if(SSL_SESSION_get_protocol_version(s) >= TLS1_3_VERSION){
+            // TLS 1.3 tickets are single-use, to avoid linkability
+            n->sessions[i] = NULL;
+            n->nsessions--;
+        }else{
+            SSL_SESSION_up_ref(s);
+        }
+        out = s;
+    }
+
+done:
+    dmutex_unlock(&c->mutex);
+    return out;
+}
+
+void duv_tls_session_cache_count(duv_tls_session_cache_t *c, bool resumed){
+    dmutex_lock(&c->mutex);
+    if(resumed){
+        c->stats.hits++;
+    }else{
+        c->stats.misses++;
+    }
+    dmutex_unlock(&c->mutex);
+}
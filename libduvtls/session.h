@@ -0,0 +1,67 @@
+#include <openssl/ssl.h>
+
+/* A client-side TLS session cache, keyed by verify_name.
+
+   Once a cache is attached to a client SSL_CTX, every duv_tls_wrap_client()
+   using that SSL_CTX offers a cached session for its verify_name, and any new
+   sessions (including TLS 1.3 tickets, which arrive after the handshake) are
+   stored for the next connection.  Reconnects then cost a resumption instead
+   of a full key exchange.
+
+   The cache claims the SSL_CTX's app_data.  It is thread-safe, so it may be
+   shared by SSL_CTX's used from multiple threads. */
+
+// how many names are remembered, and how many sessions per name
+#define DUV_TLS_SESSION_NAMES 64
+#define DUV_TLS_SESSIONS_PER_NAME 4
+
+typedef struct {
+    // handshakes which resumed a cached session
+    uint64_t hits;
+    // full handshakes, whether or not a cached session was offered
+    uint64_t misses;
+    // sessions added to the cache
+    uint64_t stored;
+    // names dropped to make room for other names
+    uint64_t evicted;
+} duv_tls_session_stats_t;
+
+typedef struct {
+    dstr_t name;
+    SSL_SESSION *sessions[DUV_TLS_SESSIONS_PER_NAME];
+    size_t nsessions;
+    hash_elem_t elem;  // duv_tls_session_cache_t->names
+    link_t link;  // duv_tls_session_cache_t->lru
+} duv_tls_cached_name_t;
+DEF_CONTAINER_OF(duv_tls_cached_name_t, elem, hash_elem_t)
+DEF_CONTAINER_OF(duv_tls_cached_name_t, link, link_t)
+
+typedef struct {
+    SSL_CTX *ctx;
+    dmutex_t mutex;
+    hashmap_t names;  // verify_name -> duv_tls_cached_name_t
+    link_t lru;  // duv_tls_cached_name_t->link, least-recently-used first
+    size_t nnames;
+    duv_tls_session_stats_t stats;
+} duv_tls_session_cache_t;
+
+// attach a cache to a client SSL_CTX; the cache holds a reference to ctx
+derr_t duv_tls_session_cache_init(duv_tls_session_cache_t *c, SSL_CTX *ctx);
+// detach from the SSL_CTX and drop all sessions; safe to call if zeroized
+void duv_tls_session_cache_free(duv_tls_session_cache_t *c);
+
+duv_tls_session_stats_t duv_tls_session_cache_stats(
+    duv_tls_session_cache_t *c
+);
+
+// internal interface for tls.c
+
+// returns NULL if ctx has no cache
+duv_tls_session_cache_t *duv_tls_session_cache_get(SSL_CTX *ctx);
+
+// returns a session reference owned by the caller, or NULL
+SSL_SESSION *duv_tls_session_cache_take(
+    duv_tls_session_cache_t *c, const dstr_t name
+);
+
+void duv_tls_session_cache_count(duv_tls_session_cache_t *c, bool resumed);
@@ -26,6 +26,7 @@ static bool finishing = false;
 static bool success = false;
 static bool expect_exit = false;
 static ssl_context_t client_ctx = {0};
+static duv_tls_session_cache_t session_cache = {0};
 
 static char readmem[MANY];
 static stream_read_t reads[MANY];
@@ -210,6 +211,11 @@ static void await_cb_phase6(
         ORIG_GO(&E, E_VALUE, "unfinished writes", fail);
     }
 
+    // the reconnect should have resumed the first connection's session
+    duv_tls_session_stats_t stats = duv_tls_session_cache_stats(&session_cache);
+    EXPECT_U_GO(&E, "session misses", stats.misses, 1, fail);
+    EXPECT_U_GO(&E, "session hits", stats.hits, 1, fail);
+
     // SUCCESS!
     success = true;
 
@@ -593,6 +599,9 @@ static derr_t test_tls_client(void){
 
     PROP(&e, ssl_context_new_client(&client_ctx) );
     PROP_GO(&e, trust_good(client_ctx.ctx), fail_ctx);
+    PROP_GO(&e,
+        duv_tls_session_cache_init(&session_cache, client_ctx.ctx),
+    fail_ctx);
 
     PROP_GO(&e, duv_loop_init(&loop), fail_ctx);
 
@@ -622,6 +631,7 @@ done:
     uv_loop_close(&loop);
 
 fail_ctx:
+    duv_tls_session_cache_free(&session_cache);
     ssl_context_free(&client_ctx);
 
     return e;
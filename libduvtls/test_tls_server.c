@@ -169,18 +169,13 @@ static derr_t test_tls_server(bool with_preinput){
     PUSH_BYTES(&fc, &fs);
     manual_scheduler_run(&scheduler);
 
-    // server should finalize handshake
+    /* server should finalize handshake, and its first message rides along
+       in the same base stream write */
     EXPECT_WANT_WRITE("server handshake finish", &fs, true);
     EXPECT_WANT_READ("client handshake finish", &fc, true);
     PUSH_BYTES(&fs, &fc);
     manual_scheduler_run(&scheduler);
 
-    // server sends what it needs to
-    EXPECT_WANT_WRITE("server first message", &fs, true);
-    EXPECT_WANT_READ("client first messagae", &fc, true);
-    PUSH_BYTES(&fs, &fc);
-    manual_scheduler_run(&scheduler);
-
     EXPECT_READ_CB;
     EXPECT_WRITE_CB;
     EXPECT_READY_STATE;
@@ -218,6 +213,150 @@ cu:
     return e;
 }
 
+// big enough that the ciphertext buffers must grow
+#define BULK (256 * 1024)
+static char bulk_out[BULK];
+static char bulk_in[BULK];
+static size_t bulk_nread = 0;
+static stream_read_t bulk_read;
+
+static void bulk_read_cb(stream_i *stream, stream_read_t *req, dstr_t buf){
+    (void)req;
+    if(!buf.len){
+        TRACE_ORIG(&E, E_VALUE, "unexpected eof");
+        return;
+    }
+    bulk_nread += buf.len;
+    if(bulk_nread == BULK) return;
+    // read the rest in one big chunk
+    dstr_t rbuf = {
+        .data = bulk_in + bulk_nread,
+        .size = BULK - bulk_nread,
+        .fixed_size = true,
+    };
+    stream_must_read(stream, &bulk_read, rbuf, bulk_read_cb);
+}
+
+// shuttle bytes in both directions until nobody is both talking and listening
+static derr_t pump(manual_scheduler_t *m, fake_stream_t *a, fake_stream_t *b){
+    derr_t e = E_OK;
+
+    manual_scheduler_run(m);
+    while(true){
+        fake_stream_t *from, *to;
+        if(fake_stream_want_write(a) && fake_stream_want_read(b)){
+            from = a;
+            to = b;
+        }else if(fake_stream_want_write(b) && fake_stream_want_read(a)){
+            from = b;
+            to = a;
+        }else{
+            break;
+        }
+        dstr_t bytes = fake_stream_pop_write(from);
+        while(bytes.len){
+            if(!fake_stream_want_read(to)){
+                ORIG(&e, E_VALUE, "reader stopped reading mid-write");
+            }
+            bytes = fake_stream_feed_read(to, bytes);
+            manual_scheduler_run(m);
+        }
+        fake_stream_write_done(from);
+        manual_scheduler_run(m);
+    }
+
+    return e;
+}
+
+static derr_t test_tls_bulk(void){
+    derr_t e = E_OK;
+
+    manual_scheduler_t scheduler;
+    scheduler_i *sched = manual_scheduler(&scheduler);
+    fake_stream_t fs, fc;
+    duv_tls_t ts, tc;
+    stream_i *s = NULL, *c = NULL;
+    ssl_context_t server_ctx = {0};
+    ssl_context_t client_ctx = {0};
+    stream_write_t write;
+
+    for(size_t i = 0; i < BULK; i++){
+        bulk_out[i] = (char)('a' + i % 26);
+    }
+
+    PROP_GO(&e, good_127_0_0_1_server(&server_ctx.ctx), cu);
+    PROP_GO(&e, ssl_context_new_client(&client_ctx), cu);
+    PROP_GO(&e, trust_good(client_ctx.ctx), cu);
+
+    PROP_GO(&e,
+        duv_tls_wrap_server(
+            &ts, server_ctx.ctx, sched, fake_stream(&fs), (dstr_t){0}, &s
+        ),
+    cu);
+    PROP_GO(&e,
+        duv_tls_wrap_client(
+            &tc,
+            client_ctx.ctx,
+            DSTR_LIT("127.0.0.1"),
+            sched,
+            fake_stream(&fc),
+            &c
+        ),
+    cu);
+
+    // client writes a lot to the server
+    size_t exp_nwrites = nwrites + 1;
+    dstr_t wbuf = { .data = bulk_out, .len = BULK, .size = BULK };
+    stream_must_write(c, &write, &wbuf, 1, write_cb);
+    dstr_t rbuf = { .data = bulk_in, .size = BULK, .fixed_size = true };
+    stream_must_read(s, &bulk_read, rbuf, bulk_read_cb);
+    // the client reads too, which lets it process session tickets
+    DSTR_VAR(cbuf, 256);
+    stream_read_t cread;
+    stream_must_read(c, &cread, cbuf, read_cb);
+
+    PROP_GO(&e, pump(&scheduler, &fc, &fs), cu);
+    PROP_VAR_GO(&e, &E, cu);
+
+    EXPECT_U_GO(&e, "nwrites", nwrites, exp_nwrites, cu);
+    EXPECT_U_GO(&e, "bulk_nread", bulk_nread, BULK, cu);
+    if(memcmp(bulk_in, bulk_out, BULK) != 0){
+        ORIG_GO(&e, E_VALUE, "bulk data corrupted", cu);
+    }
+
+    duv_tls_stats_t cs = tc.stats;
+    duv_tls_stats_t ss = ts.stats;
+    EXPECT_U_GO(&e, "client plain_out", cs.plain_out, BULK, cu);
+    EXPECT_U_GO(&e, "server plain_in", ss.plain_in, BULK, cu);
+    EXPECT_U_GO(&e, "server bytes_in", ss.bytes_in, cs.bytes_out, cu);
+    EXPECT_U_GO(&e, "client bytes_in", cs.bytes_in, ss.bytes_out, cu);
+    EXPECT_U_GO(&e, "server records_in", ss.records_in, cs.records_out, cu);
+    EXPECT_U_GO(&e, "client records_in", cs.records_in, ss.records_out, cu);
+    // at least one full record per 16KB
+    EXPECT_U_GE_GO(&e, "client records_out", cs.records_out, BULK/16384, cu);
+    // both buffers grew, so there are fewer base writes and reads than records
+    EXPECT_U_GE_GO(&e, "client grows", cs.grows, 1, cu);
+    EXPECT_U_GE_GO(&e, "server grows", ss.grows, 1, cu);
+    EXPECT_U_LT_GO(&e,
+        "client base_writes", cs.base_writes, cs.records_out, cu
+    );
+    EXPECT_U_LT_GO(&e, "server base_reads", ss.base_reads, ss.records_in, cu);
+
+cu:
+    MERGE_CMD(&E, fake_stream_cleanup(&scheduler, c, &fc), "fc");
+    MERGE_CMD(&E, fake_stream_cleanup(&scheduler, s, &fs), "fs");
+    ssl_context_free(&server_ctx);
+    ssl_context_free(&client_ctx);
+
+    if(is_error(e)){
+        DROP_VAR(&E);
+    }else{
+        TRACE_PROP_VAR(&e, &E);
+    }
+
+    return e;
+}
+
 int main(int argc, char** argv){
     derr_t e = E_OK;
     // parse options and set default log level
@@ -229,6 +368,7 @@ int main(int argc, char** argv){
 
     PROP_GO(&e, test_tls_server(false), test_fail);
     PROP_GO(&e, test_tls_server(true), test_fail);
+    PROP_GO(&e, test_tls_bulk(), test_fail);
 
     LOG_ERROR("PASS\n");
     ssl_library_close();
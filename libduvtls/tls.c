@@ -10,13 +10,56 @@ DUV_TLS_ERRNO_MAP(DUV_TLS_ERR_DEF)
 static void advance_state(duv_tls_t *t);
 
 static void duv_tls_free_allocations(duv_tls_t *t){
-    dstr_free(&t->read_buf);
-    dstr_free(&t->write_buf);
     if(t->ssl){
         SSL_free(t->ssl);
         t->ssl = NULL;
-        t->rawin = NULL;
-        t->rawout = NULL;
+    }
+    if(t->raw){
+        BIO_free(t->raw);
+        t->raw = NULL;
+    }
+}
+
+// replaces any existing BIO pair, which must be empty
+static derr_t bio_pair(duv_tls_t *t, size_t in_size, size_t out_size){
+    derr_t e = E_OK;
+
+    BIO *internal, *raw;
+    int ret = BIO_new_bio_pair(&internal, out_size, &raw, in_size);
+    if(ret != 1){
+        ORIG(&e, E_NOMEM, "unable to create BIO pair: %x", FSSL);
+    }
+
+    // SSL owns one reference to its half, and frees any previous half
+    SSL_set_bio(t->ssl, internal, internal);
+    if(t->raw) BIO_free(t->raw);
+    t->raw = raw;
+    t->in_size = in_size;
+    t->out_size = out_size;
+
+    return e;
+}
+
+static void msg_cb(
+    int write_p,
+    int version,
+    int content_type,
+    const void *buf,
+    size_t len,
+    SSL *ssl,
+    void *arg
+){
+    (void)version;
+    (void)buf;
+    (void)len;
+    (void)ssl;
+    // openssl reports every record header, in addition to protocol messages
+    if(content_type != SSL3_RT_HEADER) return;
+    duv_tls_t *t = arg;
+    if(write_p){
+        t->stats.records_out++;
+    }else{
+        t->stats.records_in++;
     }
 }
 
@@ -62,13 +105,18 @@ static void read_cb(
         goto done;
     }
 
-    // put bytes in rawin
-    size_t nwritten;
-    int ret = BIO_write_ex(t->rawin, buf.data, buf.len, &nwritten);
-    if(ret != 1 || nwritten != buf.len){
-        TRACE_ORIG(&t->e, E_NOMEM, "failed to write to membio");
+    // the bytes are already in the BIO pair's buffer, just commit them
+    int ret = BIO_nwrite(t->raw, NULL, (int)buf.len);
+    if(ret != (int)buf.len){
+        TRACE_ORIG(&t->e, E_INTERNAL, "failed to commit to BIO pair");
         goto done;
     }
+    t->stats.bytes_in += buf.len;
+
+    // a read that filled the whole buffer suggests a bulk transfer
+    if(buf.len == t->in_size && t->in_size < DUV_TLS_BUF_MAX){
+        t->grow_in = true;
+    }
 
     // successful read
     t->need_read = false;
@@ -81,9 +129,16 @@ done:
 static void write_cb(stream_i *base, stream_write_t *req){
     duv_tls_t *t = base->wrapper_data;
     (void)req;
+    size_t len = t->write_buf.len;
 
-    // done with write buffer
+    // done with those bytes of the BIO pair
+    int ret = BIO_nread(t->raw, NULL, (int)len);
+    if(ret != (int)len){
+        TRACE_ORIG(&t->e, E_INTERNAL, "failed to consume from BIO pair");
+    }
+    t->stats.bytes_out += len;
     t->write_pending = false;
+    t->need_write = false;
 
     advance_state(t);
 }
@@ -108,7 +163,7 @@ static void await_cb(stream_i *base, derr_t e, link_t *reads, link_t *writes){
         // filter out our own read and write
         link_t ignore = {0};
         stream_reads_filter(reads, &ignore, read_cb);
-        stream_writes_filter(reads, &ignore, write_cb);
+        stream_writes_filter(writes, &ignore, write_cb);
         t->original_base_await_cb(base, E_OK, reads, writes);
     }
     advance_state(t);
@@ -183,7 +238,7 @@ static derr_type_t classify_verify_result(long r){
 
 static bool _advance_ssl_do_handshake(duv_tls_t *t){
     if(t->handshake_done) return true;
-    if(t->need_read) return true;
+    if(t->need_read || t->need_write) return true;
     ERR_clear_error();
     int ret = SSL_do_handshake(t->ssl);
     long lret;
@@ -194,9 +249,8 @@ static bool _advance_ssl_do_handshake(duv_tls_t *t){
                 return true;
 
             case SSL_ERROR_WANT_WRITE:
-                // we use a membio, so this is an ENOMEM
-                TRACE_ORIG(&t->e, E_NOMEM, "failed to write to write bio");
-                return false;
+                t->need_write = true;
+                return true;
 
             case SSL_ERROR_SSL:
                 // now we check for certificate handshake errors
@@ -255,6 +309,12 @@ static bool _advance_ssl_do_handshake(duv_tls_t *t){
         X509_free(peer_cert);
     }
 
+    if(t->client){
+        duv_tls_session_cache_t *c;
+        c = duv_tls_session_cache_get(SSL_get_SSL_CTX(t->ssl));
+        if(c) duv_tls_session_cache_count(c, SSL_session_reused(t->ssl));
+    }
+
     t->handshake_done = true;
     return true;
 }
@@ -284,23 +344,19 @@ static bool next_nonempty_write_req(duv_tls_t *t, stream_write_t **out){
 }
 
 static bool _advance_ssl_write(duv_tls_t *t){
-    // wait for an empty rawout
-    if(!BIO_eof(t->rawout)) return true;
-
-    // wait for the read that SSL_write wants
-    if(t->need_read) return true;
+    // wait for the read or write that SSL_write wants
+    if(t->need_read || t->need_write) return true;
 
     // get a write to work on
     stream_write_t *req;
     if(!next_nonempty_write_req(t, &req)) return false;
     if(!req) return true;
 
-    /* Detect completed writes and report them to the user.  We know that
-       rawout is empty now, so now is the first time that:
-         - we have a write req
-         - the whole write req has passed through SSL_write
-         - the whole rawout was pushed over the wire */
-    if(t->nbufswritten == req->nbufs && !t->write_pending){
+    /* Detect completed writes and report them to the user.  The first time
+       that the outgoing buffer is empty after the whole write req has passed
+       through SSL_write, the whole write req has been pushed over the wire */
+    if(t->nbufswritten == req->nbufs){
+        if(BIO_ctrl_pending(t->raw) || t->write_pending) return true;
         // done with this req
         t->nbufswritten = 0;
         link_remove(&req->link);
@@ -316,9 +372,6 @@ static bool _advance_ssl_write(duv_tls_t *t){
     while(t->nbufswritten < req->nbufs){
         const dstr_t buf = bufs[t->nbufswritten];
         while(t->nwritten < buf.len){
-            // no point in encrypting more than what our own write buf can hold
-            long blen = BIO_get_mem_data(t->rawout, NULL);
-            if((size_t)blen > t->write_buf.len) return true;
             size_t write_size = buf.len - t->nwritten;
             size_t nwritten;
             ERR_clear_error();
@@ -334,15 +387,17 @@ static bool _advance_ssl_write(duv_tls_t *t){
                         t->need_read = true;
                         return true;
                     case SSL_ERROR_WANT_WRITE:
-                        // we use a membio, so this is an ENOMEM
-                        TRACE_ORIG(&t->e, E_NOMEM, "write to membio failed");
-                        return false;
+                        // a bulk write filled the outgoing buffer
+                        t->need_write = true;
+                        if(t->out_size < DUV_TLS_BUF_MAX) t->grow_out = true;
+                        return true;
                     default:
                         TRACE_ORIG(&t->e, E_SSL, "SSL_write failed: %x", FSSL);
                         return false;
                 }
             }
             // one successful SSL_write, but maybe not a whole write req
+            t->stats.plain_out += nwritten;
             t->nwritten += nwritten;
             if(t->nwritten >= buf.len){
                 // done encrypting this buffer
@@ -359,11 +414,13 @@ static bool _advance_ssl_write(duv_tls_t *t){
 static bool _advance_ssl_read(duv_tls_t *t){
     // // note that the SSL object might have unread data from a record it has
     // // already processed, so our ability to read is not really connected to
-    // // how many bytes are present in t->rawin...
-    // if(BIO_eof(t->rawin)) return 0;
+    // // how many bytes are present in the incoming buffer...
+    // if(!BIO_ctrl_pending(SSL_get_rbio(t->ssl))) return 0;
 
     // ... unless the last call to SSL_read told us to wait for more bytes
     if(t->read_wants_read) return true;
+    // ... or to wait for the outgoing buffer to drain
+    if(t->need_write) return true;
 
     // process as many in-flight reads as we can
     link_t *link;
@@ -392,8 +449,8 @@ static bool _advance_ssl_read(duv_tls_t *t){
                     return true;
 
                 case SSL_ERROR_WANT_WRITE:
-                    TRACE_ORIG(&t->e, E_NOMEM, "write to membio failed");
-                    return false;
+                    t->need_write = true;
+                    return true;
 
                 default:
                     TRACE_ORIG(&t->e, E_SSL, "SSL_read failed: %x", FSSL);
@@ -402,6 +459,7 @@ static bool _advance_ssl_read(duv_tls_t *t){
         }
 
         // read success!
+        t->stats.plain_in += nread;
         read->buf.len = nread;
         read->cb(&t->iface, read, read->buf);
         // detect if user closed us
@@ -418,6 +476,8 @@ static bool _advance_ssl_shutdown(duv_tls_t *t){
     if(t->shutdown) return true;
     // wait for pending writes to finish
     if(!link_list_isempty(&t->writes)) return true;
+    // wait for the outgoing buffer to drain
+    if(t->need_write) return true;
 
     /* Note that SSL_shutdown can return 0 or 1 in success cases:
          - 0 means we wrote what we needed to the SSL object, but we don't have
@@ -441,9 +501,8 @@ static bool _advance_ssl_shutdown(duv_tls_t *t){
                 t->need_read = true;
                 return true;
             case SSL_ERROR_WANT_WRITE:
-                // we use a membio, so this is an ENOMEM
-                TRACE_ORIG(&t->e, E_NOMEM, "failed to write to write_bio");
-                return false;
+                t->need_write = true;
+                return true;
             default:
                 TRACE_ORIG(&t->e, E_SSL, "error in SSL_shutdown: %x", FSSL);
                 return false;
@@ -471,19 +530,12 @@ static bool _advance_tls(duv_tls_t *t){
     // no reads or writes until handshake completed and cert verified
     if(!t->handshake_done) return true;
 
-    // Initially I was concerned that the memory BIO might have strange
-    // behaviors if you did a partial reading from one end between writes to
-    // the other end.
-    //
-    // from the bio_s_mem manpage:
-    //
-    //     Unless the memory BIO is read only any data read from it is deleted
-    //     from the BIO.
-    //
-    // Therefore we can safely intermix calls to SSL_read/write/shutdown with
-    // BIO_read()ing from rawout.
-
-    // write any user requests to rawout
+    // The BIO pair is a pair of ring buffers, so calls to SSL_read/write/
+    // shutdown can safely intermix with base stream reads and writes which
+    // hold regions of those buffers, as long as nothing is committed to or
+    // consumed from a region until the base stream is done with it.
+
+    // write any user requests to the outgoing buffer
     if(!_advance_ssl_write(t)) return false;
 
     // read anything we've gotten from the wire
@@ -495,38 +547,65 @@ static bool _advance_tls(duv_tls_t *t){
     return true;
 }
 
+static void _advance_grow(duv_tls_t *t){
+    if(!t->grow_in && !t->grow_out) return;
+
+    // the BIO pair can only be swapped out while it is empty and idle
+    if(t->read_pending || t->write_pending) return;
+    if(BIO_ctrl_pending(t->raw)) return;
+    if(BIO_ctrl_pending(SSL_get_rbio(t->ssl))) return;
+
+    size_t in_size = t->in_size;
+    size_t out_size = t->out_size;
+    if(t->grow_in) in_size = MIN(2 * in_size, DUV_TLS_BUF_MAX);
+    if(t->grow_out) out_size = MIN(2 * out_size, DUV_TLS_BUF_MAX);
+    t->grow_in = false;
+    t->grow_out = false;
+
+    derr_t e = bio_pair(t, in_size, out_size);
+    CATCH_ANY(&e){
+        // the old buffers still work fine
+        DROP_VAR(&e);
+        return;
+    }
+    t->stats.grows++;
+}
+
 static void _advance_wire_reads(duv_tls_t *t){
     // one read in flight at a time
     if(t->read_pending) return;
     // respect backpressure; don't read without a good reason
     if(!t->read_wants_read && !t->need_read) return;
-    t->base->read(t->base, &t->read_req, t->read_buf, read_cb);
+    /* read directly into the BIO pair.  SSL has consumed everything it was
+       given before asking for more, so the buffer is never full here */
+    char *ptr;
+    int n = BIO_nwrite0(t->raw, &ptr);
+    if(n < 1){
+        LOG_FATAL("duv_tls found no space in BIO pair for reading\n");
+    }
+    dstr_t buf = {
+        .data = ptr, .len = 0, .size = (size_t)n, .fixed_size = true
+    };
+    t->base->read(t->base, &t->read_req, buf, read_cb);
     t->read_pending = true;
+    t->stats.base_reads++;
 }
 
-static bool _advance_wire_writes(duv_tls_t *t){
-    // make sure there's something to write
-    if(BIO_eof(t->rawout)) return true;
-
-    // make sure there's a write buffer to write to
-    if(t->write_pending) return true;
+static void _advance_wire_writes(duv_tls_t *t){
+    // one write in flight at a time
+    if(t->write_pending) return;
 
-    int ret = BIO_read_ex(
-        t->rawout, t->write_buf.data, t->write_buf.size, &t->write_buf.len
-    );
-    if(ret != 1){
-        TRACE_ORIG(&t->e, E_SSL, "failed to read from nonemtpy read bio");
-        return false;
-    }
-    if(t->write_buf.len < 1){
-        LOG_FATAL("duv_tls read zero bytes from non-empty BIO\n");
-    }
+    // write directly from the BIO pair, if there's anything to write
+    char *ptr;
+    int n = BIO_nread0(t->raw, &ptr);
+    if(n < 1) return;
+    t->write_buf = (dstr_t){
+        .data = ptr, .len = (size_t)n, .size = (size_t)n, .fixed_size = true
+    };
 
     t->base->write(t->base, &t->write_req, &t->write_buf, 1, write_cb);
-
-    // write was successful
     t->write_pending = true;
-    return true;
+    t->stats.base_writes++;
 }
 
 static void _advance_close(duv_tls_t *t){
@@ -558,13 +637,20 @@ static void _advance_close(duv_tls_t *t){
 static void advance_state(duv_tls_t *t){
     if(closing(t)) goto closing;
 
+    /* enlarge buffers for bulk transfers, which is only possible while they
+       are empty: before SSL refills the outgoing buffer after a write ... */
+    _advance_grow(t);
+
     // all the TLS-related stuff
     if(!_advance_tls(t)) goto closing;
 
-    // push rawout over the wire
-    if(!_advance_wire_writes(t)) goto closing;
+    // ... or after SSL has drained the incoming buffer
+    _advance_grow(t);
 
-    // request a read for rawin
+    // push the outgoing buffer over the wire
+    _advance_wire_writes(t);
+
+    // request a read for the incoming buffer
     _advance_wire_reads(t);
 
     // we may have completed a bidirection shutdown
@@ -714,25 +800,15 @@ static derr_t wrap(
     link_init(&t->reads);
     link_init(&t->writes);
 
-    PROP_GO(&e, dstr_new(&t->read_buf, 4096), fail);
-    PROP_GO(&e, dstr_new(&t->write_buf, 4096), fail);
-
     t->ssl = SSL_new(ssl_ctx);
     if(!t->ssl){
         ORIG_GO(&e, E_SSL, "error creating SSL object: %x", fail, FSSL);
     }
 
-    t->rawin = BIO_new(BIO_s_mem());
-    if(t->rawin == NULL){
-        ORIG_GO(&e, E_NOMEM, "unable to create BIO: %x", fail, FSSL);
-    }
-    SSL_set0_rbio(t->ssl, t->rawin);
+    PROP_GO(&e, bio_pair(t, DUV_TLS_BUF_MIN, DUV_TLS_BUF_MIN), fail);
 
-    t->rawout = BIO_new(BIO_s_mem());
-    if(t->rawout == NULL){
-        ORIG_GO(&e, E_NOMEM, "unable to create BIO: %x", fail, FSSL);
-    }
-    SSL_set0_wbio(t->ssl, t->rawout);
+    SSL_set_msg_callback(t->ssl, msg_cb);
+    SSL_set_msg_callback_arg(t->ssl, t);
 
     if(client){
         SSL_set_connect_state(t->ssl);
@@ -779,16 +855,30 @@ static derr_t wrap(
                 FSSL
             );
         }
+
+        // offer a cached session, if we have one
+        duv_tls_session_cache_t *c = duv_tls_session_cache_get(ssl_ctx);
+        SSL_SESSION *session = c ? duv_tls_session_cache_take(c, *verify_name)
+                                 : NULL;
+        if(session){
+            ret = SSL_set_session(t->ssl, session);
+            SSL_SESSION_free(session);
+            if(ret != 1){
+                ORIG_GO(&e,
+                    E_SSL, "error setting SSL session: %x", fail, FSSL
+                );
+            }
+        }
     }
 
     if(preinput.len){
-        // put preinput in rawin
+        // put preinput in the incoming buffer
         size_t nwritten;
         int ret = BIO_write_ex(
-            t->rawin, preinput.data, preinput.len, &nwritten
+            t->raw, preinput.data, preinput.len, &nwritten
         );
         if(ret != 1 || nwritten != preinput.len){
-            ORIG_GO(&e, E_NOMEM, "failed to write to membio", fail);
+            ORIG_GO(&e, E_PARAM, "preinput too long", fail);
         }
     }
 
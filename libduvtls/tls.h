@@ -20,6 +20,28 @@
 DUV_TLS_ERRNO_MAP(DUV_TLS_ERR_DECL)
 #undef DUV_TLS_ERR_DECL
 
+/* ciphertext buffers start big enough for one full TLS record, and double
+   (up to DUV_TLS_BUF_MAX) whenever a bulk transfer fills them */
+#define DUV_TLS_BUF_MIN SSL3_RT_MAX_PACKET_SIZE
+#define DUV_TLS_BUF_MAX (4 * DUV_TLS_BUF_MIN)
+
+typedef struct {
+    // ciphertext through the base stream
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    // plaintext through our own stream
+    uint64_t plain_in;
+    uint64_t plain_out;
+    // TLS records of any type, including handshake and alert records
+    uint64_t records_in;
+    uint64_t records_out;
+    // calls to base->read() and base->write()
+    uint64_t base_reads;
+    uint64_t base_writes;
+    // how many times the ciphertext buffers were enlarged
+    uint64_t grows;
+} duv_tls_stats_t;
+
 typedef struct {
     // the stream we provide
     stream_i iface;
@@ -29,17 +51,19 @@ typedef struct {
     stream_await_cb original_base_await_cb;
 
     SSL *ssl;
-    BIO *rawout;
-    BIO *rawin;
+    /* our half of a BIO pair; SSL has the other half.  Base stream reads land
+       directly in the pair's incoming buffer and base stream writes are made
+       directly from its outgoing buffer, so ciphertext is never copied */
+    BIO *raw;
+    size_t in_size;
+    size_t out_size;
     bool client;
     bool want_verify;
     scheduler_i *scheduler;
     schedulable_t schedulable;
 
-    // buffers for reading and writing from/to the base stream
-    dstr_t read_buf;
     stream_read_t read_req;
-    dstr_t write_buf;
+    dstr_t write_buf;  // a view into the BIO pair while write_pending
     stream_write_t write_req;
 
     link_t reads;  // stream_read_t->link
@@ -53,15 +77,24 @@ typedef struct {
     size_t nbufswritten;
     size_t nwritten;
 
+    // per-connection counters, for the owner to inspect at any time
+    duv_tls_stats_t stats;
+
     bool need_read : 1;  /* WANT_READ from SSL_{do_handshake,write,shutdown}
                             need read prevents us from doing anything without
                             more data to read */
+    bool need_write : 1;  /* WANT_WRITE from any SSL call: the outgoing buffer
+                             is full and nothing continues until a base stream
+                             write drains it */
     bool read_wants_read : 1;  /* WANT_READ returned from SSL_read.  Reads are
                                   blocked but other operations can continue */
     bool read_pending : 1;
 
     bool write_pending : 1;
 
+    bool grow_in : 1;
+    bool grow_out : 1;
+
     bool handshake_done : 1;
     bool shutdown : 1;
     bool base_canceled : 1;
@@ -37,6 +37,8 @@ static void read_cb(
         }
     }
 
+    // a lent buf is already a slice of our lendbuf
+    if(b->rread->lend && buf.len) b->lent = true;
     b->rread->buf = buf;
     b->rread->cb(&b->iface, b->rread, buf);
 
@@ -61,11 +63,21 @@ static void advance_state(borrow_rstream_t *b){
     link_t *link;
     if(closing(b)) goto closing;
 
+    // a lent slice must be released before we can reuse the lendbuf
+    if(b->lent) return;
+
     if(!b->reading && (link = link_list_pop_first(&b->reads))){
         b->rread = CONTAINER_OF(link, rstream_read_t, link);
+        dstr_t buf = b->rread->buf;
+        if(b->rread->lend){
+            // read into our lendbuf instead
+            size_t max = buf.size;
+            buf = b->lendbuf;
+            buf.size = MIN(buf.size, max);
+        }
         // submit to base stream
         b->reading = true;
-        stream_must_read(b->base, &b->sread, b->rread->buf, read_cb);
+        stream_must_read(b->base, &b->sread, buf, read_cb);
     }
 
     return;
@@ -109,6 +121,27 @@ static bool borrow_read(
     return true;
 }
 
+static bool borrow_lend(
+    rstream_i *iface,
+    rstream_read_t *read,
+    size_t max,
+    rstream_read_cb cb
+){
+    borrow_rstream_t *b = CONTAINER_OF(iface, borrow_rstream_t, iface);
+    if(!stream_lend_checks(iface, max)) return false;
+    rstream_lend_prep(read, max, cb);
+    link_list_append(&b->reads, &read->link);
+    schedule(b);
+    return true;
+}
+
+static void borrow_release(rstream_i *iface, rstream_read_t *read){
+    (void)read;
+    borrow_rstream_t *b = CONTAINER_OF(iface, borrow_rstream_t, iface);
+    b->lent = false;
+    schedule(b);
+}
+
 static void borrow_cancel(rstream_i *iface){
     borrow_rstream_t *b = CONTAINER_OF(iface, borrow_rstream_t, iface);
     b->iface.canceled = true;
@@ -128,7 +161,10 @@ static rstream_await_cb borrow_await(
 }
 
 rstream_i *borrow_rstream(
-    borrow_rstream_t *b, scheduler_i *scheduler, stream_i *base
+    borrow_rstream_t *b,
+    scheduler_i *scheduler,
+    stream_i *base,
+    dstr_t lendbuf
 ){
     *b = (borrow_rstream_t){
         .iface = {
@@ -142,7 +178,13 @@ rstream_i *borrow_rstream(
         .scheduler = scheduler,
         .base = base,
         .original_await_cb = base->await(base, await_cb),
+        .lendbuf = lendbuf,
     };
+    if(lendbuf.size){
+        b->lendbuf.len = 0;
+        b->iface.lend = borrow_lend;
+        b->iface.release = borrow_release;
+    }
     link_init(&b->reads);
     schedulable_prep(&b->schedulable, schedule_cb);
     base->wrapper_data = b;
@@ -6,7 +6,10 @@ typedef struct {
     derr_t e;
     bool base_canceled : 1;
     bool reading : 1;
+    bool lent : 1;
     stream_await_cb original_await_cb;
+    // lends are read into this memory, which we do not own
+    dstr_t lendbuf;
     // one read in flight at a time
     link_t reads;
     rstream_read_t *rread;
@@ -16,6 +19,11 @@ typedef struct {
 DEF_CONTAINER_OF(borrow_rstream_t, iface, rstream_i)
 DEF_CONTAINER_OF(borrow_rstream_t, schedulable, schedulable_t)
 
+/* lendbuf is optional; if it has a nonzero size then the borrow_rstream_t
+   supports lending, by reading into lendbuf, which must outlive it */
 rstream_i *borrow_rstream(
-    borrow_rstream_t *b, scheduler_i *scheduler, stream_i *base
+    borrow_rstream_t *b,
+    scheduler_i *scheduler,
+    stream_i *base,
+    dstr_t lendbuf
 );
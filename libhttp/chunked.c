@@ -152,6 +152,9 @@ static void advance_chunks(chunked_rstream_t *c, bool *complete){
     // wait for any in-flight read to return
     if(c->reading) return;
 
+    // wait for any lent bytes to be released before touching buf
+    if(c->lent) return;
+
     // wait for user to read
     while(!link_list_isempty(&c->reads)){
         // pass along any bytes that are ready to be consumed
@@ -160,7 +163,11 @@ static void advance_chunks(chunked_rstream_t *c, bool *complete){
             link_t *link = link_list_pop_first(&c->reads);
             rstream_read_t *read = CONTAINER_OF(link, rstream_read_t, link);
             dstr_t sub = dstr_sub2(readable, 0, read->buf.size);
-            if(dstr_append_quiet(&read->buf, &sub) != E_NONE){
+            if(read->lend){
+                // lend straight out of our buf
+                read->buf = sub;
+                c->lent = true;
+            }else if(dstr_append_quiet(&read->buf, &sub) != E_NONE){
                 LOG_FATAL("dstr_append_quiet failure in chunked_rstream_t\n");
             }
             c->nbufread += sub.len;
@@ -178,6 +185,8 @@ static void advance_chunks(chunked_rstream_t *c, bool *complete){
             read->cb(&c->iface, read, read->buf);
             // detect if user canceled us
             if(closing(c)) return;
+            // if we lent bytes out, wait for them to come back
+            if(c->lent) return;
             // if no more reads from the user, we are done here
             if(link_list_isempty(&c->reads)) return;
         }
@@ -211,6 +220,9 @@ static void advance_trailer(chunked_rstream_t *c, bool *complete){
     // wait for any pending read to complete
     if(c->reading) return;
 
+    // wait for any lent bytes to be released before touching buf
+    if(c->lent) return;
+
     size_t initial_nbufread = c->nbufread;
     dstr_t buf = dstr_sub2(c->buf, c->nbufread, SIZE_MAX);
     web_scanner_t s = web_scanner(&buf);
@@ -363,6 +375,27 @@ static bool chunked_read(
     return true;
 }
 
+static bool chunked_lend(
+    rstream_i *iface,
+    rstream_read_t *read,
+    size_t max,
+    rstream_read_cb cb
+){
+    chunked_rstream_t *c = CONTAINER_OF(iface, chunked_rstream_t, iface);
+    if(!stream_lend_checks(iface, max)) return false;
+    rstream_lend_prep(read, max, cb);
+    link_list_append(&c->reads, &read->link);
+    schedule(c);
+    return true;
+}
+
+static void chunked_release(rstream_i *iface, rstream_read_t *read){
+    (void)read;
+    chunked_rstream_t *c = CONTAINER_OF(iface, chunked_rstream_t, iface);
+    c->lent = false;
+    schedule(c);
+}
+
 static void chunked_cancel(rstream_i *iface){
     chunked_rstream_t *c = CONTAINER_OF(iface, chunked_rstream_t, iface);
     c->iface.canceled = true;
@@ -396,6 +429,8 @@ rstream_i *chunked_rstream(
             .read = chunked_read,
             .cancel = chunked_cancel,
             .await = chunked_await,
+            .lend = chunked_lend,
+            .release = chunked_release,
         },
         .base = base,
         .try_detach = try_detach,
@@ -26,6 +26,8 @@ struct chunked_rstream_t {
     rstream_read_t read;
     derr_t e;
     bool reading : 1;
+    // bytes of buf are lent to the user until they call release()
+    bool lent : 1;
     bool first_chunk_parsed : 1;
     bool base_canceled : 1;
     bool tried_detach : 1;
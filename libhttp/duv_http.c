@@ -10,9 +10,12 @@ static void req_cancel(duv_http_req_t *req);
 static void req_start(duv_http_req_t *req, http_mem_t *mem);
 
 static void duv_http_free_allocations(duv_http_t *h){
-    dstr_free(&h->mem.write_buf);
-    dstr_free(&h->mem.read_buf);
-    if(h->own_ssl_ctx && h->mem.ssl_ctx) SSL_CTX_free(h->mem.ssl_ctx);
+    for(size_t i = 0; i < DUV_HTTP_MAX_CONNS; i++){
+        dstr_free(&h->mems[i].write_buf);
+        dstr_free(&h->mems[i].read_buf);
+    }
+    duv_tls_session_cache_free(&h->session_cache);
+    if(h->own_ssl_ctx && h->ssl_ctx) SSL_CTX_free(h->ssl_ctx);
 }
 
 static void http_schedule_cb(schedulable_t *schedulable){
@@ -25,61 +28,120 @@ static void http_schedule(duv_http_t *h){
 }
 
 static void timer_cb(uv_timer_t *timer){
-    duv_http_t *h = timer->data;
+    http_mem_t *m = timer->data;
     // just cancel the stream, no advance_state is necessary
-    if(h->mem.stream) h->mem.stream->cancel(h->mem.stream);
+    if(m->stream) m->stream->cancel(m->stream);
 }
 
 static void timer_close_cb(uv_handle_t *handle){
-    duv_http_t *h = handle->data;
-    h->timer_close_complete = true;
-    http_advance_state(h);
+    http_mem_t *m = handle->data;
+    m->timer_close_complete = true;
+    http_advance_state(m->http);
+}
+
+// is this connection, or the request on it, for the same server as req?
+static bool mem_matches(http_mem_t *m, duv_http_req_t *req){
+    if(m->req){
+        return m->req->tls == req->tls
+            && m->req->port == req->port
+            && dstr_eq(m->req->host, req->host);
+    }
+    if(!m->stream) return false;
+    return m->tls == req->tls
+        && m->port == req->port
+        && dstr_eq(m->host, req->host);
+}
+
+// returns NULL if req must keep waiting
+static http_mem_t *http_pick_mem(duv_http_t *h, duv_http_req_t *req){
+    http_mem_t *reuse = NULL;
+    http_mem_t *empty = NULL;
+    http_mem_t *evict = NULL;
+    size_t nhost = 0;
+
+    size_t nmems = MIN(h->max_conns, DUV_HTTP_MAX_CONNS);
+    for(size_t i = 0; i < nmems; i++){
+        http_mem_t *m = &h->mems[i];
+        bool match = mem_matches(m, req);
+        if(match) nhost++;
+        if(m->req) continue;
+        if(match && !m->stream->canceled){
+            // an idle persistent connection to the right server
+            if(!reuse) reuse = m;
+        }else if(!m->stream){
+            if(!empty) empty = m;
+        }else{
+            // idle but connected elsewhere, or already closing
+            if(!evict) evict = m;
+        }
+    }
+
+    if(reuse) return reuse;
+    if(nhost >= h->max_conns_per_host) return NULL;
+    // prefer not to close a connection someone else might reuse
+    return empty ? empty : evict;
+}
+
+// the first pending request which can start now, in order
+static duv_http_req_t *http_next_startable(duv_http_t *h, http_mem_t **mem){
+    duv_http_req_t *req;
+    LINK_FOR_EACH(req, &h->pending, duv_http_req_t, link){
+        if((*mem = http_pick_mem(h, req))) return req;
+    }
+    return NULL;
 }
 
 static void http_advance_state(duv_http_t *h){
-    link_t *link;
+    duv_http_req_t *req;
+    http_mem_t *m;
 
     if(h->closed) return;
 
     if(h->closing) goto closing;
 
-    // wait for the current request to finish
-    if(h->req) return;
-
-    // wait for a pending request
-    if(!(link = link_list_pop_first(&h->pending))) return;
-    duv_http_req_t *req = CONTAINER_OF(link, duv_http_req_t, link);
-
-    // start the request
-    h->req = req;
-    req_start(req, &h->mem);
-    // cancel any idle timer
-    duv_timer_must_stop(&h->timer);
+    // start every pending request which has a connection available
+    while((req = http_next_startable(h, &m))){
+        link_remove(&req->link);
+        m->req = req;
+        // cancel any idle timer
+        duv_timer_must_stop(&m->timer);
+        req_start(req, m);
+    }
 
     return;
 
 closing:
     // wait for our requests to be canceled
-    if(h->req || !link_list_isempty(&h->pending)) return;
+    if(!link_list_isempty(&h->pending)) return;
+
+    bool busy = false;
+    for(size_t i = 0; i < DUV_HTTP_MAX_CONNS; i++){
+        m = &h->mems[i];
+        if(m->req){
+            busy = true;
+            continue;
+        }
 
-    // the connector must be inactive already
-    if(h->mem.connector.active){
-        LOG_FATAL("a req finished with connector.active == true\n");
-    }
+        // the connector must be inactive already
+        if(m->connector.active){
+            LOG_FATAL("a req finished with connector.active == true\n");
+        }
 
-    // close any active connection
-    if(h->mem.stream){
-        h->mem.stream->cancel(h->mem.stream);
-        return;
-    }
+        // close any active connection
+        if(m->stream){
+            m->stream->cancel(m->stream);
+            busy = true;
+            continue;
+        }
 
-    if(!h->timer_closed){
-        h->timer_closed = true;
-        duv_timer_must_stop(&h->timer);
-        uv_close(duv_timer_handle(&h->timer), timer_close_cb);
-        return;
+        if(!m->timer_closed){
+            m->timer_closed = true;
+            duv_timer_must_stop(&m->timer);
+            uv_close(duv_timer_handle(&m->timer), timer_close_cb);
+        }
+        if(!m->timer_close_complete) busy = true;
     }
-    if(!h->timer_close_complete) return;
+    if(busy) return;
 
     // done!
     duv_http_free_allocations(h);
@@ -94,12 +156,15 @@ bool duv_http_close(duv_http_t *h, duv_http_close_cb close_cb){
     h->closing = true;
     h->close_cb = close_cb;
 
-    if(h->req) req_cancel(h->req);
+    for(size_t i = 0; i < DUV_HTTP_MAX_CONNS; i++){
+        http_mem_t *m = &h->mems[i];
+        if(m->req) req_cancel(m->req);
+        duv_timer_must_stop(&m->timer);
+    }
     duv_http_req_t *req;
     LINK_FOR_EACH(req, &h->pending, duv_http_req_t, link){
         req_cancel(req);
     }
-    duv_timer_must_stop(&h->timer);
 
     http_schedule(h);
     return true;
@@ -119,18 +184,22 @@ derr_t duv_http_init(
         .data = h->data,
         .loop = loop,
         .scheduler = scheduler,
-        .mem = {
-            .ssl_ctx = ssl_ctx,
-        },
+        .max_conns = DUV_HTTP_MAX_CONNS,
+        .max_conns_per_host = DUV_HTTP_MAX_CONNS_PER_HOST,
+        .ssl_ctx = ssl_ctx,
         .own_ssl_ctx = !ssl_ctx,
         .initialized = true,
     };
 
-    // read_buf size is effectively the longest-allowed line length
-    DSTR_WRAP_ARRAY(h->mem.host, h->mem._host);
-    PROP_GO(&e, dstr_new(&h->mem.read_buf, 8192), fail);
-    // but write_buf size does not correspond to any restrictions
-    PROP_GO(&e, dstr_new(&h->mem.write_buf, 4096), fail);
+    for(size_t i = 0; i < DUV_HTTP_MAX_CONNS; i++){
+        http_mem_t *m = &h->mems[i];
+        m->http = h;
+        DSTR_WRAP_ARRAY(m->host, m->_host);
+        // read_buf size is effectively the longest-allowed line length
+        PROP_GO(&e, dstr_new(&m->read_buf, 8192), fail);
+        // but write_buf size does not correspond to any restrictions
+        PROP_GO(&e, dstr_new(&m->write_buf, 4096), fail);
+    }
 
     // success
 
@@ -138,8 +207,11 @@ derr_t duv_http_init(
     schedulable_prep(&h->schedulable, http_schedule_cb);
     // http_reader_t is not initialized until a req_start()
 
-    duv_timer_must_init(loop, &h->timer);
-    h->timer.data = h;
+    for(size_t i = 0; i < DUV_HTTP_MAX_CONNS; i++){
+        http_mem_t *m = &h->mems[i];
+        duv_timer_must_init(loop, &m->timer);
+        m->timer.data = m;
+    }
 
     return e;
 
@@ -153,9 +225,9 @@ fail:
 static void http_await_cb(
     stream_i *stream, derr_t e, link_t *reads, link_t *writes
 ){
-    duv_http_t *h = stream->data;
+    http_mem_t *m = stream->data;
 
-    h->mem.stream = NULL;
+    m->stream = NULL;
 
     // don't even log E_CANCELED
     DROP_CANCELED_VAR(&e);
@@ -174,19 +246,23 @@ static void http_await_cb(
         LOG_FATAL("http_await_cb had unfinished writes\n");
     }
 
-    http_schedule(h);
+    http_schedule(m->http);
 }
 
 static void http_completed_req(duv_http_t *h, duv_http_req_t *req){
-    if(h->req == req){
-        // this was the active req
-        h->req = NULL;
-        if(h->mem.stream){
+    http_mem_t *m = NULL;
+    for(size_t i = 0; i < DUV_HTTP_MAX_CONNS; i++){
+        if(h->mems[i].req == req) m = &h->mems[i];
+    }
+    if(m){
+        // this req was active
+        m->req = NULL;
+        if(m->stream){
             // we are now responsible for the stream
-            h->mem.stream->data = h;
-            h->mem.stream->await(h->mem.stream, http_await_cb);
+            m->stream->data = m;
+            m->stream->await(m->stream, http_await_cb);
             // start idle timer
-            duv_timer_must_start(&h->timer, timer_cb, IDLE_MS);
+            duv_timer_must_start(&m->timer, timer_cb, IDLE_MS);
         }
     }else{
         // this req was pending
@@ -308,10 +384,15 @@ static void connect_cb(duv_connect_t *connector, derr_t e){
     // decect when we don't want tls or when there's no point
     if(!req->tls || req_failing(req)) goto done;
     // do we need to create a default ssl_ctx?
-    if(!m->ssl_ctx){
+    duv_http_t *h = req->http;
+    if(!h->ssl_ctx){
         ssl_context_t ssl_ctx;
         PROP_GO(&req->e, ssl_context_new_client(&ssl_ctx), done);
-        m->ssl_ctx = ssl_ctx.ctx;
+        h->ssl_ctx = ssl_ctx.ctx;
+        // resume sessions when we reconnect after an idle timeout
+        PROP_GO(&req->e,
+            duv_tls_session_cache_init(&h->session_cache, h->ssl_ctx),
+        done);
     }
     stream_i *tls_stream;
     dstr_t verify_name = m->host;
@@ -321,7 +402,7 @@ static void connect_cb(duv_connect_t *connector, derr_t e){
     PROP_GO(&req->e,
         duv_tls_wrap_client(
             &m->duv_tls,
-            m->ssl_ctx,
+            h->ssl_ctx,
             verify_name,
             req->scheduler,
             m->stream,
@@ -678,7 +759,11 @@ static rstream_i *req_configure_base(duv_http_req_t *req){
         &m->initial_body, req->scheduler, sub
     );
 
-    rstream_i *borrow = borrow_rstream(&m->borrow, req->scheduler, m->stream);
+    /* by the time the borrow is read, the headers and initial body in
+       read_buf have been consumed, so we can lend out of read_buf */
+    rstream_i *borrow = borrow_rstream(
+        &m->borrow, req->scheduler, m->stream, m->read_buf
+    );
 
     rstream_i *concat = rstream_concat(
         &m->concat, req->scheduler, initial_body, borrow
@@ -743,6 +828,7 @@ static void req_advance_state(duv_http_req_t *req){
             // start a new connection
             PROP_GO(&req->e, dstr_copy(&req->host, &m->host), failing);
             m->port = req->port;
+            m->tls = req->tls;
             DSTR_VAR(portbuf, 32);
             PROP_GO(&req->e, FMT(&portbuf, "%x", FU(m->port)), failing);
             m->connector.data = req;
@@ -794,7 +880,9 @@ static void req_advance_state(duv_http_req_t *req){
             // submit another read to the rstream
             req->reading = true;
             req->original_read_cb = read->cb;
-            stream_must_read(req->base, read, read->buf, req_read_cb_body);
+            rstream_must_forward(
+                req->base, read, read->buf, req_read_cb_body
+            );
             break;
         }
         // respond eof to remaining reads
@@ -890,6 +978,31 @@ static bool req_read(
     return true;
 }
 
+static bool req_lend(
+    rstream_i *iface,
+    rstream_read_t *read,
+    size_t max,
+    rstream_read_cb cb
+){
+    if(!stream_lend_checks(iface, max)) return false;
+
+    duv_http_req_t *req = CONTAINER_OF(iface, duv_http_req_t, iface);
+
+    rstream_lend_prep(read, max, cb);
+    link_list_append(&req->reads, &read->link);
+
+    // only schedule if there's a chance we can actually process this read
+    if(req->base) req_schedule(req);
+
+    return true;
+}
+
+static void req_release(rstream_i *iface, rstream_read_t *read){
+    duv_http_req_t *req = CONTAINER_OF(iface, duv_http_req_t, iface);
+    // every layer of our base lends, so this always goes to the base
+    req->base->release(req->base, read);
+}
+
 static void req_cancel(duv_http_req_t *req){
     if(req->iface.awaited || req->iface.canceled) return;
     req->iface.canceled = true;
@@ -948,6 +1061,8 @@ rstream_i *duv_http_req_ex(
             .read = req_read,
             .cancel = req_rstream_cancel,
             .await = req_await,
+            .lend = req_lend,
+            .release = req_release,
         },
         .http = http,
         .scheduler = &http->scheduler->iface,
@@ -6,8 +6,16 @@ typedef struct duv_http_req_t duv_http_req_t;
 
 typedef void (*duv_http_close_cb)(duv_http_t*);
 
-// memory stored per-http rather than per-req
+// memory stored per-connection rather than per-req
 typedef struct {
+    duv_http_t *http;
+    // the request currently using this connection, if any
+    duv_http_req_t *req;
+    // idle timer, for closing a persistent connection nobody is using
+    uv_timer_t timer;
+    bool timer_closed : 1;
+    bool timer_close_complete : 1;
+
     dstr_t write_buf;
     dstr_t read_buf;
     // how much of read_buf was headers vs initial body
@@ -28,7 +36,6 @@ typedef struct {
     uv_tcp_t tcp;
     duv_passthru_t passthru;
     duv_tls_t duv_tls;
-    SSL_CTX *ssl_ctx;
     stream_i *stream;
     time_t since;
 
@@ -41,38 +48,50 @@ typedef struct {
     stream_read_t read;
 } http_mem_t;
 
-/* A struct for a series of requests from a libuv event loop, capable of
-   handling persistent connections.
+// size of a duv_http_t's connection pool, and the default for .max_conns
+#define DUV_HTTP_MAX_CONNS 4
+// default for duv_http_t.max_conns_per_host
+#define DUV_HTTP_MAX_CONNS_PER_HOST 2
+
+/* A struct for requests from a libuv event loop, capable of handling
+   persistent connections.
 
-   If you send another request to a new server, it will automatically connect
-   to the new server and persist connections to that server. */
+   Each request runs on one of a small pool of connections.  A request reuses
+   an idle connection to its server when there is one, otherwise it opens a
+   new connection, as long as its server has fewer than max_conns_per_host
+   connections.  Requests to a server at its limit wait in line, but they do
+   not block requests to other servers. */
 struct duv_http_t {
     void *data;
 
     uv_loop_t *loop;
-    uv_timer_t timer;
     duv_scheduler_t *scheduler;
     schedulable_t schedulable;
 
     // debug flags, can be set at runtime
     bool log_requests;
 
+    /* connection limits, can be set at runtime, but they only affect
+       requests not yet started */
+    size_t max_conns;  // no more than DUV_HTTP_MAX_CONNS
+    size_t max_conns_per_host;
+
     duv_http_close_cb close_cb;
 
-    http_mem_t mem;
+    SSL_CTX *ssl_ctx;
+    // only used with our own ssl_ctx; a caller's ssl_ctx may have its own
+    duv_tls_session_cache_t session_cache;
+
+    http_mem_t mems[DUV_HTTP_MAX_CONNS];
 
-    // pending requests
+    // requests which have not been given a connection yet
     link_t pending;  // duv_http_req_t->link
-    // current request
-    duv_http_req_t *req;
 
     bool initialized : 1;
     bool reqs_canceled : 1;
     bool closing : 1;
     bool closed : 1;
     bool own_ssl_ctx : 1;
-    bool timer_closed : 1;
-    bool timer_close_complete : 1;
 };
 DEF_CONTAINER_OF(duv_http_t, schedulable, schedulable_t)
 
@@ -29,7 +29,12 @@ static void read_cb(rstream_i *base, rstream_read_t *read, dstr_t buf){
         TRACE_ORIG(&l->e, E_RESPONSE, "unexpected EOF");
     }
 
-    buf.size = l->original_read_buf_size;
+    if(read->lend){
+        // a lent buf is the base's memory, which we should leave alone
+        if(buf.len) l->lent = true;
+    }else{
+        buf.size = l->original_read_buf_size;
+    }
     read->cb = l->original_read_cb;
     read->buf = buf;
     read->cb(&l->iface, read, buf);
@@ -57,6 +62,9 @@ static void advance_state(limit_rstream_t *l){
     link_t *link;
     if(closing(l)) goto closing;
 
+    // a lent slice must be released before we might detach from the base
+    if(l->lent) return;
+
     if(!l->reading && (link = link_list_pop_first(&l->reads))){
         rstream_read_t *read = CONTAINER_OF(link, rstream_read_t, link);
 
@@ -79,7 +87,7 @@ static void advance_state(limit_rstream_t *l){
 
         // submit to base stream
         l->reading = true;
-        stream_must_read(l->base, read, read->buf, read_cb);
+        rstream_must_forward(l->base, read, read->buf, read_cb);
     }
 
     return;
@@ -123,6 +131,27 @@ static bool limit_read(
     return true;
 }
 
+static bool limit_lend(
+    rstream_i *iface,
+    rstream_read_t *read,
+    size_t max,
+    rstream_read_cb cb
+){
+    limit_rstream_t *l = CONTAINER_OF(iface, limit_rstream_t, iface);
+    if(!stream_lend_checks(iface, max)) return false;
+    rstream_lend_prep(read, max, cb);
+    link_list_append(&l->reads, &read->link);
+    schedule(l);
+    return true;
+}
+
+static void limit_release(rstream_i *iface, rstream_read_t *read){
+    limit_rstream_t *l = CONTAINER_OF(iface, limit_rstream_t, iface);
+    l->lent = false;
+    l->base->release(l->base, read);
+    schedule(l);
+}
+
 static void limit_cancel(rstream_i *iface){
     limit_rstream_t *l = CONTAINER_OF(iface, limit_rstream_t, iface);
     l->iface.canceled = true;
@@ -165,6 +194,11 @@ rstream_i *limit_rstream(
         .scheduler = scheduler,
         .limit = limit,
     };
+    // we can only lend what our base can lend
+    if(base->lend){
+        l->iface.lend = limit_lend;
+        l->iface.release = limit_release;
+    }
     link_init(&l->reads);
     schedulable_prep(&l->schedulable, schedule_cb);
     base->wrapper_data = l;
@@ -18,6 +18,7 @@ struct limit_rstream_t {
     // one read in flight at a time
     bool reading : 1;
     bool detached : 1;
+    bool lent : 1;
     link_t reads;
     rstream_await_cb await_cb;
 };
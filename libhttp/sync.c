@@ -78,25 +78,17 @@ fail:
     stream_reader_cancel(&sreq->reader);
 }
 
-derr_t http_sync_req(
+static rstream_i *sync_req_start(
+    sync_req_t *sreq,
     http_sync_t *sync,
     http_method_e method,
     url_t url,
     http_pairs_t *params,
     http_pairs_t *hdrs,
-    const dstr_t body,
-    // headers you want to receive
-    hdr_selector_t *selectors,
-    int *status,
-    dstr_t *reason, // limited to 256 characters
-    dstr_t *resp
+    const dstr_t body
 ){
-    derr_t e = E_OK;
-
-    sync_req_t sreq = { selectors };
-
-    rstream_i *rstream = duv_http_req(
-        &sreq.req,
+    return duv_http_req(
+        &sreq->req,
         &sync->http,
         method,
         url,
@@ -105,11 +97,13 @@ derr_t http_sync_req(
         body,
         sync_req_hdr_cb
     );
+}
 
-    stream_read_all(&sreq.reader, rstream, resp, sync_req_reader_cb);
+static void sync_req_drain(sync_req_t *sreq, http_sync_t *sync){
+    derr_t e = E_OK;
 
     // drain events until we see our reader cb
-    while(!sreq.done){
+    while(!sreq->done){
         /* use UV_RUN_ONCE because when we finish a request, there's likely a
            timer open for the socket we haven't closed yet */
         IF_PROP(&e, duv_step(&sync->loop) ){
@@ -117,6 +111,32 @@ derr_t http_sync_req(
             LOG_FATAL("uv_run() failed: %x\n", FD(e.msg));
         }
     }
+}
+
+derr_t http_sync_req(
+    http_sync_t *sync,
+    http_method_e method,
+    url_t url,
+    http_pairs_t *params,
+    http_pairs_t *hdrs,
+    const dstr_t body,
+    // headers you want to receive
+    hdr_selector_t *selectors,
+    int *status,
+    dstr_t *reason, // limited to 256 characters
+    dstr_t *resp
+){
+    derr_t e = E_OK;
+
+    sync_req_t sreq = { selectors };
+
+    rstream_i *rstream = sync_req_start(
+        &sreq, sync, method, url, params, hdrs, body
+    );
+
+    stream_read_all(&sreq.reader, rstream, resp, sync_req_reader_cb);
+
+    sync_req_drain(&sreq, sync);
 
     // detect in-loop failures
     PROP_VAR(&e, &sreq.e);
@@ -127,3 +147,45 @@ derr_t http_sync_req(
 
     return e;
 }
+
+derr_t http_sync_req_json(
+    http_sync_t *sync,
+    http_method_e method,
+    url_t url,
+    http_pairs_t *params,
+    http_pairs_t *hdrs,
+    const dstr_t body,
+    // headers you want to receive
+    hdr_selector_t *selectors,
+    int *status,
+    dstr_t *reason, // limited to 256 characters
+    json_parser_t *parser
+){
+    derr_t e = E_OK;
+
+    sync_req_t sreq = { selectors };
+    // only used if the response body can't be lent to us
+    dstr_t buf = {0};
+
+    rstream_i *rstream = sync_req_start(
+        &sreq, sync, method, url, params, hdrs, body
+    );
+
+    stream_read_json(&sreq.reader, rstream, &buf, parser, sync_req_reader_cb);
+
+    sync_req_drain(&sreq, sync);
+
+    dstr_free(&buf);
+
+    // copy outputs first, since a body may be invalid for a good reason
+    *status = sreq.req.status;
+    IF_PROP(&e, dstr_copy(&sreq.req.reason, reason) ){
+        DROP_VAR(&sreq.e);
+        return e;
+    }
+
+    // detect in-loop failures
+    PROP_VAR(&e, &sreq.e);
+
+    return e;
+}
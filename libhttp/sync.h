@@ -34,3 +34,20 @@ derr_t http_sync_req(
     dstr_t *reason, // output is limited to 256 characters
     dstr_t *resp
 );
+
+/* like http_sync_req, but the response body is parsed as it arrives rather
+   than being buffered; status and reason are set even if the body turns out
+   to be invalid json (E_PARAM), such as for an error status */
+derr_t http_sync_req_json(
+    http_sync_t *sync,
+    http_method_e method,
+    url_t url,
+    http_pairs_t *params,
+    http_pairs_t *hdrs,
+    const dstr_t body,
+    // headers you want to receive
+    hdr_selector_t *selectors,
+    int *status,
+    dstr_t *reason, // output is limited to 256 characters
+    json_parser_t *parser
+);
@@ -65,7 +65,7 @@ static derr_t test_borrow(void){
     borrow_rstream_t borrow;
 
     stream_i *base = dstr_stream(&dstr_s, sched, rbase, &wbase);
-    rstream_i *r = borrow_rstream(&borrow, sched, base);
+    rstream_i *r = borrow_rstream(&borrow, sched, base, (dstr_t){0});
     stream_must_await_first(r, await_cb);
 
     rstream_read_t read1, read2;
@@ -89,7 +89,7 @@ static derr_t test_borrow(void){
     // reset, then cancel the borrow stream
     finished = false;
     base = dstr_stream(&dstr_s, sched, rbase, &wbase);
-    r = borrow_rstream(&borrow, sched, base);
+    r = borrow_rstream(&borrow, sched, base, (dstr_t){0});
     stream_must_await_first(r, await_cb);
 
     r->cancel(r);
@@ -104,7 +104,7 @@ static derr_t test_borrow(void){
     // reset, then cancel the underlying stream
     finished = false;
     base = dstr_stream(&dstr_s, sched, rbase, &wbase);
-    r = borrow_rstream(&borrow, sched, base);
+    r = borrow_rstream(&borrow, sched, base, (dstr_t){0});
     stream_must_await_first(r, await_cb);
 
     base->cancel(base);
@@ -118,7 +118,7 @@ static derr_t test_borrow(void){
     // reset, then cause a failure in the underlying stream
     finished = false;
     base = dstr_stream(&dstr_s, sched, rbase, &wbase);
-    r = borrow_rstream(&borrow, sched, base);
+    r = borrow_rstream(&borrow, sched, base, (dstr_t){0});
     stream_must_await_first(r, await_cb);
 
     stream_write_t write;
@@ -133,12 +133,68 @@ static derr_t test_borrow(void){
     return e;
 }
 
+static void lend_cb(rstream_i *rstream, rstream_read_t *read, dstr_t buf){
+    dstr_t *got = read->data;
+    IF_PROP(&E, dstr_append(got, &buf) ){
+        rstream->cancel(rstream);
+        return;
+    }
+    if(!buf.len) return;
+    rstream->release(rstream, read);
+    rstream_must_lend(rstream, read, 5, lend_cb);
+}
+
+static derr_t test_borrow_lend(void){
+    derr_t e = E_OK;
+
+    manual_scheduler_t scheduler;
+    scheduler_i *sched = manual_scheduler(&scheduler);
+
+    dstr_stream_t dstr_s;
+    DSTR_STATIC(rbase, "hello world!");
+    DSTR_VAR(wbase, 1);
+
+    borrow_rstream_t borrow;
+    DSTR_VAR(lendbuf, 8);
+    DSTR_VAR(got, 32);
+
+    finished = false;
+    stream_i *base = dstr_stream(&dstr_s, sched, rbase, &wbase);
+    rstream_i *r = borrow_rstream(&borrow, sched, base, lendbuf);
+    stream_must_await_first(r, await_cb);
+
+    rstream_read_t read = { .data = &got };
+    rstream_must_lend(r, &read, 5, lend_cb);
+
+    manual_scheduler_run(&scheduler);
+
+    PROP_VAR(&e, &E);
+    if(!finished) ORIG(&e, E_VALUE, "borrow did not finish");
+    EXPECT_D3(&e, "got", got, rbase);
+
+    // without a lendbuf, there is no lending
+    finished = false;
+    base = dstr_stream(&dstr_s, sched, rbase, &wbase);
+    r = borrow_rstream(&borrow, sched, base, (dstr_t){0});
+    EXPECT_NULL(&e, "lend", r->lend);
+    stream_must_await_first(r, await_cb);
+    r->cancel(r);
+
+    manual_scheduler_run(&scheduler);
+
+    EXPECT_E_VAR(&e, "E", &E, E_CANCELED);
+    if(!finished) ORIG(&e, E_VALUE, "borrow did not finish");
+
+    return e;
+}
+
 int main(int argc, char **argv){
     derr_t e = E_OK;
     // parse options and set default log level
     PARSE_TEST_OPTIONS(argc, argv, NULL, LOG_LVL_INFO);
 
     PROP_GO(&e, test_borrow(), test_fail);
+    PROP_GO(&e, test_borrow_lend(), test_fail);
 
     LOG_ERROR("PASS\n");
     return 0;
@@ -299,12 +299,111 @@ done:
     return e;
 }
 
+typedef struct {
+    char _got[64];
+    dstr_t got;
+    bool eof;
+    bool awaited;
+    derr_t e;
+} lender_t;
+
+static void lend_cb(rstream_i *r, rstream_read_t *read, dstr_t buf){
+    (void)read;
+    lender_t *l = r->data;
+    if(!buf.len){
+        l->eof = true;
+        return;
+    }
+    TRACE_PROP(&l->e, dstr_append(&l->got, &buf) );
+}
+
+static void lend_await_cb(rstream_i *r, derr_t e, link_t *reads){
+    (void)reads;
+    lender_t *l = r->data;
+    l->awaited = true;
+    TRACE_PROP_VAR(&l->e, &e);
+}
+
+static derr_t test_chunked_lend(void){
+    derr_t e = E_OK;
+
+    manual_scheduler_t scheduler;
+    scheduler_i *sched = manual_scheduler(&scheduler);
+
+    dstr_rstream_t dstr_r;
+    chunked_rstream_t chunked;
+    lender_t l = {0};
+    DSTR_WRAP_ARRAY(l.got, l._got);
+    rstream_read_t read1, read2;
+
+    DSTR_STATIC(input, "5\r\nhello\r\n7\r\n world!\r\n0\r\n\r\n");
+
+    // release after EOF: the last chunk is held while the trailer is pending
+    base = dstr_rstream(&dstr_r, sched, input);
+    rstream_i *r = chunked_rstream(&chunked, sched, base, try_detach, NULL);
+    r->data = &l;
+    stream_must_await_first(r, lend_await_cb);
+
+    rstream_must_lend(r, &read1, 64, lend_cb);
+    manual_scheduler_run(&scheduler);
+    EXPECT_D3_GO(&e, "got", l.got, DSTR_LIT("hello"), done);
+    // the slice is chunked_rstream_t's own buffer
+    EXPECT_P_GO(&e, "slice", read1.buf.data, chunked.buf.data + 3, done);
+
+    // the next chunk waits for the release
+    rstream_must_lend(r, &read2, 64, lend_cb);
+    manual_scheduler_run(&scheduler);
+    EXPECT_D3_GO(&e, "got", l.got, DSTR_LIT("hello"), done);
+
+    r->release(r, &read1);
+    manual_scheduler_run(&scheduler);
+    EXPECT_D3_GO(&e, "got", l.got, DSTR_LIT("hello world!"), done);
+
+    // the EOF waits for the release too
+    rstream_must_lend(r, &read1, 64, lend_cb);
+    manual_scheduler_run(&scheduler);
+    EXPECT_B_GO(&e, "eof", l.eof, false, done);
+
+    r->release(r, &read2);
+    manual_scheduler_run(&scheduler);
+    EXPECT_B_GO(&e, "eof", l.eof, true, done);
+    EXPECT_B_GO(&e, "detached", chunked.detached, true, done);
+    EXPECT_B_GO(&e, "awaited", l.awaited, true, done);
+    PROP_VAR_GO(&e, &l.e, done);
+
+    // release after cancel: the held slice is returned to a canceled stream
+    l = (lender_t){0};
+    DSTR_WRAP_ARRAY(l.got, l._got);
+    base = dstr_rstream(&dstr_r, sched, input);
+    r = chunked_rstream(&chunked, sched, base, try_detach, NULL);
+    r->data = &l;
+    stream_must_await_first(r, lend_await_cb);
+
+    rstream_must_lend(r, &read1, 64, lend_cb);
+    manual_scheduler_run(&scheduler);
+    EXPECT_D3_GO(&e, "got", l.got, DSTR_LIT("hello"), done);
+
+    r->cancel(r);
+    r->release(r, &read1);
+    manual_scheduler_run(&scheduler);
+    EXPECT_B_GO(&e, "chunked.lent", chunked.lent, false, done);
+    EXPECT_B_GO(&e, "eof", l.eof, false, done);
+    EXPECT_B_GO(&e, "awaited", l.awaited, true, done);
+    EXPECT_B_GO(&e, "base awaited", base->awaited, true, done);
+    EXPECT_E_VAR_GO(&e, "l.e", &l.e, E_CANCELED, done);
+
+done:
+    DROP_VAR(&l.e);
+    return e;
+}
+
 int main(int argc, char **argv){
     derr_t e = E_OK;
     // parse options and set default log level
     PARSE_TEST_OPTIONS(argc, argv, NULL, LOG_LVL_INFO);
 
     PROP_GO(&e, test_chunked(), test_fail);
+    PROP_GO(&e, test_chunked_lend(), test_fail);
 
     LOG_ERROR("PASS\n");
     return 0;
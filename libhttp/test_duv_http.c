@@ -55,6 +55,8 @@ static struct {
     dmutex_t mutex;
     dcond_t cond;
     bool ready;
+    // for test_pool: the client has seen the response from server b
+    bool b_done;
 } comm;
 
 typedef struct {
@@ -81,6 +83,7 @@ static derr_t do_server_test_case(test_server_t *s, test_case_t *tc){
         }else{
             PROP(&e, listener_accept(&s->l, &s->conn) );
         }
+        s->tls = want_tls;
     }
 
     // read the whole request into our buffer
@@ -879,6 +882,8 @@ static derr_t test_duv_http(void){
     PROP_GO(&e, duv_scheduler_init(&scheduler, &loop), die);
 
     PROP_GO(&e, duv_http_init(&http, &loop, &scheduler, client_ctx.ctx), die);
+    // our hand-jammed server only handles one connection at a time, in order
+    http.max_conns = 1;
 
     // start the first request
     start_next_request();
@@ -924,6 +929,270 @@ die:
     exit(1);
 }
 
+/* test_pool: three servers, for testing the connection pool.  With
+   max_conns=2 and max_conns_per_host=1:
+    - a1 and b1 each get a connection, while a2 waits for a1's
+    - b1 completes while a1 is still waiting for its response
+    - a2 reuses a1's connection
+    - c1 evicts the idle connection to server a
+    - d1 reuses the connection to server b, which was not evicted */
+
+#define POOL_NREQS 5
+enum { POOL_A1, POOL_A2, POOL_B1, POOL_C1, POOL_D1 };
+
+typedef struct {
+    dstr_t url;
+    dstr_t exp_request;
+    dstr_t response;
+    dstr_t exp_body;
+} pool_case_t;
+
+// pool_cases is not defined here to avoid static initializer requirements
+static pool_case_t *pool_cases;
+static size_t pool_order[POOL_NREQS];
+static size_t pool_ncompleted = 0;
+
+static derr_t pool_serve(connection_t *conn, size_t idx){
+    derr_t e = E_OK;
+
+    pool_case_t *pc = &pool_cases[idx];
+
+    DSTR_VAR(buf, 4096);
+    while(!dstr_contains(buf, DSTR_LIT("\r\n\r\n"))){
+        PROP(&e, connection_read(conn, &buf, NULL) );
+    }
+    EXPECT_D(&e, "request", buf, pc->exp_request);
+
+    PROP(&e, connection_write(conn, &pc->response) );
+
+    return e;
+}
+
+static void *pool_server_run(void *arg){
+    (void)arg;
+
+    derr_t e = E_OK;
+
+    listener_t la = {0}, lb = {0}, lc = {0};
+    connection_t ca = {0}, cb = {0}, cc = {0};
+
+    PROP_GO(&e, listener_new(&la, "127.0.0.1", 48125), done);
+    PROP_GO(&e, listener_new(&lb, "127.0.0.1", 48126), done);
+    PROP_GO(&e, listener_new(&lc, "127.0.0.1", 48127), done);
+
+    // signal main thread
+    dmutex_lock(&comm.mutex);
+    comm.ready = true;
+    dcond_signal(&comm.cond);
+    dmutex_unlock(&comm.mutex);
+
+    // a1 and b1 are connected concurrently
+    PROP_GO(&e, listener_accept(&la, &ca), done);
+    PROP_GO(&e, listener_accept(&lb, &cb), done);
+
+    // answer b1 and wait for the client to see it, leaving a1 unanswered
+    PROP_GO(&e, pool_serve(&cb, POOL_B1), done);
+    dmutex_lock(&comm.mutex);
+    while(!comm.b_done) dcond_wait(&comm.cond, &comm.mutex);
+    dmutex_unlock(&comm.mutex);
+
+    // a2 arrives on a1's connection
+    PROP_GO(&e, pool_serve(&ca, POOL_A1), done);
+    PROP_GO(&e, pool_serve(&ca, POOL_A2), done);
+
+    // c1 needs a slot, so the idle connection to a must be closed
+    PROP_GO(&e, listener_accept(&lc, &cc), done);
+    DSTR_VAR(buf, 256);
+    size_t nread;
+    PROP_GO(&e, connection_read(&ca, &buf, &nread), done);
+    EXPECT_U_GO(&e, "nread after eviction", nread, 0, done);
+    PROP_GO(&e, pool_serve(&cc, POOL_C1), done);
+
+    // d1 arrives on b1's connection
+    PROP_GO(&e, pool_serve(&cb, POOL_D1), done);
+
+done:
+    connection_close(&ca);
+    connection_close(&cb);
+    connection_close(&cc);
+    listener_close(&la);
+    listener_close(&lb);
+    listener_close(&lc);
+
+    if(is_error(e)){
+        DUMP(e);
+        DROP_VAR(&e);
+        fprintf(stderr, "exiting due to error on thread\n");
+        exit(1);
+    }
+
+    return NULL;
+}
+
+static void pool_done_cb(stream_reader_t *r, derr_t e);
+
+static void pool_start(size_t idx){
+    req_ctx_t *ctx = &req_ctxs[idx];
+    rstream_i *r = duv_http_req(
+        &ctx->req,
+        &http,
+        HTTP_METHOD_GET,
+        must_parse_url(&pool_cases[idx].url),
+        NULL,
+        NULL,
+        (dstr_t){0},
+        hdrs_to_hashmap
+    );
+    stream_read_all(&ctx->reader, r, &ctx->body, pool_done_cb);
+}
+
+static void pool_done_cb(stream_reader_t *r, derr_t e){
+    req_ctx_t *ctx = CONTAINER_OF(r, req_ctx_t, reader);
+    size_t idx = ctx->idx;
+
+    KEEP_FIRST_IF_NOT_CANCELED_VAR(&ctx->e, &e);
+    if(is_error(ctx->e)) goto fail;
+
+    EXPECT_I_GO(&ctx->e, "status", ctx->req.status, 200, fail);
+    EXPECT_D3_GO(&ctx->e, "body", ctx->body, pool_cases[idx].exp_body, fail);
+
+    pool_order[pool_ncompleted++] = idx;
+
+    switch(idx){
+        case POOL_B1:
+            // let the server answer a1
+            dmutex_lock(&comm.mutex);
+            comm.b_done = true;
+            dcond_signal(&comm.cond);
+            dmutex_unlock(&comm.mutex);
+            break;
+        case POOL_A2: pool_start(POOL_C1); break;
+        case POOL_C1: pool_start(POOL_D1); break;
+        case POOL_D1:
+            success = true;
+            finish(E_OK);
+            break;
+    }
+    return;
+
+fail:
+    LOG_ERROR("main-thread failure on pool request %x\n", FU(idx));
+    finish(ctx->e);
+}
+
+static derr_t test_pool(void){
+    derr_t e = E_OK;
+
+    #define POOL_CASE(port, name) { \
+        .url = DSTR_LIT("http://127.0.0.1:" port "/" name), \
+        .exp_request = DSTR_LIT( \
+            "GET /" name " HTTP/1.1\r\n" \
+            "Host: 127.0.0.1:" port "\r\n" \
+            "TE: trailers\r\n" \
+            "Connection: TE\r\n" \
+            "\r\n" \
+        ), \
+        .response = DSTR_LIT( \
+            "HTTP/1.1 200 OK\r\n" \
+            "Content-Length: 2\r\n" \
+            "\r\n" \
+            name \
+        ), \
+        .exp_body = DSTR_LIT(name), \
+    }
+    pool_case_t _pool_cases[POOL_NREQS] = {
+        [POOL_A1] = POOL_CASE("48125", "a1"),
+        [POOL_A2] = POOL_CASE("48125", "a2"),
+        [POOL_B1] = POOL_CASE("48126", "b1"),
+        [POOL_C1] = POOL_CASE("48127", "c1"),
+        [POOL_D1] = POOL_CASE("48126", "d1"),
+    };
+    #undef POOL_CASE
+    pool_cases = _pool_cases;
+
+    req_ctx_t _req_ctxs[POOL_NREQS];
+    req_ctxs = _req_ctxs;
+    finished = false;
+    success = false;
+    comm.ready = false;
+    comm.b_done = false;
+
+    PROP(&e, dmutex_init(&comm.mutex) );
+    PROP_GO(&e, dcond_init(&comm.cond), fail_mutex);
+
+    dthread_t thread;
+    PROP_GO(&e, dthread_create(&thread, pool_server_run, NULL), fail_cond);
+
+    // wait for thread to become ready
+    dmutex_lock(&comm.mutex);
+    while(!comm.ready) dcond_wait(&comm.cond, &comm.mutex);
+    dmutex_unlock(&comm.mutex);
+
+    // begin exit-on-failure, until dthread_join()
+
+    uv_loop_t loop;
+    duv_scheduler_t scheduler;
+
+    for(size_t i = 0; i < POOL_NREQS; i++){
+        PROP_GO(&e, req_ctx_init(&req_ctxs[i], i), die);
+    }
+
+    PROP_GO(&e, duv_loop_init(&loop), die);
+    PROP_GO(&e, duv_scheduler_init(&scheduler, &loop), die);
+
+    PROP_GO(&e, duv_http_init(&http, &loop, &scheduler, NULL), die);
+    http.max_conns = 2;
+    http.max_conns_per_host = 1;
+
+    // a2 must wait for a1, but b1 must not wait for a2
+    pool_start(POOL_A1);
+    pool_start(POOL_A2);
+    pool_start(POOL_B1);
+
+    PROP_GO(&e, duv_run(&loop), die);
+
+    PROP_VAR_GO(&e, &E, die);
+
+    if(!finished){
+        ORIG_GO(&e, E_INTERNAL, "loop exited without finishing", die);
+    }
+
+    duv_scheduler_close(&scheduler);
+    uv_loop_close(&loop);
+
+    for(size_t i = 0; i < POOL_NREQS; i++){
+        req_ctx_free(&req_ctxs[i]);
+    }
+
+    // expect the server to exit on its own
+    dthread_join(&thread);
+
+    if(!success){
+        ORIG_GO(&e, E_INTERNAL, "no error, but was not successful", fail_cond);
+    }
+
+    // b1 was not blocked by a1 or a2
+    EXPECT_U_GO(&e, "pool_ncompleted", pool_ncompleted, POOL_NREQS, fail_cond);
+    EXPECT_U_GO(&e, "first completed", pool_order[0], POOL_B1, fail_cond);
+    EXPECT_U_GO(&e, "second completed", pool_order[1], POOL_A1, fail_cond);
+    EXPECT_U_GO(&e, "third completed", pool_order[2], POOL_A2, fail_cond);
+
+fail_cond:
+    dcond_free(&comm.cond);
+
+fail_mutex:
+    dmutex_free(&comm.mutex);
+
+    return e;
+
+die:
+    // our multithreaded failure strategy is: "just exit"
+    TRACE(&e, "exiting due to error on main thread\n");
+    DUMP(e);
+    DROP_VAR(&e);
+    exit(1);
+}
+
 static derr_t test_close(void){
     derr_t e = E_OK;
 
@@ -963,6 +1232,7 @@ int main(int argc, char **argv){
     PROP_GO(&e, ssl_library_init(), test_fail);
 
     PROP_GO(&e, test_duv_http(), test_fail);
+    PROP_GO(&e, test_pool(), test_fail);
     PROP_GO(&e, test_close(), test_fail);
 
     LOG_ERROR("PASS\n");
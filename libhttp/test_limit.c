@@ -113,12 +113,114 @@ static derr_t test_limit(void){
     return e;
 }
 
+typedef struct {
+    char _got[64];
+    dstr_t got;
+    bool eof;
+    bool awaited;
+    derr_t e;
+} lender_t;
+
+static void lend_cb(rstream_i *r, rstream_read_t *read, dstr_t buf){
+    (void)read;
+    lender_t *l = r->data;
+    if(!buf.len){
+        l->eof = true;
+        return;
+    }
+    TRACE_PROP(&l->e, dstr_append(&l->got, &buf) );
+}
+
+static void lend_await_cb(rstream_i *r, derr_t e, link_t *reads){
+    (void)reads;
+    lender_t *l = r->data;
+    l->awaited = true;
+    TRACE_PROP_VAR(&l->e, &e);
+}
+
+static derr_t test_limit_lend(void){
+    derr_t e = E_OK;
+
+    size_t old_read_in_max_size = _dstr_rstream_read_max_size;
+    _dstr_rstream_read_max_size = 3;
+
+    manual_scheduler_t scheduler;
+    scheduler_i *sched = manual_scheduler(&scheduler);
+
+    dstr_rstream_t dstr_r;
+    limit_rstream_t limit_r;
+    lender_t l = {0};
+    DSTR_WRAP_ARRAY(l.got, l._got);
+    rstream_read_t read1, read2;
+
+    DSTR_STATIC(input, "abcdefgh");
+
+    // release after EOF: the limit is reached while the last slice is held
+    base = dstr_rstream(&dstr_r, sched, input);
+    rstream_i *r = limit_rstream(&limit_r, sched, base, 5, try_detach);
+    r->data = &l;
+    stream_must_await_first(r, lend_await_cb);
+    EXPECT_NOT_NULL_GO(&e, "lend", r->lend, done);
+
+    rstream_must_lend(r, &read1, 64, lend_cb);
+    manual_scheduler_run(&scheduler);
+    EXPECT_D3_GO(&e, "got", l.got, DSTR_LIT("abc"), done);
+    // the slice is the base's own memory
+    EXPECT_P_GO(&e, "slice", read1.buf.data, input.data, done);
+
+    r->release(r, &read1);
+    rstream_must_lend(r, &read1, 64, lend_cb);
+    manual_scheduler_run(&scheduler);
+    EXPECT_D3_GO(&e, "got", l.got, DSTR_LIT("abcde"), done);
+
+    // the EOF must wait for the release, and so must detaching from base
+    rstream_must_lend(r, &read2, 64, lend_cb);
+    manual_scheduler_run(&scheduler);
+    EXPECT_B_GO(&e, "eof", l.eof, false, done);
+    EXPECT_B_GO(&e, "detached", limit_r.detached, false, done);
+
+    r->release(r, &read1);
+    manual_scheduler_run(&scheduler);
+    EXPECT_B_GO(&e, "eof", l.eof, true, done);
+    EXPECT_B_GO(&e, "detached", limit_r.detached, true, done);
+    EXPECT_B_GO(&e, "awaited", l.awaited, true, done);
+    PROP_VAR_GO(&e, &l.e, done);
+    EXPECT_B_GO(&e, "dstr_r.lent", dstr_r.lent, false, done);
+
+    // release after cancel: the held slice is returned to a canceled stream
+    l = (lender_t){0};
+    DSTR_WRAP_ARRAY(l.got, l._got);
+    base = dstr_rstream(&dstr_r, sched, input);
+    r = limit_rstream(&limit_r, sched, base, 5, try_detach);
+    r->data = &l;
+    stream_must_await_first(r, lend_await_cb);
+
+    rstream_must_lend(r, &read1, 64, lend_cb);
+    manual_scheduler_run(&scheduler);
+    EXPECT_D3_GO(&e, "got", l.got, DSTR_LIT("abc"), done);
+
+    r->cancel(r);
+    r->release(r, &read1);
+    manual_scheduler_run(&scheduler);
+    EXPECT_B_GO(&e, "eof", l.eof, false, done);
+    EXPECT_B_GO(&e, "awaited", l.awaited, true, done);
+    EXPECT_B_GO(&e, "base awaited", base->awaited, true, done);
+    EXPECT_E_VAR_GO(&e, "l.e", &l.e, E_CANCELED, done);
+    EXPECT_B_GO(&e, "dstr_r.lent", dstr_r.lent, false, done);
+
+done:
+    DROP_VAR(&l.e);
+    _dstr_rstream_read_max_size = old_read_in_max_size;
+    return e;
+}
+
 int main(int argc, char **argv){
     derr_t e = E_OK;
     // parse options and set default log level
     PARSE_TEST_OPTIONS(argc, argv, NULL, LOG_LVL_INFO);
 
     PROP_GO(&e, test_limit(), test_fail);
+    PROP_GO(&e, test_limit_lend(), test_fail);
 
     LOG_ERROR("PASS\n");
     return 0;
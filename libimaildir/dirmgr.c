@@ -80,6 +80,9 @@ static derr_t rmdir_ctn(const string_builder_t *dir_path){
         PROP(&e, drmdir_path(&full_path) );
     }
 
+    // the header cache can't outlive the messages it caches
+    PROP(&e, hdrcache_rm_all(dir_path) );
+
     return e;
 }
 
@@ -151,6 +154,7 @@ static derr_t handle_each_mbx(const string_builder_t* base,
     if(dstr_cmp(file, &DSTR_LIT("tmp")) == 0) return e;
     if(dstr_cmp(file, &DSTR_LIT("new")) == 0) return e;
     if(dstr_cmp(file, &DSTR_LIT(".cache")) == 0) return e;
+    if(dstr_cmp(file, &subdir_hdrs_dstr) == 0) return e;
 
     for_each_mbx_arg_t *prev_arg = userdata;
     prev_arg->found_child = true;
@@ -322,7 +326,7 @@ void dirmgr_close_dn(dirmgr_t *dm, dn_t *dn){
 }
 
 /* check for invald names, including:
-   - sections named any of: . .. cur tmp new
+   - sections named any of: . .. cur tmp new .hdrs
    - empty sections
    - names starting or ending with /
    - names containing newlines */
@@ -348,6 +352,7 @@ bool dirmgr_name_valid(const dstr_t *name){
         if(!dstr_cmp(&elem, &DSTR_LIT("cur"))) return false;
         if(!dstr_cmp(&elem, &DSTR_LIT("tmp"))) return false;
         if(!dstr_cmp(&elem, &DSTR_LIT("new"))) return false;
+        if(!dstr_cmp(&elem, &subdir_hdrs_dstr)) return false;
     } while(split.len > 1);
 
     return true;
@@ -462,10 +467,11 @@ static derr_t _prune_empty_dirs(
     DSTR_STATIC(tmp, "tmp");
     DSTR_STATIC(new, "new");
 
-    // this function doesn't recurse into ctn
+    // this function doesn't recurse into ctn (or the header cache)
     if(dstr_cmp(name, &cur) == 0) return e;
     if(dstr_cmp(name, &tmp) == 0) return e;
     if(dstr_cmp(name, &new) == 0) return e;
+    if(dstr_cmp(name, &subdir_hdrs_dstr) == 0) return e;
 
     // but if we're looking at the parent directory of ctn, handle ctn here
     bool has_tmp = false;
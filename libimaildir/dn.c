@@ -39,6 +39,9 @@ typedef struct {
     bool taken; // the first taker gets *content; following takers get a copy
     imf_hdrs_t *hdrs;
     imf_t *imf;
+    // headers from the imaildir's header cache, pointing into cache_buf
+    dstr_t cache_buf;
+    imf_hdrs_t *cached;
 } loader_t;
 
 static loader_t loader_prep(imaildir_t *m, msg_key_t key){
@@ -159,6 +162,41 @@ fail:
     return NULL;
 }
 
+/* like loader_parse_hdrs, but prefer the imaildir's header cache, which
+   avoids opening the message at all */
+static const imf_hdrs_t *loader_cached_hdrs(derr_t *e, loader_t *loader){
+    if(is_error(*e)) goto fail;
+    if(loader->cached) return loader->cached;
+    // anything already parsed from the message is just as good
+    if(loader->hdrs) return loader->hdrs;
+    if(loader->imf) return loader->imf->hdrs;
+
+    IF_PROP(e,
+        imaildir_dn_read_hdrs(
+            loader->m, loader->key, &loader->cache_buf, &loader->cached
+        )
+    ){
+        // E_NOMEM is unfixable
+        if(e->type == E_NOMEM){
+            goto fail;
+        }
+        // otherwise, just treat it as a cache miss
+        DROP_VAR(e);
+    }
+    if(loader->cached) return loader->cached;
+
+    const imf_hdrs_t *hdrs = loader_parse_hdrs(e, loader);
+    CHECK_GO(e, fail);
+
+    // fill in the cache for messages which were filled before it existed
+    DROP_CMD( imaildir_dn_write_hdrs(loader->m, loader->key, hdrs) );
+
+    return hdrs;
+
+fail:
+    return NULL;
+}
+
 // parse the content into an imf_t
 static const imf_t *loader_parse_imf(derr_t *e, loader_t *loader){
     // borrow the fallback behavior in loader_parse_hdrs
@@ -183,6 +221,9 @@ fail:
 }
 
 static void loader_close(loader_t *loader){
+    imf_hdrs_free(loader->cached);
+    loader->cached = NULL;
+    dstr_free(&loader->cache_buf);
     imf_hdrs_free(loader->hdrs);
     imf_free(loader->imf);
     loader->imf = NULL;
@@ -664,10 +705,10 @@ static derr_t send_search_resp(dn_t *dn, ie_nums_t *nums, link_t *out){
     return e;
 }
 
-// a closure around loader_parse_hdrs for search_key_eval()
+// a closure around loader_cached_hdrs for search_key_eval()
 static derr_t _loader_parse_hdrs_fn(void *data, const imf_hdrs_t **hdrs){
     derr_t e = E_OK;
-    *hdrs = loader_parse_hdrs(&e, (loader_t*)data);
+    *hdrs = loader_cached_hdrs(&e, (loader_t*)data);
     CHECK(&e);
     return e;
 }
@@ -1273,8 +1314,8 @@ static ie_fetch_resp_t *build_fetch_resp_extra(
             || sect->sect_txt->type == IE_SECT_HDR_FLDS_NOT
         )
     ){
-        // parse just the headers
-        const imf_hdrs_t *hdrs = loader_parse_hdrs(e, loader);
+        // parse just the headers, or better yet, read them from the cache
+        const imf_hdrs_t *hdrs = loader_cached_hdrs(e, loader);
         if(sect->sect_txt->type == IE_SECT_HEADER){
             if(!is_error(*e)){
                 dstr_t bytes = dstr_from_off(hdrs->bytes);
@@ -1383,7 +1424,7 @@ static derr_t send_fetch_resp(
     f = ie_fetch_resp_seq_num(&e, f, seq_num);
 
     if(fetch->attr->envelope){
-        const imf_hdrs_t *hdrs = loader_parse_hdrs(&e, &loader);
+        const imf_hdrs_t *hdrs = loader_cached_hdrs(&e, &loader);
         ie_envelope_t *envelope = read_envelope_info(&e, hdrs);
         f = ie_fetch_resp_envelope(&e, f, envelope);
     }
@@ -1420,7 +1461,7 @@ static derr_t send_fetch_resp(
 
     if(fetch->attr->rfc822_header){
         // parse the headers and copy the header byes
-        const imf_hdrs_t *hdrs = loader_parse_hdrs(&e, &loader);
+        const imf_hdrs_t *hdrs = loader_cached_hdrs(&e, &loader);
         if(!is_error(e)){
             dstr_t text = dstr_from_off(hdrs->bytes);
             f = ie_fetch_resp_rfc822_hdr(&e, f, ie_dstr_new2(&e, text));
@@ -0,0 +1,276 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+
+#include "libimaildir.h"
+
+DSTR_STATIC(hdrcache_format_version, "1");
+
+static derr_t hdrcache_name(msg_key_t key, dstr_t *out){
+    derr_t e = E_OK;
+
+    if(key.uid_up){
+        PROP(&e, FMT(out, "u.%x", FU(key.uid_up)) );
+    }else{
+        PROP(&e, FMT(out, "l.%x", FU(key.uid_local)) );
+    }
+
+    return e;
+}
+
+// offsets are stored relative to the start of the header bytes
+static derr_t write_off(dstr_t *out, dstr_off_t off, size_t base){
+    derr_t e = E_OK;
+    PROP(&e, FMT(out, "%x:%x", FU(off.start - base), FU(off.len)) );
+    return e;
+}
+
+derr_t hdrcache_write(
+    const string_builder_t *maildir_path,
+    msg_key_t key,
+    size_t len,
+    const imf_hdrs_t *hdrs
+){
+    derr_t e = E_OK;
+
+    dstr_t out = {0};
+
+    DSTR_VAR(name, 32);
+    DSTR_VAR(tmp_name, 32);
+    PROP(&e, hdrcache_name(key, &name) );
+    PROP(&e, FMT(&tmp_name, "%x.tmp", FD(name)) );
+
+    string_builder_t dir = HDRS(maildir_path);
+    string_builder_t path = sb_append(&dir, SBD(name));
+    string_builder_t tmp_path = sb_append(&dir, SBD(tmp_name));
+
+    size_t nhdrs = 0;
+    for(const imf_hdr_t *hdr = hdrs->hdr; hdr; hdr = hdr->next) nhdrs++;
+
+    dstr_t raw = dstr_from_off(hdrs->bytes);
+    size_t base = hdrs->bytes.start;
+
+    // the index is small compared to the raw bytes
+    PROP(&e, dstr_new(&out, raw.len + 32 * (nhdrs + 2)) );
+
+    PROP_GO(&e,
+        FMT(&out,
+            "%x:%x:%x:%x\n",
+            FD(hdrcache_format_version),
+            FU(len),
+            FU(nhdrs),
+            FU(raw.len)
+        ),
+    cu);
+    PROP_GO(&e, write_off(&out, hdrs->sep, base), cu);
+    PROP_GO(&e, dstr_append(&out, &DSTR_LIT("\n")), cu);
+    for(const imf_hdr_t *hdr = hdrs->hdr; hdr; hdr = hdr->next){
+        PROP_GO(&e, write_off(&out, hdr->bytes, base), cu);
+        PROP_GO(&e, dstr_append(&out, &DSTR_LIT(":")), cu);
+        PROP_GO(&e, write_off(&out, hdr->name, base), cu);
+        PROP_GO(&e, dstr_append(&out, &DSTR_LIT(":")), cu);
+        PROP_GO(&e, write_off(&out, hdr->value, base), cu);
+        PROP_GO(&e, dstr_append(&out, &DSTR_LIT("\n")), cu);
+    }
+    PROP_GO(&e, dstr_append(&out, &raw), cu);
+
+    // write to a temporary file and rename it into place
+    PROP_GO(&e, mkdirs_path(&dir, 0777), cu);
+    PROP_GO(&e, dstr_write_path(&tmp_path, &out), cu);
+    PROP_GO(&e, drename_atomic_path(&tmp_path, &path), cu_tmp);
+
+    dstr_free(&out);
+
+    return e;
+
+cu_tmp:
+    DROP_CMD( remove_path(&tmp_path) );
+cu:
+    dstr_free(&out);
+    return e;
+}
+
+typedef struct {
+    int fd;
+    dstr_t *buf;
+} file_reader_t;
+
+// a closure for imf_hdrs_parse
+static derr_t file_read_fn(void *data, size_t *amnt_read){
+    derr_t e = E_OK;
+    file_reader_t *r = data;
+    PROP(&e, dstr_read(r->fd, r->buf, 4096, amnt_read) );
+    return e;
+}
+
+derr_t hdrcache_write_from_file(
+    const string_builder_t *maildir_path,
+    msg_key_t key,
+    size_t len,
+    const string_builder_t *msg_path
+){
+    derr_t e = E_OK;
+
+    dstr_t buf = {0};
+    imf_hdrs_t *hdrs = NULL;
+    file_reader_t r = { .fd = -1, .buf = &buf };
+
+    PROP(&e, dstr_new(&buf, 4096) );
+    PROP_GO(&e, dopen_path(msg_path, O_RDONLY, 0, &r.fd), cu);
+
+    // read at least one chunk, like the dn_t's loader does
+    size_t amnt_read;
+    PROP_GO(&e, file_read_fn(&r, &amnt_read), cu);
+
+    PROP_GO(&e, imf_hdrs_parse(&buf, file_read_fn, &r, &hdrs), cu);
+
+    PROP_GO(&e, hdrcache_write(maildir_path, key, len, hdrs), cu);
+
+cu:
+    imf_hdrs_free(hdrs);
+    if(r.fd >= 0) compat_close(r.fd);
+    dstr_free(&buf);
+    return e;
+}
+
+// pop one '\n'-terminated line off the front of *rest
+static bool pop_line(dstr_t *rest, dstr_t *line){
+    char *nl = memchr(rest->data, '\n', rest->len);
+    if(!nl) return false;
+    size_t n = (size_t)(nl - rest->data);
+    *line = dstr_sub2(*rest, 0, n);
+    *rest = dstr_sub2(*rest, n + 1, SIZE_MAX);
+    return true;
+}
+
+// parse a line of exactly n ':'-separated numbers (n <= 6)
+static bool parse_nums(const dstr_t line, size_t n, size_t *nums){
+    dstr_t f[6], junk;
+    size_t found;
+    dstr_split2_soft(
+        line, DSTR_LIT(":"), &found,
+        &f[0], &f[1], &f[2], &f[3], &f[4], &f[5], &junk
+    );
+    if(found != n) return false;
+    for(size_t i = 0; i < n; i++){
+        if(dstr_tosize_quiet(f[i], &nums[i], 10) != E_NONE) return false;
+    }
+    return true;
+}
+
+// convert a relative offset from the index back to a dstr_off_t
+static bool read_off(
+    const size_t *nums, const dstr_t *buf, size_t base, size_t raw_len,
+    dstr_off_t *out
+){
+    size_t start = nums[0];
+    size_t len = nums[1];
+    if(start > raw_len || len > raw_len - start) return false;
+    *out = (dstr_off_t){ .buf = buf, .start = base + start, .len = len };
+    return true;
+}
+
+derr_t hdrcache_read(
+    const string_builder_t *maildir_path,
+    msg_key_t key,
+    size_t len,
+    dstr_t *buf,
+    imf_hdrs_t **out
+){
+    derr_t e = E_OK;
+
+    *out = NULL;
+    imf_hdr_t *hdr = NULL;
+    imf_hdr_t **tail = &hdr;
+
+    DSTR_VAR(name, 32);
+    PROP(&e, hdrcache_name(key, &name) );
+    string_builder_t dir = HDRS(maildir_path);
+    string_builder_t path = sb_append(&dir, SBD(name));
+
+    bool ok;
+    PROP(&e, exists_path(&path, &ok) );
+    if(!ok) return e;
+
+    if(!buf->data) PROP(&e, dstr_new(buf, 4096) );
+    PROP(&e, dstr_read_path(&path, buf) );
+
+    // the first line is the version, the msg length, and the counts
+    dstr_t rest = *buf;
+    dstr_t line;
+    size_t nums[6];
+    if(!pop_line(&rest, &line)) goto invalid;
+    dstr_t version, postversion;
+    dstr_split2_soft(line, DSTR_LIT(":"), NULL, &version, &postversion);
+    if(!dstr_eq(version, hdrcache_format_version)) goto invalid;
+    if(!parse_nums(postversion, 3, nums)) goto invalid;
+    // a cache file for some other version of this message is worthless
+    if(nums[0] != len) goto invalid;
+    size_t nhdrs = nums[1];
+    size_t raw_len = nums[2];
+
+    // the raw bytes are at the very end
+    if(raw_len > rest.len) goto invalid;
+    size_t base = buf->len - raw_len;
+    dstr_t index = dstr_sub2(rest, 0, rest.len - raw_len);
+
+    dstr_off_t sep;
+    if(!pop_line(&index, &line)) goto invalid;
+    if(!parse_nums(line, 2, nums)) goto invalid;
+    if(!read_off(nums, buf, base, raw_len, &sep)) goto invalid;
+
+    for(size_t i = 0; i < nhdrs; i++){
+        dstr_off_t bytes, hname, value;
+        if(!pop_line(&index, &line)) goto invalid;
+        if(!parse_nums(line, 6, nums)) goto invalid;
+        if(!read_off(&nums[0], buf, base, raw_len, &bytes)) goto invalid;
+        if(!read_off(&nums[2], buf, base, raw_len, &hname)) goto invalid;
+        if(!read_off(&nums[4], buf, base, raw_len, &value)) goto invalid;
+        *tail = imf_hdr_new(&e, bytes, hname, value);
+        CHECK_GO(&e, fail);
+        tail = &(*tail)->next;
+    }
+    if(index.len) goto invalid;
+
+    dstr_off_t bytes = { .buf = buf, .start = base, .len = raw_len };
+    *out = imf_hdrs_new(&e, bytes, sep, STEAL(imf_hdr_t, &hdr));
+    CHECK(&e);
+
+    return e;
+
+invalid:
+    LOG_WARN("ignoring invalid header cache file for %x\n", FMK(key));
+    imf_hdr_free(hdr);
+    return e;
+
+fail:
+    imf_hdr_free(hdr);
+    return e;
+}
+
+derr_t hdrcache_rm(const string_builder_t *maildir_path, msg_key_t key){
+    derr_t e = E_OK;
+
+    DSTR_VAR(name, 32);
+    PROP(&e, hdrcache_name(key, &name) );
+    string_builder_t dir = HDRS(maildir_path);
+    string_builder_t path = sb_append(&dir, SBD(name));
+
+    bool ok;
+    PROP(&e, exists_path(&path, &ok) );
+    if(ok) PROP(&e, remove_path(&path) );
+
+    return e;
+}
+
+derr_t hdrcache_rm_all(const string_builder_t *maildir_path){
+    derr_t e = E_OK;
+
+    string_builder_t dir = HDRS(maildir_path);
+
+    bool ok;
+    PROP(&e, exists_path(&dir, &ok) );
+    if(ok) PROP(&e, rm_rf_path(&dir) );
+
+    return e;
+}
@@ -0,0 +1,56 @@
+/* The header cache keeps a pre-parsed copy of each message's headers in the
+   .hdrs/ subdirectory of a maildir, so that BODY[HEADER.FIELDS] and ENVELOPE
+   fetches can be answered without opening the message itself.
+
+   Cache files are named after the msg_key_t, which never changes after a
+   message is FILLED.  Each file holds a small text index with the offsets of
+   every header, followed by the raw header bytes:
+
+       1:<msg len>:<num hdrs>:<raw len>\n
+       <sep start>:<sep len>\n
+       <bytes start>:<bytes len>:<name start>:<name len>:<val start>:<val len>\n
+       ...
+       <raw header bytes>
+
+   The message length is stored so that a stale cache file is never trusted.
+   The cache is strictly an optimization; any missing or invalid cache file
+   just means the message gets parsed instead. */
+
+// the subdirectory for the header cache, alongside cur/tmp/new
+DSTR_STATIC(subdir_hdrs_dstr, ".hdrs");
+
+static inline string_builder_t HDRS(const string_builder_t *path){
+    return sb_append(path, SBD(subdir_hdrs_dstr));
+}
+
+// write a cache file from already-parsed headers
+derr_t hdrcache_write(
+    const string_builder_t *maildir_path,
+    msg_key_t key,
+    size_t len,
+    const imf_hdrs_t *hdrs
+);
+
+// parse the headers of a message file and write a cache file for it
+derr_t hdrcache_write_from_file(
+    const string_builder_t *maildir_path,
+    msg_key_t key,
+    size_t len,
+    const string_builder_t *msg_path
+);
+
+/* *out is left NULL if there is no valid cache file for this message.
+   Otherwise, *out points into *buf, which must outlive it. */
+derr_t hdrcache_read(
+    const string_builder_t *maildir_path,
+    msg_key_t key,
+    size_t len,
+    dstr_t *buf,
+    imf_hdrs_t **out
+);
+
+// remove the cache file for one message, if there is one
+derr_t hdrcache_rm(const string_builder_t *maildir_path, msg_key_t key);
+
+// remove the whole header cache for a maildir
+derr_t hdrcache_rm_all(const string_builder_t *maildir_path);
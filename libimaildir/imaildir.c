@@ -305,6 +305,7 @@ static derr_t add_msg_to_maildir(const string_builder_t *base,
         // (2) if the message is expunged, it's time to delete the file
         string_builder_t rm_path = sb_append(base, SBD(*name));
         PROP(&e, remove_path(&rm_path) );
+        PROP(&e, hdrcache_rm(&m->path, key) );
         return e;
     }
 
@@ -389,6 +390,9 @@ static derr_t handle_missing_file(imaildir_t *m, msg_t *msg,
             // just drop the msg, no need to update it
             *drop_msg = true;
 
+            // the header cache is no good without the file
+            DROP_CMD( hdrcache_rm(&m->path, key) );
+
             // insert expunge into expunged
             jsw_ainsert(&m->expunged, &expunge->node);
 
@@ -549,6 +553,8 @@ static derr_t delete_all_msg_files(const string_builder_t *maildir_path){
         PROP(&e, for_each_file_in_dir(&subpath, delete_one_msg_file, NULL) );
     }
 
+    PROP(&e, hdrcache_rm_all(maildir_path) );
+
     return e;
 }
 
@@ -1161,6 +1167,16 @@ static derr_t handle_new_msg_file(imaildir_t *m, const string_builder_t *path,
 
     PROP(&e, msg_set_file(msg, len, SUBDIR_CUR, &cur_name) );
 
+    /* pre-parse the headers now, so header-only fetches never have to open
+       the message; the cache is optional so failures are not fatal */
+    IF_PROP(&e,
+        hdrcache_write_from_file(&m->path, msg->key, len, &cur_path)
+    ){
+        TRACE(&e, "failed to cache headers for %x\n", FMK(msg->key));
+        DUMP(e);
+        DROP_VAR(&e);
+    }
+
     return e;
 
 fail:
@@ -1180,8 +1196,43 @@ static void finalize_msg(imaildir_t *m, msg_t *msg){
     msg->state = MSG_FILLED;
 }
 
+// run a streamed BODY[] literal through the hooks, as process_msg would
+static derr_t process_streamed_msg(
+    imaildir_t *m,
+    const string_builder_t *lit_path,
+    const string_builder_t *tmp_path,
+    size_t *len,
+    bool *not4me
+){
+    derr_t e = E_OK;
+
+    if(m->hooks->process_file){
+        PROP(&e,
+            m->hooks->process_file(
+                m->hooks, m->name, lit_path, tmp_path, len, not4me
+            )
+        );
+        return e;
+    }
+
+    dstr_t content = {0};
+    PROP(&e, dstr_read_path(lit_path, &content) );
+    PROP_GO(&e,
+        m->hooks->process_msg(
+            m->hooks, m->name, tmp_path, &content, len, not4me
+        ),
+    cu);
+
+cu:
+    dstr_free(&content);
+    return e;
+}
+
 static derr_t _imaildir_up_handle_static_fetch_attr(
-    imaildir_t *m, msg_t *msg, const ie_fetch_resp_t *fetch
+    imaildir_t *m,
+    msg_t *msg,
+    const ie_fetch_resp_t *fetch,
+    const string_builder_t **lit_path
 ){
     derr_t e = E_OK;
 
@@ -1207,6 +1258,11 @@ static derr_t _imaildir_up_handle_static_fetch_attr(
         ORIG(&e, E_RESPONSE, "wrong BODY[*] response");
     }
 
+    // a streamed BODY[] has no content, it is already in a file
+    if(!extra->content && !*lit_path){
+        ORIG(&e, E_INTERNAL, "streamed BODY[] without its file");
+    }
+
     msg->internaldate = fetch->intdate;
 
     size_t tmp_id = imaildir_new_tmp_id(m);
@@ -1218,11 +1274,15 @@ static derr_t _imaildir_up_handle_static_fetch_attr(
     // build the path
     string_builder_t tmp_dir = TMP(&m->path);
     string_builder_t tmp_path = sb_append(&tmp_dir, SBD(tmp_name));
+    const string_builder_t *path = &tmp_path;
 
     size_t len = 0;
     bool not4me = false;
 
-    if(m->hooks && m->hooks->process_msg){
+    bool hooked = m->hooks && m->hooks->process_msg;
+    bool hooked_file = m->hooks && m->hooks->process_file;
+
+    if(extra->content && hooked){
         // post-process the downloaded message
         PROP(&e,
             m->hooks->process_msg(
@@ -1234,10 +1294,20 @@ static derr_t _imaildir_up_handle_static_fetch_attr(
                 &not4me
             )
         );
-    }else{
+    }else if(extra->content){
         // default behavior: just write the content to a file.
         PROP(&e, dstr_write_path(&tmp_path, &extra->content->dstr) );
         len = extra->content->dstr.len;
+    }else if(hooked || hooked_file){
+        // post-process the streamed message
+        PROP(&e,
+            process_streamed_msg(m, *lit_path, &tmp_path, &len, &not4me)
+        );
+    }else{
+        // default behavior: the streamed file is the message
+        path = *lit_path;
+        *lit_path = NULL;
+        len = extra->len;
     }
 
     if(not4me){
@@ -1246,7 +1316,7 @@ static derr_t _imaildir_up_handle_static_fetch_attr(
         PROP(&e, m->log->update_msg(m->log, msg) );
     }else{
         // keep the file contents
-        PROP(&e, handle_new_msg_file(m, &tmp_path, msg, len) );
+        PROP(&e, handle_new_msg_file(m, path, msg, len) );
         // complete the message and persist its state
         finalize_msg(m, msg);
         PROP(&e, m->log->update_msg(m->log, msg) );
@@ -1258,15 +1328,24 @@ static derr_t _imaildir_up_handle_static_fetch_attr(
 }
 
 derr_t imaildir_up_handle_static_fetch_attr(
-    imaildir_t *m, msg_t *msg, const ie_fetch_resp_t *fetch
+    imaildir_t *m,
+    msg_t *msg,
+    const ie_fetch_resp_t *fetch,
+    const string_builder_t *lit_path
 ){
     derr_t e = E_OK;
 
-    PROP_GO(&e, _imaildir_up_handle_static_fetch_attr(m, msg, fetch), fail);
+    PROP_GO(&e,
+        _imaildir_up_handle_static_fetch_attr(m, msg, fetch, &lit_path),
+    fail);
+
+    // the streamed literal is garbage unless it was renamed into place
+    if(lit_path) DROP_CMD( remove_path(lit_path) );
 
     return e;
 
 fail:
+    if(lit_path) DROP_CMD( remove_path(lit_path) );
     // failures to accept an update are treated as consistency failures
     imaildir_maybe_fail(m, e);
     return e;
@@ -2287,6 +2366,35 @@ fail:
     return e;
 }
 
+derr_t imaildir_dn_read_hdrs(
+    imaildir_t *m, const msg_key_t key, dstr_t *buf, imf_hdrs_t **out
+){
+    derr_t e = E_OK;
+    *out = NULL;
+
+    jsw_anode_t *node = jsw_afind(&m->msgs, &key, NULL);
+    if(!node) ORIG(&e, E_INTERNAL, "msg_key missing %x", FMK(key));
+    msg_t *msg = CONTAINER_OF(node, msg_t, node);
+
+    PROP(&e, hdrcache_read(&m->path, key, msg->length, buf, out) );
+
+    return e;
+}
+
+derr_t imaildir_dn_write_hdrs(
+    imaildir_t *m, const msg_key_t key, const imf_hdrs_t *hdrs
+){
+    derr_t e = E_OK;
+
+    jsw_anode_t *node = jsw_afind(&m->msgs, &key, NULL);
+    if(!node) ORIG(&e, E_INTERNAL, "msg_key missing %x", FMK(key));
+    msg_t *msg = CONTAINER_OF(node, msg_t, node);
+
+    PROP(&e, hdrcache_write(&m->path, key, msg->length, hdrs) );
+
+    return e;
+}
+
 // close a message in a view-safe way
 void imaildir_dn_close_msg(imaildir_t *m, const msg_key_t key, int *fd){
     if(*fd < 0) return;
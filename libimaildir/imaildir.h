@@ -53,6 +53,17 @@ struct imaildir_hooks_i {
         size_t *len,
         bool *not4me
     );
+    /* process_file is like process_msg, but for a BODY[] literal which was
+       streamed to the file at *in as it arrived.  It must not modify *in.
+       When it is NULL, the file is loaded for process_msg instead. */
+    derr_t (*process_file)(
+        imaildir_hooks_i*,
+        const dstr_t *mailbox,
+        const string_builder_t *in,
+        const string_builder_t *path,
+        size_t *len,
+        bool *not4me
+    );
 };
 
 // IMAP maildir
@@ -271,9 +282,11 @@ derr_t imaildir_up_new_msg(imaildir_t *m, unsigned int uid, msg_flags_t flags,
 // update flags for an existing message
 derr_t imaildir_up_update_flags(imaildir_t *m, msg_t *msg, msg_flags_t flags);
 
-// handle the static attributes from a FETCH
+/* handle the static attributes from a FETCH.  If its BODY[] was streamed,
+   lit_path is the file holding it (always removes or renames lit_path) */
 derr_t imaildir_up_handle_static_fetch_attr(imaildir_t *m,
-        msg_t *msg, const ie_fetch_resp_t *fetch);
+        msg_t *msg, const ie_fetch_resp_t *fetch,
+        const string_builder_t *lit_path);
 
 // after a select or a reselect
 derr_t imaildir_up_selected(imaildir_t *m, ie_status_t status);
@@ -314,6 +327,17 @@ derr_t imaildir_dn_open_msg(imaildir_t *m, const msg_key_t key, int *fd);
 // close a message in a view-safe way
 void imaildir_dn_close_msg(imaildir_t *m, const msg_key_t key, int *fd);
 
+/* read a message's headers from the header cache, without opening the
+   message; *out is left NULL if there is no valid cache file */
+derr_t imaildir_dn_read_hdrs(
+    imaildir_t *m, const msg_key_t key, dstr_t *buf, imf_hdrs_t **out
+);
+
+// fill in a missing header cache file with headers parsed by a dn_t
+derr_t imaildir_dn_write_hdrs(
+    imaildir_t *m, const msg_key_t key, const imf_hdrs_t *hdrs
+);
+
 /////////////////
 // support for APPEND and COPY (without redownloading message)
 
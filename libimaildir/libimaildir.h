@@ -10,6 +10,7 @@ typedef struct imaildir_t imaildir_t;
 #include "util.h"
 #include "msg.h"
 #include "name.h"
+#include "hdrcache.h"
 #include "up.h"
 #include "dn.h"
 #include "imaildir.h"
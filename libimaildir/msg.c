@@ -79,6 +79,9 @@ derr_t msg_del_file(msg_t *msg, const string_builder_t *basepath){
     string_builder_t path = sb_append(&subdir, SBD(msg->filename));
     PROP(&e, remove_path(&path) );
 
+    // the header cache file is useless without the message
+    PROP(&e, hdrcache_rm(basepath, msg->key) );
+
     dstr_free(&msg->filename);
     msg->filename = (dstr_t){0};
 
@@ -207,7 +207,7 @@ void msg_free(msg_t **msg);
 derr_t msg_set_file(msg_t *msg, size_t len, subdir_type_e subdir,
         const dstr_t *filename);
 
-// deletes the file backing the msg_t
+// deletes the file backing the msg_t, and its header cache file
 derr_t msg_del_file(msg_t *msg, const string_builder_t *basepath);
 
 
@@ -0,0 +1,135 @@
+#include "libimaildir/libimaildir.h"
+
+#include "test/test_utils.h"
+
+
+static derr_t expect_off(
+    const char *name, dstr_off_t got, dstr_off_t exp
+){
+    derr_t e = E_OK;
+    dstr_t g = dstr_from_off(got);
+    dstr_t x = dstr_from_off(exp);
+    EXPECT_D3(&e, name, g, x);
+    return e;
+}
+
+static derr_t expect_hdrs(const imf_hdrs_t *got, const imf_hdrs_t *exp){
+    derr_t e = E_OK;
+
+    PROP(&e, expect_off("bytes", got->bytes, exp->bytes) );
+    PROP(&e, expect_off("sep", got->sep, exp->sep) );
+    const imf_hdr_t *g = got->hdr;
+    const imf_hdr_t *x = exp->hdr;
+    for(; g && x; g = g->next, x = x->next){
+        PROP(&e, expect_off("hdr bytes", g->bytes, x->bytes) );
+        PROP(&e, expect_off("hdr name", g->name, x->name) );
+        PROP(&e, expect_off("hdr value", g->value, x->value) );
+    }
+    EXPECT_NULL(&e, "extra got hdr", g);
+    EXPECT_NULL(&e, "extra exp hdr", x);
+
+    return e;
+}
+
+static derr_t test_hdrcache(void){
+    derr_t e = E_OK;
+
+    dstr_t buf = {0};
+    imf_hdrs_t *exp = NULL;
+    imf_hdrs_t *got = NULL;
+
+    DSTR_VAR(tmp, 4096);
+    PROP(&e, mkdir_temp("test-hdrcache", &tmp) );
+    string_builder_t path = SBD(tmp);
+    string_builder_t msg_path = sb_append(&path, SBS("msg"));
+
+    DSTR_STATIC(msg,
+        "Subject: hello\r\n"
+        "From: a@b.c\r\n"
+        "X-Folded: one\r\n"
+        " two\r\n"
+        "\r\n"
+        "body\r\n"
+    );
+    msg_key_t key = KEY_UP(7);
+
+    PROP_GO(&e, imf_hdrs_parse(&msg, NULL, NULL, &exp), cu);
+
+    // nothing cached yet
+    PROP_GO(&e, hdrcache_read(&path, key, msg.len, &buf, &got), cu);
+    EXPECT_NULL_GO(&e, "got", got, cu);
+
+    // cache from the message file, then read it back
+    PROP_GO(&e, dstr_write_path(&msg_path, &msg), cu);
+    PROP_GO(&e, hdrcache_write_from_file(&path, key, msg.len, &msg_path), cu);
+    PROP_GO(&e, hdrcache_read(&path, key, msg.len, &buf, &got), cu);
+    EXPECT_NOT_NULL_GO(&e, "got", got, cu);
+    PROP_GO(&e, expect_hdrs(got, exp), cu);
+    imf_hdrs_free(got);
+    got = NULL;
+    dstr_free(&buf);
+
+    // a local key has its own cache file
+    PROP_GO(&e, hdrcache_read(&path, KEY_LOCAL(7), msg.len, &buf, &got), cu);
+    EXPECT_NULL_GO(&e, "got", got, cu);
+    dstr_free(&buf);
+
+    // a cache file for a different message length is never trusted
+    PROP_GO(&e, hdrcache_read(&path, key, msg.len + 1, &buf, &got), cu);
+    EXPECT_NULL_GO(&e, "got", got, cu);
+    dstr_free(&buf);
+
+    // a truncated cache file is ignored
+    string_builder_t hdrs_dir = HDRS(&path);
+    string_builder_t cache_path = sb_append(&hdrs_dir, SBS("u.7"));
+    PROP_GO(&e, dstr_read_path(&cache_path, &buf), cu);
+    dstr_t trunc = dstr_sub2(buf, 0, buf.len / 2);
+    PROP_GO(&e, dstr_write_path(&cache_path, &trunc), cu);
+    dstr_free(&buf);
+    PROP_GO(&e, hdrcache_read(&path, key, msg.len, &buf, &got), cu);
+    EXPECT_NULL_GO(&e, "got", got, cu);
+    dstr_free(&buf);
+
+    // rewrite from already-parsed headers, then remove it
+    PROP_GO(&e, hdrcache_write(&path, key, msg.len, exp), cu);
+    PROP_GO(&e, hdrcache_read(&path, key, msg.len, &buf, &got), cu);
+    EXPECT_NOT_NULL_GO(&e, "got", got, cu);
+    PROP_GO(&e, expect_hdrs(got, exp), cu);
+    imf_hdrs_free(got);
+    got = NULL;
+    dstr_free(&buf);
+
+    PROP_GO(&e, hdrcache_rm(&path, key), cu);
+    PROP_GO(&e, hdrcache_read(&path, key, msg.len, &buf, &got), cu);
+    EXPECT_NULL_GO(&e, "got", got, cu);
+
+    // removing the whole cache is fine, even twice
+    PROP_GO(&e, hdrcache_rm_all(&path), cu);
+    PROP_GO(&e, hdrcache_rm_all(&path), cu);
+
+cu:
+    imf_hdrs_free(got);
+    imf_hdrs_free(exp);
+    dstr_free(&buf);
+    DROP_CMD( rm_rf_path(&path) );
+
+    return e;
+}
+
+
+int main(int argc, char **argv){
+    derr_t e = E_OK;
+    // parse options and set default log level
+    PARSE_TEST_OPTIONS(argc, argv, NULL, LOG_LVL_INFO);
+
+    PROP_GO(&e, test_hdrcache(), test_fail);
+
+    LOG_ERROR("PASS\n");
+    return 0;
+
+test_fail:
+    DUMP(e);
+    DROP_VAR(&e);
+    LOG_ERROR("FAIL\n");
+    return 1;
+}
@@ -438,7 +438,12 @@ static derr_t enqueue_reselect(up_t *up, unsigned int uidvld_up,
     return e;
 }
 
-derr_t up_fetch_resp(up_t *up, const ie_fetch_resp_t *fetch, link_t *out){
+static derr_t _up_fetch_resp(
+    up_t *up,
+    const ie_fetch_resp_t *fetch,
+    const string_builder_t **lit_path,
+    link_t *out
+){
     derr_t e = E_OK;
 
     PROP(&e, healthcheck(up) );
@@ -485,7 +490,12 @@ derr_t up_fetch_resp(up_t *up, const ie_fetch_resp_t *fetch, link_t *out){
     }
 
     if(fetch->extras){
-        PROP(&e, imaildir_up_handle_static_fetch_attr(up->m, msg, fetch) );
+        // the imaildir takes the streamed literal, if there is one
+        const string_builder_t *path = *lit_path;
+        *lit_path = NULL;
+        PROP(&e,
+            imaildir_up_handle_static_fetch_attr(up->m, msg, fetch, path)
+        );
     }
 
     // did we see a MODSEQ value?
@@ -496,6 +506,22 @@ derr_t up_fetch_resp(up_t *up, const ie_fetch_resp_t *fetch, link_t *out){
     return e;
 }
 
+derr_t up_fetch_resp(
+    up_t *up,
+    const ie_fetch_resp_t *fetch,
+    const string_builder_t *lit_path,
+    link_t *out
+){
+    derr_t e = E_OK;
+
+    PROP_GO(&e, _up_fetch_resp(up, fetch, &lit_path, out), cu);
+
+cu:
+    // a skipped FETCH leaves its streamed literal behind
+    if(lit_path) DROP_CMD( remove_path(lit_path) );
+    return e;
+}
+
 // expunge_done is an imap_cmd_cb_call_f
 static derr_t expunge_done(imap_cmd_cb_t *cb, const ie_st_resp_t *st_resp){
     derr_t e = E_OK;
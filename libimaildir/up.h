@@ -46,7 +46,14 @@ struct up_cb_i {
 
 // pass a response from the remote imap server to the up_t
 derr_t up_st_resp(up_t *up, const ie_st_resp_t *st_resp, link_t *out);
-derr_t up_fetch_resp(up_t *up, const ie_fetch_resp_t *fetch, link_t *out);
+/* a FETCH whose BODY[] literal was streamed to a file comes with lit_path,
+   which up_fetch_resp always removes or renames */
+derr_t up_fetch_resp(
+    up_t *up,
+    const ie_fetch_resp_t *fetch,
+    const string_builder_t *lit_path,
+    link_t *out
+);
 derr_t up_vanished_resp(up_t *up, const ie_vanished_resp_t *vanished);
 derr_t up_exists_resp(up_t *up, unsigned int exists, link_t *out);
 derr_t up_plus_resp(up_t *up, link_t *out);
@@ -0,0 +1,835 @@
+#include "libimap/libimap.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+/* Throughput of libimap's readers, writers, and imf parser, for judging
+   parser and allocator changes against a stable baseline.
+
+   Every corpus is run through each operation for its kind once per chunk
+   size.  Input is fed to the readers in CHUNK-byte pieces, as it would arrive
+   from a socket, and the writers fill CHUNK-byte buffers, so small chunks
+   stress the scanner's leftover handling and the writers' skip logic.
+
+   Without CORPUS arguments, synthetic corpora shaped like the traffic that
+   costs us the most are generated: FETCH responses with large literals,
+   SEARCH results with thousands of numbers, QRESYNC VANISHED ranges, long
+   uid sets, and an IMF message with hundreds of headers.  CORPUS files are
+   raw captures of one direction of an IMAP session (.resp or .cmd) or a
+   single message (.eml).
+
+   When tests are enabled, libimap is built a second time with the
+   c-threaded backend of tools/gen.py; this file is linked against each build,
+   as bench_imap and bench_imap_threaded, so the two backends can be compared
+   on identical input.
+
+   Each line reports MB/s and objects/s, allocator calls per object (where
+   the build counts them, see BENCH_COUNT_ALLOCS), and the process's peak RSS
+   so far. */
+
+#ifndef BENCH_GENERATOR
+#define BENCH_GENERATOR "c"
+#endif
+
+#define MAX_CHUNKS 16
+
+#ifdef BENCH_COUNT_ALLOCS
+/* Linked with -Wl,--wrap for each of these, so every allocation made by
+   libimap and libdstr passes through here. */
+static size_t nallocs = 0;
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size){
+    nallocs++;
+    return __real_malloc(size);
+}
+void *__wrap_calloc(size_t nmemb, size_t size){
+    nallocs++;
+    return __real_calloc(nmemb, size);
+}
+void *__wrap_realloc(void *ptr, size_t size){
+    nallocs++;
+    return __real_realloc(ptr, size);
+}
+#define ALLOCS() nallocs
+#else
+#define ALLOCS() ((size_t)0)
+#endif
+
+// peak resident set size of the process, in KB, or 0 if unknown
+static size_t peak_rss_kb(void){
+#ifndef _WIN32
+    struct rusage ru;
+    if(getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#ifdef __APPLE__
+    // macos reports bytes
+    return (size_t)ru.ru_maxrss / 1024;
+#else
+    return (size_t)ru.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+typedef enum {
+    CORPUS_RESP,
+    CORPUS_CMD,
+    CORPUS_EML,
+} corpus_kind_e;
+
+typedef struct {
+    dstr_t name;
+    corpus_kind_e kind;
+    dstr_t text;
+} corpus_t;
+
+typedef struct {
+    size_t bytes;
+    size_t objs;
+    size_t allocs;
+    double secs;
+} stats_t;
+
+typedef struct {
+    size_t sizes[MAX_CHUNKS];
+    size_t n;
+} chunks_t;
+
+static extensions_t exts = {
+    .uidplus = EXT_STATE_ON,
+    .enable = EXT_STATE_ON,
+    .condstore = EXT_STATE_ON,
+    .qresync = EXT_STATE_ON,
+    .unselect = EXT_STATE_ON,
+    .idle = EXT_STATE_ON,
+    .xkey = EXT_STATE_ON,
+};
+
+// minimum cpu time to spend on each measurement
+static double budget = 0.25;
+
+static double since(clock_t start){
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+// server side of a short session
+static const char *session_resp =
+    "* OK [CAPABILITY IMAP4rev1 LITERAL+ SASL-IR LOGIN-REFERRALS ID ENABLE "
+    "IDLE AUTH=PLAIN] Dovecot ready.\r\n"
+    "1 OK [CAPABILITY IMAP4rev1 LITERAL+ SASL-IR LOGIN-REFERRALS ID ENABLE "
+    "IDLE SORT THREAD=REFERENCES MULTIAPPEND UNSELECT CHILDREN NAMESPACE "
+    "UIDPLUS LIST-EXTENDED I18NLEVEL=1 CONDSTORE QRESYNC ESEARCH SEARCHRES "
+    "WITHIN CONTEXT=SEARCH LIST-STATUS MOVE] Logged in\r\n"
+    "* ENABLED CONDSTORE QRESYNC\r\n"
+    "2 OK Enabled.\r\n"
+    "* LIST (\\HasNoChildren) \"/\" INBOX\r\n"
+    "* LIST (\\HasNoChildren \\Sent) \"/\" Sent\r\n"
+    "* LIST (\\HasNoChildren \\Trash) \"/\" Trash\r\n"
+    "3 OK List completed (0.001 + 0.000 secs).\r\n"
+    "* FLAGS (\\Answered \\Flagged \\Deleted \\Seen \\Draft)\r\n"
+    "* OK [PERMANENTFLAGS (\\Answered \\Flagged \\Deleted \\Seen \\Draft \\*)] "
+    "Flags permitted.\r\n"
+    "* 248 EXISTS\r\n"
+    "* 0 RECENT\r\n"
+    "* OK [UIDVALIDITY 1598473520] UIDs valid\r\n"
+    "* OK [UIDNEXT 1032] Predicted next UID\r\n"
+    "* OK [HIGHESTMODSEQ 4417] Highest\r\n"
+    "* VANISHED (EARLIER) 3:7,12,15:19,44,101:103,250:262,700\r\n"
+    "* 201 FETCH (UID 977 FLAGS (\\Seen) MODSEQ (4401))\r\n"
+    "* 202 FETCH (UID 978 FLAGS (\\Seen \\Answered) MODSEQ (4402))\r\n"
+    "* 203 FETCH (UID 981 FLAGS () MODSEQ (4405))\r\n"
+    "* 204 FETCH (UID 990 FLAGS (\\Seen \\Flagged $Forwarded) MODSEQ (4410))\r\n"
+    "4 OK [READ-WRITE] Select completed (0.002 + 0.000 secs).\r\n"
+    "* SEARCH 1 2 3 5 8 13 21 34 55 89 144 233\r\n"
+    "6 OK Search completed (0.001 + 0.000 secs).\r\n"
+    "* 12 FETCH (UID 55 MODSEQ (4418) FLAGS (\\Seen \\Deleted))\r\n"
+    "7 OK Store completed (0.001 + 0.000 secs).\r\n"
+    "* 12 EXPUNGE\r\n"
+    "8 OK Expunge completed (0.001 + 0.000 secs).\r\n"
+    "* STATUS Sent (MESSAGES 112 UIDNEXT 113 UNSEEN 0)\r\n"
+    "9 OK Status completed (0.001 + 0.000 secs).\r\n"
+    "10 OK NOOP completed (0.001 + 0.000 secs).\r\n";
+
+// client side of the same session
+static const char *session_cmd =
+    "1 LOGIN bob@example.com hunter2\r\n"
+    "2 ENABLE CONDSTORE QRESYNC\r\n"
+    "3 LIST \"\" \"*\"\r\n"
+    "4 SELECT INBOX (QRESYNC (1598473520 4400 1:1031))\r\n"
+    "5 UID FETCH 1031 (UID RFC822.SIZE INTERNALDATE BODY.PEEK[])\r\n"
+    "6 UID SEARCH UNDELETED SINCE 1-Jan-2023 FROM \"alice\"\r\n"
+    "7 UID STORE 55 +FLAGS.SILENT (\\Deleted)\r\n"
+    "8 EXPUNGE\r\n"
+    "9 STATUS Sent (MESSAGES UIDNEXT UNSEEN)\r\n"
+    "10 NOOP\r\n"
+    "11 APPEND Sent (\\Seen) {27}\r\n"
+    "Subject: re: lunch\r\n"
+    "\r\n"
+    "yes\r\n"
+    "\r\n"
+    "12 IDLE\r\n"
+    "DONE\r\n";
+
+// a small deterministic generator, so every run sees the same corpora
+static uint32_t lcg = 1;
+static uint32_t rnd(uint32_t n){
+    lcg = lcg * 1103515245u + 12345u;
+    return (lcg >> 8) % n;
+}
+
+// exactly len bytes of text, in lines of at most 78 bytes
+static derr_t filler(dstr_t *out, size_t len){
+    derr_t e = E_OK;
+
+    static const char *lorem =
+        "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
+        "eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim "
+        "ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut "
+        "aliquip ex ea commodo consequat.";
+    dstr_t text = dstr_from_cstr((char*)lorem);
+
+    while(len >= 78){
+        size_t start = rnd((uint32_t)(text.len - 76));
+        dstr_t line = dstr_sub2(text, start, start + 76);
+        PROP(&e, dstr_append(out, &line) );
+        PROP(&e, dstr_append(out, &DSTR_LIT("\r\n")) );
+        len -= 78;
+    }
+    dstr_t rest = dstr_sub2(text, 0, len);
+    PROP(&e, dstr_append(out, &rest) );
+
+    return e;
+}
+
+// FETCH responses with BODY[] literals from 1KB to 128KB
+static derr_t gen_fetch(dstr_t *out){
+    derr_t e = E_OK;
+
+    for(unsigned int i = 0; i < 32; i++){
+        size_t len = 1024 + rnd(128 * 1024);
+        PROP(&e,
+            FMT(out,
+                "* %x FETCH (UID %x MODSEQ (%x) FLAGS (\\Seen) "
+                "RFC822.SIZE %x BODY[] {%x}\r\n",
+                FU(i + 1), FU(1000 + 3*i), FU(5000 + i), FU(len), FU(len)
+            )
+        );
+        PROP(&e, filler(out, len) );
+        PROP(&e, dstr_append(out, &DSTR_LIT(")\r\n")) );
+    }
+    PROP(&e, dstr_append(out, &DSTR_LIT("5 OK Fetch completed.\r\n")) );
+
+    return e;
+}
+
+// SEARCH results with thousands of numbers each
+static derr_t gen_search(dstr_t *out){
+    derr_t e = E_OK;
+
+    for(unsigned int i = 0; i < 8; i++){
+        PROP(&e, dstr_append(out, &DSTR_LIT("* SEARCH")) );
+        size_t n = 0;
+        for(unsigned int j = 0; j < 4000; j++){
+            n += 1 + rnd(20);
+            PROP(&e, FMT(out, " %x", FU(n)) );
+        }
+        PROP(&e, dstr_append(out, &DSTR_LIT("\r\n")) );
+        PROP(&e, FMT(out, "%x OK Search completed.\r\n", FU(i + 1)) );
+    }
+
+    return e;
+}
+
+// QRESYNC VANISHED (EARLIER) responses with thousands of ranges each
+static derr_t gen_vanished(dstr_t *out){
+    derr_t e = E_OK;
+
+    for(unsigned int i = 0; i < 8; i++){
+        PROP(&e, dstr_append(out, &DSTR_LIT("* VANISHED (EARLIER) ")) );
+        size_t n = 0;
+        for(unsigned int j = 0; j < 2000; j++){
+            n += 2 + rnd(50);
+            if(j) PROP(&e, dstr_append(out, &DSTR_LIT(",")) );
+            if(rnd(3) == 0){
+                PROP(&e, FMT(out, "%x", FU(n)) );
+            }else{
+                size_t n0 = n;
+                n += 1 + rnd(30);
+                PROP(&e, FMT(out, "%x:%x", FU(n0), FU(n)) );
+            }
+        }
+        PROP(&e, dstr_append(out, &DSTR_LIT("\r\n")) );
+        PROP(&e, FMT(out, "%x OK Select completed.\r\n", FU(i + 1)) );
+    }
+
+    return e;
+}
+
+// UID FETCH and UID STORE commands with long uid sets
+static derr_t gen_uidsets(dstr_t *out){
+    derr_t e = E_OK;
+
+    for(unsigned int i = 0; i < 8; i++){
+        if(i % 2 == 0){
+            PROP(&e, FMT(out, "%x UID FETCH ", FU(i + 1)) );
+        }else{
+            PROP(&e, FMT(out, "%x UID STORE ", FU(i + 1)) );
+        }
+        size_t n = 0;
+        for(unsigned int j = 0; j < 2000; j++){
+            n += 2 + rnd(50);
+            if(j) PROP(&e, dstr_append(out, &DSTR_LIT(",")) );
+            size_t n0 = n;
+            n += rnd(30);
+            if(n == n0){
+                PROP(&e, FMT(out, "%x", FU(n)) );
+            }else{
+                PROP(&e, FMT(out, "%x:%x", FU(n0), FU(n)) );
+            }
+        }
+        if(i % 2 == 0){
+            PROP(&e,
+                dstr_append(out, &DSTR_LIT(" (UID FLAGS MODSEQ)\r\n"))
+            );
+        }else{
+            PROP(&e,
+                dstr_append(out, &DSTR_LIT(" +FLAGS.SILENT (\\Seen)\r\n"))
+            );
+        }
+    }
+
+    return e;
+}
+
+// one message with hundreds of headers, many of them folded
+static derr_t gen_eml(dstr_t *out){
+    derr_t e = E_OK;
+
+    for(unsigned int i = 0; i < 100; i++){
+        PROP(&e,
+            FMT(out,
+                "Received: from relay%x.example.net "
+                "(relay%x.example.net [192.0.2.%x])\r\n"
+                "\tby mx%x.example.com with ESMTPS id %x\r\n"
+                "\tfor <bob@example.com>; Tue, 30 May 2023 07:07:%x +0000\r\n",
+                FU(i), FU(i), FU(i), FU(i % 4), FU(rnd(1u<<30)), FU(i % 60)
+            )
+        );
+    }
+    for(unsigned int i = 0; i < 200; i++){
+        PROP(&e,
+            FMT(out,
+                "X-Filter-Detail-%x: score=%x.%x tests=BAYES_%x,"
+                "DKIM_SIGNED,DKIM_VALID,SPF_PASS\r\n",
+                FU(i), FU(rnd(10)), FU(rnd(100)), FU(rnd(100))
+            )
+        );
+    }
+    PROP(&e, dstr_append(out, &DSTR_LIT("Cc: ")) );
+    for(unsigned int i = 0; i < 40; i++){
+        PROP(&e,
+            FMT(out,
+                "%xUser %x <user%x@example.com>",
+                FS(i ? ",\r\n " : ""), FU(i), FU(i)
+            )
+        );
+    }
+    PROP(&e,
+        dstr_append(out, &DSTR_LIT(
+            "\r\n"
+            "From: Alice <alice@example.com>\r\n"
+            "To: Bob <bob@example.com>\r\n"
+            "Subject: a message with many, many headers\r\n"
+            "Date: Tue, 30 May 2023 01:07:40 -0600\r\n"
+            "Message-ID: <20230530070740.1234@example.com>\r\n"
+            "MIME-Version: 1.0\r\n"
+            "Content-Type: text/plain; charset=us-ascii\r\n"
+            "\r\n"
+        ))
+    );
+    PROP(&e, filler(out, 16 * 1024) );
+
+    return e;
+}
+
+static derr_t corpus_add(
+    corpus_t *corpora,
+    size_t *ncorpora,
+    dstr_t name,
+    corpus_kind_e kind,
+    derr_t (*gen)(dstr_t*),
+    const char *text
+){
+    derr_t e = E_OK;
+
+    corpus_t *c = &corpora[(*ncorpora)++];
+    *c = (corpus_t){ .name = name, .kind = kind };
+    PROP(&e, dstr_new(&c->text, 4096) );
+    if(gen){
+        PROP(&e, gen(&c->text) );
+    }else{
+        dstr_t d = dstr_from_cstr((char*)text);
+        PROP(&e, dstr_append(&c->text, &d) );
+    }
+
+    return e;
+}
+
+static void free_resps(link_t *list){
+    link_t *link;
+    while((link = link_list_pop_first(list))){
+        imap_resp_free(CONTAINER_OF(link, imap_resp_t, link));
+    }
+}
+
+static void free_cmds(link_t *list){
+    link_t *link;
+    while((link = link_list_pop_first(list))){
+        imap_cmd_free(CONTAINER_OF(link, imap_cmd_t, link));
+    }
+}
+
+static derr_t read_resps(const dstr_t in, size_t chunk, link_t *out){
+    derr_t e = E_OK;
+
+    imap_resp_reader_t r = {0};
+
+    PROP(&e, imap_resp_reader_init(&r, &exts) );
+
+    for(size_t off = 0; off < in.len; off += chunk){
+        dstr_t piece = dstr_sub2(in, off, off + chunk);
+        PROP_GO(&e, imap_resp_read(&r, piece, out), cu);
+    }
+
+cu:
+    imap_resp_reader_free(&r);
+    return e;
+}
+
+static derr_t bench_resp_read(const dstr_t in, size_t chunk, stats_t *s){
+    derr_t e = E_OK;
+
+    imap_resp_reader_t r = {0};
+    link_t out = {0};
+
+    PROP(&e, imap_resp_reader_init(&r, &exts) );
+
+    size_t allocs = ALLOCS();
+    clock_t start = clock();
+    do {
+        for(size_t off = 0; off < in.len; off += chunk){
+            dstr_t piece = dstr_sub2(in, off, off + chunk);
+            PROP_GO(&e, imap_resp_read(&r, piece, &out), cu);
+            s->objs += link_list_count(&out);
+            free_resps(&out);
+        }
+        s->bytes += in.len;
+    } while(since(start) < budget);
+    s->secs = since(start);
+    s->allocs = ALLOCS() - allocs;
+
+cu:
+    free_resps(&out);
+    imap_resp_reader_free(&r);
+    return e;
+}
+
+static derr_t bench_resp_write(const dstr_t in, size_t chunk, stats_t *s){
+    derr_t e = E_OK;
+
+    link_t resps = {0};
+    dstr_t buf = {0};
+    imap_resp_t *resp;
+
+    PROP_GO(&e, read_resps(in, in.len, &resps), cu);
+    PROP_GO(&e, dstr_new(&buf, chunk), cu);
+
+    size_t allocs = ALLOCS();
+    clock_t start = clock();
+    do {
+        LINK_FOR_EACH(resp, &resps, imap_resp_t, link){
+            size_t skip = 0;
+            size_t want = 1;
+            while(want){
+                buf.len = 0;
+                PROP_GO(&e,
+                    imap_resp_write(resp, &buf, &skip, &want, &exts),
+                cu);
+                s->bytes += buf.len;
+            }
+            s->objs++;
+        }
+    } while(since(start) < budget);
+    s->secs = since(start);
+    s->allocs = ALLOCS() - allocs;
+
+cu:
+    dstr_free(&buf);
+    free_resps(&resps);
+    return e;
+}
+
+static derr_t read_cmds(const dstr_t in, size_t chunk, link_t *out){
+    derr_t e = E_OK;
+
+    imap_cmd_reader_t r = {0};
+    dstr_t copy = {0};
+
+    PROP(&e, imap_cmd_reader_init(&r, &exts) );
+    // imap_cmd_read() may zeroize passwords, so always read a copy
+    PROP_GO(&e, dstr_new(&copy, in.len), cu);
+    PROP_GO(&e, dstr_append(&copy, &in), cu);
+
+    for(size_t off = 0; off < copy.len; off += chunk){
+        dstr_t piece = dstr_sub2(copy, off, off + chunk);
+        PROP_GO(&e, imap_cmd_read(&r, piece, out), cu);
+    }
+
+cu:
+    dstr_free(&copy);
+    imap_cmd_reader_free(&r);
+    return e;
+}
+
+static derr_t bench_cmd_read(const dstr_t in, size_t chunk, stats_t *s){
+    derr_t e = E_OK;
+
+    imap_cmd_reader_t r = {0};
+    link_t out = {0};
+    dstr_t copy = {0};
+
+    PROP(&e, imap_cmd_reader_init(&r, &exts) );
+    PROP_GO(&e, dstr_new(&copy, in.len), cu);
+
+    size_t allocs = ALLOCS();
+    clock_t start = clock();
+    do {
+        copy.len = 0;
+        PROP_GO(&e, dstr_append(&copy, &in), cu);
+        for(size_t off = 0; off < copy.len; off += chunk){
+            dstr_t piece = dstr_sub2(copy, off, off + chunk);
+            PROP_GO(&e, imap_cmd_read(&r, piece, &out), cu);
+            s->objs += link_list_count(&out);
+            free_cmds(&out);
+        }
+        s->bytes += in.len;
+    } while(since(start) < budget);
+    s->secs = since(start);
+    s->allocs = ALLOCS() - allocs;
+
+cu:
+    free_cmds(&out);
+    dstr_free(&copy);
+    imap_cmd_reader_free(&r);
+    return e;
+}
+
+static derr_t bench_cmd_write(const dstr_t in, size_t chunk, stats_t *s){
+    derr_t e = E_OK;
+
+    link_t cmds = {0};
+    dstr_t buf = {0};
+    imap_cmd_t *cmd;
+
+    PROP_GO(&e, read_cmds(in, in.len, &cmds), cu);
+    PROP_GO(&e, dstr_new(&buf, chunk), cu);
+
+    size_t allocs = ALLOCS();
+    clock_t start = clock();
+    do {
+        LINK_FOR_EACH(cmd, &cmds, imap_cmd_t, link){
+            // the reader's requests for a "+" are not on the wire
+            if(cmd->type == IMAP_CMD_PLUS_REQ) continue;
+            size_t skip = 0;
+            size_t want = 1;
+            while(want){
+                buf.len = 0;
+                PROP_GO(&e,
+                    imap_cmd_write(cmd, &buf, &skip, &want, &exts),
+                cu);
+                s->bytes += buf.len;
+            }
+            s->objs++;
+        }
+    } while(since(start) < budget);
+    s->secs = since(start);
+    s->allocs = ALLOCS() - allocs;
+
+cu:
+    dstr_free(&buf);
+    free_cmds(&cmds);
+    return e;
+}
+
+static derr_t bench_imf_parse(const dstr_t in, stats_t *s){
+    derr_t e = E_OK;
+
+    size_t allocs = ALLOCS();
+    clock_t start = clock();
+    do {
+        imf_t *imf = NULL;
+        PROP(&e, imf_parse(&in, NULL, NULL, NULL, &imf) );
+        imf_free(imf);
+        s->bytes += in.len;
+        s->objs++;
+    } while(since(start) < budget);
+    s->secs = since(start);
+    s->allocs = ALLOCS() - allocs;
+
+    return e;
+}
+
+// feeds a message to the imf scanner, chunk bytes at a time
+typedef struct {
+    dstr_t in;
+    dstr_t *buf;
+    size_t chunk;
+} imf_feed_t;
+
+static derr_t imf_feed(void *data, size_t *amnt_read){
+    derr_t e = E_OK;
+
+    imf_feed_t *feed = data;
+    size_t off = feed->buf->len;
+    dstr_t piece = dstr_sub2(feed->in, off, off + feed->chunk);
+    PROP(&e, dstr_append(feed->buf, &piece) );
+    *amnt_read = piece.len;
+
+    return e;
+}
+
+static derr_t bench_imf_hdrs(const dstr_t in, size_t chunk, stats_t *s){
+    derr_t e = E_OK;
+
+    dstr_t buf = {0};
+
+    // preallocate, so only the parser's allocations are counted
+    PROP(&e, dstr_new(&buf, in.len) );
+    imf_feed_t feed = { .in = in, .buf = &buf, .chunk = chunk };
+
+    size_t allocs = ALLOCS();
+    clock_t start = clock();
+    do {
+        imf_hdrs_t *hdrs = NULL;
+        buf.len = 0;
+        PROP_GO(&e, imf_hdrs_parse(&buf, imf_feed, &feed, &hdrs), cu);
+        s->bytes += hdrs->bytes.len;
+        s->objs++;
+        imf_hdrs_free(hdrs);
+    } while(since(start) < budget);
+    s->secs = since(start);
+    s->allocs = ALLOCS() - allocs;
+
+cu:
+    dstr_free(&buf);
+    return e;
+}
+
+static void report(
+    const corpus_t *c, const char *op, size_t chunk, const stats_t *s
+){
+    char chunkstr[32] = "-";
+    if(chunk) snprintf(chunkstr, sizeof(chunkstr), "%zu", chunk);
+    double secs = s->secs > 0 ? s->secs : 1e-9;
+    double objs = s->objs ? (double)s->objs : 1;
+    printf(
+        "%-20.*s %-6s %6s %9.1f %12.0f",
+        (int)MIN(c->name.len, 20),
+        c->name.data,
+        op,
+        chunkstr,
+        (double)s->bytes / 1e6 / secs,
+        (double)s->objs / secs
+    );
+#ifdef BENCH_COUNT_ALLOCS
+    printf(" %10.1f", (double)s->allocs / objs);
+#else
+    (void)objs;
+    printf(" %10s", "-");
+#endif
+    printf(" %10zu\n", peak_rss_kb());
+    fflush(stdout);
+}
+
+static derr_t run_corpus(const corpus_t *c, const chunks_t *chunks){
+    derr_t e = E_OK;
+
+    stats_t s;
+
+    if(c->kind == CORPUS_EML){
+        s = (stats_t){0};
+        PROP(&e, bench_imf_parse(c->text, &s) );
+        report(c, "parse", 0, &s);
+    }
+
+    for(size_t i = 0; i < chunks->n; i++){
+        size_t chunk = chunks->sizes[i];
+        // the writers have a minimum chunk size of 2 bytes
+        size_t wchunk = MAX(chunk, 2);
+        switch(c->kind){
+            case CORPUS_RESP:
+                s = (stats_t){0};
+                PROP(&e, bench_resp_read(c->text, chunk, &s) );
+                report(c, "read", chunk, &s);
+                s = (stats_t){0};
+                PROP(&e, bench_resp_write(c->text, wchunk, &s) );
+                report(c, "write", wchunk, &s);
+                break;
+
+            case CORPUS_CMD:
+                s = (stats_t){0};
+                PROP(&e, bench_cmd_read(c->text, chunk, &s) );
+                report(c, "read", chunk, &s);
+                s = (stats_t){0};
+                PROP(&e, bench_cmd_write(c->text, wchunk, &s) );
+                report(c, "write", wchunk, &s);
+                break;
+
+            case CORPUS_EML:
+                s = (stats_t){0};
+                PROP(&e, bench_imf_hdrs(c->text, chunk, &s) );
+                report(c, "hdrs", chunk, &s);
+                break;
+        }
+    }
+
+    return e;
+}
+
+static derr_t chunk_cb(void *data, dstr_t val){
+    derr_t e = E_OK;
+
+    chunks_t *chunks = data;
+    if(chunks->n == MAX_CHUNKS){
+        ORIG(&e, E_PARAM, "too many --chunk options");
+    }
+    size_t chunk;
+    PROP(&e, dstr_tosize(&val, &chunk, 10) );
+    if(chunk < 1) ORIG(&e, E_PARAM, "--chunk must be at least 1");
+    chunks->sizes[chunks->n++] = chunk;
+
+    return e;
+}
+
+static void print_help(FILE *f){
+    fprintf(f,
+        "bench_imap: libimap throughput on recorded or synthetic traffic\n"
+        "\n"
+        "usage: bench_imap [OPTIONS] [CORPUS...]\n"
+        "\n"
+        "where OPTIONS are one of:\n"
+        "  -t --millis N    minimum cpu time per measurement (default 250)\n"
+        "  -c --chunk N     chunk size; repeat to sweep\n"
+        "                   (default: 1 7 64 1024 16384)\n"
+        "\n"
+        "and CORPUS files are named by what they contain:\n"
+        "  *.resp           server side of an IMAP session\n"
+        "  *.cmd            client side of an IMAP session\n"
+        "  *.eml            one IMF message\n"
+    );
+}
+
+int main(int argc, char **argv){
+    derr_t e = E_OK;
+
+    chunks_t chunks = {0};
+    corpus_t corpora[64];
+    size_t ncorpora = 0;
+
+    opt_spec_t o_millis = {'t', "millis", true};
+    opt_spec_t o_chunk = {'c', "chunk", true, chunk_cb, &chunks};
+    opt_spec_t* spec[] = {
+        &o_millis,
+        &o_chunk,
+    };
+    size_t speclen = sizeof(spec) / sizeof(*spec);
+    int newargc;
+
+    logger_add_fileptr(LOG_LVL_WARN, stderr);
+
+    IF_PROP(&e, opt_parse(argc, argv, spec, speclen, &newargc) ){
+        print_help(stderr);
+        goto cu;
+    }
+    if((size_t)newargc - 1 > sizeof(corpora) / sizeof(*corpora)){
+        print_help(stderr);
+        ORIG_GO(&e, E_PARAM, "too many corpora", cu);
+    }
+
+    if(o_millis.found){
+        size_t millis;
+        PROP_GO(&e, dstr_tosize(&o_millis.val, &millis, 10), cu);
+        budget = (double)millis / 1000;
+    }
+
+    if(!chunks.n){
+        size_t defaults[] = {1, 7, 64, 1024, 16384};
+        chunks.n = sizeof(defaults) / sizeof(*defaults);
+        memcpy(chunks.sizes, defaults, sizeof(defaults));
+    }
+
+    if(newargc < 2){
+        #define ADD(name, kind, gen, text) \
+            PROP_GO(&e, \
+                corpus_add( \
+                    corpora, &ncorpora, DSTR_LIT(name), kind, gen, text \
+                ), \
+            cu)
+        ADD("session.resp", CORPUS_RESP, NULL, session_resp);
+        ADD("session.cmd", CORPUS_CMD, NULL, session_cmd);
+        ADD("fetch.resp", CORPUS_RESP, gen_fetch, NULL);
+        ADD("search.resp", CORPUS_RESP, gen_search, NULL);
+        ADD("vanished.resp", CORPUS_RESP, gen_vanished, NULL);
+        ADD("uidsets.cmd", CORPUS_CMD, gen_uidsets, NULL);
+        ADD("headers.eml", CORPUS_EML, gen_eml, NULL);
+        #undef ADD
+    }
+
+    for(int i = 1; i < newargc; i++){
+        dstr_t path = dstr_from_cstr(argv[i]);
+        corpus_kind_e kind;
+        if(dstr_endswith2(path, DSTR_LIT(".resp"))){
+            kind = CORPUS_RESP;
+        }else if(dstr_endswith2(path, DSTR_LIT(".cmd"))){
+            kind = CORPUS_CMD;
+        }else if(dstr_endswith2(path, DSTR_LIT(".eml"))){
+            kind = CORPUS_EML;
+        }else{
+            print_help(stderr);
+            ORIG_GO(&e, E_PARAM, "unknown corpus type: %x", cu, FD(path));
+        }
+        corpus_t *c = &corpora[ncorpora++];
+        *c = (corpus_t){ .name = path, .kind = kind };
+        PROP_GO(&e, dstr_read_file(argv[i], &c->text), cu);
+    }
+
+    printf("backend: %s\n", BENCH_GENERATOR);
+    printf(
+        "%-20s %-6s %6s %9s %12s %10s %10s\n",
+        "corpus", "op", "chunk", "MB/s", "objs/s", "allocs/obj", "peak KB"
+    );
+    for(size_t i = 0; i < ncorpora; i++){
+        PROP_GO(&e, run_corpus(&corpora[i], &chunks), cu);
+    }
+
+cu:
+    for(size_t i = 0; i < ncorpora; i++){
+        dstr_free(&corpora[i].text);
+    }
+    if(is_error(e)){
+        DUMP(e);
+        DROP_VAR(&e);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include "libimap/libimap.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Parse throughput of the imap response and command readers on recorded
+   traffic.  When tests are enabled, libimap is built a second time with the
+   c-threaded backend of tools/gen.py; this file is linked against each build,
+   as bench_parse and bench_parse_threaded, so the two backends can be
+   compared on identical input.
+
+   Input is fed to the readers in CHUNK-byte pieces, as it would arrive from a
+   socket.  RESPFILE and CMDFILE are raw captures of one direction of an IMAP
+   session; without them a built-in capture of a short session is used.
+
+   usage: bench_parse [ROUNDS [RESPFILE [CMDFILE]]] */
+
+#ifndef BENCH_GENERATOR
+#define BENCH_GENERATOR "c"
+#endif
+
+#define CHUNK 4096
+
+// server side of a short session; the FETCH lines repeat in the real thing
+static const char *resp_capture =
+    "* OK [CAPABILITY IMAP4rev1 LITERAL+ SASL-IR LOGIN-REFERRALS ID ENABLE "
+    "IDLE AUTH=PLAIN] Dovecot ready.\r\n"
+    "1 OK [CAPABILITY IMAP4rev1 LITERAL+ SASL-IR LOGIN-REFERRALS ID ENABLE "
+    "IDLE SORT THREAD=REFERENCES MULTIAPPEND UNSELECT CHILDREN NAMESPACE "
+    "UIDPLUS LIST-EXTENDED I18NLEVEL=1 CONDSTORE QRESYNC ESEARCH SEARCHRES "
+    "WITHIN CONTEXT=SEARCH LIST-STATUS MOVE] Logged in\r\n"
+    "* ENABLED CONDSTORE QRESYNC\r\n"
+    "2 OK Enabled.\r\n"
+    "* LIST (\\HasNoChildren) \"/\" INBOX\r\n"
+    "* LIST (\\HasNoChildren \\Sent) \"/\" Sent\r\n"
+    "* LIST (\\HasNoChildren \\Trash) \"/\" Trash\r\n"
+    "3 OK List completed (0.001 + 0.000 secs).\r\n"
+    "* FLAGS (\\Answered \\Flagged \\Deleted \\Seen \\Draft)\r\n"
+    "* OK [PERMANENTFLAGS (\\Answered \\Flagged \\Deleted \\Seen \\Draft \\*)] "
+    "Flags permitted.\r\n"
+    "* 248 EXISTS\r\n"
+    "* 0 RECENT\r\n"
+    "* OK [UIDVALIDITY 1598473520] UIDs valid\r\n"
+    "* OK [UIDNEXT 1032] Predicted next UID\r\n"
+    "* OK [HIGHESTMODSEQ 4417] Highest\r\n"
+    "* VANISHED (EARLIER) 3:7,12,15:19,44,101:103,250:262,700\r\n"
+    "* 201 FETCH (UID 977 FLAGS (\\Seen) MODSEQ (4401))\r\n"
+    "* 202 FETCH (UID 978 FLAGS (\\Seen \\Answered) MODSEQ (4402))\r\n"
+    "* 203 FETCH (UID 981 FLAGS () MODSEQ (4405))\r\n"
+    "* 204 FETCH (UID 990 FLAGS (\\Seen \\Flagged $Forwarded) MODSEQ (4410))\r\n"
+    "4 OK [READ-WRITE] Select completed (0.002 + 0.000 secs).\r\n"
+    "* 248 FETCH (UID 1031 RFC822.SIZE 482 INTERNALDATE "
+    "\"30-May-2023 01:07:43 -0600\" BODY[] {482}\r\n"
+    "Return-Path: <alice@example.com>\r\n"
+    "Delivered-To: bob@example.com\r\n"
+    "Received: from mail.example.com ([192.0.2.7])\r\n"
+    "\tby mx.example.com with ESMTPS id 6cYbJGunVmQ\r\n"
+    "\tfor <bob@example.com>; Tue, 30 May 2023 07:07:43 +0000\r\n"
+    "From: Alice <alice@example.com>\r\n"
+    "To: Bob <bob@example.com>\r\n"
+    "Subject: lunch\r\n"
+    "Date: Tue, 30 May 2023 01:07:40 -0600\r\n"
+    "Message-ID: <20230530070740.1234@example.com>\r\n"
+    "MIME-Version: 1.0\r\n"
+    "Content-Type: text/plain; charset=us-ascii\r\n"
+    "\r\n"
+    "noon at the usual place?\r\n"
+    "-a\r\n"
+    "   ----\r\n"
+    ")\r\n"
+    "5 OK Fetch completed (0.001 + 0.000 secs).\r\n"
+    "* SEARCH 1 2 3 5 8 13 21 34 55 89 144 233\r\n"
+    "6 OK Search completed (0.001 + 0.000 secs).\r\n"
+    "* 12 FETCH (UID 55 MODSEQ (4418) FLAGS (\\Seen \\Deleted))\r\n"
+    "7 OK Store completed (0.001 + 0.000 secs).\r\n"
+    "* 12 EXPUNGE\r\n"
+    "8 OK Expunge completed (0.001 + 0.000 secs).\r\n"
+    "* STATUS Sent (MESSAGES 112 UIDNEXT 113 UNSEEN 0)\r\n"
+    "9 OK Status completed (0.001 + 0.000 secs).\r\n"
+    "10 OK NOOP completed (0.001 + 0.000 secs).\r\n";
+
+// client side of the same session
+static const char *cmd_capture =
+    "1 LOGIN bob@example.com hunter2\r\n"
+    "2 ENABLE CONDSTORE QRESYNC\r\n"
+    "3 LIST \"\" \"*\"\r\n"
+    "4 SELECT INBOX (QRESYNC (1598473520 4400 1:1031))\r\n"
+    "5 UID FETCH 1031 (UID RFC822.SIZE INTERNALDATE BODY.PEEK[])\r\n"
+    "6 UID SEARCH UNDELETED SINCE 1-Jan-2023 FROM \"alice\"\r\n"
+    "7 UID STORE 55 +FLAGS.SILENT (\\Deleted)\r\n"
+    "8 EXPUNGE\r\n"
+    "9 STATUS Sent (MESSAGES UIDNEXT UNSEEN)\r\n"
+    "10 NOOP\r\n"
+    "11 APPEND Sent (\\Seen) {27}\r\n"
+    "Subject: re: lunch\r\n"
+    "\r\n"
+    "yes\r\n"
+    "\r\n"
+    "12 IDLE\r\n"
+    "DONE\r\n";
+
+static void free_resps(link_t *out){
+    link_t *link;
+    while((link = link_list_pop_first(out))){
+        imap_resp_free(CONTAINER_OF(link, imap_resp_t, link));
+    }
+}
+
+static void free_cmds(link_t *out){
+    link_t *link;
+    while((link = link_list_pop_first(out))){
+        imap_cmd_free(CONTAINER_OF(link, imap_cmd_t, link));
+    }
+}
+
+static derr_t bench_resps(
+    extensions_t *exts, const dstr_t in, size_t rounds, double *secs, size_t *n
+){
+    derr_t e = E_OK;
+
+    imap_resp_reader_t r = {0};
+    link_t out = {0};
+
+    PROP(&e, imap_resp_reader_init(&r, exts) );
+
+    clock_t start = clock();
+    for(size_t i = 0; i < rounds; i++){
+        for(size_t off = 0; off < in.len; off += CHUNK){
+            dstr_t chunk = dstr_sub2(in, off, off + CHUNK);
+            PROP_GO(&e, imap_resp_read(&r, chunk, &out), cu);
+            *n += link_list_count(&out);
+            free_resps(&out);
+        }
+    }
+    *secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+cu:
+    free_resps(&out);
+    imap_resp_reader_free(&r);
+    return e;
+}
+
+static derr_t bench_cmds(
+    extensions_t *exts, const dstr_t in, size_t rounds, double *secs, size_t *n
+){
+    derr_t e = E_OK;
+
+    imap_cmd_reader_t r = {0};
+    link_t out = {0};
+    dstr_t copy = {0};
+
+    PROP(&e, imap_cmd_reader_init(&r, exts) );
+    // imap_cmd_read() may zeroize passwords, so every round reads a copy
+    PROP_GO(&e, dstr_new(&copy, in.len), cu);
+
+    clock_t start = clock();
+    for(size_t i = 0; i < rounds; i++){
+        copy.len = 0;
+        PROP_GO(&e, dstr_append(&copy, &in), cu);
+        for(size_t off = 0; off < copy.len; off += CHUNK){
+            dstr_t chunk = dstr_sub2(copy, off, off + CHUNK);
+            PROP_GO(&e, imap_cmd_read(&r, chunk, &out), cu);
+            *n += link_list_count(&out);
+            free_cmds(&out);
+        }
+    }
+    *secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+cu:
+    free_cmds(&out);
+    dstr_free(&copy);
+    imap_cmd_reader_free(&r);
+    return e;
+}
+
+static void report(const char *what, size_t bytes, double secs, size_t n){
+    printf(
+        "%s %s: %.1f MB in %.3fs = %.1f MB/s, %.0f objects/s\n",
+        BENCH_GENERATOR,
+        what,
+        (double)bytes / 1e6,
+        secs,
+        (double)bytes / 1e6 / secs,
+        (double)n / secs
+    );
+}
+
+int main(int argc, char **argv){
+    derr_t e = E_OK;
+
+    size_t rounds = argc > 1 ? strtoul(argv[1], NULL, 10) : 20000;
+    const char *resp_path = argc > 2 ? argv[2] : NULL;
+    const char *cmd_path = argc > 3 ? argv[3] : NULL;
+    if(rounds < 1){
+        fprintf(stderr, "ROUNDS must be at least 1\n");
+        return 1;
+    }
+
+    logger_add_fileptr(LOG_LVL_WARN, stderr);
+
+    dstr_t resp_file = {0};
+    dstr_t cmd_file = {0};
+    dstr_t resp_in = dstr_from_cstr((char*)resp_capture);
+    dstr_t cmd_in = dstr_from_cstr((char*)cmd_capture);
+    double secs = 0;
+    size_t n;
+
+    extensions_t exts = {
+        .uidplus = EXT_STATE_ON,
+        .enable = EXT_STATE_ON,
+        .condstore = EXT_STATE_ON,
+        .qresync = EXT_STATE_ON,
+        .unselect = EXT_STATE_ON,
+        .idle = EXT_STATE_ON,
+        .xkey = EXT_STATE_ON,
+    };
+
+    if(resp_path){
+        PROP_GO(&e, dstr_read_file(resp_path, &resp_file), cu);
+        resp_in = resp_file;
+    }
+    if(cmd_path){
+        PROP_GO(&e, dstr_read_file(cmd_path, &cmd_file), cu);
+        cmd_in = cmd_file;
+    }
+
+    n = 0;
+    PROP_GO(&e, bench_resps(&exts, resp_in, rounds, &secs, &n), cu);
+    report("responses", resp_in.len * rounds, secs, n);
+
+    n = 0;
+    PROP_GO(&e, bench_cmds(&exts, cmd_in, rounds, &secs, &n), cu);
+    report("commands", cmd_in.len * rounds, secs, n);
+
+cu:
+    dstr_free(&resp_file);
+    dstr_free(&cmd_file);
+    if(is_error(e)){
+        DUMP(e);
+        DROP_VAR(&e);
+        return 1;
+    }
+    return 0;
+}
@@ -2260,6 +2260,15 @@ fail:
     return NULL;
 }
 
+ie_fetch_resp_extra_t *ie_fetch_resp_extra_new_stream(derr_t *e,
+        ie_sect_t *sect, ie_nums_t *offset, size_t len){
+    ie_fetch_resp_extra_t *extra = ie_fetch_resp_extra_new(
+        e, sect, offset, NULL
+    );
+    if(extra) extra->len = len;
+    return extra;
+}
+
 void ie_fetch_resp_extra_free(ie_fetch_resp_extra_t *extra){
     if(!extra) return;
     ie_fetch_resp_extra_free(extra->next);
@@ -2710,6 +2719,13 @@ fail:
     return NULL;
 }
 
+ie_append_cmd_t *ie_append_cmd_new_stream(derr_t *e, ie_mailbox_t *m,
+        ie_flags_t *flags, imap_time_t time, size_t len){
+    ie_append_cmd_t *append = ie_append_cmd_new(e, m, flags, time, NULL);
+    if(append) append->len = len;
+    return append;
+}
+
 void ie_append_cmd_free(ie_append_cmd_t *append){
     if(!append) return;
     ie_mailbox_free(append->m);
@@ -2720,12 +2736,14 @@ void ie_append_cmd_free(ie_append_cmd_t *append){
 
 ie_append_cmd_t *ie_append_cmd_copy(derr_t *e, const ie_append_cmd_t *old){
     if(!old) return NULL;
-    return ie_append_cmd_new(e,
+    ie_append_cmd_t *append = ie_append_cmd_new(e,
         ie_mailbox_copy(e, old->m),
         ie_flags_copy(e, old->flags),
         old->time,
         ie_dstr_copy(e, old->content)
     );
+    if(append) append->len = old->len;
+    return append;
 }
 
 ie_search_cmd_t *ie_search_cmd_new(derr_t *e, bool uid_mode,
@@ -539,7 +539,10 @@ typedef struct ie_fetch_resp_extra_t {
     ie_sect_t *sect;
     // the <p1> from the <p1.p2> partial of the request
     ie_nums_t *offset;
+    // content is NULL when the literal was streamed to a literal sink
     ie_dstr_t *content;
+    // the length of a streamed literal
+    size_t len;
     struct ie_fetch_resp_extra_t *next;
 } ie_fetch_resp_extra_t;
 DEF_STEAL_PTR(ie_fetch_resp_extra_t)
@@ -636,7 +639,10 @@ typedef struct {
     ie_mailbox_t *m;
     ie_flags_t *flags;
     imap_time_t time;
+    // content is NULL when the literal is streamed separately
     ie_dstr_t *content;
+    // the length of a streamed literal
+    size_t len;
 } ie_append_cmd_t;
 DEF_STEAL_PTR(ie_append_cmd_t)
 
@@ -1147,6 +1153,9 @@ ie_body_t *ie_body_add(derr_t *e, ie_body_t *list, ie_body_t *new);
 
 ie_fetch_resp_extra_t *ie_fetch_resp_extra_new(derr_t *e, ie_sect_t *sect,
         ie_nums_t *offset, ie_dstr_t *content);
+// a BODY[] whose literal of len bytes was streamed to a literal sink
+ie_fetch_resp_extra_t *ie_fetch_resp_extra_new_stream(derr_t *e,
+        ie_sect_t *sect, ie_nums_t *offset, size_t len);
 void ie_fetch_resp_extra_free(ie_fetch_resp_extra_t *extra);
 
 ie_fetch_resp_t *ie_fetch_resp_new(derr_t *e);
@@ -1206,6 +1215,9 @@ ie_status_cmd_t *ie_status_cmd_copy(derr_t *e, const ie_status_cmd_t *old);
 
 ie_append_cmd_t *ie_append_cmd_new(derr_t *e, ie_mailbox_t *m,
         ie_flags_t *flags, imap_time_t time, ie_dstr_t *content);
+// an APPEND whose literal of len bytes will be streamed separately
+ie_append_cmd_t *ie_append_cmd_new_stream(derr_t *e, ie_mailbox_t *m,
+        ie_flags_t *flags, imap_time_t time, size_t len);
 void ie_append_cmd_free(ie_append_cmd_t *append);
 ie_append_cmd_t *ie_append_cmd_copy(derr_t *e, const ie_append_cmd_t *old);
 
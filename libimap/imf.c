@@ -1,7 +1,17 @@
 #include <stdlib.h>
+#include <string.h>
 
 #include "libimap/libimap.h"
 
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMF_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(IMF_SSE2) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 DSTR_STATIC(D_TEXT, "text");
 DSTR_STATIC(D_PLAIN, "plain");
 DSTR_STATIC(D_MESSAGE, "message");
@@ -274,6 +284,229 @@ void imf_handle_error(
     }
 }
 
+/* Splitting headers only requires finding line endings, and most of the
+   bytes in a header block are in long runs of field values that contain none,
+   so search for CR and LF 16 bytes at a time where SSE2 is available, and a
+   word at a time where it isn't. */
+
+#ifdef IMF_SSE2
+#ifdef _MSC_VER
+static unsigned int imf_ctz(unsigned int x){
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return (unsigned int)i;
+}
+#else
+#define imf_ctz(x) ((unsigned int)__builtin_ctz(x))
+#endif
+#endif
+
+static bool imf_is_eol(unsigned char c){
+    return c == '\r' || c == '\n';
+}
+
+static bool imf_is_ws(unsigned char c){
+    return c == ' ' || c == '\t';
+}
+
+// bytes which the scanner puts in tokens that field_name accepts
+static bool imf_is_name(unsigned char c){
+    return (c > ' ' && c < 0x7f && c != ':') || c >= 0x80;
+}
+
+bool _imf_find_eol_portable = false;
+
+#ifdef IMF_SSE2
+// skip 16-byte blocks without CR or LF; returns the index of the first EOL
+static size_t imf_skip_sse2(const char *p, size_t n){
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16){
+        __m128i v = _mm_loadu_si128((const __m128i*)(const void*)(p + i));
+        __m128i m = _mm_or_si128(
+            _mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)
+        );
+        unsigned int bits = (unsigned int)_mm_movemask_epi8(m);
+        if(bits) return i + imf_ctz(bits);
+    }
+    return i;
+}
+#endif
+
+// skip 8-byte words without CR or LF; an EOL may be anywhere after
+static size_t imf_skip_swar(const char *p, size_t n){
+    const uint64_t ones = 0x0101010101010101ull;
+    const uint64_t highs = 0x8080808080808080ull;
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        uint64_t x = w ^ (ones * '\r');
+        uint64_t y = w ^ (ones * '\n');
+        // nonzero if any byte of x or y is zero
+        if(((x - ones) & ~x & highs) | ((y - ones) & ~y & highs)) break;
+    }
+    return i;
+}
+
+size_t imf_find_eol(const char *p, size_t n){
+    size_t i = 0;
+#ifdef IMF_SSE2
+    if(!_imf_find_eol_portable) i = imf_skip_sse2(p, n);
+#endif
+    // finishes the sse2 tail, or is a noop when sse2 already found an EOL
+    i += imf_skip_swar(p + i, n - i);
+    for(; i < n; i++){
+        if(imf_is_eol((unsigned char)p[i])) return i;
+    }
+    return n;
+}
+
+/* The header fast path, which produces exactly what the hdrs grammar would,
+   but without tokenizing every byte.  Anything it does not expect (an invalid
+   field name, a missing colon, a final header without an EOL) is declined, so
+   the grammar can have its turn and report the error properly. */
+
+typedef struct {
+    imf_scanner_t *s;
+    size_t end;
+} imf_splitter_t;
+
+static unsigned char split_byte(imf_splitter_t *sp, size_t idx){
+    return ((unsigned char*)sp->s->bytes->data)[idx];
+}
+
+// make sure byte idx is available, calling the read_fn as needed
+static derr_t split_have(imf_splitter_t *sp, size_t idx, bool *ok){
+    derr_t e = E_OK;
+
+    while(idx >= sp->end){
+        if(!sp->s->read_fn){
+            *ok = false;
+            return e;
+        }
+        size_t amnt_read;
+        PROP(&e, sp->s->read_fn(sp->s->read_fn_data, &amnt_read) );
+        sp->end = sp->s->bytes->len;
+        if(amnt_read == 0){
+            *ok = false;
+            return e;
+        }
+    }
+
+    *ok = true;
+    return e;
+}
+
+// length of the EOL at idx, by the scanner's rules: (LF CR?) | (CR LF?)
+static derr_t split_eol(imf_splitter_t *sp, size_t idx, size_t *len){
+    derr_t e = E_OK;
+
+    unsigned char pair = split_byte(sp, idx) == '\n' ? '\r' : '\n';
+    bool ok;
+    PROP(&e, split_have(sp, idx + 1, &ok) );
+    *len = ok && split_byte(sp, idx + 1) == pair ? 2 : 1;
+
+    return e;
+}
+
+// *out is left NULL when the grammar should handle the headers instead
+static derr_t imf_hdrs_split(imf_scanner_t *s, imf_hdrs_t **out){
+    derr_t e = E_OK;
+
+    imf_splitter_t sp = {
+        .s = s,
+        .end = s->fixed_end != (size_t)-1 ? s->fixed_end : s->bytes->len,
+    };
+    const dstr_t *buf = s->bytes;
+    size_t start = s->start_idx;
+    size_t idx = start;
+    imf_hdr_t *hdr = NULL;
+    imf_hdr_t **tail = &hdr;
+    dstr_off_t sep;
+    bool ok;
+
+    while(true){
+        PROP_GO(&e, split_have(&sp, idx, &ok), fail);
+        if(!ok){
+            // EOF ends the headers too
+            sep = (dstr_off_t){ .buf = buf, .start = idx, .len = 0 };
+            break;
+        }
+        if(imf_is_eol(split_byte(&sp, idx))){
+            size_t len;
+            PROP_GO(&e, split_eol(&sp, idx, &len), fail);
+            sep = (dstr_off_t){ .buf = buf, .start = idx, .len = len };
+            break;
+        }
+
+        // field name, optional whitespace, colon
+        size_t name_start = idx;
+        while(true){
+            PROP_GO(&e, split_have(&sp, idx, &ok), fail);
+            if(!ok) goto decline;
+            if(!imf_is_name(split_byte(&sp, idx))) break;
+            idx++;
+        }
+        size_t name_end = idx;
+        if(name_end == name_start) goto decline;
+        while(imf_is_ws(split_byte(&sp, idx))){
+            idx++;
+            PROP_GO(&e, split_have(&sp, idx, &ok), fail);
+            if(!ok) goto decline;
+        }
+        if(split_byte(&sp, idx) != ':') goto decline;
+        idx++;
+
+        // value, through the first EOL not followed by a fold
+        size_t value_start = idx;
+        size_t value_end;
+        while(true){
+            while(true){
+                idx += imf_find_eol(buf->data + idx, sp.end - idx);
+                if(idx < sp.end) break;
+                PROP_GO(&e, split_have(&sp, idx, &ok), fail);
+                if(!ok) goto decline;
+            }
+            value_end = idx;
+            size_t len;
+            PROP_GO(&e, split_eol(&sp, idx, &len), fail);
+            idx += len;
+            PROP_GO(&e, split_have(&sp, idx, &ok), fail);
+            if(!ok || !imf_is_ws(split_byte(&sp, idx))) break;
+        }
+
+        dstr_off_t bytes = {
+            .buf = buf, .start = name_start, .len = idx - name_start
+        };
+        dstr_off_t name = {
+            .buf = buf, .start = name_start, .len = name_end - name_start
+        };
+        dstr_off_t value = {
+            .buf = buf, .start = value_start, .len = value_end - value_start
+        };
+        *tail = imf_hdr_new(&e, bytes, name, value);
+        CHECK_GO(&e, fail);
+        tail = &(*tail)->next;
+    }
+
+    dstr_off_t bytes = {
+        .buf = buf, .start = start, .len = sep.start + sep.len - start
+    };
+    *out = imf_hdrs_new(&e, bytes, sep, STEAL(imf_hdr_t, &hdr));
+    CHECK(&e);
+
+    s->start_idx = sep.start + sep.len;
+
+    return e;
+
+decline:
+fail:
+    imf_hdr_free(hdr);
+    return e;
+}
+
 static derr_t do_imf_hdrs_parse(
     const dstr_t *msg,
     imf_scanner_t *s,
@@ -282,6 +515,9 @@ static derr_t do_imf_hdrs_parse(
     derr_t e = E_OK;
     *out = NULL;
 
+    PROP(&e, imf_hdrs_split(s, out) );
+    if(*out) return e;
+
     IMF_ONSTACK_PARSER(p, IMF_HDRS_MAX_CALLSTACK, IMF_HDRS_MAX_SEMSTACK);
 
     size_t skip = s->start_idx;
@@ -486,6 +722,56 @@ derr_t imf_hdrs_parse_sub(const dstr_off_t bytes, imf_hdrs_t **out){
     imf_parser_reset(&p); \
 } while(0);
 
+/* The unstruct_field fast path: the same unfolding, in one copy and without
+   tokenizing.  Sets *ok to false for anything the grammar would reject. */
+static ie_dstr_t *imf_unfold(derr_t *e, const dstr_t in, bool *ok){
+    *ok = true;
+    if(is_error(*e)) goto fail;
+    if(!in.len) return NULL;
+
+    ie_dstr_t *out = ie_dstr_new_empty(e);
+    CHECK_GO(e, fail);
+    PROP_GO(e, dstr_grow(&out->dstr, in.len), fail_out);
+
+    size_t i = 0;
+    // ignore leading whitespace
+    while(i < in.len && imf_is_ws((unsigned char)in.data[i])) i++;
+    while(i < in.len){
+        size_t n = imf_find_eol(in.data + i, in.len - i);
+        dstr_t text = dstr_sub2(in, i, i + n);
+        // out was allocated big enough for every append
+        DROP_CMD( dstr_append(&out->dstr, &text) );
+        i += n;
+        if(i == in.len) break;
+        // folds become one space: 1*(EOL 1*WS)
+        do {
+            unsigned char c = (unsigned char)in.data[i++];
+            unsigned char pair = c == '\n' ? '\r' : '\n';
+            if(i < in.len && (unsigned char)in.data[i] == pair) i++;
+            if(i == in.len || !imf_is_ws((unsigned char)in.data[i])){
+                *ok = false;
+                goto fail_out;
+            }
+            while(i < in.len && imf_is_ws((unsigned char)in.data[i])) i++;
+        } while(i < in.len && imf_is_eol((unsigned char)in.data[i]));
+        DROP_CMD( dstr_append(&out->dstr, &DSTR_LIT(" ")) );
+    }
+
+    return out;
+
+fail_out:
+    ie_dstr_free(out);
+fail:
+    return NULL;
+}
+
+// unstructured fields only need the grammar when they are malformed
+#define imf_unstruct_or_nil(e, out, name, parse_fn) do { \
+    bool ok; \
+    out = imf_unfold(e, out##_field, &ok); \
+    if(!ok) imf_parse_or_nil(e, out, name, parse_fn); \
+} while(0);
+
 ie_envelope_t *read_envelope_info(derr_t *e, const imf_hdrs_t *hdrs){
     if(is_error(*e)) return NULL;
 
@@ -552,8 +838,8 @@ ie_envelope_t *read_envelope_info(derr_t *e, const imf_hdrs_t *hdrs){
     IMF_ONSTACK_PARSER(p, 20, 100);
 
     // note: date is unstructured becase the IMAP ENVELOPE uses nstring
-    imf_parse_or_nil(e, date, "Date", imf_parse_unstruct_field);
-    imf_parse_or_nil(e, subj, "Subject", imf_parse_subj_field);
+    imf_unstruct_or_nil(e, date, "Date", imf_parse_unstruct_field);
+    imf_unstruct_or_nil(e, subj, "Subject", imf_parse_subj_field);
     imf_parse_or_nil(e, from, "From", imf_parse_from_field);
     imf_parse_or_nil(e, sender, "Sender", imf_parse_sender_field);
     imf_parse_or_nil(e, reply_to, "Reply-To", imf_parse_reply_to_field);
@@ -732,7 +1018,7 @@ derr_t read_bodystruct_info(
     imf_parse_or_nil(&e, version, "MIME-Version", imf_parse_mime_version_field);
     imf_parse_or_nil(&e, content_type, "Content-Type", imf_parse_content_type_field);
     imf_parse_or_nil(&e, content_id, "Content-Id", imf_parse_content_id_field);
-    imf_parse_or_nil(&e, description, "Content-Description", imf_parse_content_description_field);
+    imf_unstruct_or_nil(&e, description, "Content-Description", imf_parse_content_description_field);
     imf_parse_or_nil(&e,
         content_transfer_encoding,
         "Content-Transfer-Encoding",
@@ -243,3 +243,8 @@ ie_body_t *imf_bodystructure(derr_t *e, const imf_t *root_imf);
 
 imap_time_t imf_parse_date_builder(derr_t *e, const dstr_t in);
 derr_t imf_parse_date(const dstr_t in, imap_time_t *out);
+
+// exposed for testing: index of the first CR or LF in p[:n], or n
+size_t imf_find_eol(const char *p, size_t n);
+// skips the SSE2 search even where it is available, useful for tests
+extern bool _imf_find_eol_portable;
@@ -27,6 +27,23 @@ typedef struct {
     bool fed;
 } imap_scanner_t;
 
+/* a literal sink receives the body of a large literal straight from the
+   scanner, rather than having the parser collect it into an ie_dstr_t.
+   Servers stream APPEND literals and clients stream FETCH BODY[] literals;
+   quoted strings and literals shorter than min_len are parsed normally, so
+   consumers must still handle content which arrives in the usual way. */
+typedef struct imap_literal_sink_i imap_literal_sink_i;
+struct imap_literal_sink_i {
+    // shorter literals are not streamed
+    size_t min_len;
+    /* called once per streamed literal, before its first chunk.  An APPEND
+       is emitted just before start(), a FETCH response after the final
+       chunk of its BODY[] literal. */
+    derr_t (*start)(imap_literal_sink_i*, size_t len);
+    // chunk points into the input buffer and is only valid during the call
+    derr_t (*chunk)(imap_literal_sink_i*, const dstr_t chunk);
+};
+
 typedef struct {
     scan_mode_t scan_mode;
     extensions_t *exts;
@@ -41,6 +58,10 @@ typedef struct {
     imap_scanner_t *scanner;
     // the output where cmds or responses are set
     link_t *out;
+    // when set, large APPEND or FETCH BODY[] literals go to the sink
+    imap_literal_sink_i *literal_sink;
+    // is the current literal going to the sink?
+    bool streaming;
 } imap_args_t;
 
 dstr_t* scan_mode_to_dstr(scan_mode_t mode);
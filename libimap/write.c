@@ -119,16 +119,22 @@ static derr_t st_code_text_skip_fill(skip_fill_t *sf, const dstr_t in){
     return e;
 }
 
-static derr_t literal_skip_fill(skip_fill_t *sf, const dstr_t in){
+static derr_t literal_header_skip_fill(skip_fill_t *sf, size_t len){
     derr_t e = E_OK;
     // generate the imap literal header
     DSTR_VAR(header, 64);
 
     // use LITERAL+ extension on commands
     const char *fmt = sf->is_cmd ? "{%x+}\r\n" : "{%x}\r\n";
-    PROP(&e, FMT(&header, fmt, FU(in.len)) );
+    PROP(&e, FMT(&header, fmt, FU(len)) );
 
     PROP(&e, raw_skip_fill(sf, header) );
+    return e;
+}
+
+static derr_t literal_skip_fill(skip_fill_t *sf, const dstr_t in){
+    derr_t e = E_OK;
+    PROP(&e, literal_header_skip_fill(sf, in.len) );
     PROP(&e, raw_skip_fill(sf, in) );
     return e;
 }
@@ -1068,6 +1074,7 @@ static derr_t do_imap_cmd_write(const imap_cmd_t *cmd, dstr_t *out,
     }
 
     imap_cmd_arg_t arg = cmd->arg;
+    bool streamed = false;
 
     // other than the DONE of IDLE or XKEYSYNC, all commands are tagged
     if(cmd->type != IMAP_CMD_IDLE_DONE && cmd->type != IMAP_CMD_XKEYSYNC_DONE){
@@ -1173,6 +1180,13 @@ static derr_t do_imap_cmd_write(const imap_cmd_t *cmd, dstr_t *out,
                 PROP(&e, date_time_skip_fill(sf, arg.append->time) );
                 STATIC_SKIP_FILL(" ");
             }
+            if(!arg.append->content){
+                /* a streamed literal: the caller writes the literal and the
+                   line break after it */
+                PROP(&e, literal_header_skip_fill(sf, arg.append->len) );
+                streamed = true;
+                break;
+            }
             PROP(&e, literal_skip_fill(sf, arg.append->content->dstr) );
             break;
 
@@ -1336,7 +1350,7 @@ static derr_t do_imap_cmd_write(const imap_cmd_t *cmd, dstr_t *out,
             ORIG(&e, E_INTERNAL, "unprintable command: unknown type");
     }
     // line break
-    STATIC_SKIP_FILL("\r\n");
+    if(!streamed) STATIC_SKIP_FILL("\r\n");
 
     // make sure we progressed further than last time
     if(enforce_output && sf->passed == *skip){
@@ -1826,6 +1840,10 @@ static derr_t fetch_resp_extra_skip_fill(skip_fill_t *sf,
         STATIC_SKIP_FILL(">");
     }
     STATIC_SKIP_FILL(" ");
+    // a streamed literal is no longer ours to write
+    if(!extra->content && extra->len){
+        ORIG(&e, E_PARAM, "unable to write a streamed BODY[] literal");
+    }
     PROP(&e, nstring_skip_fill(sf, extra->content) );
     return e;
 }
@@ -0,0 +1,553 @@
+/* bench_dns: throughput and latency of the dns server, for a synthetic mix of
+   queries.
+
+   Two paths are measured:
+
+     - "inproc": each query is fed straight through handle_packet(), using a
+       real kvpsync_recv_t behind the same kvp_i the server uses.
+
+     - "loopback": the real dns_main() runs in a background thread with real
+       libuv sockets on 127.0.0.1, the benchmark acts as its kvpsync peer, and
+       queries are sent one-at-a-time over udp.
+
+   For each query kind we report QPS, p50/p99 latency, and (inproc only, when
+   linked with --wrap=malloc) allocations per query.
+
+   usage: bench_dns [ROUNDS [LOOPBACK_ROUNDS [BASEPORT]]] */
+
+#define BUILD_BENCH
+#include "server/dns/main.c"
+
+#include <poll.h>
+
+#define NUSERS 1000
+#define NVARIANTS 64
+
+// allocation counting, active when linked with -Wl,--wrap=malloc etc
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+
+static _Atomic size_t nallocs = 0;
+
+void *__wrap_malloc(size_t size){
+    atomic_fetch_add_explicit(&nallocs, 1, memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size){
+    atomic_fetch_add_explicit(&nallocs, 1, memory_order_relaxed);
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size){
+    atomic_fetch_add_explicit(&nallocs, 1, memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
+
+typedef struct {
+    char buf[512];
+    size_t len;
+} query_t;
+
+typedef struct {
+    const char *name;
+    // malformed or out-of-zone queries get no response
+    bool responds;
+    query_t variants[NVARIANTS];
+    uint64_t *lat;  // nanoseconds, one per round
+    size_t nlat;
+    size_t allocs;
+} kind_t;
+
+static size_t put_uint16(uint16_t n, char *out, size_t used){
+    uint8_t *uptr = (uint8_t*)out;
+    uptr[used+0] = (unsigned char)((n >> 8) & 0xff);
+    uptr[used+1] = (unsigned char)((n >> 0) & 0xff);
+    return used + 2;
+}
+
+static size_t put_uint32(uint32_t n, char *out, size_t used){
+    used = put_uint16((uint16_t)(n >> 16), out, used);
+    return put_uint16((uint16_t)(n & 0xffff), out, used);
+}
+
+static void build_query(
+    query_t *q,
+    uint16_t qtype,
+    bool edns,
+    const lstr_t *labels,
+    size_t nlabels
+){
+    dns_hdr_t hdr = { .qdcount = 1, .arcount = edns ? 1 : 0, .rd = 1 };
+    size_t used = write_hdr(hdr, q->buf, sizeof(q->buf), 0);
+    used = put_name(labels, nlabels, q->buf, used);
+    used = put_uint16(qtype, q->buf, used);
+    used = put_uint16(1, q->buf, used);
+    if(edns){
+        // OPT pseudo-RR: root name, type, udp size, ttl, empty rdata
+        q->buf[used++] = '\0';
+        used = put_uint16(EDNS, q->buf, used);
+        used = put_uint16(4096, q->buf, used);
+        used = put_uint32(0, q->buf, used);
+        used = put_uint16(0, q->buf, used);
+    }
+    q->len = used;
+}
+
+static void set_id(query_t *q, uint16_t id){
+    put_uint16(id, q->buf, 0);
+}
+
+// usernames alternate case, to exercise lowercasing
+static void user_label(char *buf, size_t i, bool known){
+    sprintf(buf, "%s%zu", (i % 2) ? "U" : "u", known ? i : i + NUSERS);
+}
+
+#define KIND_QTYPE(_name, qtype, edns, ...) do { \
+    kinds[n] = (kind_t){ .name = _name, .responds = true }; \
+    for(size_t v = 0; v < NVARIANTS; v++){ \
+        const lstr_t labels[] = {__VA_ARGS__}; \
+        build_query(&kinds[n].variants[v], qtype, edns, \
+            labels, sizeof(labels)/sizeof(*labels)); \
+    } \
+    n++; \
+} while(0)
+
+#define USER LSTR("user")
+#define SM LSTR("splintermail")
+#define COM LSTR("com")
+#define ACME LSTR("_acme-challenge")
+
+// returns the number of kinds
+static size_t build_kinds(kind_t *kinds){
+    size_t n = 0;
+    char ubuf[32];
+    // the user label changes per variant
+    #define U ((lstr_t){ .str = ubuf, .len = strlen(ubuf) })
+
+    KIND_QTYPE("root SOA", SOA, false, USER, SM, COM);
+    KIND_QTYPE("root NS", NS, false, USER, SM, COM);
+    KIND_QTYPE("root CAA", CAA, false, USER, SM, COM);
+
+    kinds[n] = (kind_t){ .name = "user A", .responds = true };
+    for(size_t v = 0; v < NVARIANTS; v++){
+        user_label(ubuf, v, true);
+        build_query(&kinds[n].variants[v], A, false,
+            (lstr_t[]){U, USER, SM, COM}, 4);
+    }
+    n++;
+
+    kinds[n] = (kind_t){ .name = "user AAAA", .responds = true };
+    for(size_t v = 0; v < NVARIANTS; v++){
+        user_label(ubuf, v, true);
+        build_query(&kinds[n].variants[v], AAAA, false,
+            (lstr_t[]){U, USER, SM, COM}, 4);
+    }
+    n++;
+
+    kinds[n] = (kind_t){ .name = "acme TXT", .responds = true };
+    for(size_t v = 0; v < NVARIANTS; v++){
+        user_label(ubuf, v * 7 % NUSERS, true);
+        build_query(&kinds[n].variants[v], TXT, false,
+            (lstr_t[]){ACME, U, USER, SM, COM}, 5);
+    }
+    n++;
+
+    kinds[n] = (kind_t){ .name = "acme TXT edns", .responds = true };
+    for(size_t v = 0; v < NVARIANTS; v++){
+        user_label(ubuf, v * 13 % NUSERS, true);
+        build_query(&kinds[n].variants[v], TXT, true,
+            (lstr_t[]){ACME, U, USER, SM, COM}, 5);
+    }
+    n++;
+
+    kinds[n] = (kind_t){ .name = "acme TXT miss", .responds = true };
+    for(size_t v = 0; v < NVARIANTS; v++){
+        user_label(ubuf, v, false);
+        build_query(&kinds[n].variants[v], TXT, true,
+            (lstr_t[]){ACME, U, USER, SM, COM}, 5);
+    }
+    n++;
+
+    KIND_QTYPE("notimpl ANY", 255, false, USER, SM, COM);
+    KIND_QTYPE("name error", A, false,
+        LSTR("a"), LSTR("b"), USER, SM, COM
+    );
+
+    KIND_QTYPE("out of zone", A, false, LSTR("example"), COM);
+    kinds[n-1].responds = false;
+
+    // a header which promises a question that isn't there
+    kinds[n] = (kind_t){ .name = "malformed hdr", .responds = false };
+    for(size_t v = 0; v < NVARIANTS; v++){
+        query_t *q = &kinds[n].variants[v];
+        q->len = write_hdr((dns_hdr_t){ .qdcount = 1 }, q->buf, 512, 0);
+        q->len -= v % DNS_HDR_SIZE;
+    }
+    n++;
+
+    // a label which runs past the end of the packet
+    kinds[n] = (kind_t){ .name = "malformed label", .responds = false };
+    for(size_t v = 0; v < NVARIANTS; v++){
+        query_t *q = &kinds[n].variants[v];
+        q->len = write_hdr((dns_hdr_t){ .qdcount = 1 }, q->buf, 512, 0);
+        q->buf[q->len++] = 63;
+        memcpy(q->buf + q->len, "abc", 3);
+        q->len += 3;
+    }
+    n++;
+
+    #undef U
+    return n;
+}
+
+#define MAXKINDS 16
+
+static uint32_t rand_state = 1;
+static uint32_t next_rand(void){
+    uint32_t x = rand_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rand_state = x;
+}
+
+static kvp_update_t mk_update(
+    kvp_update_type_e type, uint32_t sync_id, uint32_t update_id
+){
+    return (kvp_update_t){
+        .type = type,
+        .ok_expiry = xtime() + 3600*SECOND,
+        .sync_id = sync_id,
+        .update_id = update_id,
+    };
+}
+
+/* call fn for each update a sender would emit to bring a fresh receiver up to
+   date with NUSERS acme challenges */
+static derr_t for_each_sync_update(
+    uint32_t recv_id, derr_t (*fn)(void*, kvp_update_t*), void *arg
+){
+    derr_t e = E_OK;
+
+    uint32_t sync_id = 0xb3;
+    uint32_t update_id = 1;
+
+    kvp_update_t u = mk_update(KVP_UPDATE_START, sync_id, update_id++);
+    u.resync_id = recv_id;
+    PROP(&e, fn(arg, &u) );
+
+    u = mk_update(KVP_UPDATE_FLUSH, sync_id, update_id++);
+    PROP(&e, fn(arg, &u) );
+
+    for(size_t i = 0; i < NUSERS; i++){
+        u = mk_update(KVP_UPDATE_INSERT, sync_id, update_id++);
+        u.klen = (uint8_t)sprintf(u.key, "u%zu", i);
+        u.vlen = (uint8_t)sprintf(u.val, "challenge-secret-for-u%zu", i);
+        PROP(&e, fn(arg, &u) );
+    }
+
+    return e;
+}
+
+static derr_t apply_update(void *arg, kvp_update_t *u){
+    derr_t e = E_OK;
+    kvpsync_recv_t *r = arg;
+    kvp_ack_t ack;
+    PROP(&e, kvpsync_recv_handle_update(r, xtime(), *u, &ack) );
+    return e;
+}
+
+static int cmp_u64(const void *a, const void *b){
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report(const char *path, kind_t *kinds, size_t nkinds, bool al){
+    printf("== %s ==\n", path);
+    printf("%-18s %10s %12s %10s %10s", "kind", "queries", "qps", "p50", "p99");
+    printf("%s\n", al ? "  allocs/q" : "");
+    size_t total_n = 0;
+    uint64_t total_ns = 0;
+    for(size_t k = 0; k < nkinds; k++){
+        kind_t *kind = &kinds[k];
+        if(!kind->nlat) continue;
+        uint64_t sum = 0;
+        for(size_t i = 0; i < kind->nlat; i++) sum += kind->lat[i];
+        qsort(kind->lat, kind->nlat, sizeof(*kind->lat), cmp_u64);
+        uint64_t p50 = kind->lat[kind->nlat / 2];
+        uint64_t p99 = kind->lat[kind->nlat * 99 / 100];
+        double qps = (double)kind->nlat / ((double)sum / (double)SECOND);
+        printf("%-18s %10zu %12.0f %8luns %8luns",
+            kind->name, kind->nlat, qps,
+            (unsigned long)p50, (unsigned long)p99
+        );
+        if(al){
+            printf(" %10.2f", (double)kind->allocs / (double)kind->nlat);
+        }
+        printf("\n");
+        total_n += kind->nlat;
+        total_ns += sum;
+    }
+    printf("%-18s %10zu %12.0f\n",
+        "total", total_n, (double)total_n / ((double)total_ns / SECOND)
+    );
+}
+
+// a kvp_i over one kvpsync_recv_t, the same way the server builds it
+static derr_t bench_inproc(kind_t *kinds, size_t nkinds, size_t nrounds){
+    derr_t e = E_OK;
+
+    globals_t g = {
+        .iface = { .get = globals_kvp_get },
+        .npeers = 1,
+    };
+
+    PROP(&e, kvpsync_recv_init(&g.recv[0]) );
+    PROP_GO(&e,
+        for_each_sync_update(g.recv[0].recv_id, apply_update, &g.recv[0]),
+    cu);
+
+    char resp[MEMBUFSIZE];
+    for(size_t r = 0; r < nrounds; r++){
+        for(size_t k = 0; k < nkinds; k++){
+            kind_t *kind = &kinds[k];
+            query_t *q = &kind->variants[next_rand() % NVARIANTS];
+            set_id(q, (uint16_t)r);
+            char qbuf[512];
+            memcpy(qbuf, q->buf, q->len);
+            size_t a0 = atomic_load(&nallocs);
+            xtime_t t0 = xtime();
+            g.now = t0;
+            size_t rlen = handle_packet(
+                qbuf, q->len, &g.iface, false, resp, sizeof(resp)
+            );
+            xtime_t t1 = xtime();
+            kind->allocs += atomic_load(&nallocs) - a0;
+            kind->lat[kind->nlat++] = t1 - t0;
+            if(!!rlen != kind->responds){
+                ORIG_GO(&e,
+                    E_VALUE,
+                    "%x: expected responds=%x",
+                    cu,
+                    FS(kind->name),
+                    FB(kind->responds)
+                );
+            }
+        }
+    }
+
+cu:
+    kvpsync_recv_free(&g.recv[0]);
+    return e;
+}
+
+typedef struct {
+    uint16_t port;
+    derr_t e;
+} server_arg_t;
+
+static void *server_thread(void *arg){
+    server_arg_t *s = arg;
+    int fd = -1;
+    DSTR_VAR(dnsbuf, 64);
+    DSTR_VAR(syncbuf, 64);
+    struct sockaddr_storage peer;
+    PROP_GO(&s->e, FMT(&dnsbuf, "127.0.0.1:%x", FU(s->port)), done);
+    PROP_GO(&s->e, FMT(&syncbuf, "127.0.0.1:%x", FU(s->port + 1)), done);
+    PROP_GO(&s->e,
+        read_addr(&peer, "127.0.0.1", (uint16_t)(s->port + 2)),
+    done);
+    addrspec_t dnsspec = must_parse_addrspec(&dnsbuf);
+    addrspec_t syncspec = must_parse_addrspec(&syncbuf);
+    // rrl disabled; every query comes from one address
+    PROP_GO(&s->e,
+        dns_main(
+            dnsspec,
+            &fd,
+            &fd,
+            syncspec,
+            &fd,
+            &peer,
+            1,
+            0,
+            RRL_CFG_DEFAULT,
+            NULL
+        ),
+    done);
+done:
+    return NULL;
+}
+
+static derr_t sock_for(uint16_t port, bool do_bind, int *out){
+    derr_t e = E_OK;
+
+    struct sockaddr_storage ss;
+    PROP(&e, read_addr(&ss, "127.0.0.1", port) );
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(fd < 0) ORIG(&e, E_OS, "socket(): %x", FE(errno));
+    int ret = do_bind
+        ? bind(fd, ss2sa(&ss), sizeof(struct sockaddr_in))
+        : connect(fd, ss2sa(&ss), sizeof(struct sockaddr_in));
+    if(ret){
+        close(fd);
+        ORIG(&e, E_OS, "bind/connect(): %x", FE(errno));
+    }
+    *out = fd;
+
+    return e;
+}
+
+static derr_t recv_timeout(int fd, char *buf, size_t cap, size_t *len){
+    derr_t e = E_OK;
+
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    int ret = poll(&pfd, 1, 5000);
+    if(ret < 0) ORIG(&e, E_OS, "poll(): %x", FE(errno));
+    if(ret == 0) ORIG(&e, E_CONN, "timed out waiting for the dns server");
+    ssize_t n = recv(fd, buf, cap, 0);
+    if(n < 0) ORIG(&e, E_OS, "recv(): %x", FE(errno));
+    *len = (size_t)n;
+
+    return e;
+}
+
+typedef struct {
+    int fd;
+    struct sockaddr_storage dst;
+} peer_t;
+
+static derr_t send_update(void *arg, kvp_update_t *u){
+    derr_t e = E_OK;
+    peer_t *p = arg;
+    DSTR_VAR(buf, 1024);
+    PROP(&e, kvpsync_update_write(u, &buf) );
+    ssize_t n = sendto(
+        p->fd, buf.data, buf.len, 0, ss2sa(&p->dst), sizeof(struct sockaddr_in)
+    );
+    if(n < 0) ORIG(&e, E_OS, "sendto(): %x", FE(errno));
+    // don't outrun the server's membufs
+    if(u->update_id % 64 == 0) usleep(1000);
+    return e;
+}
+
+static derr_t bench_loopback(
+    kind_t *kinds, size_t nkinds, size_t nrounds, uint16_t port
+){
+    derr_t e = E_OK;
+
+    int peerfd = -1;
+    int dnsfd = -1;
+
+    // be the server's kvpsync peer so acme answers come from a synced recv
+    PROP(&e, sock_for((uint16_t)(port + 2), true, &peerfd) );
+    PROP_GO(&e, sock_for(port, false, &dnsfd), cu);
+
+    static server_arg_t s;
+    s = (server_arg_t){ .port = port };
+    dthread_t thread;
+    PROP_GO(&e, dthread_create(&thread, server_thread, &s), cu);
+
+    // the server sends its resync request when it starts
+    char buf[MEMBUFSIZE];
+    size_t len;
+    PROP_GO(&e, recv_timeout(peerfd, buf, sizeof(buf), &len), cu);
+    dstr_t rbuf;
+    DSTR_WRAP(rbuf, buf, len, false);
+    kvp_ack_t ack;
+    if(!kvpsync_ack_read(rbuf, &ack)){
+        ORIG_GO(&e, E_RESPONSE, "invalid resync request", cu);
+    }
+    peer_t p = { .fd = peerfd };
+    PROP_GO(&e, read_addr(&p.dst, "127.0.0.1", (uint16_t)(port + 1)), cu);
+    PROP_GO(&e, for_each_sync_update(ack.sync_id, send_update, &p), cu);
+    // let the updates land
+    usleep(100000);
+
+    for(size_t r = 0; r < nrounds; r++){
+        for(size_t k = 0; k < nkinds; k++){
+            kind_t *kind = &kinds[k];
+            if(!kind->responds) continue;
+            query_t *q = &kind->variants[next_rand() % NVARIANTS];
+            uint16_t id = (uint16_t)r;
+            set_id(q, id);
+            xtime_t t0 = xtime();
+            ssize_t n = send(dnsfd, q->buf, q->len, 0);
+            if(n < 0) ORIG_GO(&e, E_OS, "send(): %x", cu, FE(errno));
+            // discard any stale responses
+            do {
+                PROP_GO(&e, recv_timeout(dnsfd, buf, sizeof(buf), &len), cu);
+            } while(len < 2 || ((uint8_t)buf[0] << 8 | (uint8_t)buf[1]) != id);
+            xtime_t t1 = xtime();
+            kind->lat[kind->nlat++] = t1 - t0;
+        }
+    }
+
+    /* there's no clean way to stop dns_main from outside its loop, so the
+       server thread is left running and exits with the process */
+
+cu:
+    if(peerfd > -1) close(peerfd);
+    if(dnsfd > -1) close(dnsfd);
+    return e;
+}
+
+static void reset_kinds(kind_t *kinds, size_t nkinds){
+    for(size_t k = 0; k < nkinds; k++){
+        kinds[k].nlat = 0;
+        kinds[k].allocs = 0;
+    }
+}
+
+int main(int argc, char **argv){
+    derr_t e = E_OK;
+
+    size_t nrounds = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+    size_t nloop = argc > 2 ? strtoul(argv[2], NULL, 10) : 5000;
+    unsigned long port = argc > 3 ? strtoul(argv[3], NULL, 10) : 9950;
+    if(port < 1024 || port > 65000){
+        fprintf(stderr, "BASEPORT must be between 1024 and 65000\n");
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    logger_add_fileptr(LOG_LVL_WARN, stderr);
+
+    kind_t kinds[MAXKINDS];
+    size_t nkinds = build_kinds(kinds);
+    size_t nlat = MAX(nrounds, nloop);
+    for(size_t k = 0; k < nkinds; k++){
+        kinds[k].lat = malloc(nlat * sizeof(*kinds[k].lat));
+        if(!kinds[k].lat) ORIG_GO(&e, E_NOMEM, "nomem", cu);
+    }
+
+    // detect if allocation counting is linked in
+    size_t a0 = atomic_load(&nallocs);
+    free(malloc(1));
+    bool counting = atomic_load(&nallocs) != a0;
+
+    PROP_GO(&e, bench_inproc(kinds, nkinds, nrounds), cu);
+    report("inproc handle_packet", kinds, nkinds, counting);
+
+    if(nloop){
+        reset_kinds(kinds, nkinds);
+        PROP_GO(&e, bench_loopback(kinds, nkinds, nloop, (uint16_t)port), cu);
+        report("loopback udp", kinds, nkinds, false);
+    }
+
+cu:
+    for(size_t k = 0; k < nkinds; k++){
+        if(kinds[k].lat) free(kinds[k].lat);
+    }
+    if(is_error(e)){
+        DUMP(e);
+        DROP_VAR(&e);
+        return 1;
+    }
+    return 0;
+}
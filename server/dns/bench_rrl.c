@@ -0,0 +1,139 @@
+#include "server/dns/libdns.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* A microbenchmark for rrl_check().  Each thread checks a stream of
+   pseudorandom client addresses (a mix of IPv4 and IPv6) against one shared
+   rrl_t and we report aggregate calls per second.
+
+   usage: bench_rrl [NTHREADS [NCALLS [NBUCKETS]]] */
+
+#define NADDRS 4096
+
+typedef struct {
+    rrl_t *rrl;
+    struct sockaddr_storage *addrs;
+    size_t ncalls;
+    size_t nok;
+    size_t nslip;
+    size_t ndrop;
+} worker_t;
+
+static void *worker(void *arg){
+    worker_t *w = arg;
+    xtime_t start = xtime();
+    for(size_t i = 0; i < w->ncalls; i++){
+        const struct sockaddr *sa = ss2sa(&w->addrs[i % NADDRS]);
+        // advance the clock a tick every so often so buckets refill
+        xtime_t now = start + (xtime_t)(i >> 16) * SECOND;
+        switch(rrl_check(w->rrl, sa, now)){
+            case RRL_OK: w->nok++; break;
+            case RRL_SLIP: w->nslip++; break;
+            case RRL_DROP: w->ndrop++; break;
+        }
+    }
+    return NULL;
+}
+
+// xorshift, so every run benchmarks the same address stream
+static uint32_t next(uint32_t *state){
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static void make_addrs(struct sockaddr_storage *addrs, uint32_t seed){
+    uint32_t state = seed | 1;
+    for(size_t i = 0; i < NADDRS; i++){
+        addrs[i] = (struct sockaddr_storage){0};
+        if(i % 2 == 0){
+            struct sockaddr_in *sin = (struct sockaddr_in*)&addrs[i];
+            sin->sin_family = AF_INET;
+            sin->sin_port = htons(53);
+            sin->sin_addr.s_addr = next(&state);
+        }else{
+            struct sockaddr_in6 *sin6 = (struct sockaddr_in6*)&addrs[i];
+            sin6->sin6_family = AF_INET6;
+            sin6->sin6_port = htons(53);
+            for(size_t j = 0; j < 16; j += 4){
+                uint32_t r = next(&state);
+                memcpy(&sin6->sin6_addr.s6_addr[j], &r, sizeof(r));
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv){
+    derr_t e = E_OK;
+
+    size_t nthreads = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+    size_t ncalls = argc > 2 ? strtoul(argv[2], NULL, 10) : 10000000;
+    size_t nbuckets = argc > 3 ? strtoul(argv[3], NULL, 10) : 62499971;
+    if(nthreads < 1 || nthreads > 64){
+        fprintf(stderr, "NTHREADS must be between 1 and 64\n");
+        return 1;
+    }
+
+    logger_add_fileptr(LOG_LVL_INFO, stderr);
+
+    rrl_t rrl = {0};
+    struct sockaddr_storage *addrs = NULL;
+    worker_t workers[64] = {0};
+    dthread_t threads[64];
+
+    PROP_GO(&e, rrl_init(&rrl, nbuckets, RRL_CFG_DEFAULT), cu);
+
+    addrs = malloc(nthreads * NADDRS * sizeof(*addrs));
+    if(!addrs) ORIG_GO(&e, E_NOMEM, "nomem", cu);
+
+    for(size_t i = 0; i < nthreads; i++){
+        make_addrs(&addrs[i * NADDRS], (uint32_t)i + 1);
+        workers[i] = (worker_t){
+            .rrl = &rrl,
+            .addrs = &addrs[i * NADDRS],
+            .ncalls = ncalls,
+        };
+    }
+
+    xtime_t start = xtime();
+    size_t nstarted = 0;
+    for(; nstarted < nthreads; nstarted++){
+        PROP_GO(&e,
+            dthread_create(&threads[nstarted], worker, &workers[nstarted]),
+        join);
+    }
+join:
+    for(size_t i = 0; i < nstarted; i++){
+        dthread_join(&threads[i]);
+    }
+    if(is_error(e)) goto cu;
+    xtime_t end = xtime();
+
+    size_t nok = 0, nslip = 0, ndrop = 0;
+    for(size_t i = 0; i < nthreads; i++){
+        nok += workers[i].nok;
+        nslip += workers[i].nslip;
+        ndrop += workers[i].ndrop;
+    }
+
+    double secs = (double)(end - start) / (double)SECOND;
+    double total = (double)(nthreads * ncalls);
+    printf(
+        "threads=%zu calls=%.0f time=%.3fs rate=%.2fM calls/s "
+        "(ok=%zu slip=%zu drop=%zu)\n",
+        nthreads, total, secs, total / secs / 1e6, nok, nslip, ndrop
+    );
+
+cu:
+    rrl_free(&rrl);
+    if(addrs) free(addrs);
+    if(is_error(e)){
+        DUMP(e);
+        DROP_VAR(&e);
+        return 1;
+    }
+    return 0;
+}
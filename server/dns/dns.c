@@ -216,6 +216,21 @@ size_t respond_acme(void *arg, const dns_pkt_t pkt, char *out, size_t cap){
 
 }
 
+/* a slipped response: an empty, truncated answer, which offers an attacker no
+   amplification but tells a legitimate resolver to retry over tcp */
+size_t respond_slip(void *arg, const dns_pkt_t pkt, char *out, size_t cap){
+    (void)arg;
+
+    size_t used = write_qstn(pkt.qstn, out, cap, DNS_HDR_SIZE);
+    if(used > cap) return 0;
+
+    bool aa = false;
+    bool tc = true;
+    write_response_hdr(pkt.hdr, RCODE_OK, aa, tc, 0, 0, 0, out, cap, 0);
+
+    return used;
+}
+
 // always sets *respond and *user
 respond_f sort_pkt(const dns_pkt_t pkt, const lstr_t *rname, size_t n){
     // only service queries
@@ -257,7 +272,7 @@ respond_f sort_pkt(const dns_pkt_t pkt, const lstr_t *rname, size_t n){
 }
 
 size_t handle_packet(
-    char *qbuf, size_t qlen, kvp_i *kvp, char *rbuf, size_t rcap
+    char *qbuf, size_t qlen, kvp_i *kvp, bool slip, char *rbuf, size_t rcap
 ){
     // require a minimum rcap size to function
     if(rcap < 512){
@@ -274,24 +289,25 @@ size_t handle_packet(
 
     LOG_DEBUG("%x", FPKT(pkt));
 
-    /* save one label more than we'll ever read, so that sort_pkt can be aware
-       of junk queries which are only junk because of the extra labels */
-    lstr_t rname[6] = {0};
-    size_t cap = sizeof(rname) / sizeof(*rname);
-    size_t n = labels_read_reverse(pkt.qstn.ptr, pkt.qstn.off, rname, cap);
-    if(n > cap){
-        // too many labels; but we don't actually care
-        n = cap;
+    qname_t q;
+    qname_read(&q, pkt.qstn.ptr, pkt.qstn.off);
+    // too many labels; but we don't actually care
+    size_t n = MIN(q.n, QNAME_RLABELS);
+    respond_f respond = sort_pkt(pkt, q.rname, n);
+
+    // rate-limited queries get the same empty answer, whatever they asked
+    if(slip && respond != norespond){
+        respond = respond_slip;
     }
-    respond_f respond = sort_pkt(pkt, rname, n);
 
     void *arg = NULL;
     lstr_t secret = {0};
     if(respond == respond_acme){
         // username would be at index 3: com.splintermail.user.*
         if(n < 4) LOG_FATAL("respond_acme doesn't have enough labels\n");
-        lstr_t user = rname[3];
-        const dstr_t *dsecret = kvp->iget(kvp, user);
+        dstr_t user;
+        DSTR_WRAP(user, q.user, q.ulen, false);
+        const dstr_t *dsecret = kvp->get(kvp, user, q.uhash);
         if(dsecret == UNSURE){
             secret.str = &C_UNSURE;
         }else if(dsecret){
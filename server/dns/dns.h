@@ -11,6 +11,7 @@ size_t respond_name_error(void *arg, const dns_pkt_t, char*, size_t);
 size_t respond_root(void *arg, const dns_pkt_t, char*, size_t);
 size_t respond_user(void *arg, const dns_pkt_t, char*, size_t);
 size_t respond_acme(void *arg, const dns_pkt_t, char*, size_t);
+size_t respond_slip(void *arg, const dns_pkt_t, char*, size_t);
 
 // always sets *respond and *user
 respond_f sort_pkt(const dns_pkt_t pkt, const lstr_t *rname, size_t n);
@@ -19,10 +20,12 @@ respond_f sort_pkt(const dns_pkt_t pkt, const lstr_t *rname, size_t n);
 struct kvp_i;
 typedef struct kvp_i kvp_i;
 struct kvp_i {
-    const dstr_t *(*iget)(kvp_i*, lstr_t iuser);
+    // user is already lowercased, and hash is kvp_hash(user)
+    const dstr_t *(*get)(kvp_i*, const dstr_t user, uint32_t hash);
 };
 
-// returns zero to not respond
+/* returns zero to not respond; slip=true (from the rrl) means only a
+   truncated response is allowed */
 size_t handle_packet(
-    char *qbuf, size_t qlen, kvp_i *kvp, char *rbuf, size_t rcap
+    char *qbuf, size_t qlen, kvp_i *kvp, bool slip, char *rbuf, size_t rcap
 );
@@ -9,6 +9,8 @@
 
 #define MAX_PEERS 8
 #define NMEMBUFS 256
+// how often to persist changed kvpsync state, when --snapshot-dir is given
+#define SNAPSHOT_INTERVAL_MS 30000
 
 // we must have enough membufs for initial resync packets
 #if MAX_PEERS > NMEMBUFS
@@ -53,6 +55,12 @@ typedef struct {
     derr_t close_reason;
     rrl_t rrl;
     xtime_t last_report;
+    // kvpsync snapshots are disabled when snapdir is NULL
+    const char *snapdir;
+    bool resumed[MAX_PEERS];
+    uv_timer_t snap_timer;
+    uv_signal_t sigterm;
+    uv_signal_t sigint;
 } globals_t;
 DEF_CONTAINER_OF(globals_t, iface, kvp_i)
 
@@ -103,6 +111,9 @@ static void dns_close(globals_t *g, derr_t e){
     g->close_reason = e;
     duv_udp_close(&g->dns_udp, noop_close_cb);
     duv_udp_close(&g->sync_udp, noop_close_cb);
+    if(g->snap_timer.data) duv_timer_close(&g->snap_timer, noop_close_cb);
+    if(g->sigterm.data) duv_signal_close(&g->sigterm, noop_close_cb);
+    if(g->sigint.data) duv_signal_close(&g->sigint, noop_close_cb);
 }
 
 static void on_send(uv_udp_send_t *req, int status){
@@ -159,15 +170,17 @@ static derr_t on_recv_dns(
     LOG_DEBUG("-- udp from %x --\n", FNTOP(src));
 
     // check rrl
-    bool ok = rrl_check(&g->rrl, src, g->now);
-    if(!ok){
-        LOG_DEBUG("dropping due to rate limit\n");
+    rrl_e limit = rrl_check(&g->rrl, src, g->now);
+    if(limit != RRL_OK){
+        LOG_DEBUG("%x due to rate limit\n",
+            FS(limit == RRL_SLIP ? "slipping" : "dropping")
+        );
         // INFO-level report every hour
         if(g->now > g->last_report + 60*60*SECOND){
             g->last_report = g->now;
-            LOG_INFO("dropping packets due to rate limit\n");
+            LOG_INFO("limiting packets due to rate limit\n");
         }
-        return e;
+        if(limit == RRL_DROP) return e;
     }
 
     membuf_t *membuf = *membufp;
@@ -176,6 +189,7 @@ static derr_t on_recv_dns(
         membuf->base,
         len,
         &g->iface,
+        limit == RRL_SLIP,
         membuf->resp,
         sizeof(membuf->resp)
     );
@@ -310,17 +324,10 @@ buf_return:
 }
 
 // implements the kvp_i->get
-static const dstr_t *globals_kvp_iget(kvp_i *iface, lstr_t iuser){
+static const dstr_t *globals_kvp_get(
+    kvp_i *iface, const dstr_t user, uint32_t hash
+){
     globals_t *g = CONTAINER_OF(iface, globals_t, iface);
-    /* make a copy of username to get around const requirements, and also to
-       make lower-casing easy */
-    if(iuser.len > 63) LOG_FATAL("username too long");
-    char userbuf[63];
-    memcpy(userbuf, iuser.str, iuser.len);
-
-    dstr_t key;
-    DSTR_WRAP(key, userbuf, iuser.len, false);
-    dstr_lower(&key);
 
     /* If we have multiple kvpsync_recv_t's which are both OK but only one has
        received the challenge, prefer the confident yes to the confident no.
@@ -343,7 +350,9 @@ static const dstr_t *globals_kvp_iget(kvp_i *iface, lstr_t iuser){
     // prefer confident yes to confident no, prefer confident no to unsure
     const dstr_t *ans = UNSURE;
     for(size_t i = 0; i < g->npeers; i++){
-        const dstr_t *dret = kvpsync_recv_get_value(&g->recv[i], g->now, key);
+        const dstr_t *dret = kvpsync_recv_get_value_hashed(
+            &g->recv[i], g->now, user, hash
+        );
         if(dret == UNSURE) continue;
         // confident yes: return immediately
         if(dret) return dret;
@@ -405,6 +414,72 @@ fail:
     return e;
 }
 
+static derr_t snapshot_names(
+    globals_t *g, size_t i, dstr_t *path, dstr_t *peer
+){
+    derr_t e = E_OK;
+    PROP(&e, FMT(path, "%x/kvpsync-%x.snap", FS(g->snapdir), FU(i)) );
+    PROP(&e, FMT(peer, "%x", FNTOPS(&g->peers[i])) );
+    return e;
+}
+
+static derr_t load_snapshots(globals_t *g){
+    derr_t e = E_OK;
+
+    for(size_t i = 0; i < g->npeers; i++){
+        DSTR_VAR(path, 4096);
+        DSTR_VAR(peer, 256);
+        PROP(&e, snapshot_names(g, i, &path, &peer) );
+        PROP(&e,
+            kvpsync_recv_load(&g->recv[i], peer, path.data, &g->resumed[i])
+        );
+        if(g->resumed[i]){
+            LOG_INFO("resumed kvpsync with %x from snapshot\n", FD(peer));
+        }
+    }
+
+    return e;
+}
+
+/* a failed snapshot only costs us a warm restart, so it's not worth crashing
+   over; log it and keep serving */
+static void save_snapshots(globals_t *g, bool clean){
+    for(size_t i = 0; i < g->npeers; i++){
+        if(!clean && !g->recv[i].dirty) continue;
+        derr_t e = E_OK;
+        DSTR_VAR(path, 4096);
+        DSTR_VAR(peer, 256);
+        PROP_GO(&e, snapshot_names(g, i, &path, &peer), fail);
+        PROP_GO(&e,
+            kvpsync_recv_save(&g->recv[i], peer, clean, path.data),
+        fail);
+    fail:
+        if(is_error(e)){
+            LOG_ERROR("failed to save kvpsync snapshot:\n");
+            DUMP(e);
+            DROP_VAR(&e);
+        }
+    }
+}
+
+// a uv_timer_cb
+static void on_snap_timer(uv_timer_t *timer){
+    globals_t *g = timer->data;
+    save_snapshots(g, false);
+    duv_timer_must_start(timer, on_snap_timer, SNAPSHOT_INTERVAL_MS);
+}
+
+// a uv_signal_cb
+static void on_signal(uv_signal_t *signal, int signum){
+    globals_t *g = signal->data;
+    LOG_INFO("caught %x, shutting down\n", FS(strsignal(signum)));
+    if(g->closing) return;
+    /* dns_close() stops all acks, so everything the sender thinks we have is
+       already in our state, and the snapshot may be marked clean */
+    save_snapshots(g, true);
+    dns_close(g, E_OK);
+}
+
 // a uv_timer_cb
 static void send_initial_resyncs(uv_timer_t *timer){
     globals_t *g = timer->data;
@@ -417,6 +492,8 @@ static void send_initial_resyncs(uv_timer_t *timer){
     membuf_t *membuf = NULL;
 
     for(size_t i = 0; i < g->npeers; i++){
+        // peers resumed from a clean snapshot are already in sync
+        if(g->resumed[i]) continue;
         membuf = membufs_pop(&g->membufs);
         if(!membuf) LOG_FATAL("not enough membufs for initial resyncs\n");
 
@@ -457,26 +534,30 @@ static derr_t dns_main(
     int *kvp_fd,
     struct sockaddr_storage *peers,
     size_t npeers,
-    size_t rrl_nbuckets
+    size_t rrl_nbuckets,
+    rrl_cfg_t rrl_cfg,
+    const char *snapdir
 ){
     derr_t e = E_OK;
 
     globals_t g = {
         .iface = {
-            .iget = globals_kvp_iget,
+            .get = globals_kvp_get,
         },
         .peers = peers,
         .npeers = npeers,
         .recving = true,
+        .snapdir = snapdir,
     };
 
     PROP(&e, membufs_init(&g.membufs, NMEMBUFS) );
 
-    PROP_GO(&e, rrl_init(&g.rrl, rrl_nbuckets), cu);
+    PROP_GO(&e, rrl_init(&g.rrl, rrl_nbuckets, rrl_cfg), cu);
 
     for(size_t i = 0; i < npeers; i++){
         PROP_GO(&e, kvpsync_recv_init(&g.recv[i]), cu);
     }
+    if(snapdir) PROP_GO(&e, load_snapshots(&g), cu);
 
     PROP_GO(&e, duv_loop_init(&g.loop), cu);
     g.loop.data = &g;
@@ -505,6 +586,32 @@ static derr_t dns_main(
     }
     PROP_GO(&e, recv_start(&g.dns_udp, allocator, on_recv), fail_loop);
 
+    if(snapdir){
+        // persist snapshots periodically, and cleanly at shutdown
+        duv_timer_must_init(&g.loop, &g.snap_timer);
+        g.snap_timer.data = &g;
+        duv_timer_must_start(
+            &g.snap_timer, on_snap_timer, SNAPSHOT_INTERVAL_MS
+        );
+        uv_signal_t *sigs[] = { &g.sigterm, &g.sigint };
+        int signums[] = { SIGTERM, SIGINT };
+        for(size_t i = 0; i < 2; i++){
+            int ret = uv_signal_init(&g.loop, sigs[i]);
+            if(ret < 0){
+                ORIG_GO(&e,
+                    uv_err_type(ret), "uv_signal_init: %x", fail_loop, FUV(ret)
+                );
+            }
+            sigs[i]->data = &g;
+            ret = uv_signal_start(sigs[i], on_signal, signums[i]);
+            if(ret < 0){
+                ORIG_GO(&e,
+                    uv_err_type(ret), "uv_signal_start: %x", fail_loop, FUV(ret)
+                );
+            }
+        }
+    }
+
     (void)tcp_fd;
 
 fail_loop:
@@ -524,6 +631,9 @@ fail_loop:
         // erroring execution path
         if(g.dns_udp.data) duv_udp_close(&g.dns_udp, noop_close_cb);
         if(g.sync_udp.data) duv_udp_close(&g.sync_udp, noop_close_cb);
+        if(g.snap_timer.data) duv_timer_close(&g.snap_timer, noop_close_cb);
+        if(g.sigterm.data) duv_signal_close(&g.sigterm, noop_close_cb);
+        if(g.sigint.data) duv_signal_close(&g.sigint, noop_close_cb);
         DROP_CMD( runloop(&g.loop) );
     }
 
@@ -537,7 +647,7 @@ cu:
     return e;
 }
 
-#ifndef BUILD_TEST
+#if !defined(BUILD_TEST) && !defined(BUILD_BENCH)
 
 static void print_help(FILE *f){
     fprintf(f,
@@ -552,9 +662,25 @@ static void print_help(FILE *f){
         "                be provided multiple times.  Must be provided at\n"
         "                least once.\n"
         "--rrl NBUCKETS  Configure the number of rrl buckets.  Should\n"
-        "                probably be prime.  Default is 249999991 (about\n"
+        "                probably be prime.  Default is 62499971 (about\n"
         "                250MB).\n"
+        "--rrl-rate N    Responses per second allowed for each client\n"
+        "                prefix.  Default is 20.\n"
+        "--rrl-burst N   Responses allowed in a burst for each client\n"
+        "                prefix, at most 4095.  Default is 40.\n"
+        "--rrl-slip N    Send a truncated response instead of dropping\n"
+        "                every Nth limited response, at most 15.  Zero\n"
+        "                disables slip.  Default is 2.\n"
+        "--rrl-v4 BITS   IPv4 prefix length for grouping clients.\n"
+        "                Default is 24.\n"
+        "--rrl-v6 BITS   IPv6 prefix length for grouping clients.\n"
+        "                Default is 56.\n"
         "--dns SPEC      Configure how dns is served.  Defaults to :53.\n"
+        "--snapshot-dir DIR\n"
+        "                Periodically save kvpsync state in DIR, and\n"
+        "                reload it at startup, so a restarted server can\n"
+        "                answer immediately.  A clean shutdown (SIGTERM)\n"
+        "                lets the next startup skip the full resync.\n"
         "\n"
         "Each address SPEC is of the form [HOST][:PORT].\n"
         "\n"
@@ -667,14 +793,26 @@ int main(int argc, char **argv){
     opt_spec_t o_sync = {'\0', "sync", true};
     opt_spec_t o_peer = {'\0', "peer", true, on_peer, &peers};
     opt_spec_t o_rrl  = {'\0', "rrl", true};
+    opt_spec_t o_rate = {'\0', "rrl-rate", true};
+    opt_spec_t o_brst = {'\0', "rrl-burst", true};
+    opt_spec_t o_slip = {'\0', "rrl-slip", true};
+    opt_spec_t o_rv4  = {'\0', "rrl-v4", true};
+    opt_spec_t o_rv6  = {'\0', "rrl-v6", true};
     opt_spec_t o_dns  = {'\0', "dns", true};
+    opt_spec_t o_snap = {'\0', "snapshot-dir", true};
     opt_spec_t o_dbg  = {'d', "debug", false};
 
     opt_spec_t* spec[] = {
         &o_sync,
         &o_peer,
         &o_rrl,
+        &o_rate,
+        &o_brst,
+        &o_slip,
+        &o_rv4,
+        &o_rv6,
         &o_dns,
+        &o_snap,
         &o_dbg,
     };
     size_t speclen = sizeof(spec) / sizeof(*spec);
@@ -730,8 +868,25 @@ int main(int argc, char **argv){
     if(o_rrl.found){
         PROP_GO(&e, dstr_tosize(&o_rrl.val, &nbuckets, 10), fail);
     }else{
-        // default to a prime near 250MB
-        nbuckets = 249999991;
+        // default to a prime near 250MB of 4-byte buckets
+        nbuckets = 62499971;
+    }
+
+    rrl_cfg_t rrl_cfg = RRL_CFG_DEFAULT;
+    if(o_rate.found){
+        PROP_GO(&e, dstr_tou(&o_rate.val, &rrl_cfg.rate, 10), fail);
+    }
+    if(o_brst.found){
+        PROP_GO(&e, dstr_tou(&o_brst.val, &rrl_cfg.burst, 10), fail);
+    }
+    if(o_slip.found){
+        PROP_GO(&e, dstr_tou(&o_slip.val, &rrl_cfg.slip, 10), fail);
+    }
+    if(o_rv4.found){
+        PROP_GO(&e, dstr_tou(&o_rv4.val, &rrl_cfg.v4_prefix, 10), fail);
+    }
+    if(o_rv6.found){
+        PROP_GO(&e, dstr_tou(&o_rv6.val, &rrl_cfg.v6_prefix, 10), fail);
     }
 
     // In linux, the default is that binding to "::" receieves ipv6 and ipv4.
@@ -754,7 +909,9 @@ int main(int argc, char **argv){
             &kvp_fd,
             peers.data,
             peers.len,
-            nbuckets
+            nbuckets,
+            rrl_cfg,
+            o_snap.found ? o_snap.val.data : NULL
         ),
     fail);
 
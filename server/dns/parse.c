@@ -333,6 +333,43 @@ size_t labels_read_reverse(
     return total;
 }
 
+void qname_read(qname_t *q, const char *ptr, size_t start){
+    *q = (qname_t){0};
+
+    // rings of the most recent labels; the username is 4th-to-last
+    lstr_t ring[QNAME_RLABELS];
+    char lower[4][63];
+    uint32_t hash[4];
+
+    labels_t it;
+    size_t n = 0;
+    lstr_t *l = labels_iter(&it, ptr, start);
+    for(; l; n++, l = labels_next(&it)){
+        ring[n % QNAME_RLABELS] = *l;
+        char *buf = lower[n % 4];
+        uint32_t h = KVP_HASH_INIT;
+        for(size_t i = 0; i < l->len; i++){
+            char c = l->str[i];
+            if(c >= 'A' && c <= 'Z') c = (char)(c + ('a' - 'A'));
+            buf[i] = c;
+            h = kvp_hash_step(h, c);
+        }
+        hash[n % 4] = h;
+    }
+
+    q->n = n;
+    size_t keep = MIN(n, QNAME_RLABELS);
+    for(size_t i = 0; i < keep; i++){
+        q->rname[i] = ring[(n - 1 - i) % QNAME_RLABELS];
+    }
+    if(n > 3){
+        size_t u = (n - 4) % 4;
+        q->ulen = q->rname[3].len;
+        q->uhash = hash[u];
+        memcpy(q->user, lower[u], q->ulen);
+    }
+}
+
 static size_t parse_qstn(
     dns_qstn_t *qstn,
     uint16_t qdcount,
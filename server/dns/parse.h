@@ -142,6 +142,27 @@ size_t labels_read_reverse(
     const char *ptr, size_t start, lstr_t *lstrs, size_t cap
 );
 
+/* save one label more than we'll ever read, so that sort_pkt can be aware
+   of junk queries which are only junk because of the extra labels */
+#define QNAME_RLABELS 6
+
+/* qname_read does everything handle_packet needs from the question name in a
+   single pass: it keeps the final QNAME_RLABELS labels in reverse order (like
+   labels_read_reverse) and also lowercases and kvp_hash()es the label which
+   would be the username (rname[3]), so the kvpsync lookup needs no copies */
+typedef struct {
+    lstr_t rname[QNAME_RLABELS];
+    // total number of labels, which may exceed QNAME_RLABELS
+    size_t n;
+    // rname[3], lowercased; only valid when n > 3
+    char user[63];
+    size_t ulen;
+    uint32_t uhash;
+} qname_t;
+
+// name must already be validated by parse_name
+void qname_read(qname_t *q, const char *ptr, size_t start);
+
 typedef struct {
     const char *ptr;
     size_t nameoff;
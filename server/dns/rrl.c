@@ -3,17 +3,47 @@
 #include <stdlib.h>
 #include <string.h>
 
-derr_t rrl_init(rrl_t *rrl, size_t nbuckets){
+derr_t rrl_init(rrl_t *rrl, size_t nbuckets, rrl_cfg_t cfg){
     derr_t e = E_OK;
 
-    *rrl = (rrl_t){
-        .buckets = malloc(nbuckets),
-        .nbuckets = nbuckets,
+    if(cfg.rate == 0){
+        ORIG(&e, E_PARAM, "rrl rate must be nonzero");
+    }
+    if(cfg.burst > RRL_MAX_BURST){
+        ORIG(&e, E_PARAM, "rrl burst must not exceed %x", FU(RRL_MAX_BURST));
+    }
+    if(cfg.slip > RRL_MAX_SLIP){
+        ORIG(&e, E_PARAM, "rrl slip must not exceed %x", FU(RRL_MAX_SLIP));
+    }
+    if(cfg.v4_prefix > 32){
+        ORIG(&e, E_PARAM, "rrl ipv4 prefix must not exceed 32");
+    }
+    if(cfg.v6_prefix > 128){
+        ORIG(&e, E_PARAM, "rrl ipv6 prefix must not exceed 128");
+    }
+
+    *rrl = (rrl_t){ .nbuckets = nbuckets, .cfg = cfg };
+
+    // pick a random siphash key
+    uint64_t keys[2];
+    dstr_t d = {
+        .data = (char*)keys,
+        .len = 0,
+        .size = sizeof(keys),
+        .fixed_size = true,
     };
+    PROP(&e, urandom_bytes(&d, d.size) );
+    rrl->k0 = keys[0];
+    rrl->k1 = keys[1];
+
+    if(!nbuckets) return e;
+
+    // zeroized buckets are full buckets
+    rrl->buckets = calloc(nbuckets, sizeof(*rrl->buckets));
     if(!rrl->buckets){
+        *rrl = (rrl_t){0};
         ORIG(&e, E_NOMEM, "nomem");
     }
-    memset(rrl->buckets, 0, nbuckets);
 
     return e;
 }
@@ -23,59 +53,131 @@ void rrl_free(rrl_t *rrl){
     *rrl = (rrl_t){0};
 }
 
-// copied from hashmap.c, which has a proper attribution
-// TODO: investigate other public domain hashing functions:
-// (public domain) http://burtleburtle.net/bob/hash/doobs.html
-// (LGPL) http://www.azillionmonkeys.com/qed/hash.html
-static uint32_t hash_uint(uint32_t ukey){
-    /* Robert Jenkins' 32 bit Mix Function */
-    ukey += (ukey << 12);
-    ukey ^= (ukey >> 22);
-    ukey += (ukey << 4);
-    ukey ^= (ukey >> 9);
-    ukey += (ukey << 10);
-    ukey ^= (ukey >> 2);
-    ukey += (ukey << 7);
-    ukey ^= (ukey >> 12);
-
-    /* Knuth's Multiplicative Method */
-    ukey = (uint32_t)(((ukey >> 3) * 2654435761) & 0xFFFFFFFF);
-
-    return ukey;
+// SipHash-2-4, specialized to a message of exactly three 64-bit words
+// (public domain reference: https://github.com/veorq/SipHash)
+#define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+#define SIPROUND \
+    do { \
+        v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0; v0 = ROTL(v0, 32); \
+        v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2; \
+        v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0; \
+        v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2; v2 = ROTL(v2, 32); \
+    } while(0)
+
+static uint64_t siphash3(
+    uint64_t k0, uint64_t k1, uint64_t m0, uint64_t m1, uint64_t m2
+){
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+    uint64_t m[4] = { m0, m1, m2, (uint64_t)24 << 56 };
+    for(size_t i = 0; i < 4; i++){
+        v3 ^= m[i];
+        SIPROUND;
+        SIPROUND;
+        v0 ^= m[i];
+    }
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
 }
 
-static uint32_t hash_addr(const struct sockaddr *sa){
+#undef SIPROUND
+#undef ROTL
+
+// the top nbits bits of a 64-bit word, with nbits clamped to [0, 64]
+static uint64_t mask64(unsigned int nbits){
+    if(nbits == 0) return 0;
+    if(nbits >= 64) return UINT64_MAX;
+    return UINT64_MAX << (64 - nbits);
+}
+
+static uint64_t be64(const uint8_t *u){
+    uint64_t out = 0;
+    for(size_t i = 0; i < 8; i++){
+        out = (out << 8) | u[i];
+    }
+    return out;
+}
+
+// hash the client's prefix, not its whole address
+static uint64_t hash_addr(const rrl_t *rrl, const struct sockaddr *sa){
     int family = sa->sa_family;
     if(family == AF_INET){
         const struct sockaddr_in *sin = (const struct sockaddr_in*)sa;
-        return hash_uint(sin->sin_addr.s_addr);
+        const uint8_t *u = (const uint8_t*)&sin->sin_addr.s_addr;
+        uint64_t addr = (uint64_t)u[0] << 56
+                      | (uint64_t)u[1] << 48
+                      | (uint64_t)u[2] << 40
+                      | (uint64_t)u[3] << 32;
+        addr &= mask64(rrl->cfg.v4_prefix);
+        return siphash3(rrl->k0, rrl->k1, AF_INET, addr, 0);
     }else if(family == AF_INET6){
         const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6*)sa;
-        uint32_t *keys = (uint32_t*)&sin6->sin6_addr.s6_addr;
-        return hash_uint(keys[0]) ^ hash_uint(keys[1]);
+        const uint8_t *u = sin6->sin6_addr.s6_addr;
+        unsigned int nbits = rrl->cfg.v6_prefix;
+        uint64_t hi = be64(u) & mask64(nbits);
+        uint64_t lo = be64(u + 8) & mask64(nbits > 64 ? nbits - 64 : 0);
+        return siphash3(rrl->k0, rrl->k1, AF_INET6, hi, lo);
     }
     LOG_FATAL("hash_addr with invalid address family %x\n", FI(family));
     return 0;
 }
 
-// returns true if this recipient is under the limit
-bool rrl_check(rrl_t *rrl, const struct sockaddr *sa, xtime_t now){
-    if(!rrl->nbuckets) return true;
-    size_t hash = hash_addr(sa) % rrl->nbuckets;
-    uint8_t window = (now / SECOND) & 0x1f;
-    uint8_t bucket = rrl->buckets[hash];
-    uint8_t stamp = (bucket >> 3) & 0x1f;
-    if(stamp != window){
-        // reset bucket
-        rrl->buckets[hash] = (window << 3);
-        return true;
-    }
-    uint8_t count = bucket & 0x7;
-    if(count == 7){
-        // limit reached
-        return false;
-    }
-    // increase count
-    rrl->buckets[hash] = (window << 3) | (count + 1);
-    return true;
+#define STAMP(b) ((uint32_t)(b) >> 16)
+#define USED(b) (((uint32_t)(b) >> 4) & RRL_MAX_BURST)
+#define NSLIP(b) ((uint32_t)(b) & RRL_MAX_SLIP)
+#define BUCKET(stamp, used, nslip) \
+    (((uint32_t)(stamp) & 0xffff) << 16 | (uint32_t)(used) << 4 | (nslip))
+
+rrl_e rrl_check(rrl_t *rrl, const struct sockaddr *sa, xtime_t now){
+    if(!rrl->nbuckets) return RRL_OK;
+    const rrl_cfg_t cfg = rrl->cfg;
+    size_t idx = (size_t)(hash_addr(rrl, sa) % rrl->nbuckets);
+    _Atomic uint32_t *bucket = &rrl->buckets[idx];
+    uint32_t window = (uint32_t)(now / SECOND) & 0xffff;
+
+    uint32_t old = atomic_load_explicit(bucket, memory_order_relaxed);
+    uint32_t new;
+    rrl_e out;
+    do {
+        // refill the bucket for however many seconds have passed
+        uint32_t elapsed = (window - STAMP(old)) & 0xffff;
+        // saturate, since a long pause at a high rate overflows 32 bits
+        uint64_t refill64 = (uint64_t)elapsed * cfg.rate;
+        uint32_t refill = (uint32_t)MIN(refill64, RRL_MAX_BURST);
+        uint32_t used = USED(old);
+        uint32_t nslip = NSLIP(old);
+        used = refill >= used ? 0 : used - refill;
+        if(used < cfg.burst){
+            // take a token
+            used++;
+            nslip = 0;
+            out = RRL_OK;
+        }else if(cfg.slip){
+            // over the limit, but every slip'th response gets through
+            nslip = (nslip + 1) % cfg.slip;
+            out = nslip ? RRL_DROP : RRL_SLIP;
+        }else{
+            out = RRL_DROP;
+        }
+        new = BUCKET(window, used, nslip);
+        // don't bother writing back an unchanged bucket
+        if(new == old) break;
+    } while(
+        !atomic_compare_exchange_weak_explicit(
+            bucket, &old, new, memory_order_relaxed, memory_order_relaxed
+        )
+    );
+
+    return out;
 }
+
+#undef BUCKET
+#undef NSLIP
+#undef USED
+#undef STAMP
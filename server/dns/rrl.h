@@ -1,3 +1,5 @@
+#include <stdatomic.h>
+
 /* Other dns servers implement rrl based on who is asking and what is being
    asked, but we base our rrl only on who is asking, because there's really
    nothing interesting to ask very many times.
@@ -7,22 +9,74 @@
    splintermail users are using one resolver) but of course the available
    uniqueness is infinite, so distinguishing those would break the rrl.
 
-   Each bucket is addressed as a direct hash of the recipient address.  Hash
-   collisions are unfortunate but we will assume they are rare enough to
-   ignore.
+   "Who is asking" is a network prefix, not an address: an IPv6 attacker
+   typically controls at least a /64 and often a /56, and rotating addresses
+   within that prefix must not buy them fresh buckets.  By default IPv4
+   clients are grouped by /24 and IPv6 clients by /56, like BIND does.
+
+   Each bucket is addressed by a keyed hash (siphash) of the client prefix.
+   The key is chosen randomly at boot so an attacker cannot precompute a set
+   of prefixes which collide with a victim's bucket.  Collisions can still
+   happen by chance, but we will assume they are rare enough to ignore.
+
+   Each bucket is a token bucket packed into one 32-bit atomic word:
+
+       31..16: timestamp, in seconds, of the last check
+       15..4:  tokens used (the bucket is full when zero)
+        3..0:  slip counter
+
+   Tokens refill at cfg.rate per second up to cfg.burst.  Once a bucket is
+   empty, responses are dropped, except that every cfg.slip'th limited
+   response "slips" through as a truncated response instead, so that a
+   legitimate resolver sharing a prefix with an attacker can still retry over
+   tcp, while the attacker gains no amplification.
+
+   Every update is a single compare-and-swap, so one rrl_t may be shared by
+   many threads without any locks.  Since the timestamp is only 16 bits, a
+   bucket untouched for exactly a multiple of ~18 hours may see its stale
+   token count; that is harmless. */
+
+#define RRL_MAX_BURST 0xfff
+#define RRL_MAX_SLIP 0xf
 
-   Each bucket is 5 bits of timestamp and 3 bits of counter.  The counter is
-   invalid when the timestamp does not match the current time and is zeroized
-   when checked again.  Theoretically a client could query ping exactly every
-   32 seconds and never reset their timer. */
 typedef struct {
-    // each bucket is 5 bits of timestamp and 3 bits of counter.
-    uint8_t *buckets;
+    // tokens added to each bucket per second, must be nonzero
+    uint32_t rate;
+    // maximum tokens in each bucket, at most RRL_MAX_BURST
+    uint32_t burst;
+    // every slip'th limited response is truncated instead of dropped
+    // (zero means always drop, one means always truncate)
+    uint32_t slip;
+    // prefix lengths used to aggregate clients
+    unsigned int v4_prefix;  // at most 32
+    unsigned int v6_prefix;  // at most 128
+} rrl_cfg_t;
+
+#define RRL_CFG_DEFAULT ((rrl_cfg_t){ \
+    .rate = 20, \
+    .burst = 40, \
+    .slip = 2, \
+    .v4_prefix = 24, \
+    .v6_prefix = 56, \
+})
+
+typedef struct {
+    _Atomic uint32_t *buckets;
     size_t nbuckets;
+    rrl_cfg_t cfg;
+    // siphash key
+    uint64_t k0;
+    uint64_t k1;
 } rrl_t;
 
-derr_t rrl_init(rrl_t *rrl, size_t nbuckets);
+typedef enum {
+    RRL_OK = 0,  // under the limit, respond normally
+    RRL_SLIP,    // over the limit, respond with a truncated response
+    RRL_DROP,    // over the limit, do not respond
+} rrl_e;
+
+derr_t rrl_init(rrl_t *rrl, size_t nbuckets, rrl_cfg_t cfg);
 void rrl_free(rrl_t *rrl);
 
-// returns true if this address is under the limit
-bool rrl_check(rrl_t *rrl, const struct sockaddr *sa, xtime_t now);
+// thread-safe
+rrl_e rrl_check(rrl_t *rrl, const struct sockaddr *sa, xtime_t now);
@@ -493,7 +493,18 @@ static derr_t test_main(void){
     }
 
     int fd = -1;
-    PROP(&e, dns_main(dnsspec, &fd, &fd, syncspec, &fd, peers, NPEERS, 997) );
+    PROP(&e, dns_main(
+        dnsspec,
+        &fd,
+        &fd,
+        syncspec,
+        &fd,
+        peers,
+        NPEERS,
+        997,
+        RRL_CFG_DEFAULT,
+        NULL
+    ) );
 
     return e;
 }
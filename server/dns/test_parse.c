@@ -157,6 +157,65 @@ cu:
     return e;
 }
 
+static derr_t test_qname_read(void){
+    derr_t e = E_OK;
+
+    #define ASSERT(code) \
+        if(!(code)) ORIG_GO(&e, E_VALUE, "assertion failed: " #code, cu)
+
+    char buf[] =
+        "\x0c" "splintermail" "\x03" "com" "\x00" // splintermail.com
+        "\x04" "user" "\x0c" "spLINTERmail" "\xC0\x0d" // user.spl...com
+        "\x05" "ABCDE" "\x04" "User" "\xC0\x17" // abcde.user.spl...com
+        "\x0f" "_acme-challenge" "\xC0\x26" // _acme-challenge.abcde...
+        "\x01" "x" "\x01" "y" "\x01" "z" "\xC0\x33" // x.y.z._acme-...
+    ;
+    size_t len = sizeof(buf)-1;
+
+    // validate with parse_name
+    size_t offs[] = {0, 18, 38, 51, 69};
+    size_t used = 0;
+    for(size_t i = 0; i < sizeof(offs)/sizeof(*offs); i++){
+        ASSERT(used == offs[i]);
+        used = parse_name(buf, len, used);
+        ASSERT(!is_bad_parse(used));
+    }
+
+    qname_t q;
+
+    qname_read(&q, buf, 0);
+    ASSERT(q.n == 2);
+    ASSERT(lstr_ieq(q.rname[0], LSTR("com")));
+    ASSERT(lstr_ieq(q.rname[1], LSTR("splintermail")));
+    ASSERT(q.ulen == 0);
+
+    qname_read(&q, buf, 38);
+    ASSERT(q.n == 4);
+    ASSERT(lstr_ieq(q.rname[2], LSTR("user")));
+    ASSERT(lstr_ieq(q.rname[3], LSTR("abcde")));
+    ASSERT(dstr_eq(dstr_from_cstrn(q.user, q.ulen, false), DSTR_LIT("abcde")));
+    ASSERT(q.uhash == kvp_hash(DSTR_LIT("abcde")));
+
+    qname_read(&q, buf, 51);
+    ASSERT(q.n == 5);
+    ASSERT(lstr_ieq(q.rname[4], LSTR("_acme-challenge")));
+    ASSERT(dstr_eq(dstr_from_cstrn(q.user, q.ulen, false), DSTR_LIT("abcde")));
+    ASSERT(q.uhash == kvp_hash(DSTR_LIT("abcde")));
+
+    // over capacity: keep the final labels, and still find the username
+    qname_read(&q, buf, 69);
+    ASSERT(q.n == 8);
+    ASSERT(lstr_ieq(q.rname[0], LSTR("com")));
+    ASSERT(lstr_ieq(q.rname[3], LSTR("abcde")));
+    ASSERT(lstr_ieq(q.rname[4], LSTR("_acme-challenge")));
+    ASSERT(lstr_ieq(q.rname[5], LSTR("z")));
+    ASSERT(dstr_eq(dstr_from_cstrn(q.user, q.ulen, false), DSTR_LIT("abcde")));
+
+    #undef ASSERT
+
+cu:
+    return e;
+}
 
 int main(void){
     int retval = 0;
@@ -174,6 +233,7 @@ int main(void){
 
     RUN(test_labels_iter());
     RUN(test_labels_read());
+    RUN(test_qname_read());
 
     printf("%s\n", retval ? "FAIL" : "PASS");
 
@@ -2,50 +2,74 @@
 
 #include "test/test_utils.h"
 
-static derr_t do_test(rrl_t *rrl){
+#define EXPECT_RRL(e, sa, now, exp) do { \
+    rrl_e _got = rrl_check(rrl, (sa), (now)); \
+    rrl_e _exp = (exp); \
+    if(_got != _exp){ \
+        ORIG((e), \
+            E_VALUE, \
+            "rrl_check at line %x: expected %x but got %x", \
+            FI(__LINE__), FI(_exp), FI(_got) \
+        ); \
+    } \
+} while(0)
+
+// use a fixed siphash key so collisions in the test are deterministic
+static derr_t init(rrl_t *rrl, rrl_cfg_t cfg){
+    derr_t e = E_OK;
+    PROP(&e, rrl_init(rrl, 65521, cfg) );
+    rrl->k0 = 0x0706050403020100ULL;
+    rrl->k1 = 0x0f0e0d0c0b0a0908ULL;
+    return e;
+}
+
+static derr_t do_test_bucket(rrl_t *rrl){
     derr_t e = E_OK;
 
     struct sockaddr_storage a[3];
     size_t naddrs = sizeof(a)/sizeof(*a);
     PROP(&e, read_addr(&a[0], "1.2.3.4", 1) );
-    PROP(&e, read_addr(&a[1], "1.2.3.5", 1) );
+    PROP(&e, read_addr(&a[1], "1.2.4.4", 1) );
     PROP(&e, read_addr(&a[2], "1111:2222:3333:4444::", 1) );
 
-    // block window is 1 second long, resets after 32 seconds
-    xtime_t end;
-    for(xtime_t now = 1*SECOND; now < 34*SECOND; now += 1*SECOND){
-        // every gets 8 responses for free
-        for(size_t i = 0; i < naddrs; i++){
-            const struct sockaddr *sa = ss2sa(&a[i]);
-            for(size_t j = 0; j < 8; j++){
-                EXPECT_B(&e, "rrl_check", rrl_check(rrl, sa, now), true);
-            }
-            // after that you are blocked
-            EXPECT_B(&e, "rrl_check", rrl_check(rrl, sa, now), false);
-            EXPECT_B(&e, "rrl_check", rrl_check(rrl, sa, now), false);
-            end = now;
+    for(size_t i = 0; i < naddrs; i++){
+        const struct sockaddr *sa = ss2sa(&a[i]);
+        // everybody gets a full burst for free
+        for(size_t j = 0; j < 8; j++){
+            EXPECT_RRL(&e, sa, 1*SECOND, RRL_OK);
+        }
+        // after that you are blocked
+        EXPECT_RRL(&e, sa, 1*SECOND, RRL_DROP);
+        EXPECT_RRL(&e, sa, 1*SECOND + 999*MILLISECOND, RRL_DROP);
+        // one second refills at the configured rate
+        for(size_t j = 0; j < 4; j++){
+            EXPECT_RRL(&e, sa, 2*SECOND, RRL_OK);
         }
+        EXPECT_RRL(&e, sa, 2*SECOND, RRL_DROP);
+        // a long pause refills the whole bucket, but not more
+        for(size_t j = 0; j < 8; j++){
+            EXPECT_RRL(&e, sa, 100*SECOND, RRL_OK);
+        }
+        EXPECT_RRL(&e, sa, 100*SECOND, RRL_DROP);
     }
 
-    // only the first 64 bits of ipv6 addrs are considered
-    struct sockaddr_storage a2;
-    PROP(&e, read_addr(&a2, "1111:2222:3333:4444:abcd:efab:cdef:abcd", 1) );
-    const struct sockaddr *sa = ss2sa(&a2);
-    EXPECT_B(&e, "rrl_check", rrl_check(rrl, sa, end), false);
-
-
     return e;
 }
 
-static derr_t test_rrl(void){
+static derr_t test_bucket(void){
     derr_t e = E_OK;
 
+    rrl_cfg_t cfg = RRL_CFG_DEFAULT;
+    cfg.rate = 4;
+    cfg.burst = 8;
+    cfg.slip = 0;
+
     rrl_t rrl = {0};
     // safe to free zeroized
     rrl_free(&rrl);
-    PROP(&e, rrl_init(&rrl, 997) );
+    PROP(&e, init(&rrl, cfg) );
 
-    PROP_GO(&e, do_test(&rrl), cu);
+    PROP_GO(&e, do_test_bucket(&rrl), cu);
 
 cu:
     rrl_free(&rrl);
@@ -55,12 +79,162 @@ cu:
     return e;
 }
 
+static derr_t do_test_prefix(rrl_t *rrl){
+    derr_t e = E_OK;
+
+    // each group shares a bucket
+    const char *groups[][3] = {
+        {"1.2.3.4", "1.2.3.5", "1.2.3.255"},
+        {"1.2.4.4", "1.2.4.5", "1.2.4.0"},
+        {
+            "1111:2222:3333:4400::",
+            "1111:2222:3333:4444:abcd:efab:cdef:abcd",
+            "1111:2222:3333:44ff:ffff:ffff:ffff:ffff",
+        },
+        {
+            "1111:2222:3333:4500::",
+            "1111:2222:3333:4501::1",
+            "1111:2222:3333:45ab::2",
+        },
+    };
+    size_t ngroups = sizeof(groups)/sizeof(*groups);
+
+    for(size_t i = 0; i < ngroups; i++){
+        struct sockaddr_storage ss[3];
+        for(size_t j = 0; j < 3; j++){
+            PROP(&e, read_addr(&ss[j], groups[i][j], 1) );
+        }
+        // each member of the group pulls from the same bucket
+        EXPECT_RRL(&e, ss2sa(&ss[0]), 1*SECOND, RRL_OK);
+        EXPECT_RRL(&e, ss2sa(&ss[1]), 1*SECOND, RRL_OK);
+        EXPECT_RRL(&e, ss2sa(&ss[2]), 1*SECOND, RRL_DROP);
+        EXPECT_RRL(&e, ss2sa(&ss[0]), 1*SECOND, RRL_DROP);
+    }
+
+    return e;
+}
+
+static derr_t test_prefix(void){
+    derr_t e = E_OK;
+
+    rrl_cfg_t cfg = RRL_CFG_DEFAULT;
+    cfg.rate = 1;
+    cfg.burst = 2;
+    cfg.slip = 0;
+
+    rrl_t rrl = {0};
+    PROP(&e, init(&rrl, cfg) );
+
+    PROP_GO(&e, do_test_prefix(&rrl), cu);
+
+cu:
+    rrl_free(&rrl);
+
+    return e;
+}
+
+static derr_t do_test_slip(rrl_t *rrl, uint32_t slip){
+    derr_t e = E_OK;
+
+    struct sockaddr_storage ss;
+    PROP(&e, read_addr(&ss, "5.6.7.8", 1) );
+    const struct sockaddr *sa = ss2sa(&ss);
+
+    EXPECT_RRL(&e, sa, 1*SECOND, RRL_OK);
+    for(uint32_t i = 1; i < 3 * slip + 3; i++){
+        rrl_e exp = RRL_DROP;
+        if(slip && i % slip == 0) exp = RRL_SLIP;
+        EXPECT_RRL(&e, sa, 1*SECOND, exp);
+    }
+
+    return e;
+}
+
+static derr_t test_slip(void){
+    derr_t e = E_OK;
+
+    rrl_t rrl = {0};
+
+    for(uint32_t slip = 0; slip < 4; slip++){
+        rrl_cfg_t cfg = RRL_CFG_DEFAULT;
+        cfg.rate = 1;
+        cfg.burst = 1;
+        cfg.slip = slip;
+        PROP_GO(&e, init(&rrl, cfg), cu);
+        PROP_GO(&e, do_test_slip(&rrl, slip), cu);
+        rrl_free(&rrl);
+    }
+
+cu:
+    rrl_free(&rrl);
+
+    return e;
+}
+
+static derr_t do_test_high_rate(rrl_t *rrl){
+    derr_t e = E_OK;
+
+    struct sockaddr_storage ss;
+    PROP(&e, read_addr(&ss, "9.8.7.6", 1) );
+    const struct sockaddr *sa = ss2sa(&ss);
+
+    EXPECT_RRL(&e, sa, 1*SECOND, RRL_OK);
+    EXPECT_RRL(&e, sa, 1*SECOND, RRL_DROP);
+    // two seconds of refill must saturate, not wrap around to zero
+    EXPECT_RRL(&e, sa, 3*SECOND, RRL_OK);
+
+    return e;
+}
+
+static derr_t test_high_rate(void){
+    derr_t e = E_OK;
+
+    rrl_cfg_t cfg = RRL_CFG_DEFAULT;
+    cfg.rate = 0x80000000;
+    cfg.burst = 1;
+    cfg.slip = 0;
+
+    rrl_t rrl = {0};
+    PROP(&e, init(&rrl, cfg) );
+
+    PROP_GO(&e, do_test_high_rate(&rrl), cu);
+
+cu:
+    rrl_free(&rrl);
+
+    return e;
+}
+
+static derr_t test_bad_cfg(void){
+    derr_t e = E_OK;
+
+    rrl_cfg_t cfgs[5];
+    for(size_t i = 0; i < 5; i++) cfgs[i] = RRL_CFG_DEFAULT;
+    cfgs[0].burst = RRL_MAX_BURST + 1;
+    cfgs[1].slip = RRL_MAX_SLIP + 1;
+    cfgs[2].v4_prefix = 33;
+    cfgs[3].v6_prefix = 129;
+    cfgs[4].rate = 0;
+
+    for(size_t i = 0; i < 5; i++){
+        rrl_t rrl;
+        derr_t e2 = rrl_init(&rrl, 997, cfgs[i]);
+        EXPECT_E_VAR(&e, "rrl_init", &e2, E_PARAM);
+    }
+
+    return e;
+}
+
 int main(int argc, char **argv){
     derr_t e = E_OK;
     // parse options and set default log level
     PARSE_TEST_OPTIONS(argc, argv, NULL, LOG_LVL_INFO);
 
-    PROP_GO(&e, test_rrl(), test_fail);
+    PROP_GO(&e, test_bucket(), test_fail);
+    PROP_GO(&e, test_prefix(), test_fail);
+    PROP_GO(&e, test_slip(), test_fail);
+    PROP_GO(&e, test_high_rate(), test_fail);
+    PROP_GO(&e, test_bad_cfg(), test_fail);
 
     LOG_ERROR("PASS\n");
     return 0;
@@ -15,15 +15,17 @@ static derr_t _gc_sessions(int server_id, const dstr_t *sock){
     // get sql server ready
     PROP(&e, dmysql_library_init() );
 
-    MYSQL sql;
+    sql_t sql;
     PROP_GO(&e, dmysql_init(&sql), cu_sql_lib);
 
     PROP_GO(&e, sql_connect_unix(&sql, NULL, NULL, sock), cu_sql);
 
     PROP_GO(&e, gc_sessions_and_csrf(&sql, server_id, now), cu_sql);
 
+    PROP_GO(&e, gc_device_changes(&sql, now), cu_sql);
+
 cu_sql:
-    mysql_close(&sql);
+    sql_close(&sql);
 
 cu_sql_lib:
     mysql_library_end();
@@ -39,7 +41,7 @@ static dstr_t get_arg(char **argv, size_t idx){
 
 static void print_help(FILE *f){
     fprintf(f,
-        "gc_sessions: delete sessions older than a certain age\n"
+        "gc_sessions: delete expired sessions and device changes\n"
         "\n"
         "usage: gc_sessions SERVER_ID [OPTIONS]\n"
         "\n"
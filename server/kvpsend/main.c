@@ -20,7 +20,7 @@ typedef struct {
     char recvbuf[2048];
     derr_t close_reason;
     bool closing;
-    MYSQL *sql;
+    sql_t *sql;
     // remember the time we set in the loop
     xtime_t now;
 } uv_kvpsend_t;
@@ -714,7 +714,7 @@ fail:
 
 static derr_t uv_kvpsend_init(
     uv_kvpsend_t *uv_k,
-    MYSQL *sql,
+    sql_t *sql,
     struct sockaddr_storage *peers,
     size_t npeers
 ){
@@ -822,7 +822,7 @@ int main(int argc, char **argv){
 
     int retval = 0;
     bool mysql_lib_ready = false;
-    MYSQL sql = {0};
+    sql_t sql = {0};
     bool mysql_ready = false;
     uv_kvpsend_t uv_k = {0};
 
@@ -939,7 +939,7 @@ fail:
     }
 
     uv_kvpsend_free(&uv_k);
-    if(mysql_ready) mysql_close(&sql);
+    if(mysql_ready) sql_close(&sql);
     if(mysql_lib_ready) mysql_library_end();
 
     return retval;
@@ -1159,10 +1159,10 @@ cu:
 static derr_t test_free(void){
     derr_t e = E_OK;
 
-    MYSQL sql = {0};
+    sql_t sql = {0};
     kvpsend_t k = {0};
 
-    mysql_close(&sql);
+    sql_close(&sql);
     kvpsend_free(&k);
 
     return e;
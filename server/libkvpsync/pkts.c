@@ -13,7 +13,7 @@ const char *kvp_update_type_name(kvp_update_type_e type){
     return "unknown";
 }
 
-static uint64_t read_uint64(const dstr_t rbuf, size_t *pos, bool *ok){
+uint64_t kvp_read_uint64(const dstr_t rbuf, size_t *pos, bool *ok){
     if(!*ok) return 0;
     uint8_t *udata = (uint8_t*)rbuf.data;
     if(*pos + 8 > rbuf.len){
@@ -32,7 +32,7 @@ static uint64_t read_uint64(const dstr_t rbuf, size_t *pos, bool *ok){
     return u;
 }
 
-static uint32_t read_uint32(const dstr_t rbuf, size_t *pos, bool *ok){
+uint32_t kvp_read_uint32(const dstr_t rbuf, size_t *pos, bool *ok){
     if(!*ok) return 0;
     uint8_t *udata = (uint8_t*)rbuf.data;
     if(*pos + 4 > rbuf.len){
@@ -47,7 +47,7 @@ static uint32_t read_uint32(const dstr_t rbuf, size_t *pos, bool *ok){
     return u;
 }
 
-static uint8_t read_uint8(const dstr_t rbuf, size_t *pos, bool *ok){
+uint8_t kvp_read_uint8(const dstr_t rbuf, size_t *pos, bool *ok){
     if(!*ok) return 0;
     uint8_t *udata = (uint8_t*)rbuf.data;
     if(*pos + 1 > rbuf.len){
@@ -59,7 +59,7 @@ static uint8_t read_uint8(const dstr_t rbuf, size_t *pos, bool *ok){
     return u;
 }
 
-static derr_t write_uint64(uint64_t u, dstr_t *out){
+derr_t kvp_write_uint64(uint64_t u, dstr_t *out){
     derr_t e = E_OK;
 
     PROP(&e, dstr_grow(out, out->len + 8) );
@@ -77,7 +77,7 @@ static derr_t write_uint64(uint64_t u, dstr_t *out){
     return e;
 }
 
-static derr_t write_uint32(uint32_t u, dstr_t *out){
+derr_t kvp_write_uint32(uint32_t u, dstr_t *out){
     derr_t e = E_OK;
 
     PROP(&e, dstr_grow(out, out->len + 4) );
@@ -91,7 +91,7 @@ static derr_t write_uint32(uint32_t u, dstr_t *out){
     return e;
 }
 
-static derr_t write_uint8(uint8_t u, dstr_t *out){
+derr_t kvp_write_uint8(uint8_t u, dstr_t *out){
     derr_t e = E_OK;
 
     PROP(&e, dstr_grow(out, out->len + 1) );
@@ -108,12 +108,12 @@ bool kvpsync_update_read(const dstr_t rbuf, kvp_update_t *out){
     *out = (kvp_update_t){0};
 
     size_t pos = 0;
-    out->ok_expiry = read_uint64(rbuf, &pos, &ok);
-    out->sync_id = read_uint32(rbuf, &pos, &ok);
-    out->update_id = read_uint32(rbuf, &pos, &ok);
+    out->ok_expiry = kvp_read_uint64(rbuf, &pos, &ok);
+    out->sync_id = kvp_read_uint32(rbuf, &pos, &ok);
+    out->update_id = kvp_read_uint32(rbuf, &pos, &ok);
 
     // conditional parsing based on flags
-    out->type = read_uint8(rbuf, &pos, &ok);
+    out->type = kvp_read_uint8(rbuf, &pos, &ok);
     if(!ok) return false;
     switch(out->type){
         // empty contents
@@ -123,7 +123,7 @@ bool kvpsync_update_read(const dstr_t rbuf, kvp_update_t *out){
         case KVP_UPDATE_START:
             if(out->update_id != 1) return false;
             // read resync_id
-            out->resync_id = read_uint32(rbuf, &pos, &ok);
+            out->resync_id = kvp_read_uint32(rbuf, &pos, &ok);
             return ok;
         case KVP_UPDATE_INSERT:
         case KVP_UPDATE_DELETE:
@@ -134,7 +134,7 @@ bool kvpsync_update_read(const dstr_t rbuf, kvp_update_t *out){
     }
 
     // read key
-    out->klen = read_uint8(rbuf, &pos, &ok);
+    out->klen = kvp_read_uint8(rbuf, &pos, &ok);
     if(!ok) return false;
     if(pos + out->klen > rbuf.len) return false;
     memcpy(out->key, &rbuf.data[pos], out->klen);
@@ -142,12 +142,12 @@ bool kvpsync_update_read(const dstr_t rbuf, kvp_update_t *out){
 
     if(out->type == KVP_UPDATE_DELETE){
         // read delete_id
-        out->delete_id = read_uint32(rbuf, &pos, &ok);
+        out->delete_id = kvp_read_uint32(rbuf, &pos, &ok);
         return ok;
     }
 
     // read value
-    out->vlen = read_uint8(rbuf, &pos, &ok);
+    out->vlen = kvp_read_uint8(rbuf, &pos, &ok);
     if(!ok) return false;
     if(pos + out->vlen > rbuf.len) return false;
     memcpy(out->val, &rbuf.data[pos], out->vlen);
@@ -159,10 +159,10 @@ bool kvpsync_update_read(const dstr_t rbuf, kvp_update_t *out){
 derr_t kvpsync_update_write(const kvp_update_t *update, dstr_t *out){
     derr_t e = E_OK;
 
-    PROP(&e, write_uint64(update->ok_expiry, out) );
-    PROP(&e, write_uint32(update->sync_id, out) );
-    PROP(&e, write_uint32(update->update_id, out) );
-    PROP(&e, write_uint8(update->type, out) );
+    PROP(&e, kvp_write_uint64(update->ok_expiry, out) );
+    PROP(&e, kvp_write_uint32(update->sync_id, out) );
+    PROP(&e, kvp_write_uint32(update->update_id, out) );
+    PROP(&e, kvp_write_uint8(update->type, out) );
     switch(update->type){
         // empty contents
         case KVP_UPDATE_EMPTY:
@@ -172,7 +172,7 @@ derr_t kvpsync_update_write(const kvp_update_t *update, dstr_t *out){
             if(update->update_id != 1){
                 ORIG(&e, E_INTERNAL, "invalid update_id in START packet");
             }
-            PROP(&e, write_uint32(update->resync_id, out) );
+            PROP(&e, kvp_write_uint32(update->resync_id, out) );
             return e;
         case KVP_UPDATE_INSERT:
         case KVP_UPDATE_DELETE:
@@ -182,17 +182,17 @@ derr_t kvpsync_update_write(const kvp_update_t *update, dstr_t *out){
             ORIG(&e, E_INTERNAL, "invalid packet type");
     }
     // INSERT and DELETE: write klen and key
-    PROP(&e, write_uint8(update->klen, out) );
+    PROP(&e, kvp_write_uint8(update->klen, out) );
     PROP(&e, dstr_grow(out, out->len + update->klen) );
     memcpy(&out->data[out->len], update->key, update->klen);
     out->len += update->klen;
     if(update->type == KVP_UPDATE_DELETE){
         // DELETE: write delete_id
-        PROP(&e, write_uint32(update->delete_id, out) );
+        PROP(&e, kvp_write_uint32(update->delete_id, out) );
         return e;
     }
     // INSERT: write vlen and val
-    PROP(&e, write_uint8(update->vlen, out) );
+    PROP(&e, kvp_write_uint8(update->vlen, out) );
     PROP(&e, dstr_grow(out, out->len + update->vlen) );
     memcpy(&out->data[out->len], update->val, update->vlen);
     out->len += update->vlen;
@@ -205,8 +205,8 @@ bool kvpsync_ack_read(const dstr_t rbuf, kvp_ack_t *out){
     *out = (kvp_ack_t){0};
 
     size_t pos = 0;
-    out->sync_id = read_uint32(rbuf, &pos, &ok);
-    out->update_id = read_uint32(rbuf, &pos, &ok);
+    out->sync_id = kvp_read_uint32(rbuf, &pos, &ok);
+    out->update_id = kvp_read_uint32(rbuf, &pos, &ok);
 
     return ok;
 }
@@ -214,8 +214,8 @@ bool kvpsync_ack_read(const dstr_t rbuf, kvp_ack_t *out){
 derr_t kvpsync_ack_write(const kvp_ack_t *ack, dstr_t *out){
     derr_t e = E_OK;
 
-    PROP(&e, write_uint32(ack->sync_id, out) );
-    PROP(&e, write_uint32(ack->update_id, out) );
+    PROP(&e, kvp_write_uint32(ack->sync_id, out) );
+    PROP(&e, kvp_write_uint32(ack->update_id, out) );
 
     return e;
 }
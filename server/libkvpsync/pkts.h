@@ -1,5 +1,13 @@
 #define KVPSYNC_MAX_LEN 255
 
+// big-endian integer helpers; reads set *ok=false on overrun
+uint64_t kvp_read_uint64(const dstr_t rbuf, size_t *pos, bool *ok);
+uint32_t kvp_read_uint32(const dstr_t rbuf, size_t *pos, bool *ok);
+uint8_t kvp_read_uint8(const dstr_t rbuf, size_t *pos, bool *ok);
+derr_t kvp_write_uint64(uint64_t u, dstr_t *out);
+derr_t kvp_write_uint32(uint32_t u, dstr_t *out);
+derr_t kvp_write_uint8(uint8_t u, dstr_t *out);
+
 typedef enum {
     KVP_UPDATE_EMPTY = 0,
     KVP_UPDATE_FLUSH = 1,
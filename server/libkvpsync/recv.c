@@ -26,10 +26,11 @@ DEF_CONTAINER_OF(recv_datum_t, gc, link_t)
 struct recv_data_t {
     dstr_t key;
     char _key[KVPSYNC_MAX_LEN];
+    uint32_t hash;  // kvp_hash(key)
     link_t list;  // recv_datum_t->link
-    hash_elem_t elem;  // kvp_recv_t->h
+    link_t link;  // kvpsync_recv_t->all
 };
-DEF_CONTAINER_OF(recv_data_t, elem, hash_elem_t)
+DEF_CONTAINER_OF(recv_data_t, link, link_t)
 
 // recv_datum_t is freed with just free
 static derr_t recv_datum_new(
@@ -81,6 +82,7 @@ static derr_t recv_data_new(recv_data_t **out, const dstr_t key){
 
     DSTR_WRAP_ARRAY(data->key, data->_key);
     PROP_GO(&e, dstr_append(&data->key, &key), fail);
+    data->hash = kvp_hash(key);
 
     *out = data;
 
@@ -91,14 +93,96 @@ fail:
     return e;
 }
 
+#define MIN_SLOTS 64
+
+static recv_slot_t *slot_find(
+    kvpsync_recv_t *r, const dstr_t key, uint32_t hash
+){
+    size_t mask = r->nslots - 1;
+    // load factor is kept under 1/2, so there is always an empty slot
+    for(size_t i = hash & mask; ; i = (i + 1) & mask){
+        recv_slot_t *slot = &r->slots[i];
+        if(!slot->data) return NULL;
+        if(slot->hash == hash && dstr_eq(slot->data->key, key)) return slot;
+    }
+}
+
+// assumes data->key is not already present
+static void slot_put(recv_slot_t *slots, size_t nslots, recv_data_t *data){
+    size_t mask = nslots - 1;
+    size_t i = data->hash & mask;
+    while(slots[i].data) i = (i + 1) & mask;
+    slots[i] = (recv_slot_t){ .hash = data->hash, .data = data };
+}
+
+static derr_t slots_resize(kvpsync_recv_t *r, size_t nslots){
+    derr_t e = E_OK;
+
+    recv_slot_t *slots = calloc(nslots, sizeof(*slots));
+    if(!slots) ORIG(&e, E_NOMEM, "nomem");
+    for(size_t i = 0; i < r->nslots; i++){
+        if(!r->slots[i].data) continue;
+        slot_put(slots, nslots, r->slots[i].data);
+    }
+    free(r->slots);
+    r->slots = slots;
+    r->nslots = nslots;
+
+    return e;
+}
+
+static derr_t slots_insert(kvpsync_recv_t *r, recv_data_t *data){
+    derr_t e = E_OK;
+
+    if((r->ndata + 1) * 2 > r->nslots){
+        PROP(&e, slots_resize(r, r->nslots * 2) );
+    }
+
+    slot_put(r->slots, r->nslots, data);
+    link_list_append(&r->all, &data->link);
+    r->ndata++;
+
+    return e;
+}
+
+// backward-shift deletion, so we never need tombstones
+static void slots_remove(kvpsync_recv_t *r, recv_data_t *data){
+    recv_slot_t *slot = slot_find(r, data->key, data->hash);
+    if(!slot) LOG_FATAL("recv_data_t not found in slots\n");
+    size_t mask = r->nslots - 1;
+    size_t hole = (size_t)(slot - r->slots);
+    for(size_t i = (hole + 1) & mask; r->slots[i].data; i = (i + 1) & mask){
+        size_t home = r->slots[i].hash & mask;
+        // slot i may fill the hole only if its home is not in (hole, i]
+        bool stay = hole <= i
+            ? (home > hole && home <= i)
+            : (home > hole || home <= i);
+        if(stay) continue;
+        r->slots[hole] = r->slots[i];
+        hole = i;
+    }
+    r->slots[hole] = (recv_slot_t){0};
+    link_remove(&data->link);
+    r->ndata--;
+
+    /* shrink once the table is under 1/8 full, so it stays between 1/8 and
+       1/2 full; if the allocation fails, the bigger table still works */
+    if(r->nslots > MIN_SLOTS && r->ndata * 8 < r->nslots){
+        DROP_CMD( slots_resize(r, r->nslots / 2) );
+    }
+}
+
 // returns true if data still exists
-static bool data_remove_datum(recv_data_t *data, recv_datum_t *datum){
+static bool data_remove_datum(
+    kvpsync_recv_t *r, recv_data_t *data, recv_datum_t *datum
+){
     link_remove(&datum->gc);
     link_remove(&datum->link);
     free(datum);
+    r->dirty = true;
     if(!link_list_isempty(&data->list)) return true;
     // this data is empty
-    hash_elem_remove(&data->elem);
+    slots_remove(r, data);
     free(data);
     return false;
 }
@@ -120,7 +204,10 @@ derr_t kvpsync_recv_init(kvpsync_recv_t *r){
 
     *r = (kvpsync_recv_t){ .recv_id = recv_id };
 
-    PROP(&e, hashmap_init(&r->h) );
+    link_init(&r->all);
+    r->slots = calloc(MIN_SLOTS, sizeof(*r->slots));
+    if(!r->slots) ORIG(&e, E_NOMEM, "nomem");
+    r->nslots = MIN_SLOTS;
 
     return e;
 }
@@ -128,15 +215,12 @@ derr_t kvpsync_recv_init(kvpsync_recv_t *r){
 static void for_each_datum(
     kvpsync_recv_t *r, bool (*should_free)(kvpsync_recv_t*, recv_datum_t*)
 ){
-    // free every data and datum
-    hashmap_trav_t trav;
-    hash_elem_t *elem = hashmap_iter(&trav, &r->h);
-    for(; elem; elem = hashmap_next(&trav)){
-        recv_data_t *data = CONTAINER_OF(elem, recv_data_t, elem);
+    recv_data_t *data, *dtemp;
+    LINK_FOR_EACH_SAFE(data, dtemp, &r->all, recv_data_t, link){
         recv_datum_t *datum, *temp;
         LINK_FOR_EACH_SAFE(datum, temp, &data->list, recv_datum_t, link){
             if(!should_free(r, datum)) continue;
-            bool data_ok = data_remove_datum(data, datum);
+            bool data_ok = data_remove_datum(r, data, datum);
             if(!data_ok) break;
         }
     }
@@ -149,10 +233,13 @@ static bool _always_should_free(kvpsync_recv_t *r, recv_datum_t *datum){
 }
 
 void kvpsync_recv_free(kvpsync_recv_t *r){
+    if(!r->slots) return;
     // free every data and datum
     for_each_datum(r, _always_should_free);
-    // free hashmap
-    hashmap_free(&r->h);
+    // free slots
+    free(r->slots);
+    r->slots = NULL;
+    r->nslots = 0;
 }
 
 static void do_gc(kvpsync_recv_t *r, xtime_t now){
@@ -160,7 +247,7 @@ static void do_gc(kvpsync_recv_t *r, xtime_t now){
     LINK_FOR_EACH_SAFE(datum, temp, &r->gc, recv_datum_t, gc){
         if(now < datum->gc_time) return;
         recv_data_t *data = datum->data;
-        data_remove_datum(data, datum);
+        data_remove_datum(r, data, datum);
     }
 }
 
@@ -186,24 +273,23 @@ static derr_t handle_recv_or_delete(
     recv_data_t *new_data = NULL;
     recv_datum_t *new_datum = NULL;
 
-    hash_elem_t *elem = hashmap_gets(&r->h, &key);
-    if(!elem){
-        // first item for this key, put a datum in a data in the hashmap
+    recv_slot_t *slot = slot_find(r, key, kvp_hash(key));
+    if(!slot){
+        // first item for this key, put a datum in a data in the slots
         PROP(&e, recv_data_new(&new_data, key) );
         PROP_GO(&e,
             recv_datum_new(
                 &new_datum, new_data, sync_id, update_id, delete_id, val
             ),
         fail);
-        PROP_GO(&e,
-            hashmap_sets_unique(&r->h, &new_data->key, &new_data->elem),
-        fail);
+        PROP_GO(&e, slots_insert(r, new_data), fail);
         link_list_append(&new_data->list, &new_datum->link);
+        r->dirty = true;
         return e;
     }
 
     // secondary item for this key, check for duplicates or cancellations
-    recv_data_t *data = CONTAINER_OF(elem, recv_data_t, elem);
+    recv_data_t *data = slot->data;
     recv_datum_t *other, *temp;
     xtime_t gc_time = 0;
     LINK_FOR_EACH_SAFE(other, temp, &data->list, recv_datum_t, link){
@@ -219,6 +305,7 @@ static derr_t handle_recv_or_delete(
             // remove other immediately
             link_remove(&other->link);
             free(other);
+            r->dirty = true;
             // continue with inserting ourselves, but with a timer
 
         }else if(!delete_id && other->delete_id == update_id){
@@ -230,6 +317,7 @@ static derr_t handle_recv_or_delete(
             // put other on a timer
             other->gc_time = now + GC_DELAY;
             link_list_append(&r->gc, &other->gc);
+            r->dirty = true;
             return e;
         }
     }
@@ -239,6 +327,7 @@ static derr_t handle_recv_or_delete(
         recv_datum_new(&new_datum, data, sync_id, update_id, delete_id, val)
     );
     link_list_append(&data->list, &new_datum->link);
+    r->dirty = true;
     if(gc_time){
         new_datum->gc_time = gc_time;
         link_list_append(&r->gc, &new_datum->gc);
@@ -302,7 +391,9 @@ derr_t kvpsync_recv_handle_update(
             // ignore any packets before our resync is acknowldged
             if(!r->initial_sync_acked) break;
             r->sync_id = update.sync_id;
+            r->snap_sync_id = 0;
             r->ok_expiry = MAX(r->ok_expiry, update.ok_expiry);
+            r->dirty = true;
             flush_stale_data(r);
             break;
 
@@ -338,22 +429,30 @@ const dstr_t *UNSURE = &(dstr_t){0};
    until the next call to handle_update() */
 const dstr_t *kvpsync_recv_get_value(
     kvpsync_recv_t *r, xtime_t now, const dstr_t key
+){
+    return kvpsync_recv_get_value_hashed(r, now, key, kvp_hash(key));
+}
+
+const dstr_t *kvpsync_recv_get_value_hashed(
+    kvpsync_recv_t *r, xtime_t now, const dstr_t key, uint32_t hash
 ){
     do_gc(r, now);
 
-    // if we have no sync_id, then we can serve nothing at all
-    if(!r->sync_id){
+    /* if we have no sync_id, then we can serve nothing at all, except for
+       positive answers from an unclean snapshot (ok_expiry is zero then) */
+    uint32_t sync_id = r->sync_id ? r->sync_id : r->snap_sync_id;
+    if(!sync_id){
         return UNSURE;
     }
 
     // lookup the data we have for this key
-    hash_elem_t *elem = hashmap_gets(&r->h, &key);
-    if(!elem){
+    recv_slot_t *slot = slot_find(r, key, hash);
+    if(!slot){
         // no information
         return now < r->ok_expiry ? NULL : UNSURE;
     }
 
-    recv_data_t *data = CONTAINER_OF(elem, recv_data_t, elem);
+    recv_data_t *data = slot->data;
 
     // use the datum with the highest update_id
     dstr_t *ans = NULL;
@@ -361,7 +460,7 @@ const dstr_t *kvpsync_recv_get_value(
     recv_datum_t *datum;
     LINK_FOR_EACH(datum, &data->list, recv_datum_t, link){
         // ignore any datum from the wrong sync_id
-        if(datum->sync_id != r->sync_id) continue;
+        if(datum->sync_id != sync_id) continue;
         // ignore any datum older than our current answer
         if(datum->update_id < ans_update_id) continue;
         ans = datum->delete_id ? NULL : &datum->val;
@@ -381,3 +480,254 @@ const dstr_t *kvpsync_recv_get_value(
     // even if we are not OK, we serve positive results confidently
     return ans;
 }
+
+/* snapshot format, all integers big-endian:
+
+       uint32_t magic;  // SNAPSHOT_MAGIC
+       uint8_t version;  // SNAPSHOT_VERSION
+       uint8_t clean;
+       uint8_t peerlen;
+       char peer[peerlen];
+       uint32_t recv_id;
+       uint32_t sync_id;
+       uint64_t ok_expiry;
+       uint32_t ndata;
+       ndata * {
+           uint8_t klen;
+           char key[klen];
+           uint32_t ndatum;
+           ndatum * {
+               uint32_t sync_id;
+               uint32_t update_id;
+               uint32_t delete_id;
+               uint64_t gc_time;
+               uint8_t vlen;
+               char val[vlen];
+           }
+       } */
+#define SNAPSHOT_MAGIC 0x6b767073  // "kvps"
+#define SNAPSHOT_VERSION 1
+
+static derr_t write_lstr(const dstr_t d, dstr_t *out){
+    derr_t e = E_OK;
+    if(d.len > UINT8_MAX) ORIG(&e, E_PARAM, "string too long for snapshot");
+    PROP(&e, kvp_write_uint8((uint8_t)d.len, out) );
+    PROP(&e, dstr_append(out, &d) );
+    return e;
+}
+
+static dstr_t read_lstr(const dstr_t rbuf, size_t *pos, bool *ok){
+    uint8_t len = kvp_read_uint8(rbuf, pos, ok);
+    if(!*ok || *pos + len > rbuf.len){
+        *ok = false;
+        return (dstr_t){0};
+    }
+    dstr_t out = dstr_sub2(rbuf, *pos, *pos + len);
+    *pos += len;
+    return out;
+}
+
+static derr_t snapshot_write(
+    kvpsync_recv_t *r, const dstr_t peer, bool clean, dstr_t *out
+){
+    derr_t e = E_OK;
+
+    PROP(&e, kvp_write_uint32(SNAPSHOT_MAGIC, out) );
+    PROP(&e, kvp_write_uint8(SNAPSHOT_VERSION, out) );
+    // without a completed sync, there is nothing to resume
+    if(!r->sync_id) clean = false;
+    uint32_t sync_id = r->sync_id ? r->sync_id : r->snap_sync_id;
+
+    PROP(&e, kvp_write_uint8(clean, out) );
+    PROP(&e, write_lstr(peer, out) );
+    PROP(&e, kvp_write_uint32(r->recv_id, out) );
+    PROP(&e, kvp_write_uint32(sync_id, out) );
+    PROP(&e, kvp_write_uint64(r->ok_expiry, out) );
+    PROP(&e, kvp_write_uint32((uint32_t)r->ndata, out) );
+
+    recv_data_t *data;
+    LINK_FOR_EACH(data, &r->all, recv_data_t, link){
+        PROP(&e, write_lstr(data->key, out) );
+        uint32_t ndatum = 0;
+        recv_datum_t *datum;
+        LINK_FOR_EACH(datum, &data->list, recv_datum_t, link){
+            ndatum++;
+        }
+        PROP(&e, kvp_write_uint32(ndatum, out) );
+        LINK_FOR_EACH(datum, &data->list, recv_datum_t, link){
+            PROP(&e, kvp_write_uint32(datum->sync_id, out) );
+            PROP(&e, kvp_write_uint32(datum->update_id, out) );
+            PROP(&e, kvp_write_uint32(datum->delete_id, out) );
+            PROP(&e, kvp_write_uint64(datum->gc_time, out) );
+            PROP(&e, write_lstr(datum->val, out) );
+        }
+    }
+
+    return e;
+}
+
+derr_t kvpsync_recv_save(
+    kvpsync_recv_t *r, const dstr_t peer, bool clean, const char *path
+){
+    derr_t e = E_OK;
+
+    dstr_t buf = {0};
+    DSTR_VAR(tmp, 4096);
+
+    PROP_GO(&e, dstr_new(&buf, 4096), cu);
+    PROP_GO(&e, snapshot_write(r, peer, clean, &buf), cu);
+
+    // write to a temporary file and rename it, so a crash never corrupts it
+    PROP_GO(&e, FMT(&tmp, "%x.tmp", FS(path)), cu);
+    PROP_GO(&e, dstr_write_file(tmp.data, &buf), cu);
+    PROP_GO(&e, drename_atomic(tmp.data, path), cu);
+
+    r->dirty = false;
+
+cu:
+    dstr_free(&buf);
+    return e;
+}
+
+// insert gc'd datums in gc_time order, since do_gc relies on it
+static void gc_insert_sorted(kvpsync_recv_t *r, recv_datum_t *datum){
+    if(!r->gc.next) link_init(&r->gc);
+    link_t *at = r->gc.prev;
+    while(at != &r->gc){
+        recv_datum_t *other = CONTAINER_OF(at, recv_datum_t, gc);
+        if(other->gc_time <= datum->gc_time) break;
+        at = at->prev;
+    }
+    link_list_prepend(at, &datum->gc);
+}
+
+// like kvpsync_recv_free, but tolerates recv_data_t's with no datums
+static void recv_clear(kvpsync_recv_t *r){
+    recv_data_t *data, *dtemp;
+    LINK_FOR_EACH_SAFE(data, dtemp, &r->all, recv_data_t, link){
+        recv_datum_t *datum, *temp;
+        LINK_FOR_EACH_SAFE(datum, temp, &data->list, recv_datum_t, link){
+            link_remove(&datum->gc);
+            link_remove(&datum->link);
+            free(datum);
+        }
+        slots_remove(r, data);
+        free(data);
+    }
+}
+
+// returns bool ok, errors are for real failures, not for bad snapshots
+static derr_t snapshot_read(
+    kvpsync_recv_t *r, const dstr_t peer, const dstr_t rbuf, bool *ok
+){
+    derr_t e = E_OK;
+
+    size_t pos = 0;
+    *ok = true;
+
+    uint32_t magic = kvp_read_uint32(rbuf, &pos, ok);
+    uint8_t version = kvp_read_uint8(rbuf, &pos, ok);
+    if(!*ok || magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION){
+        *ok = false;
+        return e;
+    }
+    bool clean = kvp_read_uint8(rbuf, &pos, ok);
+    dstr_t snap_peer = read_lstr(rbuf, &pos, ok);
+    uint32_t recv_id = kvp_read_uint32(rbuf, &pos, ok);
+    uint32_t sync_id = kvp_read_uint32(rbuf, &pos, ok);
+    xtime_t ok_expiry = kvp_read_uint64(rbuf, &pos, ok);
+    uint32_t ndata = kvp_read_uint32(rbuf, &pos, ok);
+    if(!*ok || !dstr_eq(snap_peer, peer) || !recv_id){
+        *ok = false;
+        return e;
+    }
+
+    for(uint32_t i = 0; i < ndata; i++){
+        dstr_t key = read_lstr(rbuf, &pos, ok);
+        uint32_t ndatum = kvp_read_uint32(rbuf, &pos, ok);
+        if(!*ok || !ndatum || slot_find(r, key, kvp_hash(key))){
+            *ok = false;
+            return e;
+        }
+        recv_data_t *data;
+        PROP(&e, recv_data_new(&data, key) );
+        PROP_GO(&e, slots_insert(r, data), fail_data);
+        for(uint32_t j = 0; j < ndatum; j++){
+            uint32_t d_sync_id = kvp_read_uint32(rbuf, &pos, ok);
+            uint32_t update_id = kvp_read_uint32(rbuf, &pos, ok);
+            uint32_t delete_id = kvp_read_uint32(rbuf, &pos, ok);
+            xtime_t gc_time = kvp_read_uint64(rbuf, &pos, ok);
+            dstr_t val = read_lstr(rbuf, &pos, ok);
+            if(!*ok) return e;
+            recv_datum_t *datum;
+            PROP(&e,
+                recv_datum_new(
+                    &datum, data, d_sync_id, update_id, delete_id, val
+                )
+            );
+            link_list_append(&data->list, &datum->link);
+            if(gc_time){
+                datum->gc_time = gc_time;
+                gc_insert_sorted(r, datum);
+            }
+        }
+        continue;
+
+    fail_data:
+        free(data);
+        return e;
+    }
+
+    if(pos != rbuf.len){
+        *ok = false;
+        return e;
+    }
+
+    if(clean){
+        // resume exactly where we left off
+        r->recv_id = recv_id;
+        r->sync_id = sync_id;
+        r->initial_sync_acked = true;
+        r->ok_expiry = ok_expiry;
+    }else{
+        /* not r->sync_id, or a late packet from the old sync could extend
+           ok_expiry before our resync completes */
+        r->snap_sync_id = sync_id;
+    }
+
+    return e;
+}
+
+derr_t kvpsync_recv_load(
+    kvpsync_recv_t *r, const dstr_t peer, const char *path, bool *resumed
+){
+    derr_t e = E_OK;
+
+    *resumed = false;
+
+    dstr_t buf = {0};
+
+    bool exists;
+    PROP_GO(&e, dexists(path, &exists), cu);
+    if(!exists) goto cu;
+
+    PROP_GO(&e, dstr_new(&buf, 4096), cu);
+    PROP_GO(&e, dstr_read_file(path, &buf), cu);
+
+    bool ok;
+    derr_t e2 = snapshot_read(r, peer, buf, &ok);
+    if(is_error(e2) || !ok){
+        // discard anything partially loaded
+        recv_clear(r);
+        PROP_VAR_GO(&e, &e2, cu);
+        LOG_WARN("ignoring unusable kvpsync snapshot %x\n", FS(path));
+        goto cu;
+    }
+
+    *resumed = r->initial_sync_acked;
+    r->dirty = false;
+
+cu:
+    dstr_free(&buf);
+    return e;
+}
@@ -5,14 +5,30 @@
    even though in practice that's a lot longer than a real packet can live. */
 #define GC_DELAY 255
 
+struct recv_data_t;
+
+typedef struct {
+    uint32_t hash;
+    struct recv_data_t *data;  // NULL for an empty slot
+} recv_slot_t;
+
 // kvpsync_recv_t is the receiver's side of kvp sync
 typedef struct {
-    hashmap_t h;  // maps dstr_t keys to dstr_t values
+    /* an open-addressed, linear-probed table of recv_data_t, keyed by
+       kvp_hash(key), so a lookup is usually one cache line */
+    recv_slot_t *slots;
+    size_t nslots;  // always a power of 2
+    size_t ndata;
+    link_t all;  // recv_data_t->link
     uint32_t recv_id;  // randomly chosen at boot
     uint32_t sync_id;  // the send_id for a sync we've completed, or zero
+    /* the sync_id of an unclean snapshot, only trusted for positive answers
+       until our own sync completes */
+    uint32_t snap_sync_id;
     bool initial_sync_acked;
     xtime_t ok_expiry;
     link_t gc; // recv_datum_t->gc
+    bool dirty;  // changed since the last kvpsync_recv_save()
 } kvpsync_recv_t;
 
 derr_t kvpsync_recv_init(kvpsync_recv_t *r);
@@ -30,3 +46,33 @@ extern const dstr_t *UNSURE;
 const dstr_t *kvpsync_recv_get_value(
     kvpsync_recv_t *r, xtime_t now, const dstr_t key
 );
+
+// same as kvpsync_recv_get_value, but with hash=kvp_hash(key) precomputed
+const dstr_t *kvpsync_recv_get_value_hashed(
+    kvpsync_recv_t *r, xtime_t now, const dstr_t key, uint32_t hash
+);
+
+/* Snapshots let a restarted receiver answer immediately instead of answering
+   UNSURE until a full resync completes.
+
+   A "clean" snapshot must be written after the final ack has been sent, so
+   that it contains every update the sender believes we have.  Loading a clean
+   snapshot resumes the old recv_id and sync_id, and no resync is needed: the
+   sender will simply retransmit whatever we didn't ack while we were down.
+
+   Any other snapshot (such as a periodic one, after a crash) may be missing
+   acked updates, so it is only trusted for positive answers, which are always
+   safe to give, and a full resync is still required.
+
+   The peer is an opaque identifier for the sender; a snapshot for a different
+   peer is ignored. */
+derr_t kvpsync_recv_save(
+    kvpsync_recv_t *r, const dstr_t peer, bool clean, const char *path
+);
+
+/* r must be freshly initialized.  A missing, mismatched, or corrupt snapshot
+   is not an error, it just leaves r empty.  *resumed indicates that a clean
+   snapshot was loaded, and no initial resync request should be sent. */
+derr_t kvpsync_recv_load(
+    kvpsync_recv_t *r, const dstr_t peer, const char *path, bool *resumed
+);
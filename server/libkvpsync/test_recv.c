@@ -119,7 +119,7 @@ static derr_t test_recv(void){
     MUST_RESYNC( FLUSH(9, 6, 1*SECOND) );
     EXPECT_B_GO(&e, "initial_sync_acked", r.initial_sync_acked, false, cu);
     EXPECT_U_GO(&e, "ok_expiry", r.ok_expiry, 0, cu);
-    EXPECT_U_GO(&e, "num_elems", r.h.num_elems, 0, cu);
+    EXPECT_U_GO(&e, "num_elems", r.ndata, 0, cu);
     EXPECT_B_GO(&e, "gc empty", link_list_isempty(&r.gc), true, cu);
 
     // all responses are UNSURE
@@ -320,6 +320,217 @@ cu:
     return e;
 }
 
+static derr_t expect_reply_n(
+    kvpsync_recv_t *r, xtime_t now, size_t i, bool exists
+){
+    derr_t e = E_OK;
+
+    DSTR_VAR(k, 32);
+    PROP(&e, FMT(&k, "key%x", FU(i)) );
+    const dstr_t *got = kvpsync_recv_get_value(r, now, k);
+    if(!exists){
+        if(got == NULL) return e;
+        ORIG(&e, E_VALUE, "expected %x -> NULL\n", FD(k));
+    }
+    if(got != NULL && got != UNSURE && dstr_eq(*got, k)) return e;
+    ORIG(&e, E_VALUE, "expected %x -> %x\n", FD(k), FD(k));
+}
+
+static derr_t test_many(void){
+    derr_t e = E_OK;
+
+    kvpsync_recv_t r = {0};
+    PROP_GO(&e, kvpsync_recv_init(&r), cu);
+
+    xtime_t now = 1;
+    xtime_t expire = 10000*SECOND;
+    size_t n = 1000;
+
+    MUST_ACK( START(1, r.recv_id) );
+    MUST_ACK( FLUSH(1, 2, expire) );
+
+    // enough keys to force the slots to grow several times
+    for(size_t i = 0; i < n; i++){
+        char k[32];
+        snprintf(k, sizeof(k), "key%zu", i);
+        MUST_ACK( INSERT(k, k, 1, (uint32_t)(3 + i), expire) );
+    }
+    EXPECT_U_GO(&e, "ndata", r.ndata, n, cu);
+    for(size_t i = 0; i < n; i++){
+        PROP_GO(&e, expect_reply_n(&r, now, i, true), cu);
+    }
+
+    // delete every third key, then let gc remove them from the slots
+    uint32_t update_id = (uint32_t)(3 + n);
+    for(size_t i = 0; i < n; i += 3){
+        char k[32];
+        snprintf(k, sizeof(k), "key%zu", i);
+        MUST_ACK( DELETE(k, (uint32_t)(3 + i), 1, update_id++, expire) );
+    }
+    now += GC_DELAY;
+    PROP_GO(&e, expect_reply_n(&r, now, 0, false), cu);
+    EXPECT_U_GO(&e, "ndata", r.ndata, n - (n + 2) / 3, cu);
+
+    // every surviving key must still be reachable after the shifts
+    for(size_t i = 0; i < n; i++){
+        PROP_GO(&e, expect_reply_n(&r, now, i, i % 3 != 0), cu);
+    }
+    size_t big = r.nslots;
+
+    // delete most of the rest, so the slots shrink
+    for(size_t i = 0; i < n; i++){
+        if(i % 3 == 0 || i % 30 == 1) continue;
+        char k[32];
+        snprintf(k, sizeof(k), "key%zu", i);
+        MUST_ACK( DELETE(k, (uint32_t)(3 + i), 1, update_id++, expire) );
+    }
+    now += GC_DELAY;
+    PROP_GO(&e, expect_reply_n(&r, now, 0, false), cu);
+    EXPECT_U_GO(&e, "ndata", r.ndata, (n + 29) / 30, cu);
+    if(r.nslots >= big){
+        ORIG_GO(&e, E_VALUE, "slots did not shrink from %x", cu, FU(big));
+    }
+    for(size_t i = 0; i < n; i++){
+        PROP_GO(&e, expect_reply_n(&r, now, i, i % 30 == 1), cu);
+    }
+
+    // deleting everything shrinks back to the initial size
+    for(size_t i = 1; i < n; i += 30){
+        char k[32];
+        snprintf(k, sizeof(k), "key%zu", i);
+        MUST_ACK( DELETE(k, (uint32_t)(3 + i), 1, update_id++, expire) );
+    }
+    now += GC_DELAY;
+    PROP_GO(&e, expect_reply_n(&r, now, 0, false), cu);
+    EXPECT_U_GO(&e, "ndata", r.ndata, 0, cu);
+    EXPECT_U_GO(&e, "nslots", r.nslots, 64, cu);
+
+cu:
+    kvpsync_recv_free(&r);
+
+    return e;
+}
+
+static derr_t test_snapshot(void){
+    derr_t e = E_OK;
+
+    kvpsync_recv_t r = {0};
+    DSTR_VAR(tmp, 4096);
+    DSTR_VAR(path, 4096);
+    DSTR_STATIC(peer, "10.0.0.1:4567");
+    bool resumed;
+
+    PROP(&e, mkdir_temp("test-recv", &tmp) );
+    PROP_GO(&e, FMT(&path, "%x/snap", FD(tmp)), cu);
+
+    // a missing snapshot is not an error
+    PROP_GO(&e, kvpsync_recv_init(&r), cu);
+    PROP_GO(&e, kvpsync_recv_load(&r, peer, path.data, &resumed), cu);
+    EXPECT_B_GO(&e, "resumed", resumed, false, cu);
+    EXPECT_U_GO(&e, "ndata", r.ndata, 0, cu);
+
+    xtime_t now = 1;
+    xtime_t expire = 10000*SECOND;
+
+    MUST_ACK( START(1, r.recv_id) );
+    MUST_ACK( INSERT("A", "aaa", 1, 2, 0) );
+    MUST_ACK( INSERT("B", "bbb", 1, 3, 0) );
+    MUST_ACK( FLUSH(1, 4, expire) );
+    MUST_ACK( INSERT("C", "ccc", 1, 5, expire) );
+    // a pending deletion, which must keep its gc timer
+    MUST_ACK( DELETE("B", 3, 1, 6, expire) );
+    EXPECT_B_GO(&e, "dirty", r.dirty, true, cu);
+
+    // a clean snapshot resumes exactly
+    PROP_GO(&e, kvpsync_recv_save(&r, peer, true, path.data), cu);
+    EXPECT_B_GO(&e, "dirty", r.dirty, false, cu);
+    uint32_t old_recv_id = r.recv_id;
+    kvpsync_recv_free(&r);
+    PROP_GO(&e, kvpsync_recv_init(&r), cu);
+    PROP_GO(&e, kvpsync_recv_load(&r, peer, path.data, &resumed), cu);
+    EXPECT_B_GO(&e, "resumed", resumed, true, cu);
+    EXPECT_U_GO(&e, "recv_id", r.recv_id, old_recv_id, cu);
+    EXPECT_U_GO(&e, "sync_id", r.sync_id, 1, cu);
+    EXPECT_U_GO(&e, "ok_expiry", r.ok_expiry, expire, cu);
+    EXPECT_REPLY("A", "aaa");
+    EXPECT_REPLY("B", "NULL");
+    EXPECT_REPLY("C", "ccc");
+    EXPECT_REPLY("Z", "NULL");
+    // the sender's retransmissions are acked normally, no resync needed
+    MUST_ACK( INSERT("D", "ddd", 1, 7, expire) );
+    EXPECT_REPLY("D", "ddd");
+    // gc still happens on time
+    EXPECT_B_GO(&e, "gc not empty", !link_list_isempty(&r.gc), true, cu);
+    now += GC_DELAY;
+    EXPECT_REPLY("B", "NULL");
+    EXPECT_B_GO(&e, "gc empty", link_list_isempty(&r.gc), true, cu);
+    EXPECT_U_GO(&e, "ndata", r.ndata, 3, cu);
+
+    // an unclean snapshot only provides positive answers
+    PROP_GO(&e, kvpsync_recv_save(&r, peer, false, path.data), cu);
+    kvpsync_recv_free(&r);
+    PROP_GO(&e, kvpsync_recv_init(&r), cu);
+    PROP_GO(&e, kvpsync_recv_load(&r, peer, path.data, &resumed), cu);
+    EXPECT_B_GO(&e, "resumed", resumed, false, cu);
+    EXPECT_B_GO(&e, "initial_sync_acked", r.initial_sync_acked, false, cu);
+    EXPECT_U_GO(&e, "sync_id", r.sync_id, 0, cu);
+    EXPECT_REPLY("A", "aaa");
+    EXPECT_REPLY("D", "ddd");
+    EXPECT_REPLY("Z", "UNSURE");
+    // and a full resync replaces it
+    MUST_RESYNC( INSERT("E", "eee", 1, 8, expire) );
+    MUST_ACK( START(2, r.recv_id) );
+    // a late packet from the old sync must not make us sure of anything
+    MUST_ACK( INSERT("F", "fff", 1, 9, expire) );
+    EXPECT_U_GO(&e, "ok_expiry", r.ok_expiry, 0, cu);
+    EXPECT_REPLY("Z", "UNSURE");
+    // re-saving before the resync finishes keeps the positive answers
+    PROP_GO(&e, kvpsync_recv_save(&r, peer, true, path.data), cu);
+    kvpsync_recv_free(&r);
+    PROP_GO(&e, kvpsync_recv_init(&r), cu);
+    PROP_GO(&e, kvpsync_recv_load(&r, peer, path.data, &resumed), cu);
+    EXPECT_B_GO(&e, "resumed", resumed, false, cu);
+    EXPECT_REPLY("A", "aaa");
+    EXPECT_REPLY("Z", "UNSURE");
+    MUST_ACK( START(2, r.recv_id) );
+    MUST_ACK( INSERT("A", "aaa2", 2, 2, 0) );
+    EXPECT_REPLY("A", "aaa");
+    MUST_ACK( FLUSH(2, 3, expire) );
+    EXPECT_REPLY("A", "aaa2");
+    EXPECT_REPLY("D", "NULL");
+    EXPECT_U_GO(&e, "ndata", r.ndata, 1, cu);
+    kvpsync_recv_free(&r);
+
+    // a snapshot for another peer is ignored
+    PROP_GO(&e, kvpsync_recv_init(&r), cu);
+    DSTR_STATIC(other, "10.0.0.2:4567");
+    PROP_GO(&e, kvpsync_recv_load(&r, other, path.data, &resumed), cu);
+    EXPECT_B_GO(&e, "resumed", resumed, false, cu);
+    EXPECT_U_GO(&e, "ndata", r.ndata, 0, cu);
+    EXPECT_REPLY("A", "UNSURE");
+    kvpsync_recv_free(&r);
+
+    // so is a corrupt snapshot
+    PROP_GO(&e, kvpsync_recv_init(&r), cu);
+    dstr_t snap = {0};
+    PROP_GO(&e, dstr_new(&snap, 4096), cu);
+    PROP_GO(&e, dstr_read_file(path.data, &snap), cu_snap);
+    snap.len -= 3;
+    PROP_GO(&e, dstr_write_file(path.data, &snap), cu_snap);
+    PROP_GO(&e, kvpsync_recv_load(&r, peer, path.data, &resumed), cu_snap);
+    EXPECT_B_GO(&e, "resumed", resumed, false, cu_snap);
+    EXPECT_U_GO(&e, "ndata", r.ndata, 0, cu_snap);
+
+cu_snap:
+    dstr_free(&snap);
+
+cu:
+    kvpsync_recv_free(&r);
+    DROP_CMD( rm_rf(tmp.data) );
+
+    return e;
+}
+
 int main(int argc, char **argv){
     derr_t e = E_OK;
     // parse options and set default log level
@@ -327,6 +538,8 @@ int main(int argc, char **argv){
 
     PROP_GO(&e, test_recv(), test_fail);
     PROP_GO(&e, test_gc(), test_fail);
+    PROP_GO(&e, test_many(), test_fail);
+    PROP_GO(&e, test_snapshot(), test_fail);
 
     LOG_ERROR("PASS\n");
     return 0;
@@ -10,3 +10,11 @@ xtime_t xtime(void){
     if(ts.tv_nsec < 0) LOG_FATAL("clock_gettime: negative tv_nsec!\n");
     return 1000*1000*1000*(xtime_t)ts.tv_sec + (xtime_t)ts.tv_nsec;
 }
+
+uint32_t kvp_hash(const dstr_t key){
+    uint32_t h = KVP_HASH_INIT;
+    for(size_t i = 0; i < key.len; i++){
+        h = kvp_hash_step(h, key.data[i]);
+    }
+    return h;
+}
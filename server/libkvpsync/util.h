@@ -6,3 +6,13 @@ typedef uint64_t xtime_t;
 #define XTIME_MAX UINT64_MAX
 
 xtime_t xtime(void);
+
+/* FNV-1a, which can be computed one byte at a time, so that the dns server can
+   hash a username while it reads it out of a packet */
+#define KVP_HASH_INIT ((uint32_t)2166136261U)
+
+static inline uint32_t kvp_hash_step(uint32_t h, char c){
+    return (h ^ (uint8_t)c) * (uint32_t)16777619U;
+}
+
+uint32_t kvp_hash(const dstr_t key);
@@ -343,7 +343,7 @@ derr_t valid_splintermail_password(const dstr_t pass){
 // predefined queries
 
 derr_t get_uuid_for_email(
-    MYSQL *sql, const dstr_t email, dstr_t *uuid, bool *ok
+    sql_t *sql, const dstr_t email, dstr_t *uuid, bool *ok
 ){
     derr_t e = E_OK;
     *ok = false;
@@ -367,7 +367,7 @@ derr_t get_uuid_for_email(
 }
 
 derr_t get_email_for_uuid(
-    MYSQL *sql, const dstr_t uuid, dstr_t *email, bool *ok
+    sql_t *sql, const dstr_t uuid, dstr_t *email, bool *ok
 ){
     derr_t e = E_OK;
     if(email->size < SMSQL_EMAIL_SIZE){
@@ -418,7 +418,7 @@ void smsql_alias_free(smsql_alias_t **old){
     *old = NULL;
 }
 
-derr_t list_aliases(MYSQL *sql, const dstr_t uuid, link_t *out){
+derr_t list_aliases(sql_t *sql, const dstr_t uuid, link_t *out){
     derr_t e = E_OK;
 
     MYSQL_STMT *stmt;
@@ -461,7 +461,7 @@ derr_t list_aliases(MYSQL *sql, const dstr_t uuid, link_t *out){
     // set the output
     link_list_append_list(out, &list);
 
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
 
     return e;
 
@@ -470,12 +470,12 @@ fail_list:
         smsql_alias_t *alias = CONTAINER_OF(link, smsql_alias_t, link);
         smsql_alias_free(&alias);
     }
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
     return e;
 }
 
 static derr_t _add_random_alias_txn(
-    MYSQL *sql, const dstr_t uuid, dstr_t *alias
+    sql_t *sql, const dstr_t uuid, dstr_t *alias
 ){
     derr_t e = E_OK;
 
@@ -548,7 +548,7 @@ static derr_t _add_random_alias_txn(
 }
 
 // throws E_USERMSG if max aliases reached
-derr_t add_random_alias(MYSQL *sql, const dstr_t uuid, dstr_t *alias){
+derr_t add_random_alias(sql_t *sql, const dstr_t uuid, dstr_t *alias){
     derr_t e = E_OK;
 
     PROP(&e, sql_txn_start(sql) );
@@ -567,7 +567,7 @@ hard_fail:
 
 
 static derr_t _add_primary_alias_txn(
-    MYSQL *sql, const dstr_t uuid, const dstr_t alias
+    sql_t *sql, const dstr_t uuid, const dstr_t alias
 ){
     derr_t e = E_OK;
 
@@ -594,7 +594,7 @@ static derr_t _add_primary_alias_txn(
 }
 
 // throws E_USERMSG if alias is unavailable
-derr_t add_primary_alias(MYSQL *sql, const dstr_t uuid, const dstr_t alias){
+derr_t add_primary_alias(sql_t *sql, const dstr_t uuid, const dstr_t alias){
     derr_t e = E_OK;
 
     PROP(&e, valid_splintermail_email(alias) );
@@ -614,7 +614,7 @@ hard_fail:
 }
 
 static derr_t _delete_alias_txn(
-    MYSQL *sql, const dstr_t uuid, const dstr_t alias
+    sql_t *sql, const dstr_t uuid, const dstr_t alias
 ){
     derr_t e = E_OK;
 
@@ -649,7 +649,7 @@ static derr_t _delete_alias_txn(
     return e;
 }
 
-derr_t delete_alias(MYSQL *sql, const dstr_t uuid, const dstr_t alias){
+derr_t delete_alias(sql_t *sql, const dstr_t uuid, const dstr_t alias){
     derr_t e = E_OK;
 
     PROP(&e, sql_txn_start(sql) );
@@ -666,7 +666,7 @@ hard_fail:
     return e;
 }
 
-static derr_t _delete_all_aliases_txn(MYSQL *sql, const dstr_t uuid){
+static derr_t _delete_all_aliases_txn(sql_t *sql, const dstr_t uuid){
     derr_t e = E_OK;
 
     link_t *link;
@@ -707,7 +707,7 @@ cu:
     return e;
 }
 
-derr_t delete_all_aliases(MYSQL *sql, const dstr_t uuid){
+derr_t delete_all_aliases(sql_t *sql, const dstr_t uuid){
     derr_t e = E_OK;
 
     PROP(&e, sql_txn_start(sql) );
@@ -772,7 +772,7 @@ void smsql_dstr_free(smsql_dstr_t **old){
     *old = NULL;
 }
 
-derr_t list_device_fprs(MYSQL *sql, const dstr_t uuid, link_t *out){
+derr_t list_device_fprs(sql_t *sql, const dstr_t uuid, link_t *out){
     derr_t e = E_OK;
 
     MYSQL_STMT *stmt;
@@ -818,7 +818,7 @@ derr_t list_device_fprs(MYSQL *sql, const dstr_t uuid, link_t *out){
     // set the output
     link_list_append_list(out, &list);
 
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
 
     return e;
 
@@ -827,11 +827,11 @@ fail_list:
         smsql_dstr_t *dstr = CONTAINER_OF(link, smsql_dstr_t, link);
         smsql_dstr_free(&dstr);
     }
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
     return e;
 }
 
-derr_t list_device_keys(MYSQL *sql, const dstr_t uuid, link_t *out){
+derr_t list_device_keys(sql_t *sql, const dstr_t uuid, link_t *out){
     derr_t e = E_OK;
 
     MYSQL_STMT *stmt;
@@ -877,7 +877,7 @@ derr_t list_device_keys(MYSQL *sql, const dstr_t uuid, link_t *out){
     // set the output
     link_list_append_list(out, &list);
 
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
 
     return e;
 
@@ -886,12 +886,12 @@ fail_list:
         smsql_dstr_t *dstr = CONTAINER_OF(link, smsql_dstr_t, link);
         smsql_dstr_free(&dstr);
     }
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
     return e;
 }
 
 derr_t get_device(
-    MYSQL *sql, const dstr_t uuid, const dstr_t fpr, dstr_t *key, bool *ok
+    sql_t *sql, const dstr_t uuid, const dstr_t fpr, dstr_t *key, bool *ok
 ){
     derr_t e = E_OK;
     *ok = false;
@@ -916,7 +916,7 @@ derr_t get_device(
 }
 
 static derr_t _add_device_txn(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t uuid,
     const dstr_t pubkey,
     const dstr_t fpr_hex
@@ -987,10 +987,24 @@ cu:
     return e;
 }
 
+// let anyone watching device_changes know that this user's devices changed
+static derr_t _note_device_change(sql_t *sql, const dstr_t uuid){
+    derr_t e = E_OK;
+
+    DSTR_STATIC(
+        q1,
+        "INSERT INTO device_changes (user_uuid, created) "
+        "VALUES (?, UNIX_TIMESTAMP())"
+    );
+    PROP(&e, sql_norow_query(sql, q1, NULL, blob_bind_in(&uuid)) );
+
+    return e;
+}
+
 // take a PEM-encoded public key, validate it, and add it to an account
 // raises E_USERMSG on failure
 derr_t add_device(
-    MYSQL *sql, const dstr_t uuid, const dstr_t pubkey, dstr_t *fpr
+    sql_t *sql, const dstr_t uuid, const dstr_t pubkey, dstr_t *fpr
 ){
     derr_t e = E_OK;
 
@@ -1002,6 +1016,8 @@ derr_t add_device(
 
     PROP_GO(&e, _add_device_txn(sql, uuid, norm, fpr_hex), hard_fail);
 
+    PROP_GO(&e, _note_device_change(sql, uuid), hard_fail);
+
     PROP_GO(&e, dstr_append(fpr, &fpr_hex), hard_fail);
 
     PROP(&e, sql_txn_commit(sql) );
@@ -1014,7 +1030,9 @@ hard_fail:
     return e;
 }
 
-derr_t delete_device(MYSQL *sql, const dstr_t uuid, const dstr_t fpr_hex){
+static derr_t _delete_device_txn(
+    sql_t *sql, const dstr_t uuid, const dstr_t fpr_hex
+){
     derr_t e = E_OK;
 
     size_t affected;
@@ -1029,6 +1047,138 @@ derr_t delete_device(MYSQL *sql, const dstr_t uuid, const dstr_t fpr_hex){
         ORIG(&e, E_USERMSG, "no such device");
     }
 
+    PROP(&e, _note_device_change(sql, uuid) );
+
+    return e;
+}
+
+derr_t delete_device(sql_t *sql, const dstr_t uuid, const dstr_t fpr_hex){
+    derr_t e = E_OK;
+
+    PROP(&e, sql_txn_start(sql) );
+
+    PROP_GO(&e, _delete_device_txn(sql, uuid, fpr_hex), hard_fail);
+
+    PROP(&e, sql_txn_commit(sql) );
+
+    return e;
+
+hard_fail:
+    sql_txn_abort(sql);
+
+    return e;
+}
+
+derr_t get_device_change_seq(sql_t *sql, uint64_t *seq){
+    derr_t e = E_OK;
+
+    DSTR_STATIC(q1, "SELECT COALESCE(MAX(seq), 0) FROM device_changes");
+    PROP(&e, sql_onerow_query(sql, q1, NULL, uint64_bind_out(seq)) );
+
+    return e;
+}
+
+derr_t smsql_device_change_new(
+    smsql_device_change_t **out, uint64_t seq, const dstr_t uuid
+){
+    derr_t e = E_OK;
+    *out = NULL;
+
+    smsql_device_change_t *change = DMALLOC_STRUCT_PTR(&e, change);
+    CHECK(&e);
+
+    change->seq = seq;
+    link_init(&change->link);
+
+    PROP_GO(&e, dstr_copy(&uuid, &change->uuid), fail);
+
+    *out = change;
+    return e;
+
+fail:
+    free(change);
+    return e;
+}
+
+void smsql_device_change_free(smsql_device_change_t **old){
+    smsql_device_change_t *change = *old;
+    if(change == NULL) return;
+    dstr_free(&change->uuid);
+    free(change);
+    *old = NULL;
+}
+
+derr_t list_device_changes(sql_t *sql, uint64_t since, link_t *out){
+    derr_t e = E_OK;
+
+    MYSQL_STMT *stmt;
+
+    uint64_t seq_res;
+    DSTR_VAR(uuid_res, SMSQL_UUID_SIZE);
+
+    DSTR_STATIC(
+        q1,
+        "SELECT seq, user_uuid FROM device_changes WHERE seq > ? ORDER BY seq"
+    );
+    PROP(&e,
+        sql_multirow_stmt(
+            sql, &stmt, q1,
+            // parameters
+            uint64_bind_in(&since),
+            // results
+            uint64_bind_out(&seq_res),
+            blob_bind_out(&uuid_res)
+        )
+    );
+
+    link_t list;
+    link_init(&list);
+    link_t *link;
+
+    while(true){
+        bool ok;
+        PROP_GO(&e, sql_stmt_fetch(stmt, &ok), fail_list);
+        if(!ok) break;
+
+        smsql_device_change_t *change;
+        PROP_GO(&e,
+            smsql_device_change_new(&change, seq_res, uuid_res),
+        loop_fail);
+        link_list_append(&list, &change->link);
+
+        continue;
+
+    loop_fail:
+        sql_stmt_fetchall(stmt);
+        goto fail_list;
+    }
+
+    // set the output
+    link_list_append_list(out, &list);
+
+    sql_stmt_close(sql, stmt);
+
+    return e;
+
+fail_list:
+    while((link = link_list_pop_first(&list))){
+        smsql_device_change_t *change =
+            CONTAINER_OF(link, smsql_device_change_t, link);
+        smsql_device_change_free(&change);
+    }
+    sql_stmt_close(sql, stmt);
+    return e;
+}
+
+derr_t gc_device_changes(sql_t *sql, time_t now){
+    derr_t e = E_OK;
+
+    // time_t is signed so this can't underflow if now == 0
+    int64_t limit = now - SMSQL_DEVICE_CHANGES_TIMEOUT;
+
+    DSTR_STATIC(q1, "DELETE FROM device_changes WHERE created<?");
+    PROP(&e, sql_norow_query(sql, q1, NULL, int64_bind_in(&limit)) );
+
     return e;
 }
 
@@ -1056,7 +1206,7 @@ void smsql_uint_free(smsql_uint_t **old){
     *old = NULL;
 }
 
-derr_t list_tokens(MYSQL *sql, const dstr_t uuid, link_t *out){
+derr_t list_tokens(sql_t *sql, const dstr_t uuid, link_t *out){
     derr_t e = E_OK;
 
     MYSQL_STMT *stmt;
@@ -1102,7 +1252,7 @@ derr_t list_tokens(MYSQL *sql, const dstr_t uuid, link_t *out){
     // set the output
     link_list_append_list(out, &list);
 
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
 
     return e;
 
@@ -1111,7 +1261,7 @@ fail_list:
         smsql_uint_t *uint = CONTAINER_OF(link, smsql_uint_t, link);
         smsql_uint_free(&uint);
     }
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
     return e;
 }
 
@@ -1127,7 +1277,7 @@ static derr_t new_api_secret(dstr_t *secret){
 }
 
 derr_t add_token(
-    MYSQL *sql, const dstr_t uuid, uint32_t *token, dstr_t *secret
+    sql_t *sql, const dstr_t uuid, uint32_t *token, dstr_t *secret
 ){
     derr_t e = E_OK;
     *token = 0;
@@ -1165,7 +1315,7 @@ derr_t add_token(
 }
 
 
-derr_t delete_token(MYSQL *sql, const dstr_t uuid, uint32_t token){
+derr_t delete_token(sql_t *sql, const dstr_t uuid, uint32_t token){
     derr_t e = E_OK;
 
     size_t affected;
@@ -1186,7 +1336,7 @@ derr_t delete_token(MYSQL *sql, const dstr_t uuid, uint32_t token){
 // installations
 
 derr_t subdomain_user(
-    MYSQL *sql, const dstr_t subdomain, dstr_t *user_uuid, bool *ok
+    sql_t *sql, const dstr_t subdomain, dstr_t *user_uuid, bool *ok
 ){
     derr_t e = E_OK;
 
@@ -1215,7 +1365,7 @@ derr_t subdomain_user(
 }
 
 derr_t subdomain_installation(
-    MYSQL *sql, const dstr_t subdomain, dstr_t *inst_uuid, bool *ok
+    sql_t *sql, const dstr_t subdomain, dstr_t *inst_uuid, bool *ok
 ){
     derr_t e = E_OK;
 
@@ -1244,7 +1394,7 @@ derr_t subdomain_installation(
 }
 
 // populates out with subdomains (smsql_dstr_t's)
-derr_t list_installations(MYSQL *sql, const dstr_t user_uuid, link_t *out){
+derr_t list_installations(sql_t *sql, const dstr_t user_uuid, link_t *out){
     derr_t e = E_OK;
 
     MYSQL_STMT *stmt;
@@ -1288,7 +1438,7 @@ derr_t list_installations(MYSQL *sql, const dstr_t user_uuid, link_t *out){
     // set the output
     link_list_append_list(out, &list);
 
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
 
     return e;
 
@@ -1297,12 +1447,12 @@ fail_list:
         smsql_dstr_t *dstr = CONTAINER_OF(link, smsql_dstr_t, link);
         smsql_dstr_free(&dstr);
     }
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
     return e;
 }
 
 derr_t add_installation(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t user_uuid,
     dstr_t *inst_uuid,
     uint32_t *token,
@@ -1364,7 +1514,7 @@ derr_t add_installation(
 
 // a user manually decides to delete an installation tied to their account
 derr_t delete_installation(
-    MYSQL *sql, const dstr_t user_uuid, const dstr_t subdomain
+    sql_t *sql, const dstr_t user_uuid, const dstr_t subdomain
 ){
     derr_t e = E_OK;
 
@@ -1390,7 +1540,7 @@ derr_t delete_installation(
 }
 
 // an install token is used to delete itself
-derr_t delete_installation_by_token(MYSQL *sql, const dstr_t inst_uuid){
+derr_t delete_installation_by_token(sql_t *sql, const dstr_t inst_uuid){
     derr_t e = E_OK;
 
     size_t affected;
@@ -1403,7 +1553,7 @@ derr_t delete_installation_by_token(MYSQL *sql, const dstr_t inst_uuid){
     return e;
 }
 
-derr_t set_challenge(MYSQL *sql, const dstr_t inst_uuid, const dstr_t text){
+derr_t set_challenge(sql_t *sql, const dstr_t inst_uuid, const dstr_t text){
     derr_t e = E_OK;
 
     if(text.len > SMSQL_CHALLENGE_SIZE){
@@ -1424,7 +1574,7 @@ derr_t set_challenge(MYSQL *sql, const dstr_t inst_uuid, const dstr_t text){
     return e;
 }
 
-derr_t delete_challenge(MYSQL *sql, const dstr_t inst_uuid){
+derr_t delete_challenge(sql_t *sql, const dstr_t inst_uuid){
     derr_t e = E_OK;
 
     DSTR_STATIC(q1,
@@ -1438,7 +1588,7 @@ derr_t delete_challenge(MYSQL *sql, const dstr_t inst_uuid){
 }
 
 derr_t get_installation_challenge(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t inst_uuid,
     dstr_t *subdomain,
     bool *subdomain_ok,
@@ -1477,10 +1627,10 @@ derr_t get_installation_challenge(
     return e;
 }
 
-derr_t challenges_first(challenge_iter_t *it, MYSQL *sql){
+derr_t challenges_first(challenge_iter_t *it, sql_t *sql){
     derr_t e = E_OK;
 
-    *it = (challenge_iter_t){ .ok = true };
+    *it = (challenge_iter_t){ .ok = true, ._sql = sql };
     DSTR_WRAP_ARRAY(it->subdomain, it->_subdomainbuf);
     DSTR_WRAP_ARRAY(it->challenge, it->_challengebuf);
 
@@ -1526,7 +1676,7 @@ void challenges_free(challenge_iter_t *it){
         sql_stmt_fetchall(it->_stmt);
         it->_inloop = false;
     }
-    mysql_stmt_close(it->_stmt);
+    sql_stmt_close(it->_sql, it->_stmt);
     it->_stmt = NULL;
 }
 
@@ -1559,7 +1709,7 @@ void smsql_dpair_free(smsql_dpair_t **old){
     *old = NULL;
 }
 
-derr_t list_challenges(MYSQL *sql, link_t *out){
+derr_t list_challenges(sql_t *sql, link_t *out){
     derr_t e = E_OK;
 
     link_t list = {0};
@@ -1591,7 +1741,7 @@ cu:
 // misc
 
 static derr_t _create_account_txn(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t email,
     const dstr_t pass_hash,
     const dstr_t uuid
@@ -1626,7 +1776,7 @@ static derr_t _create_account_txn(
 
 // throws E_USERMSG if email is taken
 derr_t create_account(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t email,
     const dstr_t pass,
     dstr_t *uuid
@@ -1660,7 +1810,7 @@ hard_fail:
     return e;
 }
 
-static derr_t _delete_account_txn(MYSQL *sql, const dstr_t uuid){
+static derr_t _delete_account_txn(sql_t *sql, const dstr_t uuid){
     derr_t e = E_OK;
 
     // start by getting this uuid's email, with FOR UPDATE
@@ -1701,6 +1851,7 @@ static derr_t _delete_account_txn(MYSQL *sql, const dstr_t uuid){
     {
         DSTR_STATIC(q, "DELETE FROM devices WHERE user_uuid = ?");
         PROP(&e, sql_norow_query(sql, q, NULL, blob_bind_in(&uuid)) );
+        PROP(&e, _note_device_change(sql, uuid) );
     }
 
     {
@@ -1718,7 +1869,7 @@ static derr_t _delete_account_txn(MYSQL *sql, const dstr_t uuid){
 
 // gateway is responsible for ensuring a password is provided
 // gateway is also responsible for calling trigger_deleter(), below
-derr_t delete_account(MYSQL *sql, const dstr_t uuid){
+derr_t delete_account(sql_t *sql, const dstr_t uuid){
     derr_t e = E_OK;
 
     PROP(&e, sql_txn_start(sql) );
@@ -1736,7 +1887,7 @@ hard_fail:
 }
 
 derr_t account_info(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t uuid,
     size_t *num_devices,
     size_t *num_primary_aliases,
@@ -1776,7 +1927,7 @@ derr_t account_info(
 
 // validate a password for a user against the database
 derr_t validate_user_password(
-    MYSQL *sql, const dstr_t uuid, const dstr_t pass, bool *ok
+    sql_t *sql, const dstr_t uuid, const dstr_t pass, bool *ok
 ){
     derr_t e = E_OK;
     *ok = false;
@@ -1801,7 +1952,7 @@ derr_t validate_user_password(
 
 // returns uuid or throws E_USERMSG on failure
 derr_t validate_login(
-    MYSQL *sql, const dstr_t email, const dstr_t pass, dstr_t *uuid
+    sql_t *sql, const dstr_t email, const dstr_t pass, dstr_t *uuid
 ){
     derr_t e = E_OK;
 
@@ -1820,7 +1971,7 @@ derr_t validate_login(
 }
 
 static derr_t _validate_token_auth_txn(
-    MYSQL *sql,
+    sql_t *sql,
     uint32_t token,
     uint64_t nonce,
     const dstr_t payload,
@@ -1884,7 +2035,7 @@ static derr_t _validate_token_auth_txn(
    responsibility of the gateway */
 // raises E_USERMSG on error
 derr_t validate_token_auth(
-    MYSQL *sql,
+    sql_t *sql,
     uint32_t token,
     uint64_t nonce,
     const dstr_t payload,
@@ -1910,7 +2061,7 @@ hard_fail:
 }
 
 static derr_t _validate_installation_auth_txn(
-    MYSQL *sql,
+    sql_t *sql,
     uint32_t token,
     uint64_t nonce,
     const dstr_t payload,
@@ -1976,7 +2127,7 @@ static derr_t _validate_installation_auth_txn(
    responsibility of the gateway */
 // raises E_USERMSG on error
 derr_t validate_installation_auth(
-    MYSQL *sql,
+    sql_t *sql,
     uint32_t token,
     uint64_t nonce,
     const dstr_t payload,
@@ -2003,7 +2154,7 @@ hard_fail:
 
 // the gateway should enforce a valid old password is provided first
 // throws E_USERMSG on invalid password
-derr_t change_password(MYSQL *sql, const dstr_t uuid, const dstr_t pass){
+derr_t change_password(sql_t *sql, const dstr_t uuid, const dstr_t pass){
     derr_t e = E_OK;
 
     PROP(&e, valid_splintermail_password(pass) );
@@ -2029,7 +2180,7 @@ derr_t change_password(MYSQL *sql, const dstr_t uuid, const dstr_t pass){
 // uses time() for the login and last_seen times
 // this implies that you should always create a fresh session_id on login
 derr_t add_session_auth(
-    MYSQL *sql, int server_id, const dstr_t session_id, const dstr_t uuid
+    sql_t *sql, int server_id, const dstr_t session_id, const dstr_t uuid
 ){
     derr_t e = E_OK;
 
@@ -2061,7 +2212,7 @@ derr_t add_session_auth(
    timeout, by _validate_session_auth, to ensure that a logout decision is
    final */
 static derr_t _do_logout_txn(
-    MYSQL *sql,
+    sql_t *sql,
     int server_id,
     const dstr_t session_id,
     const dstr_t uuid,
@@ -2108,7 +2259,7 @@ static derr_t _do_logout_txn(
 
 
 static derr_t _session_logout_txn(
-    MYSQL *sql,
+    sql_t *sql,
     int server_id,
     const dstr_t session_id,
     time_t now
@@ -2167,12 +2318,12 @@ static derr_t _session_logout_txn(
     cu);
 
 cu:
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
 
     return e;
 }
 
-derr_t session_logout(MYSQL *sql, int server_id, const dstr_t session_id){
+derr_t session_logout(sql_t *sql, int server_id, const dstr_t session_id){
     derr_t e = E_OK;
 
     time_t now;
@@ -2195,7 +2346,7 @@ hard_fail:
 }
 
 static derr_t _validate_session_auth_txn(
-    MYSQL *sql,
+    sql_t *sql,
     int server_id,
     const dstr_t session_id,
     time_t now,
@@ -2309,7 +2460,7 @@ static derr_t _validate_session_auth_txn(
     PROP_GO(&e, dstr_append(uuid, &uuid_res), cu);
 
 cu:
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
 
     return e;
 }
@@ -2325,7 +2476,7 @@ cu:
    of the session */
 // throws E_USERMSG on bad sessions
 derr_t validate_session_auth(
-    MYSQL *sql, int server_id, const dstr_t session_id, dstr_t *uuid
+    sql_t *sql, int server_id, const dstr_t session_id, dstr_t *uuid
 ){
     derr_t e = E_OK;
 
@@ -2350,7 +2501,7 @@ hard_fail:
 
 // new_csrf returns a token you can embed in a webpage
 derr_t new_csrf(
-    MYSQL *sql, int server_id, const dstr_t session_id, dstr_t *csrf
+    sql_t *sql, int server_id, const dstr_t session_id, dstr_t *csrf
 ){
     derr_t e = E_OK;
 
@@ -2386,7 +2537,7 @@ derr_t new_csrf(
 
 // validate_csrf() just checks if the token was valid for this session
 // throws E_USERMSG on bad tokens
-derr_t validate_csrf(MYSQL *sql, const dstr_t session_id, const dstr_t csrf){
+derr_t validate_csrf(sql_t *sql, const dstr_t session_id, const dstr_t csrf){
     derr_t e = E_OK;
 
     time_t now;
@@ -2415,7 +2566,7 @@ derr_t validate_csrf(MYSQL *sql, const dstr_t session_id, const dstr_t csrf){
 
 // returns true if uuid/address matches accounts.email or aliases.alias
 derr_t user_owns_address(
-    MYSQL *sql, const dstr_t uuid, const dstr_t address, bool *ok
+    sql_t *sql, const dstr_t uuid, const dstr_t address, bool *ok
 ){
     derr_t e = E_OK;
     *ok = false;
@@ -2444,7 +2595,7 @@ derr_t user_owns_address(
 }
 
 static derr_t _limit_check_txn(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t uuid,
     unsigned int recipients,
     bool *ok,
@@ -2506,7 +2657,7 @@ static derr_t _limit_check_txn(
    msg_sent both come back false it is the caller's responsibility to send
    the limit message. */
 derr_t limit_check(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t uuid,
     unsigned int recipients,
     bool *ok,
@@ -2534,7 +2685,7 @@ hard_fail:
     return e;
 }
 
-derr_t gtid_current_pos(MYSQL *sql, dstr_t *out){
+derr_t gtid_current_pos(sql_t *sql, dstr_t *out){
     derr_t e = E_OK;
 
     DSTR_STATIC(query, "SELECT @@gtid_current_pos");
@@ -2545,7 +2696,7 @@ derr_t gtid_current_pos(MYSQL *sql, dstr_t *out){
     return e;
 }
 
-static derr_t _trigger_deleter_txn(MYSQL *sql, const dstr_t uuid){
+static derr_t _trigger_deleter_txn(sql_t *sql, const dstr_t uuid){
     derr_t e = E_OK;
 
     // read servers.conf
@@ -2580,7 +2731,7 @@ static derr_t _trigger_deleter_txn(MYSQL *sql, const dstr_t uuid){
 /* AFTER deleting an account, it is safe to try to trigger the deletions
    service.  It is expected that the caller is tolerant of errors, since they
    are often not fatal; the deleter will periodically GC any stray files. */
-derr_t trigger_deleter(MYSQL *sql, const dstr_t uuid){
+derr_t trigger_deleter(sql_t *sql, const dstr_t uuid){
     derr_t e = E_OK;
 
     PROP(&e, sql_txn_start(sql) );
@@ -2598,7 +2749,7 @@ hard_fail:
 }
 
 // returns a list of uuids to delete (smsql_dstr_t's)
-derr_t list_deletions(MYSQL *sql, int server_id, link_t *out){
+derr_t list_deletions(sql_t *sql, int server_id, link_t *out){
     derr_t e = E_OK;
 
     MYSQL_STMT *stmt;
@@ -2639,7 +2790,7 @@ derr_t list_deletions(MYSQL *sql, int server_id, link_t *out){
     // set the output
     link_list_append_list(out, &list);
 
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
 
     return e;
 
@@ -2648,12 +2799,12 @@ fail_list:
         smsql_dstr_t *uuid = CONTAINER_OF(link, smsql_dstr_t, link);
         smsql_dstr_free(&uuid);
     }
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
     return e;
 }
 
 // remove a deletions entry for this server_id
-derr_t deletions_finished_one(MYSQL *sql, int server_id, const dstr_t uuid){
+derr_t deletions_finished_one(sql_t *sql, int server_id, const dstr_t uuid){
     derr_t e = E_OK;
 
     DSTR_STATIC(q1,
@@ -2671,7 +2822,7 @@ derr_t deletions_finished_one(MYSQL *sql, int server_id, const dstr_t uuid){
     return e;
 }
 
-derr_t gc_sessions_and_csrf(MYSQL *sql, int server_id, time_t now){
+derr_t gc_sessions_and_csrf(sql_t *sql, int server_id, time_t now){
     derr_t e = E_OK;
 
     // time_t is signed so this can't underflow if now == 0
@@ -2705,7 +2856,7 @@ derr_t gc_sessions_and_csrf(MYSQL *sql, int server_id, time_t now){
 // sysadmin utils
 
 // returns a list of smsql_dstr_t's
-derr_t list_users(MYSQL *sql, link_t *out){
+derr_t list_users(sql_t *sql, link_t *out){
     derr_t e = E_OK;
 
     MYSQL_STMT *stmt;
@@ -2744,7 +2895,7 @@ derr_t list_users(MYSQL *sql, link_t *out){
     // set the output
     link_list_append_list(out, &list);
 
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
 
     return e;
 
@@ -2753,6 +2904,6 @@ fail_list:
         smsql_dstr_t *dstr = CONTAINER_OF(link, smsql_dstr_t, link);
         smsql_dstr_free(&dstr);
     }
-    mysql_stmt_close(stmt);
+    sql_stmt_close(sql, stmt);
     return e;
 }
@@ -81,15 +81,17 @@ derr_t valid_splintermail_password(const dstr_t pass);
 #define SMSQL_CSRF_RANDOM_BYTES 33
 #define SMSQL_CSRF_SIZE 44
 #define SMSQL_CSRF_TIMEOUT (24*60*60)
+// device_changes only need to outlive the XKEYSYNC poll interval
+#define SMSQL_DEVICE_CHANGES_TIMEOUT (60*60)
 #define SMSQL_SUBDOMAIN_SIZE 8
 #define SMSQL_CHALLENGE_SIZE 255
 
 derr_t get_uuid_for_email(
-    MYSQL *sql, const dstr_t email, dstr_t *uuid, bool *ok
+    sql_t *sql, const dstr_t email, dstr_t *uuid, bool *ok
 );
 
 derr_t get_email_for_uuid(
-    MYSQL *sql, const dstr_t uuid, dstr_t *email, bool *ok
+    sql_t *sql, const dstr_t uuid, dstr_t *email, bool *ok
 );
 
 // aliases
@@ -105,18 +107,18 @@ derr_t smsql_alias_new(smsql_alias_t **out, const dstr_t email, bool paid);
 void smsql_alias_free(smsql_alias_t **old);
 
 // returns a list of smsql_alias_t's
-derr_t list_aliases(MYSQL *sql, const dstr_t uuid, link_t *out);
+derr_t list_aliases(sql_t *sql, const dstr_t uuid, link_t *out);
 
 // throws E_USERMSG if max aliases reached
-derr_t add_random_alias(MYSQL *sql, const dstr_t uuid, dstr_t *alias);
+derr_t add_random_alias(sql_t *sql, const dstr_t uuid, dstr_t *alias);
 
 // throws E_USERMSG if alias is unavailable
-derr_t add_primary_alias(MYSQL *sql, const dstr_t uuid, const dstr_t alias);
+derr_t add_primary_alias(sql_t *sql, const dstr_t uuid, const dstr_t alias);
 
 // throws E_USERMSG if no alias matched
-derr_t delete_alias(MYSQL *sql, const dstr_t uuid, const dstr_t alias);
+derr_t delete_alias(sql_t *sql, const dstr_t uuid, const dstr_t alias);
 
-derr_t delete_all_aliases(MYSQL *sql, const dstr_t uuid);
+derr_t delete_all_aliases(sql_t *sql, const dstr_t uuid);
 
 // devices
 
@@ -132,25 +134,55 @@ void smsql_dstr_free(smsql_dstr_t **old);
 
 /* returns a list of hex-encoded fingerprints (smsql_dstr_t's), ordered
    by fingerprint */
-derr_t list_device_fprs(MYSQL *sql, const dstr_t uuid, link_t *out);
+derr_t list_device_fprs(sql_t *sql, const dstr_t uuid, link_t *out);
 
 /* returns a list of pem-encoded public keys (smsql_dstr_t's), ordered
    by fingerprint */
-derr_t list_device_keys(MYSQL *sql, const dstr_t uuid, link_t *out);
+derr_t list_device_keys(sql_t *sql, const dstr_t uuid, link_t *out);
 
 // returns a user's device identified by a particular fingerprint
 derr_t get_device(
-    MYSQL *sql, const dstr_t uuid, const dstr_t fpr, dstr_t *key, bool *ok
+    sql_t *sql, const dstr_t uuid, const dstr_t fpr, dstr_t *key, bool *ok
 );
 
 // take a PEM-encoded public key, validate it, and add it to an account
 // raises E_USERMSG on invalid or duplicate key
 derr_t add_device(
-    MYSQL *sql, const dstr_t uuid, const dstr_t pubkey, dstr_t *fpr
+    sql_t *sql, const dstr_t uuid, const dstr_t pubkey, dstr_t *fpr
 );
 
 // throws E_USERMSG if no device matched
-derr_t delete_device(MYSQL *sql, const dstr_t uuid, const dstr_t fpr_hex);
+derr_t delete_device(sql_t *sql, const dstr_t uuid, const dstr_t fpr_hex);
+
+/* device_changes is an append-only log of which users' devices changed, so
+   watchers can poll one table instead of every user's devices */
+
+// the current high-water mark of device_changes (0 if empty)
+derr_t get_device_change_seq(sql_t *sql, uint64_t *seq);
+
+typedef struct {
+    uint64_t seq;
+    dstr_t uuid;
+    link_t link;
+} smsql_device_change_t;
+DEF_CONTAINER_OF(smsql_device_change_t, link, link_t)
+
+derr_t smsql_device_change_new(
+    smsql_device_change_t **out, uint64_t seq, const dstr_t uuid
+);
+void smsql_device_change_free(smsql_device_change_t **old);
+
+/* returns a list of device_changes rows (smsql_device_change_t's, ordered by
+   seq) with seq after the since seq.
+
+   seq is auto_increment, so it is assigned at INSERT but visible only after
+   COMMIT, and a row with a lower seq than one already seen can still appear.
+   Callers which care about such late commits should remember the seqs they
+   skipped over and pass a since below the lowest one. */
+derr_t list_device_changes(sql_t *sql, uint64_t since, link_t *out);
+
+// delete device_changes entries older than SMSQL_DEVICE_CHANGES_TIMEOUT
+derr_t gc_device_changes(sql_t *sql, time_t now);
 
 // tokens
 
@@ -163,30 +195,30 @@ DEF_CONTAINER_OF(smsql_uint_t, link, link_t)
 derr_t smsql_uint_new(smsql_uint_t **out, uint32_t val);
 void smsql_uint_free(smsql_uint_t **old);
 
-derr_t list_tokens(MYSQL *sql, const dstr_t uuid, link_t *out);
+derr_t list_tokens(sql_t *sql, const dstr_t uuid, link_t *out);
 
 derr_t add_token(
-    MYSQL *sql, const dstr_t uuid, uint32_t *token, dstr_t *secret
+    sql_t *sql, const dstr_t uuid, uint32_t *token, dstr_t *secret
 );
 
 // throws E_USERMSG if no token matched
-derr_t delete_token(MYSQL *sql, const dstr_t uuid, uint32_t token);
+derr_t delete_token(sql_t *sql, const dstr_t uuid, uint32_t token);
 
 // installations
 
 derr_t subdomain_user(
-    MYSQL *sql, const dstr_t subdomain, dstr_t *user_uuid, bool *ok
+    sql_t *sql, const dstr_t subdomain, dstr_t *user_uuid, bool *ok
 );
 
 derr_t subdomain_installation(
-    MYSQL *sql, const dstr_t subdomain, dstr_t *inst_uuid, bool *ok
+    sql_t *sql, const dstr_t subdomain, dstr_t *inst_uuid, bool *ok
 );
 
 // populates out with subdomains (smsql_dstr_t's)
-derr_t list_installations(MYSQL *sql, const dstr_t user_uuid, link_t *out);
+derr_t list_installations(sql_t *sql, const dstr_t user_uuid, link_t *out);
 
 derr_t add_installation(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t user_uuid,
     dstr_t *inst_uuid,
     uint32_t *token,
@@ -197,18 +229,18 @@ derr_t add_installation(
 
 // a user manually decides to delete an installation tied to their account
 derr_t delete_installation(
-    MYSQL *sql, const dstr_t user_uuid, const dstr_t subdomain
+    sql_t *sql, const dstr_t user_uuid, const dstr_t subdomain
 );
 
 // an install token is used to delete itself
-derr_t delete_installation_by_token(MYSQL *sql, const dstr_t inst_uuid);
+derr_t delete_installation_by_token(sql_t *sql, const dstr_t inst_uuid);
 
-derr_t set_challenge(MYSQL *sql, const dstr_t inst_uuid, const dstr_t text);
+derr_t set_challenge(sql_t *sql, const dstr_t inst_uuid, const dstr_t text);
 
-derr_t delete_challenge(MYSQL *sql, const dstr_t inst_uuid);
+derr_t delete_challenge(sql_t *sql, const dstr_t inst_uuid);
 
 derr_t get_installation_challenge(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t inst_uuid,
     dstr_t *subdomain,
     bool *subdomain_ok,
@@ -236,13 +268,14 @@ typedef struct {
     dstr_t challenge;
     bool ok;
     // private
+    sql_t *_sql;
     MYSQL_STMT *_stmt;
     char _subdomainbuf[SMSQL_SUBDOMAIN_SIZE];
     char _challengebuf[SMSQL_CHALLENGE_SIZE];
     bool _inloop;
 } challenge_iter_t;
 
-derr_t challenges_first(challenge_iter_t *it, MYSQL *sql);
+derr_t challenges_first(challenge_iter_t *it, sql_t *sql);
 derr_t challenges_next(challenge_iter_t *it);
 void challenges_free(challenge_iter_t *it);
 
@@ -257,13 +290,13 @@ derr_t smsql_dpair_new(smsql_dpair_t **out, const dstr_t a, const dstr_t b);
 void smsql_dpair_free(smsql_dpair_t **old);
 
 // returns a list of smsql_dpair_t's, sorted by subdomain
-derr_t list_challenges(MYSQL *sql, link_t *out);
+derr_t list_challenges(sql_t *sql, link_t *out);
 
 // misc
 
 // throws E_USERMSG on failure
 derr_t create_account(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t email,
     const dstr_t pass,
     dstr_t *uuid
@@ -271,10 +304,10 @@ derr_t create_account(
 
 // gateway is responsible for ensuring a password is provided first
 // gateway is also responsible for calling trigger_deleter(), below
-derr_t delete_account(MYSQL *sql, const dstr_t uuid);
+derr_t delete_account(sql_t *sql, const dstr_t uuid);
 
 derr_t account_info(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t uuid,
     size_t *num_devices,
     size_t *num_primary_aliases,
@@ -283,12 +316,12 @@ derr_t account_info(
 
 // validate a password for a user against the database
 derr_t validate_user_password(
-    MYSQL *sql, const dstr_t uuid, const dstr_t pass, bool *ok
+    sql_t *sql, const dstr_t uuid, const dstr_t pass, bool *ok
 );
 
 // returns uuid or throws E_USERMSG on failure
 derr_t validate_login(
-    MYSQL *sql, const dstr_t email, const dstr_t pass, dstr_t *uuid
+    sql_t *sql, const dstr_t email, const dstr_t pass, dstr_t *uuid
 );
 
 // validate a token against the database, returning uuid
@@ -297,7 +330,7 @@ derr_t validate_login(
    responsibility of the gateway */
 // raises E_USERMSG on error
 derr_t validate_token_auth(
-    MYSQL *sql,
+    sql_t *sql,
     uint32_t token,
     uint64_t nonce,
     const dstr_t payload,
@@ -312,7 +345,7 @@ derr_t validate_token_auth(
    responsibility of the gateway */
 // raises E_USERMSG on error
 derr_t validate_installation_auth(
-    MYSQL *sql,
+    sql_t *sql,
     uint32_t token,
     uint64_t nonce,
     const dstr_t payload,
@@ -322,16 +355,16 @@ derr_t validate_installation_auth(
 
 // the gateway should enforce a valid old password is provided first
 // throws E_USERMSG on invalid password
-derr_t change_password(MYSQL *sql, const dstr_t uuid, const dstr_t pass);
+derr_t change_password(sql_t *sql, const dstr_t uuid, const dstr_t pass);
 
 // uses time() for the login and last_seen times.
 /* this API implies that you should always create a fresh session_id on login
    (which is already a mandatory practice to avoid session fixation attacks) */
 derr_t add_session_auth(
-    MYSQL *sql, int server_id, const dstr_t session_id, const dstr_t uuid
+    sql_t *sql, int server_id, const dstr_t session_id, const dstr_t uuid
 );
 
-derr_t session_logout(MYSQL *sql, int server_id, const dstr_t session_id);
+derr_t session_logout(sql_t *sql, int server_id, const dstr_t session_id);
 
 /* check if a session id is valid, and get the user_uuid if it is.
    valid sessions meet the following criteria:
@@ -344,21 +377,21 @@ derr_t session_logout(MYSQL *sql, int server_id, const dstr_t session_id);
    of the session */
 // throws E_USERMSG on bad sessions
 derr_t validate_session_auth(
-    MYSQL *sql, int server_id, const dstr_t session_id, dstr_t *uuid
+    sql_t *sql, int server_id, const dstr_t session_id, dstr_t *uuid
 );
 
 // new_csrf returns a token you can embed in a webpage
 derr_t new_csrf(
-    MYSQL *sql, int server_id, const dstr_t session_id, dstr_t *csrf
+    sql_t *sql, int server_id, const dstr_t session_id, dstr_t *csrf
 );
 
 // validate_csrf() just checks if the token was valid for this session
 // throws E_USERMSG on bad tokens
-derr_t validate_csrf(MYSQL *sql, const dstr_t session_id, const dstr_t csrf);
+derr_t validate_csrf(sql_t *sql, const dstr_t session_id, const dstr_t csrf);
 
 // returns true if uuid/address matches accounts.email or aliases.alias
 derr_t user_owns_address(
-    MYSQL *sql, const dstr_t uuid, const dstr_t address, bool *ok
+    sql_t *sql, const dstr_t uuid, const dstr_t address, bool *ok
 );
 
 /* This will atomically check if the user is allowed to send to this many
@@ -371,7 +404,7 @@ derr_t user_owns_address(
    msg_sent both come back false it is the caller's responsibility to send
    the limit message. */
 derr_t limit_check(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t uuid,
     unsigned int recipients,
     bool *ok,
@@ -381,24 +414,24 @@ derr_t limit_check(
 
 // used by health-check-service (hcs)
 // out must be pre-allocated
-derr_t gtid_current_pos(MYSQL *sql, dstr_t *out);
+derr_t gtid_current_pos(sql_t *sql, dstr_t *out);
 
 /* AFTER deleting an account, it is safe to try to trigger the deletions
    service.  It is expected that the caller is tolerant of errors, since they
    are often not fatal; the deleter will periodically GC any stray files. */
-derr_t trigger_deleter(MYSQL *sql, const dstr_t uuid);
+derr_t trigger_deleter(sql_t *sql, const dstr_t uuid);
 
 // returns a list of uuids to delete (smsql_dstr_t's)
-derr_t list_deletions(MYSQL *sql, int server_id, link_t *out);
+derr_t list_deletions(sql_t *sql, int server_id, link_t *out);
 
 // remove a deletions entry for this server_id
-derr_t deletions_finished_one(MYSQL *sql, int server_id, const dstr_t uuid);
+derr_t deletions_finished_one(sql_t *sql, int server_id, const dstr_t uuid);
 
-derr_t gc_sessions_and_csrf(MYSQL *sql, int server_id, time_t now);
+derr_t gc_sessions_and_csrf(sql_t *sql, int server_id, time_t now);
 
 // sysadmin utils
 
 // returns a list of smsql_dstr_t's
-derr_t list_users(MYSQL *sql, link_t *out);
+derr_t list_users(sql_t *sql, link_t *out);
 
 #endif // SM_SQL_H
@@ -361,7 +361,7 @@ static void limit_migrations(jsw_atree_t *tree, unsigned int tgt){
 /////////// sql logic
 
 
-static derr_t mig_bootstrap(MYSQL *sql){
+static derr_t mig_bootstrap(sql_t *sql){
     derr_t e = E_OK;
 
     // ensure migmysql table exists
@@ -381,7 +381,7 @@ static derr_t mig_bootstrap(MYSQL *sql){
 }
 
 
-static derr_t mig_override(MYSQL *sql, const dstr_t *path){
+static derr_t mig_override(sql_t *sql, const dstr_t *path){
     derr_t e = E_OK;
 
     dstr_t base = dbasename(*path);
@@ -419,7 +419,7 @@ cu:
 }
 
 
-static derr_t get_mig_states(MYSQL *sql, jsw_atree_t *states){
+static derr_t get_mig_states(sql_t *sql, jsw_atree_t *states){
     derr_t e = E_OK;
 
     PROP(&e,
@@ -580,7 +580,7 @@ cu_file:
 
 
 static derr_t migmysql_apply_one(
-    const config_t *config, MYSQL *sql, migration_t *up, migration_t *dn
+    const config_t *config, sql_t *sql, migration_t *up, migration_t *dn
 ){
     derr_t e = E_OK;
 
@@ -622,7 +622,7 @@ cu:
 }
 
 static derr_t migmysql_undo_one(
-    const config_t *config, MYSQL *sql, state_t *state
+    const config_t *config, sql_t *sql, state_t *state
 ){
     derr_t e = E_OK;
 
@@ -658,7 +658,7 @@ cu:
 
 static derr_t migmysql_apply(
     const config_t *config,
-    MYSQL *sql,
+    sql_t *sql,
     jsw_atree_t *ups,
     jsw_atree_t *dns,
     jsw_atree_t *states
@@ -698,7 +698,7 @@ static derr_t migmysql(const config_t *config){
 
     PROP(&e, dmysql_library_init() );
 
-    MYSQL sql;
+    sql_t sql;
     PROP_GO(&e, dmysql_init(&sql), cu_sql_lib);
 
     PROP_GO(&e,
@@ -749,7 +749,7 @@ cu_migrations:
     }
 
 cu_sql:
-    mysql_close(&sql);
+    sql_close(&sql);
 
 cu_sql_lib:
     mysql_library_end();
@@ -0,0 +1,12 @@
+-- Every change to a user's devices appends a row here, so that the XKEYSYNC
+-- plugin can watch for key changes with a single query per dovecot process,
+-- rather than re-reading the devices table for every connected client.
+--
+-- Rows are only useful for a short time, and gc_sessions prunes old ones.
+create table device_changes (
+    seq bigint(20) unsigned auto_increment primary key,
+    user_uuid binary(32) not null,
+    -- unix epoch, for garbage collection
+    created bigint(20) not null,
+    index (created)
+);
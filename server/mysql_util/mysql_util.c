@@ -13,8 +13,8 @@
 #define TRACE_SQL(e, sql) \
     TRACE((e), \
         "mysql_error(%x): %x\n", \
-        FU(mysql_errno((sql))), \
-        FSQL(sql) \
+        FU(mysql_errno(&(sql)->mysql)), \
+        FSQL(&(sql)->mysql) \
     )
 
 REGISTER_ERROR_TYPE(E_SQL, "SQLERROR", "error from sql");
@@ -27,8 +27,8 @@ static derr_type_t _read_errno(unsigned int err){
     return E_SQL;
 }
 
-static derr_type_t sql_err(MYSQL *sql){
-    return _read_errno(mysql_errno(sql));
+static derr_type_t sql_err(sql_t *sql){
+    return _read_errno(mysql_errno(&sql->mysql));
 }
 
 static derr_type_t stmt_err(MYSQL_STMT *stmt){
@@ -57,17 +57,22 @@ derr_t dmysql_library_init(void){
     return e;
 }
 
-derr_t dmysql_init(MYSQL *sql){
+derr_t dmysql_init(sql_t *sql){
     derr_t e = E_OK;
 
-    MYSQL* mret = mysql_init(sql);
+    sql->conn = NULL;
+    MYSQL* mret = mysql_init(&sql->mysql);
     if(!mret) ORIG(&e, E_SQL, "unable to init mysql object");
 
     return e;
 }
 
+void sql_close(sql_t *sql){
+    mysql_close(&sql->mysql);
+}
+
 derr_t sql_connect_unix_ex(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t *user,
     const dstr_t *pass,
     const dstr_t *sock,
@@ -115,7 +120,7 @@ derr_t sql_connect_unix_ex(
     char *null_host = NULL;
 
     MYSQL *mret = mysql_real_connect(
-        sql, null_host, sqluser, sqlpass, sqldb, 0, sqlsock, 0
+        &sql->mysql, null_host, sqluser, sqlpass, sqldb, 0, sqlsock, 0
     );
     if(!mret){
         TRACE_SQL(&e, sql);
@@ -126,7 +131,7 @@ derr_t sql_connect_unix_ex(
 }
 
 derr_t sql_connect_unix(
-    MYSQL *sql, const dstr_t *user, const dstr_t *pass, const dstr_t *sock
+    sql_t *sql, const dstr_t *user, const dstr_t *pass, const dstr_t *sock
 ){
     derr_t e = E_OK;
 
@@ -137,7 +142,7 @@ derr_t sql_connect_unix(
     return e;
 }
 
-derr_t sql_query(MYSQL *sql, const dstr_t query){
+derr_t sql_query(sql_t *sql, const dstr_t query){
     derr_t e = E_OK;
 
     // mariadb will puke if you pass a zero length string
@@ -145,7 +150,8 @@ derr_t sql_query(MYSQL *sql, const dstr_t query){
         ORIG(&e, E_INTERNAL, "empty queries not allowed");
     }
 
-    int ret = mysql_real_query(sql, query.data, query.len ? query.len : 1);
+    size_t len = query.len ? query.len : 1;
+    int ret = mysql_real_query(&sql->mysql, query.data, len);
     if(ret){
         TRACE_SQL(&e, sql);
         TRACE(&e, "while running: %x\n", FD(query));
@@ -156,11 +162,13 @@ derr_t sql_query(MYSQL *sql, const dstr_t query){
 }
 
 
-derr_t sql_exec_multi(MYSQL *sql, const dstr_t stmts){
+derr_t sql_exec_multi(sql_t *sql, const dstr_t stmts){
     derr_t e = E_OK;
 
     // multi-statements on
-    int ret = mysql_set_server_option(sql, MYSQL_OPTION_MULTI_STATEMENTS_ON);
+    int ret = mysql_set_server_option(
+        &sql->mysql, MYSQL_OPTION_MULTI_STATEMENTS_ON
+    );
     if(ret){
         TRACE_SQL(&e, sql);
         ORIG(&e, sql_err(sql), "failed to enable multi statement support");
@@ -172,11 +180,11 @@ derr_t sql_exec_multi(MYSQL *sql, const dstr_t stmts){
     // The multi-statement result loop is insanely complex:
     // see: https://dev.mysql.com/doc/c-api/8.0/en/c-api-multiple-queries.html
     while(true) {
-        MYSQL_RES *res = mysql_store_result(sql);
+        MYSQL_RES *res = mysql_store_result(&sql->mysql);
         if(res){
             // the current statement returned some data (we ignore it)
             mysql_free_result(res);
-        }else if(mysql_field_count(sql) == 0) {
+        }else if(mysql_field_count(&sql->mysql) == 0) {
             // current statement returned no data (still don't care)
         }else{
             // error; res should not have been NULL
@@ -184,7 +192,7 @@ derr_t sql_exec_multi(MYSQL *sql, const dstr_t stmts){
             ORIG(&e, sql_err(sql), "error getting query result");
         }
         // more results? -1 = no, >0 = error, 0 = yes (keep looping)
-        ret = mysql_next_result(sql);
+        ret = mysql_next_result(&sql->mysql);
         if(ret < 0){
             // no more results
             break;
@@ -196,7 +204,9 @@ derr_t sql_exec_multi(MYSQL *sql, const dstr_t stmts){
     }
 
     // multi-statements off
-    ret = mysql_set_server_option(sql, MYSQL_OPTION_MULTI_STATEMENTS_OFF);
+    ret = mysql_set_server_option(
+        &sql->mysql, MYSQL_OPTION_MULTI_STATEMENTS_OFF
+    );
     if(ret){
         TRACE_SQL(&e, sql);
         ORIG(&e, sql_err(sql), "failed to disable multi statement support");
@@ -206,10 +216,10 @@ derr_t sql_exec_multi(MYSQL *sql, const dstr_t stmts){
 }
 
 
-derr_t sql_use_result(MYSQL *sql, MYSQL_RES **res){
+derr_t sql_use_result(sql_t *sql, MYSQL_RES **res){
     derr_t e = E_OK;
 
-    *res = mysql_use_result(sql);
+    *res = mysql_use_result(&sql->mysql);
     if(!*res){
         TRACE_SQL(&e, sql);
         ORIG(&e, sql_err(sql), "mysql_use_result failed");
@@ -241,10 +251,10 @@ derr_t _sql_read_row(
     return e;
 }
 
-derr_t sql_stmt_init(MYSQL *sql, MYSQL_STMT **stmt){
+derr_t sql_stmt_init(sql_t *sql, MYSQL_STMT **stmt){
     derr_t e = E_OK;
 
-    *stmt = mysql_stmt_init(sql);
+    *stmt = mysql_stmt_init(&sql->mysql);
     if(!*stmt){
         TRACE_SQL(&e, sql);
         ORIG(&e, sql_err(sql), "failed to init new statment");
@@ -334,6 +344,43 @@ derr_t sql_stmt_execute(MYSQL_STMT *stmt){
     return e;
 }
 
+/* prepare a statement, or, on a pooled connection, reuse a cached one.
+   Either way, release it with stmt_release() */
+static derr_t stmt_acquire(sql_t *sql, const dstr_t query, MYSQL_STMT **stmt){
+    derr_t e = E_OK;
+
+    if(sql->conn){
+        PROP(&e, sql_conn_stmt_get(sql->conn, query, stmt) );
+        return e;
+    }
+
+    // create a statement object
+    PROP(&e, sql_stmt_init(sql, stmt) );
+
+    // prepare the statement
+    PROP_GO(&e, sql_stmt_prepare(*stmt, query), fail);
+
+    return e;
+
+fail:
+    mysql_stmt_close(*stmt);
+    *stmt = NULL;
+    return e;
+}
+
+static void stmt_release(sql_t *sql, MYSQL_STMT *stmt){
+    if(sql->conn){
+        sql_conn_stmt_put(sql->conn, stmt);
+        return;
+    }
+    mysql_stmt_close(stmt);
+}
+
+void sql_stmt_close(sql_t *sql, MYSQL_STMT *stmt){
+    if(!stmt) return;
+    stmt_release(sql, stmt);
+}
+
 static derr_t _stmt_rows_affected(MYSQL_STMT *stmt, size_t *out){
     derr_t e = E_OK;
 
@@ -353,7 +400,7 @@ static derr_t _stmt_rows_affected(MYSQL_STMT *stmt, size_t *out){
 }
 
 derr_t _sql_norow_query(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t query,
     unsigned long *affected,
     MYSQL_BIND *args,
@@ -362,12 +409,9 @@ derr_t _sql_norow_query(
     derr_t e = E_OK;
     if(affected) *affected = 0;
 
-    // create a statement object
+    // create and prepare a statement object
     MYSQL_STMT *stmt;
-    PROP(&e, sql_stmt_init(sql, &stmt) );
-
-    // prepare the statement
-    PROP_GO(&e, sql_stmt_prepare(stmt, query), cu_stmt);
+    PROP(&e, stmt_acquire(sql, query, &stmt) );
 
     // ensure that the statement will not produce results
     unsigned int nfields = mysql_stmt_field_count(stmt);
@@ -387,22 +431,19 @@ derr_t _sql_norow_query(
     if(affected) PROP_GO(&e, _stmt_rows_affected(stmt, affected), cu_stmt);
 
 cu_stmt:
-    mysql_stmt_close(stmt);
+    stmt_release(sql, stmt);
     return e;
 }
 
 derr_t _sql_onerow_query(
-    MYSQL *sql, const dstr_t query, bool *ok, MYSQL_BIND *args, size_t nargs
+    sql_t *sql, const dstr_t query, bool *ok, MYSQL_BIND *args, size_t nargs
 ){
     derr_t e = E_OK;
     if(ok) *ok = false;
 
-    // create a statement object
+    // create and prepare a statement object
     MYSQL_STMT *stmt;
-    PROP(&e, sql_stmt_init(sql, &stmt) );
-
-    // prepare the statement
-    PROP_GO(&e, sql_stmt_prepare(stmt, query), cu_stmt);
+    PROP(&e, stmt_acquire(sql, query, &stmt) );
 
     // count input and output fields
     long unsigned int ins = mysql_stmt_param_count(stmt);
@@ -476,12 +517,12 @@ derr_t _sql_onerow_query(
     }
 
 cu_stmt:
-    mysql_stmt_close(stmt);
+    stmt_release(sql, stmt);
     return e;
 }
 
 derr_t _sql_multirow_stmt(
-    MYSQL *sql,
+    sql_t *sql,
     MYSQL_STMT **stmt,
     const dstr_t query,
     MYSQL_BIND *args,
@@ -489,11 +530,8 @@ derr_t _sql_multirow_stmt(
 ){
     derr_t e = E_OK;
 
-    // create a statement object
-    PROP(&e, sql_stmt_init(sql, stmt) );
-
-    // prepare the statement
-    PROP_GO(&e, sql_stmt_prepare(*stmt, query), fail);
+    // create and prepare a statement object
+    PROP(&e, stmt_acquire(sql, query, stmt) );
 
     // count input and output fields
     long unsigned int ins = mysql_stmt_param_count(*stmt);
@@ -527,7 +565,7 @@ derr_t _sql_multirow_stmt(
     return e;
 
 fail:
-    mysql_stmt_close(*stmt);
+    stmt_release(sql, *stmt);
     *stmt = NULL;
     return e;
 }
@@ -564,26 +602,27 @@ void sql_stmt_fetchall(MYSQL_STMT *stmt){
     }
 }
 
-derr_t sql_txn_start(MYSQL *sql){
+derr_t sql_txn_start(sql_t *sql){
     derr_t e = E_OK;
     PROP(&e, sql_query(sql, DSTR_LIT("START TRANSACTION")));
     return e;
 }
 
-derr_t sql_txn_commit(MYSQL *sql){
+derr_t sql_txn_commit(sql_t *sql){
     derr_t e = E_OK;
     PROP(&e, sql_query(sql, DSTR_LIT("COMMIT")));
     return e;
 }
 
-derr_t sql_txn_rollback(MYSQL *sql){
+derr_t sql_txn_rollback(sql_t *sql){
     derr_t e = E_OK;
     PROP(&e, sql_query(sql, DSTR_LIT("ROLLBACK")));
     return e;
 }
 
-// if txn rollback fails, it closes the mysql object
-void sql_txn_abort(MYSQL *sql){
+// if txn rollback fails, it closes the mysql object (or, for a pooled
+// connection, marks it to be closed when it is returned)
+void sql_txn_abort(sql_t *sql){
     derr_t e = E_OK;
     IF_PROP(&e, sql_query(sql, DSTR_LIT("ROLLBACK"))) {
         // this seems by far most likely due to connection issues, so just
@@ -591,6 +630,11 @@ void sql_txn_abort(MYSQL *sql){
         DROP_VAR(&e);
 
         // render the connection unusable
-        mysql_close(sql);
+        if(sql->conn){
+            // the pool will close it when it is returned
+            sql_conn_mark_broken(sql->conn);
+        }else{
+            sql_close(sql);
+        }
     }
 }
@@ -17,6 +17,19 @@
 
 #include "binds.h"
 
+struct sql_conn_t;
+
+/* a mysql connection, as passed to every sql_*() helper and to libsmsql.
+   Connections from sql_pool_get() carry a pointer to their sql_conn_t, so
+   the helpers can reuse its cached statements without a lookup. */
+typedef struct {
+    MYSQL mysql;
+    // NULL for standalone connections
+    struct sql_conn_t *conn;
+} sql_t;
+
+#include "pool.h"
+
 // an error in the SQL library
 extern derr_type_t E_SQL;
 // a 'duplicate entry' error
@@ -34,13 +47,14 @@ derr_type_t _fmt_sql(const fmt_i *iface, writer_i *out);
 derr_t dmysql_library_init(void);
 // use normal mysql_library_end()
 
-derr_t dmysql_init(MYSQL *sql);
-// use normal mysql_close(sql)
+derr_t dmysql_init(sql_t *sql);
+// not for pooled connections, which are closed by their pool
+void sql_close(sql_t *sql);
 
 // sock is allowed to be NULL (defaults to "/var/run/mysqld/mysqld.sock")
 // dbname can be NULL to not choose a database
 derr_t sql_connect_unix_ex(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t *user,
     const dstr_t *pass,
     const dstr_t *sock,
@@ -49,14 +63,14 @@ derr_t sql_connect_unix_ex(
 
 // always connects to the "splintermail" database
 derr_t sql_connect_unix(
-    MYSQL *sql, const dstr_t *user, const dstr_t *pass, const dstr_t *sock
+    sql_t *sql, const dstr_t *user, const dstr_t *pass, const dstr_t *sock
 );
 
-derr_t sql_query(MYSQL *sql, const dstr_t query);
+derr_t sql_query(sql_t *sql, const dstr_t query);
 
-derr_t sql_exec_multi(MYSQL *sql, const dstr_t stmts);
+derr_t sql_exec_multi(sql_t *sql, const dstr_t stmts);
 
-derr_t sql_use_result(MYSQL *sql, MYSQL_RES **res);
+derr_t sql_use_result(sql_t *sql, MYSQL_RES **res);
 
 derr_t _sql_read_row(
     MYSQL_RES *res, MYSQL_ROW *row, dstr_t **args, size_t nargs
@@ -70,7 +84,7 @@ derr_t _sql_read_row(
     )
 
 
-derr_t sql_stmt_init(MYSQL *sql, MYSQL_STMT **stmt);
+derr_t sql_stmt_init(sql_t *sql, MYSQL_STMT **stmt);
 
 derr_t sql_stmt_prepare(MYSQL_STMT *stmt, const dstr_t query);
 
@@ -95,7 +109,7 @@ derr_t sql_read_bit_dstr(const dstr_t *val, bool *out);
 derr_t sql_stmt_execute(MYSQL_STMT *stmt);
 
 derr_t _sql_norow_query(
-    MYSQL *sql,
+    sql_t *sql,
     const dstr_t query,
     size_t *affected,
     MYSQL_BIND *args,
@@ -114,7 +128,7 @@ derr_t _sql_norow_query(
 // if ok==NULL, raises an error if no row is received
 // if ok!=NULL, sets ok=bool(one row was received)
 derr_t _sql_onerow_query(
-    MYSQL *mysql, const dstr_t query, bool *ok, MYSQL_BIND *args, size_t nargs
+    sql_t *sql, const dstr_t query, bool *ok, MYSQL_BIND *args, size_t nargs
 );
 #define sql_onerow_query(sql, query, ok, ...) \
     _sql_onerow_query( \
@@ -132,12 +146,15 @@ derr_t _sql_onerow_query(
     - sql_stmt_execute()
     - sql_stmt_bind_results()
 
+   (on a pooled connection, the first two are usually skipped in favor of a
+   cached statement)
+
    you still have to call
     - sql_stmt_fetch()
-    - mysql_stmt_close()
+    - sql_stmt_close()
 */
 derr_t _sql_multirow_stmt(
-    MYSQL *sql,
+    sql_t *sql,
     MYSQL_STMT **stmt,
     const dstr_t query,
     MYSQL_BIND *args,
@@ -165,11 +182,16 @@ derr_t sql_stmt_fetch(MYSQL_STMT *stmt, bool *ok);
 // only useful in error handling; will destroy memory pointed to by BINDs
 void sql_stmt_fetchall(MYSQL_STMT *stmt);
 
-derr_t sql_txn_start(MYSQL *sql);
-derr_t sql_txn_commit(MYSQL *sql);
+/* finish with a statement from sql_multirow_stmt(); pooled connections keep
+   the statement prepared for next time.  Safe to call with stmt=NULL. */
+void sql_stmt_close(sql_t *sql, MYSQL_STMT *stmt);
+
+derr_t sql_txn_start(sql_t *sql);
+derr_t sql_txn_commit(sql_t *sql);
 // ROLLBACK and let the caller handle errors
-derr_t sql_txn_rollback(MYSQL *sql);
+derr_t sql_txn_rollback(sql_t *sql);
 // closes sql if ROLLBACK fails; useful during error handling
-void sql_txn_abort(MYSQL *sql);
+// (a pooled connection is instead closed when it is returned to the pool)
+void sql_txn_abort(sql_t *sql);
 
 #endif // MYSQL_HELPER_H
@@ -0,0 +1,309 @@
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+
+#include <errmsg.h>
+#include <mysqld_error.h>
+
+#include "mysql_util.h"
+
+static uint64_t now_ns(void){
+    struct timespec ts;
+    int ret = clock_gettime(CLOCK_MONOTONIC, &ts);
+    if(ret) LOG_FATAL("clock_gettime: %x\n", FE(errno));
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static void stats_add(sql_pool_stats_t *a, const sql_pool_stats_t b){
+    a->checkouts += b.checkouts;
+    a->waits += b.waits;
+    a->wait_ns += b.wait_ns;
+    a->connects += b.connects;
+    a->prepares += b.prepares;
+    a->reuses += b.reuses;
+}
+
+static derr_t copy_param(const dstr_t *in, dstr_t *mem, const dstr_t **out){
+    derr_t e = E_OK;
+
+    *out = NULL;
+    if(!in) return e;
+
+    PROP(&e, dstr_new(mem, in->len) );
+    PROP(&e, dstr_copy(in, mem) );
+    *out = mem;
+
+    return e;
+}
+
+derr_t sql_pool_init(
+    sql_pool_t *pool,
+    size_t nconns,
+    const dstr_t *user,
+    const dstr_t *pass,
+    const dstr_t *sock,
+    const dstr_t *db
+){
+    derr_t e = E_OK;
+
+    *pool = (sql_pool_t){0};
+    link_init(&pool->idle);
+
+    if(nconns == 0) ORIG(&e, E_PARAM, "sql pool must have connections");
+
+    PROP_GO(&e, copy_param(user, &pool->_user, &pool->user), fail);
+    PROP_GO(&e, copy_param(pass, &pool->_pass, &pool->pass), fail);
+    PROP_GO(&e, copy_param(sock, &pool->_sock, &pool->sock), fail);
+    PROP_GO(&e, copy_param(db, &pool->_db, &pool->db), fail);
+
+    pool->conns = calloc(nconns, sizeof(*pool->conns));
+    if(!pool->conns) ORIG_GO(&e, E_NOMEM, "nomem", fail);
+    pool->nconns = nconns;
+
+    for(size_t i = 0; i < nconns; i++){
+        sql_conn_t *conn = &pool->conns[i];
+        conn->pool = pool;
+        link_init(&conn->inuse);
+        PROP_GO(&e, hashmap_init(&conn->stmts), fail);
+        link_list_append(&pool->idle, &conn->link);
+    }
+
+    PROP_GO(&e, dmutex_init(&pool->mutex), fail);
+    PROP_GO(&e, dcond_init(&pool->cond), fail_mutex);
+
+    return e;
+
+fail_mutex:
+    dmutex_free(&pool->mutex);
+fail:
+    for(size_t i = 0; pool->conns && i < nconns; i++){
+        hashmap_free(&pool->conns[i].stmts);
+    }
+    if(pool->conns) free(pool->conns);
+    dstr_free(&pool->_user);
+    dstr_free(&pool->_pass);
+    dstr_free(&pool->_sock);
+    dstr_free(&pool->_db);
+    *pool = (sql_pool_t){0};
+    return e;
+}
+
+// close every cached statement, then the connection itself
+static void conn_disconnect(sql_conn_t *conn){
+    hashmap_trav_t trav;
+    hash_elem_t *elem = hashmap_pop_iter(&trav, &conn->stmts);
+    for(; elem != NULL; elem = hashmap_pop_next(&trav)){
+        sql_cached_stmt_t *cached = CONTAINER_OF(elem, sql_cached_stmt_t, elem);
+        link_remove(&cached->link);
+        mysql_stmt_close(cached->stmt);
+        dstr_free(&cached->query);
+        free(cached);
+    }
+    if(conn->connected){
+        sql_close(&conn->sql);
+        conn->connected = false;
+    }
+    conn->broken = false;
+}
+
+void sql_pool_free(sql_pool_t *pool){
+    if(!pool->conns) return;
+
+    for(size_t i = 0; i < pool->nconns; i++){
+        conn_disconnect(&pool->conns[i]);
+        hashmap_free(&pool->conns[i].stmts);
+    }
+    free(pool->conns);
+    dcond_free(&pool->cond);
+    dmutex_free(&pool->mutex);
+    dstr_free(&pool->_user);
+    dstr_free(&pool->_pass);
+    dstr_free(&pool->_sock);
+    dstr_free(&pool->_db);
+    *pool = (sql_pool_t){0};
+}
+
+static derr_t conn_connect(sql_pool_t *pool, sql_conn_t *conn){
+    derr_t e = E_OK;
+
+    PROP(&e, dmysql_init(&conn->sql) );
+
+    PROP_GO(&e,
+        sql_connect_unix_ex(
+            &conn->sql, pool->user, pool->pass, pool->sock, pool->db
+        ),
+    fail);
+
+    conn->sql.conn = conn;
+    conn->connected = true;
+    conn->stats.connects++;
+
+    return e;
+
+fail:
+    sql_close(&conn->sql);
+    return e;
+}
+
+// return a connection to the idle list and publish its counters
+static void conn_release(sql_pool_t *pool, sql_conn_t *conn){
+    dmutex_lock(&pool->mutex);
+    stats_add(&pool->stats, conn->stats);
+    conn->stats = (sql_pool_stats_t){0};
+    // prefer recently-used connections, which are known to be alive
+    link_list_prepend(&pool->idle, &conn->link);
+    dcond_signal(&pool->cond);
+    dmutex_unlock(&pool->mutex);
+}
+
+derr_t sql_pool_get(sql_pool_t *pool, sql_t **sql){
+    derr_t e = E_OK;
+
+    *sql = NULL;
+
+    dmutex_lock(&pool->mutex);
+    pool->stats.checkouts++;
+    if(link_list_isempty(&pool->idle)){
+        pool->stats.waits++;
+        uint64_t start = now_ns();
+        while(link_list_isempty(&pool->idle)){
+            dcond_wait(&pool->cond, &pool->mutex);
+        }
+        pool->stats.wait_ns += now_ns() - start;
+    }
+    link_t *link = link_list_pop_first(&pool->idle);
+    dmutex_unlock(&pool->mutex);
+
+    sql_conn_t *conn = CONTAINER_OF(link, sql_conn_t, link);
+
+    if(!conn->connected){
+        PROP_GO(&e, conn_connect(pool, conn), fail);
+    }
+
+    *sql = &conn->sql;
+
+    return e;
+
+fail:
+    conn_release(pool, conn);
+    return e;
+}
+
+// errors after which the connection can't be used again
+static bool is_client_error(unsigned int err){
+#ifdef ER_CONNECTION_KILLED
+    // mariadb reports a KILLed connection as a server error
+    if(err == ER_CONNECTION_KILLED) return true;
+#endif
+    return err >= CR_MIN_ERROR && err <= CR_MAX_ERROR;
+}
+
+void sql_pool_put(sql_pool_t *pool, sql_t *sql){
+    sql_conn_t *conn = sql->conn;
+    if(!conn || conn->pool != pool){
+        LOG_FATAL("sql_pool_put() with a connection from another pool\n");
+    }
+
+    // statements left checked out can't be trusted; drop the connection
+    if(!link_list_isempty(&conn->inuse)){
+        LOG_ERROR("sql connection returned with statements in use\n");
+        conn->broken = true;
+    }
+    if(conn->connected && is_client_error(mysql_errno(&sql->mysql))){
+        conn->broken = true;
+    }
+    if(conn->broken) conn_disconnect(conn);
+
+    conn_release(pool, conn);
+}
+
+sql_pool_stats_t sql_pool_stats(sql_pool_t *pool){
+    dmutex_lock(&pool->mutex);
+    sql_pool_stats_t out = pool->stats;
+    dmutex_unlock(&pool->mutex);
+    return out;
+}
+
+static derr_t stmt_new(
+    sql_conn_t *conn, const dstr_t query, MYSQL_STMT **stmt
+){
+    derr_t e = E_OK;
+
+    PROP(&e, sql_stmt_init(&conn->sql, stmt) );
+    PROP_GO(&e, sql_stmt_prepare(*stmt, query), fail);
+
+    conn->stats.prepares++;
+
+    return e;
+
+fail:
+    if(is_client_error(mysql_stmt_errno(*stmt))) conn->broken = true;
+    mysql_stmt_close(*stmt);
+    *stmt = NULL;
+    return e;
+}
+
+derr_t sql_conn_stmt_get(
+    sql_conn_t *conn, const dstr_t query, MYSQL_STMT **stmt
+){
+    derr_t e = E_OK;
+
+    *stmt = NULL;
+
+    hash_elem_t *elem = hashmap_gets(&conn->stmts, &query);
+    if(elem){
+        sql_cached_stmt_t *cached = CONTAINER_OF(elem, sql_cached_stmt_t, elem);
+        if(link_list_isempty(&cached->link)){
+            link_list_append(&conn->inuse, &cached->link);
+            conn->stats.reuses++;
+            *stmt = cached->stmt;
+            return e;
+        }
+        /* the cached statement is already in use (a nested query), so just
+           prepare a one-off statement for this caller */
+        PROP(&e, stmt_new(conn, query, stmt) );
+        return e;
+    }
+
+    sql_cached_stmt_t *cached = malloc(sizeof(*cached));
+    if(!cached) ORIG(&e, E_NOMEM, "nomem");
+    *cached = (sql_cached_stmt_t){0};
+    link_init(&cached->link);
+
+    PROP_GO(&e, dstr_new(&cached->query, query.len), fail);
+    PROP_GO(&e, dstr_copy(&query, &cached->query), fail);
+
+    PROP_GO(&e, stmt_new(conn, query, &cached->stmt), fail);
+
+    hashmap_sets(&conn->stmts, &cached->query, &cached->elem);
+    link_list_append(&conn->inuse, &cached->link);
+    *stmt = cached->stmt;
+
+    return e;
+
+fail:
+    dstr_free(&cached->query);
+    free(cached);
+    return e;
+}
+
+void sql_conn_stmt_put(sql_conn_t *conn, MYSQL_STMT *stmt){
+    if(is_client_error(mysql_stmt_errno(stmt))) conn->broken = true;
+
+    sql_cached_stmt_t *cached;
+    LINK_FOR_EACH(cached, &conn->inuse, sql_cached_stmt_t, link){
+        if(cached->stmt != stmt) continue;
+        link_remove(&cached->link);
+        /* discard any unread rows, but keep the server-side statement; this
+           costs no round trip unless there were rows left to drain */
+        mysql_stmt_free_result(stmt);
+        return;
+    }
+
+    // a one-off statement
+    mysql_stmt_close(stmt);
+}
+
+void sql_conn_mark_broken(sql_conn_t *conn){
+    conn->broken = true;
+}
@@ -0,0 +1,107 @@
+/* sql_pool_t: a fixed set of mysql connections shared between threads, where
+   each connection caches a prepared MYSQL_STMT for every query it has run.
+
+   A sql_t checked out of a pool is passed to the normal sql_*_query() and
+   libsmsql functions.  Its conn pointer leads those helpers straight to the
+   cached statement instead of paying for a prepare round trip on every call.
+   Standalone sql_t objects keep the old prepare-execute-close behavior, so
+   nothing needs to know which kind of connection it has.
+
+   Connections are established lazily, on their first checkout.  A
+   connection which hits a client error (lost connection and the like) is
+   marked broken; when it is returned it is closed along with its cached
+   statements, and the next checkout reconnects. */
+
+typedef struct {
+    dstr_t query;
+    MYSQL_STMT *stmt;
+    hash_elem_t elem;  // sql_conn_t->stmts
+    link_t link;  // sql_conn_t->inuse
+} sql_cached_stmt_t;
+DEF_CONTAINER_OF(sql_cached_stmt_t, elem, hash_elem_t)
+DEF_CONTAINER_OF(sql_cached_stmt_t, link, link_t)
+
+typedef struct {
+    // calls to sql_pool_get()
+    uint64_t checkouts;
+    // checkouts which found no idle connection
+    uint64_t waits;
+    // total time spent waiting for an idle connection
+    uint64_t wait_ns;
+    // connections established, including reconnects
+    uint64_t connects;
+    // statements prepared on pooled connections
+    uint64_t prepares;
+    // executions which reused a cached statement
+    uint64_t reuses;
+} sql_pool_stats_t;
+
+struct sql_pool_t;
+
+typedef struct sql_conn_t {
+    // sql.conn points back to us
+    sql_t sql;
+    struct sql_pool_t *pool;
+    bool connected;
+    bool broken;
+    // query -> sql_cached_stmt_t
+    hashmap_t stmts;
+    // cached statements which are checked out right now
+    link_t inuse;
+    // counters accumulated while checked out, merged into the pool on return
+    sql_pool_stats_t stats;
+    link_t link;  // sql_pool_t->idle
+} sql_conn_t;
+DEF_CONTAINER_OF(sql_conn_t, link, link_t)
+
+typedef struct sql_pool_t {
+    dstr_t _user;
+    dstr_t _pass;
+    dstr_t _sock;
+    dstr_t _db;
+    const dstr_t *user;
+    const dstr_t *pass;
+    const dstr_t *sock;
+    const dstr_t *db;
+
+    sql_conn_t *conns;
+    size_t nconns;
+
+    dmutex_t mutex;
+    dcond_t cond;
+    link_t idle;  // sql_conn_t->link
+    sql_pool_stats_t stats;
+} sql_pool_t;
+
+// user, pass, sock, and db have the same meaning as in sql_connect_unix_ex()
+derr_t sql_pool_init(
+    sql_pool_t *pool,
+    size_t nconns,
+    const dstr_t *user,
+    const dstr_t *pass,
+    const dstr_t *sock,
+    const dstr_t *db
+);
+// all connections must have been returned; safe to call on a zeroized pool
+void sql_pool_free(sql_pool_t *pool);
+
+/* blocks until a connection is available, then connects it if necessary.
+   On failure, the connection is returned to the pool and *sql is NULL. */
+derr_t sql_pool_get(sql_pool_t *pool, sql_t **sql);
+/* any transaction on sql must be finished before it is returned; safe to
+   call after any error, since a broken connection is closed here */
+void sql_pool_put(sql_pool_t *pool, sql_t *sql);
+
+sql_pool_stats_t sql_pool_stats(sql_pool_t *pool);
+
+// internal interface for mysql_util.c
+
+// returns a prepared statement from conn's cache, preparing it if necessary
+derr_t sql_conn_stmt_get(
+    sql_conn_t *conn, const dstr_t query, MYSQL_STMT **stmt
+);
+
+// returns a statement from sql_conn_stmt_get(), which may be reused later
+void sql_conn_stmt_put(sql_conn_t *conn, MYSQL_STMT *stmt);
+
+void sql_conn_mark_broken(sql_conn_t *conn);
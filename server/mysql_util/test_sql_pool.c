@@ -0,0 +1,304 @@
+#include <time.h>
+
+#include "mysql_util.h"
+
+#include "test/test_utils.h"
+
+/* these tests need a live database; test/test_sql_pool.py starts one and
+   passes us the path to its socket */
+
+static derr_t conn_id(sql_t *sql, uint64_t *id){
+    derr_t e = E_OK;
+
+    DSTR_STATIC(q, "SELECT CONNECTION_ID()");
+    PROP(&e, sql_onerow_query(sql, q, NULL, uint64_bind_out(id)) );
+
+    return e;
+}
+
+static void sleep_ms(long ms){
+    struct timespec ts = {
+        .tv_sec = ms / 1000, .tv_nsec = ms % 1000 * 1000000
+    };
+    nanosleep(&ts, NULL);
+}
+
+static derr_t test_get_put(const dstr_t *sock){
+    derr_t e = E_OK;
+
+    sql_pool_t pool = {0};
+    sql_t *a = NULL;
+    sql_t *b = NULL;
+    uint64_t id_a, id_b, id;
+
+    PROP_GO(&e, sql_pool_init(&pool, 2, NULL, NULL, sock, NULL), cu);
+
+    PROP_GO(&e, sql_pool_get(&pool, &a), cu);
+    EXPECT_NOT_NULL_GO(&e, "a->conn", a->conn, cu);
+    // the second execution reuses the cached statement
+    PROP_GO(&e, conn_id(a, &id_a), cu);
+    PROP_GO(&e, conn_id(a, &id), cu);
+    EXPECT_U_GO(&e, "id", id, id_a, cu);
+
+    PROP_GO(&e, sql_pool_get(&pool, &b), cu);
+    PROP_GO(&e, conn_id(b, &id_b), cu);
+    EXPECT_B_GO(&e, "a != b", a != b, true, cu);
+    EXPECT_B_GO(&e, "id_a != id_b", id_a != id_b, true, cu);
+
+    sql_pool_put(&pool, b);
+    b = NULL;
+    sql_pool_put(&pool, a);
+
+    // the most recently returned connection comes out first, still connected
+    sql_t *c;
+    PROP_GO(&e, sql_pool_get(&pool, &c), cu);
+    EXPECT_B_GO(&e, "c == a", c == a, true, cu);
+    PROP_GO(&e, conn_id(c, &id), cu);
+    EXPECT_U_GO(&e, "id", id, id_a, cu);
+    sql_pool_put(&pool, c);
+    a = NULL;
+
+    sql_pool_stats_t stats = sql_pool_stats(&pool);
+    EXPECT_U_GO(&e, "checkouts", stats.checkouts, 3, cu);
+    EXPECT_U_GO(&e, "waits", stats.waits, 0, cu);
+    EXPECT_U_GO(&e, "connects", stats.connects, 2, cu);
+    EXPECT_U_GO(&e, "prepares", stats.prepares, 2, cu);
+    EXPECT_U_GO(&e, "reuses", stats.reuses, 2, cu);
+
+cu:
+    if(b) sql_pool_put(&pool, b);
+    if(a) sql_pool_put(&pool, a);
+    sql_pool_free(&pool);
+    return e;
+}
+
+typedef struct {
+    sql_pool_t *pool;
+    dmutex_t mutex;
+    bool got;
+    derr_t e;
+} waiter_t;
+
+static void *waiter_thread(void *arg){
+    waiter_t *w = arg;
+    sql_t *sql;
+    derr_t e = E_OK;
+    PROP_GO(&e, sql_pool_get(w->pool, &sql), done);
+    dmutex_lock(&w->mutex);
+    w->got = true;
+    dmutex_unlock(&w->mutex);
+    sql_pool_put(w->pool, sql);
+done:
+    w->e = e;
+    return NULL;
+}
+
+static bool waiter_got(waiter_t *w){
+    dmutex_lock(&w->mutex);
+    bool out = w->got;
+    dmutex_unlock(&w->mutex);
+    return out;
+}
+
+static derr_t test_blocking(const dstr_t *sock){
+    derr_t e = E_OK;
+
+    sql_pool_t pool = {0};
+    sql_t *sql = NULL;
+    waiter_t w = { .pool = &pool };
+    bool mutex_ready = false;
+    bool thread_running = false;
+    dthread_t thread;
+
+    PROP_GO(&e, sql_pool_init(&pool, 1, NULL, NULL, sock, NULL), cu);
+    PROP_GO(&e, dmutex_init(&w.mutex), cu);
+    mutex_ready = true;
+
+    PROP_GO(&e, sql_pool_get(&pool, &sql), cu);
+
+    // with the only connection checked out, the waiter must block
+    PROP_GO(&e, dthread_create(&thread, waiter_thread, &w), cu);
+    thread_running = true;
+    sleep_ms(100);
+    EXPECT_B_GO(&e, "got while checked out", waiter_got(&w), false, cu);
+
+    // returning the connection wakes the waiter
+    sql_pool_put(&pool, sql);
+    sql = NULL;
+    dthread_join(&thread);
+    thread_running = false;
+    PROP_VAR_GO(&e, &w.e, cu);
+    EXPECT_B_GO(&e, "got after put", waiter_got(&w), true, cu);
+
+    sql_pool_stats_t stats = sql_pool_stats(&pool);
+    EXPECT_U_GO(&e, "checkouts", stats.checkouts, 2, cu);
+    EXPECT_U_GO(&e, "waits", stats.waits, 1, cu);
+    EXPECT_U_GT_GO(&e, "wait_ns", stats.wait_ns, 0, cu);
+    EXPECT_U_GO(&e, "connects", stats.connects, 1, cu);
+
+cu:
+    if(sql) sql_pool_put(&pool, sql);
+    if(thread_running){
+        dthread_join(&thread);
+        DROP_VAR(&w.e);
+    }
+    if(mutex_ready) dmutex_free(&w.mutex);
+    sql_pool_free(&pool);
+    return e;
+}
+
+static derr_t test_reconnect(const dstr_t *sock){
+    derr_t e = E_OK;
+
+    sql_pool_t pool = {0};
+    sql_t *sql = NULL;
+    sql_t killer;
+    bool killer_ready = false;
+    uint64_t id_a, id_b;
+
+    PROP_GO(&e, sql_pool_init(&pool, 1, NULL, NULL, sock, NULL), cu);
+
+    PROP_GO(&e, sql_pool_get(&pool, &sql), cu);
+    PROP_GO(&e, conn_id(sql, &id_a), cu);
+
+    // kill the pooled connection from a standalone one
+    PROP_GO(&e, dmysql_init(&killer), cu);
+    killer_ready = true;
+    PROP_GO(&e, sql_connect_unix_ex(&killer, NULL, NULL, sock, NULL), cu);
+    DSTR_VAR(kill, 64);
+    PROP_GO(&e, FMT(&kill, "KILL CONNECTION %x", FU(id_a)), cu);
+    PROP_GO(&e, sql_query(&killer, kill), cu);
+
+    // the cached statement now fails, which marks the connection broken
+    derr_t e2 = conn_id(sql, &id_b);
+    EXPECT_E_VAR_GO(&e, "conn_id after kill", &e2, E_SQL, cu);
+    sql_pool_put(&pool, sql);
+    sql = NULL;
+
+    // the next checkout reconnects
+    PROP_GO(&e, sql_pool_get(&pool, &sql), cu);
+    PROP_GO(&e, conn_id(sql, &id_b), cu);
+    EXPECT_B_GO(&e, "new connection id", id_a != id_b, true, cu);
+
+    sql_pool_stats_t stats = sql_pool_stats(&pool);
+    EXPECT_U_GO(&e, "connects", stats.connects, 2, cu);
+
+cu:
+    if(sql) sql_pool_put(&pool, sql);
+    if(killer_ready) sql_close(&killer);
+    sql_pool_free(&pool);
+    return e;
+}
+
+static derr_t test_error_paths(const dstr_t *sock){
+    derr_t e = E_OK;
+
+    sql_pool_t pool = {0};
+    sql_pool_t bad_pool = {0};
+    sql_t *sql = NULL;
+    MYSQL_STMT *stmt = NULL;
+    uint64_t id_a, id;
+    derr_t e2;
+
+    PROP_GO(&e, sql_pool_init(&pool, 1, NULL, NULL, sock, NULL), cu);
+
+    PROP_GO(&e, sql_pool_get(&pool, &sql), cu);
+    PROP_GO(&e, conn_id(sql, &id_a), cu);
+
+    // a statement that fails to prepare
+    DSTR_STATIC(q_bad, "SELEKT 1");
+    e2 = sql_norow_query(sql, q_bad, NULL);
+    EXPECT_E_VAR_GO(&e, "bad query", &e2, E_SQL, cu);
+
+    // a onerow query with too many rows leaves none unread
+    uint64_t val;
+    DSTR_STATIC(q_two, "SELECT 1 UNION SELECT 2");
+    e2 = sql_onerow_query(sql, q_two, NULL, uint64_bind_out(&val));
+    EXPECT_E_VAR_GO(&e, "two rows", &e2, E_SQL, cu);
+
+    // a multirow statement abandoned halfway through
+    DSTR_STATIC(q_multi, "SELECT 1 UNION SELECT 2 UNION SELECT 3");
+    PROP_GO(&e,
+        sql_multirow_stmt(sql, &stmt, q_multi, uint64_bind_out(&val)),
+    cu);
+    bool ok;
+    PROP_GO(&e, sql_stmt_fetch(stmt, &ok), cu);
+    EXPECT_B_GO(&e, "ok", ok, true, cu);
+    sql_stmt_close(sql, stmt);
+    stmt = NULL;
+
+    // an aborted transaction
+    PROP_GO(&e, sql_txn_start(sql), cu);
+    sql_txn_abort(sql);
+
+    // none of that broke the connection
+    PROP_GO(&e, conn_id(sql, &id), cu);
+    EXPECT_U_GO(&e, "id", id, id_a, cu);
+    sql_pool_put(&pool, sql);
+    sql = NULL;
+    PROP_GO(&e, sql_pool_get(&pool, &sql), cu);
+    PROP_GO(&e, conn_id(sql, &id), cu);
+    EXPECT_U_GO(&e, "id", id, id_a, cu);
+
+    // returning a connection with a statement still open does break it
+    PROP_GO(&e,
+        sql_multirow_stmt(sql, &stmt, q_multi, uint64_bind_out(&val)),
+    cu);
+    sql_pool_put(&pool, sql);
+    sql = NULL;
+    stmt = NULL;
+    PROP_GO(&e, sql_pool_get(&pool, &sql), cu);
+    PROP_GO(&e, conn_id(sql, &id), cu);
+    EXPECT_B_GO(&e, "new connection id", id != id_a, true, cu);
+    sql_pool_put(&pool, sql);
+    sql = NULL;
+
+    sql_pool_stats_t stats = sql_pool_stats(&pool);
+    EXPECT_U_GO(&e, "connects", stats.connects, 2, cu);
+
+    /* a failed connect returns the connection to the pool, so with only one
+       connection the second attempt fails too, rather than blocking */
+    DSTR_STATIC(nosock, "/nonexistent/mysqld.sock");
+    PROP_GO(&e, sql_pool_init(&bad_pool, 1, NULL, NULL, &nosock, NULL), cu);
+    for(int i = 0; i < 2; i++){
+        e2 = sql_pool_get(&bad_pool, &sql);
+        EXPECT_E_VAR_GO(&e, "bad connect", &e2, E_SQL, cu);
+        EXPECT_NULL_GO(&e, "sql", sql, cu);
+    }
+
+cu:
+    if(stmt) sql_stmt_close(sql, stmt);
+    if(sql) sql_pool_put(&pool, sql);
+    sql_pool_free(&bad_pool);
+    sql_pool_free(&pool);
+    return e;
+}
+
+int main(int argc, char **argv){
+    derr_t e = E_OK;
+    const char *sock_path;
+    // the socket path takes the place of the test files path
+    PARSE_TEST_OPTIONS(argc, argv, &sock_path, LOG_LVL_INFO);
+
+    dstr_t sock = dstr_from_cstr((char*)sock_path);
+
+    PROP_GO(&e, dmysql_library_init(), test_fail);
+
+    PROP_GO(&e, test_get_put(&sock), cu);
+    PROP_GO(&e, test_blocking(&sock), cu);
+    PROP_GO(&e, test_reconnect(&sock), cu);
+    PROP_GO(&e, test_error_paths(&sock), cu);
+
+cu:
+    mysql_library_end();
+    if(is_error(e)) goto test_fail;
+
+    LOG_ERROR("PASS\n");
+    return 0;
+
+test_fail:
+    DUMP(e);
+    DROP_VAR(&e);
+    LOG_ERROR("FAIL\n");
+    return 1;
+}
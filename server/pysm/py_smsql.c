@@ -4,16 +4,50 @@
 
 #include "pysm.h"
 
+derr_t sqlpool_init(
+    py_sqlpool_t *self,
+    size_t size,
+    const dstr_t sock,
+    const dstr_t *user,
+    const dstr_t *pass,
+    const dstr_t *db
+){
+    derr_t e = E_OK;
+
+    if(self->_pool){
+        ORIG(&e, E_INTERNAL, "sql pool already initialized!");
+    }
+
+    PROP(&e, sql_pool_init(&self->pool, size, user, pass, &sock, db) );
+    self->_pool = true;
+
+    return e;
+}
+
+void sqlpool_deinit(py_sqlpool_t *self){
+    // every SMSQL using this pool holds a reference, so all are returned
+    if(!self->_pool) return;
+    sql_pool_free(&self->pool);
+    self->_pool = false;
+}
+
 derr_t smsql_init(
     py_smsql_t *self,
     const dstr_t sock,
     const dstr_t *user,
     const dstr_t *pass,
-    const dstr_t *db
+    const dstr_t *db,
+    py_sqlpool_t *pool
 ){
-    (void)db;
     derr_t e = E_OK;
 
+    self->sql = &self->mysql;
+
+    if(pool != NULL){
+        Py_INCREF((PyObject*)pool);
+        self->pool = pool;
+    }
+
     PROP_GO(&e, dstr_copy(&sock, &self->sock), fail);
 
     if(user != NULL){
@@ -44,10 +78,9 @@ void smsql_deinit(py_smsql_t *self){
     dstr_free(&self->pass);
     dstr_free(&self->db);
 
-    if(self->_sql){
-        mysql_close(&self->sql);
-        self->_sql = false;
-    }
+    smsql_close(self);
+
+    Py_CLEAR(self->pool);
 }
 
 derr_t smsql_connect(py_smsql_t *self){
@@ -57,11 +90,26 @@ derr_t smsql_connect(py_smsql_t *self){
         ORIG(&e, E_INTERNAL, "sql already connected!");
     }
 
-    PROP(&e, dmysql_init(&self->sql) );
+    if(self->pool){
+        if(!self->pool->_pool){
+            ORIG(&e, E_INTERNAL, "sql pool not initialized!");
+        }
+        /* other python threads may hold every connection, and they need the
+           GIL to give them back */
+        derr_t e2;
+        Py_BEGIN_ALLOW_THREADS
+        e2 = sql_pool_get(&self->pool->pool, &self->sql);
+        Py_END_ALLOW_THREADS
+        PROP(&e, e2);
+        self->_sql = true;
+        return e;
+    }
+
+    PROP(&e, dmysql_init(&self->mysql) );
 
     PROP_GO(&e,
         sql_connect_unix_ex(
-            &self->sql,
+            &self->mysql,
             self->_user ? &self->user : NULL,
             self->_pass ? &self->pass : NULL,
             &self->sock,
@@ -69,16 +117,22 @@ derr_t smsql_connect(py_smsql_t *self){
         ),
     fail_sql);
 
+    self->sql = &self->mysql;
     self->_sql = true;
     return e;
 
 fail_sql:
-    mysql_close(&self->sql);
+    sql_close(&self->mysql);
     return e;
 }
 
 void smsql_close(py_smsql_t *self){
     if(!self->_sql) return;
-    mysql_close(&self->sql);
+    if(self->pool){
+        sql_pool_put(&self->pool->pool, self->sql);
+    }else{
+        sql_close(&self->mysql);
+    }
+    self->sql = &self->mysql;
     self->_sql = false;
 }
@@ -46,6 +46,88 @@ static void raise_derr(derr_t *e){
     DROP_VAR(e);
 }
 
+static void py_sqlpool_dealloc(py_sqlpool_t *self){
+    sqlpool_deinit(self);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int py_sqlpool_init(
+    py_sqlpool_t *self, PyObject *args, PyObject *kwds
+){
+    derr_t e = E_OK;
+
+    unsigned int size = 1;
+    dstr_t *db = &DSTR_LIT("splintermail");
+    dstr_t sock = DSTR_LIT("/var/run/mysqld/mysqld.sock");
+    dstr_t *user = NULL;
+    dstr_t *pass = NULL;
+
+    pyarg_i *spec[] = {
+        NULL, // begin optionals
+        PU("size", &size),
+        PDN("db", &db),
+        PD("sock", &sock),
+        PDN("user", &user),
+        PDN("pass", &pass),
+    };
+    size_t nspec = sizeof(spec)/sizeof(*spec);
+
+    PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
+
+    PROP_GO(&e, sqlpool_init(self, size, sock, user, pass, db), fail);
+
+    return 0;
+
+fail:
+    raise_derr(&e);
+    return -1;
+}
+
+static PyObject *py_sqlpool_stats(py_sqlpool_t *self){
+    if(!self->_pool){
+        PyErr_SetString(pysm_error, "sql pool not initialized");
+        return NULL;
+    }
+    sql_pool_stats_t stats = sql_pool_stats(&self->pool);
+    return Py_BuildValue(
+        "{s:K,s:K,s:K,s:K,s:K,s:K}",
+        "checkouts", (unsigned long long)stats.checkouts,
+        "waits", (unsigned long long)stats.waits,
+        "wait_ns", (unsigned long long)stats.wait_ns,
+        "connects", (unsigned long long)stats.connects,
+        "prepares", (unsigned long long)stats.prepares,
+        "reuses", (unsigned long long)stats.reuses
+    );
+}
+
+static PyMethodDef py_sqlpool_methods[] = {
+    {
+        .ml_name = "stats",
+        .ml_meth = (PyCFunction)(void*)py_sqlpool_stats,
+        .ml_flags = METH_NOARGS,
+        .ml_doc = "stats() -> dict\n"
+            "Pool counters: checkouts, waits, wait_ns, connects, prepares, "
+            "and reuses (executions of an already-prepared statement).",
+    },
+    {NULL},  // sentinel
+};
+
+static PyTypeObject py_sqlpool_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    // this needs to be dotted to work with pickle and pydoc
+    .tp_name = "pysm.SQLPool",
+    .tp_doc = "a pool of sql connections with cached prepared statements; "
+        "pass as SMSQL(pool=...)",
+    .tp_basicsize = sizeof(py_sqlpool_t),
+    // 0 means "size is not variable"
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_dealloc = (destructor) py_sqlpool_dealloc,
+    .tp_methods = py_sqlpool_methods,
+    .tp_init = (initproc)py_sqlpool_init,
+};
+
 static void py_smsql_dealloc(py_smsql_t *self){
     smsql_deinit(self);
     Py_TYPE(self)->tp_free((PyObject*)self);
@@ -58,6 +140,7 @@ static int py_smsql_init(py_smsql_t *self, PyObject *args, PyObject *kwds){
     dstr_t sock = DSTR_LIT("/var/run/mysqld/mysqld.sock");
     dstr_t *user = NULL;
     dstr_t *pass = NULL;
+    PyObject *pool = NULL;
 
     pyarg_i *spec[] = {
         NULL, // begin optionals
@@ -65,12 +148,22 @@ static int py_smsql_init(py_smsql_t *self, PyObject *args, PyObject *kwds){
         PD("sock", &sock),
         PDN("user", &user),
         PDN("pass", &pass),
+        PO("pool", &pool),
     };
     size_t nspec = sizeof(spec)/sizeof(*spec);
 
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, smsql_init(self, sock, user, pass, db), fail);
+    // with a pool, the connection parameters come from the pool instead
+    if(pool == Py_None) pool = NULL;
+    if(pool && !PyObject_TypeCheck(pool, &py_sqlpool_type)){
+        PyErr_SetString(PyExc_TypeError, "pool must be a pysm.SQLPool");
+        return -1;
+    }
+
+    PROP_GO(&e,
+        smsql_init(self, sock, user, pass, db, (py_sqlpool_t*)pool),
+    fail);
 
     return 0;
 
@@ -137,7 +230,7 @@ static PyObject *py_smsql_get_uuid(
     DSTR_VAR(uuid, SMSQL_UUID_SIZE);
     bool ok;
 
-    PROP_GO(&e, get_uuid_for_email(&self->sql, email, &uuid, &ok), fail);
+    PROP_GO(&e, get_uuid_for_email(self->sql, email, &uuid, &ok), fail);
 
     return BUILD_OPTIONAL_BYTES(uuid, ok);
 
@@ -164,7 +257,7 @@ static PyObject *py_smsql_get_email(
     DSTR_VAR(email, SMSQL_EMAIL_SIZE);
     bool ok;
 
-    PROP_GO(&e, get_email_for_uuid(&self->sql, uuid, &email, &ok), fail);
+    PROP_GO(&e, get_email_for_uuid(self->sql, uuid, &email, &ok), fail);
 
     return BUILD_OPTIONAL_STRING(email, ok);
 
@@ -189,7 +282,7 @@ static PyObject *py_smsql_list_aliases(
 
     link_t aliases;
     link_init(&aliases);
-    PROP_GO(&e, list_aliases(&self->sql, uuid, &aliases), fail);
+    PROP_GO(&e, list_aliases(self->sql, uuid, &aliases), fail);
 
     // count entries
     Py_ssize_t count = 0;
@@ -257,7 +350,7 @@ static PyObject *py_smsql_add_random_alias(
 
     DSTR_VAR(alias, SMSQL_EMAIL_SIZE);
 
-    PROP_GO(&e, add_random_alias(&self->sql, uuid, &alias), fail);
+    PROP_GO(&e, add_random_alias(self->sql, uuid, &alias), fail);
 
     return BUILD_STRING(alias);
 
@@ -283,7 +376,7 @@ static PyObject *py_smsql_add_primary_alias(
     size_t nspec = sizeof(spec)/sizeof(*spec);
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, add_primary_alias(&self->sql, uuid, alias), fail);
+    PROP_GO(&e, add_primary_alias(self->sql, uuid, alias), fail);
 
     Py_RETURN_NONE;
 
@@ -309,7 +402,7 @@ static PyObject *py_smsql_delete_alias(
     size_t nspec = sizeof(spec)/sizeof(*spec);
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, delete_alias(&self->sql, uuid, alias), fail);
+    PROP_GO(&e, delete_alias(self->sql, uuid, alias), fail);
 
     Py_RETURN_NONE;
 
@@ -333,7 +426,7 @@ static PyObject *py_smsql_delete_all_aliases(
     size_t nspec = sizeof(spec)/sizeof(*spec);
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, delete_all_aliases(&self->sql, uuid), fail);
+    PROP_GO(&e, delete_all_aliases(self->sql, uuid), fail);
 
     Py_RETURN_NONE;
 
@@ -361,7 +454,7 @@ static PyObject *py_smsql_list_device_fprs(
 
     link_t dstrs;
     link_init(&dstrs);
-    PROP_GO(&e, list_device_fprs(&self->sql, uuid, &dstrs), fail);
+    PROP_GO(&e, list_device_fprs(self->sql, uuid, &dstrs), fail);
 
     // count entries
     Py_ssize_t count = 0;
@@ -424,7 +517,7 @@ static PyObject *py_smsql_list_device_keys(
 
     link_t dstrs;
     link_init(&dstrs);
-    PROP_GO(&e, list_device_keys(&self->sql, uuid, &dstrs), fail);
+    PROP_GO(&e, list_device_keys(self->sql, uuid, &dstrs), fail);
 
     // count entries
     Py_ssize_t count = 0;
@@ -488,7 +581,7 @@ static PyObject *py_smsql_add_device(
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
     DSTR_VAR(fpr, SMSQL_FPR_SIZE);
-    PROP_GO(&e, add_device(&self->sql, uuid, pubkey, &fpr), fail);
+    PROP_GO(&e, add_device(self->sql, uuid, pubkey, &fpr), fail);
 
     return BUILD_STRING(fpr);
 
@@ -515,7 +608,7 @@ static PyObject *py_smsql_delete_device(
     size_t nspec = sizeof(spec)/sizeof(*spec);
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, delete_device(&self->sql, uuid, fpr), fail);
+    PROP_GO(&e, delete_device(self->sql, uuid, fpr), fail);
 
     Py_RETURN_NONE;
 
@@ -543,7 +636,7 @@ static PyObject *py_smsql_list_tokens(
 
     link_t tokens;
     link_init(&tokens);
-    PROP_GO(&e, list_tokens(&self->sql, uuid, &tokens), fail);
+    PROP_GO(&e, list_tokens(self->sql, uuid, &tokens), fail);
 
     // count entries
     Py_ssize_t count = 0;
@@ -604,7 +697,7 @@ static PyObject *py_smsql_add_token(
 
     unsigned int token;
     DSTR_VAR(secret, SMSQL_APISECRET_SIZE);
-    PROP_GO(&e, add_token(&self->sql, uuid, &token, &secret), fail);
+    PROP_GO(&e, add_token(self->sql, uuid, &token, &secret), fail);
 
     // I = unsigned int
     // s# = string with length
@@ -632,7 +725,7 @@ static PyObject *py_smsql_delete_token(
     size_t nspec = sizeof(spec)/sizeof(*spec);
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, delete_token(&self->sql, uuid, token), fail);
+    PROP_GO(&e, delete_token(self->sql, uuid, token), fail);
 
     Py_RETURN_NONE;
 
@@ -660,7 +753,7 @@ static PyObject *py_smsql_list_installations(
 
     link_t subdomains;
     link_init(&subdomains);
-    PROP_GO(&e, list_installations(&self->sql, uuid, &subdomains), fail);
+    PROP_GO(&e, list_installations(self->sql, uuid, &subdomains), fail);
 
     // count entries
     Py_ssize_t count = 0;
@@ -728,7 +821,7 @@ static PyObject *py_smsql_add_installation(
     DSTR_VAR(email, SMSQL_EMAIL_SIZE);
     PROP_GO(&e,
         add_installation(
-            &self->sql, uuid, &inst_uuid, &token, &secret, &subdomain, &email
+            self->sql, uuid, &inst_uuid, &token, &secret, &subdomain, &email
         ),
     fail);
 
@@ -768,7 +861,7 @@ static PyObject *py_smsql_delete_installation(
     size_t nspec = sizeof(spec)/sizeof(*spec);
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, delete_installation(&self->sql, uuid, subdomain), fail);
+    PROP_GO(&e, delete_installation(self->sql, uuid, subdomain), fail);
 
     Py_RETURN_NONE;
 
@@ -792,7 +885,7 @@ static PyObject *py_smsql_delete_installation_by_token(
     size_t nspec = sizeof(spec)/sizeof(*spec);
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, delete_installation_by_token(&self->sql, inst_uuid), fail);
+    PROP_GO(&e, delete_installation_by_token(self->sql, inst_uuid), fail);
 
     Py_RETURN_NONE;
 
@@ -817,7 +910,7 @@ static PyObject *py_smsql_set_challenge(
     size_t nspec = sizeof(spec)/sizeof(*spec);
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, set_challenge(&self->sql, inst_uuid, challenge), fail);
+    PROP_GO(&e, set_challenge(self->sql, inst_uuid, challenge), fail);
 
     Py_RETURN_NONE;
 
@@ -840,7 +933,7 @@ static PyObject *py_smsql_delete_challenge(
     size_t nspec = sizeof(spec)/sizeof(*spec);
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, delete_challenge(&self->sql, inst_uuid), fail);
+    PROP_GO(&e, delete_challenge(self->sql, inst_uuid), fail);
 
     Py_RETURN_NONE;
 
@@ -860,7 +953,7 @@ static PyObject *py_smsql_list_challenges(
 
     link_t dpairs;
     link_init(&dpairs);
-    PROP_GO(&e, list_challenges(&self->sql, &dpairs), fail);
+    PROP_GO(&e, list_challenges(self->sql, &dpairs), fail);
 
     // count entries
     Py_ssize_t count = 0;
@@ -932,7 +1025,7 @@ static PyObject *py_smsql_create_account(
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
     DSTR_VAR(uuid, SMSQL_UUID_SIZE);
-    PROP_GO(&e, create_account(&self->sql, email, pass, &uuid), fail);
+    PROP_GO(&e, create_account(self->sql, email, pass, &uuid), fail);
 
     return BUILD_BYTES(uuid);
 
@@ -955,7 +1048,7 @@ static PyObject *py_smsql_delete_account(
     size_t nspec = sizeof(spec)/sizeof(*spec);
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, delete_account(&self->sql, uuid), fail);
+    PROP_GO(&e, delete_account(self->sql, uuid), fail);
 
     Py_RETURN_NONE;
 
@@ -984,7 +1077,7 @@ static PyObject *py_smsql_account_info(
     size_t paids;
     size_t frees;
 
-    PROP_GO(&e, account_info(&self->sql, uuid, &dvcs, &paids, &frees), fail);
+    PROP_GO(&e, account_info(self->sql, uuid, &dvcs, &paids, &frees), fail);
 
     // k = unsigned long
     return Py_BuildValue(
@@ -1017,7 +1110,7 @@ static PyObject *py_smsql_validate_login(
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
     DSTR_VAR(uuid, SMSQL_UUID_SIZE);
-    PROP_GO(&e, validate_login(&self->sql, email, pass, &uuid), fail);
+    PROP_GO(&e, validate_login(self->sql, email, pass, &uuid), fail);
 
     return BUILD_BYTES(uuid);
 
@@ -1059,7 +1152,7 @@ static PyObject *py_smsql_validate_token_auth(
     DSTR_VAR(uuid, SMSQL_UUID_SIZE);
     PROP_GO(&e,
         validate_token_auth(
-            &self->sql, token, nonce, payload, signature, &uuid
+            self->sql, token, nonce, payload, signature, &uuid
         ),
     fail);
 
@@ -1103,7 +1196,7 @@ static PyObject *py_smsql_validate_installation_auth(
     DSTR_VAR(inst_uuid, SMSQL_UUID_SIZE);
     PROP_GO(&e,
         validate_installation_auth(
-            &self->sql, token, nonce, payload, signature, &inst_uuid
+            self->sql, token, nonce, payload, signature, &inst_uuid
         ),
     fail);
 
@@ -1130,7 +1223,7 @@ static PyObject *py_smsql_change_password(
     size_t nspec = sizeof(spec)/sizeof(*spec);
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, change_password(&self->sql, uuid, pass), fail);
+    PROP_GO(&e, change_password(self->sql, uuid, pass), fail);
 
     Py_RETURN_NONE;
 
@@ -1163,7 +1256,7 @@ static PyObject *py_smsql_validate_session_auth(
 
     DSTR_VAR(uuid, SMSQL_UUID_SIZE);
     PROP_GO(&e,
-        validate_session_auth(&self->sql, server_id, session_id, &uuid),
+        validate_session_auth(self->sql, server_id, session_id, &uuid),
     fail);
 
     return BUILD_BYTES(uuid);
@@ -1190,7 +1283,7 @@ static PyObject *py_smsql_validate_csrf(
     size_t nspec = sizeof(spec)/sizeof(*spec);
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, validate_csrf(&self->sql, session_id, csrf), fail);
+    PROP_GO(&e, validate_csrf(self->sql, session_id, csrf), fail);
 
     Py_RETURN_NONE;
 
@@ -1216,7 +1309,7 @@ static PyObject *py_smsql_user_owns_addr(
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
     bool ok;
-    PROP_GO(&e, user_owns_address(&self->sql, uuid, address, &ok), fail);
+    PROP_GO(&e, user_owns_address(self->sql, uuid, address, &ok), fail);
 
     RETURN_BOOL(ok);
 
@@ -1251,7 +1344,7 @@ static PyObject *py_smsql_limit_check(
     bool msg_sent;
     unsigned int limit;
     PROP_GO(&e,
-        limit_check(&self->sql, uuid, recipients, &ok, &msg_sent, &limit),
+        limit_check(self->sql, uuid, recipients, &ok, &msg_sent, &limit),
     fail);
 
     // O = pyobject (boolean singletons)
@@ -1281,7 +1374,7 @@ static PyObject *py_smsql_gtid_current_pos(
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
     DSTR_VAR(buf, 1024);
-    PROP_GO(&e, gtid_current_pos(&self->sql, &buf), fail);
+    PROP_GO(&e, gtid_current_pos(self->sql, &buf), fail);
 
     return BUILD_STRING(buf);
 
@@ -1304,7 +1397,7 @@ static PyObject *py_smsql_trigger_deleter(
     size_t nspec = sizeof(spec)/sizeof(*spec);
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, trigger_deleter(&self->sql, uuid), fail);
+    PROP_GO(&e, trigger_deleter(self->sql, uuid), fail);
 
     Py_RETURN_NONE;
 
@@ -1329,7 +1422,7 @@ static PyObject *py_smsql_list_deletions(
 
     link_t dstrs;
     link_init(&dstrs);
-    PROP_GO(&e, list_deletions(&self->sql, server_id, &dstrs), fail);
+    PROP_GO(&e, list_deletions(self->sql, server_id, &dstrs), fail);
 
     // count entries
     Py_ssize_t count = 0;
@@ -1390,7 +1483,7 @@ static PyObject *py_smsql_deletions_finished_one(
     size_t nspec = sizeof(spec)/sizeof(*spec);
     PROP_GO(&e, pyarg_parse(args, kwds, spec, nspec), fail);
 
-    PROP_GO(&e, deletions_finished_one(&self->sql, server_id, uuid), fail);
+    PROP_GO(&e, deletions_finished_one(self->sql, server_id, uuid), fail);
 
     Py_RETURN_NONE;
 
@@ -1973,6 +2066,7 @@ PyObject* PyInit_pysm(void){
         return NULL;
     }
 
+    if (PyType_Ready(&py_sqlpool_type) < 0) return NULL;
     if (PyType_Ready(&py_smsql_type) < 0) return NULL;
 
     PyObject *module = PyModule_Create(&pysm_module);
@@ -1984,6 +2078,10 @@ PyObject* PyInit_pysm(void){
     ret = PyModule_AddObject(module, "SMSQL", (PyObject*)&py_smsql_type);
     if(ret < 0) goto fail_py_smsql;
 
+    Py_INCREF((PyObject*)&py_sqlpool_type);
+    ret = PyModule_AddObject(module, "SQLPool", (PyObject*)&py_sqlpool_type);
+    if(ret < 0) goto fail_py_sqlpool;
+
     pysm_error = PyErr_NewException("pysm.PysmError", NULL, NULL);
     Py_INCREF(pysm_error);
     ret = PyModule_AddObject(module, "PysmError", pysm_error);
@@ -2000,6 +2098,8 @@ fail_user_error:
     Py_DECREF((PyObject*)&user_error);
 fail_pysm_error:
     Py_DECREF((PyObject*)&pysm_error);
+fail_py_sqlpool:
+    Py_DECREF((PyObject*)&py_sqlpool_type);
 fail_py_smsql:
     Py_DECREF((PyObject*)&py_smsql_type);
     Py_DECREF(module);
@@ -20,6 +20,23 @@
 // some python error has already been raised
 extern derr_type_t E_NORAISE;
 
+// custom type; a pool of MYSQL connections which SMSQL objects can borrow
+typedef struct {
+    PyObject_HEAD
+    bool _pool;
+    sql_pool_t pool;
+} py_sqlpool_t;
+
+derr_t sqlpool_init(
+    py_sqlpool_t *self,
+    size_t size,
+    const dstr_t sock,
+    const dstr_t *user,
+    const dstr_t *pass,
+    const dstr_t *db
+);
+void sqlpool_deinit(py_sqlpool_t *self);
+
 // custom type; represents a MYSQL connection
 typedef struct {
     PyObject_HEAD
@@ -30,16 +47,22 @@ typedef struct {
     dstr_t pass;
     bool _db;
     dstr_t db;
+    // if set, connections are borrowed from the pool (we hold a reference)
+    py_sqlpool_t *pool;
     bool _sql;
-    MYSQL sql;
+    sql_t mysql;
+    // either &mysql or a connection borrowed from the pool
+    sql_t *sql;
 } py_smsql_t;
 
+// pool may be NULL
 derr_t smsql_init(
     py_smsql_t *self,
     const dstr_t sock,
     const dstr_t *user,
     const dstr_t *pass,
-    const dstr_t *db
+    const dstr_t *db,
+    py_sqlpool_t *pool
 );
 void smsql_deinit(py_smsql_t *self);
 
@@ -37,6 +37,18 @@ def set_pysm_logging() -> None:
         pysm.log_to_file(config.logfile, "debug")
 
 
+_sql_pool = None
+
+
+def get_sql_pool() -> typing.Any:
+    # created lazily, like the logging above, so that it is made after any
+    # forking; connections in the pool keep their prepared statements
+    global _sql_pool
+    if _sql_pool is None:
+        _sql_pool = pysm.SQLPool(size=4, sock=config.sqlsock)
+    return _sql_pool
+
+
 JsonObj = typing.Dict[str, typing.Any]
 
 
@@ -388,7 +400,7 @@ def app(environ: typing.Dict[str, typing.Any]) -> Response:
 
     arg = body.get("arg")
 
-    with pysm.SMSQL(sock=config.sqlsock) as smsql:
+    with pysm.SMSQL(pool=get_sql_pool()) as smsql:
         return func(auth, arg, smsql)
 
 
@@ -97,22 +97,32 @@ static zend_string *print_error(derr_t e_in){
 }
 
 
-static derr_t _sql_init(MYSQL *sql){
+/* one connection per process, kept open between requests so that its
+   prepared statements are reused; php workers are single-threaded so the
+   pool never has to wait */
+static sql_pool_t sql_pool;
+static bool sql_pool_ready = false;
+
+static derr_t _sql_init(sql_t **sql){
     derr_t e = E_OK;
 
-    PROP(&e, dmysql_init(sql) );
+    if(!sql_pool_ready){
+        // connect with php.ini's sql_sock setting
+        char *sql_sock = (char *)smphp_globals.sql_sock;
+        dstr_t sock;
+        DSTR_WRAP(sock, sql_sock, strlen(sql_sock), true);
+        DSTR_STATIC(db, "splintermail");
+        PROP(&e, sql_pool_init(&sql_pool, 1, NULL, NULL, &sock, &db) );
+        sql_pool_ready = true;
+    }
 
-    // connect with php.ini's sql_sock setting
-    char *sql_sock = (char *)smphp_globals.sql_sock;
-    dstr_t sock;
-    DSTR_WRAP(sock, sql_sock, strlen(sql_sock), true);
-    PROP_GO(&e, sql_connect_unix(sql, NULL, NULL, &sock), fail);
+    PROP(&e, sql_pool_get(&sql_pool, sql) );
 
     return e;
+}
 
-fail:
-    mysql_close(sql);
-    return e;
+static void _sql_done(sql_t *sql){
+    sql_pool_put(&sql_pool, sql);
 }
 
 
@@ -136,13 +146,13 @@ static derr_t _create_account(
 ){
     derr_t e = E_OK;
 
-    MYSQL sql;
+    sql_t *sql;
     PROP(&e, _sql_init(&sql) );
 
-    PROP_GO(&e, create_account(&sql, email, pass, uuid), cu_sql);
+    PROP_GO(&e, create_account(sql, email, pass, uuid), cu_sql);
 
 cu_sql:
-    mysql_close(&sql);
+    _sql_done(sql);
 
     return e;
 }
@@ -150,13 +160,13 @@ cu_sql:
 static derr_t _login(const dstr_t email, const dstr_t pass, dstr_t *uuid){
     derr_t e = E_OK;
 
-    MYSQL sql;
+    sql_t *sql;
     PROP(&e, _sql_init(&sql) );
 
-    PROP_GO(&e, validate_login(&sql, email, pass, uuid), cu_sql);
+    PROP_GO(&e, validate_login(sql, email, pass, uuid), cu_sql);
 
 cu_sql:
-    mysql_close(&sql);
+    _sql_done(sql);
 
     return e;
 }
@@ -166,13 +176,13 @@ static derr_t _add_session_auth(
 ){
     derr_t e = E_OK;
 
-    MYSQL sql;
+    sql_t *sql;
     PROP(&e, _sql_init(&sql) );
 
-    PROP_GO(&e, add_session_auth(&sql, server_id, session_id, uuid), cu_sql);
+    PROP_GO(&e, add_session_auth(sql, server_id, session_id, uuid), cu_sql);
 
 cu_sql:
-    mysql_close(&sql);
+    _sql_done(sql);
 
     return e;
 }
@@ -183,18 +193,18 @@ static derr_t _validate_session_auth(
 ){
     derr_t e = E_OK;
 
-    MYSQL sql;
+    sql_t *sql;
     PROP(&e, _sql_init(&sql) );
 
     // validate session
     DSTR_VAR(uuid, SMSQL_UUID_SIZE);
     PROP_GO(&e,
-        validate_session_auth(&sql, server_id, session_id, &uuid),
+        validate_session_auth(sql, server_id, session_id, &uuid),
     cu_sql);
 
     // lookup username (useful to php)
     bool ok;
-    PROP_GO(&e, get_email_for_uuid(&sql, uuid, email, &ok), cu_sql);
+    PROP_GO(&e, get_email_for_uuid(sql, uuid, email, &ok), cu_sql);
     if(!ok){
         // this is possible in race conditions but it's more likely a bug
         TRACE(&e, "session_id:%x uuid:%x", FD(session_id), FSID(uuid));
@@ -202,7 +212,7 @@ static derr_t _validate_session_auth(
     }
 
 cu_sql:
-    mysql_close(&sql);
+    _sql_done(sql);
 
     return e;
 }
@@ -210,13 +220,13 @@ cu_sql:
 static derr_t _session_logout(int server_id, const dstr_t session_id){
     derr_t e = E_OK;
 
-    MYSQL sql;
+    sql_t *sql;
     PROP(&e, _sql_init(&sql) );
 
-    PROP_GO(&e, session_logout(&sql, server_id, session_id), cu_sql);
+    PROP_GO(&e, session_logout(sql, server_id, session_id), cu_sql);
 
 cu_sql:
-    mysql_close(&sql);
+    _sql_done(sql);
 
     return e;
 }
@@ -227,13 +237,13 @@ static derr_t _new_csrf(
 ){
     derr_t e = E_OK;
 
-    MYSQL sql;
+    sql_t *sql;
     PROP(&e, _sql_init(&sql) );
 
-    PROP_GO(&e, new_csrf(&sql, server_id, session_id, csrf), cu_sql);
+    PROP_GO(&e, new_csrf(sql, server_id, session_id, csrf), cu_sql);
 
 cu_sql:
-    mysql_close(&sql);
+    _sql_done(sql);
 
     return e;
 }
@@ -460,6 +470,23 @@ fail:
     return;
 }
 
+// $stats = smphp_sql_stats()
+// returns an array of this process's sql pool counters
+PHP_FUNCTION(smphp_sql_stats){
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    sql_pool_stats_t stats = {0};
+    if(sql_pool_ready) stats = sql_pool_stats(&sql_pool);
+
+    array_init(return_value);
+    add_assoc_long(return_value, "checkouts", (zend_long)stats.checkouts);
+    add_assoc_long(return_value, "waits", (zend_long)stats.waits);
+    add_assoc_long(return_value, "wait_ns", (zend_long)stats.wait_ns);
+    add_assoc_long(return_value, "connects", (zend_long)stats.connects);
+    add_assoc_long(return_value, "prepares", (zend_long)stats.prepares);
+    add_assoc_long(return_value, "reuses", (zend_long)stats.reuses);
+}
+
 PHP_MINIT_FUNCTION(smphp){
     REGISTER_INI_ENTRIES();
 
@@ -477,6 +504,10 @@ PHP_MINIT_FUNCTION(smphp){
 }
 
 PHP_MSHUTDOWN_FUNCTION(smphp){
+    if(sql_pool_ready){
+        sql_pool_free(&sql_pool);
+        sql_pool_ready = false;
+    }
     mysql_library_end();
     return SUCCESS;
 }
@@ -526,6 +557,9 @@ ZEND_BEGIN_ARG_INFO(arginfo_smphp_new_csrf, 2)
     ZEND_ARG_INFO(0, session_id)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO(arginfo_smphp_sql_stats, 0)
+ZEND_END_ARG_INFO()
+
 #define SMPHP_FE(fn) PHP_FE(smphp_ ## fn, arginfo_smphp_ ## fn)
 static const zend_function_entry smphp_functions[] = {
     SMPHP_FE(valid_email)
@@ -536,6 +570,7 @@ static const zend_function_entry smphp_functions[] = {
     SMPHP_FE(validate_session_auth)
     SMPHP_FE(session_logout)
     SMPHP_FE(new_csrf)
+    SMPHP_FE(sql_stats)
     PHP_FE_END
 };
 #undef SMPHP_FE
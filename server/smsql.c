@@ -12,7 +12,7 @@ typedef struct {
     const dstr_t *pass;
 } config_t;
 
-typedef derr_t (*action_f)(MYSQL *sql, int argc, char **argv);
+typedef derr_t (*action_f)(sql_t *sql, int argc, char **argv);
 
 static dstr_t get_arg(char **argv, size_t idx){
     dstr_t out;
@@ -21,7 +21,7 @@ static dstr_t get_arg(char **argv, size_t idx){
 }
 
 // handle (EMAIL|FSID)-like args
-static derr_t get_uuid_from_id(MYSQL *sql, const dstr_t id, dstr_t *uuid){
+static derr_t get_uuid_from_id(sql_t *sql, const dstr_t id, dstr_t *uuid){
     derr_t e = E_OK;
 
     // check for '@' characters
@@ -40,7 +40,7 @@ static derr_t get_uuid_from_id(MYSQL *sql, const dstr_t id, dstr_t *uuid){
 
 //
 
-static derr_t get_uuid_action(MYSQL *sql, int argc, char **argv){
+static derr_t get_uuid_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -61,7 +61,7 @@ static derr_t get_uuid_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t get_email_action(MYSQL *sql, int argc, char **argv){
+static derr_t get_email_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -87,7 +87,7 @@ static derr_t get_email_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t hash_password_action(MYSQL *sql, int argc, char **argv){
+static derr_t hash_password_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
     (void)sql;
 
@@ -108,7 +108,7 @@ static derr_t hash_password_action(MYSQL *sql, int argc, char **argv){
 
 // aliases
 
-static derr_t list_aliases_action(MYSQL *sql, int argc, char **argv){
+static derr_t list_aliases_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -140,7 +140,7 @@ static derr_t list_aliases_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t add_random_alias_action(MYSQL *sql, int argc, char **argv){
+static derr_t add_random_alias_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -160,7 +160,7 @@ static derr_t add_random_alias_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t add_primary_alias_action(MYSQL *sql, int argc, char **argv){
+static derr_t add_primary_alias_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 2){
@@ -178,7 +178,7 @@ static derr_t add_primary_alias_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t delete_alias_action(MYSQL *sql, int argc, char **argv){
+static derr_t delete_alias_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 2){
@@ -197,7 +197,7 @@ static derr_t delete_alias_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t delete_all_aliases_action(MYSQL *sql, int argc, char **argv){
+static derr_t delete_all_aliases_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -218,7 +218,7 @@ static derr_t delete_all_aliases_action(MYSQL *sql, int argc, char **argv){
 
 // devices
 
-static derr_t list_device_fprs_action(MYSQL *sql, int argc, char **argv){
+static derr_t list_device_fprs_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -244,7 +244,7 @@ static derr_t list_device_fprs_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t list_device_keys_action(MYSQL *sql, int argc, char **argv){
+static derr_t list_device_keys_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -270,7 +270,7 @@ static derr_t list_device_keys_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t get_device_action(MYSQL *sql, int argc, char **argv){
+static derr_t get_device_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 2){
@@ -296,7 +296,7 @@ static derr_t get_device_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t add_device_action(MYSQL *sql, int argc, char **argv){
+static derr_t add_device_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -319,7 +319,7 @@ static derr_t add_device_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t delete_device_action(MYSQL *sql, int argc, char **argv){
+static derr_t delete_device_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 2){
@@ -341,7 +341,7 @@ static derr_t delete_device_action(MYSQL *sql, int argc, char **argv){
 
 // tokens
 
-static derr_t list_tokens_action(MYSQL *sql, int argc, char **argv){
+static derr_t list_tokens_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -367,7 +367,7 @@ static derr_t list_tokens_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t add_token_action(MYSQL *sql, int argc, char **argv){
+static derr_t add_token_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -389,7 +389,7 @@ static derr_t add_token_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t delete_token_action(MYSQL *sql, int argc, char **argv){
+static derr_t delete_token_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 2){
@@ -414,7 +414,7 @@ static derr_t delete_token_action(MYSQL *sql, int argc, char **argv){
 
 // installations
 
-static derr_t list_installations_action(MYSQL *sql, int argc, char **argv){
+static derr_t list_installations_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -440,7 +440,7 @@ static derr_t list_installations_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t add_installation_action(MYSQL *sql, int argc, char **argv){
+static derr_t add_installation_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -477,7 +477,7 @@ static derr_t add_installation_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t delete_installation_action(MYSQL *sql, int argc, char **argv){
+static derr_t delete_installation_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -498,7 +498,7 @@ static derr_t delete_installation_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t subdomain_user_action(MYSQL *sql, int argc, char **argv){
+static derr_t subdomain_user_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -523,7 +523,7 @@ static derr_t subdomain_user_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t set_challenge_action(MYSQL *sql, int argc, char **argv){
+static derr_t set_challenge_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 2){
@@ -545,7 +545,7 @@ static derr_t set_challenge_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t delete_challenge_action(MYSQL *sql, int argc, char **argv){
+static derr_t delete_challenge_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -566,7 +566,7 @@ static derr_t delete_challenge_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t list_challenges_action(MYSQL *sql, int argc, char **argv){
+static derr_t list_challenges_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
     (void)argv;
 
@@ -590,7 +590,7 @@ static derr_t list_challenges_action(MYSQL *sql, int argc, char **argv){
 
 // misc
 
-static derr_t create_account_action(MYSQL *sql, int argc, char **argv){
+static derr_t create_account_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 2){
@@ -609,7 +609,7 @@ static derr_t create_account_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t delete_account_action(MYSQL *sql, int argc, char **argv){
+static derr_t delete_account_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -633,7 +633,7 @@ static derr_t delete_account_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t account_info_action(MYSQL *sql, int argc, char **argv){
+static derr_t account_info_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -660,7 +660,7 @@ static derr_t account_info_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t validate_password_action(MYSQL *sql, int argc, char **argv){
+static derr_t validate_password_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 2){
@@ -683,7 +683,7 @@ static derr_t validate_password_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t change_password_action(MYSQL *sql, int argc, char **argv){
+static derr_t change_password_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 2){
@@ -704,7 +704,7 @@ static derr_t change_password_action(MYSQL *sql, int argc, char **argv){
 }
 
 
-static derr_t user_owns_address_action(MYSQL *sql, int argc, char **argv){
+static derr_t user_owns_address_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 2){
@@ -726,7 +726,7 @@ static derr_t user_owns_address_action(MYSQL *sql, int argc, char **argv){
 }
 
 
-static derr_t gtid_current_pos_action(MYSQL *sql, int argc, char **argv){
+static derr_t gtid_current_pos_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
     (void)argv;
 
@@ -742,7 +742,7 @@ static derr_t gtid_current_pos_action(MYSQL *sql, int argc, char **argv){
     return e;
 }
 
-static derr_t list_deletions_action(MYSQL *sql, int argc, char **argv){
+static derr_t list_deletions_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
 
     if(argc != 1){
@@ -774,7 +774,7 @@ static derr_t list_deletions_action(MYSQL *sql, int argc, char **argv){
 
 // sysadmin utils
 
-static derr_t list_users_action(MYSQL *sql, int argc, char **argv){
+static derr_t list_users_action(sql_t *sql, int argc, char **argv){
     derr_t e = E_OK;
     (void)argv;
 
@@ -814,7 +814,7 @@ static derr_t smsql(
 
     PROP(&e, dmysql_library_init() );
 
-    MYSQL sql;
+    sql_t sql;
     PROP_GO(&e, dmysql_init(&sql), cu_sql_lib);
 
     PROP_GO(&e, sql_connect_unix(&sql, user, pass, sock), cu_sql);
@@ -822,7 +822,7 @@ static derr_t smsql(
     PROP_GO(&e, action(&sql, argc, argv), cu_sql);
 
 cu_sql:
-    mysql_close(&sql);
+    sql_close(&sql);
 
 cu_sql_lib:
     mysql_library_end();
@@ -25,7 +25,7 @@ static derr_t add_key(
     DSTR_VAR(d_sock, 256);
     PROP(&e, FMT(&d_sock, "%x", FS(sock)) );
 
-    MYSQL sql;
+    sql_t sql;
     PROP(&e, dmysql_init(&sql) );
 
     PROP_GO(&e, sql_connect_unix(&sql, NULL, NULL, &d_sock), cu_sql);
@@ -33,7 +33,7 @@ static derr_t add_key(
     PROP_GO(&e, add_device(&sql, uuid, pubkey, fpr), cu_sql);
 
 cu_sql:
-    mysql_close(&sql);
+    sql_close(&sql);
 
     return e;
 }
@@ -31,31 +31,105 @@
 
     Code is patterned after dovecot/src/imap/cmd-idle.c, since the mechanics of
     XKEYSYNC (long-running, exitable with a DONE, etc) are very similar.
+
+    Change detection:
+
+        Rather than each XKEYSYNC polling its user's devices, every XKEYSYNC in
+        a dovecot process shares one watcher.  The watcher polls the
+        device_changes table, which is one cheap query per process no matter
+        how many clients are syncing, and only wakes the XKEYSYNC commands of
+        users whose devices actually changed.  Each user's fingerprint list is
+        also cached in the watcher, so multiple connections for one user only
+        read the devices table once per change.
+
+        The watcher keeps one sql connection open for as long as any XKEYSYNC
+        is running in the process, and only reconnects after an error.
+
+        Each poll asks only for seqs after the last one seen.  An
+        auto_increment seq can become visible after a higher one (two
+        transactions that commit out of order), so any seqs skipped over are
+        remembered as gaps, and polls start below the lowest open gap until it
+        fills or ages out (a rolled-back INSERT leaves a permanent gap).
 */
 
 #include "xkey.h"
 
+enum exit_msg {
+    EXIT_EXPECTED_DONE = 0,
+    EXIT_OK = 1,
+    EXIT_INTERNAL_ERROR,
+};
+
+// how often the watcher polls device_changes
+#define XKEYSYNC_POLL_MSEC 3000
+// how long a skipped seq may take to commit before we stop waiting for it
+#define XKEYSYNC_GAP_SEC 30
+// how many skipped seqs we remember at once; the newest ones are kept
+#define XKEYSYNC_MAX_GAPS 64
+
+// a seq we skipped over, which may still commit
+typedef struct {
+    uint64_t seq;
+    time_t since;
+} seq_gap_t;
+
+// one user's fingerprints, shared by every XKEYSYNC for that user
+typedef struct {
+    dstr_t uuid;
+    char uuid_buffer[SMSQL_UUID_SIZE];
+    // smsql_dstr_t's, sorted
+    link_t fprs;
+    // false until loaded, and again after the watcher sees a change
+    bool fresh;
+    size_t refs;
+    hash_elem_t h;
+} user_fprs_t;
+DEF_CONTAINER_OF(user_fprs_t, h, hash_elem_t)
+
 struct cmd_xkeysync_context {
     struct client *client;
     struct client_command_context *cmd;
 
     struct timeout *keepalive_to;
-    struct timeout *checker_to;
 
     link_t known_fprs;
     dstr_t uuid;
     char uuid_buffer[SMSQL_UUID_SIZE];
+    user_fprs_t *user;
+    // a check is owed, either due to a change or to retry a failure
+    bool dirty;
     int retries;
+    // for the watcher's list of contexts
+    link_t link;
+};
+// a typedef, just for CONTAINER_OF
+typedef struct cmd_xkeysync_context cmd_xkeysync_context_t;
+DEF_CONTAINER_OF(cmd_xkeysync_context_t, link, link_t)
+
+// process-wide state; dovecot plugins are single-threaded
+static struct {
+    // users is only initialized while there are ctxs
+    link_t ctxs;
+    hashmap_t users;
+    // the device_changes high-water mark we have already handled
+    uint64_t seq;
+    // open gaps below seq, sorted by seq
+    seq_gap_t gaps[XKEYSYNC_MAX_GAPS];
+    size_t ngaps;
+    struct timeout *poll_to;
+    char sock_buffer[256];
+    dstr_t sock;
+    // persistent connection, only valid when sql_ok is set
+    sql_t sql;
+    bool sql_ok;
+} watcher = {
+    .ctxs = { .prev = &watcher.ctxs, .next = &watcher.ctxs },
 };
 
 static void xkeysync_add_keepalive_timeout(struct cmd_xkeysync_context *ctx);
-static void xkeysync_add_checker_timeout(struct cmd_xkeysync_context *ctx);
-
-enum exit_msg {
-    EXIT_EXPECTED_DONE = 0,
-    EXIT_OK = 1,
-    EXIT_INTERNAL_ERROR,
-};
+static void xkeysync_finish(
+    struct cmd_xkeysync_context *ctx, enum exit_msg exit_msg, bool free_cmd
+);
 
 /* We only need to sort lists that the client sends us.  This is not an
    efficient sort but realistically we only need to sort a few fprs.  We can
@@ -137,8 +211,30 @@ static derr_t report_one_deleted(const dstr_t fpr, struct client *client){
     return e;
 }
 
+static derr_t copy_fpr_list(link_t *from, link_t *to){
+    derr_t e = E_OK;
+
+    link_t temp;
+    link_init(&temp);
+
+    smsql_dstr_t *fpr;
+    LINK_FOR_EACH(fpr, from, smsql_dstr_t, link){
+        smsql_dstr_t *copy;
+        PROP_GO(&e, smsql_dstr_new(&copy, fpr->dstr), fail);
+        link_list_append(&temp, &copy->link);
+    }
+
+    link_list_append_list(to, &temp);
+
+    return e;
+
+fail:
+    free_fpr_list(&temp);
+    return e;
+}
+
 static derr_t report_one_created(
-    const dstr_t fpr, struct cmd_xkeysync_context *ctx, MYSQL *sql
+    const dstr_t fpr, struct cmd_xkeysync_context *ctx, sql_t *sql
 ){
     derr_t e = E_OK;
 
@@ -165,7 +261,7 @@ static derr_t report_changes(
     link_t *old_head,
     link_t *new_head,
     struct cmd_xkeysync_context *ctx,
-    MYSQL *sql
+    sql_t *sql
 ){
     derr_t e = E_OK;
     bool change_detected = false;
@@ -224,11 +320,11 @@ static derr_t report_changes(
 }
 
 
-// returns true on error
-static bool xkeysync_check_now(struct cmd_xkeysync_context *ctx){
+// the process shares one sql socket, taken from the first syncing user
+static derr_t watcher_set_sock(struct client *client){
     derr_t e = E_OK;
 
-    struct client *client = ctx->client;
+    if(watcher.sock.len) return e;
 
     // look up the socket path
     const char *sock = mail_user_plugin_getenv(client->user, "sql_socket");
@@ -236,57 +332,287 @@ static bool xkeysync_check_now(struct cmd_xkeysync_context *ctx){
         sock = "/var/run/mysqld/mysqld.sock";
     }
 
-    DSTR_VAR(d_sock, 256);
-    PROP_GO(&e, FMT(&d_sock, "%x", FS(sock)), done);
+    DSTR_WRAP_ARRAY(watcher.sock, watcher.sock_buffer);
+    PROP_GO(&e, FMT(&watcher.sock, "%x", FS(sock)), fail);
 
-    MYSQL sql;
-    PROP_GO(&e, dmysql_init(&sql), done);
+    return e;
 
-    PROP_GO(&e, sql_connect_unix(&sql, NULL, NULL, &d_sock), cu_sql);
+fail:
+    watcher.sock.len = 0;
+    return e;
+}
 
-    DSTR_VAR(email, SMSQL_EMAIL_SIZE);
-    bool ok;
-    PROP_GO(&e, get_email_for_uuid(&sql, ctx->uuid, &email, &ok), cu_sql);
+// get the watcher's connection, connecting if there isn't one yet
+static derr_t watcher_sql(sql_t **out){
+    derr_t e = E_OK;
+
+    *out = NULL;
+
+    if(!watcher.sql_ok){
+        PROP(&e, dmysql_init(&watcher.sql) );
+        PROP_GO(&e,
+            sql_connect_unix(&watcher.sql, NULL, NULL, &watcher.sock),
+        fail);
+        watcher.sql_ok = true;
+    }
+
+    *out = &watcher.sql;
+
+    return e;
+
+fail:
+    sql_close(&watcher.sql);
+    return e;
+}
+
+/* after any error we can't tell if the connection is still usable, so close
+   it and let the next watcher_sql() reconnect */
+static void watcher_sql_drop(void){
+    if(!watcher.sql_ok) return;
+    sql_close(&watcher.sql);
+    watcher.sql_ok = false;
+}
+
+// (re)load a user's fingerprints, unless they are already fresh
+static derr_t user_fprs_load(user_fprs_t *user, sql_t *sql){
+    derr_t e = E_OK;
+
+    if(user->fresh) return e;
 
     // get the keys from the database (comes pre-sorted)
     link_t all_fprs;
     link_init(&all_fprs);
-    PROP_GO(&e, list_device_fprs(&sql, ctx->uuid, &all_fprs), cu_sql);
-    // {
-    //     DSTR_VAR(buf, 256);
-    //     FMT(&buf, "* OK fpr list:");
-    //     client_send_line(ctx->client, buf.data);
-    //     smsql_dstr_t *fpr;
-    //     LINK_FOR_EACH(fpr, &all_fprs, smsql_dstr_t, link){
-    //         DSTR_VAR(buf, 256);
-    //         FMT(&buf, "* OK     %x", FD(&fpr->dstr));
-    //         client_send_line(ctx->client, buf.data);
-    //     }
-    // }
-
-    PROP_GO(&e,
-        report_changes(&ctx->known_fprs, &all_fprs, ctx, &sql),
-    cu_fprs);
-
-cu_fprs:
+    PROP(&e, list_device_fprs(sql, user->uuid, &all_fprs) );
+
+    free_fpr_list(&user->fprs);
+    link_list_append_list(&user->fprs, &all_fprs);
+    user->fresh = true;
+
+    return e;
+}
+
+static derr_t xkeysync_check_now(struct cmd_xkeysync_context *ctx, sql_t *sql){
+    derr_t e = E_OK;
+
+    PROP(&e, user_fprs_load(ctx->user, sql) );
+
+    link_t all_fprs;
+    link_init(&all_fprs);
+    PROP(&e, copy_fpr_list(&ctx->user->fprs, &all_fprs) );
+
+    PROP_GO(&e, report_changes(&ctx->known_fprs, &all_fprs, ctx, sql), cu);
+
+cu:
     free_fpr_list(&all_fprs);
 
-cu_sql:
-    mysql_close(&sql);
+    return e;
+}
+
+/* count a failure against a ctx and maybe give up on it; returns true if the
+   ctx was finished (and freed) */
+static bool xkeysync_failed(struct cmd_xkeysync_context *ctx){
+    // try again at the next poll
+    ctx->dirty = true;
+    // allow temporary failures gracefully
+    if(ctx->retries++ < 5) return false;
+    // free the command, since this is not a command_func_t entrypoint
+    xkeysync_finish(ctx, EXIT_INTERNAL_ERROR, true);
+    return true;
+}
+
+// run an owed check for one ctx; returns true if the ctx was finished
+static bool xkeysync_check(struct cmd_xkeysync_context *ctx){
+    derr_t e = E_OK;
+
+    struct client *client = ctx->client;
+
+    // cmd-idle.c checks if ctx->client->output_cmd_lock here, too
+
+    o_stream_cork(client->output);
+    sql_t *sql;
+    PROP_GO(&e, watcher_sql(&sql), fail);
+    PROP_GO(&e, xkeysync_check_now(ctx, sql), fail);
+    o_stream_uncork(client->output);
+
+    ctx->dirty = false;
+    ctx->retries = 0;
+    return false;
+
+fail:
+    o_stream_uncork(client->output);
+    watcher_sql_drop();
+    badbadbad_alert(DSTR_LIT("error in xkeysync_check()"), e.msg);
+    DUMP(e);
+    DROP_VAR(&e);
+    return xkeysync_failed(ctx);
+}
+
+static void gap_remove(size_t i){
+    watcher.ngaps--;
+    for(; i < watcher.ngaps; i++){
+        watcher.gaps[i] = watcher.gaps[i+1];
+    }
+}
+
+// forget gaps which have been open too long to still be in a transaction
+static void gaps_expire(time_t now){
+    size_t i = 0;
+    while(i < watcher.ngaps){
+        if(now - watcher.gaps[i].since > XKEYSYNC_GAP_SEC){
+            gap_remove(i);
+        }else{
+            i++;
+        }
+    }
+}
+
+// remember a skipped seq, which is always above every open gap
+static void gap_add(uint64_t seq, time_t now){
+    // when full, the oldest gap is the least likely to still commit
+    if(watcher.ngaps == XKEYSYNC_MAX_GAPS) gap_remove(0);
+    watcher.gaps[watcher.ngaps++] = (seq_gap_t){ .seq = seq, .since = now };
+}
+
+/* decide if a device_changes row is news to us, updating the high-water mark
+   and gaps to match */
+static bool change_is_new(uint64_t seq, time_t now){
+    if(seq > watcher.seq){
+        // remember every seq we skipped over, up to XKEYSYNC_MAX_GAPS
+        uint64_t first = watcher.seq + 1;
+        if(seq - first > XKEYSYNC_MAX_GAPS) first = seq - XKEYSYNC_MAX_GAPS;
+        for(uint64_t s = first; s < seq; s++) gap_add(s, now);
+        watcher.seq = seq;
+        return true;
+    }
+    // a row below the high-water mark is only new if it fills a gap
+    for(size_t i = 0; i < watcher.ngaps; i++){
+        if(watcher.gaps[i].seq != seq) continue;
+        gap_remove(i);
+        return true;
+    }
+    return false;
+}
+
+// the watcher's timeout: one poll of device_changes for the whole process
+static void watcher_poll(void *unused){
+    (void)unused;
+    derr_t e = E_OK;
+
+    struct cmd_xkeysync_context *ctx, *temp;
+
+    link_t changes;
+    link_init(&changes);
 
-    bool retval;
-done:
-    retval = is_error(e);
-    if(is_error(e)){
-        badbadbad_alert(DSTR_LIT("error in xkeysync_check_now()"), e.msg);
-        DUMP(e);
-        DROP_VAR(&e);
+    gaps_expire(ioloop_time);
+
+    // start below the lowest open gap, so late commits are seen
+    uint64_t since = watcher.seq;
+    if(watcher.ngaps) since = watcher.gaps[0].seq - 1;
+
+    sql_t *sql;
+    PROP_GO(&e, watcher_sql(&sql), fail);
+    PROP_GO(&e, list_device_changes(sql, since, &changes), fail);
+
+    // any changed users we are caching are no longer fresh
+    link_t *link;
+    while((link = link_list_pop_first(&changes))){
+        smsql_device_change_t *change =
+            CONTAINER_OF(link, smsql_device_change_t, link);
+        if(change_is_new(change->seq, ioloop_time)){
+            hash_elem_t *h = hashmap_gets(&watcher.users, &change->uuid);
+            if(h) CONTAINER_OF(h, user_fprs_t, h)->fresh = false;
+        }
+        smsql_device_change_free(&change);
+    }
+
+    // wake only the contexts which need it
+    LINK_FOR_EACH_SAFE(ctx, temp, &watcher.ctxs, cmd_xkeysync_context_t, link){
+        if(!ctx->user->fresh) ctx->dirty = true;
+        if(!ctx->dirty) continue;
+        xkeysync_check(ctx);
+    }
+
+    return;
+
+fail:
+    watcher_sql_drop();
+    // one alert for the whole process, rather than one per client
+    badbadbad_alert(DSTR_LIT("error in xkeysync watcher_poll()"), e.msg);
+    DUMP(e);
+    DROP_VAR(&e);
+    LINK_FOR_EACH_SAFE(ctx, temp, &watcher.ctxs, cmd_xkeysync_context_t, link){
+        xkeysync_failed(ctx);
+    }
+}
+
+/* join the watcher, which starts polling for the first ctx in the process.
+   Must happen before the ctx's initial check so no change goes unseen. */
+static derr_t watcher_add(struct cmd_xkeysync_context *ctx, sql_t *sql){
+    derr_t e = E_OK;
+
+    bool first = link_list_isempty(&watcher.ctxs);
+    if(first){
+        PROP(&e, get_device_change_seq(sql, &watcher.seq) );
+        watcher.ngaps = 0;
+        PROP(&e, hashmap_init(&watcher.users) );
+    }
+
+    user_fprs_t *user;
+    hash_elem_t *h = hashmap_gets(&watcher.users, &ctx->uuid);
+    if(h){
+        user = CONTAINER_OF(h, user_fprs_t, h);
+    }else{
+        user = DMALLOC_STRUCT_PTR(&e, user);
+        CHECK_GO(&e, fail);
+        DSTR_WRAP_ARRAY(user->uuid, user->uuid_buffer);
+        // can't fail; both buffers are SMSQL_UUID_SIZE
+        NOFAIL(&e, E_FIXEDSIZE, dstr_copy(&ctx->uuid, &user->uuid) );
+        link_init(&user->fprs);
+        hashmap_sets(&watcher.users, &user->uuid, &user->h);
+    }
+    user->refs++;
+    ctx->user = user;
+
+    link_list_append(&watcher.ctxs, &ctx->link);
+
+    if(first){
+#       ifdef __GNUC__
+#       pragma GCC diagnostic push
+#       pragma GCC diagnostic ignored "-Wvla"
+#       pragma GCC diagnostic ignored "-Wconversion"
+#       endif // __GNUC__
+        watcher.poll_to = timeout_add(XKEYSYNC_POLL_MSEC, watcher_poll, NULL);
+#       ifdef __GNUC__
+#       pragma GCC diagnostic pop
+#       endif // __GNUC__
     }
 
-    // always come back later
-    xkeysync_add_checker_timeout(ctx);
+    return e;
 
-    return retval;
+fail:
+    if(first) hashmap_free(&watcher.users);
+    return e;
+}
+
+// leave the watcher, which stops polling after the last ctx in the process
+static void watcher_remove(struct cmd_xkeysync_context *ctx){
+    if(!ctx->user) return;
+
+    link_remove(&ctx->link);
+
+    user_fprs_t *user = ctx->user;
+    ctx->user = NULL;
+    if(--user->refs == 0){
+        hash_elem_remove(&user->h);
+        free_fpr_list(&user->fprs);
+        free(user);
+    }
+
+    if(link_list_isempty(&watcher.ctxs)){
+        timeout_remove(&watcher.poll_to);
+        hashmap_free(&watcher.users);
+        watcher_sql_drop();
+    }
 }
 
 /* clean up our cmd_xkeysync_context and free the ctx->cmd if we finish in an
@@ -298,10 +624,10 @@ static void xkeysync_finish(
 
     // clean up the ctx
     free_fpr_list(&ctx->known_fprs);
+    watcher_remove(ctx);
 
     // remove all callbacks from io loop
     timeout_remove(&ctx->keepalive_to);
-    timeout_remove(&ctx->checker_to);
 
     /* Why does idle_finish have a cork/uncork?
 
@@ -387,42 +713,6 @@ static void xkeysync_add_keepalive_timeout(struct cmd_xkeysync_context *ctx){
 #   endif // __GNUC__
 }
 
-static void checker_timeout(struct cmd_xkeysync_context *ctx){
-    struct client *client = ctx->client;
-
-    // cmd-idle.c checks if ctx->client->output_cmd_lock here, too
-
-    o_stream_cork(client->output);
-    bool failure = xkeysync_check_now(ctx);
-    o_stream_uncork(client->output);
-
-    if(failure){
-        // allow temporary failures gracefully
-        if(ctx->retries++ >= 5){
-            // free the command, since this is not a command_func_t entrypoint
-            xkeysync_finish(ctx, EXIT_INTERNAL_ERROR, true);
-        }
-    }else{
-        // reset retry count
-        ctx->retries = 0;
-    }
-}
-
-static void xkeysync_add_checker_timeout(struct cmd_xkeysync_context *ctx){
-    unsigned int interval = 3000;  // milliseconds
-    timeout_remove(&ctx->checker_to);
-
-#   ifdef __GNUC__
-#   pragma GCC diagnostic push
-#   pragma GCC diagnostic ignored "-Wvla"
-#   pragma GCC diagnostic ignored "-Wconversion"
-#   endif // __GNUC__
-    ctx->checker_to = timeout_add(interval, checker_timeout, ctx);
-#   ifdef __GNUC__
-#   pragma GCC diagnostic pop
-#   endif // __GNUC__
-}
-
 /* hardcode the only string comparison we need to do, to avoid linking into
    extra dovecot libraries */
 static enum exit_msg is_done(const char *s){
@@ -588,12 +878,19 @@ bool cmd_xkeysync(struct client_command_context *cmd){
 
     o_stream_cork(client->output);
 
-    // do the first check now
-    if(xkeysync_check_now(ctx)){
-        o_stream_uncork(client->output);
-        // first check failed
-        xkeysync_finish(ctx, EXIT_INTERNAL_ERROR, false);
-        return true;
+    // join the watcher, then do the first check now
+    sql_t *sql;
+    IF_PROP(&e, watcher_set_sock(client) ){
+        goto fail_first;
+    }
+    IF_PROP(&e, watcher_sql(&sql) ){
+        goto fail_first;
+    }
+    IF_PROP(&e, watcher_add(ctx, sql) ){
+        goto fail_sql;
+    }
+    IF_PROP(&e, xkeysync_check_now(ctx, sql) ){
+        goto fail_sql;
     }
 
     // initial synchronization point; now it is ok to send DONE
@@ -604,6 +901,16 @@ bool cmd_xkeysync(struct client_command_context *cmd){
 
     return xkeysync_client_handle_input(ctx, false);
 
+fail_sql:
+    watcher_sql_drop();
+fail_first:
+    o_stream_uncork(client->output);
+    badbadbad_alert(DSTR_LIT("error in cmd_xkeysync first check"), e.msg);
+    DUMP(e);
+    DROP_VAR(&e);
+    xkeysync_finish(ctx, EXIT_INTERNAL_ERROR, false);
+    return true;
+
 fail_ctx:
     xkeysync_finish(ctx, EXIT_INTERNAL_ERROR, false);
 fail_fprs:
@@ -61,6 +61,7 @@ static derr_t fake_uv_citm(
     int *sockfd,
     SSL_CTX *client_ctx,
     string_builder_t sm_dir,
+    citm_pool_cfg_t pool_cfg,
     // function pointers, mainly for instrumenting tests:
     void (*indicate_ready)(void*, uv_citm_t*),
     void (*user_async_hook)(void*, uv_citm_t*),
@@ -105,6 +106,7 @@ static derr_t fake_uv_citm(
         "sm_baseurl", sm_baseurl, DSTR_LIT("https://splintermail.com")
     );
     EXPECT_NULL(&e, "client_ctx", client_ctx);
+    EXPECT_U(&e, "pool_cfg.size", pool_cfg.size, CITM_POOL_SIZE);
 
     return citm_args->to_return;
 }
@@ -282,6 +284,15 @@ static derr_t fake_api_token_read_increment_write_path(
     };
     return e;
 }
+static derr_t fake_api_token_reserve_path(
+    nonce_reserver_t *r, const string_builder_t *sb, api_token_t *token
+){
+    (void)r;
+    (void)sb;
+    derr_t e = E_OK;
+    token->nonce++;
+    return e;
+}
 static void fake_api_token_free0(api_token_t *token){
     *token = (api_token_t){0};
 }
@@ -373,6 +384,8 @@ static derr_t fake_api_pass_sync(
 }
 
 struct api_token_args_t* api_token_args;
+size_t napi_token_args;
+size_t api_token_calls;
 bool api_token_called;
 static derr_t fake_api_token_sync(
     http_sync_t *sync,
@@ -383,12 +396,12 @@ static derr_t fake_api_token_sync(
     json_t *json
 ){
     derr_t e = E_OK;
-    if(api_token_args == NULL){
+    if(api_token_args == NULL || api_token_calls >= napi_token_args){
         UH_OH("api_token_call called but nothing is prepared\n");
         ORIG(&e, E_INTERNAL, "bad api_token call");
     }
     (void)sync;
-    struct api_token_args_t* ATA = api_token_args;
+    struct api_token_args_t* ATA = &api_token_args[api_token_calls++];
     if(!dstr_eq(baseurl, dstr_from_cstr(ATA->baseurl)))
         UH_OH("ATA baseurl exp '%x' but got '%x'\n", FS(ATA->baseurl), FD(baseurl));
     if(ATA->path && !dstr_eq(path, dstr_from_cstr(ATA->path)))
@@ -480,6 +493,7 @@ ui_i dummy_ui_harness(void){
         .ssl_library_close = fake_ssl_library_close,
         .api_token_read_increment_write_path =
             fake_api_token_read_increment_write_path,
+        .api_token_reserve_path = fake_api_token_reserve_path,
         .api_token_free0 = fake_api_token_free0,
         .register_api_token_path_sync = fake_register_api_token_path_sync,
         .api_pass_sync = fake_api_pass_sync,
@@ -83,7 +83,10 @@ struct api_token_args_t {
     char* json;
     derr_t to_return;
 };
+// an array of napi_token_args calls, consumed in order
 extern struct api_token_args_t* api_token_args;
+extern size_t napi_token_args;
+extern size_t api_token_calls;
 extern bool api_token_called;
 
 // console_input.h
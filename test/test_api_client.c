@@ -0,0 +1,93 @@
+#include <libdstr/libdstr.h>
+
+#include "api_client.h"
+
+#include "test_utils.h"
+
+static derr_t write_nonce_file(const char *path, uint64_t nonce){
+    derr_t e = E_OK;
+
+    DSTR_VAR(buf, 32);
+    PROP(&e, FMT(&buf, "%x\n", FU(nonce)) );
+    PROP(&e, dstr_write_file(path, &buf) );
+
+    return e;
+}
+
+static derr_t read_nonce_file(const char *path, uint64_t *nonce){
+    derr_t e = E_OK;
+
+    DSTR_VAR(buf, 32);
+    PROP(&e, dstr_read_file(path, &buf) );
+    dstr_t stripped = dstr_strip_chars(buf, '\n');
+    PROP(&e, dstr_tou64(&stripped, nonce, 10) );
+
+    return e;
+}
+
+#define EXPECT_NONCE_FILE_GO(e, path, exp, label) do { \
+    uint64_t _nonce; \
+    PROP_GO(e, read_nonce_file(path, &_nonce), label); \
+    EXPECT_U_GO(e, "nonce file", _nonce, exp, label); \
+} while(0)
+
+static derr_t test_nonce_reserve(void){
+    derr_t e = E_OK;
+
+    DSTR_VAR(tmp, 64);
+    DSTR_VAR(path, 256);
+    uint64_t nonce;
+
+    PROP_GO(&e, mkdir_temp("api_client", &tmp), cu);
+    PROP_GO(&e, FMT(&path, "%x/nonce", FD(tmp)), cu);
+
+    // some earlier process left nonce 10 in the file
+    PROP_GO(&e, write_nonce_file(path.data, 10), cu);
+
+    // the first call reserves a block and writes the end of it
+    nonce_reserver_t r = {0};
+    PROP_GO(&e, nonce_reserve(&r, path.data, &nonce), cu);
+    EXPECT_U_GO(&e, "nonce", nonce, 11, cu);
+    EXPECT_NONCE_FILE_GO(&e, path.data, 10 + NONCE_RESERVE_BLOCK, cu);
+
+    /* calls within the block don't rewrite the file, which we detect by
+       clobbering the file behind the reserver's back */
+    PROP_GO(&e, write_nonce_file(path.data, 0), cu);
+    for(uint64_t i = 1; i < NONCE_RESERVE_BLOCK; i++){
+        PROP_GO(&e, nonce_reserve(&r, path.data, &nonce), cu);
+        EXPECT_U_GO(&e, "nonce", nonce, 11 + i, cu);
+    }
+    EXPECT_NONCE_FILE_GO(&e, path.data, 0, cu);
+
+    // the next block begins after the old one, no matter the file
+    PROP_GO(&e, nonce_reserve(&r, path.data, &nonce), cu);
+    EXPECT_U_GO(&e, "nonce", nonce, 11 + NONCE_RESERVE_BLOCK, cu);
+    EXPECT_NONCE_FILE_GO(&e, path.data, 10 + 2*NONCE_RESERVE_BLOCK, cu);
+
+    // a fresh reserver picks up after the file's value
+    nonce_reserver_t r2 = {0};
+    PROP_GO(&e, nonce_reserve(&r2, path.data, &nonce), cu);
+    EXPECT_U_GO(&e, "nonce", nonce, 11 + 2*NONCE_RESERVE_BLOCK, cu);
+    EXPECT_NONCE_FILE_GO(&e, path.data, 10 + 3*NONCE_RESERVE_BLOCK, cu);
+
+cu:
+    if(tmp.len) DROP_CMD( rm_rf(tmp.data) );
+    return e;
+}
+
+int main(int argc, char **argv){
+    derr_t e = E_OK;
+    // parse options and set default log level
+    PARSE_TEST_OPTIONS(argc, argv, NULL, LOG_LVL_INFO);
+
+    PROP_GO(&e, test_nonce_reserve(), test_fail);
+
+    LOG_ERROR("PASS\n");
+    return 0;
+
+test_fail:
+    DUMP(e);
+    DROP_VAR(&e);
+    LOG_ERROR("FAIL\n");
+    return 1;
+}
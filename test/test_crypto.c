@@ -241,6 +241,56 @@ cu_file:
     return e;
 }
 
+static derr_t test_predict_len(void){
+    derr_t e = E_OK;
+
+    const char* keyfile = "_delete_me_if_you_see_me.pem";
+    PROP_GO(&e, gen_key(1024, keyfile), cu_file);
+
+    keypair_t *kp;
+    PROP_GO(&e, keypair_load_private(&kp, keyfile), cu_file);
+    compat_unlink(keyfile);
+
+    encrypter_t ec;
+    PROP_GO(&e, encrypter_new(&ec), cu_kp);
+
+    link_t keys;
+    link_init(&keys);
+    link_list_append(&keys, &kp->link);
+
+    DSTR_VAR(plain, 256);
+    memset(plain.data, 'x', plain.size);
+
+    DSTR_VAR(enc, 4096);
+    // cover every alignment of the message against the base64 lines
+    for(size_t len = 0; len <= plain.size; len++){
+        plain.len = len;
+        enc.len = 0;
+        PROP_GO(&e, encrypter_start(&ec, &keys, &enc), cu_ec);
+        size_t start_len = enc.len;
+        size_t predicted;
+        PROP_GO(&e, encrypter_predict_len(&ec, len, &predicted), cu_ec);
+        PROP_GO(&e, encrypter_update(&ec, &plain, &enc), cu_ec);
+        PROP_GO(&e, encrypter_finish(&ec, &enc), cu_ec);
+        if(enc.len - start_len != predicted){
+            ORIG_GO(&e,
+                E_VALUE,
+                "for len=%x, predicted %x but got %x",
+                cu_ec,
+                FU(len), FU(predicted), FU(enc.len - start_len)
+            );
+        }
+    }
+
+cu_ec:
+    encrypter_free(&ec);
+cu_kp:
+    keypair_free(&kp);
+cu_file:
+    compat_unlink(keyfile);
+    return e;
+}
+
 static derr_t test_keypair(void){
     derr_t e = E_OK;
 
@@ -464,6 +514,7 @@ int main(int argc, char** argv){
     PROP_GO(&e, test_b64_encoders(), test_fail);
     PROP_GO(&e, test_hex_encoders(), test_fail);
     PROP_GO(&e, test_crypto(), test_fail);
+    PROP_GO(&e, test_predict_len(), test_fail);
     PROP_GO(&e, test_keypair(), test_fail);
     PROP_GO(&e, test_keyshare(), test_fail);
     PROP_GO(&e, test_zeroized(), test_fail);
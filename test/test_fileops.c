@@ -223,6 +223,20 @@ cu:
     return e;
 }
 
+static derr_t test_fsync_parent(void){
+    derr_t e = E_OK;
+
+    // relative, absolute, and bare filenames all have a parent to fsync
+    PROP(&e, dfsync_parent("./file") );
+    PROP(&e, dfsync_parent("/tmp/file") );
+    PROP(&e, dfsync_parent("file") );
+
+    // a missing parent is an error
+    derr_t e2 = dfsync_parent("/nonexistent/dir/file");
+    EXPECT_E_VAR(&e, "missing parent", &e2, E_OPEN);
+
+    return e;
+}
 
 int main(int argc, char** argv){
     derr_t e = E_OK;
@@ -232,6 +246,7 @@ int main(int argc, char** argv){
     PROP_GO(&e, test_dirname_basename(), test_fail);
     PROP_GO(&e, test_mkdirs(), test_fail);
     PROP_GO(&e, test_mkdirs_failure_handling(), test_fail);
+    PROP_GO(&e, test_fsync_parent(), test_fail);
 
     LOG_ERROR("PASS\n");
     return 0;
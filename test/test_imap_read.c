@@ -1581,6 +1581,218 @@ static derr_t test_num(void){
     return e;
 }
 
+typedef struct {
+    imap_literal_sink_i iface;
+    size_t starts;
+    size_t len;
+    dstr_t got;
+} test_sink_t;
+DEF_CONTAINER_OF(test_sink_t, iface, imap_literal_sink_i)
+
+static derr_t test_sink_start(imap_literal_sink_i *iface, size_t len){
+    derr_t e = E_OK;
+    test_sink_t *sink = CONTAINER_OF(iface, test_sink_t, iface);
+    sink->starts++;
+    sink->len = len;
+    sink->got.len = 0;
+    return e;
+}
+
+static derr_t test_sink_chunk(imap_literal_sink_i *iface, const dstr_t chunk){
+    derr_t e = E_OK;
+    test_sink_t *sink = CONTAINER_OF(iface, test_sink_t, iface);
+    PROP(&e, dstr_append(&sink->got, &chunk) );
+    return e;
+}
+
+// pop the next command, which must be of the expected type
+static derr_t pop_cmd(link_t *out, imap_cmd_type_t type, imap_cmd_t **cmd){
+    derr_t e = E_OK;
+    link_t *link = link_list_pop_first(out);
+    if(!link) ORIG(&e, E_VALUE, "missing command");
+    *cmd = CONTAINER_OF(link, imap_cmd_t, link);
+    if((*cmd)->type != type){
+        TRACE(&e, "expected %x but got %x\n",
+            FD(imap_cmd_type_to_dstr(type)),
+            FD(imap_cmd_type_to_dstr((*cmd)->type))
+        );
+        imap_cmd_free(*cmd);
+        *cmd = NULL;
+        ORIG(&e, E_VALUE, "wrong command type");
+    }
+    return e;
+}
+
+static void free_cmds(link_t *out){
+    link_t *link;
+    while((link = link_list_pop_first(out))){
+        imap_cmd_free(CONTAINER_OF(link, imap_cmd_t, link));
+    }
+}
+
+static void free_resps(link_t *out){
+    link_t *link;
+    while((link = link_list_pop_first(out))){
+        imap_resp_free(CONTAINER_OF(link, imap_resp_t, link));
+    }
+}
+
+static derr_t test_literal_sink_cmds(test_sink_t *sink){
+    derr_t e = E_OK;
+
+    extensions_t exts = {0};
+    imap_cmd_reader_t r = {0};
+    link_t out = {0};
+    imap_cmd_t *cmd = NULL;
+
+    PROP(&e, imap_cmd_reader_init(&r, &exts) );
+    r.args.literal_sink = &sink->iface;
+
+    // small literals are parsed normally
+    PROP_GO(&e,
+        imap_cmd_read(&r, DSTR_LIT("t1 APPEND inbox {5}\r\nsmall\r\n"), &out),
+    cu);
+    PROP_GO(&e, pop_cmd(&out, IMAP_CMD_PLUS_REQ, &cmd), cu);
+    imap_cmd_free(STEAL(imap_cmd_t, &cmd));
+    PROP_GO(&e, pop_cmd(&out, IMAP_CMD_APPEND, &cmd), cu);
+    EXPECT_NOT_NULL_GO(&e, "content", cmd->arg.append->content, cu);
+    EXPECT_D_GO(&e,
+        "content", cmd->arg.append->content->dstr, DSTR_LIT("small"),
+    cu);
+    imap_cmd_free(STEAL(imap_cmd_t, &cmd));
+    EXPECT_U_GO(&e, "starts", sink->starts, 0, cu);
+
+    // large literals go to the sink, and the APPEND comes out immediately
+    PROP_GO(&e,
+        imap_cmd_read(&r, DSTR_LIT("t2 APPEND inbox {12}\r\nhello "), &out),
+    cu);
+    PROP_GO(&e, pop_cmd(&out, IMAP_CMD_PLUS_REQ, &cmd), cu);
+    imap_cmd_free(STEAL(imap_cmd_t, &cmd));
+    PROP_GO(&e, pop_cmd(&out, IMAP_CMD_APPEND, &cmd), cu);
+    EXPECT_NULL_GO(&e, "content", cmd->arg.append->content, cu);
+    EXPECT_U_GO(&e, "len", cmd->arg.append->len, 12, cu);
+    imap_cmd_free(STEAL(imap_cmd_t, &cmd));
+    EXPECT_U_GO(&e, "starts", sink->starts, 1, cu);
+    EXPECT_U_GO(&e, "sink len", sink->len, 12, cu);
+    EXPECT_D_GO(&e, "got", sink->got, DSTR_LIT("hello "), cu);
+
+    PROP_GO(&e,
+        imap_cmd_read(&r, DSTR_LIT("world!\r\nt3 NOOP\r\n"), &out),
+    cu);
+    EXPECT_D_GO(&e, "got", sink->got, DSTR_LIT("hello world!"), cu);
+    PROP_GO(&e, pop_cmd(&out, IMAP_CMD_NOOP, &cmd), cu);
+    imap_cmd_free(STEAL(imap_cmd_t, &cmd));
+    EXPECT_B_GO(&e, "empty", link_list_isempty(&out), true, cu);
+
+cu:
+    imap_cmd_free(cmd);
+    free_cmds(&out);
+    imap_cmd_reader_free(&r);
+    return e;
+}
+
+// read a single FETCH response and return its BODY[]
+static derr_t read_fetch_body(
+    imap_resp_reader_t *r, const dstr_t in, imap_resp_t **resp
+){
+    derr_t e = E_OK;
+
+    link_t out = {0};
+    PROP(&e, imap_resp_read(r, in, &out) );
+    link_t *link = link_list_pop_first(&out);
+    free_resps(&out);
+    if(!link) ORIG(&e, E_VALUE, "missing response");
+    *resp = CONTAINER_OF(link, imap_resp_t, link);
+    if((*resp)->type != IMAP_RESP_FETCH || !(*resp)->arg.fetch->extras){
+        imap_resp_free(*resp);
+        *resp = NULL;
+        ORIG(&e, E_VALUE, "expected a FETCH with BODY[]");
+    }
+
+    return e;
+}
+
+static derr_t test_literal_sink_resps(test_sink_t *sink){
+    derr_t e = E_OK;
+
+    extensions_t exts = {0};
+    imap_resp_reader_t r = {0};
+    link_t out = {0};
+    imap_resp_t *resp = NULL;
+    ie_fetch_resp_extra_t *extra;
+
+    PROP(&e, imap_resp_reader_init(&r, &exts) );
+    r.args.literal_sink = &sink->iface;
+
+    // small literals are parsed normally
+    PROP_GO(&e,
+        read_fetch_body(&r,
+            DSTR_LIT("* 1 FETCH (UID 5 BODY[] {5}\r\nsmall)\r\n"), &resp
+        ),
+    cu);
+    extra = resp->arg.fetch->extras;
+    EXPECT_NOT_NULL_GO(&e, "content", extra->content, cu);
+    EXPECT_D_GO(&e, "content", extra->content->dstr, DSTR_LIT("small"), cu);
+    imap_resp_free(STEAL(imap_resp_t, &resp));
+    EXPECT_U_GO(&e, "starts", sink->starts, 0, cu);
+
+    // as are quoted strings
+    PROP_GO(&e,
+        read_fetch_body(&r,
+            DSTR_LIT("* 2 FETCH (BODY[] \"quoted string\")\r\n"), &resp
+        ),
+    cu);
+    extra = resp->arg.fetch->extras;
+    EXPECT_NOT_NULL_GO(&e, "content", extra->content, cu);
+    imap_resp_free(STEAL(imap_resp_t, &resp));
+    EXPECT_U_GO(&e, "starts", sink->starts, 0, cu);
+
+    // large literals go to the sink, before the FETCH response is emitted
+    PROP_GO(&e,
+        imap_resp_read(&r,
+            DSTR_LIT("* 3 FETCH (UID 7 BODY[] {12}\r\nhello "), &out
+        ),
+    cu);
+    EXPECT_B_GO(&e, "empty", link_list_isempty(&out), true, cu);
+    EXPECT_U_GO(&e, "starts", sink->starts, 1, cu);
+    EXPECT_U_GO(&e, "sink len", sink->len, 12, cu);
+    PROP_GO(&e,
+        read_fetch_body(&r, DSTR_LIT("world! FLAGS ())\r\n"), &resp),
+    cu);
+    EXPECT_D_GO(&e, "got", sink->got, DSTR_LIT("hello world!"), cu);
+    EXPECT_U_GO(&e, "uid", resp->arg.fetch->uid, 7, cu);
+    extra = resp->arg.fetch->extras;
+    EXPECT_NULL_GO(&e, "content", extra->content, cu);
+    EXPECT_U_GO(&e, "len", extra->len, 12, cu);
+
+cu:
+    imap_resp_free(resp);
+    free_resps(&out);
+    imap_resp_reader_free(&r);
+    return e;
+}
+
+static derr_t test_literal_sink(void){
+    derr_t e = E_OK;
+
+    test_sink_t sink = {
+        .iface = {
+            .min_len = 10,
+            .start = test_sink_start,
+            .chunk = test_sink_chunk,
+        },
+    };
+    PROP(&e, dstr_new(&sink.got, 64) );
+
+    PROP_GO(&e, test_literal_sink_cmds(&sink), cu);
+    sink.starts = 0;
+    PROP_GO(&e, test_literal_sink_resps(&sink), cu);
+
+cu:
+    dstr_free(&sink.got);
+    return e;
+}
+
 int main(int argc, char **argv){
     derr_t e = E_OK;
     PARSE_TEST_OPTIONS(argc, argv, NULL, LOG_LVL_ERROR);
@@ -1591,6 +1803,7 @@ int main(int argc, char **argv){
     PROP_GO(&e, test_command_error_reporting(), test_fail);
     PROP_GO(&e, test_response_error_reporting(), test_fail);
     PROP_GO(&e, test_num(), test_fail);
+    PROP_GO(&e, test_literal_sink(), test_fail);
 
     LOG_ERROR("PASS\n");
     return 0;
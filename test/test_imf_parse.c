@@ -854,6 +854,347 @@ cu:
     return e;
 }
 
+// the hdrs grammar alone, without the fast path in imf_hdrs_parse()
+static derr_t grammar_hdrs(const dstr_t *msg, imf_hdrs_t **out){
+    derr_t e = E_OK;
+    *out = NULL;
+
+    IMF_ONSTACK_PARSER(p, IMF_HDRS_MAX_CALLSTACK, IMF_HDRS_MAX_SEMSTACK);
+    imf_scanner_t s = imf_scanner_prep(msg, 0, NULL, NULL, NULL);
+
+    imf_token_e token_type;
+    do {
+        dstr_off_t token;
+        PROP_GO(&e, imf_scan(&s, &token, &token_type), done);
+        imf_status_e status = imf_parse_hdrs(
+            &p, &e, msg, 0, token_type, token, out, NULL
+        );
+        CHECK_GO(&e, done);
+        if(status == IMF_STATUS_DONE) break;
+        if(status != IMF_STATUS_OK){
+            ORIG_GO(&e, E_PARAM, "syntax error", done);
+        }
+    } while(token_type != IMF_EOF);
+
+done:
+    if(is_error(e)) imf_hdrs_free(STEAL(imf_hdrs_t, out));
+    imf_parser_reset(&p);
+    return e;
+}
+
+// feeds a message to imf_hdrs_parse() a few bytes at a time
+typedef struct {
+    dstr_t in;
+    dstr_t *buf;
+    size_t chunk;
+} feed_t;
+
+static derr_t feed_read(void *data, size_t *amnt_read){
+    derr_t e = E_OK;
+    feed_t *feed = data;
+    size_t off = feed->buf->len;
+    dstr_t piece = dstr_sub2(feed->in, off, off + feed->chunk);
+    PROP(&e, dstr_append(feed->buf, &piece) );
+    *amnt_read = piece.len;
+    return e;
+}
+
+// offsets must match exactly, not just the bytes they point to
+static bool off_same(dstr_off_t a, dstr_off_t b){
+    return a.start == b.start && a.len == b.len;
+}
+
+static bool hdrs_same(const imf_hdrs_t *a, const imf_hdrs_t *b){
+    IE_EQ_PTR_CHECK(a, b);
+    if(!off_same(a->bytes, b->bytes) || !off_same(a->sep, b->sep)){
+        return false;
+    }
+    const imf_hdr_t *ha = a->hdr;
+    const imf_hdr_t *hb = b->hdr;
+    for(; ha && hb; ha = ha->next, hb = hb->next){
+        if(!off_same(ha->bytes, hb->bytes)) return false;
+        if(!off_same(ha->name, hb->name)) return false;
+        if(!off_same(ha->value, hb->value)) return false;
+    }
+    return !ha && !hb;
+}
+
+// compare imf_hdrs_parse() to the grammar, both whole and streamed
+static derr_t check_hdrs_fast_path(const dstr_t msg){
+    derr_t e = E_OK;
+
+    imf_hdrs_t *exp = NULL;
+    imf_hdrs_t *got = NULL;
+    dstr_t buf = {0};
+
+    derr_t e2 = grammar_hdrs(&msg, &exp);
+    bool exp_ok = !is_error(e2);
+    DROP_VAR(&e2);
+
+    PROP_GO(&e, dstr_new(&buf, msg.len + 1), cu);
+
+    for(size_t chunk = 0; chunk < 4; chunk++){
+        // chunk == 0 means the whole message at once
+        buf.len = 0;
+        feed_t feed = { .in = msg, .buf = &buf, .chunk = chunk };
+        if(chunk == 0){
+            e2 = imf_hdrs_parse(&msg, NULL, NULL, &got);
+        }else{
+            e2 = imf_hdrs_parse(&buf, feed_read, &feed, &got);
+        }
+        bool got_ok = !is_error(e2);
+        DROP_VAR(&e2);
+        if(got_ok != exp_ok || !hdrs_same(exp, got)){
+            TRACE(&e,
+                "msg: %x\nchunk: %x, exp_ok: %x, got_ok: %x\n",
+                FD_DBG(msg), FU(chunk), FB(exp_ok), FB(got_ok)
+            );
+            ORIG_GO(&e, E_VALUE, "fast path does not match grammar", cu);
+        }
+        imf_hdrs_free(STEAL(imf_hdrs_t, &got));
+    }
+
+cu:
+    imf_hdrs_free(exp);
+    imf_hdrs_free(got);
+    dstr_free(&buf);
+    return e;
+}
+
+static derr_t test_imf_find_eol(void){
+    derr_t e = E_OK;
+
+    /* fill with bytes that are near CR and LF, or that have the high bit set,
+       which a careless word-at-a-time search might mistake for an EOL */
+    const char fill[] = "\x0c\x0e\x8d\x8a\x00\x0b\x1d\x1a\xff\x09";
+    char buf[80];
+    for(size_t i = 0; i < sizeof(buf); i++){
+        buf[i] = fill[i % (sizeof(fill)-1)];
+    }
+
+    // every alignment, length, and EOL position, for both CR and LF
+    for(size_t off = 0; off < 16; off++){
+        for(size_t n = 0; off + n <= 64; n++){
+            char *p = buf + off;
+            size_t got = imf_find_eol(p, n);
+            if(got != n){
+                TRACE(&e, "off=%x n=%x got=%x\n", FU(off), FU(n), FU(got));
+                ORIG(&e, E_VALUE, "found an EOL in none");
+            }
+            for(size_t i = 0; i < n; i++){
+                for(size_t j = 0; j < 2; j++){
+                    char c = p[i];
+                    p[i] = j ? '\n' : '\r';
+                    got = imf_find_eol(p, n);
+                    p[i] = c;
+                    if(got == i) continue;
+                    TRACE(&e,
+                        "off=%x n=%x i=%x got=%x\n",
+                        FU(off), FU(n), FU(i), FU(got)
+                    );
+                    ORIG(&e, E_VALUE, "wrong EOL");
+                }
+            }
+        }
+    }
+
+    // with two EOLs, the first one wins
+    for(size_t i = 0; i < 40; i++){
+        for(size_t j = i; j < 40; j++){
+            char c1 = buf[i];
+            char c2 = buf[j];
+            buf[j] = '\n';
+            buf[i] = '\r';
+            size_t got = imf_find_eol(buf, 40);
+            buf[i] = c1;
+            buf[j] = c2;
+            if(got == i) continue;
+            TRACE(&e, "i=%x j=%x got=%x\n", FU(i), FU(j), FU(got));
+            ORIG(&e, E_VALUE, "wrong first EOL");
+        }
+    }
+
+    return e;
+}
+
+static derr_t test_imf_hdrs_fast_path(void){
+    derr_t e = E_OK;
+
+    dstr_t cases[] = {
+        DSTR_LIT(""),
+        DSTR_LIT("\r\n"),
+        DSTR_LIT("\n"),
+        DSTR_LIT("\r"),
+        DSTR_LIT("\n\r\n"),
+        DSTR_LIT("a: b\r\n\r\nbody\r\n"),
+        DSTR_LIT("a: b\r\n"),
+        DSTR_LIT("a:b\nc: d\n\nbody"),
+        DSTR_LIT("a:b\rc: d\r\rbody"),
+        DSTR_LIT("a:b\n\rc: d\n\r\n\rbody"),
+        DSTR_LIT("a \t: b\r\n\r\n"),
+        DSTR_LIT("a:\r\n\r\n"),
+        DSTR_LIT("a:\r\n folded\r\n \r\n\tx\r\nb: c\r\n \r\n\r\n"),
+        DSTR_LIT("X-\xc3\xa9t\xff: \x01 v\x7f\r\n\r\n"),
+        DSTR_LIT("a: with a nul\0 in it\r\n\r\n"),
+        DSTR_LIT("a: \0\r\nb:\0\0\r\n\0\r\n\r\n"),
+        // bare CR, alone and beside other EOLs
+        DSTR_LIT("a: b\rc: d\r\n\r"),
+        DSTR_LIT("a: b\r\rbody\r"),
+        DSTR_LIT("a: b\r\n\rc: d\r\r\n"),
+        DSTR_LIT("a: b\r \r\tc\r\r"),
+        // obs-fold: folds whose lines hold nothing but whitespace
+        DSTR_LIT("a: b\r\n \r\n\t\r\n c\r\n\r\n"),
+        DSTR_LIT("a:\r\n \r\n\r\n"),
+        DSTR_LIT("a: b\n \n \n\nbody"),
+        DSTR_LIT("a: b\r \r \r\rbody"),
+        // no CRLF after the separator or the body
+        DSTR_LIT("a: b\r\n\r\nbody"),
+        DSTR_LIT("a: b\r\n\r\n"),
+        DSTR_LIT("a: b\r\n "),
+        DSTR_LIT(
+            "Long-Header-Name-Here: a value which is well over sixteen "
+            "bytes long, and then some more\r\n"
+            "\tand a fold which is also quite long, to cross a few\r\n"
+            " 16-byte boundaries before the end\r\n"
+            "\r\n"
+        ),
+        // the rest are errors
+        DSTR_LIT("a: b"),
+        DSTR_LIT("a: b\r\n c"),
+        DSTR_LIT(" a: b\r\n"),
+        DSTR_LIT("a b: c\r\n"),
+        DSTR_LIT("a\r\n"),
+        DSTR_LIT(":b\r\n"),
+        DSTR_LIT("a\x01: b\r\n"),
+        DSTR_LIT("a: b\r\nbody without a separator\r\n"),
+        DSTR_LIT("a: b\r\nc: d"),
+        DSTR_LIT("a: b\r\nc:"),
+        DSTR_LIT("a: b\r\nc"),
+        DSTR_LIT("a\0: b\r\n\r\n"),
+        DSTR_LIT("\0a: b\r\n\r\n"),
+    };
+    for(size_t i = 0; i < sizeof(cases)/sizeof(*cases); i++){
+        PROP(&e, check_hdrs_fast_path(cases[i]) );
+    }
+
+    // pseudorandom header blocks, heavy on line endings and whitespace
+    const char alphabet[] = "ab:\r\n \t:\r\n-xyz\x80\0\r";
+    DSTR_VAR(msg, 256);
+    uint32_t seed = 1;
+    for(size_t i = 0; i < 2000; i++){
+        msg.len = 0;
+        seed = seed * 1103515245u + 12345u;
+        size_t len = (seed >> 16) % msg.size;
+        for(size_t j = 0; j < len; j++){
+            seed = seed * 1103515245u + 12345u;
+            msg.data[msg.len++] = alphabet[(seed >> 16) % (sizeof(alphabet)-1)];
+        }
+        PROP(&e, check_hdrs_fast_path(msg) );
+    }
+
+    // pseudorandom headers with long values, to cross SSE2 and word blocks
+    const char *eols[] = { "\r\n", "\n", "\r", "\n\r", "\r\n ", "\r\t" };
+    for(size_t i = 0; i < 500; i++){
+        msg.len = 0;
+        while(true){
+            seed = seed * 1103515245u + 12345u;
+            size_t vlen = (seed >> 16) % 40;
+            size_t neols = sizeof(eols)/sizeof(*eols);
+            const char *eol = eols[(seed >> 24) % neols];
+            // leave room for the longest eol and the separator and body
+            if(msg.len + vlen + 16 > msg.size) break;
+            // field names are always valid; a nul may land in a value
+            memcpy(msg.data + msg.len, "x:", 2);
+            msg.len += 2;
+            for(size_t j = 0; j < vlen; j++){
+                seed = seed * 1103515245u + 12345u;
+                msg.data[msg.len++] = (seed >> 16) % 97 ? 'v' : '\0';
+            }
+            memcpy(msg.data + msg.len, eol, strlen(eol));
+            msg.len += strlen(eol);
+        }
+        // sometimes end with a separator, sometimes just stop
+        if(seed & 0x10000) PROP(&e, FMT(&msg, "\r\nbody") );
+        PROP(&e, check_hdrs_fast_path(msg) );
+    }
+
+    return e;
+}
+
+static derr_t test_imf_unfold(void){
+    derr_t e = E_OK;
+
+    imf_hdrs_t *hdrs = NULL;
+    ie_envelope_t *env = NULL;
+    ie_dstr_t *exp = NULL;
+
+    // compare read_envelope_info()'s fast unfolding to the grammar
+    dstr_t cases[] = {
+        DSTR_LIT(" Hi there,\r\n this is a junk message!"),
+        DSTR_LIT("no leading space"),
+        DSTR_LIT("   "),
+        DSTR_LIT("\r\n starts with a fold"),
+        DSTR_LIT(" ends with a fold\r\n "),
+        DSTR_LIT(" trailing space \r\n\t"),
+        DSTR_LIT(" many\r\n \r\n\t \r\n   folds"),
+        DSTR_LIT(" lf\n folds\n\r\tand\r cr\r\n folds"),
+        DSTR_LIT(" bare\r cr\r\t\r folds"),
+        DSTR_LIT(" obs\r\n \r\n\t\r\n fold"),
+        DSTR_LIT(" a nul\0 and\0\r\n \0 more"),
+        DSTR_LIT(" \0"),
+        DSTR_LIT(
+            " a subject line long enough to cross several 16-byte "
+            "boundaries\r\n\t before and after the fold"
+        ),
+    };
+    for(size_t i = 0; i < sizeof(cases)/sizeof(*cases); i++){
+        DSTR_VAR(msg, 256);
+        PROP_GO(&e, FMT(&msg, "Subject:%x\r\n\r\n", FD(cases[i])), cu);
+        PROP_GO(&e, imf_hdrs_parse(&msg, NULL, NULL, &hdrs), cu);
+        env = read_envelope_info(&e, hdrs);
+        CHECK_GO(&e, cu);
+
+        dstr_t value = dstr_from_off(hdrs->hdr->value);
+        imf_parse_go(&e, value, unstruct, &exp, cu);
+
+        if(!ie_dstr_eq(exp, env->subj)){
+            TRACE(&e,
+                "value: %x\nexp: %x\ngot: %x\n",
+                FD_DBG(value),
+                FD_DBG(exp ? exp->dstr : DSTR_LIT("NULL")),
+                FD_DBG(env->subj ? env->subj->dstr : DSTR_LIT("NULL"))
+            );
+            ORIG_GO(&e, E_VALUE, "unfold does not match grammar", cu);
+        }
+
+        imf_hdrs_free(STEAL(imf_hdrs_t, &hdrs));
+        ie_envelope_free(STEAL(ie_envelope_t, &env));
+        ie_dstr_free(STEAL(ie_dstr_t, &exp));
+    }
+
+cu:
+    imf_hdrs_free(hdrs);
+    ie_envelope_free(env);
+    ie_dstr_free(exp);
+    return e;
+}
+
+// run every fast path test with both the SSE2 and the portable EOL search
+static derr_t test_imf_fast_paths(void){
+    derr_t e = E_OK;
+
+    for(int portable = 0; portable < 2; portable++){
+        _imf_find_eol_portable = portable;
+        PROP_GO(&e, test_imf_find_eol(), cu);
+        PROP_GO(&e, test_imf_hdrs_fast_path(), cu);
+        PROP_GO(&e, test_imf_unfold(), cu);
+    }
+
+cu:
+    _imf_find_eol_portable = false;
+    return e;
+}
+
 #define OFF_LIT(str) \
     (dstr_off_t){ .buf = &DSTR_LIT(str), .start = 0, .len = (sizeof(str)-1) }
 
@@ -1725,6 +2066,7 @@ int main(int argc, char** argv){
     PROP_GO(&e, test_parse_date_field(), test_fail);
     PROP_GO(&e, test_read_envelope_info(), test_fail);
     PROP_GO(&e, test_read_mime_content_type(), test_fail);
+    PROP_GO(&e, test_imf_fast_paths(), test_fail);
     PROP_GO(&e, test_get_multipart_index(), test_fail);
     PROP_GO(&e, test_imf_get_submessage(), test_fail);
     PROP_GO(&e, test_imf_bodystructure(), test_fail);
@@ -1,3 +1,5 @@
+#include <errno.h>
+
 #include <libdstr/libdstr.h>
 
 
@@ -208,6 +210,23 @@ static derr_t test_json_fdump(void){
     PROP_GO(&e, dstr_recode(&buf, &buf2, &find, &repl, false), cu);
     EXPECT_DM_GO(&e, "json_fdump file", buf2, DSTR_LIT("\"b\"\n"), cu);
 
+    // again, but all on one line
+    json_free(&json);
+    json_prep(&json);
+    PROP_GO(&e, dfopen_path(&file_path, "w", &f), cu);
+    DSTR_STATIC(line, "{\"a\":\"b\",\"c\":[1,{},[],true,null]}");
+    PROP_GO(&e, json_parse(line, &json), cu);
+    PROP_GO(&e, json_fdump_line(json.root, f), cu);
+    PROP_GO(&e, dffsync(f), cu);
+    fclose(f);
+    f = NULL;
+    buf.len = 0;
+    PROP_GO(&e, dstr_read_path(&file_path, &buf), cu);
+    PROP_GO(&e, dstr_recode(&buf, &buf2, &find, &repl, false), cu);
+    DSTR_VAR(line_exp, 256);
+    PROP_GO(&e, FMT(&line_exp, "%x\n", FD(line)), cu);
+    EXPECT_DM_GO(&e, "json_fdump_line file", buf2, line_exp, cu);
+
 cu:
     if(f) fclose(f);
     DROP_CMD( rm_rf_path(&temp_path) );
@@ -215,6 +234,124 @@ cu:
     return e;
 }
 
+// parse one byte at a time, like a slow network would deliver it
+static derr_t parse_bytewise(const dstr_t in, json_parser_t *p){
+    derr_t e = E_OK;
+    for(size_t i = 0; i < in.len; i++){
+        PROP(&e, json_parse_chunk(p, dstr_sub2(in, i, i+1)) );
+    }
+    PROP(&e, json_parse_finish(p) );
+    return e;
+}
+
+// json_fdump_line, but into a dstr_t
+static derr_t dump_line(json_ptr_t ptr, dstr_t *out){
+    derr_t e = E_OK;
+
+    out->len = 0;
+    FILE *f = tmpfile();
+    if(!f) ORIG(&e, E_OS, "tmpfile: %x", FE(errno));
+    PROP_GO(&e, json_fdump_line(ptr, f), cu);
+    rewind(f);
+    PROP_GO(&e, dstr_grow(out, 4096), cu);
+    out->len = fread(out->data, 1, out->size, f);
+    // drop the newline
+    if(out->len && out->data[out->len-1] == '\n') out->len--;
+
+cu:
+    fclose(f);
+    return e;
+}
+
+static derr_t test_json_skip(void){
+    derr_t e = E_OK;
+
+    json_t json;
+    json_prep(&json);
+    dstr_t got = {0};
+
+    DSTR_STATIC(in,
+        "{\"big\": [{\"x\": \"]}\\\"\"}, [1, 2], {}], "
+        "\"n\": 12, "
+        "\"obj\": {\"keep\": true, \"drop\": {\"a\": [null]}}, "
+        "\"opt\": {\"drop\": 1, \"keep\": 2}, "
+        "\"strict\": {\"extra\": 1}, "
+        "\"tail\": \"z\"}"
+    );
+
+    bool keep, opt_nonnull;
+    int n, opt_keep;
+    json_ptr_t strict;
+    jspec_t *jspec = JOBJ(true,
+        JKEY("n", JI(&n)),
+        JKEY("obj", JOBJ(true, JKEY("keep", JB(&keep)))),
+        JKEY("opt",
+            JOPT(&opt_nonnull, JOBJ(true, JKEY("keep", JI(&opt_keep))))
+        ),
+        JKEY("strict", JPTR(&strict)),
+    );
+
+    // bytewise parsing with no skipping is identical to json_parse()
+    json_parser_t p = json_parser(&json);
+    PROP_GO(&e, parse_bytewise(in, &p), cu);
+    PROP_GO(&e, dump_line(json.root, &got), cu);
+    DSTR_STATIC(full_exp,
+        "{\"big\":[{\"x\":\"]}\\\"\"},[1,2],{}],\"n\":12,"
+        "\"obj\":{\"keep\":true,\"drop\":{\"a\":[null]}},"
+        "\"opt\":{\"drop\":1,\"keep\":2},"
+        "\"strict\":{\"extra\":1},\"tail\":\"z\"}"
+    );
+    EXPECT_DM_GO(&e, "full", got, full_exp, cu);
+
+    // only what the jspec asks for is kept
+    json_free(&json);
+    got.len = 0;
+    p = json_parser(&json);
+    p.skip = jspec_skip_unrequested;
+    p.skip_data = jspec;
+    PROP_GO(&e, parse_bytewise(in, &p), cu);
+    PROP_GO(&e, dump_line(json.root, &got), cu);
+    DSTR_STATIC(skip_exp,
+        "{\"n\":12,\"obj\":{\"keep\":true},\"opt\":{\"keep\":2},"
+        "\"strict\":{\"extra\":1}}"
+    );
+    EXPECT_DM_GO(&e, "skipped", got, skip_exp, cu);
+    PROP_GO(&e, jspec_read(jspec, json.root), cu);
+    EXPECT_I_GO(&e, "n", n, 12, cu);
+    EXPECT_B_GO(&e, "keep", keep, true, cu);
+    EXPECT_I_GO(&e, "opt_keep", opt_keep, 2, cu);
+
+    // skipping everything leaves an empty object
+    json_free(&json);
+    got.len = 0;
+    jspec = JOBJ(true, JKEY("missing", JPTR(&strict)));
+    p = json_parser(&json);
+    p.skip = jspec_skip_unrequested;
+    p.skip_data = jspec;
+    PROP_GO(&e, parse_bytewise(in, &p), cu);
+    PROP_GO(&e, dump_line(json.root, &got), cu);
+    EXPECT_DM_GO(&e, "skip all", got, DSTR_LIT("{}"), cu);
+
+    // unbalanced skipped values are still errors
+    json_free(&json);
+    p = json_parser(&json);
+    p.skip = jspec_skip_unrequested;
+    p.skip_data = jspec;
+    derr_t e2 = parse_bytewise(DSTR_LIT("{\"a\": [1}"), &p);
+    EXPECT_E_VAR_GO(&e, "unbalanced", &e2, E_PARAM, cu);
+    json_free(&json);
+    p = json_parser(&json);
+    p.skip = jspec_skip_unrequested;
+    p.skip_data = jspec;
+    e2 = parse_bytewise(DSTR_LIT("{\"a\": \"}"), &p);
+    EXPECT_E_VAR_GO(&e, "unterminated", &e2, E_PARAM, cu);
+
+cu:
+    dstr_free(&got);
+    json_free(&json);
+    return e;
+}
+
 #define EXPECT_VALID_JSPEC_GO(label) \
     EXPECT_DM_GO(&e, "errbuf", errbuf, DSTR_LIT(""), label); \
     EXPECT_B_GO(&e, "ok", ok, true, label)
@@ -484,6 +621,7 @@ int main(int argc, char** argv){
     PROP_GO(&e, test_json_parse(), test_fail);
     PROP_GO(&e, test_json_preallocated(), test_fail);
     PROP_GO(&e, test_json_fdump(), test_fail);
+    PROP_GO(&e, test_json_skip(), test_fail);
     PROP_GO(&e, test_jspec_read(), test_fail);
     PROP_GO(&e, test_unicode(), test_fail);
 
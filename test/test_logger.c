@@ -326,6 +326,108 @@ cu:
 }
 
 
+#define ASYNC_THREADS 4
+#define ASYNC_LINES 1000
+
+static void *async_logger_thread(void *arg){
+    size_t t = (size_t)(uintptr_t)arg;
+    for(size_t i = 0; i < ASYNC_LINES; i++){
+        LOG_DEBUG("%x:%x\n", FU(t), FU(i));
+    }
+    return NULL;
+}
+
+// every thread's lines must be present, and in order
+static derr_t check_async_lines(const dstr_t text){
+    derr_t e = E_OK;
+
+    size_t next[ASYNC_THREADS] = {0};
+    dstr_t rest = text;
+    while(rest.len){
+        dstr_t line, t, i;
+        size_t n, tnum, inum;
+        dstr_split2_soft(rest, DSTR_LIT("\n"), NULL, &line, &rest);
+        dstr_split2_soft(line, DSTR_LIT(":"), &n, &t, &i);
+        if(n != 2) continue;
+        if(dstr_tosize_quiet(t, &tnum, 10)) continue;
+        if(dstr_tosize_quiet(i, &inum, 10)) continue;
+        if(tnum >= ASYNC_THREADS) continue;
+        EXPECT_U(&e, "line number", inum, next[tnum]);
+        next[tnum]++;
+    }
+    for(size_t t = 0; t < ASYNC_THREADS; t++){
+        EXPECT_U(&e, "lines from thread", next[t], ASYNC_LINES);
+    }
+
+    return e;
+}
+
+static derr_t test_log_async(void){
+    derr_t e = E_OK;
+
+    DSTR_VAR(temp, 256);
+    DSTR_VAR(log, 256);
+    dstr_t got = {0};
+    size_t nstarted = 0;
+    dthread_t threads[ASYNC_THREADS];
+
+    PROP(&e, mkdir_temp("test-logger", &temp) );
+    PROP_GO(&e, FMT(&log, "%x/log", FD(temp)), cu);
+    PROP_GO(&e, dstr_new(&got, 4096), cu);
+
+    logger_clear_outputs();
+    PROP_GO(&e, logger_add_filename(LOG_LVL_DEBUG, log.data), cu);
+
+    size_t dropped = logger_dropped();
+    PROP_GO(&e, logger_start_async(0), cu);
+
+    // log_flush() waits for the drain thread
+    LOG_DEBUG("flushed\n");
+    log_flush();
+    PROP_GO(&e, dstr_read_file(log.data, &got), cu);
+    EXPECT_D_GO(&e, "log", got, DSTR_LIT("flushed\n"), cu);
+    got.len = 0;
+
+    for(; nstarted < ASYNC_THREADS; nstarted++){
+        void *arg = (void*)(uintptr_t)nstarted;
+        PROP_GO(&e,
+            dthread_create(&threads[nstarted], async_logger_thread, arg),
+        cu);
+    }
+    for(; nstarted > 0; nstarted--){
+        dthread_join(&threads[nstarted - 1]);
+    }
+    logger_stop_async();
+
+    // a message too big for its ring is dropped, then reported
+    DSTR_VAR(big, 4096);
+    memset(big.data, 'x', big.size);
+    big.len = big.size;
+    PROP_GO(&e, logger_start_async(1024), cu);
+    LOG_DEBUG("%x\n", FD(big));
+    EXPECT_U_GO(&e, "dropped", logger_dropped(), dropped + 1, cu);
+    logger_stop_async();
+
+    PROP_GO(&e, dstr_read_file(log.data, &got), cu);
+    PROP_GO(&e, check_async_lines(got), cu);
+    if(!dstr_contains(got, DSTR_LIT("logger dropped 1 messages\n"))){
+        ORIG_GO(&e, E_VALUE, "drop was not reported", cu);
+    }
+
+cu:
+    for(; nstarted > 0; nstarted--){
+        dthread_join(&threads[nstarted - 1]);
+    }
+    logger_stop_async();
+    dstr_free(&got);
+    DROP_CMD( rm_rf_path(&SBD(temp)) );
+    logger_clear_outputs();
+    logger_add_fileptr(LOG_LVL_WARN, stdout);
+
+    return e;
+}
+
+
 int main(int argc, char **argv){
     derr_t e = E_OK;
     // parse options and set default log level
@@ -340,6 +442,7 @@ int main(int argc, char **argv){
     PROP_GO(&e, test_merge(), test_fail);
     PROP_GO(&e, test_merge_noleak(), test_fail);
     PROP_GO(&e, test_log_stack_and_heap(), test_fail);
+    PROP_GO(&e, test_log_async(), test_fail);
 
     int exitval;
 test_fail:
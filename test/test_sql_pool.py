@@ -0,0 +1,17 @@
+import subprocess
+import sys
+
+import mariadb
+
+
+def main(test_sql_pool_path):
+    with mariadb.mariadb(None, None, None) as runner:
+        subprocess.run([test_sql_pool_path, runner.sockpath], check=True)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) > 1:
+        test_sql_pool_path = sys.argv[1]
+    else:
+        test_sql_pool_path = "server/mysql_util/test_sql_pool"
+    main(test_sql_pool_path)
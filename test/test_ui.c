@@ -60,6 +60,41 @@ static derr_t stop_async_reader(dstr_t** out){
 }
 
 static int real_stdout_fd;
+static int real_stdin_fd;
+
+// replace stdin with a pipe already holding all of text
+static derr_t fake_stdin(const char *text){
+    derr_t e = E_OK;
+    int fds[2];
+    int ret = compat_pipe(fds);
+    if(ret != 0){
+        ORIG(&e, E_OS, "fake_stdin failed to open pipe: %x", FE(errno));
+    }
+    size_t len = strlen(text);
+    ssize_t amnt = compat_write(fds[1], text, len);
+    compat_close(fds[1]);
+    if(amnt < 0 || (size_t)amnt != len){
+        compat_close(fds[0]);
+        ORIG(&e, E_OS, "fake_stdin failed to fill pipe");
+    }
+    compat_close(0);
+    ret = compat_dup(fds[0]);
+    compat_close(fds[0]);
+    if(ret < 0){
+        ORIG(&e, E_OS, "fake_stdin failed to dupe pipe: %x", FE(errno));
+    }
+    clearerr(stdin);
+    return e;
+}
+
+static void restore_stdin(void){
+    compat_close(0);
+    if(compat_dup(real_stdin_fd) < 0){
+        perror("dup");
+        UH_OH("run_test_case failed to restore stdin\n");
+    }
+    clearerr(stdin);
+}
 
 struct test_case_t {
     char* test_name;
@@ -81,6 +116,10 @@ struct test_case_t {
     struct api_password_args_t api_password_args;
     bool call_api_token;
     struct api_token_args_t api_token_args;
+    // for batch mode, a list of calls to expect instead of api_token_args
+    struct api_token_args_t* batch_args;
+    size_t nbatch_args;
+    char* stdin_text;
     char** creatables;
     char** passwords;
     char** strings;
@@ -108,7 +147,14 @@ static derr_t run_test_case(struct test_case_t test){
     configure_args = &test.configure_args;
     register_token_args = &test.register_token_args;
     api_password_args = &test.api_password_args;
-    api_token_args = &test.api_token_args;
+    if(test.batch_args){
+        api_token_args = test.batch_args;
+        napi_token_args = test.nbatch_args;
+    }else{
+        api_token_args = &test.api_token_args;
+        napi_token_args = 1;
+    }
+    api_token_calls = 0;
     read_token_error = test.read_token_error;
     read_token_notok = test.read_token_notok;
     token_to_read = &test.token_to_read;
@@ -147,11 +193,13 @@ static derr_t run_test_case(struct test_case_t test){
         temp++;
         argc++;
     }
+    if(test.stdin_text) PROP(&e, fake_stdin(test.stdin_text) );
     PROP(&e, FFMT(stderr, "running do_main\n") );
     // start the async_reader
     PROP(&e, start_async_reader(&fds[0]) );
     // run the test
     int main_ret = do_main(dummy_ui_harness(), argc, local_argv, false);
+    if(test.stdin_text) restore_stdin();
     // capture stdout (and stop_async_reader)
     fflush(stdout);
     compat_close(1);
@@ -194,6 +242,9 @@ static derr_t run_test_case(struct test_case_t test){
     if(test.call_api_token != api_token_called)
         UH_OH("run_test_case api_token_called exp %x but got %x\n",
               FB(test.call_api_token), FB(api_token_called));
+    if(test.batch_args && test.nbatch_args != api_token_calls)
+        UH_OH("run_test_case api_token_calls exp %x but got %x\n",
+              FU(test.nbatch_args), FU(api_token_calls));
     if(test.expect_return != main_ret)
         UH_OH("run_test_case do_main return exp %x but got %x\n",
               FI(test.expect_return), FI(main_ret));
@@ -559,6 +610,132 @@ static derr_t run_all_cases(char *tmpconf){
         PROP(&e, run_test_case(test_case) );
     }
 
+    // test batch mode, one api_token_call() per line of stdin
+    {
+        #define OK_JSON "{\"status\":\"success\",\"contents\":\"ok\"}"
+        #define ERR_LINE(why) \
+            "{\"contents\":\"" why "\",\"status\":\"error\"}\n"
+        #define BATCH_ARGS(_path, _arg, _nonce) { \
+            .baseurl = "https://splintermail.com", \
+            .path = _path, \
+            .arg = _arg, \
+            .token = {.key = 12345, \
+                      .secret = DSTR_LIT("ABCDEF"), \
+                      .nonce = _nonce}, \
+            .json = OK_JSON, \
+            .to_return = E_OK, \
+        }
+        // each reservation increments the nonce once, and only calls reserve
+        struct api_token_args_t args[2] = {
+            BATCH_ARGS("/api/list_aliases", NULL, 1),
+            BATCH_ARGS("/api/delete_alias", "a@splintermail.com", 2),
+        };
+        struct test_case_t test_case, base_case = {
+            .call_api_token = true,
+            .token_to_read = {.key = 12345,
+                              .secret = DSTR_LIT("ABCDEF"),
+                              .nonce = 0},
+            .batch_args = args,
+            .nbatch_args = 2,
+            .users = (char*[]){"user@fqdn", NULL},
+            .argv = (char*[]){SM, "batch", NULL},
+        };
+
+        test_case = base_case;
+        test_case.test_name = "batch test";
+        // blank lines are skipped and the last line needs no newline
+        test_case.stdin_text =
+            "{\"command\":\"list_aliases\"}\n"
+            "\n"
+            "{\"command\":\"delete_alias\",\"arg\":\"a@splintermail.com\"}";
+        test_case.expect_out = OK_JSON "\n" OK_JSON "\n";
+        PROP(&e, run_test_case(test_case) );
+
+        test_case = base_case;
+        test_case.test_name = "batch invalid json test";
+        test_case.nbatch_args = 1;
+        test_case.stdin_text =
+            "{\"command\":\n"
+            "{\"command\":\"list_aliases\"}\n";
+        test_case.expect_out = ERR_LINE("invalid json") OK_JSON "\n";
+        test_case.expect_return = 14;
+        PROP(&e, run_test_case(test_case) );
+
+        test_case = base_case;
+        test_case.test_name = "batch refused command test";
+        test_case.nbatch_args = 1;
+        test_case.stdin_text =
+            "{\"command\":\"delete_account\"}\n"
+            "{\"command\":\"list_aliases\"}\n";
+        test_case.expect_out =
+            ERR_LINE("command not allowed in batch mode") OK_JSON "\n";
+        test_case.expect_return = 14;
+        PROP(&e, run_test_case(test_case) );
+
+        // a failed call doesn't stop the batch, but it does set the exit code
+        test_case = base_case;
+        test_case.test_name = "batch failed command test";
+        struct api_token_args_t failed_args[2] = {
+            BATCH_ARGS("/api/list_aliases", NULL, 1),
+            BATCH_ARGS("/api/list_aliases", NULL, 2),
+        };
+        failed_args[0].to_return = (derr_t){E_RESPONSE};
+        test_case.batch_args = failed_args;
+        test_case.stdin_text =
+            "{\"command\":\"list_aliases\"}\n"
+            "{\"command\":\"list_aliases\"}\n";
+        test_case.expect_out = ERR_LINE("REST API call failed") OK_JSON "\n";
+        test_case.expect_return = 14;
+        PROP(&e, run_test_case(test_case) );
+
+        // so does a response without "status":"success"
+        test_case = base_case;
+        test_case.test_name = "batch failed status test";
+        struct api_token_args_t fail_status_args[1] = {
+            BATCH_ARGS("/api/list_aliases", NULL, 1),
+        };
+        fail_status_args[0].json = "{\"status\":\"fail\",\"contents\":\"no\"}";
+        test_case.batch_args = fail_status_args;
+        test_case.nbatch_args = 1;
+        test_case.stdin_text = "{\"command\":\"list_aliases\"}\n";
+        test_case.expect_out = "{\"status\":\"fail\",\"contents\":\"no\"}\n";
+        test_case.expect_return = 14;
+        PROP(&e, run_test_case(test_case) );
+
+        // a rejected token ends the batch immediately
+        test_case = base_case;
+        test_case.test_name = "batch rejected token test";
+        struct api_token_args_t token_args[1] = {
+            BATCH_ARGS("/api/list_aliases", NULL, 1),
+        };
+        token_args[0].to_return = (derr_t){E_TOKEN};
+        test_case.batch_args = token_args;
+        test_case.nbatch_args = 1;
+        test_case.stdin_text =
+            "{\"command\":\"list_aliases\"}\n"
+            "{\"command\":\"list_aliases\"}\n";
+        test_case.expect_out = "";
+        test_case.expect_return = 9;
+        PROP(&e, run_test_case(test_case) );
+
+        // batch mode can't prompt for a password to register a token
+        test_case = base_case;
+        test_case.test_name = "batch without creds test";
+        test_case.call_api_token = false;
+        test_case.nbatch_args = 0;
+        test_case.creatables = (char*[]){"noreg.user@fqdn/api_token.json",
+                                         NULL};
+        test_case.users = (char*[]){"noreg.user@fqdn", NULL};
+        test_case.stdin_text = "{\"command\":\"list_aliases\"}\n";
+        test_case.expect_out = "";
+        test_case.expect_return = 18;
+        PROP(&e, run_test_case(test_case) );
+
+        #undef BATCH_ARGS
+        #undef ERR_LINE
+        #undef OK_JSON
+    }
+
     // test API COMMAND args, api_password_call(), no register
     {
         // define our token
@@ -859,6 +1036,12 @@ int main(int argc, char** argv){
         perror("dup");
         goto fail;
     }
+    // and stdin, for batch mode
+    real_stdin_fd = compat_dup(0);
+    if(real_stdin_fd < 0){
+        perror("dup");
+        goto fail;
+    }
 
     PROP_GO(&e, run_all_cases(tmpconf.data), fail);
     PROP_GO(&e, test_trim_logfile(), fail);
@@ -435,6 +435,11 @@ else:
     cc = "gcc"
 
 def run_c_e2e_test(grammar_text):
+    # every C test runs against every C backend
+    for generator in ("c", "c-threaded"):
+        _run_c_e2e_test(grammar_text, generator)
+
+def _run_c_e2e_test(grammar_text, generator):
     def assert_compile_success(p):
         if p.wait() == 0:
             return
@@ -446,7 +451,7 @@ def run_c_e2e_test(grammar_text):
         raise AssertionError("compile step failed")
 
     with open("test.c", "w") as f:
-        gen.gen(grammar_text, 'c', f)
+        gen.gen(grammar_text, generator, f)
 
     if cc == "cl.exe":
         p = Popen([cc, "test.c"])
@@ -1562,4 +1567,67 @@ int main(int argc, char **argv){
 }}}
 """)
 
+# test %recover-style recovery from errors deep inside nested calls, which
+# the c-threaded backend unwinds through direct calls instead of _do_parse
+run_c_e2e_test(r"""
+%root line;
+%type i {int};
+
+NUM:i;
+PLUS;
+EOL;
+
+line:i = < sum:s {$$ = $s;} ? {$$ = -1;} > EOL;
+sum:i = term:a {$$ = $a;} *(PLUS term:b {$$ += $b;});
+term:i = NUM:n {$$ = $n;};
+
+{{{
+struct token {
+    token_e tok;
+    int val;
+};
+
+int do_test(parser_t *p, struct token *tokens, size_t ntokens, int exp){
+    status_e status = STATUS_OK;
+    size_t i = 0;
+    int out = 0;
+    while(status == STATUS_OK && i < ntokens){
+        status = parse_line(
+            p, tokens[i].tok, (val_u){.i=tokens[i].val}, &out, NULL
+        );
+        i++;
+    }
+
+    if(i != ntokens || status != STATUS_DONE){
+        fprintf(stderr, "bad exit conditions %d\n", (int)status);
+        return 1;
+    }
+
+    if(out != exp){
+        fprintf(stderr, "bad out: %d != %d\n", out, exp);
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv){
+    ONSTACK_PARSER(p, 3, 10);
+
+    struct token ok[] = {{NUM, 1}, {PLUS}, {NUM, 2}, {PLUS}, {NUM, 3}, {EOL}};
+    struct token bad[] = {{NUM, 1}, {PLUS}, {PLUS}, {NUM, 2}, {EOL}};
+    struct token early[] = {{NUM, 1}, {PLUS}, {EOL}};
+
+    int wrong = 0;
+    wrong += do_test(&p, ok, sizeof(ok)/sizeof(*ok), 6);
+    wrong += do_test(&p, bad, sizeof(bad)/sizeof(*bad), -1);
+    // the parser is reusable after recovering
+    wrong += do_test(&p, ok, sizeof(ok)/sizeof(*ok), 6);
+    wrong += do_test(&p, early, sizeof(early)/sizeof(*early), -1);
+
+    return wrong;
+}
+}}}
+""")
+
 print("PASS")